@@ -0,0 +1,329 @@
+/*
+    animationinstancer.cpp
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "animationinstancer_p.h"
+#include <Qt3DAnimation/QAnimationCallback>
+#include <Qt3DAnimation/QAnimationClip>
+#include <Qt3DAnimation/QCallbackMapping>
+#include <Qt3DAnimation/QChannelMapper>
+#include <Qt3DAnimation/QClipAnimator>
+#include <Qt3DAnimation/QClock>
+#include <Qt3DCore/QTransform>
+#include <QMetaProperty>
+#include <QPointer>
+#include <QQuaternion>
+#include <QVector3D>
+#include <algorithm>
+#include <cstring>
+
+QT_BEGIN_NAMESPACE
+
+namespace Kuesa {
+
+class AnimationInstancer::FanOutCallback : public Qt3DAnimation::QAnimationCallback
+{
+public:
+    struct Sink {
+        // Transform properties animated by glTF clips are written through
+        // their setter rather than a QVariant based QMetaProperty write
+        enum Setter {
+            Property,
+            Translation,
+            Rotation,
+            Scale3D
+        };
+
+        AnimationPlayer *player;
+        QPointer<QObject> target;
+        QMetaProperty property;
+        Setter setter;
+    };
+
+    explicit FanOutCallback(const QString &channelName)
+        : m_channelName(channelName)
+    {
+    }
+
+    // Called on the owning thread, once per evaluation of the group clip
+    void valueChanged(const QVariant &value) override
+    {
+        // Unpacked once for all the sinks
+        const int type = value.userType();
+        const QVector3D vector = type == QMetaType::QVector3D ? value.value<QVector3D>() : QVector3D();
+        const QQuaternion quaternion = type == QMetaType::QQuaternion ? value.value<QQuaternion>() : QQuaternion();
+
+        for (const Sink &sink : m_sinks) {
+            QObject *target = sink.target.data();
+            if (target == nullptr)
+                continue;
+            switch (sink.setter) {
+            case Sink::Translation:
+                static_cast<Qt3DCore::QTransform *>(target)->setTranslation(vector);
+                break;
+            case Sink::Rotation:
+                static_cast<Qt3DCore::QTransform *>(target)->setRotation(quaternion);
+                break;
+            case Sink::Scale3D:
+                static_cast<Qt3DCore::QTransform *>(target)->setScale3D(vector);
+                break;
+            case Sink::Property:
+                sink.property.write(target, value);
+                break;
+            }
+        }
+    }
+
+    static Sink::Setter setterFor(QObject *target, const QMetaProperty &property)
+    {
+        if (qobject_cast<Qt3DCore::QTransform *>(target) == nullptr)
+            return Sink::Property;
+        if (std::strcmp(property.name(), "translation") == 0)
+            return Sink::Translation;
+        if (std::strcmp(property.name(), "rotation") == 0)
+            return Sink::Rotation;
+        if (std::strcmp(property.name(), "scale3D") == 0)
+            return Sink::Scale3D;
+        return Sink::Property;
+    }
+
+    QString channelName() const { return m_channelName; }
+    std::vector<Sink> &sinks() { return m_sinks; }
+
+private:
+    QString m_channelName;
+    std::vector<Sink> m_sinks;
+};
+
+struct AnimationInstancer::Group {
+    QPointer<Qt3DAnimation::QAnimationClip> clip;
+    QPointer<Qt3DAnimation::QChannelMapper> sourceMapper;
+    QPointer<Qt3DAnimation::QClock> clock;
+    int loopCount = 1;
+    float phaseOffset = 0.0f;
+    // Only player of an independent group, nullptr for a shared one
+    AnimationPlayer *owner = nullptr;
+
+    Qt3DAnimation::QClipAnimator *animator = nullptr;
+    Qt3DAnimation::QChannelMapper *mapper = nullptr;
+    std::vector<std::unique_ptr<FanOutCallback>> callbacks;
+    std::vector<AnimationPlayer *> players;
+};
+
+AnimationInstancer::AnimationInstancer(Qt3DCore::QNode *parent)
+    : Qt3DCore::QNode(parent)
+{
+}
+
+AnimationInstancer::~AnimationInstancer()
+{
+    while (!m_groups.empty())
+        removeGroup(m_groups.size() - 1);
+}
+
+Qt3DAnimation::QClipAnimator *AnimationInstancer::join(AnimationPlayer *player,
+                                                        Qt3DAnimation::QAnimationClip *clip,
+                                                        Qt3DAnimation::QChannelMapper *mapper,
+                                                        Qt3DAnimation::QClock *clock,
+                                                        int loopCount,
+                                                        const std::vector<Target> &targets,
+                                                        float phaseOffset,
+                                                        bool shared)
+{
+    leave(player);
+    if (clip == nullptr || mapper == nullptr)
+        return nullptr;
+
+    // A shared group that is no longer running, once its last loop is done,
+    // isn't joined: restarting it would restart all its players
+    const AnimationPlayer *owner = shared ? nullptr : player;
+    auto groupIt = std::find_if(m_groups.begin(), m_groups.end(), [&](const std::unique_ptr<Group> &group) {
+        return group->clip == clip && group->sourceMapper == mapper &&
+                group->clock == clock && group->loopCount == loopCount &&
+                group->phaseOffset == phaseOffset && group->owner == owner &&
+                (owner != nullptr || group->animator->isRunning());
+    });
+
+    if (groupIt == m_groups.end()) {
+        auto group = std::make_unique<Group>();
+        group->clip = clip;
+        group->sourceMapper = mapper;
+        group->clock = clock;
+        group->loopCount = loopCount;
+        group->phaseOffset = phaseOffset;
+        group->owner = shared ? nullptr : player;
+        group->mapper = new Qt3DAnimation::QChannelMapper(this);
+        group->animator = new Qt3DAnimation::QClipAnimator(this);
+        group->animator->setClip(clip);
+        group->animator->setClock(clock);
+        group->animator->setLoopCount(loopCount);
+        group->animator->setChannelMapper(group->mapper);
+        group->animator->setNormalizedTime(phaseOffset);
+        group->animator->setRunning(shared);
+        m_groups.push_back(std::move(group));
+        groupIt = m_groups.end() - 1;
+    }
+
+    Group *group = groupIt->get();
+    bool hasSinks = false;
+    for (const Target &target : targets) {
+        if (target.target == nullptr)
+            continue;
+        const QMetaObject *metaObject = target.target->metaObject();
+        const int propertyIndex = metaObject->indexOfProperty(target.propertyName.constData());
+        if (propertyIndex < 0 || !metaObject->property(propertyIndex).isWritable())
+            continue;
+        const QMetaProperty property = metaObject->property(propertyIndex);
+
+        // One callback, hence one mapping, per channel whatever the number
+        // of players sharing the group
+        auto callbackIt = std::find_if(group->callbacks.begin(), group->callbacks.end(), [&](const std::unique_ptr<FanOutCallback> &callback) {
+            return callback->channelName() == target.channelName;
+        });
+        if (callbackIt == group->callbacks.end()) {
+            group->callbacks.push_back(std::make_unique<FanOutCallback>(target.channelName));
+            callbackIt = group->callbacks.end() - 1;
+
+            auto mapping = new Qt3DAnimation::QCallbackMapping;
+            mapping->setChannelName(target.channelName);
+            mapping->setCallback(property.userType(), callbackIt->get());
+            group->mapper->addMapping(mapping);
+        }
+
+        (*callbackIt)->sinks().push_back({ player, target.target, property, FanOutCallback::setterFor(target.target, property) });
+        hasSinks = true;
+    }
+
+    if (!hasSinks) {
+        if (group->players.empty())
+            removeGroup(size_t(std::distance(m_groups.begin(), groupIt)));
+        return nullptr;
+    }
+
+    group->players.push_back(player);
+    return group->animator;
+}
+
+void AnimationInstancer::leave(AnimationPlayer *player)
+{
+    const auto groupIt = findGroup(player);
+    if (groupIt == m_groups.end())
+        return;
+
+    Group *group = groupIt->get();
+    group->players.erase(std::find(group->players.begin(), group->players.end(), player));
+    if (group->players.empty()) {
+        removeGroup(size_t(std::distance(m_groups.begin(), groupIt)));
+        return;
+    }
+
+    for (const std::unique_ptr<FanOutCallback> &callback : group->callbacks) {
+        std::vector<FanOutCallback::Sink> &sinks = callback->sinks();
+        sinks.erase(std::remove_if(sinks.begin(), sinks.end(), [player](const FanOutCallback::Sink &sink) {
+                        return sink.player == player;
+                    }),
+                    sinks.end());
+    }
+}
+
+Qt3DAnimation::QClipAnimator *AnimationInstancer::setShared(AnimationPlayer *player, bool shared)
+{
+    const auto groupIt = findGroup(player);
+    if (groupIt == m_groups.end())
+        return nullptr;
+
+    Group *group = groupIt->get();
+    if ((group->owner == nullptr) == shared)
+        return group->animator;
+
+    // Sole player of a shared group, no need to move it
+    if (!shared && group->players.size() == 1) {
+        group->owner = player;
+        return group->animator;
+    }
+
+    std::vector<Target> targets;
+    for (const std::unique_ptr<FanOutCallback> &callback : group->callbacks) {
+        for (const FanOutCallback::Sink &sink : callback->sinks()) {
+            if (sink.player == player)
+                targets.push_back({ callback->channelName(), sink.target.data(), QByteArray(sink.property.name()) });
+        }
+    }
+
+    const float normalizedTime = group->animator->normalizedTime();
+    const bool running = group->animator->isRunning();
+    Qt3DAnimation::QClipAnimator *animator = join(player, group->clip, group->sourceMapper, group->clock,
+                                                  group->loopCount, targets, group->phaseOffset, shared);
+    // The group may have been destroyed by the player leaving it
+    if (animator != nullptr && !shared) {
+        animator->setNormalizedTime(normalizedTime);
+        animator->setRunning(running);
+    }
+    return animator;
+}
+
+int AnimationInstancer::groupCount() const
+{
+    return int(m_groups.size());
+}
+
+int AnimationInstancer::instanceCount() const
+{
+    size_t count = 0;
+    for (const std::unique_ptr<Group> &group : m_groups)
+        count += group->players.size();
+    return int(count);
+}
+
+int AnimationInstancer::mappingCount() const
+{
+    size_t count = 0;
+    for (const std::unique_ptr<Group> &group : m_groups)
+        count += group->callbacks.size();
+    return int(count);
+}
+
+std::vector<std::unique_ptr<AnimationInstancer::Group>>::iterator AnimationInstancer::findGroup(const AnimationPlayer *player)
+{
+    return std::find_if(m_groups.begin(), m_groups.end(), [player](const std::unique_ptr<Group> &group) {
+        return std::find(group->players.begin(), group->players.end(), player) != group->players.end();
+    });
+}
+
+void AnimationInstancer::removeGroup(size_t groupIndex)
+{
+    // The animator goes first so that the callbacks are no longer referenced
+    // when they are destroyed with the group
+    std::unique_ptr<Group> group = std::move(m_groups[groupIndex]);
+    m_groups.erase(m_groups.begin() + groupIndex);
+    delete group->animator;
+    delete group->mapper;
+}
+
+} // namespace Kuesa
+
+QT_END_NAMESPACE
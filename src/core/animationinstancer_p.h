@@ -0,0 +1,122 @@
+/*
+    animationinstancer_p.h
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef KUESA_ANIMATIONINSTANCER_P_H
+#define KUESA_ANIMATIONINSTANCER_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Kuesa API.  It exists for the convenience
+// of other Kuesa classes.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <Kuesa/private/kuesa_global_p.h>
+#include <Qt3DCore/QNode>
+#include <QByteArray>
+#include <QString>
+#include <memory>
+#include <vector>
+
+QT_BEGIN_NAMESPACE
+
+namespace Qt3DAnimation {
+class QAnimationClip;
+class QChannelMapper;
+class QClipAnimator;
+class QClock;
+} // namespace Qt3DAnimation
+
+namespace Kuesa {
+
+class AnimationPlayer;
+
+// Shares the evaluation of a clip between the instanced AnimationPlayers of a
+// SceneEntity playing it with the same mapper, clock, loop count and phase
+// offset. Each group of players runs a single QClipAnimator whose mappings
+// are callbacks writing every evaluated value to the targets of all the
+// players of the group, rather than one animator and one set of mappings per
+// player.
+//
+// Shared groups only hold running players, which play in lockstep. A player
+// that is stopped or seeked on its own is moved to an independent group it is
+// the only member of, so that its transport doesn't affect the others.
+class KUESA_PRIVATE_EXPORT AnimationInstancer : public Qt3DCore::QNode
+{
+    Q_OBJECT
+public:
+    struct Target {
+        QString channelName;
+        QObject *target;
+        QByteArray propertyName;
+    };
+
+    explicit AnimationInstancer(Qt3DCore::QNode *parent = nullptr);
+    ~AnimationInstancer();
+
+    // Adds the targets of player to the matching group, creating it if
+    // needed, and returns the animator of that group. Returns nullptr if none
+    // of the targets can be animated.
+    Qt3DAnimation::QClipAnimator *join(AnimationPlayer *player,
+                                       Qt3DAnimation::QAnimationClip *clip,
+                                       Qt3DAnimation::QChannelMapper *mapper,
+                                       Qt3DAnimation::QClock *clock,
+                                       int loopCount,
+                                       const std::vector<Target> &targets,
+                                       float phaseOffset = 0.0f,
+                                       bool shared = true);
+    void leave(AnimationPlayer *player);
+
+    // Moves player to a shared or independent group, keeping its targets.
+    // An independent group resumes from the time and running state of the
+    // group the player leaves. Returns the animator of the new group.
+    Qt3DAnimation::QClipAnimator *setShared(AnimationPlayer *player, bool shared);
+
+    int groupCount() const;
+    int instanceCount() const;
+    int mappingCount() const;
+
+private:
+    class FanOutCallback;
+    struct Group;
+
+    std::vector<std::unique_ptr<Group>>::iterator findGroup(const AnimationPlayer *player);
+    void removeGroup(size_t groupIndex);
+
+    std::vector<std::unique_ptr<Group>> m_groups;
+};
+
+} // namespace Kuesa
+
+QT_END_NAMESPACE
+
+#endif // KUESA_ANIMATIONINSTANCER_P_H
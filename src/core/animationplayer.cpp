@@ -30,17 +30,45 @@
 
 #include "sceneentity.h"
 #include "kuesa_p.h"
+#include "animationresultbuffer_p.h"
+#include "animationinstancer_p.h"
+#include "morphcontroller.h"
 
 #include <Qt3DAnimation/QClipAnimator>
 #include <Qt3DAnimation/QChannelMapping>
+#include <Qt3DAnimation/QCallbackMapping>
+#include <Qt3DAnimation/QSkeletonMapping>
 #include <Qt3DAnimation/QAnimationClip>
 #include <Qt3DAnimation/QClock>
+#include <Qt3DLogic/QFrameAction>
 #include <QTimer>
+#include <algorithm>
+#include <cmath>
 
 QT_USE_NAMESPACE
 using namespace Kuesa;
 using namespace Qt3DAnimation;
 
+namespace {
+
+// The morphWeights list property is animated with one float per weight, all
+// the weights of an evaluation are set at once, notifying once
+bool writeMorphWeights(QObject *target, int, const float *values, int count)
+{
+    QVector<float> weights(count);
+    std::copy(values, values + count, weights.begin());
+    static_cast<MorphController *>(target)->setWeights(weights);
+    return true;
+}
+
+bool isMorphWeights(QObject *target, const QByteArray &propertyName)
+{
+    return qobject_cast<MorphController *>(target) != nullptr &&
+            propertyName == QByteArrayLiteral("morphWeights");
+}
+
+} // namespace
+
 /*!
  * \class Kuesa::AnimationPlayer
  * \inheaderfile Kuesa/AnimationPlayer
@@ -242,6 +270,116 @@ using namespace Qt3DAnimation;
     \since 1.1
 */
 
+/*!
+    \property AnimationPlayer::batched
+    \brief controls whether animated values are applied in batches
+
+    When false (default), each animated property is written by Qt3D as soon
+    as its value is received from the animation jobs.
+
+    When true, the values are collected by the SceneEntity from the
+    animation jobs and written to their targets in a single pass per frame,
+    shared by all the batched AnimationPlayer instances of the scene. Several
+    writes to the same property within a frame are coalesced. This reduces
+    the main thread cost of applying the results when many players run
+    simultaneously. The number of properties written during the last pass is
+    reported by SceneEntity::appliedAnimationPropertyCount.
+
+    \since Kuesa 1.4
+ */
+
+/*!
+    \qmlproperty bool AnimationPlayer::batched
+    \brief controls whether animated values are applied in batches
+
+    When false (default), each animated property is written by Qt3D as soon
+    as its value is received from the animation jobs.
+
+    When true, the values are collected by the SceneEntity from the
+    animation jobs and written to their targets in a single pass per frame,
+    shared by all the batched AnimationPlayer instances of the scene. Several
+    writes to the same property within a frame are coalesced. This reduces
+    the main thread cost of applying the results when many players run
+    simultaneously. The number of properties written during the last pass is
+    reported by SceneEntity::appliedAnimationPropertyCount.
+
+    \since Kuesa 1.4
+ */
+
+/*!
+    \property AnimationPlayer::instanced
+    \brief controls whether the clip evaluation is shared with other players
+
+    When false (default), each AnimationPlayer evaluates its clip and, when
+    targets are specified or batched is true, creates its own set of
+    mappings.
+
+    When true, the clip is evaluated once per frame for all the running
+    instanced AnimationPlayer instances of the scene playing the same clip
+    with the same mapper, clock, loop count and phase offset. The resulting
+    values are then written to the targets of every player of that group.
+    This is useful when animating a large number of copies of a same object.
+
+    An instanced player that is running when its clip is resolved, or that is
+    started after having been reset, joins the group and plays in lockstep
+    with it. Stopping or seeking an instanced player only affects that
+    player, which then evaluates the clip on its own until it is reset and
+    started again. Skeleton mappings are not supported by instanced players.
+
+    \since Kuesa 1.4
+ */
+
+/*!
+    \qmlproperty bool AnimationPlayer::instanced
+    \brief controls whether the clip evaluation is shared with other players
+
+    When false (default), each AnimationPlayer evaluates its clip and, when
+    targets are specified or batched is true, creates its own set of
+    mappings.
+
+    When true, the clip is evaluated once per frame for all the running
+    instanced AnimationPlayer instances of the scene playing the same clip
+    with the same mapper, clock, loop count and phase offset. The resulting
+    values are then written to the targets of every player of that group.
+    This is useful when animating a large number of copies of a same object.
+
+    An instanced player that is running when its clip is resolved, or that is
+    started after having been reset, joins the group and plays in lockstep
+    with it. Stopping or seeking an instanced player only affects that
+    player, which then evaluates the clip on its own until it is reset and
+    started again. Skeleton mappings are not supported by instanced players.
+
+    \since Kuesa 1.4
+ */
+
+/*!
+    \property AnimationPlayer::phaseOffset
+    \brief normalized time at which an instanced player starts the clip
+
+    Instanced players only share the evaluation of the clip with players of
+    the same phase offset. Giving copies of an object a few distinct phase
+    offsets keeps them from moving in unison while still evaluating the clip
+    once per phase offset rather than once per player. The default is 0.
+
+    This has no effect when AnimationPlayer::instanced is false.
+
+    \since Kuesa 1.4
+ */
+
+/*!
+    \qmlproperty real AnimationPlayer::phaseOffset
+    \brief normalized time at which an instanced player starts the clip
+
+    Instanced players only share the evaluation of the clip with players of
+    the same phase offset. Giving copies of an object a few distinct phase
+    offsets keeps them from moving in unison while still evaluating the clip
+    once per phase offset rather than once per player. The default is 0.
+
+    This has no effect when AnimationPlayer::instanced is false.
+
+    \since Kuesa 1.4
+ */
+
 AnimationPlayer::AnimationPlayer(Qt3DCore::QNode *parent)
     : KuesaNode(parent)
     , m_status(None)
@@ -264,6 +402,8 @@ AnimationPlayer::AnimationPlayer(Qt3DCore::QNode *parent)
 
 AnimationPlayer::~AnimationPlayer()
 {
+    leaveInstanceGroup();
+    releaseResultCallbacks();
 }
 
 AnimationPlayer::Status AnimationPlayer::status() const
@@ -366,13 +506,14 @@ void AnimationPlayer::removeTarget(Qt3DCore::QNode *target)
 
 bool AnimationPlayer::isRunning() const
 {
-    return m_animator->isRunning();
+    if (m_frameAction)
+        return m_frontendRunning;
+    return animator()->isRunning();
 }
 
 void AnimationPlayer::setRunning(bool running)
 {
-    if (m_animator->clip())
-        m_animator->setRunning(running);
+    setAnimatorRunning(running);
     m_running = running;
 }
 
@@ -388,7 +529,12 @@ int AnimationPlayer::currentLoop() const
 
 void AnimationPlayer::setLoopCount(int loops)
 {
+    if (loops == m_animator->loopCount())
+        return;
     m_animator->setLoopCount(loops);
+    // Instanced players only share a group with players of same loop count
+    if (m_instanced)
+        matchClipAndTargets();
 }
 
 QClock *AnimationPlayer::clock() const
@@ -398,12 +544,19 @@ QClock *AnimationPlayer::clock() const
 
 void AnimationPlayer::setClock(QClock *clock)
 {
+    if (clock == m_animator->clock())
+        return;
     m_animator->setClock(clock);
+    // Instanced players only share a group with players of same clock
+    if (m_instanced)
+        matchClipAndTargets();
 }
 
 float AnimationPlayer::normalizedTime() const
 {
-    return m_animator->normalizedTime();
+    if (m_frameAction)
+        return m_frontendNormalizedTime;
+    return animator()->normalizedTime();
 }
 
 float AnimationPlayer::duration() const
@@ -411,11 +564,55 @@ float AnimationPlayer::duration() const
     return m_animator->clip() ? m_animator->clip()->duration() : 0.f;
 }
 
+bool AnimationPlayer::isBatched() const
+{
+    return m_batched;
+}
+
+void AnimationPlayer::setBatched(bool batched)
+{
+    if (batched == m_batched)
+        return;
+    m_batched = batched;
+    emit batchedChanged(m_batched);
+    matchClipAndTargets();
+}
+
+bool AnimationPlayer::isInstanced() const
+{
+    return m_instanced;
+}
+
+void AnimationPlayer::setInstanced(bool instanced)
+{
+    if (instanced == m_instanced)
+        return;
+    m_instanced = instanced;
+    emit instancedChanged(m_instanced);
+    matchClipAndTargets();
+}
+
+float AnimationPlayer::phaseOffset() const
+{
+    return m_phaseOffset;
+}
+
+void AnimationPlayer::setPhaseOffset(float phaseOffset)
+{
+    if (phaseOffset == m_phaseOffset)
+        return;
+    m_phaseOffset = phaseOffset;
+    emit phaseOffsetChanged(m_phaseOffset);
+    // Instanced players only share a group with players of same phase offset
+    if (m_instanced)
+        matchClipAndTargets();
+}
+
 void AnimationPlayer::setNormalizedTime(float timeFraction)
 {
     m_runToTimeFraction = -1;
     m_lastKnownNormalizedTime = timeFraction;
-    m_animator->setNormalizedTime(timeFraction);
+    setAnimatorNormalizedTime(timeFraction);
 }
 
 /*!
@@ -426,8 +623,7 @@ void AnimationPlayer::start(int delay)
 {
     QTimer::singleShot(delay, this, [this] {
         m_runToTimeFraction = -1;
-        if (m_animator->clip())
-            m_animator->start();
+        setAnimatorRunning(true);
         m_running = true;
     });
 }
@@ -438,8 +634,7 @@ void AnimationPlayer::start(int delay)
 void AnimationPlayer::stop()
 {
     m_runToTimeFraction = -1;
-    if (m_animator->clip())
-        m_animator->stop();
+    setAnimatorRunning(false);
     m_running = false;
 }
 
@@ -451,9 +646,10 @@ void AnimationPlayer::stop()
 void AnimationPlayer::reset()
 {
     stop();
-    m_animator->setNormalizedTime(0.f);
+    setAnimatorNormalizedTime(0.f);
     setCurrentLoop(0);
     m_lastKnownNormalizedTime = 0.0f;
+    m_instanceAtRest = m_instanceAnimator != nullptr;
 }
 
 /*!
@@ -476,9 +672,8 @@ void AnimationPlayer::run(float fromTimeFraction, float toTimeFraction)
 {
     m_runToTimeFraction = toTimeFraction;
     m_lastKnownNormalizedTime = fromTimeFraction;
-    m_animator->setNormalizedTime(fromTimeFraction);
-    if (m_animator->clip())
-        m_animator->start();
+    setAnimatorNormalizedTime(fromTimeFraction);
+    setAnimatorRunning(true);
     m_running = true;
 }
 
@@ -486,9 +681,11 @@ void AnimationPlayer::matchClipAndTargets()
 {
     QObject::disconnect(m_clipDestroyedConnection);
     QObject::disconnect(m_mapperDestroyedConnection);
+    leaveInstanceGroup();
 
     auto resetAnimator = [this]() {
         setStatus(Error);
+        setFrontendPlayback(false);
         m_animator->setRunning(false);
         if (m_animator->clip()) {
             m_animator->setClip(nullptr);
@@ -546,18 +743,32 @@ void AnimationPlayer::matchClipAndTargets()
         emit durationChanged(clip->duration());
     }
 
-    if (m_targets.isEmpty()) {
+    // When nothing is written back to the targets, as for an AnimationPulse
+    // dispatching precomputed events, evaluating the clip is useless: the
+    // animator is kept stopped and the playback advanced from a frame action
+    if (m_muteTargets) {
+        m_animator->setRunning(false);
+        m_animator->setChannelMapper(nullptr);
+        setGeneratedMapper(nullptr);
+        setFrontendPlayback(true);
+        setStatus(Ready);
+        return;
+    }
+    setFrontendPlayback(false);
+
+    if (m_targets.isEmpty() && !m_batched && !m_instanced) {
         m_animator->setChannelMapper(mapper);
+        setGeneratedMapper(nullptr);
     } else {
         // If we have different number of targets than of mapping, disable, since we can't know which target we want for each mapping
-        if (m_targets.size() != numMappings) {
+        if (!m_targets.isEmpty() && m_targets.size() != numMappings) {
             setStatus(Error);
             qCWarning(kuesa, "Number of targets and mappings need to match");
             return;
         }
 
         // Check that the mappings try to animate a valid property of the target
-        for (int mappingId = 0; mappingId < mappings.size(); ++mappingId) {
+        for (int mappingId = 0; !m_targets.isEmpty() && mappingId < mappings.size(); ++mappingId) {
             Qt3DAnimation::QChannelMapping *mapping = qobject_cast<Qt3DAnimation::QChannelMapping *>(mappings.at(mappingId));
             Qt3DCore::QNode *targetNode = m_targets.at(mappingId);
 
@@ -569,21 +780,89 @@ void AnimationPlayer::matchClipAndTargets()
             }
         }
 
+        // Instanced players don't evaluate the clip themselves, the group
+        // they join evaluates it once for all its players
+        if (m_instanced) {
+            std::vector<AnimationInstancer::Target> instanceTargets;
+            for (int mappingId = 0; mappingId < mappings.size(); ++mappingId) {
+                Qt3DAnimation::QChannelMapping *mapping = qobject_cast<Qt3DAnimation::QChannelMapping *>(mappings.at(mappingId));
+                if (!mapping) {
+                    qCWarning(kuesa, "Skeleton mappings can't be instanced, mapping %i is ignored", mappingId);
+                    continue;
+                }
+                Qt3DCore::QNode *target = m_targets.isEmpty() ? mapping->target() : m_targets.at(mappingId);
+                instanceTargets.push_back({ mapping->channelName(), target, mapping->property().toLatin1() });
+            }
+
+            m_animator->setRunning(false);
+            m_animator->setChannelMapper(nullptr);
+            setGeneratedMapper(nullptr);
+
+            // Running players play in lockstep with the shared group of
+            // their phase offset, others wait on their own to be started
+            m_instancer = m_sceneEntity->animationInstancer();
+            m_instanceAnimator = m_instancer->join(this, clip, mapper, m_animator->clock(),
+                                                   m_animator->loopCount(), instanceTargets,
+                                                   m_phaseOffset, m_running);
+            if (!m_instanceAnimator) {
+                setStatus(Error);
+                qCWarning(kuesa, "No mapped property can be animated by instanced AnimationPlayer");
+                return;
+            }
+
+            m_instanceAtRest = !m_running;
+            connect(m_instanceAnimator, &QClipAnimator::runningChanged, this, &AnimationPlayer::runningChanged);
+            connect(m_instanceAnimator, &QClipAnimator::normalizedTimeChanged, this, &AnimationPlayer::updateNormalizedTime);
+            setStatus(Ready);
+            return;
+        }
+
         // If everything matches and we can animate the targets using the mapping and the clip,
-        // create a new mapper to use those targets
-        Qt3DAnimation::QChannelMapper *newMapper = new Qt3DAnimation::QChannelMapper;
+        // create a new mapper to use those targets. When batched, the values
+        // are routed through the SceneEntity result buffer instead.
+        AnimationResultBuffer *resultBuffer = m_batched ? m_sceneEntity->animationResultBuffer() : nullptr;
+        std::vector<std::shared_ptr<Qt3DAnimation::QAnimationCallback>> resultCallbacks;
+        Qt3DAnimation::QChannelMapper *newMapper = new Qt3DAnimation::QChannelMapper(this);
         for (int mappingId = 0; mappingId < mappings.size(); ++mappingId) {
             Qt3DAnimation::QChannelMapping *oldMapping = qobject_cast<Qt3DAnimation::QChannelMapping *>(mappings.at(mappingId));
-            if (!oldMapping)
+            if (!oldMapping) {
+                // Skeleton mappings are kept as is
+                auto *skeletonMapping = qobject_cast<Qt3DAnimation::QSkeletonMapping *>(mappings.at(mappingId));
+                if (skeletonMapping && m_targets.isEmpty())
+                    newMapper->addMapping(skeletonMapping);
                 continue;
+            }
+
+            Qt3DCore::QNode *target = m_targets.isEmpty() ? oldMapping->target() : m_targets.at(mappingId);
+            if (resultBuffer) {
+                const QByteArray propertyName = oldMapping->property().toLatin1();
+                const bool morphWeights = isMorphWeights(target, propertyName);
+                AnimationResultBuffer::Callback callback = resultBuffer->callbackForProperty(target, propertyName,
+                                                                                             morphWeights ? writeMorphWeights : nullptr);
+                if (callback) {
+                    // Morph weights receive one float per channel component
+                    const int type = morphWeights ? qMetaTypeId<QVector<float>>()
+                                                  : resultBuffer->propertyType(target, propertyName);
+                    Qt3DAnimation::QCallbackMapping *newMapping = new Qt3DAnimation::QCallbackMapping;
+                    newMapping->setChannelName(oldMapping->channelName());
+                    newMapping->setCallback(type, callback.get(), Qt3DAnimation::QAnimationCallback::OnThreadPool);
+                    newMapper->addMapping(newMapping);
+                    resultCallbacks.push_back(std::move(callback));
+                    continue;
+                }
+            }
+
             Qt3DAnimation::QChannelMapping *newMapping = new Qt3DAnimation::QChannelMapping;
             newMapping->setChannelName(oldMapping->channelName());
             newMapping->setProperty(oldMapping->property());
-            newMapping->setTarget(m_targets.at(mappingId));
+            newMapping->setTarget(target);
             newMapper->addMapping(newMapping);
         }
 
         m_animator->setChannelMapper(newMapper);
+        setGeneratedMapper(newMapper);
+        m_resultBuffer = resultBuffer;
+        m_resultCallbacks = std::move(resultCallbacks);
     }
 
     m_animator->setRunning(m_running);
@@ -594,8 +873,7 @@ void AnimationPlayer::updateNormalizedTime(float index)
 {
     if (m_running) {
         if (m_runToTimeFraction > 0. && index >= m_runToTimeFraction) {
-            if (m_animator->clip())
-                m_animator->stop();
+            setAnimatorRunning(false);
             m_runToTimeFraction = -1;
         }
         // Have we moved to the next loop?
@@ -610,6 +888,166 @@ void AnimationPlayer::updateNormalizedTime(float index)
     emit normalizedTimeChanged(index);
 }
 
+void AnimationPlayer::setGeneratedMapper(Qt3DAnimation::QChannelMapper *mapper)
+{
+    // The previous mapper is only destroyed once the animator no longer
+    // references it
+    if (m_generatedMapper == mapper)
+        return;
+    delete m_generatedMapper;
+    m_generatedMapper = mapper;
+    // The result buffer slots the previous mapper wrote to are no longer used
+    releaseResultCallbacks();
+}
+
+Qt3DAnimation::QClipAnimator *AnimationPlayer::animator() const
+{
+    return m_instanceAnimator ? m_instanceAnimator.data() : m_animator;
+}
+
+void AnimationPlayer::leaveInstanceGroup()
+{
+    if (m_instanceAnimator)
+        disconnect(m_instanceAnimator, nullptr, this, nullptr);
+    m_instanceAnimator = nullptr;
+    if (m_instancer)
+        m_instancer->leave(this);
+    m_instancer = nullptr;
+}
+
+void AnimationPlayer::setInstanceShared(bool shared)
+{
+    const bool wasRunning = m_instanceAnimator->isRunning();
+    Qt3DAnimation::QClipAnimator *instanceAnimator = m_instancer->setShared(this, shared);
+    if (instanceAnimator == m_instanceAnimator)
+        return;
+
+    // The group the player left is destroyed if it was its last player
+    if (m_instanceAnimator)
+        disconnect(m_instanceAnimator, nullptr, this, nullptr);
+    m_instanceAnimator = instanceAnimator;
+    if (!m_instanceAnimator) {
+        m_instancer = nullptr;
+        setStatus(Error);
+        return;
+    }
+
+    connect(m_instanceAnimator, &QClipAnimator::runningChanged, this, &AnimationPlayer::runningChanged);
+    connect(m_instanceAnimator, &QClipAnimator::normalizedTimeChanged, this, &AnimationPlayer::updateNormalizedTime);
+    if (m_instanceAnimator->isRunning() != wasRunning)
+        emit runningChanged(m_instanceAnimator->isRunning());
+}
+
+void AnimationPlayer::setInstanceRunning(bool running)
+{
+    if (running == m_instanceAnimator->isRunning())
+        return;
+
+    // Starting from rest joins the shared group, anything else only affects
+    // this player
+    setInstanceShared(running && m_instanceAtRest);
+    m_instanceAtRest = false;
+    if (m_instanceAnimator)
+        m_instanceAnimator->setRunning(running);
+}
+
+void AnimationPlayer::releaseResultCallbacks()
+{
+    if (m_resultBuffer) {
+        for (const auto &callback : m_resultCallbacks)
+            m_resultBuffer->releaseCallback(callback.get());
+    }
+    m_resultBuffer = nullptr;
+    m_resultCallbacks.clear();
+}
+
+void AnimationPlayer::setAnimatorRunning(bool running)
+{
+    if (m_frameAction)
+        setFrontendRunning(running);
+    else if (m_instanceAnimator)
+        setInstanceRunning(running);
+    else if (animator()->clip())
+        animator()->setRunning(running);
+}
+
+void AnimationPlayer::setAnimatorNormalizedTime(float timeFraction)
+{
+    if (m_instanceAnimator) {
+        // Seeking an instanced player doesn't move the rest of its group
+        setInstanceShared(false);
+        m_instanceAtRest = false;
+        if (m_instanceAnimator)
+            m_instanceAnimator->setNormalizedTime(timeFraction);
+        return;
+    }
+    if (!m_frameAction) {
+        animator()->setNormalizedTime(timeFraction);
+        return;
+    }
+    m_frontendNormalizedTime = qBound(0.0f, timeFraction, 1.0f);
+    updateNormalizedTime(m_frontendNormalizedTime);
+}
+
+void AnimationPlayer::setFrontendPlayback(bool enabled)
+{
+    if (enabled) {
+        if (!m_frameAction) {
+            // Resume from where the animator was
+            m_frontendNormalizedTime = m_animator->normalizedTime();
+            m_frameAction = new Qt3DLogic::QFrameAction(this);
+            connect(m_frameAction, &Qt3DLogic::QFrameAction::triggered, this, &AnimationPlayer::advanceFrontendPlayback);
+            setFrontendRunning(m_running);
+        }
+        // Frame actions only trigger when they are a component of the scene
+        if (m_sceneEntity && !m_frameAction->entities().contains(m_sceneEntity))
+            m_sceneEntity->addComponent(m_frameAction);
+        return;
+    }
+
+    if (!m_frameAction)
+        return;
+    const bool wasRunning = m_frontendRunning;
+    delete m_frameAction;
+    m_frameAction = nullptr;
+    m_frontendRunning = false;
+    // Hand the playback back to the animator
+    m_animator->setNormalizedTime(m_frontendNormalizedTime);
+    if (wasRunning != m_animator->isRunning())
+        emit runningChanged(m_animator->isRunning());
+}
+
+void AnimationPlayer::setFrontendRunning(bool running)
+{
+    running = running && m_animator->clip() != nullptr;
+    if (running == m_frontendRunning)
+        return;
+    m_frontendRunning = running;
+    emit runningChanged(m_frontendRunning);
+}
+
+void AnimationPlayer::advanceFrontendPlayback(float dt)
+{
+    const float clipDuration = duration();
+    if (!m_frontendRunning || clipDuration <= 0.0f)
+        return;
+
+    const float playbackRate = m_animator->clock() ? float(m_animator->clock()->playbackRate()) : 1.0f;
+    float time = m_frontendNormalizedTime + dt * playbackRate / clipDuration;
+    bool finished = false;
+    if (time > 1.0f || time < 0.0f) {
+        const int loops = m_animator->loopCount();
+        finished = loops != Infinite && m_currentLoop + 1 >= std::max(loops, 1);
+        time = finished ? qBound(0.0f, time, 1.0f) : time - std::floor(time);
+    }
+
+    // Loops are counted from the wrap of the normalized time
+    m_frontendNormalizedTime = time;
+    updateNormalizedTime(time);
+    if (finished)
+        setFrontendRunning(false);
+}
+
 void AnimationPlayer::setCurrentLoop(int loop)
 {
     if (loop == m_currentLoop)
@@ -33,15 +33,27 @@
 #include <Kuesa/kuesa_global.h>
 #include <Kuesa/KuesaNode>
 #include <Qt3DAnimation/qclock.h>
+#include <QPointer>
+#include <memory>
+#include <vector>
 
 QT_BEGIN_NAMESPACE
 
 namespace Qt3DAnimation {
 class QClipAnimator;
+class QChannelMapper;
+class QAnimationCallback;
 } // namespace Qt3DAnimation
 
+namespace Qt3DLogic {
+class QFrameAction;
+} // namespace Qt3DLogic
+
 namespace Kuesa {
 
+class AnimationInstancer;
+class AnimationResultBuffer;
+
 class KUESASHARED_EXPORT AnimationPlayer : public KuesaNode
 {
     Q_OBJECT
@@ -54,6 +66,9 @@ class KUESASHARED_EXPORT AnimationPlayer : public KuesaNode
     Q_PROPERTY(Qt3DAnimation::QClock *clock READ clock WRITE setClock NOTIFY clockChanged)
     Q_PROPERTY(float normalizedTime READ normalizedTime WRITE setNormalizedTime NOTIFY normalizedTimeChanged)
     Q_PROPERTY(float duration READ duration NOTIFY durationChanged)
+    Q_PROPERTY(bool batched READ isBatched WRITE setBatched NOTIFY batchedChanged)
+    Q_PROPERTY(bool instanced READ isInstanced WRITE setInstanced NOTIFY instancedChanged)
+    Q_PROPERTY(float phaseOffset READ phaseOffset WRITE setPhaseOffset NOTIFY phaseOffsetChanged)
 public:
     enum Loops { Infinite = -1 };
     Q_ENUM(Loops) // LCOV_EXCL_LINE
@@ -77,6 +92,9 @@ public:
     Qt3DAnimation::QClock *clock() const;
     float normalizedTime() const;
     float duration() const;
+    bool isBatched() const;
+    bool isInstanced() const;
+    float phaseOffset() const;
 
     QVector<Qt3DCore::QNode *> targets() const;
     void addTarget(Qt3DCore::QNode *target);
@@ -89,6 +107,9 @@ public Q_SLOTS:
     void setLoopCount(int loops);
     void setClock(Qt3DAnimation::QClock *clock);
     void setNormalizedTime(float timeFraction);
+    void setBatched(bool batched);
+    void setInstanced(bool instanced);
+    void setPhaseOffset(float phaseOffset);
 
     void start(int delay = 0);
     void stop();
@@ -106,6 +127,9 @@ Q_SIGNALS:
     void normalizedTimeChanged(float index);
     void durationChanged(float duration);
     void currentLoopChanged(int currentLoop);
+    void batchedChanged(bool batched);
+    void instancedChanged(bool instanced);
+    void phaseOffsetChanged(float phaseOffset);
 
 private:
     void matchClipAndTargets();
@@ -113,19 +137,47 @@ private:
     void updateSceneFromParent(Qt3DCore::QNode *parent);
     void updateNormalizedTime(float index);
     void setCurrentLoop(int loop);
+    void setGeneratedMapper(Qt3DAnimation::QChannelMapper *mapper);
+    Qt3DAnimation::QClipAnimator *animator() const;
+    void leaveInstanceGroup();
+    void setInstanceShared(bool shared);
+    void setInstanceRunning(bool running);
+    void releaseResultCallbacks();
+    void setAnimatorRunning(bool running);
+    void setAnimatorNormalizedTime(float timeFraction);
+    void setFrontendPlayback(bool enabled);
+    void setFrontendRunning(bool running);
+    void advanceFrontendPlayback(float dt);
 
     Status m_status;
     QString m_clip;
     QString m_mapper;
     QVector<Qt3DCore::QNode *> m_targets;
     Qt3DAnimation::QClipAnimator *m_animator;
+    Qt3DAnimation::QChannelMapper *m_generatedMapper = nullptr;
     bool m_running;
+    bool m_batched = false;
+    bool m_instanced = false;
+    QPointer<AnimationInstancer> m_instancer;
+    QPointer<AnimationResultBuffer> m_resultBuffer;
+    std::vector<std::shared_ptr<Qt3DAnimation::QAnimationCallback>> m_resultCallbacks;
+    QPointer<Qt3DAnimation::QClipAnimator> m_instanceAnimator;
+    float m_phaseOffset = 0.0f;
+    // Instanced player not started nor seeked since it joined or was reset
+    bool m_instanceAtRest = false;
     float m_runToTimeFraction = -1;
     QMetaObject::Connection m_loadingDoneConnection;
     QMetaObject::Connection m_clipDestroyedConnection;
     QMetaObject::Connection m_mapperDestroyedConnection;
     int m_currentLoop = 0;
     float m_lastKnownNormalizedTime = 0.0f;
+    bool m_muteTargets = false;
+    // Playback advanced on the frontend while the targets are muted
+    Qt3DLogic::QFrameAction *m_frameAction = nullptr;
+    bool m_frontendRunning = false;
+    float m_frontendNormalizedTime = 0.0f;
+
+    friend class AnimationPulse;
 };
 
 } // namespace Kuesa
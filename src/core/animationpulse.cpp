@@ -27,7 +27,14 @@
 */
 
 #include "animationpulse.h"
+#include "sceneentity.h"
+#include "pulsetrack_p.h"
 #include <Qt3DCore/QTransform>
+#include <Qt3DAnimation/QAnimationClip>
+#include <Qt3DAnimation/QChannelMapper>
+#include <Qt3DAnimation/QChannelMapping>
+#include <Qt3DAnimation/QClock>
+#include <algorithm>
 
 /*!
  * \class Kuesa::AnimationPulse
@@ -49,6 +56,11 @@
  * \note To support AnimationPulse without any glTF extension, the animation should
  * animate the translation property of a glTF.Node. In particular, the pulse fcurve
  * should animate the "y" property of the translation.
+ *
+ * The times at which the pulse changes are computed once from the key frames of
+ * the animation when the clip is loaded. Signals are then emitted as the clock
+ * of the player goes past these times, every change in between two frames
+ * being reported, and nothing is evaluated or written between changes.
  */
 
 /*!
@@ -71,6 +83,11 @@
     \note To support AnimationPulse without any glTF extension, the animation should
     animate the translation property of a glTF.Node. In particular, the pulse fcurve
     should animate the "y" property of the translation.
+
+    The times at which the pulse changes are computed once from the key frames of
+    the animation when the clip is loaded. Signals are then emitted as the clock
+    of the player goes past these times, every change in between two frames
+    being reported, and nothing is evaluated or written between changes.
 */
 
 QT_BEGIN_NAMESPACE
@@ -97,16 +114,128 @@ Kuesa::AnimationPulse::AnimationPulse(Qt3DCore::QNode *parent)
     , m_proxyTransform(new Qt3DCore::QTransform(this))
 {
     addTarget(m_proxyTransform);
+    // Only used when no pulse track could be extracted from the clip, the
+    // proxy transform isn't animated otherwise
     QObject::connect(m_proxyTransform, &Qt3DCore::QTransform::translationChanged,
-                     [this]() {
-                         if (m_pulse == qRound(m_proxyTransform->translation().y()))
-                             return;
-                         m_pulse = qRound(m_proxyTransform->translation().y());
-                         emit pulseChanged(m_pulse);
+                     this, [this]() {
+                         if (!m_track)
+                             setPulse(qRound(m_proxyTransform->translation().y()));
                      });
 
     QObject::connect(this, &AnimationPulse::pulseChanged,
                      this, &AnimationPulse::onPulseChanged);
+
+    QObject::connect(this, &AnimationPlayer::statusChanged, this, &AnimationPulse::updateTrack);
+    QObject::connect(this, &AnimationPlayer::clipChanged, this, &AnimationPulse::updateTrack);
+    QObject::connect(this, &AnimationPlayer::mapperChanged, this, &AnimationPulse::updateTrack);
+    QObject::connect(this, &AnimationPlayer::durationChanged, this, &AnimationPulse::updateTrack);
+    QObject::connect(this, &AnimationPlayer::normalizedTimeChanged, this, &AnimationPulse::dispatchEvents);
+}
+
+void Kuesa::AnimationPulse::setPulse(int pulse)
+{
+    if (m_pulse == pulse)
+        return;
+    m_pulse = pulse;
+    emit pulseChanged(m_pulse);
+}
+
+void Kuesa::AnimationPulse::updateTrack()
+{
+    std::shared_ptr<const PulseTrack> track;
+
+    Qt3DAnimation::QAnimationClip *animationClip = nullptr;
+    Qt3DAnimation::QChannelMapper *channelMapper = nullptr;
+    if (m_sceneEntity) {
+        animationClip = qobject_cast<Qt3DAnimation::QAnimationClip *>(m_sceneEntity->animationClip(clip()));
+        channelMapper = m_sceneEntity->animationMapping(mapper().isEmpty() ? clip() : mapper());
+    }
+
+    if (animationClip && channelMapper) {
+        // The pulse is the y component of an animated translation
+        const QVector<Qt3DAnimation::QAbstractChannelMapping *> mappings = channelMapper->mappings();
+        for (Qt3DAnimation::QAbstractChannelMapping *abstractMapping : mappings) {
+            auto mapping = qobject_cast<Qt3DAnimation::QChannelMapping *>(abstractMapping);
+            if (!mapping || mapping->property() != QLatin1String("translation"))
+                continue;
+
+            const Qt3DAnimation::QAnimationClipData clipData = animationClip->clipData();
+            const auto channelIt = std::find_if(clipData.begin(), clipData.end(), [mapping](const Qt3DAnimation::QChannel &channel) {
+                return channel.name() == mapping->channelName();
+            });
+            if (channelIt != clipData.end() && channelIt->channelComponentCount() > 1) {
+                PulseTrack pulseTrack = PulseTrack::fromChannelComponent(*(channelIt->begin() + 1));
+                if (!pulseTrack.isEmpty())
+                    track = std::make_shared<const PulseTrack>(std::move(pulseTrack));
+            }
+            break;
+        }
+    }
+
+    m_track = track;
+    if (m_track) {
+        m_trackTime = normalizedTime() * duration();
+        setPulse(m_track->pulseAt(m_trackTime));
+    }
+
+    // With a track the clip is no longer evaluated, the player advances its
+    // time from a frame action and events are dispatched from the track
+    const bool muteTargets = m_track != nullptr;
+    if (m_muteTargets != muteTargets) {
+        m_muteTargets = muteTargets;
+        matchClipAndTargets();
+    }
+}
+
+void Kuesa::AnimationPulse::dispatchEvents(float normalizedTime)
+{
+    if (!m_track)
+        return;
+
+    const float previousTime = m_trackTime;
+    const float time = normalizedTime * duration();
+    m_trackTime = time;
+
+    // Seeking only updates the pulse
+    if (!isRunning()) {
+        setPulse(m_track->pulseAt(time));
+        return;
+    }
+
+    const bool forward = clock() ? clock()->playbackRate() > 0.0f : true;
+    const bool looped = forward ? time < previousTime : time > previousTime;
+    if (!looped) {
+        runEvents(previousTime, time);
+        return;
+    }
+
+    // Finish the previous loop before starting the new one
+    const float loopEnd = forward ? duration() : 0.0f;
+    const float loopStart = forward ? 0.0f : duration();
+    const std::shared_ptr<const PulseTrack> track = m_track;
+    runEvents(previousTime, loopEnd);
+    if (m_track != track)
+        return;
+    setPulse(m_track->pulseAt(loopStart));
+    if (m_track != track)
+        return;
+    runEvents(loopStart, time);
+}
+
+void Kuesa::AnimationPulse::runEvents(float fromTime, float toTime)
+{
+    // Every event crossed since the last update is reported, in the order of
+    // playback. Handlers may change the clip, keep the track alive and stop
+    // if they did.
+    const std::shared_ptr<const PulseTrack> track = m_track;
+    const std::vector<PulseTrack::Event> &events = track->events();
+    if (fromTime <= toTime) {
+        for (int i = track->nextEvent(fromTime), last = track->nextEvent(toTime); i < last && m_track == track; ++i)
+            setPulse(events[i].pulse);
+    } else {
+        for (int i = track->nextEvent(fromTime) - 1, first = track->nextEvent(toTime); i >= first && m_track == track; --i)
+            setPulse(i > 0 ? events[i - 1].pulse : track->initialPulse());
+    }
 }
 
 float Kuesa::AnimationPulse::pulse() const
@@ -31,6 +31,7 @@
 
 #include <Kuesa/AnimationPlayer>
 #include <Kuesa/kuesa_global.h>
+#include <memory>
 
 QT_BEGIN_NAMESPACE
 
@@ -39,6 +40,8 @@ class QTransform;
 }
 
 namespace Kuesa {
+class PulseTrack;
+
 class KUESASHARED_EXPORT AnimationPulse : public Kuesa::AnimationPlayer
 {
     Q_OBJECT
@@ -56,11 +59,17 @@ Q_SIGNALS:
 
 private:
     void onPulseChanged();
+    void setPulse(int pulse);
+    void updateTrack();
+    void dispatchEvents(float normalizedTime);
+    void runEvents(float fromTime, float toTime);
 
     int m_pulse;
     int m_previousValue;
 
     Qt3DCore::QTransform *m_proxyTransform;
+    std::shared_ptr<const PulseTrack> m_track;
+    float m_trackTime = 0.0f;
 };
 } // namespace Kuesa
 
@@ -0,0 +1,400 @@
+/*
+    animationresultbuffer.cpp
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "animationresultbuffer_p.h"
+#include <QColor>
+#include <QMutexLocker>
+#include <QQuaternion>
+#include <QVector2D>
+#include <QVector3D>
+#include <QVector4D>
+#include <algorithm>
+#include <functional>
+
+QT_BEGIN_NAMESPACE
+
+namespace Kuesa {
+
+namespace {
+
+// Same as QMetaProperty::write without wrapping the value in a QVariant
+template<typename T>
+bool writeProperty(QObject *target, int propertyIndex, T value)
+{
+    int status = -1;
+    int flags = 0;
+    void *argv[] = { &value, nullptr, &status, &flags };
+    QMetaObject::metacall(target, QMetaObject::WriteProperty, propertyIndex, argv);
+    return status != 0;
+}
+
+bool writeFloat(QObject *target, int propertyIndex, const float *values, int count)
+{
+    return count >= 1 && writeProperty(target, propertyIndex, values[0]);
+}
+
+bool writeDouble(QObject *target, int propertyIndex, const float *values, int count)
+{
+    return count >= 1 && writeProperty(target, propertyIndex, double(values[0]));
+}
+
+bool writeVector2D(QObject *target, int propertyIndex, const float *values, int count)
+{
+    return count >= 2 && writeProperty(target, propertyIndex, QVector2D(values[0], values[1]));
+}
+
+bool writeVector3D(QObject *target, int propertyIndex, const float *values, int count)
+{
+    return count >= 3 && writeProperty(target, propertyIndex, QVector3D(values[0], values[1], values[2]));
+}
+
+bool writeVector4D(QObject *target, int propertyIndex, const float *values, int count)
+{
+    return count >= 4 && writeProperty(target, propertyIndex, QVector4D(values[0], values[1], values[2], values[3]));
+}
+
+bool writeQuaternion(QObject *target, int propertyIndex, const float *values, int count)
+{
+    return count >= 4 && writeProperty(target, propertyIndex, QQuaternion(values[0], values[1], values[2], values[3]));
+}
+
+bool writeColor(QObject *target, int propertyIndex, const float *values, int count)
+{
+    return count >= 4 && writeProperty(target, propertyIndex, QColor::fromRgbF(values[0], values[1], values[2], values[3]));
+}
+
+AnimationResultBuffer::Writer defaultWriter(int type)
+{
+    switch (type) {
+    case QMetaType::Float:
+        return writeFloat;
+    case QMetaType::Double:
+        return writeDouble;
+    case QMetaType::QVector2D:
+        return writeVector2D;
+    case QMetaType::QVector3D:
+        return writeVector3D;
+    case QMetaType::QVector4D:
+        return writeVector4D;
+    case QMetaType::QQuaternion:
+        return writeQuaternion;
+    case QMetaType::QColor:
+        return writeColor;
+    default:
+        return nullptr;
+    }
+}
+
+// Extracts the float components of value, false if it has none
+template<typename Values>
+bool toFloats(const QVariant &value, Values &values)
+{
+    switch (value.userType()) {
+    case QMetaType::Float:
+    case QMetaType::Double:
+        values = { value.toFloat() };
+        return true;
+    case QMetaType::QVector2D: {
+        const auto v = value.value<QVector2D>();
+        values = { v.x(), v.y() };
+        return true;
+    }
+    case QMetaType::QVector3D: {
+        const auto v = value.value<QVector3D>();
+        values = { v.x(), v.y(), v.z() };
+        return true;
+    }
+    case QMetaType::QVector4D: {
+        const auto v = value.value<QVector4D>();
+        values = { v.x(), v.y(), v.z(), v.w() };
+        return true;
+    }
+    case QMetaType::QQuaternion: {
+        const auto q = value.value<QQuaternion>();
+        values = { q.scalar(), q.x(), q.y(), q.z() };
+        return true;
+    }
+    case QMetaType::QColor: {
+        const auto c = value.value<QColor>();
+        values = { float(c.redF()), float(c.greenF()), float(c.blueF()), float(c.alphaF()) };
+        return true;
+    }
+    default:
+        break;
+    }
+
+    // Morph weights and other lists of floats
+    if (value.userType() == qMetaTypeId<QVector<float>>()) {
+        const auto &v = *static_cast<const QVector<float> *>(value.constData());
+        values.resize(v.size());
+        std::copy(v.cbegin(), v.cend(), values.begin());
+        return true;
+    }
+    return false;
+}
+
+} // namespace
+
+class AnimationResultBuffer::SlotCallback : public Qt3DAnimation::QAnimationCallback
+{
+public:
+    SlotCallback(const std::shared_ptr<Link> &link, int slot)
+        : m_link(link)
+        , m_slot(slot)
+    {
+    }
+
+    void valueChanged(const QVariant &value) override
+    {
+        QMutexLocker lock(&m_link->mutex);
+        if (m_link->buffer && m_slot >= 0)
+            m_link->buffer->writeLocked(m_slot, value);
+    }
+
+    const std::shared_ptr<Link> m_link;
+    // Guarded by the link mutex, -1 once released
+    int m_slot;
+};
+
+constexpr int AnimationResultBuffer::ReleaseGracePasses;
+
+AnimationResultBuffer::AnimationResultBuffer(QObject *parent)
+    : QObject(parent)
+    , m_link(std::make_shared<Link>())
+{
+    m_link->buffer = this;
+}
+
+AnimationResultBuffer::~AnimationResultBuffer()
+{
+    // Callbacks still referenced by mappings outlive the buffer and turn into
+    // no-ops from now on
+    QMutexLocker lock(&m_link->mutex);
+    m_link->buffer = nullptr;
+    for (const auto &callback : m_callbacks) {
+        if (callback)
+            callback->m_slot = -1;
+    }
+}
+
+AnimationResultBuffer::Callback AnimationResultBuffer::callbackForProperty(QObject *target, const QByteArray &propertyName, Writer writer)
+{
+    if (target == nullptr)
+        return nullptr;
+
+    const int propertyIndex = target->metaObject()->indexOfProperty(propertyName.constData());
+    if (propertyIndex < 0)
+        return nullptr;
+    const QMetaProperty property = target->metaObject()->property(propertyIndex);
+    if (!property.isWritable())
+        return nullptr;
+
+    QMutexLocker lock(&m_link->mutex);
+    const auto it = std::find_if(m_slots.cbegin(), m_slots.cend(),
+                                 [&](const Slot &slot) {
+                                     return slot.refCount > 0 &&
+                                             slot.target == target &&
+                                             slot.property.propertyIndex() == propertyIndex;
+                                 });
+    if (it != m_slots.cend()) {
+        const size_t slotIndex = size_t(std::distance(m_slots.cbegin(), it));
+        ++m_slots[slotIndex].refCount;
+        return m_callbacks[slotIndex];
+    }
+
+    Slot slot;
+    slot.target = target;
+    slot.property = property;
+    slot.writer = writer ? writer : defaultWriter(property.userType());
+    slot.refCount = 1;
+
+    if (!m_freeSlots.empty()) {
+        const int slotIndex = m_freeSlots.back();
+        m_freeSlots.pop_back();
+        m_slots[size_t(slotIndex)] = slot;
+        m_callbacks[size_t(slotIndex)] = std::make_shared<SlotCallback>(m_link, slotIndex);
+        return m_callbacks[size_t(slotIndex)];
+    }
+
+    const int slotIndex = int(m_slots.size());
+    m_slots.push_back(slot);
+    m_callbacks.push_back(std::make_shared<SlotCallback>(m_link, slotIndex));
+    return m_callbacks.back();
+}
+
+/*!
+    \internal
+
+    Releases \a callback, freeing its slot once no mapping uses it anymore.
+    The callback itself is kept for ReleaseGracePasses apply passes.
+ */
+void AnimationResultBuffer::releaseCallback(Qt3DAnimation::QAnimationCallback *callback)
+{
+    QMutexLocker lock(&m_link->mutex);
+    const auto it = std::find_if(m_callbacks.begin(), m_callbacks.end(),
+                                 [callback](const std::shared_ptr<SlotCallback> &c) {
+                                     return c.get() == callback;
+                                 });
+    if (it == m_callbacks.end())
+        return;
+
+    const int slotIndex = int(std::distance(m_callbacks.begin(), it));
+    Slot &slot = m_slots[size_t(slotIndex)];
+    if (--slot.refCount > 0)
+        return;
+
+    if (slot.pending)
+        m_pendingSlots.erase(std::remove(m_pendingSlots.begin(), m_pendingSlots.end(), slotIndex),
+                             m_pendingSlots.end());
+    slot = Slot();
+    (*it)->m_slot = -1;
+    m_releasedCallbacks.push_back({ std::move(*it), m_applyPass });
+    m_freeSlots.push_back(slotIndex);
+}
+
+int AnimationResultBuffer::propertyType(QObject *target, const QByteArray &propertyName) const
+{
+    if (target == nullptr)
+        return QMetaType::UnknownType;
+    const int propertyIndex = target->metaObject()->indexOfProperty(propertyName.constData());
+    if (propertyIndex < 0)
+        return QMetaType::UnknownType;
+    return target->metaObject()->property(propertyIndex).userType();
+}
+
+int AnimationResultBuffer::slotCount() const
+{
+    QMutexLocker lock(&m_link->mutex);
+    return int(m_slots.size() - m_freeSlots.size());
+}
+
+int AnimationResultBuffer::releasedCallbackCount() const
+{
+    QMutexLocker lock(&m_link->mutex);
+    return int(m_releasedCallbacks.size());
+}
+
+void AnimationResultBuffer::write(int slotIndex, const QVariant &value)
+{
+    QMutexLocker lock(&m_link->mutex);
+    writeLocked(slotIndex, value);
+}
+
+void AnimationResultBuffer::writeLocked(int slotIndex, const QVariant &value)
+{
+    if (slotIndex < 0 || slotIndex >= int(m_slots.size()) || m_slots[size_t(slotIndex)].refCount == 0)
+        return;
+
+    Slot &slot = m_slots[size_t(slotIndex)];
+    if (slot.writer && toFloats(value, slot.values))
+        slot.value = QVariant();
+    else
+        slot.value = value;
+    if (!slot.pending) {
+        slot.pending = true;
+        m_pendingSlots.push_back(slotIndex);
+    }
+
+    if (!m_applyScheduled) {
+        m_applyScheduled = true;
+        QMetaObject::invokeMethod(this, "apply", Qt::QueuedConnection);
+    }
+}
+
+void AnimationResultBuffer::apply()
+{
+    {
+        QMutexLocker lock(&m_link->mutex);
+        m_applyScheduled = false;
+        ++m_applyPass;
+
+        // Qt 3D no longer calls callbacks released a few passes ago
+        m_releasedCallbacks.erase(std::remove_if(m_releasedCallbacks.begin(), m_releasedCallbacks.end(),
+                                                 [this](const ReleasedCallback &released) {
+                                                     return m_applyPass - released.releasePass > ReleaseGracePasses;
+                                                 }),
+                                  m_releasedCallbacks.end());
+
+        m_writes.resize(m_pendingSlots.size());
+        for (size_t i = 0, m = m_pendingSlots.size(); i < m; ++i) {
+            const int slotIndex = m_pendingSlots[i];
+            Slot &slot = m_slots[size_t(slotIndex)];
+            slot.pending = false;
+            PendingWrite &pendingWrite = m_writes[i];
+            pendingWrite.target = slot.target;
+            pendingWrite.slot = slotIndex;
+            pendingWrite.propertyIndex = slot.property.propertyIndex();
+            pendingWrite.writer = slot.writer;
+            pendingWrite.values = slot.values;
+            pendingWrite.value = std::move(slot.value);
+            slot.value = QVariant();
+        }
+        m_pendingSlots.clear();
+    }
+
+    // Group the writes target by target, in slot order for each target
+    std::sort(m_writes.begin(), m_writes.end(),
+              [](const PendingWrite &a, const PendingWrite &b) {
+                  if (a.target.data() != b.target.data())
+                      return std::less<QObject *>()(a.target.data(), b.target.data());
+                  return a.slot < b.slot;
+              });
+
+    // Writes happen outside of the lock as setters may trigger other writes
+    int appliedCount = 0;
+    QObject *target = nullptr;
+    for (size_t i = 0, m = m_writes.size(); i < m; ++i) {
+        PendingWrite &pendingWrite = m_writes[i];
+        if (i == 0 || pendingWrite.target.data() != m_writes[i - 1].target.data())
+            target = pendingWrite.target.data();
+        if (target == nullptr) {
+            pendingWrite.value = QVariant();
+            continue;
+        }
+
+        if (pendingWrite.value.isValid()) {
+            const QMetaProperty property = target->metaObject()->property(pendingWrite.propertyIndex);
+            if (property.write(target, pendingWrite.value))
+                ++appliedCount;
+            pendingWrite.value = QVariant();
+        } else if (pendingWrite.writer(target, pendingWrite.propertyIndex,
+                                       pendingWrite.values.constData(), pendingWrite.values.size())) {
+            ++appliedCount;
+        }
+    }
+    // m_writes keeps its elements, and their storage, for the next pass
+
+    if (appliedCount != m_appliedPropertyCount) {
+        m_appliedPropertyCount = appliedCount;
+        emit appliedPropertyCountChanged(m_appliedPropertyCount);
+    }
+}
+
+} // namespace Kuesa
+
+QT_END_NAMESPACE
@@ -0,0 +1,158 @@
+/*
+    animationresultbuffer_p.h
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef KUESA_ANIMATIONRESULTBUFFER_P_H
+#define KUESA_ANIMATIONRESULTBUFFER_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Kuesa API.  It exists for the convenience
+// of other Kuesa classes.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <Kuesa/private/kuesa_global_p.h>
+#include <Qt3DAnimation/qanimationcallback.h>
+#include <QObject>
+#include <QMetaProperty>
+#include <QMutex>
+#include <QPointer>
+#include <QVarLengthArray>
+#include <QVariant>
+#include <memory>
+#include <vector>
+
+QT_BEGIN_NAMESPACE
+
+namespace Kuesa {
+
+// Collects the values computed by the animation jobs for all the
+// AnimationPlayers of a SceneEntity and writes them to their target
+// properties in a single pass on the owning thread. Several writes to the
+// same property before the pass are coalesced into one.
+//
+// Float, vector, quaternion and color values are stored as floats and written
+// through typed setters, target by target. Other types go through QVariant.
+class KUESA_PRIVATE_EXPORT AnimationResultBuffer : public QObject
+{
+    Q_OBJECT
+public:
+    using Callback = std::shared_ptr<Qt3DAnimation::QAnimationCallback>;
+    // Writes the count float components of a value to the property at the
+    // absolute propertyIndex of target, returns false if it couldn't
+    using Writer = bool (*)(QObject *target, int propertyIndex, const float *values, int count);
+
+    explicit AnimationResultBuffer(QObject *parent = nullptr);
+    ~AnimationResultBuffer();
+
+    // Returns the callback writing into the slot of property propertyName of
+    // target, shared by all the mappings animating that property. writer
+    // replaces the default typed setter of the property. Returns nullptr if
+    // target has no such writable property. Each returned callback must be
+    // released once the mapping using it is gone, callers keep a reference to
+    // it for as long as it is set on a mapping.
+    Callback callbackForProperty(QObject *target, const QByteArray &propertyName, Writer writer = nullptr);
+    void releaseCallback(Qt3DAnimation::QAnimationCallback *callback);
+    int propertyType(QObject *target, const QByteArray &propertyName) const;
+
+    int slotCount() const;
+    int releasedCallbackCount() const;
+    int appliedPropertyCount() const { return m_appliedPropertyCount; }
+
+    // Thread safe
+    void write(int slot, const QVariant &value);
+
+    // Number of apply passes a released callback is kept for, Qt 3D may still
+    // call it until its animation jobs see the mapping removal
+    static constexpr int ReleaseGracePasses = 3;
+
+public Q_SLOTS:
+    void apply();
+
+Q_SIGNALS:
+    void appliedPropertyCountChanged(int count);
+
+private:
+    class SlotCallback;
+
+    // Shared with the callbacks, which may outlive the buffer
+    struct Link {
+        QMutex mutex;
+        AnimationResultBuffer *buffer = nullptr;
+    };
+
+    using Values = QVarLengthArray<float, 4>;
+
+    struct Slot {
+        QPointer<QObject> target;
+        QMetaProperty property;
+        Writer writer = nullptr;
+        Values values;
+        // Only for values without a writer
+        QVariant value;
+        int refCount = 0;
+        bool pending = false;
+    };
+
+    struct PendingWrite {
+        QPointer<QObject> target;
+        int slot;
+        int propertyIndex;
+        Writer writer;
+        Values values;
+        QVariant value;
+    };
+
+    struct ReleasedCallback {
+        std::shared_ptr<SlotCallback> callback;
+        int releasePass;
+    };
+
+    void writeLocked(int slot, const QVariant &value);
+
+    std::shared_ptr<Link> m_link;
+    std::vector<Slot> m_slots;
+    std::vector<std::shared_ptr<SlotCallback>> m_callbacks;
+    std::vector<ReleasedCallback> m_releasedCallbacks;
+    std::vector<int> m_freeSlots;
+    std::vector<int> m_pendingSlots;
+    std::vector<PendingWrite> m_writes;
+    int m_applyPass = 0;
+    bool m_applyScheduled = false;
+    int m_appliedPropertyCount = 0;
+};
+
+} // namespace Kuesa
+
+QT_END_NAMESPACE
+
+#endif // KUESA_ANIMATIONRESULTBUFFER_P_H
@@ -0,0 +1,536 @@
+/*
+    boundingvolumehierarchy.cpp
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "boundingvolumehierarchy_p.h"
+#include <algorithm>
+#include <cmath>
+
+QT_BEGIN_NAMESPACE
+
+namespace Kuesa {
+
+/*!
+    \internal
+
+    Returns true if the box has been expanded to contain at least one point.
+ */
+bool AxisAlignedBox::isValid() const
+{
+    return min.x() <= max.x() && min.y() <= max.y() && min.z() <= max.z();
+}
+
+float AxisAlignedBox::surfaceArea() const
+{
+    const QVector3D d = max - min;
+    return 2.0f * (d.x() * d.y() + d.y() * d.z() + d.z() * d.x());
+}
+
+bool AxisAlignedBox::contains(const AxisAlignedBox &other) const
+{
+    return min.x() <= other.min.x() && min.y() <= other.min.y() && min.z() <= other.min.z() &&
+            max.x() >= other.max.x() && max.y() >= other.max.y() && max.z() >= other.max.z();
+}
+
+void AxisAlignedBox::expandToContain(const AxisAlignedBox &other)
+{
+    min = QVector3D(std::min(min.x(), other.min.x()),
+                    std::min(min.y(), other.min.y()),
+                    std::min(min.z(), other.min.z()));
+    max = QVector3D(std::max(max.x(), other.max.x()),
+                    std::max(max.y(), other.max.y()),
+                    std::max(max.z(), other.max.z()));
+}
+
+void AxisAlignedBox::expandToContain(const QVector3D &point)
+{
+    expandToContain(AxisAlignedBox(point, point));
+}
+
+AxisAlignedBox AxisAlignedBox::united(const AxisAlignedBox &other) const
+{
+    AxisAlignedBox b = *this;
+    b.expandToContain(other);
+    return b;
+}
+
+AxisAlignedBox AxisAlignedBox::grown(float margin) const
+{
+    const QVector3D m(margin, margin, margin);
+    return AxisAlignedBox(min - m, max + m);
+}
+
+/*!
+    \internal
+
+    Returns the axis aligned box enclosing this box once transformed by \a m.
+    This uses the center/extents formulation (Arvo) which avoids transforming
+    the 8 corners of the box.
+ */
+AxisAlignedBox AxisAlignedBox::transformed(const QMatrix4x4 &m) const
+{
+    if (!isValid())
+        return *this;
+
+    const QVector3D c = m.map(center());
+    const QVector3D e = extents();
+    QVector3D newExtents;
+    for (int i = 0; i < 3; ++i)
+        newExtents[i] = std::abs(m(i, 0)) * e.x() + std::abs(m(i, 1)) * e.y() + std::abs(m(i, 2)) * e.z();
+    return AxisAlignedBox(c - newExtents, c + newExtents);
+}
+
+/*!
+    \internal
+
+    Extracts the 6 frustum planes from \a viewProjection (Gribb & Hartmann).
+ */
+Frustum Frustum::fromViewProjection(const QMatrix4x4 &viewProjection)
+{
+    const QVector4D r0 = viewProjection.row(0);
+    const QVector4D r1 = viewProjection.row(1);
+    const QVector4D r2 = viewProjection.row(2);
+    const QVector4D r3 = viewProjection.row(3);
+
+    Frustum f;
+    f.planes = {
+        r3 + r0, // Left
+        r3 - r0, // Right
+        r3 + r1, // Bottom
+        r3 - r1, // Top
+        r3 + r2, // Near
+        r3 - r2, // Far
+    };
+
+    for (QVector4D &p : f.planes) {
+        const float l = p.toVector3D().length();
+        if (l > 0.0f)
+            p /= l;
+    }
+    return f;
+}
+
+Frustum::Intersection Frustum::intersects(const AxisAlignedBox &box) const
+{
+    Intersection result = Inside;
+    for (const QVector4D &p : planes) {
+        // Vertex furthest along the plane normal
+        const QVector3D positive(p.x() >= 0.0f ? box.max.x() : box.min.x(),
+                                 p.y() >= 0.0f ? box.max.y() : box.min.y(),
+                                 p.z() >= 0.0f ? box.max.z() : box.min.z());
+        if (QVector3D::dotProduct(p.toVector3D(), positive) + p.w() < 0.0f)
+            return Outside;
+
+        // Vertex furthest against the plane normal
+        const QVector3D negative(p.x() >= 0.0f ? box.min.x() : box.max.x(),
+                                 p.y() >= 0.0f ? box.min.y() : box.max.y(),
+                                 p.z() >= 0.0f ? box.min.z() : box.max.z());
+        if (QVector3D::dotProduct(p.toVector3D(), negative) + p.w() < 0.0f)
+            result = Intersects;
+    }
+    return result;
+}
+
+/*!
+    \class Kuesa::BoundingVolumeHierarchy
+    \internal
+
+    \brief Dynamic bounding volume hierarchy of axis aligned boxes.
+
+    Each inserted proxy is stored with a fattened box so that small
+    displacements don't require any change to the tree. When a proxy moves
+    out of its fattened box, it is removed and reinserted using a surface area
+    heuristic and the tree is rebalanced with rotations on the way up.
+
+    Frustum queries reject whole subtrees which lie outside of the frustum and
+    accept whole subtrees which lie fully inside without further testing.
+ */
+
+constexpr int BoundingVolumeHierarchy::InvalidProxy;
+
+BoundingVolumeHierarchy::BoundingVolumeHierarchy()
+{
+}
+
+int BoundingVolumeHierarchy::insert(const AxisAlignedBox &box, quintptr userData)
+{
+    const int proxyId = allocateNode();
+    Node &n = m_nodes[proxyId];
+    n.box = box.grown(m_margin * (box.max - box.min).length());
+    n.userData = userData;
+    n.height = 0;
+    insertLeaf(proxyId);
+    ++m_proxyCount;
+    return proxyId;
+}
+
+void BoundingVolumeHierarchy::remove(int proxyId)
+{
+    Q_ASSERT(proxyId >= 0 && proxyId < int(m_nodes.size()));
+    Q_ASSERT(m_nodes[proxyId].isLeaf());
+    removeLeaf(proxyId);
+    freeNode(proxyId);
+    --m_proxyCount;
+}
+
+/*!
+    \internal
+
+    Updates the bounds of proxy \a proxyId to \a box. Returns true if the tree
+    had to be modified, false if the box still fits in the fattened bounds.
+ */
+bool BoundingVolumeHierarchy::update(int proxyId, const AxisAlignedBox &box)
+{
+    Q_ASSERT(proxyId >= 0 && proxyId < int(m_nodes.size()));
+    Q_ASSERT(m_nodes[proxyId].isLeaf());
+
+    if (m_nodes[proxyId].box.contains(box))
+        return false;
+
+    removeLeaf(proxyId);
+    m_nodes[proxyId].box = box.grown(m_margin * (box.max - box.min).length());
+    insertLeaf(proxyId);
+    return true;
+}
+
+void BoundingVolumeHierarchy::clear()
+{
+    m_nodes.clear();
+    m_root = InvalidProxy;
+    m_freeList = InvalidProxy;
+    m_proxyCount = 0;
+}
+
+quintptr BoundingVolumeHierarchy::userData(int proxyId) const
+{
+    Q_ASSERT(proxyId >= 0 && proxyId < int(m_nodes.size()));
+    return m_nodes[proxyId].userData;
+}
+
+const AxisAlignedBox &BoundingVolumeHierarchy::fatBounds(int proxyId) const
+{
+    Q_ASSERT(proxyId >= 0 && proxyId < int(m_nodes.size()));
+    return m_nodes[proxyId].box;
+}
+
+int BoundingVolumeHierarchy::height() const
+{
+    return m_root == InvalidProxy ? 0 : m_nodes[m_root].height;
+}
+
+/*!
+    \internal
+
+    Sets the \a margin by which inserted boxes are fattened, expressed as a
+    fraction of the box diagonal. This only applies to proxies inserted or
+    updated afterwards.
+ */
+void BoundingVolumeHierarchy::setMargin(float margin)
+{
+    m_margin = std::max(margin, 0.0f);
+}
+
+/*!
+    \internal
+
+    Appends to \a visibleUserData the user data of all proxies whose bounds
+    intersect \a frustum.
+ */
+void BoundingVolumeHierarchy::query(const Frustum &frustum, std::vector<quintptr> &visibleUserData) const
+{
+    if (m_root == InvalidProxy)
+        return;
+
+    std::vector<int> stack;
+    stack.reserve(64);
+    stack.push_back(m_root);
+
+    while (!stack.empty()) {
+        const int nodeId = stack.back();
+        stack.pop_back();
+
+        const Node &n = m_nodes[nodeId];
+        const Frustum::Intersection intersection = frustum.intersects(n.box);
+
+        if (intersection == Frustum::Outside)
+            continue;
+
+        if (intersection == Frustum::Inside || n.isLeaf()) {
+            collectLeaves(nodeId, visibleUserData);
+            continue;
+        }
+
+        stack.push_back(n.child1);
+        stack.push_back(n.child2);
+    }
+}
+
+int BoundingVolumeHierarchy::allocateNode()
+{
+    if (m_freeList == InvalidProxy) {
+        m_nodes.emplace_back();
+        return int(m_nodes.size()) - 1;
+    }
+    const int nodeId = m_freeList;
+    m_freeList = m_nodes[nodeId].parent;
+    m_nodes[nodeId] = Node();
+    return nodeId;
+}
+
+void BoundingVolumeHierarchy::freeNode(int nodeId)
+{
+    Node &n = m_nodes[nodeId];
+    n.parent = m_freeList;
+    n.child1 = InvalidProxy;
+    n.child2 = InvalidProxy;
+    n.height = -1;
+    m_freeList = nodeId;
+}
+
+void BoundingVolumeHierarchy::insertLeaf(int leaf)
+{
+    if (m_root == InvalidProxy) {
+        m_root = leaf;
+        m_nodes[leaf].parent = InvalidProxy;
+        return;
+    }
+
+    // Find the best sibling using the surface area heuristic
+    const AxisAlignedBox leafBox = m_nodes[leaf].box;
+    int index = m_root;
+    while (!m_nodes[index].isLeaf()) {
+        const Node &n = m_nodes[index];
+        const float area = n.box.surfaceArea();
+        const float combinedArea = n.box.united(leafBox).surfaceArea();
+
+        // Cost of creating a new parent for this node and the new leaf
+        const float cost = 2.0f * combinedArea;
+        // Minimum cost of pushing the leaf further down the tree
+        const float inheritanceCost = 2.0f * (combinedArea - area);
+
+        auto descendCost = [&](int childId) {
+            const Node &child = m_nodes[childId];
+            const float unitedArea = child.box.united(leafBox).surfaceArea();
+            if (child.isLeaf())
+                return unitedArea + inheritanceCost;
+            return (unitedArea - child.box.surfaceArea()) + inheritanceCost;
+        };
+
+        const float cost1 = descendCost(n.child1);
+        const float cost2 = descendCost(n.child2);
+
+        if (cost < cost1 && cost < cost2)
+            break;
+
+        index = cost1 < cost2 ? n.child1 : n.child2;
+    }
+
+    const int sibling = index;
+    const int oldParent = m_nodes[sibling].parent;
+    const int newParent = allocateNode(); // Invalidates references into m_nodes
+
+    Node &parentNode = m_nodes[newParent];
+    parentNode.parent = oldParent;
+    parentNode.box = leafBox.united(m_nodes[sibling].box);
+    parentNode.height = m_nodes[sibling].height + 1;
+    parentNode.child1 = sibling;
+    parentNode.child2 = leaf;
+
+    if (oldParent != InvalidProxy) {
+        Node &p = m_nodes[oldParent];
+        if (p.child1 == sibling)
+            p.child1 = newParent;
+        else
+            p.child2 = newParent;
+    } else {
+        m_root = newParent;
+    }
+    m_nodes[sibling].parent = newParent;
+    m_nodes[leaf].parent = newParent;
+
+    refitAncestors(newParent);
+}
+
+void BoundingVolumeHierarchy::removeLeaf(int leaf)
+{
+    if (leaf == m_root) {
+        m_root = InvalidProxy;
+        return;
+    }
+
+    const int parent = m_nodes[leaf].parent;
+    const int grandParent = m_nodes[parent].parent;
+    const int sibling = m_nodes[parent].child1 == leaf ? m_nodes[parent].child2 : m_nodes[parent].child1;
+
+    if (grandParent != InvalidProxy) {
+        Node &g = m_nodes[grandParent];
+        if (g.child1 == parent)
+            g.child1 = sibling;
+        else
+            g.child2 = sibling;
+        m_nodes[sibling].parent = grandParent;
+        freeNode(parent);
+        refitAncestors(grandParent);
+    } else {
+        m_root = sibling;
+        m_nodes[sibling].parent = InvalidProxy;
+        freeNode(parent);
+    }
+}
+
+void BoundingVolumeHierarchy::refitAncestors(int nodeId)
+{
+    int index = nodeId;
+    while (index != InvalidProxy) {
+        index = balance(index);
+
+        Node &n = m_nodes[index];
+        const Node &child1 = m_nodes[n.child1];
+        const Node &child2 = m_nodes[n.child2];
+        n.height = 1 + std::max(child1.height, child2.height);
+        n.box = child1.box.united(child2.box);
+
+        index = n.parent;
+    }
+}
+
+/*!
+    \internal
+
+    Performs a left or right rotation if node \a nodeId is imbalanced and
+    returns the index of the new subtree root.
+ */
+int BoundingVolumeHierarchy::balance(int nodeId)
+{
+    const int iA = nodeId;
+    Node &A = m_nodes[iA];
+    if (A.isLeaf() || A.height < 2)
+        return iA;
+
+    const int iB = A.child1;
+    const int iC = A.child2;
+    Node &B = m_nodes[iB];
+    Node &C = m_nodes[iC];
+    const int balanceFactor = C.height - B.height;
+
+    auto replaceChild = [this](int parent, int oldChild, int newChild) {
+        if (parent == InvalidProxy) {
+            m_root = newChild;
+            return;
+        }
+        Node &p = m_nodes[parent];
+        if (p.child1 == oldChild)
+            p.child1 = newChild;
+        else
+            p.child2 = newChild;
+    };
+
+    // Rotate C up
+    if (balanceFactor > 1) {
+        const int iF = C.child1;
+        const int iG = C.child2;
+        Node &F = m_nodes[iF];
+        Node &G = m_nodes[iG];
+
+        C.child1 = iA;
+        C.parent = A.parent;
+        A.parent = iC;
+        replaceChild(C.parent, iA, iC);
+
+        if (F.height > G.height) {
+            C.child2 = iF;
+            A.child2 = iG;
+            G.parent = iA;
+            A.box = B.box.united(G.box);
+            C.box = A.box.united(F.box);
+            A.height = 1 + std::max(B.height, G.height);
+            C.height = 1 + std::max(A.height, F.height);
+        } else {
+            C.child2 = iG;
+            A.child2 = iF;
+            F.parent = iA;
+            A.box = B.box.united(F.box);
+            C.box = A.box.united(G.box);
+            A.height = 1 + std::max(B.height, F.height);
+            C.height = 1 + std::max(A.height, G.height);
+        }
+        return iC;
+    }
+
+    // Rotate B up
+    if (balanceFactor < -1) {
+        const int iD = B.child1;
+        const int iE = B.child2;
+        Node &D = m_nodes[iD];
+        Node &E = m_nodes[iE];
+
+        B.child1 = iA;
+        B.parent = A.parent;
+        A.parent = iB;
+        replaceChild(B.parent, iA, iB);
+
+        if (D.height > E.height) {
+            B.child2 = iD;
+            A.child1 = iE;
+            E.parent = iA;
+            A.box = C.box.united(E.box);
+            B.box = A.box.united(D.box);
+            A.height = 1 + std::max(C.height, E.height);
+            B.height = 1 + std::max(A.height, D.height);
+        } else {
+            B.child2 = iE;
+            A.child1 = iD;
+            D.parent = iA;
+            A.box = C.box.united(D.box);
+            B.box = A.box.united(E.box);
+            A.height = 1 + std::max(C.height, D.height);
+            B.height = 1 + std::max(A.height, E.height);
+        }
+        return iB;
+    }
+
+    return iA;
+}
+
+void BoundingVolumeHierarchy::collectLeaves(int nodeId, std::vector<quintptr> &userData) const
+{
+    std::vector<int> stack = { nodeId };
+    while (!stack.empty()) {
+        const Node &n = m_nodes[stack.back()];
+        stack.pop_back();
+        if (n.isLeaf()) {
+            userData.push_back(n.userData);
+        } else {
+            stack.push_back(n.child1);
+            stack.push_back(n.child2);
+        }
+    }
+}
+
+} // namespace Kuesa
+
+QT_END_NAMESPACE
@@ -0,0 +1,156 @@
+/*
+    boundingvolumehierarchy_p.h
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef KUESA_BOUNDINGVOLUMEHIERARCHY_P_H
+#define KUESA_BOUNDINGVOLUMEHIERARCHY_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Kuesa API.  It exists for the convenience
+// of other Kuesa classes.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <Kuesa/private/kuesa_global_p.h>
+#include <QVector3D>
+#include <QVector4D>
+#include <QMatrix4x4>
+#include <array>
+#include <limits>
+#include <vector>
+
+QT_BEGIN_NAMESPACE
+
+namespace Kuesa {
+
+struct KUESA_PRIVATE_EXPORT AxisAlignedBox {
+    QVector3D min = QVector3D(std::numeric_limits<float>::max(),
+                              std::numeric_limits<float>::max(),
+                              std::numeric_limits<float>::max());
+    QVector3D max = QVector3D(std::numeric_limits<float>::lowest(),
+                              std::numeric_limits<float>::lowest(),
+                              std::numeric_limits<float>::lowest());
+
+    AxisAlignedBox() = default;
+    AxisAlignedBox(const QVector3D &minimum, const QVector3D &maximum)
+        : min(minimum)
+        , max(maximum)
+    {
+    }
+
+    bool isValid() const;
+    QVector3D center() const { return (min + max) * 0.5f; }
+    QVector3D extents() const { return (max - min) * 0.5f; }
+    float surfaceArea() const;
+
+    bool contains(const AxisAlignedBox &other) const;
+    void expandToContain(const AxisAlignedBox &other);
+    void expandToContain(const QVector3D &point);
+
+    AxisAlignedBox united(const AxisAlignedBox &other) const;
+    AxisAlignedBox grown(float margin) const;
+    AxisAlignedBox transformed(const QMatrix4x4 &m) const;
+
+    bool operator==(const AxisAlignedBox &other) const { return min == other.min && max == other.max; }
+    bool operator!=(const AxisAlignedBox &other) const { return !(*this == other); }
+};
+
+struct KUESA_PRIVATE_EXPORT Frustum {
+    enum Intersection {
+        Outside,
+        Intersects,
+        Inside
+    };
+
+    // Planes are stored as (normal, distance) with normals pointing inwards
+    std::array<QVector4D, 6> planes;
+
+    static Frustum fromViewProjection(const QMatrix4x4 &viewProjection);
+
+    Intersection intersects(const AxisAlignedBox &box) const;
+};
+
+class KUESA_PRIVATE_EXPORT BoundingVolumeHierarchy
+{
+public:
+    static constexpr int InvalidProxy = -1;
+
+    BoundingVolumeHierarchy();
+
+    int insert(const AxisAlignedBox &box, quintptr userData);
+    void remove(int proxyId);
+    bool update(int proxyId, const AxisAlignedBox &box);
+    void clear();
+
+    quintptr userData(int proxyId) const;
+    const AxisAlignedBox &fatBounds(int proxyId) const;
+
+    size_t proxyCount() const { return m_proxyCount; }
+    int height() const;
+
+    void setMargin(float margin);
+    float margin() const { return m_margin; }
+
+    void query(const Frustum &frustum, std::vector<quintptr> &visibleUserData) const;
+
+private:
+    struct Node {
+        AxisAlignedBox box;
+        quintptr userData = 0;
+        int parent = InvalidProxy; // Next free node when in the free list
+        int child1 = InvalidProxy;
+        int child2 = InvalidProxy;
+        int height = -1; // -1 for free nodes, 0 for leaves
+
+        bool isLeaf() const { return child1 == InvalidProxy; }
+    };
+
+    int allocateNode();
+    void freeNode(int nodeId);
+    void insertLeaf(int leaf);
+    void removeLeaf(int leaf);
+    int balance(int nodeId);
+    void refitAncestors(int nodeId);
+    void collectLeaves(int nodeId, std::vector<quintptr> &userData) const;
+
+    std::vector<Node> m_nodes;
+    int m_root = InvalidProxy;
+    int m_freeList = InvalidProxy;
+    size_t m_proxyCount = 0;
+    float m_margin = 0.1f;
+};
+
+} // namespace Kuesa
+
+QT_END_NAMESPACE
+
+#endif // KUESA_BOUNDINGVOLUMEHIERARCHY_P_H
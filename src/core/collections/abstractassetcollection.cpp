@@ -28,6 +28,8 @@
 
 #include "abstractassetcollection.h"
 #include "kuesa_p.h"
+#include "profiler_p.h"
+#include "assetmemory_p.h"
 
 QT_BEGIN_NAMESPACE
 using namespace Kuesa;
@@ -61,6 +63,9 @@ using namespace Kuesa;
  *
  * Removing an asset from the collection also results in the asset being
  * destroyed if the asset's parent is the collection itself.
+ *
+ * The memory held by the assets is accounted for as they are added and
+ * removed, see memoryReport().
  */
 
 /*!
@@ -69,13 +74,34 @@ using namespace Kuesa;
     Holds the list of names for the currently managed assets.
 */
 
+/*!
+    \property Kuesa::AbstractAssetCollection::cpuMemoryUsage
+
+    Holds an estimate of the CPU memory used by the assets of the collection,
+    in bytes. Resources shared by several assets are only counted once.
+
+    \since Kuesa 1.4
+*/
+
+/*!
+    \property Kuesa::AbstractAssetCollection::gpuMemoryUsage
+
+    Holds an estimate of the GPU memory used by the assets of the collection,
+    in bytes, once uploaded. Resources shared by several assets are only
+    counted once.
+
+    \since Kuesa 1.4
+*/
+
 /*!
  * \internal
  */
 AbstractAssetCollection::AbstractAssetCollection(Qt3DCore::QNode *parent)
     : Qt3DCore::QNode(parent)
+    , m_memoryTracker(new AssetMemoryTracker(this))
 {
     connect(this, &AbstractAssetCollection::namesChanged, this, &AbstractAssetCollection::sizeChanged);
+    connect(m_memoryTracker, &AssetMemoryTracker::changed, this, &AbstractAssetCollection::memoryUsageChanged);
 }
 
 /*!
@@ -120,14 +146,18 @@ bool AbstractAssetCollection::contains(Qt3DCore::QNode *asset) const
  */
 void AbstractAssetCollection::remove(const QString &name)
 {
+    Profiler::count("collections", "remove");
     auto asset = m_assets.take(name);
     if (asset) {
         //remove connection before deleting so handleAssetDestruction() is not called
         removeDestructionConnection(name, asset);
+        m_memoryTracker->untrack(name);
         if (asset->parent() == this)
             delete asset;
     }
     emit namesChanged();
+    if (asset)
+        emit assetRemoved(name);
 }
 
 /*!
@@ -135,13 +165,18 @@ void AbstractAssetCollection::remove(const QString &name)
  */
 void AbstractAssetCollection::clear()
 {
+    Profiler::count("collections", "clear");
     clearDestructionConnections();
+    m_memoryTracker->clear();
     for (auto a : qAsConst(m_assets)) {
         if (a->parent() == this)
             delete a;
     }
+    const QStringList removedNames = m_assets.keys();
     m_assets.clear();
     emit namesChanged();
+    for (const QString &name : removedNames)
+        emit assetRemoved(name);
 }
 
 /*!
@@ -150,6 +185,7 @@ void AbstractAssetCollection::clear()
 void AbstractAssetCollection::addAsset(const QString &name, Qt3DCore::QNode *asset)
 {
     Q_ASSERT(asset);
+    Profiler::count("collections", "add");
     auto it = m_assets.find(name);
     const bool nameExists = it != m_assets.end();
     if (nameExists) {
@@ -165,6 +201,7 @@ void AbstractAssetCollection::addAsset(const QString &name, Qt3DCore::QNode *ass
         asset->setParent(this);
     m_assets.insert(name, asset);
     addDestructionConnection(name, asset);
+    m_memoryTracker->track(name, asset);
 
     if (!nameExists)
         emit namesChanged();
@@ -172,13 +209,46 @@ void AbstractAssetCollection::addAsset(const QString &name, Qt3DCore::QNode *ass
     emit assetAdded(name);
 }
 
+qint64 AbstractAssetCollection::cpuMemoryUsage() const
+{
+    return m_memoryTracker->ledger()->cpuBytes();
+}
+
+qint64 AbstractAssetCollection::gpuMemoryUsage() const
+{
+    return m_memoryTracker->ledger()->gpuBytes();
+}
+
+/*!
+ * Returns a report of the memory used by the assets of the collection.
+ *
+ * The report is a map holding the cpuBytes and gpuBytes totals, the
+ * duplicateCpuBytes and duplicateGpuBytes used by resources loaded several
+ * times from the same source, the list of these duplicates and the list of
+ * assets with their own cpuBytes and gpuBytes.
+ *
+ * Buffers, textures (including their mip chain), decoded images and
+ * animation key frames are accounted for. GPU sizes are estimated from the
+ * texture formats and are refined once textures are loaded.
+ *
+ * \since Kuesa 1.4
+ */
+QVariantMap AbstractAssetCollection::memoryReport() const
+{
+    return m_memoryTracker->report();
+}
+
 void AbstractAssetCollection::handleAssetDestruction(const QString &name)
 {
     auto asset = m_assets.take(name);
     // Asset could be null if we have registered the same asset with 2 different names
-    if (asset)
+    if (asset) {
         removeDestructionConnection(name, asset);
+        m_memoryTracker->untrack(name);
+    }
     emit namesChanged();
+    if (asset)
+        emit assetRemoved(name);
 }
 
 void AbstractAssetCollection::addDestructionConnection(const QString &name, Qt3DCore::QNode *asset)
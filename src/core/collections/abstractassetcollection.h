@@ -31,16 +31,21 @@
 
 #include <Qt3DCore/qnode.h>
 #include <Kuesa/kuesa_global.h>
+#include <QVariantMap>
 
 QT_BEGIN_NAMESPACE
 
 namespace Kuesa {
 
+class AssetMemoryTracker;
+
 class KUESASHARED_EXPORT AbstractAssetCollection : public Qt3DCore::QNode
 {
     Q_OBJECT
     Q_PROPERTY(QStringList names READ names NOTIFY namesChanged)
     Q_PROPERTY(int size READ size NOTIFY sizeChanged)
+    Q_PROPERTY(qint64 cpuMemoryUsage READ cpuMemoryUsage NOTIFY memoryUsageChanged)
+    Q_PROPERTY(qint64 gpuMemoryUsage READ gpuMemoryUsage NOTIFY memoryUsageChanged)
 public:
     ~AbstractAssetCollection();
 
@@ -53,6 +58,10 @@ public:
     void remove(const QString &name);
     void clear();
 
+    qint64 cpuMemoryUsage() const;
+    qint64 gpuMemoryUsage() const;
+    Q_INVOKABLE QVariantMap memoryReport() const;
+
 protected:
     explicit AbstractAssetCollection(Qt3DCore::QNode *parent = nullptr);
 
@@ -62,6 +71,8 @@ Q_SIGNALS:
     void namesChanged();
     void sizeChanged();
     void assetAdded(const QString &name);
+    void assetRemoved(const QString &name);
+    void memoryUsageChanged();
 
 private:
     void handleAssetDestruction(const QString &name);
@@ -71,6 +82,7 @@ private:
 
     QMap<QString, Qt3DCore::QNode *> m_assets;
     QHash<std::pair<QString, QNode *>, QMetaObject::Connection> m_destructionConnections;
+    AssetMemoryTracker *m_memoryTracker;
 };
 
 } // namespace Kuesa
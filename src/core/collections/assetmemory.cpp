@@ -0,0 +1,580 @@
+/*
+    assetmemory.cpp
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "assetmemory_p.h"
+#include "sceneentity.h"
+#include "embeddedtextureimage_p.h"
+
+#include <Qt3DRender/QAbstractTexture>
+#include <Qt3DRender/QAbstractTextureImage>
+#include <Qt3DRender/QGeometryRenderer>
+#include <Qt3DRender/QTextureImage>
+#include <Qt3DRender/QTexture>
+#include <Qt3DAnimation/QAnimationClip>
+#include <Qt3DAnimation/QAnimationClipData>
+#include <Qt3DAnimation/QChannel>
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+#include <Qt3DCore/QAttribute>
+#include <Qt3DCore/QBuffer>
+#include <Qt3DCore/QGeometry>
+#else
+#include <Qt3DRender/QAttribute>
+#include <Qt3DRender/QBuffer>
+#include <Qt3DRender/QGeometry>
+#endif
+
+#include <QBuffer>
+#include <QImageReader>
+
+#include <algorithm>
+#include <cmath>
+
+QT_BEGIN_NAMESPACE
+
+namespace Kuesa {
+
+namespace {
+
+int bitsPerTexel(Qt3DRender::QAbstractTexture::TextureFormat format)
+{
+    using Texture = Qt3DRender::QAbstractTexture;
+    switch (format) {
+    case Texture::RGB_DXT1:
+    case Texture::RGBA_DXT1:
+    case Texture::SRGB_DXT1:
+    case Texture::SRGB_Alpha_DXT1:
+    case Texture::R_ATI1N_UNorm:
+    case Texture::R_ATI1N_SNorm:
+    case Texture::RGB8_ETC1:
+    case Texture::RGB8_ETC2:
+    case Texture::SRGB8_ETC2:
+    case Texture::RGB8_PunchThrough_Alpha1_ETC2:
+    case Texture::SRGB8_PunchThrough_Alpha1_ETC2:
+    case Texture::R11_EAC_UNorm:
+    case Texture::R11_EAC_SNorm:
+        return 4;
+    case Texture::R8_UNorm:
+    case Texture::R8_SNorm:
+    case Texture::R8U:
+    case Texture::R8I:
+    case Texture::RGBA_DXT3:
+    case Texture::RGBA_DXT5:
+    case Texture::SRGB_Alpha_DXT3:
+    case Texture::SRGB_Alpha_DXT5:
+    case Texture::RG_ATI2N_UNorm:
+    case Texture::RG_ATI2N_SNorm:
+    case Texture::RGB_BP_UNorm:
+    case Texture::SRGB_BP_UNorm:
+    case Texture::RGB_BP_SIGNED_FLOAT:
+    case Texture::RGB_BP_UNSIGNED_FLOAT:
+    case Texture::RGBA8_ETC2_EAC:
+    case Texture::SRGB8_Alpha8_ETC2_EAC:
+    case Texture::RG11_EAC_UNorm:
+    case Texture::RG11_EAC_SNorm:
+    case Texture::AlphaFormat:
+    case Texture::LuminanceFormat:
+        return 8;
+    case Texture::RG8_UNorm:
+    case Texture::RG8_SNorm:
+    case Texture::RG8U:
+    case Texture::RG8I:
+    case Texture::R16_UNorm:
+    case Texture::R16_SNorm:
+    case Texture::R16U:
+    case Texture::R16I:
+    case Texture::R16F:
+    case Texture::R5G6B5:
+    case Texture::RGB5A1:
+    case Texture::RGBA4:
+    case Texture::D16:
+    case Texture::LuminanceAlphaFormat:
+        return 16;
+    case Texture::RGB8_UNorm:
+    case Texture::RGB8_SNorm:
+    case Texture::RGB8U:
+    case Texture::RGB8I:
+    case Texture::SRGB8:
+    case Texture::D24:
+    case Texture::RGBFormat:
+        return 24;
+    case Texture::RGB16_UNorm:
+    case Texture::RGB16_SNorm:
+    case Texture::RGB16U:
+    case Texture::RGB16I:
+    case Texture::RGB16F:
+        return 48;
+    case Texture::RGBA16_UNorm:
+    case Texture::RGBA16_SNorm:
+    case Texture::RGBA16U:
+    case Texture::RGBA16I:
+    case Texture::RGBA16F:
+    case Texture::RG32U:
+    case Texture::RG32I:
+    case Texture::RG32F:
+    case Texture::D32FS8X24:
+        return 64;
+    case Texture::RGB32U:
+    case Texture::RGB32I:
+    case Texture::RGB32F:
+        return 96;
+    case Texture::RGBA32U:
+    case Texture::RGBA32I:
+    case Texture::RGBA32F:
+        return 128;
+    default:
+        // RGBA8 and other 32 bits formats, Automatic textures end up as RGBA8
+        return 32;
+    }
+}
+
+int faceCount(Qt3DRender::QAbstractTexture::Target target)
+{
+    return (target == Qt3DRender::QAbstractTexture::TargetCubeMap ||
+            target == Qt3DRender::QAbstractTexture::TargetCubeMapArray)
+            ? 6
+            : 1;
+}
+
+QString imageSource(Qt3DRender::QAbstractTextureImage *image)
+{
+    if (auto textureImage = qobject_cast<Qt3DRender::QTextureImage *>(image))
+        return textureImage->source().toString();
+    // Images decoded by Kuesa have no source, but are shared between the
+    // textures created from the same glTF image
+    return QStringLiteral("image:0x") + QString::number(quintptr(image), 16);
+}
+
+QString textureSource(Qt3DRender::QAbstractTexture *texture)
+{
+    if (auto loader = qobject_cast<Qt3DRender::QTextureLoader *>(texture))
+        return loader->source().toString();
+    const auto images = texture->textureImages();
+    if (images.size() == 1)
+        return imageSource(images.first());
+    return {};
+}
+
+void addImageResource(std::vector<AssetMemoryResource> &resources, Qt3DRender::QAbstractTextureImage *image)
+{
+    // Embedded images keep their decoded or encoded copy around, file based
+    // images are only loaded by the backend
+    if (auto embedded = dynamic_cast<GLTF2Import::EmbeddedTextureImage *>(image))
+        resources.push_back({ image, QString(), qint64(embedded->image().sizeInBytes()) + embedded->encodedData().size(), 0 });
+    else if (auto textureImage = qobject_cast<Qt3DRender::QTextureImage *>(image))
+        resources.push_back({ image, textureImage->source().toString(), 0, 0 });
+}
+
+void addGeometryResources(std::vector<AssetMemoryResource> &resources, Qt3DGeometry::QGeometry *geometry)
+{
+    if (!geometry)
+        return;
+    const auto attributes = geometry->attributes();
+    for (Qt3DGeometry::QAttribute *attribute : attributes) {
+        Qt3DGeometry::QBuffer *buffer = attribute->buffer();
+        if (!buffer)
+            continue;
+        const bool known = std::any_of(resources.begin(), resources.end(),
+                                       [buffer](const AssetMemoryResource &r) { return r.object == buffer; });
+        if (known)
+            continue;
+        // Buffers keep their data on the CPU side once uploaded
+        const qint64 size = buffer->data().size();
+        resources.push_back({ buffer, QString(), size, size });
+    }
+}
+
+qint64 clipBytes(const Qt3DAnimation::QAnimationClipData &clipData)
+{
+    qint64 bytes = 0;
+    for (const Qt3DAnimation::QChannel &channel : clipData) {
+        bytes += sizeof(Qt3DAnimation::QChannel);
+        for (const Qt3DAnimation::QChannelComponent &component : channel)
+            bytes += sizeof(Qt3DAnimation::QChannelComponent) + qint64(component.keyFrameCount()) * sizeof(Qt3DAnimation::QKeyFrame);
+    }
+    return bytes;
+}
+
+} // namespace
+
+AssetMemoryLedger::AssetMemoryLedger(QObject *parent)
+    : QObject(parent)
+{
+}
+
+/*!
+    \internal
+
+    Returns the ledger of \a sceneEntity, accounting for the assets of all its
+    collections.
+ */
+AssetMemoryLedger *AssetMemoryLedger::ledger(SceneEntity *sceneEntity)
+{
+    return sceneEntity ? sceneEntity->m_assetMemoryLedger : nullptr;
+}
+
+/*!
+    \internal
+
+    Returns the memory held by \a asset: buffers for meshes and geometries,
+    image data for textures and texture images, key frames for animation clips.
+    Other assets only reference these resources and are not accounted for.
+ */
+std::vector<AssetMemoryResource> AssetMemoryLedger::resources(Qt3DCore::QNode *asset)
+{
+    std::vector<AssetMemoryResource> resources;
+
+    if (auto renderer = qobject_cast<Qt3DRender::QGeometryRenderer *>(asset)) {
+        addGeometryResources(resources, renderer->geometry());
+    } else if (auto geometry = qobject_cast<Qt3DGeometry::QGeometry *>(asset)) {
+        addGeometryResources(resources, geometry);
+    } else if (auto buffer = qobject_cast<Qt3DGeometry::QBuffer *>(asset)) {
+        const qint64 size = buffer->data().size();
+        resources.push_back({ buffer, QString(), size, size });
+    } else if (auto texture = qobject_cast<Qt3DRender::QAbstractTexture *>(asset)) {
+        resources.push_back({ texture, textureSource(texture), 0, textureBytes(texture) });
+        const auto images = texture->textureImages();
+        for (Qt3DRender::QAbstractTextureImage *image : images)
+            addImageResource(resources, image);
+    } else if (auto image = qobject_cast<Qt3DRender::QAbstractTextureImage *>(asset)) {
+        addImageResource(resources, image);
+    } else if (auto clip = qobject_cast<Qt3DAnimation::QAnimationClip *>(asset)) {
+        resources.push_back({ clip, QString(), clipBytes(clip->clipData()), 0 });
+    }
+
+    return resources;
+}
+
+/*!
+    \internal
+
+    Returns an estimate of the GPU memory used by \a texture, including its mip
+    chain. Until loaded, textures report a 1x1 size, the size of the images
+    decoded by Kuesa is used instead when available.
+ */
+qint64 AssetMemoryLedger::textureBytes(const Qt3DRender::QAbstractTexture *texture)
+{
+    int width = texture->width();
+    int height = texture->height();
+    const int depth = std::max(1, texture->depth());
+
+    if (width <= 1 && height <= 1) {
+        const auto images = texture->textureImages();
+        for (Qt3DRender::QAbstractTextureImage *image : images) {
+            if (auto embedded = dynamic_cast<GLTF2Import::EmbeddedTextureImage *>(image)) {
+                QSize size = embedded->image().size();
+                // Not decoded yet, only read the header
+                if (size.isEmpty() && !embedded->encodedData().isEmpty()) {
+                    QBuffer buffer;
+                    buffer.setData(embedded->encodedData());
+                    size = QImageReader(&buffer).size();
+                }
+                width = std::max(width, size.width());
+                height = std::max(height, size.height());
+            }
+        }
+    }
+    width = std::max(1, width);
+    height = std::max(1, height);
+
+    int levels = 1;
+    if (texture->generateMipMaps())
+        levels = int(std::floor(std::log2(std::max({ width, height, depth })))) + 1;
+
+    qint64 texels = 0;
+    for (int level = 0; level < levels; ++level)
+        texels += qint64(std::max(1, width >> level)) * std::max(1, height >> level) * std::max(1, depth >> level);
+
+    const qint64 layers = std::max(1, texture->layers()) * faceCount(texture->target());
+    return (texels * layers * bitsPerTexel(texture->format()) + 7) / 8;
+}
+
+void AssetMemoryLedger::add(const std::vector<AssetMemoryResource> &resources)
+{
+    for (const AssetMemoryResource &resource : resources) {
+        auto it = m_entries.find(resource.object);
+        if (it != m_entries.end()) {
+            ++it->refCount;
+            // A shared resource was estimated again, i.e a texture got loaded
+            AssetMemoryResource &current = it->resource;
+            if (current.cpuBytes != resource.cpuBytes || current.gpuBytes != resource.gpuBytes) {
+                const bool duplicate = !current.source.isEmpty() && m_sources.value(current.source).front() != current.object;
+                account(current, -1, duplicate);
+                current.cpuBytes = resource.cpuBytes;
+                current.gpuBytes = resource.gpuBytes;
+                account(current, 1, duplicate);
+            }
+            continue;
+        }
+
+        m_entries.insert(resource.object, { resource, 1 });
+        bool duplicate = false;
+        if (!resource.source.isEmpty()) {
+            std::vector<const QObject *> &objects = m_sources[resource.source];
+            objects.push_back(resource.object);
+            duplicate = objects.size() > 1;
+        }
+        account(resource, 1, duplicate);
+    }
+}
+
+void AssetMemoryLedger::remove(const std::vector<AssetMemoryResource> &resources)
+{
+    for (const AssetMemoryResource &r : resources) {
+        auto it = m_entries.find(r.object);
+        if (it == m_entries.end() || --it->refCount > 0)
+            continue;
+
+        const AssetMemoryResource resource = it->resource;
+        m_entries.erase(it);
+
+        bool duplicate = false;
+        if (!resource.source.isEmpty()) {
+            auto sourceIt = m_sources.find(resource.source);
+            std::vector<const QObject *> &objects = sourceIt.value();
+            const auto objectIt = std::find(objects.begin(), objects.end(), resource.object);
+            duplicate = objectIt != objects.begin();
+            objects.erase(objectIt);
+            if (objects.empty()) {
+                m_sources.erase(sourceIt);
+            } else if (!duplicate) {
+                // The next copy becomes the original
+                const AssetMemoryResource &original = m_entries.value(objects.front()).resource;
+                m_duplicateCpuBytes -= original.cpuBytes;
+                m_duplicateGpuBytes -= original.gpuBytes;
+            }
+        }
+        account(resource, -1, duplicate);
+    }
+}
+
+void AssetMemoryLedger::clear()
+{
+    m_entries.clear();
+    m_sources.clear();
+    m_cpuBytes = 0;
+    m_gpuBytes = 0;
+    m_duplicateCpuBytes = 0;
+    m_duplicateGpuBytes = 0;
+}
+
+void AssetMemoryLedger::account(const AssetMemoryResource &resource, int sign, bool duplicate)
+{
+    m_cpuBytes += sign * resource.cpuBytes;
+    m_gpuBytes += sign * resource.gpuBytes;
+    if (duplicate) {
+        m_duplicateCpuBytes += sign * resource.cpuBytes;
+        m_duplicateGpuBytes += sign * resource.gpuBytes;
+    }
+}
+
+/*!
+    \internal
+
+    Returns the sources loaded more than once, along with the number of copies
+    and the memory used by the extra copies.
+ */
+QVariantList AssetMemoryLedger::duplicates() const
+{
+    QVariantList duplicates;
+    for (auto it = m_sources.cbegin(), end = m_sources.cend(); it != end; ++it) {
+        const std::vector<const QObject *> &objects = it.value();
+        if (objects.size() < 2)
+            continue;
+        qint64 cpuBytes = 0;
+        qint64 gpuBytes = 0;
+        for (auto objectIt = objects.begin() + 1; objectIt != objects.end(); ++objectIt) {
+            const AssetMemoryResource &resource = m_entries.value(*objectIt).resource;
+            cpuBytes += resource.cpuBytes;
+            gpuBytes += resource.gpuBytes;
+        }
+        duplicates.push_back(QVariantMap{
+                { QStringLiteral("source"), it.key() },
+                { QStringLiteral("copies"), int(objects.size()) },
+                { QStringLiteral("cpuBytes"), cpuBytes },
+                { QStringLiteral("gpuBytes"), gpuBytes },
+        });
+    }
+    return duplicates;
+}
+
+QVariantMap AssetMemoryLedger::report() const
+{
+    return {
+        { QStringLiteral("cpuBytes"), m_cpuBytes },
+        { QStringLiteral("gpuBytes"), m_gpuBytes },
+        { QStringLiteral("duplicateCpuBytes"), m_duplicateCpuBytes },
+        { QStringLiteral("duplicateGpuBytes"), m_duplicateGpuBytes },
+        { QStringLiteral("duplicates"), duplicates() },
+    };
+}
+
+AssetMemoryTracker::AssetMemoryTracker(QObject *parent)
+    : QObject(parent)
+{
+}
+
+AssetMemoryTracker::~AssetMemoryTracker() = default;
+
+/*!
+    \internal
+
+    Accounts for the memory held by \a asset, registered under \a name,
+    replacing any asset previously registered under that name.
+ */
+void AssetMemoryTracker::track(const QString &name, Qt3DCore::QNode *asset)
+{
+    AssetMemoryLedger *scene = sceneLedger();
+    auto it = m_assets.find(name);
+    if (it != m_assets.end()) {
+        release(it.value(), scene);
+        m_assets.erase(it);
+    }
+
+    Asset entry{ asset, AssetMemoryLedger::resources(asset), {} };
+    m_ledger.add(entry.resources);
+    if (scene)
+        scene->add(entry.resources);
+
+    // Textures loaded by the backend only report their size once loaded
+    if (auto texture = qobject_cast<Qt3DRender::QAbstractTexture *>(asset)) {
+        const auto f = [this, name] { update(name); };
+        entry.connections = {
+            connect(texture, &Qt3DRender::QAbstractTexture::widthChanged, this, f),
+            connect(texture, &Qt3DRender::QAbstractTexture::heightChanged, this, f),
+            connect(texture, &Qt3DRender::QAbstractTexture::depthChanged, this, f),
+            connect(texture, &Qt3DRender::QAbstractTexture::layersChanged, this, f),
+            connect(texture, &Qt3DRender::QAbstractTexture::formatChanged, this, f),
+            connect(texture, &Qt3DRender::QAbstractTexture::generateMipMapsChanged, this, f),
+        };
+    }
+
+    m_assets.insert(name, std::move(entry));
+    emit changed();
+}
+
+void AssetMemoryTracker::untrack(const QString &name)
+{
+    auto it = m_assets.find(name);
+    if (it == m_assets.end())
+        return;
+    release(it.value(), sceneLedger());
+    m_assets.erase(it);
+    emit changed();
+}
+
+void AssetMemoryTracker::clear()
+{
+    if (m_assets.empty())
+        return;
+    AssetMemoryLedger *scene = sceneLedger();
+    for (Asset &asset : m_assets)
+        release(asset, scene);
+    m_assets.clear();
+    emit changed();
+}
+
+qint64 AssetMemoryTracker::cpuBytes(const QString &name) const
+{
+    qint64 bytes = 0;
+    const auto it = m_assets.constFind(name);
+    if (it != m_assets.cend()) {
+        for (const AssetMemoryResource &resource : it->resources)
+            bytes += resource.cpuBytes;
+    }
+    return bytes;
+}
+
+qint64 AssetMemoryTracker::gpuBytes(const QString &name) const
+{
+    qint64 bytes = 0;
+    const auto it = m_assets.constFind(name);
+    if (it != m_assets.cend()) {
+        for (const AssetMemoryResource &resource : it->resources)
+            bytes += resource.gpuBytes;
+    }
+    return bytes;
+}
+
+QVariantMap AssetMemoryTracker::report() const
+{
+    QStringList names = m_assets.keys();
+    std::sort(names.begin(), names.end());
+
+    QVariantList assets;
+    for (const QString &name : qAsConst(names)) {
+        assets.push_back(QVariantMap{
+                { QStringLiteral("name"), name },
+                { QStringLiteral("cpuBytes"), cpuBytes(name) },
+                { QStringLiteral("gpuBytes"), gpuBytes(name) },
+        });
+    }
+    QVariantMap report = m_ledger.report();
+    report.insert(QStringLiteral("assets"), assets);
+    return report;
+}
+
+AssetMemoryLedger *AssetMemoryTracker::sceneLedger() const
+{
+    // The tracker is a child of a collection, itself a child of a SceneEntity
+    // when created by it. During the destruction of the SceneEntity, the cast
+    // fails and nothing is forwarded.
+    QObject *collection = parent();
+    return collection ? AssetMemoryLedger::ledger(qobject_cast<SceneEntity *>(collection->parent())) : nullptr;
+}
+
+void AssetMemoryTracker::update(const QString &name)
+{
+    auto it = m_assets.find(name);
+    if (it == m_assets.end())
+        return;
+
+    AssetMemoryLedger *scene = sceneLedger();
+    Asset &asset = it.value();
+    m_ledger.remove(asset.resources);
+    if (scene)
+        scene->remove(asset.resources);
+
+    asset.resources = AssetMemoryLedger::resources(asset.node);
+    m_ledger.add(asset.resources);
+    if (scene)
+        scene->add(asset.resources);
+    emit changed();
+}
+
+void AssetMemoryTracker::release(Asset &asset, AssetMemoryLedger *sceneLedger)
+{
+    m_ledger.remove(asset.resources);
+    if (sceneLedger)
+        sceneLedger->remove(asset.resources);
+    for (const QMetaObject::Connection &connection : asset.connections)
+        QObject::disconnect(connection);
+}
+
+} // namespace Kuesa
+
+QT_END_NAMESPACE
@@ -0,0 +1,160 @@
+/*
+    assetmemory_p.h
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef KUESA_ASSETMEMORY_P_H
+#define KUESA_ASSETMEMORY_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Kuesa API.  It exists for the convenience
+// of other Kuesa classes.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <Kuesa/private/kuesa_global_p.h>
+#include <QObject>
+#include <QHash>
+#include <QVariant>
+#include <vector>
+
+QT_BEGIN_NAMESPACE
+
+namespace Qt3DCore {
+class QNode;
+}
+
+namespace Qt3DRender {
+class QAbstractTexture;
+}
+
+namespace Kuesa {
+
+class SceneEntity;
+
+// A piece of memory held by an asset. Several assets may reference the same
+// object (a buffer shared by meshes, an image shared by textures), in which
+// case it is only accounted for once. Distinct objects created from the same
+// source are reported as duplicates.
+struct AssetMemoryResource {
+    const QObject *object;
+    QString source;
+    qint64 cpuBytes;
+    qint64 gpuBytes;
+};
+
+// Reference counted set of resources, with running totals so that querying
+// the memory usage is cheap whatever the number of assets.
+class KUESA_PRIVATE_EXPORT AssetMemoryLedger : public QObject
+{
+    Q_OBJECT
+public:
+    explicit AssetMemoryLedger(QObject *parent = nullptr);
+
+    static AssetMemoryLedger *ledger(SceneEntity *sceneEntity);
+
+    static std::vector<AssetMemoryResource> resources(Qt3DCore::QNode *asset);
+    static qint64 textureBytes(const Qt3DRender::QAbstractTexture *texture);
+
+    void add(const std::vector<AssetMemoryResource> &resources);
+    void remove(const std::vector<AssetMemoryResource> &resources);
+    void clear();
+
+    qint64 cpuBytes() const { return m_cpuBytes; }
+    qint64 gpuBytes() const { return m_gpuBytes; }
+    qint64 duplicateCpuBytes() const { return m_duplicateCpuBytes; }
+    qint64 duplicateGpuBytes() const { return m_duplicateGpuBytes; }
+    int resourceCount() const { return m_entries.size(); }
+
+    QVariantList duplicates() const;
+    QVariantMap report() const;
+
+private:
+    struct Entry {
+        AssetMemoryResource resource;
+        int refCount;
+    };
+
+    void account(const AssetMemoryResource &resource, int sign, bool duplicate);
+
+    QHash<const QObject *, Entry> m_entries;
+    // Distinct objects per source, the first one being the original
+    QHash<QString, std::vector<const QObject *>> m_sources;
+    qint64 m_cpuBytes = 0;
+    qint64 m_gpuBytes = 0;
+    qint64 m_duplicateCpuBytes = 0;
+    qint64 m_duplicateGpuBytes = 0;
+};
+
+// Memory accounting of the assets of a collection, the tracker being a child
+// of the collection. Estimates are computed when an asset is added, refreshed
+// when a texture reports its final size, and forwarded to the ledger of the
+// SceneEntity owning the collection.
+class KUESA_PRIVATE_EXPORT AssetMemoryTracker : public QObject
+{
+    Q_OBJECT
+public:
+    explicit AssetMemoryTracker(QObject *parent = nullptr);
+    ~AssetMemoryTracker();
+
+    void track(const QString &name, Qt3DCore::QNode *asset);
+    void untrack(const QString &name);
+    void clear();
+
+    const AssetMemoryLedger *ledger() const { return &m_ledger; }
+    qint64 cpuBytes(const QString &name) const;
+    qint64 gpuBytes(const QString &name) const;
+
+    QVariantMap report() const;
+
+Q_SIGNALS:
+    void changed();
+
+private:
+    struct Asset {
+        Qt3DCore::QNode *node;
+        std::vector<AssetMemoryResource> resources;
+        std::vector<QMetaObject::Connection> connections;
+    };
+
+    AssetMemoryLedger *sceneLedger() const;
+    void update(const QString &name);
+    void release(Asset &asset, AssetMemoryLedger *sceneLedger);
+
+    AssetMemoryLedger m_ledger;
+    QHash<QString, Asset> m_assets;
+};
+
+} // namespace Kuesa
+
+QT_END_NAMESPACE
+
+#endif // KUESA_ASSETMEMORY_P_H
@@ -0,0 +1,157 @@
+/*
+    assetnameregistry.cpp
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "assetnameregistry_p.h"
+#include "abstractassetcollection.h"
+#include "sceneentity.h"
+
+#include <algorithm>
+
+QT_BEGIN_NAMESPACE
+
+namespace Kuesa {
+
+AssetNameRegistry::AssetNameRegistry(QObject *parent)
+    : QObject(parent)
+{
+}
+
+/*!
+    \internal
+
+    Returns the registry of \a sceneEntity, shared by all the objects
+    resolving names in the collections of this scene.
+ */
+AssetNameRegistry *AssetNameRegistry::registry(SceneEntity *sceneEntity)
+{
+    return sceneEntity ? sceneEntity->m_assetNameRegistry : nullptr;
+}
+
+/*!
+    \internal
+
+    Calls \a callback whenever an asset named \a name is added to or removed
+    from \a collection, until \a watcher is unwatched.
+ */
+void AssetNameRegistry::watch(AbstractAssetCollection *collection, const QString &name,
+                              QObject *watcher, const Callback &callback)
+{
+    Q_ASSERT(collection && watcher);
+    addCollection(collection);
+
+    const Key key{ collection, name };
+    m_watchers[key].push_back({ watcher, callback });
+    m_watcherKeys[watcher].push_back(key);
+}
+
+void AssetNameRegistry::unwatch(QObject *watcher)
+{
+    const auto it = m_watcherKeys.find(watcher);
+    if (it == m_watcherKeys.end())
+        return;
+
+    for (const Key &key : it.value()) {
+        auto watchersIt = m_watchers.find(key);
+        if (watchersIt == m_watchers.end())
+            continue;
+        std::vector<Watcher> &watchers = watchersIt.value();
+        watchers.erase(std::remove_if(watchers.begin(), watchers.end(),
+                                      [watcher](const Watcher &w) { return w.object == watcher; }),
+                       watchers.end());
+        if (watchers.empty())
+            m_watchers.erase(watchersIt);
+    }
+    m_watcherKeys.erase(it);
+}
+
+int AssetNameRegistry::watcherCount(AbstractAssetCollection *collection, const QString &name) const
+{
+    const auto it = m_watchers.constFind({ collection, name });
+    return it != m_watchers.cend() ? int(it.value().size()) : 0;
+}
+
+int AssetNameRegistry::watcherCount() const
+{
+    return m_watcherKeys.size();
+}
+
+void AssetNameRegistry::addCollection(AbstractAssetCollection *collection)
+{
+    if (m_collections.contains(collection))
+        return;
+
+    m_collections.insert(collection);
+    connect(collection, &AbstractAssetCollection::assetAdded, this, [this, collection](const QString &name) {
+        notify(collection, name);
+    });
+    connect(collection, &AbstractAssetCollection::assetRemoved, this, [this, collection](const QString &name) {
+        notify(collection, name);
+    });
+    connect(collection, &QObject::destroyed, this, [this, collection] {
+        removeCollection(collection);
+    });
+}
+
+void AssetNameRegistry::removeCollection(AbstractAssetCollection *collection)
+{
+    m_collections.remove(collection);
+    for (auto it = m_watchers.begin(); it != m_watchers.end();) {
+        if (it.key().first == collection)
+            it = m_watchers.erase(it);
+        else
+            ++it;
+    }
+    // m_watcherKeys may still reference the collection, which is only ever
+    // used as a key and dropped on unwatch
+}
+
+void AssetNameRegistry::notify(AbstractAssetCollection *collection, const QString &name)
+{
+    const Key key{ collection, name };
+    const auto it = m_watchers.constFind(key);
+    if (it == m_watchers.cend())
+        return;
+
+    // Callbacks may (un)watch or destroy other watchers, iterate over a copy
+    // and skip the ones that have been unwatched in the meantime
+    const std::vector<Watcher> watchers = it.value();
+    for (const Watcher &watcher : watchers) {
+        const auto currentIt = m_watchers.constFind(key);
+        if (currentIt == m_watchers.cend())
+            return;
+        const std::vector<Watcher> &current = currentIt.value();
+        const bool stillWatching = std::any_of(current.begin(), current.end(),
+                                               [&watcher](const Watcher &w) { return w.object == watcher.object; });
+        if (stillWatching)
+            watcher.callback();
+    }
+}
+
+} // namespace Kuesa
+
+QT_END_NAMESPACE
@@ -0,0 +1,100 @@
+/*
+    assetnameregistry_p.h
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef KUESA_ASSETNAMEREGISTRY_P_H
+#define KUESA_ASSETNAMEREGISTRY_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Kuesa API.  It exists for the convenience
+// of other Kuesa classes.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <Kuesa/private/kuesa_global_p.h>
+#include <QObject>
+#include <QHash>
+#include <QSet>
+#include <functional>
+#include <vector>
+
+QT_BEGIN_NAMESPACE
+
+namespace Kuesa {
+
+class AbstractAssetCollection;
+class SceneEntity;
+
+// Index of the objects waiting for a name in a collection.
+//
+// Rather than having every watcher search the collections each time any
+// name changes, a watcher registers the (collection, name) pairs it depends
+// on and is only notified when an asset is added or removed under one of
+// these names.
+class KUESA_PRIVATE_EXPORT AssetNameRegistry : public QObject
+{
+    Q_OBJECT
+public:
+    using Callback = std::function<void()>;
+
+    explicit AssetNameRegistry(QObject *parent = nullptr);
+
+    static AssetNameRegistry *registry(SceneEntity *sceneEntity);
+
+    void watch(AbstractAssetCollection *collection, const QString &name,
+               QObject *watcher, const Callback &callback);
+    void unwatch(QObject *watcher);
+
+    int watcherCount(AbstractAssetCollection *collection, const QString &name) const;
+    int watcherCount() const;
+
+private:
+    using Key = std::pair<AbstractAssetCollection *, QString>;
+    struct Watcher {
+        QObject *object;
+        Callback callback;
+    };
+
+    void addCollection(AbstractAssetCollection *collection);
+    void removeCollection(AbstractAssetCollection *collection);
+    void notify(AbstractAssetCollection *collection, const QString &name);
+
+    QSet<AbstractAssetCollection *> m_collections;
+    QHash<Key, std::vector<Watcher>> m_watchers;
+    QHash<QObject *, std::vector<Key>> m_watcherKeys;
+};
+
+} // namespace Kuesa
+
+QT_END_NAMESPACE
+
+#endif // KUESA_ASSETNAMEREGISTRY_P_H
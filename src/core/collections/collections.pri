@@ -43,7 +43,9 @@ SOURCES += \
     $$PWD/textureimagecollection.cpp \
     $$PWD/animationmappingcollection.cpp \
     $$PWD/transformcollection.cpp \
-    $$PWD/placeholdercollection.cpp
+    $$PWD/placeholdercollection.cpp \
+    $$PWD/assetnameregistry.cpp \
+    $$PWD/assetmemory.cpp
 
 HEADERS += \
     $$PWD/layercollection.h \
@@ -62,4 +64,6 @@ HEADERS += \
     $$PWD/textureimagecollection.h \
     $$PWD/animationmappingcollection.h \
     $$PWD/transformcollection.h \
-    $$PWD/placeholdercollection.h
+    $$PWD/placeholdercollection.h \
+    $$PWD/assetnameregistry_p.h \
+    $$PWD/assetmemory_p.h
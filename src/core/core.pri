@@ -34,20 +34,34 @@ SOURCES += \
     $$PWD/logging.cpp \
     $$PWD/placeholder.cpp \
     $$PWD/meshinstantiator.cpp \
+    $$PWD/levelofdetailselector.cpp \
     $$PWD/placeholdertracker.cpp \
     $$PWD/sceneentity.cpp \
     $$PWD/animationplayer.cpp \
+    $$PWD/animationresultbuffer.cpp \
+    $$PWD/animationinstancer.cpp \
     $$PWD/skybox.cpp \
     $$PWD/morphcontroller.cpp \
+    $$PWD/packedmorphtargets.cpp \
+    $$PWD/morphtargetblender.cpp \
     $$PWD/particlemesh.cpp \
     $$PWD/particlegeometry.cpp \
     $$PWD/particlematerial.cpp \
     $$PWD/noisetextureimage.cpp \
     $$PWD/particles.cpp \
+    $$PWD/particlesimulation.cpp \
+    $$PWD/particlesort.cpp \
+    $$PWD/propertyforwarder.cpp \
+    $$PWD/profiler.cpp \
+    $$PWD/profilingmodel.cpp \
+    $$PWD/pulsetrack.cpp \
+    $$PWD/resourcereadinesstracker.cpp \
     $$PWD/steppedanimationplayer.cpp \
+    $$PWD/texturestreamer.cpp \
     $$PWD/transformtracker.cpp \
     $$PWD/animationpulse.cpp \
-    $$PWD/kuesaentity.cpp
+    $$PWD/kuesaentity.cpp \
+    $$PWD/boundingvolumehierarchy.cpp
 
 HEADERS += \
     $$PWD/empty2dtexture_p.h \
@@ -55,6 +69,7 @@ HEADERS += \
     $$PWD/logging_p.h \
     $$PWD/placeholder.h \
     $$PWD/meshinstantiator.h \
+    $$PWD/levelofdetailselector.h \
     $$PWD/placeholdertracker.h \
     $$PWD/sceneentity.h \
     $$PWD/factory.h \
@@ -63,16 +78,29 @@ HEADERS += \
     $$PWD/kuesa_global_p.h \
     $$PWD/kuesa_utils_p.h \
     $$PWD/animationplayer.h \
+    $$PWD/animationresultbuffer_p.h \
+    $$PWD/animationinstancer_p.h \
     $$PWD/skybox.h \
     $$PWD/morphcontroller.h \
+    $$PWD/packedmorphtargets_p.h \
+    $$PWD/morphtargetblender_p.h \
     $$PWD/particlemesh_p.h \
     $$PWD/particlegeometry_p.h \
     $$PWD/particlematerial_p.h \
+    $$PWD/particlesimulation_p.h \
+    $$PWD/particlesort_p.h \
+    $$PWD/propertyforwarder_p.h \
+    $$PWD/profiler_p.h \
+    $$PWD/profilingmodel.h \
+    $$PWD/pulsetrack_p.h \
+    $$PWD/resourcereadinesstracker_p.h \
     $$PWD/noisetextureimage_p.h \
     $$PWD/particles.h \
     $$PWD/steppedanimationplayer.h \
+    $$PWD/texturestreamer_p.h \
     $$PWD/transformtracker.h \
-    $$PWD/animationpulse.h
+    $$PWD/animationpulse.h \
+    $$PWD/boundingvolumehierarchy_p.h
 
 # Don't add kuesaentity.h to HEADERS as we already implement the metaobject functions
 #    $$PWD/kuesaentity.h
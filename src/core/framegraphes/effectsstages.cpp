@@ -139,6 +139,47 @@ void EffectsStages::removeEffect(AbstractPostProcessingEffect *effect)
     reconfigure();
 }
 
+/*!
+ * \internal
+ *
+ * Replaces the registered effects by \a effects, keeping the FrameGraph
+ * subtrees of the effects which remain in place and reconfiguring once.
+ */
+void EffectsStages::setEffects(const std::vector<AbstractPostProcessingEffect *> &effects)
+{
+    if (effects == m_effects)
+        return;
+
+    auto d = Qt3DCore::QNodePrivate::get(this);
+
+    // Remove effects which are gone
+    const std::vector<AbstractPostProcessingEffect *> previousEffects = m_effects;
+    for (AbstractPostProcessingEffect *fx : previousEffects) {
+        if (Utils::contains(effects, fx))
+            continue;
+        Utils::removeAll(m_effects, fx);
+        const AbstractPostProcessingEffect::FrameGraphNodePtr subtree = m_effectFGSubtrees.take(fx);
+        if (subtree)
+            subtree->setParent(Q_NODE_NULLPTR);
+        d->unregisterDestructionHelper(fx);
+    }
+
+    // Register new effects
+    for (AbstractPostProcessingEffect *fx : effects) {
+        if (Utils::contains(m_effects, fx))
+            continue;
+        m_effects.push_back(fx);
+        d->registerDestructionHelper(fx, &EffectsStages::removeEffect, m_effects);
+        const AbstractPostProcessingEffect::FrameGraphNodePtr subtree = fx->frameGraphSubTree();
+        if (!subtree.isNull())
+            m_effectFGSubtrees.insert(fx, subtree);
+    }
+
+    // Follow the requested order
+    m_effects = effects;
+    reconfigure();
+}
+
 const std::vector<AbstractPostProcessingEffect *> EffectsStages::effects() const
 {
     return m_effects;
@@ -263,98 +304,111 @@ bool EffectsStages::blitFinalRT() const
 
 void EffectsStages::reconfigure()
 {
-    m_stateSet->setParent(Q_NODE_NULLPTR);
+    // Compute the desired tree, then only move the nodes whose place changed
+    std::vector<Qt3DCore::QNode *> desiredChildren;
+    std::vector<Qt3DCore::QNode *> desiredViewportChildren;
+    QHash<Qt3DRender::QRenderTargetSelector *, Qt3DCore::QNode *> selectorSubtrees;
 
-    for (AbstractPostProcessingEffect *fx : m_effects)
-        m_effectFGSubtrees[fx]->setParent(Q_NODE_NULLPTR);
+    std::vector<Qt3DCore::QNode *> fxSubtrees;
+    for (const auto &fxSubtree : qAsConst(m_effectFGSubtrees))
+        fxSubtrees.push_back(fxSubtree.data());
 
-    for (Qt3DRender::QRenderTargetSelector *rtS : m_rtSelectors)
-        rtS->setParent(Q_NODE_NULLPTR);
+    const bool canRender = m_rt[0] && (m_effects.empty() || m_presentToScreen || m_rt[1]);
 
-    if (m_blitRt) {
-        m_blitRt->setParent(Q_NODE_NULLPTR);
-        if (!m_blitFinalRT) {
-            delete m_blitRt;
-            m_blitRt = nullptr;
-        }
+    if (m_blitRt && !m_blitFinalRT) {
+        delete m_blitRt;
+        m_blitRt = nullptr;
     }
 
-    if (!m_rt[0])
-        return;
-
-    if (m_effects.size() && !m_presentToScreen && !m_rt[1])
-        return;
-
-    const int targetSelectorCount = std::max(int(m_effects.size() - int(m_presentToScreen)), 0);
-    const int diff = m_rtSelectors.size() - targetSelectorCount;
-
-    // Add or remove Target Selectors we will make use of
-    if (diff > 0) {
-        // We need to destroy RT selector we don't need
-        for (int i = diff; i > 0; --i) {
-            auto it = --(m_rtSelectors.end());
-            delete *it;
-            m_rtSelectors.erase(it);
+    if (canRender) {
+        const int targetSelectorCount = std::max(int(m_effects.size() - int(m_presentToScreen)), 0);
+        const int diff = m_rtSelectors.size() - targetSelectorCount;
+
+        // Add or remove Target Selectors we will make use of
+        if (diff > 0) {
+            // We need to destroy RT selector we don't need
+            for (int i = diff; i > 0; --i) {
+                auto it = --(m_rtSelectors.end());
+                // Make sure we don't destroy the subtree of an effect with it
+                FrameGraphUtils::reconcileChildren(*it, {}, fxSubtrees);
+                delete *it;
+                m_rtSelectors.erase(it);
+            }
+        } else if (diff < 0) {
+            // We need to add new RT selectors
+            for (int i = 0; i > diff; --i)
+                m_rtSelectors.push_back(new Qt3DRender::QRenderTargetSelector());
         }
-    } else if (diff < 0) {
-        // We need to add new RT selectors
-        for (int i = 0; i > diff; --i)
-            m_rtSelectors.push_back(new Qt3DRender::QRenderTargetSelector());
-    }
 
-    int previousRenderTargetIndex = 0;
-    for (size_t i = 0, m = m_effects.size(); i < m; ++i) {
-        const int currentRenderTargetIndex = 1 - previousRenderTargetIndex;
-        Qt3DRender::QRenderTarget *previousRenderTarget = m_rt[previousRenderTargetIndex];
-        Qt3DRender::QRenderTarget *currentRenderTarget = m_rt[currentRenderTargetIndex];
-        AbstractPostProcessingEffect *fx = m_effects[i];
-        fx->setInputTexture(FrameGraphUtils::findRenderTargetTexture(previousRenderTarget, Qt3DRender::QRenderTargetOutput::Color0));
-        fx->setDepthTexture(m_depthTexture);
-        fx->setCamera(m_camera);
-        fx->setWindowSize(m_windowSize);
-
-        // Parent last effect to render to screen by default
-        Qt3DRender::QFrameGraphNode *fxFGParent = m_viewport;
-
-        // Use render target selectors for all but last effect (if m_presentToScreen set)
-        if (i < (m - 1) || !m_presentToScreen) {
-            Qt3DRender::QRenderTargetSelector *renderTargetSelector = m_rtSelectors[i];
-            renderTargetSelector->setTarget(currentRenderTarget);
-            renderTargetSelector->setObjectName(QStringLiteral("RenderToTexture %1").arg(currentRenderTargetIndex));
-            renderTargetSelector->setParent(this);
-            fxFGParent = renderTargetSelector;
-        }
+        int previousRenderTargetIndex = 0;
+        for (size_t i = 0, m = m_effects.size(); i < m; ++i) {
+            const int currentRenderTargetIndex = 1 - previousRenderTargetIndex;
+            Qt3DRender::QRenderTarget *previousRenderTarget = m_rt[previousRenderTargetIndex];
+            Qt3DRender::QRenderTarget *currentRenderTarget = m_rt[currentRenderTargetIndex];
+            AbstractPostProcessingEffect *fx = m_effects[i];
+            fx->setInputTexture(FrameGraphUtils::findRenderTargetTexture(previousRenderTarget, Qt3DRender::QRenderTargetOutput::Color0));
+            fx->setDepthTexture(m_depthTexture);
+            fx->setCamera(m_camera);
+            fx->setWindowSize(m_windowSize);
+
+            Qt3DCore::QNode *fxSubtree = m_effectFGSubtrees.value(fx).data();
+
+            // Use render target selectors for all but last effect (if m_presentToScreen set)
+            if (i < (m - 1) || !m_presentToScreen) {
+                Qt3DRender::QRenderTargetSelector *renderTargetSelector = m_rtSelectors[i];
+                renderTargetSelector->setTarget(currentRenderTarget);
+                renderTargetSelector->setObjectName(QStringLiteral("RenderToTexture %1").arg(currentRenderTargetIndex));
+                desiredChildren.push_back(renderTargetSelector);
+                selectorSubtrees.insert(renderTargetSelector, fxSubtree);
+            } else if (fxSubtree) {
+                // Parent last effect to render to screen
+                desiredViewportChildren.push_back(fxSubtree);
+            }
 
-        // Blit currentRT into previousRt for the last FX. This is needed to handle
-        // the case where we have different views with different FX
-        if (i == (m - 1) && m_blitFinalRT && !m_presentToScreen) {
-            if (m_blitRt == nullptr) {
-                m_blitRt = new Qt3DRender::QBlitFramebuffer();
-                auto noDraw = new Qt3DRender::QNoDraw(m_blitRt);
-                Q_UNUSED(noDraw);
+            // Blit currentRT into previousRt for the last FX. This is needed to handle
+            // the case where we have different views with different FX
+            if (i == (m - 1) && m_blitFinalRT && !m_presentToScreen) {
+                if (m_blitRt == nullptr) {
+                    m_blitRt = new Qt3DRender::QBlitFramebuffer();
+                    auto noDraw = new Qt3DRender::QNoDraw(m_blitRt);
+                    Q_UNUSED(noDraw);
+                }
+                desiredChildren.push_back(m_blitRt);
+                m_blitRt->setSource(currentRenderTarget);
+                m_blitRt->setDestination(previousRenderTarget);
+                m_blitRt->setSourceAttachmentPoint(Qt3DRender::QRenderTargetOutput::Color0);
+                m_blitRt->setDestinationAttachmentPoint(Qt3DRender::QRenderTargetOutput::Color0);
+
+                const QRect blitRect(QPoint(), m_windowSize);
+                m_blitRt->setSourceRect(blitRect);
+                m_blitRt->setDestinationRect(blitRect);
             }
-            m_blitRt->setParent(this);
-            m_blitRt->setSource(currentRenderTarget);
-            m_blitRt->setDestination(previousRenderTarget);
-            m_blitRt->setSourceAttachmentPoint(Qt3DRender::QRenderTargetOutput::Color0);
-            m_blitRt->setDestinationAttachmentPoint(Qt3DRender::QRenderTargetOutput::Color0);
-
-            const QRect blitRect(QPoint(), m_windowSize);
-            m_blitRt->setSourceRect(blitRect);
-            m_blitRt->setDestinationRect(blitRect);
+
+            // Flip previousRenderTargetIndex
+            previousRenderTargetIndex = currentRenderTargetIndex;
         }
 
-        m_effectFGSubtrees[fx]->setParent(fxFGParent);
+        // Record final RT index to make it easier to retrieve the final color attachment
+        m_finalRTIndex = previousRenderTargetIndex;
 
-        // Flip previousRenderTargetIndex
-        previousRenderTargetIndex = currentRenderTargetIndex;
+        if (m_presentToScreen)
+            desiredChildren.push_back(m_stateSet);
     }
 
-    // Record final RT index to make it easier to retrieve the final color attachment
-    m_finalRTIndex = previousRenderTargetIndex;
-
-    if (m_presentToScreen)
-        m_stateSet->setParent(this);
+    // Nodes we may have parented in previous configurations
+    std::vector<Qt3DCore::QNode *> managedNodes(m_rtSelectors.cbegin(), m_rtSelectors.cend());
+    managedNodes.push_back(m_stateSet);
+    if (m_blitRt)
+        managedNodes.push_back(m_blitRt);
+
+    FrameGraphUtils::reconcileChildren(this, desiredChildren, managedNodes);
+    for (Qt3DRender::QRenderTargetSelector *rtS : m_rtSelectors) {
+        std::vector<Qt3DCore::QNode *> desiredSelectorChildren;
+        if (Qt3DCore::QNode *fxSubtree = selectorSubtrees.value(rtS))
+            desiredSelectorChildren.push_back(fxSubtree);
+        FrameGraphUtils::reconcileChildren(rtS, desiredSelectorChildren, fxSubtrees);
+    }
+    FrameGraphUtils::reconcileChildren(m_viewport, desiredViewportChildren, fxSubtrees);
 }
 
 } // namespace Kuesa
@@ -73,6 +73,7 @@ public:
 
     void addEffect(AbstractPostProcessingEffect *effect);
     void removeEffect(AbstractPostProcessingEffect *effect);
+    void setEffects(const std::vector<AbstractPostProcessingEffect *> &effects);
     const std::vector<AbstractPostProcessingEffect *> effects() const;
     void clearEffects();
 
@@ -35,6 +35,10 @@
 #include <QScreen>
 #include <Qt3DRender/qnodraw.h>
 #include <Kuesa/private/viewresolver_p.h>
+#include <Kuesa/private/framegraphutils_p.h>
+#include <Kuesa/private/rendertargetpool_p.h>
+#include <Kuesa/private/transienttexture_p.h>
+#include <Kuesa/private/effectsstages_p.h>
 #include "kuesa_p.h"
 
 #include <Qt3DCore/private/qnode_p.h>
@@ -258,6 +262,7 @@ ForwardRenderer::ForwardRenderer(Qt3DCore::QNode *parent)
     , m_defaultViewHolder(new Qt3DRender::QFrameGraphNode())
     , m_viewsHolder(new Qt3DRender::QFrameGraphNode())
     , m_rhiViewResolver(new Qt3DRender::QFrameGraphNode())
+    , m_renderTargetPool(new RenderTargetPool(this))
     , m_debugOverlay(new Qt3DRender::QDebugOverlay)
 {
     m_surfaceSelector->setObjectName(QStringLiteral("ForwardRenderer RenderSurfaceSelector"));
@@ -271,6 +276,10 @@ ForwardRenderer::ForwardRenderer(Qt3DCore::QNode *parent)
             view->setShadowMaps(shadowMaps);
         scheduleFGTreeRebuild();
     });
+    connect(this, &View::lightsChanged, this, [this](const QVector<ShadowCastingLight *> &lights) {
+        for (auto view : m_views)
+            view->setLights(lights);
+    });
     connect(m_clearBuffers, &Qt3DRender::QClearBuffers::clearColorChanged, this, &ForwardRenderer::clearColorChanged);
     connect(m_clearBuffers, &Qt3DRender::QClearBuffers::buffersChanged, this, &ForwardRenderer::clearBuffersChanged);
     connect(m_surfaceSelector, &Qt3DRender::QRenderSurfaceSelector::surfaceChanged, this, &ForwardRenderer::renderSurfaceChanged);
@@ -283,6 +292,7 @@ ForwardRenderer::ForwardRenderer(Qt3DCore::QNode *parent)
     new Qt3DRender::QNoDraw(m_debugOverlay);
     connect(m_debugOverlay, &Qt3DRender::QDebugOverlay::enabledChanged, this, &ForwardRenderer::showDebugOverlayChanged);
 
+    updateShadowCascadeView();
     rebuildFGTree();
 }
 
@@ -339,9 +349,13 @@ void ForwardRenderer::addView(View *view)
     d->registerDestructionHelper(view, &ForwardRenderer::removeView, m_views);
 
     view->setShadowMaps(shadowMaps());
+    view->setLights(lights());
     view->setSurfaceSize(m_surfaceSize);
 
     m_views.push_back(view);
+    // Effects added to the View change the textures it needs from the pool
+    connect(view, &View::frameGraphTreeReconfigured, this, &ForwardRenderer::updateRenderTargetPool);
+    updateShadowCascadeView();
     reconfigureFrameGraph();
 }
 
@@ -351,7 +365,9 @@ void ForwardRenderer::removeView(View *view)
     if (it != std::end(m_views)) {
         auto d = Qt3DCore::QNodePrivate::get(this);
         d->unregisterDestructionHelper(view);
+        disconnect(view, &View::frameGraphTreeReconfigured, this, &ForwardRenderer::updateRenderTargetPool);
         m_views.erase(it);
+        updateShadowCascadeView();
         reconfigureFrameGraph();
     }
 }
@@ -407,34 +423,23 @@ void ForwardRenderer::updateTextureSizes()
  */
 void ForwardRenderer::reconfigureFrameGraph()
 {
-    m_clearBuffers->setParent(Q_NODE_NULLPTR);
-    m_defaultViewHolder->setParent(Q_NODE_NULLPTR);
-    m_viewsHolder->setParent(Q_NODE_NULLPTR);
-    m_debugOverlay->setParent(Q_NODE_NULLPTR);
-    m_rhiViewResolver->setParent(Q_NODE_NULLPTR);
-
-    // Unparent previous View Stages
-    for (Qt3DCore::QNode *c : m_viewsHolder->childNodes())
-        c->setParent(Q_NODE_NULLPTR);
-
-    // Rebuild FG Tree
-    m_clearBuffers->setParent(m_surfaceSelector);
+    // Rebuild FG Tree, only reparenting the nodes whose place changed
+    std::vector<Qt3DCore::QNode *> surfaceChildren{ m_clearBuffers };
 
     if (m_views.empty()) {
         View::reconfigureFrameGraphHelper(m_defaultViewHolder);
-        m_defaultViewHolder->setParent(m_surfaceSelector);
+        surfaceChildren.push_back(m_defaultViewHolder);
     } else {
-        for (View *v : m_views)
-            v->setParent(m_viewsHolder);
-        m_viewsHolder->setParent(m_surfaceSelector);
+        const std::vector<Qt3DCore::QNode *> views(m_views.begin(), m_views.end());
+        const QVector<Qt3DCore::QNode *> children = m_viewsHolder->childNodes();
+        const std::vector<Qt3DCore::QNode *> previousViews(children.begin(), children.end());
+        FrameGraphUtils::reconcileChildren(m_viewsHolder, views, previousViews);
+        surfaceChildren.push_back(m_viewsHolder);
     }
 
     // When using RHI, we need a dedicated pass to render
     // FBO associated with each view back to the main surface
     if (m_fg->m_usesRHI) {
-        for (Qt3DCore::QNode *c : m_rhiViewResolver->childNodes())
-            c->setParent(Q_NODE_NULLPTR);
-
         const std::vector<View *> &views = (m_views.empty()) ? std::vector<View *>({ this }) : m_views;
         const size_t viewCount = views.size();
 
@@ -445,16 +450,24 @@ void ForwardRenderer::reconfigureFrameGraph()
         while (m_viewRenderers.size() < viewCount)
             m_viewRenderers.push_back(new ViewResolver());
 
-        for (size_t i = 0; i < viewCount; ++i) {
-            View *v = views[i];
-            ViewResolver *resolver = m_viewRenderers[i];
-            resolver->setView(v);
-            resolver->setParent(m_rhiViewResolver);
-        }
-        m_rhiViewResolver->setParent(m_surfaceSelector);
+        for (size_t i = 0; i < viewCount; ++i)
+            m_viewRenderers[i]->setView(views[i]);
+
+        const std::vector<Qt3DCore::QNode *> resolvers(m_viewRenderers.begin(), m_viewRenderers.end());
+        FrameGraphUtils::reconcileChildren(m_rhiViewResolver, resolvers, resolvers);
+        surfaceChildren.push_back(m_rhiViewResolver);
     }
 
-    m_debugOverlay->setParent(m_surfaceSelector);
+    surfaceChildren.push_back(m_debugOverlay);
+
+    FrameGraphUtils::reconcileChildren(m_surfaceSelector, surfaceChildren,
+                                       { m_clearBuffers,
+                                         m_defaultViewHolder,
+                                         m_viewsHolder,
+                                         m_rhiViewResolver,
+                                         m_debugOverlay });
+
+    updateRenderTargetPool();
 
     const bool blocked = blockNotifications(true);
     emit frameGraphTreeReconfigured();
@@ -463,11 +476,114 @@ void ForwardRenderer::reconfigureFrameGraph()
     //    dump();
 }
 
+/*!
+ * \internal
+ *
+ * Views and their effects are rendered one after the other, the transient
+ * textures of an effect are only used while the effect is rendered. Effects
+ * which aren't rendered at the same time can therefore share their transient
+ * textures through the pool.
+ *
+ * Effects recreate their transient textures when their mode changes, the
+ * effects and the effects they are made of are therefore watched for added
+ * and removed children to update the pool.
+ */
+void ForwardRenderer::updateRenderTargetPool()
+{
+    m_renderTargetPoolUpdateScheduled = false;
+
+    std::vector<RenderTargetPool::Request> requests;
+    std::vector<QPointer<AbstractPostProcessingEffect>> pooledEffects;
+    int pass = 0;
+
+    const std::vector<View *> &views = (m_views.empty()) ? std::vector<View *>({ this }) : m_views;
+    for (View *view : views) {
+        const EffectsStages *stages[] = { view->m_fxStages, view->m_internalFXStages };
+        for (const EffectsStages *stage : stages) {
+            const std::vector<AbstractPostProcessingEffect *> effects = stage->effects();
+            for (AbstractPostProcessingEffect *fx : effects) {
+                // This includes the textures of the effects it is made of
+                const QList<TransientTexture *> textures = fx->findChildren<TransientTexture *>();
+                for (TransientTexture *texture : textures)
+                    requests.push_back({ texture, pass, pass });
+                ++pass;
+
+                pooledEffects.push_back(fx);
+                const QList<AbstractPostProcessingEffect *> subEffects = fx->findChildren<AbstractPostProcessingEffect *>();
+                pooledEffects.insert(pooledEffects.end(), subEffects.begin(), subEffects.end());
+            }
+        }
+    }
+
+    for (const QPointer<AbstractPostProcessingEffect> &fx : m_pooledEffects) {
+        if (fx && std::find(pooledEffects.begin(), pooledEffects.end(), fx) == pooledEffects.end())
+            fx->removeEventFilter(this);
+    }
+    for (const QPointer<AbstractPostProcessingEffect> &fx : pooledEffects)
+        fx->installEventFilter(this);
+    m_pooledEffects = std::move(pooledEffects);
+
+    m_renderTargetPool->setRequests(requests);
+}
+
+void ForwardRenderer::scheduleRenderTargetPoolUpdate()
+{
+    if (!m_renderTargetPoolUpdateScheduled) {
+        m_renderTargetPoolUpdateScheduled = true;
+        QMetaObject::invokeMethod(this, &ForwardRenderer::updateRenderTargetPool, Qt::QueuedConnection);
+    }
+}
+
+/*!
+ * \internal
+ *
+ * The children of a watched effect are only partially constructed when they
+ * are added, the pool is updated once the effect is done changing.
+ */
+bool ForwardRenderer::eventFilter(QObject *watched, QEvent *event)
+{
+    if (event->type() == QEvent::ChildAdded || event->type() == QEvent::ChildRemoved)
+        scheduleRenderTargetPoolUpdate();
+    return View::eventFilter(watched, event);
+}
+
 const std::vector<View *> &ForwardRenderer::views() const
 {
     return m_views;
 }
 
+/*!
+    Returns the camera the cascades of directional light shadow maps are
+    fitted to: the camera of the first sub view, or the one of the
+    ForwardRenderer when it has no sub views. The other views use a single
+    shadow map covering the whole scene.
+ */
+Qt3DCore::QEntity *ForwardRenderer::shadowCascadeCamera() const
+{
+    return m_shadowCascadeView ? m_shadowCascadeView->camera() : nullptr;
+}
+
+/*!
+ * \internal
+ *
+ * Selects the view whose camera the shadow cascades are fitted to
+ */
+void ForwardRenderer::updateShadowCascadeView()
+{
+    View *cascadeView = m_views.empty() ? this : m_views.front();
+    setShadowCascadesEnabled(cascadeView == this);
+    for (View *view : m_views)
+        view->setShadowCascadesEnabled(view == cascadeView);
+
+    if (cascadeView == m_shadowCascadeView)
+        return;
+
+    disconnect(m_shadowCascadeCameraConnection);
+    m_shadowCascadeView = cascadeView;
+    m_shadowCascadeCameraConnection = connect(cascadeView, &View::cameraChanged, this, &ForwardRenderer::shadowCascadeCameraChanged);
+    emit shadowCascadeCameraChanged(cascadeView->camera());
+}
+
 /*!
  * \internal
  *
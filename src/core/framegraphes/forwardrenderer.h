@@ -67,6 +67,7 @@ class SceneStages;
 class ReflectionStages;
 class View;
 class ViewResolver;
+class RenderTargetPool;
 
 using SceneStagesPtr = QSharedPointer<SceneStages>;
 using ReflectionStagesPtr = QSharedPointer<ReflectionStages>;
@@ -87,6 +88,7 @@ public:
 
     bool showDebugOverlay() const;
     const std::vector<View *> &views() const;
+    Qt3DCore::QEntity *shadowCascadeCamera() const;
 
 public Q_SLOTS:
     void setRenderSurface(QObject *renderSurface);
@@ -103,6 +105,7 @@ Q_SIGNALS:
     void clearBuffersChanged(Qt3DRender::QClearBuffers::BufferType clearBuffers);
     void showDebugOverlayChanged(bool showDebugOverlay);
     void externalRenderTargetSizeChanged(const QSize &renderTargetSize);
+    void shadowCascadeCameraChanged(Qt3DCore::QEntity *camera);
 
 private:
     void handleSurfaceChange();
@@ -110,12 +113,19 @@ private:
     void updateTextureSizes();
 
     void reconfigureFrameGraph() override;
+    void updateRenderTargetPool();
+    void scheduleRenderTargetPoolUpdate();
+    bool eventFilter(QObject *watched, QEvent *event) override;
+    void updateShadowCascadeView();
 
     Qt3DRender::QRenderSurfaceSelector *m_surfaceSelector;
     Qt3DRender::QClearBuffers *m_clearBuffers;
     Qt3DRender::QFrameGraphNode *m_defaultViewHolder;
     Qt3DRender::QFrameGraphNode *m_viewsHolder;
     Qt3DRender::QFrameGraphNode *m_rhiViewResolver;
+    RenderTargetPool *m_renderTargetPool;
+    std::vector<QPointer<AbstractPostProcessingEffect>> m_pooledEffects;
+    bool m_renderTargetPoolUpdateScheduled = false;
 
     QVector<QMetaObject::Connection> m_resizeConnections;
 
@@ -126,6 +136,8 @@ private:
 
     std::vector<View *> m_views;
     std::vector<ViewResolver *> m_viewRenderers;
+    View *m_shadowCascadeView = nullptr;
+    QMetaObject::Connection m_shadowCascadeCameraConnection;
 
     friend class ::tst_ForwardRenderer;
 };
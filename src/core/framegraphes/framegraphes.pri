@@ -34,6 +34,7 @@ SOURCES += \
     $$PWD/framegraphutils.cpp \
     $$PWD/reflectionplane.cpp \
     $$PWD/reflectionstages.cpp \
+    $$PWD/reflectioncamera.cpp \
     $$PWD/shadowmapstages.cpp \
     $$PWD/scenestages.cpp \
     $$PWD/view.cpp \
@@ -41,7 +42,9 @@ SOURCES += \
     $$PWD/zfillrenderstage.cpp \
     $$PWD/opaquerenderstage.cpp \
     $$PWD/transparentrenderstage.cpp \
-    $$PWD/particlerenderstage.cpp
+    $$PWD/particlerenderstage.cpp \
+    $$PWD/rendertargetpool.cpp \
+    $$PWD/transienttexture.cpp
 
 HEADERS += \
     $$PWD/effectsstages_p.h \
@@ -51,6 +54,7 @@ HEADERS += \
     $$PWD/framegraphutils_p.h \
     $$PWD/reflectionplane.h \
     $$PWD/reflectionstages_p.h \
+    $$PWD/reflectioncamera_p.h \
     $$PWD/shadowmapstages_p.h \
     $$PWD/scenestages_p.h \
     $$PWD/view.h \
@@ -58,4 +62,6 @@ HEADERS += \
     $$PWD/zfillrenderstage_p.h \
     $$PWD/opaquerenderstage_p.h \
     $$PWD/transparentrenderstage_p.h \
-    $$PWD/particlerenderstage_p.h
+    $$PWD/particlerenderstage_p.h \
+    $$PWD/rendertargetpool_p.h \
+    $$PWD/transienttexture_p.h
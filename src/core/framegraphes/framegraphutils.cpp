@@ -28,6 +28,7 @@
 
 #include "framegraphutils_p.h"
 #include <private/kuesa_p.h>
+#include <private/kuesa_utils_p.h>
 
 #include <Qt3DRender/qrendertarget.h>
 #include <Qt3DRender/qtexture.h>
@@ -90,6 +91,9 @@ FrameGraphUtils::RenderingFeatures FrameGraphUtils::checkRenderingFeatures()
             features.hasGeometryShader = (ctx.isOpenGLES() ? (format.majorVersion() == 3 && format.minorVersion() >= 2)
                                                            : format.majorVersion() >= 3);
 
+            // The particle compute shaders target GL 4.3
+            features.hasComputeShader = !ctx.isOpenGLES() && (format.majorVersion() > 4 || (format.majorVersion() == 4 && format.minorVersion() >= 3));
+
             // cubeMapArray textures were broken in Qt3D prior to 5.15.2 and in 6.0.0
 #if QT_VERSION >= QT_VERSION_CHECK(5, 15, 2) && QT_VERSION != QT_VERSION_CHECK(6, 0, 0)
             // Since ES 3.2, GL 4.0 or extension
@@ -108,6 +112,7 @@ FrameGraphUtils::RenderingFeatures FrameGraphUtils::checkRenderingFeatures()
         features.hasMultisampledTexture = true;
         features.hasMultisampledFBO = true;
         features.hasCubeMapArrayTextures = true;
+        features.hasComputeShader = true;
 #endif
     }
 
@@ -120,7 +125,8 @@ FrameGraphUtils::RenderingFeatures FrameGraphUtils::checkRenderingFeatures()
                    << "hasMultisampledTexture" << features.hasMultisampledTexture << "\n"
                    << "hasMultisampledFBO" << features.hasMultisampledFBO << "\n"
                    << "hasCubeMapArrayTextures" << features.hasCubeMapArrayTextures << "\n"
-                   << "hasGeometryShaderSupport" << features.hasGeometryShader;
+                   << "hasGeometryShaderSupport" << features.hasGeometryShader << "\n"
+                   << "hasComputeShaderSupport" << features.hasComputeShader;
 
     return features;
 }
@@ -143,6 +149,12 @@ bool FrameGraphUtils::hasGeometryShaderSupport()
     return features.hasGeometryShader;
 }
 
+bool FrameGraphUtils::hasComputeShaderSupport()
+{
+    const FrameGraphUtils::RenderingFeatures features = FrameGraphUtils::checkRenderingFeatures();
+    return features.hasComputeShader;
+}
+
 bool FrameGraphUtils::hasMSAASupport()
 {
     const FrameGraphUtils::RenderingFeatures features = FrameGraphUtils::checkRenderingFeatures();
@@ -259,6 +271,63 @@ Qt3DRender::QAbstractTexture *FrameGraphUtils::findRenderTargetTexture(Qt3DRende
     return attachment == outputs.end() ? nullptr : (*attachment)->texture();
 }
 
+/*!
+ * \internal
+ *
+ * Reparents nodes so that the children of \a parent which belong to \a
+ * managedNodes are exactly \a desiredChildren, in that order. Other children
+ * are left untouched.
+ *
+ * Rather than detaching and reattaching every node, which makes Qt3D destroy
+ * and recreate the backend nodes of the whole subtree, only the managed
+ * children no longer desired are detached, and only the children following
+ * the first position where the current order differs from the desired one are
+ * moved. Appending or removing a node therefore only touches that node.
+ *
+ * Returns the number of nodes which were reparented.
+ */
+int FrameGraphUtils::reconcileChildren(Qt3DCore::QNode *parent,
+                                       const std::vector<Qt3DCore::QNode *> &desiredChildren,
+                                       const std::vector<Qt3DCore::QNode *> &managedNodes)
+{
+    int reparentedCount = 0;
+
+    // 1) Detach managed children that are no longer wanted and gather the
+    // ones we keep in their current order
+    std::vector<Qt3DCore::QNode *> currentChildren;
+    const QObjectList children = parent->children();
+    for (QObject *child : children) {
+        auto *node = qobject_cast<Qt3DCore::QNode *>(child);
+        if (node == nullptr)
+            continue;
+        if (Utils::contains(desiredChildren, node)) {
+            currentChildren.push_back(node);
+        } else if (Utils::contains(managedNodes, node)) {
+            node->setParent(Q_NODE_NULLPTR);
+            ++reparentedCount;
+        }
+    }
+
+    // 2) Find how many children are already in place
+    size_t inPlaceCount = 0;
+    while (inPlaceCount < currentChildren.size() &&
+           inPlaceCount < desiredChildren.size() &&
+           currentChildren[inPlaceCount] == desiredChildren[inPlaceCount])
+        ++inPlaceCount;
+
+    // 3) Move the remaining ones after those
+    for (size_t i = inPlaceCount, m = currentChildren.size(); i < m; ++i) {
+        currentChildren[i]->setParent(Q_NODE_NULLPTR);
+        ++reparentedCount;
+    }
+    for (size_t i = inPlaceCount, m = desiredChildren.size(); i < m; ++i) {
+        desiredChildren[i]->setParent(parent);
+        ++reparentedCount;
+    }
+
+    return reparentedCount;
+}
+
 } // namespace Kuesa
 
 QT_END_NAMESPACE
@@ -43,6 +43,7 @@
 #include <Kuesa/private/kuesa_global_p.h>
 #include <Qt3DRender/QRenderTargetOutput>
 #include <QFlags>
+#include <vector>
 
 QT_BEGIN_NAMESPACE
 
@@ -65,12 +66,14 @@ public:
 
         bool hasCubeMapArrayTextures = false;
         bool hasGeometryShader = false;
+        bool hasComputeShader = false;
     };
 
     static RenderingFeatures checkRenderingFeatures();
     static bool hasHalfFloatRenderable();
     static bool hasCubeMapArrayTextures();
     static bool hasGeometryShaderSupport();
+    static bool hasComputeShaderSupport();
     static bool hasMSAASupport();
 
     enum RenderTargetFlag {
@@ -94,6 +97,10 @@ public:
     static Qt3DRender::QAbstractTexture *findRenderTargetTexture(Qt3DRender::QRenderTarget *target,
                                                                  Qt3DRender::QRenderTargetOutput::AttachmentPoint attachmentPoint);
 
+    static int reconcileChildren(Qt3DCore::QNode *parent,
+                                 const std::vector<Qt3DCore::QNode *> &desiredChildren,
+                                 const std::vector<Qt3DCore::QNode *> &managedNodes);
+
 private:
     static RenderingFeatures m_renderingFeatures;
 };
@@ -27,8 +27,10 @@
 */
 
 #include "particlerenderstage_p.h"
+#include <Kuesa/private/particlesort_p.h>
 
 #include <Qt3DRender/QFilterKey>
+#include <Qt3DRender/QParameter>
 #include <Qt3DRender/QMemoryBarrier>
 #include <Qt3DRender/QDispatchCompute>
 #include <Qt3DRender/QRenderStateSet>
@@ -69,6 +71,7 @@ ParticleRenderStage::ParticleRenderStage(Qt3DRender::QFrameGraphNode *parent)
         addFilterKey(passFilter, QStringLiteral("KuesaComputeStage"), QStringLiteral("ParticleSimulate"));
 
         auto *memoryBarrier = new Qt3DRender::QMemoryBarrier(passFilter);
+        m_simulateBarrier = memoryBarrier;
         memoryBarrier->setWaitOperations(Qt3DRender::QMemoryBarrier::ShaderStorage);
 
         auto *dispatchCompute = new Qt3DRender::QDispatchCompute(memoryBarrier);
@@ -78,11 +81,21 @@ ParticleRenderStage::ParticleRenderStage(Qt3DRender::QFrameGraphNode *parent)
     }
 
     // sort
-    {
+    // The bitonic sort of the sort keys is split in several dispatches, each
+    // stage providing the step of the sorting network it runs through its
+    // parameters. A ParticleMaterial only has the sort passes its padded
+    // particle count needs, the later stages don't match any of its passes.
+    const std::vector<ParticleSort::Pass> sortPasses = ParticleSort::passes();
+    for (size_t i = 0; i < sortPasses.size(); ++i) {
+        const ParticleSort::Pass &pass = sortPasses[i];
         auto passFilter = new Qt3DRender::QRenderPassFilter(this);
         addFilterKey(passFilter, QStringLiteral("KuesaComputeStage"), QStringLiteral("ParticleSort"));
+        addFilterKey(passFilter, QStringLiteral("KuesaParticleSortPass"), int(i));
+        passFilter->addParameter(new Qt3DRender::QParameter(QStringLiteral("sortBlockSize"), pass.blockSize, passFilter));
+        passFilter->addParameter(new Qt3DRender::QParameter(QStringLiteral("sortStride"), pass.stride, passFilter));
 
         auto *memoryBarrier = new Qt3DRender::QMemoryBarrier(passFilter);
+        m_sortBarriers.push_back(memoryBarrier);
         memoryBarrier->setWaitOperations(Qt3DRender::QMemoryBarrier::ShaderStorage);
 
         auto *dispatchCompute = new Qt3DRender::QDispatchCompute(memoryBarrier);
@@ -97,6 +110,7 @@ ParticleRenderStage::ParticleRenderStage(Qt3DRender::QFrameGraphNode *parent)
         addFilterKey(passFilter, QStringLiteral("KuesaDrawStage"), QStringLiteral("ParticleRender"));
 
         auto *memoryBarrier = new Qt3DRender::QMemoryBarrier(passFilter);
+        m_renderBarrier = memoryBarrier;
         memoryBarrier->setWaitOperations(Qt3DRender::QMemoryBarrier::Operations(Qt3DRender::QMemoryBarrier::VertexAttributeArray | Qt3DRender::QMemoryBarrier::ShaderStorage));
 
         auto states = new Qt3DRender::QRenderStateSet(memoryBarrier);
@@ -112,6 +126,33 @@ ParticleRenderStage::ParticleRenderStage(Qt3DRender::QFrameGraphNode *parent)
     }
 }
 
+/*!
+ * \internal
+ *
+ * Without compute support, particles are simulated on the CPU and streamed
+ * to a vertex buffer: there is nothing to synchronize and the memory barriers
+ * would only make OpenGL ES 3.0 drivers complain.
+ */
+void ParticleRenderStage::setMemoryBarriersEnabled(bool enabled)
+{
+    if (m_memoryBarriersEnabled == enabled)
+        return;
+    m_memoryBarriersEnabled = enabled;
+
+    const auto waitOperations = [enabled](Qt3DRender::QMemoryBarrier::Operations operations) {
+        return enabled ? operations : Qt3DRender::QMemoryBarrier::Operations(Qt3DRender::QMemoryBarrier::None);
+    };
+    m_simulateBarrier->setWaitOperations(waitOperations(Qt3DRender::QMemoryBarrier::ShaderStorage));
+    for (Qt3DRender::QMemoryBarrier *sortBarrier : m_sortBarriers)
+        sortBarrier->setWaitOperations(waitOperations(Qt3DRender::QMemoryBarrier::ShaderStorage));
+    m_renderBarrier->setWaitOperations(waitOperations(Qt3DRender::QMemoryBarrier::VertexAttributeArray | Qt3DRender::QMemoryBarrier::ShaderStorage));
+}
+
+bool ParticleRenderStage::memoryBarriersEnabled() const
+{
+    return m_memoryBarriersEnabled;
+}
+
 } // namespace Kuesa
 
 QT_END_NAMESPACE
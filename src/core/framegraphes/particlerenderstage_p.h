@@ -42,6 +42,11 @@
 
 #include <Kuesa/private/kuesa_global_p.h>
 #include "abstractrenderstage_p.h"
+#include <vector>
+
+namespace Qt3DRender {
+class QMemoryBarrier;
+}
 
 QT_BEGIN_NAMESPACE
 
@@ -52,6 +57,15 @@ class KUESA_PRIVATE_EXPORT ParticleRenderStage : public AbstractRenderStage
     Q_OBJECT
 public:
     explicit ParticleRenderStage(Qt3DRender::QFrameGraphNode *parent = nullptr);
+
+    void setMemoryBarriersEnabled(bool enabled);
+    bool memoryBarriersEnabled() const;
+
+private:
+    Qt3DRender::QMemoryBarrier *m_simulateBarrier;
+    std::vector<Qt3DRender::QMemoryBarrier *> m_sortBarriers;
+    Qt3DRender::QMemoryBarrier *m_renderBarrier;
+    bool m_memoryBarriersEnabled = true;
 };
 
 using ParticleRenderStagePtr = QSharedPointer<ParticleRenderStage>;
@@ -0,0 +1,209 @@
+/*
+    reflectioncamera.cpp
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "reflectioncamera_p.h"
+#include <Kuesa/private/kuesa_utils_p.h>
+#include <Qt3DCore/QTransform>
+#include <Qt3DLogic/QFrameAction>
+#include <Qt3DRender/QCamera>
+#include <Qt3DRender/QCameraLens>
+
+QT_BEGIN_NAMESPACE
+
+namespace Kuesa {
+
+namespace {
+
+float sign(float v)
+{
+    if (v > 0.0f)
+        return 1.0f;
+    if (v < 0.0f)
+        return -1.0f;
+    return 0.0f;
+}
+
+// Mirrors the x axis of the view space
+const QMatrix4x4 flipX(-1.0f, 0.0f, 0.0f, 0.0f,
+                       0.0f, 1.0f, 0.0f, 0.0f,
+                       0.0f, 0.0f, 1.0f, 0.0f,
+                       0.0f, 0.0f, 0.0f, 1.0f);
+
+} // namespace
+
+QMatrix4x4 ReflectionCamera::reflectionMatrix(const QVector4D &planeEquation)
+{
+    const float x = planeEquation.x();
+    const float y = planeEquation.y();
+    const float z = planeEquation.z();
+    const float w = planeEquation.w();
+    return QMatrix4x4(1.0f - 2.0f * x * x, -2.0f * x * y, -2.0f * x * z, -2.0f * x * w,
+                      -2.0f * x * y, 1.0f - 2.0f * y * y, -2.0f * y * z, -2.0f * y * w,
+                      -2.0f * x * z, -2.0f * y * z, 1.0f - 2.0f * z * z, -2.0f * z * w,
+                      0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+// See Lengyel, "Oblique View Frustum Depth Projection and Clipping"
+QMatrix4x4 ReflectionCamera::obliqueProjection(const QMatrix4x4 &projectionMatrix, const QVector4D &viewSpacePlane)
+{
+    // Corner of the view frustum opposite to the plane
+    const QVector4D q = projectionMatrix.inverted() * QVector4D(sign(viewSpacePlane.x()), sign(viewSpacePlane.y()), 1.0f, 1.0f);
+    const QVector4D c = viewSpacePlane * (2.0f / QVector4D::dotProduct(viewSpacePlane, q));
+
+    QMatrix4x4 m = projectionMatrix;
+    m.setRow(2, c - m.row(3));
+    return m;
+}
+
+ReflectionCamera::Matrices ReflectionCamera::mirroredMatrices(const QMatrix4x4 &viewMatrix,
+                                                              const QMatrix4x4 &projectionMatrix,
+                                                              const QVector4D &planeEquation)
+{
+    // flipX * flipX is the identity, this doesn't change the clip space
+    // coordinates but makes the view matrix rigid again
+    Matrices m;
+    m.viewMatrix = flipX * viewMatrix * reflectionMatrix(planeEquation);
+    m.projectionMatrix = projectionMatrix * flipX;
+
+    // Keep what lies on the same side of the plane as the eye
+    const QVector3D eye = viewMatrix.inverted().column(3).toVector3D();
+    const float eyeDistance = QVector3D::dotProduct(planeEquation.toVector3D(), eye) + planeEquation.w();
+    if (qFuzzyIsNull(eyeDistance))
+        return m;
+    const QVector4D plane = eyeDistance > 0.0f ? planeEquation : -planeEquation;
+
+    // The mirrored eye lies on the negative side of the plane
+    const QVector4D viewSpacePlane = m.viewMatrix.inverted().transposed() * plane;
+    m.projectionMatrix = obliqueProjection(m.projectionMatrix, viewSpacePlane);
+    return m;
+}
+
+ReflectionCamera::ReflectionCamera(Qt3DCore::QEntity *sourceCamera)
+    : Qt3DCore::QEntity(sourceCamera)
+    , m_sourceCamera(sourceCamera)
+    , m_transform(new Qt3DCore::QTransform)
+    , m_lens(new Qt3DRender::QCameraLens)
+    , m_frameAction(new Qt3DLogic::QFrameAction)
+{
+    m_lens->setProjectionType(Qt3DRender::QCameraLens::CustomProjection);
+    addComponent(m_transform);
+    addComponent(m_lens);
+    addComponent(m_frameAction);
+
+    QObject::connect(m_frameAction, &Qt3DLogic::QFrameAction::triggered,
+                     this, &ReflectionCamera::frameTriggered);
+
+    Qt3DRender::QCamera *camera = qobject_cast<Qt3DRender::QCamera *>(m_sourceCamera);
+    if (camera) {
+        QObject::connect(camera, &Qt3DRender::QCamera::viewMatrixChanged,
+                         this, &ReflectionCamera::update);
+        QObject::connect(camera, &Qt3DRender::QCamera::projectionMatrixChanged,
+                         this, &ReflectionCamera::update);
+    } else if (m_sourceCamera) {
+        Qt3DRender::QCameraLens *lens = componentFromEntity<Qt3DRender::QCameraLens>(m_sourceCamera);
+        Qt3DCore::QTransform *transform = componentFromEntity<Qt3DCore::QTransform>(m_sourceCamera);
+        if (lens)
+            QObject::connect(lens, &Qt3DRender::QCameraLens::projectionMatrixChanged,
+                             this, &ReflectionCamera::update);
+        if (transform)
+            QObject::connect(transform, &Qt3DCore::QTransform::worldMatrixChanged,
+                             this, &ReflectionCamera::update);
+    }
+
+    update();
+}
+
+ReflectionCamera::~ReflectionCamera()
+{
+}
+
+Qt3DCore::QEntity *ReflectionCamera::sourceCamera() const
+{
+    return m_sourceCamera;
+}
+
+void ReflectionCamera::setPlaneEquation(const QVector4D &planeEquation)
+{
+    if (planeEquation == m_planeEquation)
+        return;
+    m_planeEquation = planeEquation;
+    update();
+}
+
+QVector4D ReflectionCamera::planeEquation() const
+{
+    return m_planeEquation;
+}
+
+QMatrix4x4 ReflectionCamera::viewMatrix() const
+{
+    return m_matrices.viewMatrix;
+}
+
+QMatrix4x4 ReflectionCamera::projectionMatrix() const
+{
+    return m_matrices.projectionMatrix;
+}
+
+QMatrix4x4 ReflectionCamera::sourceViewMatrix() const
+{
+    Qt3DRender::QCamera *camera = qobject_cast<Qt3DRender::QCamera *>(m_sourceCamera);
+    if (camera)
+        return camera->viewMatrix();
+    Qt3DCore::QTransform *transform = m_sourceCamera ? componentFromEntity<Qt3DCore::QTransform>(m_sourceCamera) : nullptr;
+    return transform ? transform->worldMatrix().inverted() : QMatrix4x4();
+}
+
+QMatrix4x4 ReflectionCamera::sourceProjectionMatrix() const
+{
+    Qt3DRender::QCamera *camera = qobject_cast<Qt3DRender::QCamera *>(m_sourceCamera);
+    if (camera)
+        return camera->projectionMatrix();
+    Qt3DRender::QCameraLens *lens = m_sourceCamera ? componentFromEntity<Qt3DRender::QCameraLens>(m_sourceCamera) : nullptr;
+    return lens ? lens->projectionMatrix() : QMatrix4x4();
+}
+
+void ReflectionCamera::update()
+{
+    // Without a plane there is nothing to mirror
+    if (m_planeEquation.toVector3D().isNull())
+        return;
+
+    const QMatrix4x4 sourceView = sourceViewMatrix();
+    m_matrices = mirroredMatrices(sourceView, sourceProjectionMatrix(), m_planeEquation);
+
+    // We are parented to the source camera, whose world matrix is the
+    // inverse of its view matrix
+    m_transform->setMatrix(sourceView * m_matrices.viewMatrix.inverted());
+    m_lens->setProjectionMatrix(m_matrices.projectionMatrix);
+    emit changed();
+}
+
+} // namespace Kuesa
+
+QT_END_NAMESPACE
@@ -0,0 +1,133 @@
+/*
+    reflectioncamera_p.h
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef KUESA_REFLECTIONCAMERA_P_H
+#define KUESA_REFLECTIONCAMERA_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Kuesa API.  It exists for the convenience
+// of other Kuesa classes.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <Kuesa/private/kuesa_global_p.h>
+#include <Qt3DCore/QEntity>
+#include <QMatrix4x4>
+#include <QVector4D>
+
+QT_BEGIN_NAMESPACE
+
+namespace Qt3DCore {
+class QTransform;
+}
+
+namespace Qt3DRender {
+class QCameraLens;
+}
+
+namespace Qt3DLogic {
+class QFrameAction;
+}
+
+namespace Kuesa {
+
+// Camera rendering the reflection of the scene through a plane.
+//
+// Mirroring the view matrix, as the shaders do with kuesa_isReflective, can't
+// be expressed by a Qt3D camera whose view matrix is always a rigid lookAt
+// transform. The mirrored view is instead split into a rigid view matrix and a
+// projection flipping the x axis, which results in the same clip space
+// coordinates. This lets Qt3D cull against the mirrored frustum. The near plane
+// of that projection is also replaced by the reflection plane, so that
+// geometry behind the mirror is both culled and clipped.
+//
+// The entity is parented to the camera it mirrors so that it belongs to the
+// scene, its local transform cancels the one of that camera.
+class KUESA_PRIVATE_EXPORT ReflectionCamera : public Qt3DCore::QEntity
+{
+    Q_OBJECT
+public:
+    struct Matrices {
+        QMatrix4x4 viewMatrix;
+        QMatrix4x4 projectionMatrix;
+    };
+
+    // Same matrix as kuesa_reflectedViewMatrix, the plane equation being
+    // (nx, ny, nz, w) for x * nx + y * ny + z * nz + w = 0
+    static QMatrix4x4 reflectionMatrix(const QVector4D &planeEquation);
+
+    // Replaces the near plane of projectionMatrix by viewSpacePlane, the
+    // camera being on the negative side of it
+    static QMatrix4x4 obliqueProjection(const QMatrix4x4 &projectionMatrix, const QVector4D &viewSpacePlane);
+
+    // projectionMatrix * viewMatrix * reflectionMatrix(planeEquation) as a
+    // rigid view matrix and a projection clipped by the plane
+    static Matrices mirroredMatrices(const QMatrix4x4 &viewMatrix,
+                                     const QMatrix4x4 &projectionMatrix,
+                                     const QVector4D &planeEquation);
+
+    explicit ReflectionCamera(Qt3DCore::QEntity *sourceCamera);
+    ~ReflectionCamera();
+
+    Qt3DCore::QEntity *sourceCamera() const;
+
+    void setPlaneEquation(const QVector4D &planeEquation);
+    QVector4D planeEquation() const;
+
+    QMatrix4x4 viewMatrix() const;
+    QMatrix4x4 projectionMatrix() const;
+
+Q_SIGNALS:
+    // Emitted when the mirrored view or projection changed
+    void changed();
+    // Emitted once per frame
+    void frameTriggered();
+
+private:
+    void update();
+    QMatrix4x4 sourceViewMatrix() const;
+    QMatrix4x4 sourceProjectionMatrix() const;
+
+    Qt3DCore::QEntity *m_sourceCamera;
+    Qt3DCore::QTransform *m_transform;
+    Qt3DRender::QCameraLens *m_lens;
+    Qt3DLogic::QFrameAction *m_frameAction;
+    QVector4D m_planeEquation;
+    Matrices m_matrices;
+};
+
+} // namespace Kuesa
+
+QT_END_NAMESPACE
+
+#endif // KUESA_REFLECTIONCAMERA_P_H
@@ -115,6 +115,89 @@ QVector4D ReflectionPlane::equation() const
     return m_equation;
 }
 
+/*!
+    \property Kuesa::ReflectionPlane::updateInterval
+
+    Holds the number of frames between two refreshes of the reflections.
+    Defaults to 1, the reflections being rendered every frame. Reflections of
+    slowly changing scenes can be refreshed less often to save rendering time.
+
+    When set to 0, the reflections are only rendered again when the camera, the
+    plane equation or the layers change, or when requestUpdate() is called.
+
+    \since Kuesa 1.4
+*/
+
+/*!
+    \qmlproperty int Kuesa::ReflectionPlane::updateInterval
+
+    Holds the number of frames between two refreshes of the reflections.
+    Defaults to 1, the reflections being rendered every frame. Reflections of
+    slowly changing scenes can be refreshed less often to save rendering time.
+
+    When set to 0, the reflections are only rendered again when the camera, the
+    plane equation or the layers change, or when requestUpdate() is called.
+
+    \since Kuesa 1.4
+*/
+void ReflectionPlane::setUpdateInterval(int updateInterval)
+{
+    updateInterval = qMax(0, updateInterval);
+    if (updateInterval == m_updateInterval)
+        return;
+    m_updateInterval = updateInterval;
+    emit updateIntervalChanged(updateInterval);
+}
+
+int ReflectionPlane::updateInterval() const
+{
+    return m_updateInterval;
+}
+
+/*!
+    \property Kuesa::ReflectionPlane::resolutionScale
+
+    Holds the scale, between 0 and 1, applied to the View reflectionTextureSize
+    when rendering the reflections. Defaults to 1. Lowering it trades the
+    sharpness of the reflections for fill rate.
+
+    \since Kuesa 1.4
+*/
+
+/*!
+    \qmlproperty real Kuesa::ReflectionPlane::resolutionScale
+
+    Holds the scale, between 0 and 1, applied to the View reflectionTextureSize
+    when rendering the reflections. Defaults to 1. Lowering it trades the
+    sharpness of the reflections for fill rate.
+
+    \since Kuesa 1.4
+*/
+void ReflectionPlane::setResolutionScale(float resolutionScale)
+{
+    resolutionScale = qBound(0.0f, resolutionScale, 1.0f);
+    if (qFuzzyCompare(resolutionScale, m_resolutionScale))
+        return;
+    m_resolutionScale = resolutionScale;
+    emit resolutionScaleChanged(resolutionScale);
+}
+
+float ReflectionPlane::resolutionScale() const
+{
+    return m_resolutionScale;
+}
+
+/*!
+    Requests the reflections to be rendered again on the next frame. This is
+    mostly useful when updateInterval is 0 and the reflected content changed.
+
+    \since Kuesa 1.4
+*/
+void ReflectionPlane::requestUpdate()
+{
+    emit updateRequested();
+}
+
 void ReflectionPlane::addLayer(Qt3DRender::QLayer *layer)
 {
     if (layer) {
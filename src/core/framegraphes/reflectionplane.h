@@ -45,12 +45,22 @@ class KUESASHARED_EXPORT ReflectionPlane : public Qt3DCore::QNode
 {
     Q_OBJECT
     Q_PROPERTY(QVector4D equation READ equation WRITE setEquation NOTIFY equationChanged)
+    Q_PROPERTY(int updateInterval READ updateInterval WRITE setUpdateInterval NOTIFY updateIntervalChanged)
+    Q_PROPERTY(float resolutionScale READ resolutionScale WRITE setResolutionScale NOTIFY resolutionScaleChanged)
 public:
     explicit ReflectionPlane(Qt3DCore::QNode *parent = nullptr);
 
     void setEquation(const QVector4D &equation);
     QVector4D equation() const;
 
+    void setUpdateInterval(int updateInterval);
+    int updateInterval() const;
+
+    void setResolutionScale(float resolutionScale);
+    float resolutionScale() const;
+
+    Q_INVOKABLE void requestUpdate();
+
     void addLayer(Qt3DRender::QLayer *layer);
     void removeLayer(Qt3DRender::QLayer *layer);
     const std::vector<Qt3DRender::QLayer *> &layers() const;
@@ -58,10 +68,15 @@ public:
 Q_SIGNALS:
     void equationChanged(const QVector4D &equation);
     void layersChanged();
+    void updateIntervalChanged(int updateInterval);
+    void resolutionScaleChanged(float resolutionScale);
+    void updateRequested();
 
 private:
     std::vector<Qt3DRender::QLayer *> m_layers;
     QVector4D m_equation;
+    int m_updateInterval = 1;
+    float m_resolutionScale = 1.0f;
 };
 
 } // namespace Kuesa
@@ -29,17 +29,20 @@
 #include "reflectionstages_p.h"
 
 #include <Qt3DRender/qrendertargetselector.h>
+#include <Qt3DRender/qsubtreeenabler.h>
 #include <Qt3DRender/qclearbuffers.h>
 #include <Qt3DRender/qnodraw.h>
 #include <Qt3DRender/qparameter.h>
 #include <Qt3DRender/qcameraselector.h>
 #include <Qt3DRender/qrendertarget.h>
+#include <Qt3DRender/qabstracttexture.h>
 #include <QVector4D>
 
 #include "zfillrenderstage_p.h"
 #include "opaquerenderstage_p.h"
 #include "transparentrenderstage_p.h"
 #include "framegraphutils_p.h"
+#include "reflectioncamera_p.h"
 
 QT_BEGIN_NAMESPACE
 
@@ -51,7 +54,10 @@ ReflectionStages::ReflectionStages(Qt3DRender::QFrameGraphNode *parent)
     // Enable Reflections on the SceneStages
     m_reflectiveEnabledParameter->setValue(true);
 
-    m_renderTargetSelector = new Qt3DRender::QRenderTargetSelector(this);
+    // Disabling a regular FrameGraph node doesn't prevent its children from
+    // being traversed, only a QSubtreeEnabler prunes the whole reflection pass
+    m_subtreeEnabler = new Qt3DRender::QSubtreeEnabler(this);
+    m_renderTargetSelector = new Qt3DRender::QRenderTargetSelector(m_subtreeEnabler);
     auto clearDepth = new Qt3DRender::QClearBuffers(m_renderTargetSelector);
     clearDepth->setBuffers(Qt3DRender::QClearBuffers::ColorDepthBuffer);
     clearDepth->setClearColor(QColor(0, 0, 0, 0));
@@ -63,7 +69,7 @@ ReflectionStages::ReflectionStages(Qt3DRender::QFrameGraphNode *parent)
     // Create Render Target
     Qt3DRender::QRenderTarget *target = FrameGraphUtils::createRenderTarget(FrameGraphUtils::IncludeDepth,
                                                                             m_renderTargetSelector,
-                                                                            { 512, 512 });
+                                                                            m_textureSize);
     m_renderTargetSelector->setTarget(target);
 
     auto colorTexture = reflectionTexture();
@@ -76,26 +82,151 @@ ReflectionStages::ReflectionStages(Qt3DRender::QFrameGraphNode *parent)
 
 ReflectionStages::~ReflectionStages()
 {
+    delete m_reflectionCamera;
 }
 
 void ReflectionStages::reconfigure(const Features features)
 {
-    // We force disable frustum culling
+    // When mirroring is performed by the shaders, the frustum of the camera
+    // doesn't match what gets rendered and we have to disable frustum culling
     Features editedFeatures = features;
-    editedFeatures.setFlag(FrustumCulling, false);
+    if (!m_reflectionCamera)
+        editedFeatures.setFlag(FrustumCulling, false);
 
     // Rebuild FG hierarchy based on set features
     SceneStages::reconfigure(editedFeatures);
 }
 
+void ReflectionStages::setCamera(Qt3DCore::QEntity *camera)
+{
+    if (camera == m_sourceCamera)
+        return;
+    m_sourceCamera = camera;
+    updateReflectionCamera();
+}
+
+Qt3DCore::QEntity *ReflectionStages::camera() const
+{
+    return m_sourceCamera;
+}
+
+void ReflectionStages::setReflectivePlaneEquation(const QVector4D &planeEquation)
+{
+    SceneStages::setReflectivePlaneEquation(planeEquation);
+    if (m_reflectionCamera)
+        m_reflectionCamera->setPlaneEquation(planeEquation);
+    requestUpdate();
+}
+
+void ReflectionStages::updateReflectionCamera()
+{
+    ReflectionCamera *oldCamera = m_reflectionCamera;
+
+    // The reflection camera is a child of the source camera
+    m_reflectionCamera = m_sourceCamera ? new ReflectionCamera(m_sourceCamera) : nullptr;
+    if (m_reflectionCamera) {
+        m_reflectionCamera->setPlaneEquation(reflectivePlaneEquation());
+        QObject::connect(m_reflectionCamera, &ReflectionCamera::changed,
+                         this, &ReflectionStages::requestUpdate);
+        QObject::connect(m_reflectionCamera, &ReflectionCamera::frameTriggered,
+                         this, &ReflectionStages::onFrame);
+        m_cameraSelector->setCamera(m_reflectionCamera);
+    } else {
+        m_cameraSelector->setCamera(m_sourceCamera);
+        // Without any frame tick, render every frame
+        m_subtreeEnabler->setEnabled(true);
+    }
+
+    // The mirrored camera already reflects the scene
+    m_reflectiveEnabledParameter->setValue(m_reflectionCamera.isNull());
+    delete oldCamera;
+
+    reconfigure(SceneFeaturedRenderStageBase::features());
+    requestUpdate();
+}
+
+ReflectionCamera *ReflectionStages::reflectionCamera() const
+{
+    return m_reflectionCamera;
+}
+
 void ReflectionStages::setReflectionTextureSize(const QSize &size)
 {
+    if (size == m_textureSize)
+        return;
+    m_textureSize = size;
+    updateRenderTarget();
+}
+
+QSize ReflectionStages::reflectionTextureSize() const
+{
+    return m_textureSize;
+}
+
+void ReflectionStages::setResolutionScale(float resolutionScale)
+{
+    resolutionScale = qBound(0.0f, resolutionScale, 1.0f);
+    if (qFuzzyCompare(resolutionScale, m_resolutionScale))
+        return;
+    m_resolutionScale = resolutionScale;
+    updateRenderTarget();
+}
+
+float ReflectionStages::resolutionScale() const
+{
+    return m_resolutionScale;
+}
+
+void ReflectionStages::setUpdateInterval(int updateInterval)
+{
+    m_updateInterval = qMax(0, updateInterval);
+}
+
+int ReflectionStages::updateInterval() const
+{
+    return m_updateInterval;
+}
+
+void ReflectionStages::requestUpdate()
+{
+    m_dirty = true;
+}
+
+bool ReflectionStages::isUpdatePending() const
+{
+    return m_dirty;
+}
+
+void ReflectionStages::onFrame()
+{
+    if (m_updateInterval > 0 && ++m_framesSinceUpdate >= m_updateInterval)
+        m_dirty = true;
+
+    // The reflection texture keeps its content while the pass is disabled
+    m_subtreeEnabler->setEnabled(m_dirty);
+    if (m_dirty) {
+        m_dirty = false;
+        m_framesSinceUpdate = 0;
+    }
+}
+
+void ReflectionStages::updateRenderTarget()
+{
+    const QSize size = (QSizeF(m_textureSize) * m_resolutionScale).toSize().expandedTo({ 1, 1 });
+    Qt3DRender::QAbstractTexture *oldTexture = reflectionTexture();
+    if (oldTexture && oldTexture->width() == size.width() && oldTexture->height() == size.height())
+        return;
+
     Qt3DRender::QRenderTarget *oldTarget = m_renderTargetSelector->target();
     Qt3DRender::QRenderTarget *target = FrameGraphUtils::createRenderTarget(FrameGraphUtils::IncludeDepth,
                                                                             m_renderTargetSelector,
                                                                             size);
     m_renderTargetSelector->setTarget(target);
-    emit reflectionTextureChanged(reflectionTexture());
+    auto colorTexture = reflectionTexture();
+    colorTexture->setMagnificationFilter(Qt3DRender::QAbstractTexture::Linear);
+    colorTexture->setMinificationFilter(Qt3DRender::QAbstractTexture::Linear);
+    emit reflectionTextureChanged(colorTexture);
+    requestUpdate();
 
     if (oldTarget)
         oldTarget->deleteLater();
@@ -43,16 +43,22 @@
 #include <Kuesa/private/kuesa_global_p.h>
 #include <Kuesa/private/scenestages_p.h>
 #include <QMetaObject>
+#include <QPointer>
 #include <QSharedPointer>
+#include <QSize>
 
 QT_BEGIN_NAMESPACE
 
 namespace Qt3DRender {
 class QRenderTargetSelector;
+class QSubtreeEnabler;
 class QAbstractTexture;
 } // namespace Qt3DRender
 
 namespace Kuesa {
+
+class ReflectionCamera;
+
 class KUESA_PRIVATE_EXPORT ReflectionStages : public SceneStages
 {
     Q_OBJECT
@@ -60,17 +66,47 @@ public:
     explicit ReflectionStages(Qt3DRender::QFrameGraphNode *parent = nullptr);
     ~ReflectionStages();
 
+    // Hide the SceneStages ones to render through a mirrored camera
+    void setCamera(Qt3DCore::QEntity *camera);
+    Qt3DCore::QEntity *camera() const;
+    void setReflectivePlaneEquation(const QVector4D &planeEquation);
+
     void setReflectionTextureSize(const QSize &size);
+    QSize reflectionTextureSize() const;
+
+    void setResolutionScale(float resolutionScale);
+    float resolutionScale() const;
+
+    // Number of frames between two refreshes of the reflection texture,
+    // 0 meaning it is only refreshed when the camera, the plane or the scene
+    // layers change or when requestUpdate is called
+    void setUpdateInterval(int updateInterval);
+    int updateInterval() const;
+
+    void requestUpdate();
+    bool isUpdatePending() const;
 
     Qt3DRender::QAbstractTexture *reflectionTexture() const;
+    ReflectionCamera *reflectionCamera() const;
 
 signals:
     void reflectionTextureChanged(Qt3DRender::QAbstractTexture *reflectionTexture);
 
 private:
     void reconfigure(const Features features) override;
+    void updateReflectionCamera();
+    void updateRenderTarget();
+    void onFrame();
 
+    Qt3DRender::QSubtreeEnabler *m_subtreeEnabler = nullptr;
     Qt3DRender::QRenderTargetSelector *m_renderTargetSelector = nullptr;
+    QPointer<Qt3DCore::QEntity> m_sourceCamera;
+    QPointer<ReflectionCamera> m_reflectionCamera;
+    QSize m_textureSize = { 512, 512 };
+    float m_resolutionScale = 1.0f;
+    int m_updateInterval = 1;
+    int m_framesSinceUpdate = 0;
+    bool m_dirty = true;
 };
 using ReflectionStagesPtr = QSharedPointer<ReflectionStages>;
 
@@ -0,0 +1,322 @@
+/*
+    rendertargetpool.cpp
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "rendertargetpool_p.h"
+#include "transienttexture_p.h"
+
+#include <Qt3DRender/qtexture.h>
+#include <algorithm>
+#include <iterator>
+#include <numeric>
+
+QT_BEGIN_NAMESPACE
+
+namespace Kuesa {
+
+namespace {
+
+int bytesPerTexel(Qt3DRender::QAbstractTexture::TextureFormat format)
+{
+    switch (format) {
+    case Qt3DRender::QAbstractTexture::R8_UNorm:
+    case Qt3DRender::QAbstractTexture::R8_SNorm:
+    case Qt3DRender::QAbstractTexture::R8U:
+    case Qt3DRender::QAbstractTexture::R8I:
+        return 1;
+    case Qt3DRender::QAbstractTexture::RG8_UNorm:
+    case Qt3DRender::QAbstractTexture::RG8_SNorm:
+    case Qt3DRender::QAbstractTexture::R16_UNorm:
+    case Qt3DRender::QAbstractTexture::R16F:
+    case Qt3DRender::QAbstractTexture::D16:
+        return 2;
+    case Qt3DRender::QAbstractTexture::RG16F:
+    case Qt3DRender::QAbstractTexture::R32F:
+    case Qt3DRender::QAbstractTexture::RGB10A2:
+    case Qt3DRender::QAbstractTexture::R11G11B10F:
+    case Qt3DRender::QAbstractTexture::D24:
+    case Qt3DRender::QAbstractTexture::D24S8:
+    case Qt3DRender::QAbstractTexture::D32:
+    case Qt3DRender::QAbstractTexture::D32F:
+        return 4;
+    case Qt3DRender::QAbstractTexture::RGB16F:
+    case Qt3DRender::QAbstractTexture::RGBA16F:
+    case Qt3DRender::QAbstractTexture::RG32F:
+    case Qt3DRender::QAbstractTexture::D32FS8X24:
+        return 8;
+    case Qt3DRender::QAbstractTexture::RGB32F:
+    case Qt3DRender::QAbstractTexture::RGBA32F:
+        return 16;
+    default:
+        // RGB8 is padded to 32 bits by the drivers
+        return 4;
+    }
+}
+
+} // namespace
+
+/*!
+ * \class Kuesa::RenderTargetPool
+ * \internal
+ *
+ * \brief Provides the transient textures of the post processing effects
+ * rendered by a ForwardRenderer.
+ *
+ * The frame graph of a ForwardRenderer renders its Views one after the other
+ * and the effects of a View one after the other. The intermediate textures of
+ * an effect are therefore only used for a given range of passes of the frame.
+ * Each request gives the range of passes during which its TransientTexture is
+ * used and requests whose ranges don't overlap, with identical size and
+ * format, are given the same texture.
+ *
+ * The render targets of the Views themselves are not pooled: they hold the
+ * rendered View until it is blitted or resolved and are never transient.
+ *
+ * The memory footprint of the textures allocated by the pool is computed
+ * from their description, so that it can be checked without a GPU.
+ */
+RenderTargetPool::RenderTargetPool(Qt3DCore::QNode *parent)
+    : Qt3DCore::QNode(parent)
+{
+}
+
+RenderTargetPool::~RenderTargetPool()
+{
+    // Our textures are about to be destroyed with us
+    for (const PooledRequest &request : m_requests) {
+        if (request.texture)
+            request.texture->setPooledTexture(nullptr);
+    }
+}
+
+/*!
+ * Replaces the requests of the pool with \a requests and updates the
+ * textures they are bound to.
+ */
+void RenderTargetPool::setRequests(const std::vector<Request> &requests)
+{
+    // Return the textures which are no longer requested to their owners
+    for (const PooledRequest &previous : m_requests) {
+        if (!previous.texture)
+            continue;
+        const bool stillRequested = std::find_if(requests.begin(), requests.end(),
+                                                 [&previous](const Request &request) {
+                                                     return request.texture == previous.texture;
+                                                 }) != requests.end();
+        if (!stillRequested) {
+            QObject::disconnect(previous.texture, &TransientTexture::descriptionChanged,
+                                this, &RenderTargetPool::scheduleUpdate);
+            previous.texture->setPooledTexture(nullptr);
+        }
+    }
+
+    m_requests.clear();
+    m_requests.reserve(requests.size());
+    for (const Request &request : requests) {
+        Q_ASSERT(request.texture);
+        Q_ASSERT(request.firstUse <= request.lastUse);
+        QObject::connect(request.texture, &TransientTexture::descriptionChanged,
+                         this, &RenderTargetPool::scheduleUpdate, Qt::UniqueConnection);
+        m_requests.push_back({ request.texture, request.firstUse, request.lastUse, 0 });
+    }
+
+    update();
+}
+
+/*!
+ * Assigns a texture to each request, reusing the textures we already
+ * have as much as possible.
+ */
+void RenderTargetPool::update()
+{
+    m_updateScheduled = false;
+
+    m_requests.erase(std::remove_if(m_requests.begin(), m_requests.end(),
+                                    [](const PooledRequest &request) { return request.texture.isNull(); }),
+                     m_requests.end());
+
+    std::vector<Allocation> allocations;
+    allocations.reserve(m_requests.size());
+    for (const PooledRequest &request : m_requests) {
+        TextureDescription description;
+        description.size = request.texture->size();
+        description.format = request.texture->format();
+        allocations.push_back({ description, request.firstUse, request.lastUse });
+    }
+
+    std::vector<TextureDescription> descriptions;
+    const std::vector<size_t> textureIndices = assignTextures(allocations, descriptions);
+
+    // Reuse the textures matching the new descriptions
+    std::vector<Qt3DRender::QAbstractTexture *> previousTextures = std::move(m_textures);
+    std::vector<TextureDescription> previousDescriptions = std::move(m_descriptions);
+    m_textures.clear();
+    m_descriptions = descriptions;
+    for (const TextureDescription &description : descriptions) {
+        const auto it = std::find(previousDescriptions.begin(), previousDescriptions.end(), description);
+        if (it != previousDescriptions.end()) {
+            const auto previousIndex = std::distance(previousDescriptions.begin(), it);
+            m_textures.push_back(previousTextures[previousIndex]);
+            previousTextures.erase(previousTextures.begin() + previousIndex);
+            previousDescriptions.erase(it);
+            continue;
+        }
+
+        auto texture = new Qt3DRender::QTexture2D(this);
+        texture->setFormat(description.format);
+        texture->setGenerateMipMaps(false);
+        texture->setSize(description.size.width(), description.size.height());
+        m_textures.push_back(texture);
+    }
+
+    for (size_t i = 0, m = m_requests.size(); i < m; ++i) {
+        PooledRequest &request = m_requests[i];
+        request.textureIndex = textureIndices[i];
+        request.texture->setPooledTexture(m_textures[request.textureIndex]);
+    }
+
+    // Nothing references the remaining textures anymore
+    qDeleteAll(previousTextures);
+
+    const qint64 footprint = std::accumulate(m_descriptions.begin(), m_descriptions.end(), qint64(0),
+                                             [](qint64 sum, const TextureDescription &description) {
+                                                 return sum + textureMemorySize(description);
+                                             });
+    if (footprint != m_memoryFootprint) {
+        m_memoryFootprint = footprint;
+        emit memoryFootprintChanged(footprint);
+    }
+}
+
+size_t RenderTargetPool::requestCount() const
+{
+    return m_requests.size();
+}
+
+/*!
+ * Returns the number of textures allocated by the pool.
+ */
+size_t RenderTargetPool::textureCount() const
+{
+    return m_textures.size();
+}
+
+/*!
+ * Returns the amount of video memory in bytes used by the textures of the
+ * pool.
+ */
+qint64 RenderTargetPool::memoryFootprint() const
+{
+    return m_memoryFootprint;
+}
+
+/*!
+ * Returns the amount of video memory in bytes that would be used if each
+ * request had its own texture.
+ */
+qint64 RenderTargetPool::unaliasedMemoryFootprint() const
+{
+    qint64 footprint = 0;
+    for (const PooledRequest &request : m_requests) {
+        if (request.texture)
+            footprint += textureMemorySize({ request.texture->size(), request.texture->format() });
+    }
+    return footprint;
+}
+
+Qt3DRender::QAbstractTexture *RenderTargetPool::textureForRequest(size_t requestIndex) const
+{
+    if (requestIndex >= m_requests.size())
+        return nullptr;
+    return m_textures[m_requests[requestIndex].textureIndex];
+}
+
+/*!
+ * Returns the size in bytes of a texture matching \a description.
+ */
+qint64 RenderTargetPool::textureMemorySize(const TextureDescription &description)
+{
+    return qint64(description.size.width()) * qint64(description.size.height()) *
+            bytesPerTexel(description.format);
+}
+
+/*!
+ * Assigns a texture to each of the \a allocations and returns the index of
+ * that texture. \a textures is filled with the description of each texture.
+ *
+ * Allocations are processed in the order of their first use and are given
+ * the first texture with the same description which is no longer in use.
+ * This greedy allocation of intervals is optimal: the number of textures of a
+ * given description is the largest number of allocations using that
+ * description at the same time.
+ */
+std::vector<size_t> RenderTargetPool::assignTextures(const std::vector<Allocation> &allocations,
+                                                     std::vector<TextureDescription> &textures)
+{
+    std::vector<size_t> order(allocations.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&allocations](size_t a, size_t b) {
+        return allocations[a].firstUse < allocations[b].firstUse;
+    });
+
+    textures.clear();
+    std::vector<int> textureLastUses;
+    std::vector<size_t> textureIndices(allocations.size(), 0);
+
+    for (const size_t allocationIndex : order) {
+        const Allocation &allocation = allocations[allocationIndex];
+        size_t textureIndex = 0;
+        const size_t textureCount = textures.size();
+        for (; textureIndex < textureCount; ++textureIndex) {
+            if (textures[textureIndex] == allocation.description &&
+                textureLastUses[textureIndex] < allocation.firstUse)
+                break;
+        }
+
+        if (textureIndex == textureCount) {
+            textures.push_back(allocation.description);
+            textureLastUses.push_back(allocation.lastUse);
+        } else {
+            textureLastUses[textureIndex] = allocation.lastUse;
+        }
+        textureIndices[allocationIndex] = textureIndex;
+    }
+
+    return textureIndices;
+}
+
+void RenderTargetPool::scheduleUpdate()
+{
+    if (!m_updateScheduled) {
+        m_updateScheduled = true;
+        QMetaObject::invokeMethod(this, &RenderTargetPool::update, Qt::QueuedConnection);
+    }
+}
+
+} // namespace Kuesa
+
+QT_END_NAMESPACE
@@ -0,0 +1,127 @@
+/*
+    rendertargetpool_p.h
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef KUESA_RENDERTARGETPOOL_P_H
+#define KUESA_RENDERTARGETPOOL_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Kuesa API.  It exists for the convenience
+// of other Kuesa classes.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <Kuesa/private/kuesa_global_p.h>
+#include <Qt3DCore/qnode.h>
+#include <Qt3DRender/qabstracttexture.h>
+#include <QPointer>
+#include <QSize>
+#include <vector>
+
+QT_BEGIN_NAMESPACE
+
+namespace Kuesa {
+
+class TransientTexture;
+
+class KUESA_PRIVATE_EXPORT RenderTargetPool : public Qt3DCore::QNode
+{
+    Q_OBJECT
+public:
+    struct TextureDescription {
+        QSize size;
+        Qt3DRender::QAbstractTexture::TextureFormat format = Qt3DRender::QAbstractTexture::RGBA8_UNorm;
+
+        bool operator==(const TextureDescription &other) const
+        {
+            return size == other.size && format == other.format;
+        }
+        bool operator!=(const TextureDescription &other) const
+        {
+            return !(*this == other);
+        }
+    };
+
+    // Texture used by the passes firstUse to lastUse included
+    struct Allocation {
+        TextureDescription description;
+        int firstUse = 0;
+        int lastUse = 0;
+    };
+
+    struct Request {
+        TransientTexture *texture = nullptr;
+        int firstUse = 0;
+        int lastUse = 0;
+    };
+
+    explicit RenderTargetPool(Qt3DCore::QNode *parent = nullptr);
+    ~RenderTargetPool();
+
+    void setRequests(const std::vector<Request> &requests);
+    void update();
+
+    size_t requestCount() const;
+    size_t textureCount() const;
+    qint64 memoryFootprint() const;
+    qint64 unaliasedMemoryFootprint() const;
+    Qt3DRender::QAbstractTexture *textureForRequest(size_t requestIndex) const;
+
+    static qint64 textureMemorySize(const TextureDescription &description);
+    static std::vector<size_t> assignTextures(const std::vector<Allocation> &allocations,
+                                              std::vector<TextureDescription> &textures);
+
+Q_SIGNALS:
+    void memoryFootprintChanged(qint64 memoryFootprint);
+
+private:
+    void scheduleUpdate();
+
+    struct PooledRequest {
+        QPointer<TransientTexture> texture;
+        int firstUse = 0;
+        int lastUse = 0;
+        size_t textureIndex = 0;
+    };
+
+    std::vector<PooledRequest> m_requests;
+    std::vector<TextureDescription> m_descriptions;
+    std::vector<Qt3DRender::QAbstractTexture *> m_textures;
+    qint64 m_memoryFootprint = 0;
+    bool m_updateScheduled = false;
+};
+
+} // namespace Kuesa
+
+QT_END_NAMESPACE
+
+#endif // KUESA_RENDERTARGETPOOL_P_H
@@ -45,8 +45,10 @@
 #include "opaquerenderstage_p.h"
 #include "transparentrenderstage_p.h"
 #include <Kuesa/private/empty2dtexture_p.h>
+#include <Kuesa/private/clusteredlights_p.h>
 
 #include <private/particlerenderstage_p.h>
+#include <private/framegraphutils_p.h>
 #include <Qt3DCore/private/qnode_p.h>
 
 QT_BEGIN_NAMESPACE
@@ -94,6 +96,11 @@ bool SceneFeaturedRenderStageBase::cubeShadowMap() const
     return m_features & CubeShadowMap;
 }
 
+bool SceneFeaturedRenderStageBase::clusteredLighting() const
+{
+    return m_features & ClusteredLighting;
+}
+
 SceneFeaturedRenderStageBase::Features SceneFeaturedRenderStageBase::features() const
 {
     return m_features;
@@ -147,6 +154,14 @@ void SceneFeaturedRenderStageBase::setCubeShadowMap(bool cubeShadowMap)
     reconfigure(m_features);
 }
 
+void SceneFeaturedRenderStageBase::setClusteredLighting(bool clusteredLighting)
+{
+    if (clusteredLighting == bool(m_features & ClusteredLighting))
+        return;
+    m_features.setFlag(ClusteredLighting, clusteredLighting);
+    reconfigure(m_features);
+}
+
 /*!
     \internal
 
@@ -268,14 +283,6 @@ void ScenePass::reconfigure(const Features features)
     const bool useFrustumCulling = bool(features & FrustumCulling);
     const bool cubeShadowMap = bool(features & CubeShadowMap);
 
-    // Unparent all nodes
-    m_nonSkinnedStage->setParent(Q_NODE_NULLPTR);
-    m_skinnedStage->setParent(Q_NODE_NULLPTR);
-
-    m_nonSkinnedTechniqueFilter->setParent(Q_NODE_NULLPTR);
-    m_skinnedTechniqueFilter->setParent(Q_NODE_NULLPTR);
-    m_frustumCulling->setParent(Q_NODE_NULLPTR);
-
     // Set Features on sub stages
     switch (m_type) {
     case Transparent: {
@@ -305,22 +312,35 @@ void ScenePass::reconfigure(const Features features)
         break;
     }
 
-    // Reparent appropriately
-    m_nonSkinnedTechniqueFilter->setParent(this);
-    if (useFrustumCulling) {
-        m_frustumCulling->setParent(m_nonSkinnedTechniqueFilter);
-        m_nonSkinnedStage->setParent(m_frustumCulling);
-    } else {
-        m_nonSkinnedStage->setParent(m_nonSkinnedTechniqueFilter);
-    }
+    // Reparent appropriately, leaving the nodes already in place untouched
+    const std::vector<Qt3DCore::QNode *> managedNodes{
+        m_nonSkinnedTechniqueFilter,
+        m_skinnedTechniqueFilter,
+        m_frustumCulling,
+        m_nonSkinnedStage,
+        m_skinnedStage
+    };
 
     // Skinned Meshes are not checked against frustum culling as the skinning
     // could actually make them still be in the view frustum even if their
     // transform technically makes them out of sight
-    if (useSkinning) {
-        m_skinnedTechniqueFilter->setParent(this);
-        m_skinnedStage->setParent(m_skinnedTechniqueFilter);
+    std::vector<Qt3DCore::QNode *> filters{ m_nonSkinnedTechniqueFilter };
+    if (useSkinning)
+        filters.push_back(m_skinnedTechniqueFilter);
+    FrameGraphUtils::reconcileChildren(this, filters, managedNodes);
+
+    if (useFrustumCulling) {
+        FrameGraphUtils::reconcileChildren(m_nonSkinnedTechniqueFilter, { m_frustumCulling }, managedNodes);
+        FrameGraphUtils::reconcileChildren(m_frustumCulling, { m_nonSkinnedStage }, managedNodes);
+    } else {
+        FrameGraphUtils::reconcileChildren(m_frustumCulling, {}, managedNodes);
+        FrameGraphUtils::reconcileChildren(m_nonSkinnedTechniqueFilter, { m_nonSkinnedStage }, managedNodes);
     }
+
+    if (useSkinning)
+        FrameGraphUtils::reconcileChildren(m_skinnedTechniqueFilter, { m_skinnedStage }, managedNodes);
+    else
+        FrameGraphUtils::reconcileChildren(m_skinnedTechniqueFilter, {}, managedNodes);
 }
 
 /*!
@@ -364,6 +384,19 @@ SceneStages::SceneStages(Qt3DRender::QFrameGraphNode *parent)
     m_opaqueStage->addParameter(m_reflectivePlaneTextureParameter);
     m_transparentStage->addParameter(m_reflectivePlaneTextureParameter);
 
+    // Only the shading passes sample shadow maps
+    m_shadowCascadesDisabledParameter = new Qt3DRender::QParameter(QStringLiteral("kuesa_shadowCascadesDisabled"), QVariant(false), this);
+    m_opaqueStage->addParameter(m_shadowCascadesDisabledParameter);
+    m_transparentStage->addParameter(m_shadowCascadesDisabledParameter);
+
+    // Clustered light buffers, only the shading passes evaluate lights
+    m_clusteredLights = new ClusteredLights(this);
+    const auto clusterParameters = m_clusteredLights->parameters();
+    for (Qt3DRender::QParameter *parameter : clusterParameters) {
+        m_opaqueStage->addParameter(parameter);
+        m_transparentStage->addParameter(parameter);
+    }
+
     // Force initial configuration
     reconfigure(SceneFeaturedRenderStageBase::features());
 }
@@ -384,11 +417,7 @@ void SceneStages::reconfigure(const Features features)
     const bool useFrustumCulling = bool(features & FrustumCulling);
     const bool useParticles = bool(features & Particles);
 
-    // Unparent each stages to make sure they are added in correct order
-    m_zFillStage->setParent(Q_NODE_NULLPTR);
-    m_opaqueStage->setParent(Q_NODE_NULLPTR);
-    m_transparentStage->setParent(Q_NODE_NULLPTR);
-    m_particleRenderStage->setParent(Q_NODE_NULLPTR);
+    m_clusteredLights->setEnabled(bool(features & ClusteredLighting));
 
     // Set features on stages which will update accordingly
     const ScenePassPtr passStages[]{ m_zFillStage, m_opaqueStage, m_transparentStage };
@@ -399,27 +428,38 @@ void SceneStages::reconfigure(const Features features)
         passStage->setBackToFrontSorting(sortBackToFront);
     }
 
-    // Find stages parent root
-    Qt3DRender::QFrameGraphNode *stageRoot = nullptr;
+    // Stages based on features, in rendering order
+    std::vector<Qt3DCore::QNode *> stages;
+    if (useZFilling)
+        stages.push_back(m_zFillStage.data());
+    stages.push_back(m_opaqueStage.data());
+    stages.push_back(m_transparentStage.data());
+    if (useParticles) {
+        // Without compute, particles are simulated on the CPU
+        m_particleRenderStage->setMemoryBarriersEnabled(FrameGraphUtils::hasComputeShaderSupport());
+        stages.push_back(m_particleRenderStage.data());
+    }
+
+    const std::vector<Qt3DCore::QNode *> managedNodes{
+        m_layerFilter,
+        m_zFillStage.data(),
+        m_opaqueStage.data(),
+        m_transparentStage.data(),
+        m_particleRenderStage.data()
+    };
+
+    // Only reparent the stages whose place changed
     if (hasLayers) {
         // If we have layers, then we parent the layer filter
         // and add the stages as children of it
-        stageRoot = m_layerFilter;
-        m_layerFilter->setParent(m_cameraSelector);
+        FrameGraphUtils::reconcileChildren(m_cameraSelector, { m_layerFilter }, managedNodes);
+        FrameGraphUtils::reconcileChildren(m_layerFilter, stages, managedNodes);
     } else {
         // Otherwise, we unparent the layer filter and
         // parent the stages to the cameraSelector
-        stageRoot = m_cameraSelector;
-        m_layerFilter->setParent(Q_NODE_NULLPTR);
+        FrameGraphUtils::reconcileChildren(m_layerFilter, {}, managedNodes);
+        FrameGraphUtils::reconcileChildren(m_cameraSelector, stages, managedNodes);
     }
-
-    // Reparent stages based on features
-    if (useZFilling)
-        m_zFillStage->setParent(stageRoot);
-    m_opaqueStage->setParent(stageRoot);
-    m_transparentStage->setParent(stageRoot);
-    if (useParticles)
-        m_particleRenderStage->setParent(stageRoot);
 }
 
 void SceneStages::addLayer(Qt3DRender::QLayer *layer)
@@ -467,6 +507,7 @@ Qt3DRender::QCullFace::CullingMode SceneStages::cullingMode() const
 void SceneStages::setCamera(Qt3DCore::QEntity *camera)
 {
     m_cameraSelector->setCamera(camera);
+    m_clusteredLights->setCamera(camera);
 }
 
 Qt3DCore::QEntity *SceneStages::camera() const
@@ -508,4 +549,31 @@ Qt3DRender::QAbstractTexture *SceneStages::reflectivePlaneTexture() const
     return m_reflectivePlaneTextureParameter->value().value<Qt3DRender::QAbstractTexture *>();
 }
 
+void SceneStages::setLights(const QVector<ShadowCastingLight *> &lights)
+{
+    m_clusteredLights->setLights(lights);
+}
+
+ClusteredLights *SceneStages::clusteredLights() const
+{
+    return m_clusteredLights;
+}
+
+/*!
+    \internal
+
+    Sets whether the shading passes use the cascades of directional light
+    shadow maps. Views whose camera the cascades aren't fitted to sample the
+    whole scene shadow map instead.
+ */
+void SceneStages::setShadowCascadesEnabled(bool shadowCascadesEnabled)
+{
+    m_shadowCascadesDisabledParameter->setValue(!shadowCascadesEnabled);
+}
+
+bool SceneStages::shadowCascadesEnabled() const
+{
+    return !m_shadowCascadesDisabledParameter->value().toBool();
+}
+
 QT_END_NAMESPACE
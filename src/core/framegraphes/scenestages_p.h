@@ -72,6 +72,8 @@ class QAbstractTexture;
 namespace Kuesa {
 
 class AbstractRenderStage;
+class ClusteredLights;
+class ShadowCastingLight;
 class OpaqueRenderStage;
 class TransparentRenderStage;
 class ZFillRenderStage;
@@ -92,6 +94,7 @@ public:
         ZFilling = (1 << 3),
         Particles = (1 << 4),
         CubeShadowMap = (1 << 5),
+        ClusteredLighting = (1 << 6),
     };
     Q_DECLARE_FLAGS(Features, Feature)
 
@@ -115,6 +118,9 @@ public:
     void setCubeShadowMap(bool cubeShadowMap);
     bool cubeShadowMap() const;
 
+    void setClusteredLighting(bool clusteredLighting);
+    bool clusteredLighting() const;
+
 private:
     Features m_features;
 
@@ -184,6 +190,12 @@ public:
     void setReflectivePlaneTexture(Qt3DRender::QAbstractTexture *t);
     Qt3DRender::QAbstractTexture *reflectivePlaneTexture() const;
 
+    void setLights(const QVector<ShadowCastingLight *> &lights);
+    ClusteredLights *clusteredLights() const;
+
+    void setShadowCascadesEnabled(bool shadowCascadesEnabled);
+    bool shadowCascadesEnabled() const;
+
 public Q_SLOTS:
     void addLayer(Qt3DRender::QLayer *layer);
     void removeLayer(Qt3DRender::QLayer *layer);
@@ -203,6 +215,8 @@ protected:
     Qt3DRender::QParameter *m_reflectivePlaneParameter = nullptr;
     Qt3DRender::QParameter *m_reflectivePlaneTextureParameter = nullptr;
     Qt3DRender::QAbstractTexture *m_defaultReflectivePlaneTexture = nullptr;
+    Qt3DRender::QParameter *m_shadowCascadesDisabledParameter = nullptr;
+    ClusteredLights *m_clusteredLights = nullptr;
 };
 using SceneStagesPtr = QSharedPointer<SceneStages>;
 
@@ -41,6 +41,10 @@
 #include <Qt3DRender/qclearbuffers.h>
 #include <Qt3DRender/qrendertarget.h>
 #include <Qt3DRender/qrendertargetselector.h>
+#include <Qt3DRender/qsubtreeenabler.h>
+#include <Qt3DRender/qviewport.h>
+
+#include <algorithm>
 
 QT_BEGIN_NAMESPACE
 
@@ -60,6 +64,8 @@ ShadowMapRenderPass::ShadowMapRenderPass(Qt3DRender::QFrameGraphNode *parent)
     , m_shadowMapRenderPass(new ScenePass(ScenePass::ShadowMap))
     , m_lightCamera(new Qt3DRender::QCamera(this))
     , m_cameraSelector(new Qt3DRender::QCameraSelector)
+    , m_viewport(new Qt3DRender::QViewport)
+    , m_subtreeEnabler(new Qt3DRender::QSubtreeEnabler)
     , m_depthOutput(new Qt3DRender::QRenderTargetOutput)
 {
     setObjectName(QStringLiteral("Shadow Map"));
@@ -87,7 +93,9 @@ ShadowMapRenderPass::ShadowMapRenderPass(Qt3DRender::QFrameGraphNode *parent)
     sceneTargetSelector->setParent(this);
     m_clearBuffers->setParent(sceneTargetSelector);
     noDrawClear->setParent(m_clearBuffers);
-    m_cameraSelector->setParent(sceneTargetSelector);
+    m_viewport->setParent(sceneTargetSelector);
+    m_subtreeEnabler->setParent(m_viewport);
+    m_cameraSelector->setParent(m_subtreeEnabler);
     m_shadowMapRenderPass->setParent(m_cameraSelector);
 }
 
@@ -103,6 +111,11 @@ void ShadowMapRenderPass::setSkinning(bool skinning)
     m_shadowMapRenderPass->setSkinning(skinning);
 }
 
+void ShadowMapRenderPass::setClearDepth(bool clearDepth)
+{
+    m_clearBuffers->setEnabled(clearDepth);
+}
+
 void ShadowMapRenderPass::addParameter(Qt3DRender::QParameter *parameter)
 {
     m_shadowMapRenderPass->addParameter(parameter);
@@ -113,16 +126,20 @@ void ShadowMapRenderPass::removeParameter(Qt3DRender::QParameter *parameter)
     m_shadowMapRenderPass->removeParameter(parameter);
 }
 
-void ShadowMapRenderPass::setShadowMap(ShadowMapPtr shadowMap)
+void ShadowMapRenderPass::setShadowMap(ShadowMapPtr shadowMap, int cascade)
 {
-    if (m_shadowMap == shadowMap)
+    if (m_shadowMap == shadowMap && m_cascade == cascade)
         return;
 
-    if (m_shadowMap)
+    if (m_shadowMap) {
         disconnect(m_shadowMap.data(), &ShadowMap::lightViewProjectionChanged, this, &ShadowMapRenderPass::updateLightViewProjection);
+        disconnect(m_shadowMap.data(), &ShadowMap::viewportRectChanged, this, &ShadowMapRenderPass::updateViewport);
+    }
     connect(shadowMap.data(), &ShadowMap::lightViewProjectionChanged, this, &ShadowMapRenderPass::updateLightViewProjection);
+    connect(shadowMap.data(), &ShadowMap::viewportRectChanged, this, &ShadowMapRenderPass::updateViewport);
 
     m_shadowMap = shadowMap;
+    m_cascade = cascade;
     m_shadowMapRenderPass->setCubeShadowMap(m_shadowMap->usesCubeMap());
 
     m_depthOutput->setTexture(shadowMap->depthTexture());
@@ -130,19 +147,28 @@ void ShadowMapRenderPass::setShadowMap(ShadowMapPtr shadowMap)
 
     m_lightIndexParam->setValue(m_shadowMap->depthTextureLayer());
 
-    // clear the buffer except for cubemaps that aren't the first cubemap
-    // the entire cubemap array is bound so clearing will clear all cubemaps in array.
-    m_clearBuffers->setEnabled(!m_shadowMap->usesCubeMap() || m_shadowMap->depthTextureLayer() == 0);
-
+    updateViewport();
     updateLightViewProjection();
 }
 
+void ShadowMapRenderPass::updateViewport()
+{
+    // Shadow maps which didn't fit in the atlas are not rendered. Disabling a
+    // regular FrameGraph node doesn't prune its children, a QSubtreeEnabler does
+    const QRectF viewportRect = m_shadowMap->viewportRect(std::max(m_cascade, 0));
+    m_viewport->setNormalizedRect(viewportRect);
+    m_subtreeEnabler->setEnabled(!viewportRect.isEmpty());
+}
+
 void ShadowMapRenderPass::updateLightViewProjection()
 {
     if (m_shadowMap->usesCubeMap()) {
         m_cubeMapMatrixParam->setValue(m_shadowMap->cubeMapProjectionMatrixList());
     } else {
-        const auto shadowMapCamera = m_shadowMap->lightCamera();
+        const auto shadowMapCamera = m_cascade == WholeScene ? m_shadowMap->lightCamera()
+                                                             : m_shadowMap->cascadeCamera(m_cascade);
+        if (!shadowMapCamera)
+            return;
         m_lightCamera->setProjectionType(shadowMapCamera->projectionType());
         m_lightCamera->setPosition(shadowMapCamera->position());
         m_lightCamera->setViewCenter(shadowMapCamera->viewCenter());
@@ -200,9 +226,22 @@ void ShadowMapStages::reconfigure(const Features features)
         m_layerFilter->setParent(Q_NODE_NULLPTR);
     }
 
+    // One pass per cascade of each shadow map, or a single whole scene pass
+    // when the cascades are fitted to the camera of another view
+    QVector<QPair<ShadowMapPtr, int>> shadowMapCascades;
+    for (const auto &shadowMap : qAsConst(m_shadowMaps)) {
+        const int cascadeCount = shadowMap->cascadeCount();
+        if (cascadeCount > 1 && !m_cascadesEnabled) {
+            shadowMapCascades.push_back({ shadowMap, int(ShadowMapRenderPass::WholeScene) });
+            continue;
+        }
+        for (int cascade = 0; cascade < cascadeCount; ++cascade)
+            shadowMapCascades.push_back({ shadowMap, cascade });
+    }
+
     const int oldSize = m_shadowMapPasses.size();
-    const auto passesToCreate = m_shadowMaps.size() - oldSize;
-    m_shadowMapPasses.resize(m_shadowMaps.size());
+    const auto passesToCreate = shadowMapCascades.size() - oldSize;
+    m_shadowMapPasses.resize(shadowMapCascades.size());
 
     for (int i = 0; i < passesToCreate; ++i) {
         auto shadowMapPass = ShadowMapNodePtr::create();
@@ -211,15 +250,26 @@ void ShadowMapStages::reconfigure(const Features features)
         shadowMapPass->addParameter(m_reflectivePlaneParameter);
     }
 
-    for (int shadowMapNo = 0; shadowMapNo < m_shadowMaps.size(); ++shadowMapNo) {
-        const auto &shadowMap = m_shadowMaps[shadowMapNo];
-        auto &shadowMapRenderPass = m_shadowMapPasses[shadowMapNo];
+    bool atlasCleared = false;
+    for (int passNo = 0; passNo < shadowMapCascades.size(); ++passNo) {
+        const auto &shadowMap = shadowMapCascades[passNo].first;
+        auto &shadowMapRenderPass = m_shadowMapPasses[passNo];
 
         // reparent to new stage root, which might have changed if layers were added/removed
         shadowMapRenderPass->setParent(stageRoot);
 
+        // Only clear once per depth texture: the entire cubemap array is bound
+        // so clearing will clear all cubemaps in array, and all directional
+        // and spot lights render into tiles of the same atlas layer.
+        if (shadowMap->usesCubeMap()) {
+            shadowMapRenderPass->setClearDepth(shadowMap->depthTextureLayer() == 0);
+        } else {
+            shadowMapRenderPass->setClearDepth(!atlasCleared);
+            atlasCleared = true;
+        }
+
         // Set features on stages which will update accordingly
-        shadowMapRenderPass->setShadowMap(shadowMap);
+        shadowMapRenderPass->setShadowMap(shadowMap, shadowMapCascades[passNo].second);
         shadowMapRenderPass->setFrustumCulling(useFrustumCulling);
         shadowMapRenderPass->setSkinning(useSkinning);
     }
@@ -261,9 +311,19 @@ void ShadowMapStages::setShadowMaps(const QVector<ShadowMapPtr> &activeShadowMap
     if (m_shadowMaps == activeShadowMaps)
         return;
 
+    for (const auto &shadowMap : qAsConst(m_shadowMaps))
+        disconnect(shadowMap.data(), &ShadowMap::cascadeCountChanged, this, nullptr);
+
     m_shadowMaps = activeShadowMaps;
     emit shadowMapsChanged(m_shadowMaps);
 
+    // Directional lights need a pass per cascade
+    for (const auto &shadowMap : qAsConst(m_shadowMaps)) {
+        connect(shadowMap.data(), &ShadowMap::cascadeCountChanged, this, [this] {
+            reconfigure(SceneFeaturedRenderStageBase::features());
+        });
+    }
+
     reconfigure(SceneFeaturedRenderStageBase::features());
 }
 
@@ -272,4 +332,24 @@ QVector<ShadowMapPtr> ShadowMapStages::shadowMaps() const
     return m_shadowMaps;
 }
 
+/*!
+    \internal
+
+    Sets whether the cascades of directional lights are rendered. They are
+    fitted to the camera of a single view, the other views render the whole
+    scene shadow map into the tile of the first cascade instead.
+ */
+void ShadowMapStages::setCascadesEnabled(bool cascadesEnabled)
+{
+    if (m_cascadesEnabled == cascadesEnabled)
+        return;
+    m_cascadesEnabled = cascadesEnabled;
+    reconfigure(SceneFeaturedRenderStageBase::features());
+}
+
+bool ShadowMapStages::cascadesEnabled() const
+{
+    return m_cascadesEnabled;
+}
+
 QT_END_NAMESPACE
@@ -50,6 +50,8 @@ namespace Qt3DRender {
 class QCamera;
 class QCameraSelector;
 class QRenderTargetOutput;
+class QSubtreeEnabler;
+class QViewport;
 } // namespace Qt3DRender
 
 namespace Kuesa {
@@ -58,23 +60,31 @@ class KUESA_PRIVATE_EXPORT ShadowMapRenderPass : public Qt3DRender::QFrameGraphN
 {
     Q_OBJECT
 public:
+    // Renders the whole scene light camera into the tile of the first cascade
+    enum { WholeScene = -1 };
+
     ShadowMapRenderPass(Qt3DRender::QFrameGraphNode *parent = nullptr);
     ~ShadowMapRenderPass();
 
-    void setShadowMap(ShadowMapPtr shadowMap);
+    void setShadowMap(ShadowMapPtr shadowMap, int cascade = 0);
     void setFrustumCulling(bool frustumCulling);
     void setSkinning(bool skinning);
+    void setClearDepth(bool clearDepth);
     void addParameter(Qt3DRender::QParameter *parameter);
     void removeParameter(Qt3DRender::QParameter *parameter);
 
 private:
     void updateLightViewProjection();
+    void updateViewport();
 
     ShadowMapPtr m_shadowMap;
+    int m_cascade = 0;
     ScenePass *m_shadowMapRenderPass;
 
     Qt3DRender::QCamera *m_lightCamera;
     Qt3DRender::QCameraSelector *m_cameraSelector;
+    Qt3DRender::QViewport *m_viewport;
+    Qt3DRender::QSubtreeEnabler *m_subtreeEnabler;
     Qt3DRender::QRenderTargetOutput *m_depthOutput;
     Qt3DRender::QClearBuffers *m_clearBuffers;
 
@@ -93,6 +103,9 @@ public:
     void setShadowMaps(const QVector<ShadowMapPtr> &activeShadowMaps);
     QVector<ShadowMapPtr> shadowMaps() const;
 
+    void setCascadesEnabled(bool cascadesEnabled);
+    bool cascadesEnabled() const;
+
 public Q_SLOTS:
     void addLayer(Qt3DRender::QLayer *layer);
     void removeLayer(Qt3DRender::QLayer *layer);
@@ -111,6 +124,7 @@ protected:
     using ShadowMapNodePtr = QSharedPointer<ShadowMapRenderPass>;
     QVector<ShadowMapNodePtr> m_shadowMapPasses;
     QVector<ShadowMapPtr> m_shadowMaps;
+    bool m_cascadesEnabled = true;
 };
 
 } // namespace Kuesa
@@ -0,0 +1,163 @@
+/*
+    transienttexture.cpp
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "transienttexture_p.h"
+#include "framegraphutils_p.h"
+
+#include <Qt3DRender/qtexture.h>
+#include <Qt3DRender/qrendertargetoutput.h>
+#include <Qt3DRender/qparameter.h>
+
+QT_BEGIN_NAMESPACE
+
+namespace Kuesa {
+
+/*!
+ * \class Kuesa::TransientTexture
+ * \internal
+ *
+ * \brief Intermediate texture of a post processing effect which is only read
+ * and written while the effect is rendered.
+ *
+ * Effects declare the render target outputs and parameters referencing the
+ * texture. By default the TransientTexture owns a texture of its own. When
+ * the effect is rendered by a ForwardRenderer, the RenderTargetPool of the
+ * renderer can instead provide a texture shared with other effects that are
+ * never rendered at the same time, in which case the own texture is released.
+ */
+TransientTexture::TransientTexture(QObject *parent)
+    : QObject(parent)
+    , m_size(512, 512)
+    , m_format(FrameGraphUtils::hasHalfFloatRenderable() ? Qt3DRender::QAbstractTexture::RGBA16F : Qt3DRender::QAbstractTexture::RGBA8_UNorm)
+{
+    createOwnTexture();
+}
+
+TransientTexture::~TransientTexture()
+{
+    // Might already have been destroyed along with the output it was parented to
+    delete m_ownTexture;
+}
+
+void TransientTexture::setSize(const QSize &size)
+{
+    if (size == m_size)
+        return;
+    m_size = size;
+    if (m_ownTexture)
+        m_ownTexture->setSize(size.width(), size.height());
+    emit descriptionChanged();
+}
+
+QSize TransientTexture::size() const
+{
+    return m_size;
+}
+
+void TransientTexture::setFormat(Qt3DRender::QAbstractTexture::TextureFormat format)
+{
+    if (format == m_format)
+        return;
+    m_format = format;
+    if (m_ownTexture)
+        m_ownTexture->setFormat(format);
+    emit descriptionChanged();
+}
+
+Qt3DRender::QAbstractTexture::TextureFormat TransientTexture::format() const
+{
+    return m_format;
+}
+
+/*!
+ * Makes \a output render into the texture.
+ */
+void TransientTexture::addOutput(Qt3DRender::QRenderTargetOutput *output)
+{
+    m_outputs.push_back(output);
+    output->setTexture(texture());
+}
+
+/*!
+ * Makes \a parameter reference the texture.
+ */
+void TransientTexture::addParameter(Qt3DRender::QParameter *parameter)
+{
+    m_parameters.push_back(parameter);
+    parameter->setValue(QVariant::fromValue(texture()));
+}
+
+Qt3DRender::QAbstractTexture *TransientTexture::texture()
+{
+    if (m_pooledTexture)
+        return m_pooledTexture;
+    if (!m_ownTexture)
+        createOwnTexture();
+    return m_ownTexture;
+}
+
+bool TransientTexture::isPooled() const
+{
+    return !m_pooledTexture.isNull();
+}
+
+/*!
+ * Uses \a texture provided by a RenderTargetPool instead of our own texture,
+ * which gets destroyed so that it never gets allocated on the GPU. A nullptr
+ * \a texture restores an own texture.
+ */
+void TransientTexture::setPooledTexture(Qt3DRender::QAbstractTexture *texture)
+{
+    if (texture == m_pooledTexture)
+        return;
+    m_pooledTexture = texture;
+    bindTexture(this->texture());
+    if (m_pooledTexture)
+        delete m_ownTexture;
+}
+
+void TransientTexture::createOwnTexture()
+{
+    m_ownTexture = new Qt3DRender::QTexture2D;
+    m_ownTexture->setFormat(m_format);
+    m_ownTexture->setGenerateMipMaps(false);
+    m_ownTexture->setSize(m_size.width(), m_size.height());
+}
+
+void TransientTexture::bindTexture(Qt3DRender::QAbstractTexture *texture)
+{
+    for (Qt3DRender::QRenderTargetOutput *output : m_outputs)
+        output->setTexture(texture);
+    for (Qt3DRender::QParameter *parameter : m_parameters)
+        parameter->setValue(QVariant::fromValue(texture));
+    emit textureChanged(texture);
+}
+
+} // namespace Kuesa
+
+QT_END_NAMESPACE
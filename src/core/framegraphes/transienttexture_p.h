@@ -0,0 +1,99 @@
+/*
+    transienttexture_p.h
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef KUESA_TRANSIENTTEXTURE_P_H
+#define KUESA_TRANSIENTTEXTURE_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Kuesa API.  It exists for the convenience
+// of other Kuesa classes.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <Kuesa/private/kuesa_global_p.h>
+#include <Qt3DRender/qabstracttexture.h>
+#include <QObject>
+#include <QPointer>
+#include <QSize>
+#include <vector>
+
+QT_BEGIN_NAMESPACE
+
+namespace Qt3DRender {
+class QRenderTargetOutput;
+class QParameter;
+} // namespace Qt3DRender
+
+namespace Kuesa {
+
+class KUESA_PRIVATE_EXPORT TransientTexture : public QObject
+{
+    Q_OBJECT
+public:
+    explicit TransientTexture(QObject *parent = nullptr);
+    ~TransientTexture();
+
+    void setSize(const QSize &size);
+    QSize size() const;
+
+    void setFormat(Qt3DRender::QAbstractTexture::TextureFormat format);
+    Qt3DRender::QAbstractTexture::TextureFormat format() const;
+
+    void addOutput(Qt3DRender::QRenderTargetOutput *output);
+    void addParameter(Qt3DRender::QParameter *parameter);
+
+    Qt3DRender::QAbstractTexture *texture();
+    bool isPooled() const;
+    void setPooledTexture(Qt3DRender::QAbstractTexture *texture);
+
+Q_SIGNALS:
+    void descriptionChanged();
+    void textureChanged(Qt3DRender::QAbstractTexture *texture);
+
+private:
+    void createOwnTexture();
+    void bindTexture(Qt3DRender::QAbstractTexture *texture);
+
+    QSize m_size;
+    Qt3DRender::QAbstractTexture::TextureFormat m_format;
+    QPointer<Qt3DRender::QAbstractTexture> m_ownTexture;
+    QPointer<Qt3DRender::QAbstractTexture> m_pooledTexture;
+    std::vector<Qt3DRender::QRenderTargetOutput *> m_outputs;
+    std::vector<Qt3DRender::QParameter *> m_parameters;
+};
+
+} // namespace Kuesa
+
+QT_END_NAMESPACE
+
+#endif // KUESA_TRANSIENTTEXTURE_P_H
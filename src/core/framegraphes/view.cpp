@@ -52,19 +52,42 @@
 #include <private/kuesa_utils_p.h>
 #include <private/kuesa_p.h>
 #include <private/scenestages_p.h>
+#include <private/clusteredlights_p.h>
 #include <private/shadowmapstages_p.h>
 #include <private/effectsstages_p.h>
 #include <private/reflectionstages_p.h>
 #include <private/particlerenderstage_p.h>
 #include <private/framegraphutils_p.h>
 #include <private/fboresolver_p.h>
+#include <private/profiler_p.h>
 
 #include <cmath>
+#include <iterator>
 
 QT_BEGIN_NAMESPACE
 
 namespace Kuesa {
 
+namespace {
+
+// Only removes the layers no longer wanted and adds the missing ones,
+// each layer change triggers a reconfiguration of the stages
+template<typename Stages>
+void syncLayers(Stages *stages, const std::vector<Qt3DRender::QLayer *> &layers)
+{
+    const QVector<Qt3DRender::QLayer *> oldLayers = stages->layers();
+    for (Qt3DRender::QLayer *l : oldLayers) {
+        if (!Utils::contains(layers, l))
+            stages->removeLayer(l);
+    }
+    for (Qt3DRender::QLayer *l : layers) {
+        if (!oldLayers.contains(l))
+            stages->addLayer(l);
+    }
+}
+
+} // namespace
+
 /*!
  * \internal
  * Forward Renderer FrameGraph for a View
@@ -140,15 +163,8 @@ void View::ViewForward::setupRenderTargets(Qt3DRender::QRenderTargetSelector *sc
         m_msaaResolver = nullptr;
     }
 
-    // Unparent nodes
-    if (m_msaaResolver)
-        m_msaaResolver->setParent(Q_NODE_NULLPTR);
-    if (m_blitFramebufferNodeFromMSToFBO0)
-        m_blitFramebufferNodeFromMSToFBO0->setParent(Q_NODE_NULLPTR);
-    if (m_blitFramebufferNodeFromFBO0ToFBO1)
-        m_blitFramebufferNodeFromFBO0ToFBO1->setParent(Q_NODE_NULLPTR);
-    if (m_rt0rt1Resolver)
-        m_rt0rt1Resolver->setParent(Q_NODE_NULLPTR);
+    // Resolve and blit nodes to parent to the sceneTargetSelector, in order
+    std::vector<Qt3DCore::QNode *> sceneTargetChildren;
 
     // Recreate RenderTargets if required
     if (!m_renderTargets[0]) {
@@ -181,7 +197,7 @@ void View::ViewForward::setupRenderTargets(Qt3DRender::QRenderTargetSelector *sc
                 m_msaaResolver = new FBOResolver();
                 m_msaaResolver->setObjectName(QStringLiteral("Kuesa::FBOResolve MSAA -> RT0"));
             }
-            m_msaaResolver->setParent(sceneTargetSelector);
+            sceneTargetChildren.push_back(m_msaaResolver);
             m_msaaResolver->setSource(FrameGraphUtils::findRenderTargetTexture(m_multisampleTarget, Qt3DRender::QRenderTargetOutput::Color0));
             m_msaaResolver->setDestination(m_renderTargets[0]);
         } else {
@@ -192,7 +208,7 @@ void View::ViewForward::setupRenderTargets(Qt3DRender::QRenderTargetSelector *sc
                 auto noDraw = new Qt3DRender::QNoDraw(m_blitFramebufferNodeFromMSToFBO0);
                 Q_UNUSED(noDraw);
             }
-            m_blitFramebufferNodeFromMSToFBO0->setParent(sceneTargetSelector);
+            sceneTargetChildren.push_back(m_blitFramebufferNodeFromMSToFBO0);
             m_blitFramebufferNodeFromMSToFBO0->setSource(m_multisampleTarget);
             m_blitFramebufferNodeFromMSToFBO0->setDestination(m_renderTargets[0]);
             m_blitFramebufferNodeFromMSToFBO0->setSourceAttachmentPoint(Qt3DRender::QRenderTargetOutput::Color0);
@@ -216,7 +232,7 @@ void View::ViewForward::setupRenderTargets(Qt3DRender::QRenderTargetSelector *sc
                 m_rt0rt1Resolver = new FBOResolver();
                 m_rt0rt1Resolver->setObjectName(QStringLiteral("Kuesa::FBOResolve RT0 -> RT1"));
             }
-            m_rt0rt1Resolver->setParent(sceneTargetSelector);
+            sceneTargetChildren.push_back(m_rt0rt1Resolver);
             m_rt0rt1Resolver->setSource(FrameGraphUtils::findRenderTargetTexture(m_renderTargets[0], Qt3DRender::QRenderTargetOutput::Color0));
             m_rt0rt1Resolver->setDestination(m_renderTargets[1]);
         } else {
@@ -228,7 +244,7 @@ void View::ViewForward::setupRenderTargets(Qt3DRender::QRenderTargetSelector *sc
                 Q_UNUSED(noDraw);
             }
 
-            m_blitFramebufferNodeFromFBO0ToFBO1->setParent(sceneTargetSelector);
+            sceneTargetChildren.push_back(m_blitFramebufferNodeFromFBO0ToFBO1);
             m_blitFramebufferNodeFromFBO0ToFBO1->setSource(m_renderTargets[0]);
             m_blitFramebufferNodeFromFBO0ToFBO1->setDestination(m_renderTargets[1]);
             m_blitFramebufferNodeFromFBO0ToFBO1->setSourceAttachmentPoint(Qt3DRender::QRenderTargetOutput::Color0);
@@ -239,6 +255,13 @@ void View::ViewForward::setupRenderTargets(Qt3DRender::QRenderTargetSelector *sc
             m_blitFramebufferNodeFromFBO0ToFBO1->setDestinationRect(blitRect);
         }
     }
+
+    // Only move the nodes which changed, other children of the selector are left untouched
+    FrameGraphUtils::reconcileChildren(sceneTargetSelector, sceneTargetChildren,
+                                       { m_msaaResolver,
+                                         m_blitFramebufferNodeFromMSToFBO0,
+                                         m_blitFramebufferNodeFromFBO0ToFBO1,
+                                         m_rt0rt1Resolver });
 }
 
 /*!
@@ -287,50 +310,41 @@ void View::ViewForward::updateTextureSizes()
  */
 void View::ViewForward::reconfigure(Qt3DRender::QFrameGraphNode *fgRoot)
 {
-    m_renderToTextureRootNode->setParent(Q_NODE_NULLPTR);
-    m_clearRT0->setParent(Q_NODE_NULLPTR);
-    m_mainSceneLayerFilter->setParent(Q_NODE_NULLPTR);
-
-    // Clear all layers on mainSceneFilter
-    const QVector<Qt3DRender::QLayer *> fxLayers = m_mainSceneLayerFilter->layers();
-    for (Qt3DRender::QLayer *l : fxLayers)
-        m_mainSceneLayerFilter->removeLayer(l);
-
-    // Unparent Stages
-    m_view->m_sceneStages->setParent(Q_NODE_NULLPTR);
-    m_view->m_reflectionStages->setParent(Q_NODE_NULLPTR);
-    m_view->m_fxStages->setParent(Q_NODE_NULLPTR);
-    m_view->m_internalFXStages->setParent(Q_NODE_NULLPTR);
-    m_view->m_shadowMapStages->setParent(Q_NODE_NULLPTR);
-
-    // Rebuild FG
+    // The desired tree is computed and compared with the current one, only
+    // the nodes whose place changed are reparented. Reparenting a node makes
+    // Qt3D destroy and recreate the backend nodes of its whole subtree, so
+    // rebuilding everything would make toggling a single stage costly.
 
     // 1) Setup RT for View
-    m_renderToTextureRootNode->setParent(fgRoot);
+    std::vector<Qt3DCore::QNode *> rootChildren{ m_renderToTextureRootNode };
+    FrameGraphUtils::reconcileChildren(fgRoot, rootChildren, rootChildren);
 
     // 1.1 Clear FBO Texture
-    m_clearRT0->setParent(m_renderToTextureRootNode);
-
     // 1.2) Render Stages
-    m_mainSceneLayerFilter->setParent(m_renderToTextureRootNode);
+    FrameGraphUtils::reconcileChildren(m_renderToTextureRootNode,
+                                       { m_clearRT0, m_mainSceneLayerFilter },
+                                       { m_clearRT0, m_mainSceneLayerFilter });
 
     // We draw reflections prior to drawing the scene
+    std::vector<Qt3DCore::QNode *> sceneChildren;
     const bool needsReflections = m_view->m_reflectionPlanes.size() > 0;
     if (needsReflections)
-        m_view->m_reflectionStages->setParent(m_mainSceneLayerFilter);
+        sceneChildren.push_back(m_view->m_reflectionStages);
 
     // Render Scene
 
     // The scene is drawn with a viewport of (0, 0, 1, 1) regardless of the
     // viewport rect set on the View as this parts gets rendered into a texture.
-    m_view->m_sceneStages->setParent(m_mainSceneLayerFilter);
+    sceneChildren.push_back(m_view->m_sceneStages);
+    FrameGraphUtils::reconcileChildren(m_mainSceneLayerFilter, sceneChildren,
+                                       { m_view->m_reflectionStages, m_view->m_sceneStages });
 
     // Put shadowmap render passes first.  There is one pass per shadow-casting light.
     // These passes renderer the scene with simple z-fill shader from the light's perspective
     // into shadowmaps which are passed into the regular render passes defined below.
 #if defined(ENABLE_SHADOWS)
     if (m_view->m_shadowMapStages->shadowMaps().count() > 0)
-        m_view->m_shadowMapStages->setParent(fgRoot);
+        rootChildren.push_back(m_view->m_shadowMapStages);
 #endif
 
     // 2.3) Set up RenderTargets and optional Blits to RT[0] if using MSAA
@@ -347,6 +361,7 @@ void View::ViewForward::reconfigure(Qt3DRender::QFrameGraphNode *fgRoot)
     if (!target0outputs.empty())
         depthTex = target0outputs[1]->texture();
 
+    std::vector<Qt3DRender::QLayer *> fxLayers;
     auto setUpEffectStage = [&](EffectsStages *stage,
                                 Qt3DRender::QRenderTarget *rtA,
                                 Qt3DRender::QRenderTarget *rtB,
@@ -359,13 +374,12 @@ void View::ViewForward::reconfigure(Qt3DRender::QFrameGraphNode *fgRoot)
         stage->setDepthTexture(depthTex);
         stage->setRenderTargets(rtA, rtB);
         stage->setPresentToScreen(presentLastFXToScreen);
-        stage->setParent(fgRoot);
         stage->setBlitFinalRT(blitRts);
+        rootChildren.push_back(stage);
 
         // Exclude fx layers from the main scene
         const std::vector<Qt3DRender::QLayer *> &layers = stage->layers();
-        for (Qt3DRender::QLayer *layer : layers)
-            m_mainSceneLayerFilter->addLayer(layer);
+        std::copy(layers.cbegin(), layers.cend(), std::back_inserter(fxLayers));
     };
 
     // Setup RenderTargets for Effects
@@ -391,6 +405,23 @@ void View::ViewForward::reconfigure(Qt3DRender::QFrameGraphNode *fgRoot)
 
     // We should always have at least 1 internalFX (for Gamma/Exposure)
     Q_ASSERT(m_view->m_internalFXStages->effects().size() > 0);
+
+    FrameGraphUtils::reconcileChildren(fgRoot, rootChildren,
+                                       { m_renderToTextureRootNode,
+                                         m_view->m_shadowMapStages,
+                                         m_view->m_fxStages,
+                                         m_view->m_internalFXStages });
+
+    // Only update the layers of the main scene filter which changed
+    const QVector<Qt3DRender::QLayer *> currentFxLayers = m_mainSceneLayerFilter->layers();
+    for (Qt3DRender::QLayer *l : currentFxLayers) {
+        if (!Utils::contains(fxLayers, l))
+            m_mainSceneLayerFilter->removeLayer(l);
+    }
+    for (Qt3DRender::QLayer *l : fxLayers) {
+        if (!currentFxLayers.contains(l))
+            m_mainSceneLayerFilter->addLayer(l);
+    }
 }
 
 /*!
@@ -479,6 +510,11 @@ View::View(Qt3DCore::QNode *parent)
     QObject::connect(m_gammaCorrectionFX, &ToneMappingAndGammaCorrectionEffect::toneMappingAlgorithmChanged, this, &View::toneMappingAlgorithmChanged);
     QObject::connect(m_reflectionStages, &ReflectionStages::reflectionTextureChanged,
                      this, &View::reflectionTextureChanged);
+    QObject::connect(m_reflectionStages, &ReflectionStages::reflectionTextureChanged,
+                     this, [this](Qt3DRender::QAbstractTexture *t) {
+                         if (m_reflectionPlanes.size() > 0)
+                             m_sceneStages->setReflectivePlaneTexture(t);
+                     });
 
     connect(m_shadowMapStages, &ShadowMapStages::shadowMapsChanged, this, &View::shadowMapsChanged);
     connect(m_shadowMapStages, &ShadowMapStages::shadowMapsChanged, this, &View::scheduleFGTreeRebuild);
@@ -631,6 +667,38 @@ bool View::particlesEnabled() const
     return m_features & Particles;
 }
 
+/*!
+    \property Kuesa::View::clusteredLighting
+
+    Holds whether the lights of the scene are binned in clusters of the view
+    frustum, so that the metallic roughness materials only evaluate the lights
+    reaching each fragment instead of up to 8 lights selected per entity.
+
+    Only the lights of the Kuesa::LightCollection of the SceneEntity which
+    don't cast shadows are clustered, shadow casting lights are still
+    selected per entity. Disabled by default.
+
+    \since Kuesa 1.4
+*/
+
+/*!
+    \qmlproperty bool Kuesa::View::clusteredLighting
+
+    Holds whether the lights of the scene are binned in clusters of the view
+    frustum, so that the metallic roughness materials only evaluate the lights
+    reaching each fragment instead of up to 8 lights selected per entity.
+
+    Only the lights of the Kuesa::LightCollection of the SceneEntity which
+    don't cast shadows are clustered, shadow casting lights are still
+    selected per entity. Disabled by default.
+
+    \since Kuesa 1.4
+*/
+bool View::clusteredLighting() const
+{
+    return m_features & ClusteredLighting;
+}
+
 /*!
     \property Kuesa::View::reflectionTexture
 
@@ -664,8 +732,7 @@ Qt3DRender::QAbstractTexture *View::reflectionTexture() const
 */
 QSize View::reflectionTextureSize() const
 {
-    Qt3DRender::QAbstractTexture *t = m_reflectionStages->reflectionTexture();
-    return { t->width(), t->height() };
+    return m_reflectionStages->reflectionTextureSize();
 }
 
 /*!
@@ -950,6 +1017,12 @@ void View::addReflectionPlane(ReflectionPlane *plane)
                          this, &View::rebuildFGTree);
         QObject::connect(plane, &ReflectionPlane::layersChanged,
                          this, &View::rebuildFGTree);
+        QObject::connect(plane, &ReflectionPlane::updateIntervalChanged,
+                         this, &View::rebuildFGTree);
+        QObject::connect(plane, &ReflectionPlane::resolutionScaleChanged,
+                         this, &View::rebuildFGTree);
+        QObject::connect(plane, &ReflectionPlane::updateRequested,
+                         m_reflectionStages, &ReflectionStages::requestUpdate);
     }
 }
 
@@ -962,6 +1035,7 @@ void View::removeReflectionPlane(ReflectionPlane *plane)
         m_reflectionPlanes.erase(it);
         rebuildFGTree();
         plane->disconnect(this);
+        plane->disconnect(m_reflectionStages);
     }
 }
 
@@ -1054,6 +1128,17 @@ void View::setParticlesEnabled(bool enabled)
     rebuildFGTree();
 }
 
+void View::setClusteredLighting(bool clusteredLighting)
+{
+    if (clusteredLighting == bool(m_features & ClusteredLighting))
+        return;
+    m_features.setFlag(ClusteredLighting, clusteredLighting);
+    const bool blocked = blockNotifications(true);
+    emit clusteredLightingChanged(clusteredLighting);
+    blockNotifications(blocked);
+    reconfigureStages();
+}
+
 /*!
     Sets the \a gamma value to use for gamma correction that brings linear
     colors to sRGB colors.
@@ -1126,6 +1211,7 @@ void View::scheduleFGTreeRebuild()
 
 void View::rebuildFGTree()
 {
+    ProfilerScope scope("framegraph", "rebuild");
     m_fgTreeRebuiltScheduled = false;
     // Reconfigure FrameGraph Tree
     reconfigureStages();
@@ -1139,6 +1225,7 @@ void View::reconfigureStages()
     const bool sortBackToFront = bool(m_features & BackToFrontSorting);
     const bool useFrustumCulling = bool(m_features & FrustumCulling);
     const bool useParticles = bool(m_features & Particles);
+    const bool useClusteredLighting = bool(m_features & ClusteredLighting);
 
     // Scene Stages
     m_sceneStages->setBackToFrontSorting(sortBackToFront);
@@ -1146,6 +1233,7 @@ void View::reconfigureStages()
     m_sceneStages->setZFilling(useZFilling);
     m_sceneStages->setFrustumCulling(useFrustumCulling);
     m_sceneStages->setParticlesEnabled(useParticles);
+    m_sceneStages->setClusteredLighting(useClusteredLighting);
     m_sceneStages->setCamera(m_camera);
     m_sceneStages->setCullingMode(Qt3DRender::QCullFace::Back);
 
@@ -1154,17 +1242,8 @@ void View::reconfigureStages()
     m_shadowMapStages->setFrustumCulling(useFrustumCulling);
 
     // Update layers on sceneStages
-    // Remove old layers
-    const QVector<Qt3DRender::QLayer *> oldLayers = m_sceneStages->layers();
-    for (Qt3DRender::QLayer *l : oldLayers) {
-        m_sceneStages->removeLayer(l);
-        m_shadowMapStages->removeLayer(l);
-    }
-    // Add new ones
-    for (Qt3DRender::QLayer *l : m_layers) {
-        m_sceneStages->addLayer(l);
-        m_shadowMapStages->addLayer(l);
-    }
+    syncLayers(m_sceneStages.data(), m_layers);
+    syncLayers(m_shadowMapStages.data(), m_layers);
 
     // FX
     m_fxStages->setCamera(m_camera);
@@ -1173,10 +1252,7 @@ void View::reconfigureStages()
     m_internalFXStages->setViewport(m_viewport);
 
     // Update fxs on effectsStages
-    m_fxStages->clearEffects();
-
-    for (Kuesa::AbstractPostProcessingEffect *fx : m_fxs)
-        m_fxStages->addEffect(fx);
+    m_fxStages->setEffects(m_fxs);
 
     // Reflections Stages
     m_reflectionStages->setBackToFrontSorting(sortBackToFront);
@@ -1192,18 +1268,15 @@ void View::reconfigureStages()
     if (needsReflections) {
         if (m_reflectionPlanes.size() > 1)
             qCWarning(kuesa) << "Kuesa only handles a single reflection plane per View";
-        // Remove layers
-        const QVector<Qt3DRender::QLayer *> oldReflectionLayers = m_reflectionStages->layers();
-        for (Qt3DRender::QLayer *l : oldLayers)
-            m_reflectionStages->removeLayer(l);
+        // Update layers
         const std::vector<Qt3DRender::QLayer *> &reflectionVisibleLayers =
                 m_reflectionPlanes[0]->layers().size() > 0 ? m_reflectionPlanes[0]->layers() : m_layers;
-        // Readd layers
-        for (Qt3DRender::QLayer *l : reflectionVisibleLayers)
-            m_reflectionStages->addLayer(l);
+        syncLayers(m_reflectionStages.data(), reflectionVisibleLayers);
         // Set equation
         const QVector4D planeEquation = m_reflectionPlanes[0]->equation();
         m_reflectionStages->setReflectivePlaneEquation(planeEquation);
+        m_reflectionStages->setUpdateInterval(m_reflectionPlanes[0]->updateInterval());
+        m_reflectionStages->setResolutionScale(m_reflectionPlanes[0]->resolutionScale());
         m_sceneStages->setReflectivePlaneEquation(planeEquation);
         m_sceneStages->setReflectivePlaneTexture(m_reflectionStages->reflectionTexture());
     }
@@ -1269,6 +1342,38 @@ QVector<ShadowMapPtr> View::shadowMaps() const
     return m_shadowMapStages->shadowMaps();
 }
 
+/*!
+    \internal
+
+    Directional light cascades are fitted to the camera of a single view, set
+    by the ForwardRenderer. The other views render and sample a single shadow
+    map covering the whole scene.
+ */
+void View::setShadowCascadesEnabled(bool shadowCascadesEnabled)
+{
+    m_shadowMapStages->setCascadesEnabled(shadowCascadesEnabled);
+    m_sceneStages->setShadowCascadesEnabled(shadowCascadesEnabled);
+    m_reflectionStages->setShadowCascadesEnabled(shadowCascadesEnabled);
+}
+
+/*!
+    Sets the \a lights binned when clusteredLighting is enabled. The
+    SceneEntity sets those of its LightCollection on the ForwardRenderer,
+    which forwards them to its sub views.
+ */
+void View::setLights(const QVector<ShadowCastingLight *> &lights)
+{
+    if (lights == m_sceneStages->clusteredLights()->lights())
+        return;
+    m_sceneStages->setLights(lights);
+    emit lightsChanged(lights);
+}
+
+QVector<ShadowCastingLight *> View::lights() const
+{
+    return m_sceneStages->clusteredLights()->lights();
+}
+
 } // namespace Kuesa
 
 QT_END_NAMESPACE
@@ -43,6 +43,7 @@
 
 class tst_View;
 class tst_ForwardRenderer;
+class tst_FrameGraphReconfiguration;
 
 QT_BEGIN_NAMESPACE
 
@@ -67,6 +68,7 @@ class EffectsStages;
 class ReflectionPlane;
 class FBOResolver;
 class ShadowMapStages;
+class ShadowCastingLight;
 
 class KUESASHARED_EXPORT View : public Qt3DRender::QFrameGraphNode
 {
@@ -78,6 +80,7 @@ class KUESASHARED_EXPORT View : public Qt3DRender::QFrameGraphNode
     Q_PROPERTY(bool backToFrontSorting READ backToFrontSorting WRITE setBackToFrontSorting NOTIFY backToFrontSortingChanged)
     Q_PROPERTY(bool zFilling READ zFilling WRITE setZFilling NOTIFY zFillingChanged)
     Q_PROPERTY(bool particlesEnabled READ particlesEnabled WRITE setParticlesEnabled NOTIFY particlesEnabledChanged)
+    Q_PROPERTY(bool clusteredLighting READ clusteredLighting WRITE setClusteredLighting NOTIFY clusteredLightingChanged)
     Q_PROPERTY(Qt3DRender::QAbstractTexture *reflectionTexture READ reflectionTexture NOTIFY reflectionTextureChanged)
     Q_PROPERTY(QSize reflectionTextureSize READ reflectionTextureSize WRITE setReflectionTextureSize NOTIFY reflectionTextureSizeChanged)
     Q_PROPERTY(ToneMappingAndGammaCorrectionEffect::ToneMapping toneMappingAlgorithm READ toneMappingAlgorithm WRITE setToneMappingAlgorithm NOTIFY toneMappingAlgorithmChanged)
@@ -97,6 +100,7 @@ public:
     bool backToFrontSorting() const;
     bool zFilling() const;
     bool particlesEnabled() const;
+    bool clusteredLighting() const;
     Qt3DRender::QAbstractTexture *reflectionTexture() const;
     QSize reflectionTextureSize() const;
     QColor clearColor() const;
@@ -110,6 +114,7 @@ public:
     const std::vector<ReflectionPlane *> &reflectionPlanes() const;
 
     QVector<ShadowMapPtr> shadowMaps() const;
+    QVector<ShadowCastingLight *> lights() const;
 
 public Q_SLOTS:
     void setViewportRect(const QRectF &viewportRect);
@@ -119,6 +124,7 @@ public Q_SLOTS:
     void setBackToFrontSorting(bool backToFrontSorting);
     void setZFilling(bool zfilling);
     void setParticlesEnabled(bool enabled);
+    void setClusteredLighting(bool clusteredLighting);
     void setReflectionTextureSize(const QSize &reflectionTextureSize);
     void setClearColor(const QColor &clearColor);
     void setGamma(float gamma);
@@ -136,6 +142,7 @@ public Q_SLOTS:
     void removeReflectionPlane(ReflectionPlane *plane);
 
     void setShadowMaps(const QVector<ShadowMapPtr> &activeShadowMaps);
+    void setLights(const QVector<ShadowCastingLight *> &lights);
 
     void dump();
 
@@ -147,11 +154,13 @@ Q_SIGNALS:
     void backToFrontSortingChanged(bool backToFrontSorting);
     void zFillingChanged(bool zFilling);
     void particlesEnabledChanged(bool enabled);
+    void clusteredLightingChanged(bool clusteredLighting);
     void reflectionTextureChanged(Qt3DRender::QAbstractTexture *reflectionTexture);
     void reflectionTextureSizeChanged(const QSize &reflectionTextureSize);
     void clearColorChanged(const QColor &clearColor);
     void gammaChanged(float gamma);
     void shadowMapsChanged(const QVector<ShadowMapPtr> &shadowMaps);
+    void lightsChanged(const QVector<ShadowCastingLight *> &lights);
     void exposureChanged(float exposure);
     void toneMappingAlgorithmChanged(ToneMappingAndGammaCorrectionEffect::ToneMapping toneMappingAlgorithm);
     void usesStencilMaskChanged(bool usesStencilMask);
@@ -174,6 +183,7 @@ protected:
         FrustumCulling = (1 << 2),
         ZFilling = (1 << 3),
         Particles = (1 << 4),
+        ClusteredLighting = (1 << 5),
     };
     Q_DECLARE_FLAGS(Features, Feature)
 
@@ -182,6 +192,7 @@ private:
 
     void setSurfaceSize(const QSize &size);
     QSize surfaceSize() const;
+    void setShadowCascadesEnabled(bool shadowCascadesEnabled);
     QSize currentTargetSize() const;
 
     QPointer<SceneStages> m_sceneStages;
@@ -236,6 +247,7 @@ private:
 
     friend class ::tst_View;
     friend class ::tst_ForwardRenderer;
+    friend class ::tst_FrameGraphReconfiguration;
     friend class ForwardRenderer;
     friend class ViewResolver;
 };
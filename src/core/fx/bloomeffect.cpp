@@ -31,7 +31,7 @@
 #include "thresholdeffect.h"
 #include "fullscreenquad.h"
 #include "fxutils_p.h"
-#include "framegraphutils_p.h"
+#include "transienttexture_p.h"
 
 #include <Qt3DRender/qcameraselector.h>
 #include <Qt3DRender/qrendersurfaceselector.h>
@@ -154,6 +154,28 @@ using namespace Kuesa;
     \sa GaussianBlurEffect::blurPassCount
 */
 
+/*!
+    \property BloomEffect::blurMode
+
+    \brief the algorithm used to blur the bright parts of the scene
+
+    Using GaussianBlurEffect::MipChainBlur is much cheaper than
+    GaussianBlurEffect::IterativeBlur on high resolution displays and gives a
+    wider glow.
+
+    \since Kuesa 1.4
+    \sa GaussianBlurEffect::blurMode
+*/
+
+/*!
+    \property BloomEffect::mipLevelCount
+
+    \brief the number of downsampled levels used by the mip chain blur
+
+    \since Kuesa 1.4
+    \sa GaussianBlurEffect::mipLevelCount
+*/
+
 /*!
     \qmlproperty real BloomEffect::threshold
 
@@ -172,6 +194,26 @@ using namespace Kuesa;
     More passes result in stronger blurring effect but take longer to render.
 */
 
+/*!
+    \qmlproperty enumeration BloomEffect::blurMode
+
+    \brief the algorithm used to blur the bright parts of the scene
+
+    Using GaussianBlurEffect.MipChainBlur is much cheaper than
+    GaussianBlurEffect.IterativeBlur on high resolution displays and gives a
+    wider glow.
+
+    \since Kuesa 1.4
+*/
+
+/*!
+    \qmlproperty int BloomEffect::mipLevelCount
+
+    \brief the number of downsampled levels used by the mip chain blur
+
+    \since Kuesa 1.4
+*/
+
 BloomEffect::BloomEffect(Qt3DCore::QNode *parent)
     : AbstractPostProcessingEffect(parent)
     , m_sceneTextureParam(new Qt3DRender::QParameter(QStringLiteral("texture0"), nullptr))
@@ -181,10 +223,12 @@ BloomEffect::BloomEffect(Qt3DCore::QNode *parent)
     m_rootFrameGraphNode.reset(new Qt3DRender::QFrameGraphNode);
     m_rootFrameGraphNode->setObjectName(QStringLiteral("Bloom Effect"));
 
-    m_brightTexture = new Qt3DRender::QTexture2D;
+    // Only used while the effect is rendered, a RenderTargetPool can share
+    // them with other effects
+    m_brightTexture = new TransientTexture(this);
     auto thresholdRenderTarget = createRenderTarget(m_brightTexture);
 
-    m_blurredBrightTexture = new Qt3DRender::QTexture2D;
+    m_blurredBrightTexture = new TransientTexture(this);
     auto blurRenderTarget = createRenderTarget(m_blurredBrightTexture);
 
     // Set up Threshold Material
@@ -193,7 +237,8 @@ BloomEffect::BloomEffect(Qt3DCore::QNode *parent)
 
     // Set up Gaussian Blur
     m_blurEffect = new GaussianBlurEffect(this);
-    m_blurEffect->setInputTexture(m_brightTexture);
+    m_blurEffect->setInputTexture(m_brightTexture->texture());
+    connect(m_brightTexture, &TransientTexture::textureChanged, m_blurEffect, &GaussianBlurEffect::setInputTexture);
     m_layers += m_blurEffect->layers();
 
     // Set up Bloom Material
@@ -239,7 +284,7 @@ BloomEffect::BloomEffect(Qt3DCore::QNode *parent)
     effect->addTechnique(rhiTechnique);
 #endif
 
-    m_blurredBrightTextureParam->setValue(QVariant::fromValue(m_blurredBrightTexture));
+    m_blurredBrightTexture->addParameter(m_blurredBrightTextureParam);
     effect->addParameter(m_sceneTextureParam);
     effect->addParameter(m_blurredBrightTextureParam);
 
@@ -248,6 +293,8 @@ BloomEffect::BloomEffect(Qt3DCore::QNode *parent)
 
     connect(m_thresholdEffect, &ThresholdEffect::thresholdChanged, this, &BloomEffect::thresholdChanged);
     connect(m_blurEffect, &GaussianBlurEffect::blurPassCountChanged, this, &BloomEffect::blurPassCountChanged);
+    connect(m_blurEffect, &GaussianBlurEffect::blurModeChanged, this, &BloomEffect::blurModeChanged);
+    connect(m_blurEffect, &GaussianBlurEffect::mipLevelCountChanged, this, &BloomEffect::mipLevelCountChanged);
 
     //
     //  FrameGraph Construction
@@ -280,16 +327,13 @@ BloomEffect::~BloomEffect()
     m_blurEffect->frameGraphSubTree()->setParent(static_cast<Qt3DCore::QNode *>(nullptr));
 }
 
-Qt3DRender::QRenderTarget *BloomEffect::createRenderTarget(Qt3DRender::QAbstractTexture *texture)
+Qt3DRender::QRenderTarget *BloomEffect::createRenderTarget(TransientTexture *texture)
 {
     auto renderTarget = new Qt3DRender::QRenderTarget(this);
     auto output = new Qt3DRender::QRenderTargetOutput;
     output->setAttachmentPoint(Qt3DRender::QRenderTargetOutput::Color0);
     renderTarget->addOutput(output);
-    texture->setFormat(FrameGraphUtils::hasHalfFloatRenderable() ? Qt3DRender::QAbstractTexture::RGBA16F : Qt3DRender::QAbstractTexture::RGBA8_UNorm);
-    texture->setSize(512, 512);
-    texture->setGenerateMipMaps(false);
-    output->setTexture(texture);
+    texture->addOutput(output);
     return renderTarget;
 }
 
@@ -312,8 +356,8 @@ void BloomEffect::setWindowSize(const QSize &size)
 {
     m_blurEffect->setWindowSize(size);
     m_thresholdEffect->setWindowSize(size);
-    m_brightTexture->setSize(size.width(), size.height());
-    m_blurredBrightTexture->setSize(size.width(), size.height());
+    m_brightTexture->setSize(size);
+    m_blurredBrightTexture->setSize(size);
 }
 
 /*!
@@ -372,4 +416,46 @@ void BloomEffect::setBlurPassCount(int blurPassCount)
     m_blurEffect->setBlurPassCount(blurPassCount);
 }
 
+/*!
+ * Returns the algorithm used to blur the bright parts of the scene.
+ *
+ * \sa BloomEffect::setBlurMode
+ */
+GaussianBlurEffect::BlurMode BloomEffect::blurMode() const
+{
+    return m_blurEffect->blurMode();
+}
+
+/*!
+ * Sets the algorithm used to blur the bright parts of the scene to
+ * \a blurMode.
+ *
+ * \sa BloomEffect::blurMode
+ */
+void BloomEffect::setBlurMode(GaussianBlurEffect::BlurMode blurMode)
+{
+    m_blurEffect->setBlurMode(blurMode);
+}
+
+/*!
+ * Returns the number of downsampled levels used by the mip chain blur.
+ *
+ * \sa BloomEffect::setMipLevelCount
+ */
+int BloomEffect::mipLevelCount() const
+{
+    return m_blurEffect->mipLevelCount();
+}
+
+/*!
+ * Sets the number of downsampled levels used by the mip chain blur to
+ * \a mipLevelCount.
+ *
+ * \sa BloomEffect::mipLevelCount
+ */
+void BloomEffect::setMipLevelCount(int mipLevelCount)
+{
+    m_blurEffect->setMipLevelCount(mipLevelCount);
+}
+
 QT_END_NAMESPACE
@@ -31,6 +31,7 @@
 
 #include <Kuesa/kuesa_global.h>
 #include <Kuesa/abstractpostprocessingeffect.h>
+#include <Kuesa/gaussianblureffect.h>
 
 QT_BEGIN_NAMESPACE
 
@@ -49,7 +50,7 @@ class QCamera;
 namespace Kuesa {
 
 class ThresholdEffect;
-class GaussianBlurEffect;
+class TransientTexture;
 class BloomMaterial;
 class FullScreenQuad;
 
@@ -59,6 +60,8 @@ class KUESASHARED_EXPORT BloomEffect : public AbstractPostProcessingEffect
 
     Q_PROPERTY(float threshold READ threshold WRITE setThreshold NOTIFY thresholdChanged)
     Q_PROPERTY(int blurPassCount READ blurPassCount WRITE setBlurPassCount NOTIFY blurPassCountChanged)
+    Q_PROPERTY(Kuesa::GaussianBlurEffect::BlurMode blurMode READ blurMode WRITE setBlurMode NOTIFY blurModeChanged)
+    Q_PROPERTY(int mipLevelCount READ mipLevelCount WRITE setMipLevelCount NOTIFY mipLevelCountChanged)
 
 public:
     BloomEffect(Qt3DCore::QNode *parent = nullptr);
@@ -71,22 +74,28 @@ public:
 
     float threshold() const;
     int blurPassCount() const;
+    GaussianBlurEffect::BlurMode blurMode() const;
+    int mipLevelCount() const;
 
 public Q_SLOTS:
     void setThreshold(float threshold);
     void setBlurPassCount(int blurPassCount);
+    void setBlurMode(Kuesa::GaussianBlurEffect::BlurMode blurMode);
+    void setMipLevelCount(int mipLevelCount);
 
 Q_SIGNALS:
     void thresholdChanged(float threshold);
     void blurPassCountChanged(int blurPassCount);
+    void blurModeChanged(Kuesa::GaussianBlurEffect::BlurMode blurMode);
+    void mipLevelCountChanged(int mipLevelCount);
 
 private:
-    Qt3DRender::QRenderTarget *createRenderTarget(Qt3DRender::QAbstractTexture *texture);
+    Qt3DRender::QRenderTarget *createRenderTarget(TransientTexture *texture);
 
     FrameGraphNodePtr m_rootFrameGraphNode;
 
-    Qt3DRender::QAbstractTexture *m_brightTexture;
-    Qt3DRender::QAbstractTexture *m_blurredBrightTexture;
+    TransientTexture *m_brightTexture;
+    TransientTexture *m_blurredBrightTexture;
 
     ThresholdEffect *m_thresholdEffect;
     GaussianBlurEffect *m_blurEffect;
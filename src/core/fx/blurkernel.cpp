@@ -0,0 +1,173 @@
+/*
+    blurkernel.cpp
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "blurkernel_p.h"
+
+#include <algorithm>
+#include <cmath>
+
+QT_BEGIN_NAMESPACE
+
+namespace Kuesa {
+namespace BlurKernel {
+
+namespace {
+
+float texelAt(const std::vector<float> &texels, int index)
+{
+    const int lastIndex = int(texels.size()) - 1;
+    return texels[size_t(std::max(0, std::min(index, lastIndex)))];
+}
+
+float sampleLinear(const std::vector<float> &texels, float position)
+{
+    const float floorPosition = std::floor(position);
+    const float t = position - floorPosition;
+    const int index = int(floorPosition);
+    return texelAt(texels, index) * (1.0f - t) + texelAt(texels, index + 1) * t;
+}
+
+} // namespace
+
+std::vector<float> binomialWeights(int radius, int trimmedTaps)
+{
+    radius = std::max(radius, 0);
+    trimmedTaps = std::max(trimmedTaps, 0);
+
+    // Row n of the Pascal triangle, computed in double to stay exact for
+    // the rows we care about
+    const int n = 2 * (radius + trimmedTaps);
+    std::vector<double> row(size_t(n + 1), 0.0);
+    row[0] = 1.0;
+    for (int i = 1; i <= n; ++i) {
+        for (int j = i; j > 0; --j)
+            row[size_t(j)] += row[size_t(j - 1)];
+    }
+
+    const int center = n / 2;
+    double sum = row[size_t(center)];
+    for (int i = 1; i <= radius; ++i)
+        sum += 2.0 * row[size_t(center + i)];
+
+    std::vector<float> weights;
+    weights.reserve(size_t(radius + 1));
+    for (int i = 0; i <= radius; ++i)
+        weights.push_back(float(row[size_t(center + i)] / sum));
+    return weights;
+}
+
+LinearTaps linearSampledTaps(const std::vector<float> &weights)
+{
+    LinearTaps taps;
+    if (weights.empty())
+        return taps;
+
+    taps.offsets.push_back(0.0f);
+    taps.weights.push_back(weights[0]);
+
+    const size_t radius = weights.size() - 1;
+    for (size_t i = 1; i <= radius; i += 2) {
+        if (i == radius) {
+            // Odd tap left over, fetched on its own
+            taps.offsets.push_back(float(i));
+            taps.weights.push_back(weights[i]);
+            break;
+        }
+        const float weight = weights[i] + weights[i + 1];
+        taps.offsets.push_back((float(i) * weights[i] + float(i + 1) * weights[i + 1]) / weight);
+        taps.weights.push_back(weight);
+    }
+    return taps;
+}
+
+std::vector<QSize> mipChainSizes(const QSize &size, int levelCount)
+{
+    std::vector<QSize> sizes;
+    QSize levelSize = size.expandedTo(QSize(1, 1));
+    for (int level = 0; level < levelCount; ++level) {
+        levelSize = QSize(std::max(levelSize.width() / 2, 1),
+                          std::max(levelSize.height() / 2, 1));
+        sizes.push_back(levelSize);
+    }
+    return sizes;
+}
+
+qint64 mipChainShadedPixelCount(const QSize &size, int levelCount)
+{
+    const std::vector<QSize> sizes = mipChainSizes(size, levelCount);
+    qint64 count = qint64(size.width()) * qint64(size.height());
+    for (size_t level = 0, m = sizes.size(); level < m; ++level) {
+        const qint64 levelPixels = qint64(sizes[level].width()) * qint64(sizes[level].height());
+        count += 2 * levelPixels;
+        if (level + 1 < m)
+            count += levelPixels;
+    }
+    return count;
+}
+
+qint64 iterativeShadedPixelCount(const QSize &size, int blurPassCount)
+{
+    return 2 * qint64(blurPassCount) * qint64(size.width()) * qint64(size.height());
+}
+
+std::vector<float> convolve(const std::vector<float> &texels,
+                            const std::vector<float> &weights)
+{
+    std::vector<float> result(texels.size(), 0.0f);
+    if (weights.empty())
+        return result;
+    for (int i = 0, m = int(texels.size()); i < m; ++i) {
+        float sum = texels[size_t(i)] * weights[0];
+        for (int j = 1, r = int(weights.size()); j < r; ++j)
+            sum += (texelAt(texels, i - j) + texelAt(texels, i + j)) * weights[size_t(j)];
+        result[size_t(i)] = sum;
+    }
+    return result;
+}
+
+std::vector<float> convolve(const std::vector<float> &texels,
+                            const LinearTaps &taps)
+{
+    std::vector<float> result(texels.size(), 0.0f);
+    if (taps.weights.empty())
+        return result;
+    for (int i = 0, m = int(texels.size()); i < m; ++i) {
+        float sum = texels[size_t(i)] * taps.weights[0];
+        for (size_t j = 1, r = taps.weights.size(); j < r; ++j) {
+            sum += (sampleLinear(texels, float(i) - taps.offsets[j]) +
+                    sampleLinear(texels, float(i) + taps.offsets[j])) * taps.weights[j];
+        }
+        result[size_t(i)] = sum;
+    }
+    return result;
+}
+
+} // namespace BlurKernel
+} // namespace Kuesa
+
+QT_END_NAMESPACE
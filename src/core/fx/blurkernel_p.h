@@ -0,0 +1,101 @@
+/*
+    blurkernel_p.h
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef KUESA_BLURKERNEL_P_H
+#define KUESA_BLURKERNEL_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Kuesa API.  It exists for the convenience
+// of other Kuesa classes.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <Kuesa/private/kuesa_global_p.h>
+#include <QSize>
+#include <vector>
+
+QT_BEGIN_NAMESPACE
+
+namespace Kuesa {
+
+// CPU reference of the kernels and render target chain used by the
+// GaussianBlurEffect shaders. The constants of the shaders are generated from
+// these functions, they must be kept in sync.
+namespace BlurKernel {
+
+struct LinearTaps {
+    std::vector<float> offsets;
+    std::vector<float> weights;
+};
+
+// Weights of the center tap and of the taps at distance 1 to radius of a
+// symmetric kernel built from the binomial coefficients of row
+// 2 * (radius + trimmedTaps). The trimmedTaps outermost coefficients on each
+// side are dropped as they barely contribute, the kept weights sum to 1.
+KUESA_PRIVATE_EXPORT std::vector<float> binomialWeights(int radius, int trimmedTaps = 2);
+
+// Merges pairs of adjacent taps into a single fetch placed between the two
+// texels so that bilinear filtering returns their weighted sum. A kernel of
+// radius r then needs 1 + ceil(r / 2) fetches per side instead of 1 + r.
+KUESA_PRIVATE_EXPORT LinearTaps linearSampledTaps(const std::vector<float> &weights);
+
+// Sizes of the levelCount downsampled levels of the mip chain blur for an
+// input of size: half, quarter, eighth... Levels never get smaller than a
+// single texel.
+KUESA_PRIVATE_EXPORT std::vector<QSize> mipChainSizes(const QSize &size, int levelCount);
+
+// Number of pixels shaded by the mip chain blur: a horizontal and a vertical
+// pass per level, an upsampling pass per level but the last one and a final
+// upsampling pass at full size.
+KUESA_PRIVATE_EXPORT qint64 mipChainShadedPixelCount(const QSize &size, int levelCount);
+
+// Number of pixels shaded by the iterative blur: a horizontal and a vertical
+// pass at full size per blur pass.
+KUESA_PRIVATE_EXPORT qint64 iterativeShadedPixelCount(const QSize &size, int blurPassCount);
+
+// Convolves a row of texels with a symmetric kernel, clamping to the edges
+KUESA_PRIVATE_EXPORT std::vector<float> convolve(const std::vector<float> &texels,
+                                                 const std::vector<float> &weights);
+
+// Convolves a row of texels with linear taps, emulating bilinear filtering
+// with clamping to the edges
+KUESA_PRIVATE_EXPORT std::vector<float> convolve(const std::vector<float> &texels,
+                                                 const LinearTaps &taps);
+
+} // namespace BlurKernel
+
+} // namespace Kuesa
+
+QT_END_NAMESPACE
+
+#endif // KUESA_BLURKERNEL_P_H
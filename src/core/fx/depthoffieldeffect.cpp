@@ -29,7 +29,7 @@
 #include "depthoffieldeffect.h"
 #include "fullscreenquad.h"
 #include "fx/fxutils_p.h"
-#include "framegraphutils_p.h"
+#include "transienttexture_p.h"
 
 #include <Qt3DRender/qcameraselector.h>
 #include <Qt3DRender/qrendersurfaceselector.h>
@@ -286,18 +286,17 @@ DepthOfFieldEffect::DepthOfFieldEffect(Qt3DCore::QNode *parent)
     m_rootFrameGraphNode.reset(new Qt3DRender::QFrameGraphNode);
     m_rootFrameGraphNode->setObjectName(QStringLiteral("DoF Effect"));
 
-    m_dofTexture = new Qt3DRender::QTexture2D;
+    // Only used while the effect is rendered, a RenderTargetPool can share
+    // it with other effects
+    m_dofTexture = new TransientTexture(this);
 
     auto blurRenderTarget = new Qt3DRender::QRenderTarget;
     auto dofOutput = new Qt3DRender::QRenderTargetOutput;
     dofOutput->setAttachmentPoint(Qt3DRender::QRenderTargetOutput::Color0);
-    dofOutput->setTexture(m_dofTexture);
-    m_dofTexture->setFormat(FrameGraphUtils::hasHalfFloatRenderable() ? Qt3DRender::QAbstractTexture::RGBA16F : Qt3DRender::QAbstractTexture::RGBA8_UNorm);
-    m_dofTexture->setSize(512, 512);
-    m_dofTexture->setGenerateMipMaps(false);
+    m_dofTexture->addOutput(dofOutput);
     blurRenderTarget->addOutput(dofOutput);
 
-    m_dofTextureParam->setValue(QVariant::fromValue(m_dofTexture));
+    m_dofTexture->addParameter(m_dofTextureParam);
 
     // Set up DoF Material
     auto dofMaterial = new Qt3DRender::QMaterial(m_rootFrameGraphNode.data());
@@ -502,7 +501,7 @@ void DepthOfFieldEffect::setFocusDistance(float focusDistance)
 void DepthOfFieldEffect::setWindowSize(const QSize &size)
 {
     m_textureSizeParam->setValue(QSizeF(size));
-    m_dofTexture->setSize(size.width(), size.height());
+    m_dofTexture->setSize(size);
 }
 
 QT_END_NAMESPACE
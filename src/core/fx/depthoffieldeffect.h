@@ -49,6 +49,7 @@ class QCamera;
 namespace Kuesa {
 
 class FullScreenQuad;
+class TransientTexture;
 
 class KUESASHARED_EXPORT DepthOfFieldEffect : public AbstractPostProcessingEffect
 {
@@ -99,7 +100,7 @@ private:
     float m_focusDistance;
 
     Qt3DRender::QParameter *m_dofTextureParam;
-    Qt3DRender::QAbstractTexture *m_dofTexture = nullptr;
+    TransientTexture *m_dofTexture = nullptr;
     FullScreenQuad *m_fsQuad = nullptr;
 };
 } // namespace Kuesa
@@ -28,6 +28,7 @@ INCLUDEPATH += $$PWD
 
 HEADERS += \
     $$PWD/abstractpostprocessingeffect.h \
+    $$PWD/blurkernel_p.h \
     $$PWD/fullscreenquad.h \
     $$PWD/fxutils_p.h \
     $$PWD/gaussianblureffect.h \
@@ -39,6 +40,7 @@ HEADERS += \
 
 SOURCES += \
     $$PWD/abstractpostprocessingeffect.cpp \
+    $$PWD/blurkernel.cpp \
     $$PWD/fullscreenquad.cpp \
     $$PWD/fxutils.cpp \
     $$PWD/gaussianblureffect.cpp \
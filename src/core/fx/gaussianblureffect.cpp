@@ -29,7 +29,8 @@
 #include "gaussianblureffect.h"
 #include "fullscreenquad.h"
 #include "fxutils_p.h"
-#include "framegraphutils_p.h"
+#include "blurkernel_p.h"
+#include "transienttexture_p.h"
 
 #include <Qt3DRender/qtexture.h>
 #include <Qt3DRender/qrendertarget.h>
@@ -48,11 +49,26 @@
 #include <Qt3DRender/qcamera.h>
 #include <Qt3DRender/qlayerfilter.h>
 #include <Qt3DRender/qrendertargetselector.h>
+#include <QVector2D>
 
 QT_BEGIN_NAMESPACE
 
 using namespace Kuesa;
 
+namespace {
+
+// Values of the blurPass filter key
+const int horizontalBlurPass = 1;
+const int verticalBlurPass = 2;
+const int mipChainBlurPass = 3;
+const int mipChainUpsamplePass = 4;
+
+// Weight of a level of the mip chain when blended with the upsampled
+// smaller levels
+const float mipChainLevelWeight = 0.5f;
+
+} // namespace
+
 /*!
  * \class Kuesa::GaussianBlurEffect
  * \inheaderfile Kuesa/GaussianBlurEffect
@@ -64,6 +80,12 @@ using namespace Kuesa;
  * Gaussian blur to the scene. The amount of blurring can be adjusted
  * using the blurPassCount property.
  *
+ * When blurMode is MipChainBlur, the scene is instead blurred while being
+ * progressively downsampled to half, quarter, eighth... of its size and then
+ * upsampled back, which only shades a fraction of the pixels of the
+ * iterative blur. The amount of blurring is then adjusted using the
+ * mipLevelCount property.
+ *
  * \badcode
  * #include <Qt3DExtras/Qt3DWindow>
  * #include <ForwardRenderer>
@@ -100,6 +122,41 @@ using namespace Kuesa;
 
     This is the number of times to apply the blur filter. More passes result in
     stronger blurring effect but take longer to render.
+
+    Only used when blurMode is IterativeBlur.
+*/
+
+/*!
+    \enum GaussianBlurEffect::BlurMode
+
+    \value IterativeBlur
+    The blur filter is applied blurPassCount times at full resolution
+    \value MipChainBlur
+    The blur filter is applied while downsampling the scene mipLevelCount
+    times and the result is upsampled back to full resolution
+*/
+
+/*!
+    \property GaussianBlurEffect::blurMode
+
+    \brief the algorithm used to blur the scene
+
+    Defaults to IterativeBlur.
+
+    \since Kuesa 1.4
+*/
+
+/*!
+    \property GaussianBlurEffect::mipLevelCount
+
+    \brief the number of downsampled levels of the mip chain blur
+
+    Each level halves the resolution of the previous one and doubles the blur
+    radius. Defaults to 3, for half, quarter and eighth resolution levels.
+
+    Only used when blurMode is MipChainBlur.
+
+    \since Kuesa 1.4
 */
 
 /*!
@@ -149,12 +206,46 @@ using namespace Kuesa;
 
     This is the number of times to apply the blur filter. More passes result in
     stronger blurring effect but take longer to render.
+
+    Only used when blurMode is GaussianBlurEffect.IterativeBlur.
+*/
+
+/*!
+    \qmlproperty enumeration GaussianBlurEffect::blurMode
+
+    \brief the algorithm used to blur the scene
+
+    \list
+    \li GaussianBlurEffect.IterativeBlur: the blur filter is applied
+    blurPassCount times at full resolution (default)
+    \li GaussianBlurEffect.MipChainBlur: the blur filter is applied while
+    downsampling the scene mipLevelCount times and the result is upsampled
+    back to full resolution
+    \endlist
+
+    \since Kuesa 1.4
+*/
+
+/*!
+    \qmlproperty int GaussianBlurEffect::mipLevelCount
+
+    \brief the number of downsampled levels of the mip chain blur
+
+    Each level halves the resolution of the previous one and doubles the blur
+    radius. Defaults to 3, for half, quarter and eighth resolution levels.
+
+    Only used when blurMode is GaussianBlurEffect.MipChainBlur.
+
+    \since Kuesa 1.4
 */
 
 GaussianBlurEffect::GaussianBlurEffect(Qt3DCore::QNode *parent)
     : AbstractPostProcessingEffect(parent)
     , m_layer(nullptr)
     , m_blurPassCount(8)
+    , m_blurMode(IterativeBlur)
+    , m_mipLevelCount(3)
+    , m_windowSize(512, 512)
     , m_blurTextureOutput1(new Qt3DRender::QRenderTargetOutput)
     , m_blurTarget1(new Qt3DRender::QRenderTarget)
     , m_blurTarget2(new Qt3DRender::QRenderTarget)
@@ -183,13 +274,11 @@ GaussianBlurEffect::GaussianBlurEffect(Qt3DCore::QNode *parent)
     blurOutput2->setAttachmentPoint(Qt3DRender::QRenderTargetOutput::Color0);
     m_blurTarget2->addOutput(blurOutput2);
 
-    m_blurTexture2 = new Qt3DRender::QTexture2D;
-    m_blurTexture2->setFormat(FrameGraphUtils::hasHalfFloatRenderable() ? Qt3DRender::QAbstractTexture::RGBA16F : Qt3DRender::QAbstractTexture::RGBA8_UNorm);
-    m_blurTexture2->setGenerateMipMaps(false);
-    m_blurTexture2->setSize(512, 512);
-    blurOutput2->setTexture(m_blurTexture2);
-
-    m_blurTextureParam2->setValue(QVariant::fromValue(m_blurTexture2));
+    // Only used while the effect is rendered, a RenderTargetPool can share
+    // it with other effects
+    m_blurTexture2 = new TransientTexture(this);
+    m_blurTexture2->addOutput(blurOutput2);
+    m_blurTexture2->addParameter(m_blurTextureParam2);
 
     // Set up GaussianBlur Material
     auto blurMaterial = new Qt3DRender::QMaterial(m_rootFrameGraphNode.data());
@@ -199,8 +288,9 @@ GaussianBlurEffect::GaussianBlurEffect(Qt3DCore::QNode *parent)
     auto makeTechnique = [this](Qt3DRender::QGraphicsApiFilter::Api api,
                                 int majorVersion, int minorVersion,
                                 Qt3DRender::QGraphicsApiFilter::OpenGLProfile profile,
-                                const QString &vertexShader) -> Qt3DRender::QTechnique * {
+                                const QString &shaderDirectory) -> Qt3DRender::QTechnique * {
         auto *technique = FXUtils::makeTechnique(api, majorVersion, minorVersion, profile);
+        const QString vertexShader = shaderDirectory + QStringLiteral("fullscreen.vert");
 
         // create shader
         auto blurShader = new Qt3DRender::QShaderProgram(technique);
@@ -218,8 +308,21 @@ GaussianBlurEffect::GaussianBlurEffect(Qt3DCore::QNode *parent)
             return blurPass;
         };
 
-        createAndAddBlurPass(passName(), 1, m_blurTextureParam1);
-        createAndAddBlurPass(passName(), 2, m_blurTextureParam2);
+        createAndAddBlurPass(passName(), horizontalBlurPass, m_blurTextureParam1);
+        createAndAddBlurPass(passName(), verticalBlurPass, m_blurTextureParam2);
+
+        // Mip chain passes, their textures and steps are set by the render pass filters
+        auto createAndAddMipChainPass = [&](int pass, const QString &fragmentShader) {
+            auto mipChainPass = FXUtils::createRenderPass(passName(), pass);
+            auto mipChainShader = new Qt3DRender::QShaderProgram(mipChainPass);
+            mipChainShader->setVertexShaderCode(Qt3DRender::QShaderProgram::loadSource(QUrl(vertexShader)));
+            mipChainShader->setFragmentShaderCode(Qt3DRender::QShaderProgram::loadSource(QUrl(shaderDirectory + fragmentShader)));
+            mipChainPass->setShaderProgram(mipChainShader);
+            technique->addRenderPass(mipChainPass);
+        };
+
+        createAndAddMipChainPass(mipChainBlurPass, QStringLiteral("mipchain_blur.frag"));
+        createAndAddMipChainPass(mipChainUpsamplePass, QStringLiteral("mipchain_upsample.frag"));
 
         return technique;
     };
@@ -227,28 +330,28 @@ GaussianBlurEffect::GaussianBlurEffect(Qt3DCore::QNode *parent)
     auto *gl3Technique = makeTechnique(Qt3DRender::QGraphicsApiFilter::OpenGL,
                                        3, 2,
                                        Qt3DRender::QGraphicsApiFilter::CoreProfile,
-                                       QStringLiteral("qrc:/kuesa/shaders/gl3/fullscreen.vert"));
+                                       QStringLiteral("qrc:/kuesa/shaders/gl3/"));
 
     effect->addTechnique(gl3Technique);
 
     auto *es3Technique = makeTechnique(Qt3DRender::QGraphicsApiFilter::OpenGLES,
                                        3, 0,
                                        Qt3DRender::QGraphicsApiFilter::NoProfile,
-                                       QStringLiteral("qrc:/kuesa/shaders/es3/fullscreen.vert"));
+                                       QStringLiteral("qrc:/kuesa/shaders/es3/"));
 
     effect->addTechnique(es3Technique);
 
     auto *es2Technique = makeTechnique(Qt3DRender::QGraphicsApiFilter::OpenGLES,
                                        2, 0,
                                        Qt3DRender::QGraphicsApiFilter::NoProfile,
-                                       QStringLiteral("qrc:/kuesa/shaders/es2/fullscreen.vert"));
+                                       QStringLiteral("qrc:/kuesa/shaders/es2/"));
 
     effect->addTechnique(es2Technique);
 
 #if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
     auto rhiTechnique = makeTechnique(Qt3DRender::QGraphicsApiFilter::RHI, 1, 0,
                                       Qt3DRender::QGraphicsApiFilter::NoProfile,
-                                      QStringLiteral("qrc:/kuesa/shaders/gl45/fullscreen.vert"));
+                                      QStringLiteral("qrc:/kuesa/shaders/gl45/"));
 
     effect->addTechnique(rhiTechnique);
 #endif
@@ -267,38 +370,188 @@ GaussianBlurEffect::GaussianBlurEffect(Qt3DCore::QNode *parent)
     createBlurPasses();
 }
 
+/*!
+ * \internal
+ *
+ * Creates the blur passes matching the blur mode.
+ */
+void GaussianBlurEffect::createBlurPasses()
+{
+    if (m_blurMode == MipChainBlur)
+        createMipChainBlurPasses();
+    else
+        createIterativeBlurPasses();
+}
+
+/*!
+ * \internal
+ *
+ * Deletes the blur passes along with the render targets and textures of the
+ * mip chain.
+ */
+void GaussianBlurEffect::clearBlurPasses()
+{
+    const auto &childNodes = m_blurPassRoot->childNodes();
+    for (auto child : childNodes)
+        delete child;
+
+    for (const MipLevel &level : m_mipLevels) {
+        delete level.horizontalTexture;
+        delete level.blurredTexture;
+        delete level.upsampledTexture;
+    }
+    m_mipLevels.clear();
+    m_mipChainInputParams.clear();
+}
+
 /*!
  * \internal
  *
  * Helper function to create the correct number of blur passes and set their render
  * targets.
  */
-void GaussianBlurEffect::createBlurPasses()
+void GaussianBlurEffect::createIterativeBlurPasses()
 {
     for (int i = 0; i < m_blurPassCount - 1; ++i) {
         auto blurTargetSelectorA = new Qt3DRender::QRenderTargetSelector(m_blurPassRoot);
         blurTargetSelectorA->setTarget(m_blurTarget2);
 
-        auto blurPassFilterA = FXUtils::createRenderPassFilter(passName(), 1);
+        auto blurPassFilterA = FXUtils::createRenderPassFilter(passName(), horizontalBlurPass);
         blurPassFilterA->setParent(blurTargetSelectorA);
 
         auto blurTargetSelectorB = new Qt3DRender::QRenderTargetSelector(m_blurPassRoot);
         blurTargetSelectorB->setTarget(m_blurTarget1);
 
-        auto blurPassFilterB = FXUtils::createRenderPassFilter(passName(), 2);
+        auto blurPassFilterB = FXUtils::createRenderPassFilter(passName(), verticalBlurPass);
         blurPassFilterB->setParent(blurTargetSelectorB);
     }
     auto blurTargetSelectorA = new Qt3DRender::QRenderTargetSelector(m_blurPassRoot);
     blurTargetSelectorA->setTarget(m_blurTarget2);
 
-    auto blurPassFilterA = FXUtils::createRenderPassFilter(passName(), 1);
+    auto blurPassFilterA = FXUtils::createRenderPassFilter(passName(), horizontalBlurPass);
     blurPassFilterA->setParent(blurTargetSelectorA);
 
     //render one final blur, but not into any render target
-    auto blurPassFilterB = FXUtils::createRenderPassFilter(passName(), 2);
+    auto blurPassFilterB = FXUtils::createRenderPassFilter(passName(), verticalBlurPass);
     blurPassFilterB->setParent(m_blurPassRoot);
 }
 
+/*!
+ * \internal
+ *
+ * Creates the passes of the mip chain blur. Each level blurs the previous
+ * level horizontally while halving its size and then vertically. The levels
+ * are then upsampled from the smallest one, each upsampled level being
+ * blended with the blurred level of the same size. The final upsampling
+ * renders at full size in the target of the effect.
+ */
+void GaussianBlurEffect::createMipChainBlurPasses()
+{
+    auto createTargetSelector = [this](TransientTexture *texture) {
+        auto targetSelector = new Qt3DRender::QRenderTargetSelector(m_blurPassRoot);
+        auto target = new Qt3DRender::QRenderTarget(targetSelector);
+        auto output = new Qt3DRender::QRenderTargetOutput;
+        output->setAttachmentPoint(Qt3DRender::QRenderTargetOutput::Color0);
+        target->addOutput(output);
+        texture->addOutput(output);
+        targetSelector->setTarget(target);
+        return targetSelector;
+    };
+
+    auto createTextureParameter = [this](Qt3DRender::QRenderPassFilter *filter, const QString &name,
+                                         TransientTexture *texture) {
+        auto parameter = new Qt3DRender::QParameter(name, nullptr);
+        filter->addParameter(parameter);
+        if (texture) {
+            texture->addParameter(parameter);
+        } else {
+            parameter->setValue(QVariant::fromValue(m_blurTexture1));
+            m_mipChainInputParams.push_back(parameter);
+        }
+    };
+
+    auto createParameter = [](Qt3DRender::QRenderPassFilter *filter, const QString &name,
+                              const QVariant &value) {
+        auto parameter = new Qt3DRender::QParameter(name, value);
+        filter->addParameter(parameter);
+        return parameter;
+    };
+
+    const size_t levelCount = size_t(m_mipLevelCount);
+    m_mipLevels.resize(levelCount);
+
+    // Downsampling
+    for (size_t i = 0; i < levelCount; ++i) {
+        MipLevel &level = m_mipLevels[i];
+        level.horizontalTexture = new TransientTexture(this);
+        level.blurredTexture = new TransientTexture(this);
+
+        auto horizontalFilter = FXUtils::createRenderPassFilter(passName(), mipChainBlurPass,
+                                                                createTargetSelector(level.horizontalTexture));
+        createTextureParameter(horizontalFilter, QStringLiteral("sourceTexture"),
+                               i > 0 ? m_mipLevels[i - 1].blurredTexture : nullptr);
+        level.horizontalStepParam = createParameter(horizontalFilter, QStringLiteral("blurStep"), QVector2D());
+
+        auto verticalFilter = FXUtils::createRenderPassFilter(passName(), mipChainBlurPass,
+                                                              createTargetSelector(level.blurredTexture));
+        createTextureParameter(verticalFilter, QStringLiteral("sourceTexture"), level.horizontalTexture);
+        level.verticalStepParam = createParameter(verticalFilter, QStringLiteral("blurStep"), QVector2D());
+    }
+
+    // Upsampling, the last level is only read from
+    TransientTexture *lowTexture = m_mipLevels.back().blurredTexture;
+    for (size_t i = levelCount; i-- > 0;) {
+        MipLevel &level = m_mipLevels[i];
+        Qt3DRender::QRenderPassFilter *upsampleFilter = nullptr;
+        TransientTexture *upsampledTexture = nullptr;
+        if (i > 0) {
+            // Upsample into the size of the next bigger level
+            MipLevel &higherLevel = m_mipLevels[i - 1];
+            higherLevel.upsampledTexture = new TransientTexture(this);
+            upsampledTexture = higherLevel.upsampledTexture;
+            upsampleFilter = FXUtils::createRenderPassFilter(passName(), mipChainUpsamplePass,
+                                                             createTargetSelector(upsampledTexture));
+            createTextureParameter(upsampleFilter, QStringLiteral("highTexture"), higherLevel.blurredTexture);
+            createParameter(upsampleFilter, QStringLiteral("highWeight"), mipChainLevelWeight);
+        } else {
+            // Render one final upsampling, but not into any render target
+            upsampleFilter = FXUtils::createRenderPassFilter(passName(), mipChainUpsamplePass, m_blurPassRoot);
+            createTextureParameter(upsampleFilter, QStringLiteral("highTexture"), nullptr);
+            createParameter(upsampleFilter, QStringLiteral("highWeight"), 0.0f);
+        }
+        createTextureParameter(upsampleFilter, QStringLiteral("lowTexture"), lowTexture);
+        level.lowTexelSizeParam = createParameter(upsampleFilter, QStringLiteral("lowTexelSize"), QVector2D());
+        lowTexture = upsampledTexture;
+    }
+
+    updateMipChainSizes();
+}
+
+/*!
+ * \internal
+ *
+ * Resizes the textures of the mip chain and updates the steps of the
+ * passes sampling them.
+ */
+void GaussianBlurEffect::updateMipChainSizes()
+{
+    const std::vector<QSize> sizes = BlurKernel::mipChainSizes(m_windowSize, m_mipLevelCount);
+    for (size_t i = 0, m = m_mipLevels.size(); i < m; ++i) {
+        const MipLevel &level = m_mipLevels[i];
+        const QSize &size = sizes[i];
+        const QVector2D texelSize(1.0f / float(size.width()), 1.0f / float(size.height()));
+
+        level.horizontalTexture->setSize(size);
+        level.blurredTexture->setSize(size);
+        if (level.upsampledTexture)
+            level.upsampledTexture->setSize(size);
+
+        level.horizontalStepParam->setValue(QVector2D(texelSize.x(), 0.0f));
+        level.verticalStepParam->setValue(QVector2D(0.0f, texelSize.y()));
+        level.lowTexelSizeParam->setValue(texelSize);
+    }
+}
+
 /*!
  * Returns the frame graph subtree corresponding to the effect's implementation.
  *
@@ -325,6 +578,8 @@ void GaussianBlurEffect::setInputTexture(Qt3DRender::QAbstractTexture *texture)
     m_blurTexture1 = texture;
     m_blurTextureParam1->setValue(QVariant::fromValue(texture));
     m_blurTextureOutput1->setTexture(texture);
+    for (Qt3DRender::QParameter *parameter : m_mipChainInputParams)
+        parameter->setValue(QVariant::fromValue(texture));
 }
 
 /*!
@@ -340,7 +595,9 @@ void GaussianBlurEffect::setWindowSize(const QSize &size)
     m_widthParameter->setValue(float(size.width()));
     // only need to resize texture 2.
     // texture 1 is passed as "input texture" so should be resized elsewhere
-    m_blurTexture2->setSize(size.width(), size.height());
+    m_blurTexture2->setSize(size);
+    m_windowSize = size;
+    updateMipChainSizes();
 }
 
 /*!
@@ -366,14 +623,71 @@ void GaussianBlurEffect::setBlurPassCount(int blurPassCount)
     m_blurPassCount = blurPassCount;
 
     //just do the simple thing for now and delete all children and recreate.
-    const auto &childNodes = m_blurPassRoot->childNodes();
-    for (auto child : childNodes)
-        delete child;
-    createBlurPasses();
+    if (m_blurMode == IterativeBlur) {
+        clearBlurPasses();
+        createBlurPasses();
+    }
 
     emit blurPassCountChanged(m_blurPassCount);
 }
 
+/*!
+ * Returns the algorithm used to blur the scene.
+ *
+ * \sa GaussianBlurEffect::setBlurMode
+ */
+GaussianBlurEffect::BlurMode GaussianBlurEffect::blurMode() const
+{
+    return m_blurMode;
+}
+
+/*!
+ * Sets the algorithm used to blur the scene to \a blurMode.
+ *
+ * \sa GaussianBlurEffect::blurMode
+ */
+void GaussianBlurEffect::setBlurMode(GaussianBlurEffect::BlurMode blurMode)
+{
+    if (m_blurMode == blurMode)
+        return;
+
+    m_blurMode = blurMode;
+    clearBlurPasses();
+    createBlurPasses();
+
+    emit blurModeChanged(m_blurMode);
+}
+
+/*!
+ * Returns the number of downsampled levels of the mip chain blur.
+ *
+ * \sa GaussianBlurEffect::setMipLevelCount
+ */
+int GaussianBlurEffect::mipLevelCount() const
+{
+    return m_mipLevelCount;
+}
+
+/*!
+ * Sets the number of downsampled levels of the mip chain blur to
+ * \a mipLevelCount.
+ *
+ * \sa GaussianBlurEffect::mipLevelCount
+ */
+void GaussianBlurEffect::setMipLevelCount(int mipLevelCount)
+{
+    if (m_mipLevelCount == mipLevelCount || mipLevelCount <= 0)
+        return;
+
+    m_mipLevelCount = mipLevelCount;
+    if (m_blurMode == MipChainBlur) {
+        clearBlurPasses();
+        createBlurPasses();
+    }
+
+    emit mipLevelCountChanged(m_mipLevelCount);
+}
+
 QString GaussianBlurEffect::passName() const
 {
     return QStringLiteral("blurPass");
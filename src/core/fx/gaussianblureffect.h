@@ -31,6 +31,8 @@
 
 #include <Kuesa/kuesa_global.h>
 #include <Kuesa/abstractpostprocessingeffect.h>
+#include <QSize>
+#include <vector>
 
 QT_BEGIN_NAMESPACE
 
@@ -48,14 +50,23 @@ namespace Kuesa {
 
 class GaussianBlurMaterial;
 class FullScreenQuad;
+class TransientTexture;
 
 class KUESASHARED_EXPORT GaussianBlurEffect : public AbstractPostProcessingEffect
 {
     Q_OBJECT
 
     Q_PROPERTY(int blurPassCount READ blurPassCount WRITE setBlurPassCount NOTIFY blurPassCountChanged)
+    Q_PROPERTY(Kuesa::GaussianBlurEffect::BlurMode blurMode READ blurMode WRITE setBlurMode NOTIFY blurModeChanged)
+    Q_PROPERTY(int mipLevelCount READ mipLevelCount WRITE setMipLevelCount NOTIFY mipLevelCountChanged)
 
 public:
+    enum BlurMode {
+        IterativeBlur = 0,
+        MipChainBlur
+    };
+    Q_ENUM(BlurMode)
+
     GaussianBlurEffect(Qt3DCore::QNode *parent = nullptr);
     FrameGraphNodePtr frameGraphSubTree() const override;
     QVector<Qt3DRender::QLayer *> layers() const override;
@@ -63,21 +74,43 @@ public:
     void setInputTexture(Qt3DRender::QAbstractTexture *texture) override;
     void setWindowSize(const QSize &size) override;
     int blurPassCount() const;
+    BlurMode blurMode() const;
+    int mipLevelCount() const;
 
 public Q_SLOTS:
     void setBlurPassCount(int blurPassCount);
+    void setBlurMode(Kuesa::GaussianBlurEffect::BlurMode blurMode);
+    void setMipLevelCount(int mipLevelCount);
 
 Q_SIGNALS:
     void blurPassCountChanged(int blurPassCount);
+    void blurModeChanged(Kuesa::GaussianBlurEffect::BlurMode blurMode);
+    void mipLevelCountChanged(int mipLevelCount);
 
 private:
     void createBlurPasses();
+    void createIterativeBlurPasses();
+    void createMipChainBlurPasses();
+    void clearBlurPasses();
+    void updateMipChainSizes();
     QString passName() const;
 
+    struct MipLevel {
+        TransientTexture *horizontalTexture = nullptr;
+        TransientTexture *blurredTexture = nullptr;
+        TransientTexture *upsampledTexture = nullptr;
+        Qt3DRender::QParameter *horizontalStepParam = nullptr;
+        Qt3DRender::QParameter *verticalStepParam = nullptr;
+        Qt3DRender::QParameter *lowTexelSizeParam = nullptr;
+    };
+
     FrameGraphNodePtr m_rootFrameGraphNode;
     Qt3DRender::QLayer *m_layer;
 
     int m_blurPassCount;
+    BlurMode m_blurMode;
+    int m_mipLevelCount;
+    QSize m_windowSize;
 
     //Textures and targets
     Qt3DRender::QRenderTargetOutput *m_blurTextureOutput1;
@@ -85,7 +118,7 @@ private:
     Qt3DRender::QRenderTarget *m_blurTarget2;
 
     Qt3DRender::QAbstractTexture *m_blurTexture1;
-    Qt3DRender::QAbstractTexture *m_blurTexture2;
+    TransientTexture *m_blurTexture2;
 
     Qt3DRender::QFrameGraphNode *m_blurPassRoot;
 
@@ -94,6 +127,10 @@ private:
     Qt3DRender::QParameter *m_widthParameter;
     Qt3DRender::QParameter *m_heightParameter;
     FullScreenQuad *m_fsQuad;
+
+    // Parameters sampling the input texture in mip chain mode
+    std::vector<Qt3DRender::QParameter *> m_mipChainInputParams;
+    std::vector<MipLevel> m_mipLevels;
 };
 } // namespace Kuesa
 QT_END_NAMESPACE
@@ -27,6 +27,7 @@
 */
 
 #include "embeddedtextureimage_p.h"
+#include "kuesa_p.h"
 
 QT_BEGIN_NAMESPACE
 using namespace Kuesa;
@@ -39,8 +40,9 @@ class EmbeddedTextureImageFunctor : public Qt3DRender::QTextureImageDataGenerato
 public:
     QT_WARNING_PUSH
     QT_WARNING_DISABLE_DEPRECATED
-    EmbeddedTextureImageFunctor(const QImage &image)
+    EmbeddedTextureImageFunctor(const QImage &image, const QByteArray &encodedData)
         : m_image(image)
+        , m_encodedData(encodedData)
     {
     }
     QT_WARNING_POP
@@ -48,14 +50,24 @@ public:
     Qt3DRender::QTextureImageDataPtr operator()() override
     {
         Qt3DRender::QTextureImageDataPtr dataPtr = Qt3DRender::QTextureImageDataPtr::create();
-        dataPtr->setImage(m_image);
+        if (!m_encodedData.isEmpty()) {
+            QImage image;
+            if (!image.loadFromData(m_encodedData))
+                qCWarning(Kuesa::kuesa) << "Failed to decode embedded image";
+            dataPtr->setImage(image);
+        } else {
+            dataPtr->setImage(m_image);
+        }
         return dataPtr;
     }
 
     bool operator==(const Qt3DRender::QTextureImageDataGenerator &other) const override
     {
         const EmbeddedTextureImageFunctor *otherFunctor = functor_cast<EmbeddedTextureImageFunctor>(&other);
-        return (otherFunctor != nullptr && otherFunctor->m_image == m_image);
+        // Encoded data is shared, not copied, compare storage rather than content
+        return (otherFunctor != nullptr && otherFunctor->m_image == m_image &&
+                otherFunctor->m_encodedData.constData() == m_encodedData.constData() &&
+                otherFunctor->m_encodedData.size() == m_encodedData.size());
     }
 
     QT_WARNING_PUSH
@@ -65,6 +77,7 @@ public:
 
 private:
     QImage m_image;
+    QByteArray m_encodedData;
 };
 
 } // namespace
@@ -74,13 +87,18 @@ EmbeddedTextureImage::EmbeddedTextureImage(const QImage &image, Qt3DCore::QNode
 {
 }
 
+EmbeddedTextureImage::EmbeddedTextureImage(const QByteArray &encodedData, Qt3DCore::QNode *parent)
+    : Qt3DRender::QAbstractTextureImage(parent), m_encodedData(encodedData)
+{
+}
+
 EmbeddedTextureImage::~EmbeddedTextureImage()
 {
 }
 
 Qt3DRender::QTextureImageDataGeneratorPtr EmbeddedTextureImage::dataGenerator() const
 {
-    return Qt3DRender::QTextureImageDataGeneratorPtr(new EmbeddedTextureImageFunctor(m_image));
+    return Qt3DRender::QTextureImageDataGeneratorPtr(new EmbeddedTextureImageFunctor(m_image, m_encodedData));
 }
 
 QImage EmbeddedTextureImage::image()
@@ -88,4 +106,9 @@ QImage EmbeddedTextureImage::image()
     return m_image;
 }
 
+QByteArray EmbeddedTextureImage::encodedData() const
+{
+    return m_encodedData;
+}
+
 QT_END_NAMESPACE
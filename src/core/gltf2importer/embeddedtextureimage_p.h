@@ -40,6 +40,8 @@
 #include <Kuesa/private/kuesa_global_p.h>
 
 #include <Qt3DRender/qabstracttextureimage.h>
+#include <QByteArray>
+#include <QImage>
 
 QT_BEGIN_NAMESPACE
 
@@ -50,13 +52,18 @@ class KUESA_PRIVATE_EXPORT EmbeddedTextureImage : public Qt3DRender::QAbstractTe
 {
 public:
     EmbeddedTextureImage(const QImage &image, QNode *parent = nullptr);
+    // Decoding is deferred to the data generator, i.e. until the image is
+    // used by a texture loaded by the backend
+    EmbeddedTextureImage(const QByteArray &encodedData, QNode *parent = nullptr);
     ~EmbeddedTextureImage();
 
     Qt3DRender::QTextureImageDataGeneratorPtr dataGenerator() const override;
     QImage image();
+    QByteArray encodedData() const;
 
 private:
     QImage m_image;
+    QByteArray m_encodedData;
 };
 
 } // namespace GLTF2Import
@@ -320,6 +320,7 @@ Qt3DRender::QGeometryRenderer *GLTF2Context::getOrAllocateGeometryRenderer(Primi
     // Use Resource from Cache
     if (renderer) {
         primitive.primitiveRenderer = renderer;
+        primitive.packedMorphTargets = m_sharedPackedMorphTargets.value(primitive.key);
         qCDebug(Kuesa::kuesa) << "Reusing cached geometry renderer";
         return primitive.primitiveRenderer;
     }
@@ -327,6 +328,12 @@ Qt3DRender::QGeometryRenderer *GLTF2Context::getOrAllocateGeometryRenderer(Primi
     // Create the geometry renderer and store it in the cache if successful
     if (m_primitiveBuilder->generateGeometryRendererForPrimitive(primitive)) {
         m_sharedPrimitives.addResourceToCache(primitive, primitive.primitiveRenderer);
+        if (!primitive.key.isEmpty()) {
+            if (primitive.packedMorphTargets)
+                m_sharedPackedMorphTargets.insert(primitive.key, primitive.packedMorphTargets);
+            else
+                m_sharedPackedMorphTargets.remove(primitive.key);
+        }
         return primitive.primitiveRenderer;
     }
 
@@ -711,6 +718,9 @@ Qt3DRender::QAbstractTexture *GLTF2Context::getOrAllocateTexture(Texture &textur
                 ti->setSource(image.url);
                 ti->setMirrored(false);
                 textureImage = ti;
+            } else if (m_options.lazyTextureLoading()) {
+                // Only decoded once the texture gets used
+                textureImage = new EmbeddedTextureImage(image.data);
             } else {
                 QImage qimage;
                 if (!qimage.loadFromData(image.data)) {
@@ -237,6 +237,8 @@ private:
     AssetCache<Texture, Qt3DRender::QAbstractTexture> m_sharedTextures;
     AssetCache<Primitive, Qt3DRender::QGeometryRenderer> m_sharedPrimitives;
     AssetCache<BufferView, Qt3DGeometry::QBuffer> m_sharedBufferViews;
+    // Packed morph targets of the cached primitives, by primitive key
+    QHash<QString, PackedMorphTargetsPtr> m_sharedPackedMorphTargets;
 
     std::unique_ptr<PrimitiveBuilder> m_primitiveBuilder;
 };
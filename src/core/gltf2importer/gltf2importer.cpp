@@ -402,6 +402,14 @@ void GLTF2Importer::setOptions(const Kuesa::GLTF2Import::GLTF2Options &options)
 {
     GLTF2Import::GLTF2Options *m_options = m_context->options();
     m_options->setGenerateTangents(options.generateTangents());
+    m_options->setGenerateNormals(options.generateNormals());
+    m_options->setLodLevelCount(options.lodLevelCount());
+    m_options->setLodError(options.lodError());
+    m_options->setLodErrorMetric(options.lodErrorMetric());
+    m_options->setPackedMorphTargets(options.packedMorphTargets());
+    m_options->setLazyTextureLoading(options.lazyTextureLoading());
+    m_options->setTextureMemoryBudget(options.textureMemoryBudget());
+    m_options->setTextureEvictionDelay(options.textureEvictionDelay());
 }
 
 void GLTF2Importer::setActiveSceneIndex(int index)
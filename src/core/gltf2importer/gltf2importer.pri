@@ -49,6 +49,7 @@ SOURCES += \
     $$PWD/skinparser.cpp \
     $$PWD/gltf2uri.cpp \
     $$PWD/meshparser_utils.cpp \
+    $$PWD/meshsimplifier.cpp \
     $$PWD/gltf2options.cpp \
     $$PWD/embeddedtextureimage.cpp
 
@@ -78,6 +79,7 @@ HEADERS += \
     $$PWD/gltf2keys_p.h \
     $$PWD/gltf2uri_p.h \
     $$PWD/meshparser_utils_p.h \
+    $$PWD/meshsimplifier_p.h \
     $$PWD/gltf2options.h \
     $$PWD/embeddedtextureimage_p.h
 
@@ -28,6 +28,8 @@
 
 #include "gltf2options.h"
 
+#include <algorithm>
+
 /*!
  * \class Kuesa::GLTF2Import::GLTF2Options
  * \inheaderfile Kuesa/GLTF2Options
@@ -41,6 +43,27 @@
  * for all the primitives which don't have tangents.
  * \li generateNormals: If true, the importer will generate flat normals
  * for all the primitives which don't have normals.
+ * \li lodLevelCount: Number of simplified levels of detail the importer
+ * will generate for each triangle primitive, in addition to the original
+ * geometry. Defaults to 0 (no level of detail generation).
+ * \li lodError: Maximum geometric error allowed for the first generated
+ * level of detail. Each subsequent level doubles the allowed error.
+ * \li lodErrorMetric: Whether lodError is expressed relative to the
+ * diagonal of the primitive bounding box (RelativeLodError, default) or as
+ * an absolute distance in model units (AbsoluteLodError).
+ * \li packedMorphTargets: If true, morph targets are packed in a single
+ * sparse buffer and blended on the CPU into dedicated vertex buffers instead
+ * of being exposed as one vertex attribute per target. This mode is always
+ * used for meshes with more than 8 morph targets.
+ * \li lazyTextureLoading: If true, textures start as 1x1 placeholders and
+ * their images are only decoded and uploaded once a material using them is
+ * attached to an enabled entity rendering a mesh. Requires a SceneEntity.
+ * \li textureMemoryBudget: When lazyTextureLoading is enabled, estimated
+ * number of bytes of texture memory above which textures that haven't been
+ * used for textureEvictionDelay are evicted, least recently used first.
+ * Defaults to 0, which never evicts textures.
+ * \li textureEvictionDelay: Time in milliseconds during which a texture must
+ * have been unused before it can be evicted. Defaults to 10000.
  * \endlist
  */
 
@@ -57,6 +80,27 @@
  * for all the primitives which don't have tangents.
  * \li generateNormals: If true, the importer will generate flat normals
  * for all the primitives which don't have normals.
+ * \li lodLevelCount: Number of simplified levels of detail the importer
+ * will generate for each triangle primitive, in addition to the original
+ * geometry. Defaults to 0 (no level of detail generation).
+ * \li lodError: Maximum geometric error allowed for the first generated
+ * level of detail. Each subsequent level doubles the allowed error.
+ * \li lodErrorMetric: Whether lodError is expressed relative to the
+ * diagonal of the primitive bounding box (RelativeLodError, default) or as
+ * an absolute distance in model units (AbsoluteLodError).
+ * \li packedMorphTargets: If true, morph targets are packed in a single
+ * sparse buffer and blended on the CPU into dedicated vertex buffers instead
+ * of being exposed as one vertex attribute per target. This mode is always
+ * used for meshes with more than 8 morph targets.
+ * \li lazyTextureLoading: If true, textures start as 1x1 placeholders and
+ * their images are only decoded and uploaded once a material using them is
+ * attached to an enabled entity rendering a mesh. Requires a SceneEntity.
+ * \li textureMemoryBudget: When lazyTextureLoading is enabled, estimated
+ * number of bytes of texture memory above which textures that haven't been
+ * used for textureEvictionDelay are evicted, least recently used first.
+ * Defaults to 0, which never evicts textures.
+ * \li textureEvictionDelay: Time in milliseconds during which a texture must
+ * have been unused before it can be evicted. Defaults to 10000.
  * \endlist
  */
 
@@ -66,6 +110,13 @@ Kuesa::GLTF2Import::GLTF2Options::GLTF2Options()
     : QObject(nullptr)
     , m_generateTangents(false)
     , m_generateNormals(false)
+    , m_lodLevelCount(0)
+    , m_lodError(0.01f)
+    , m_lodErrorMetric(RelativeLodError)
+    , m_packedMorphTargets(false)
+    , m_lazyTextureLoading(false)
+    , m_textureMemoryBudget(0)
+    , m_textureEvictionDelay(10000)
 {
 }
 
@@ -95,4 +146,98 @@ void Kuesa::GLTF2Import::GLTF2Options::setGenerateNormals(bool generateNormals)
     emit generateNormalsChanged(m_generateNormals);
 }
 
+int Kuesa::GLTF2Import::GLTF2Options::lodLevelCount() const
+{
+    return m_lodLevelCount;
+}
+
+float Kuesa::GLTF2Import::GLTF2Options::lodError() const
+{
+    return m_lodError;
+}
+
+Kuesa::GLTF2Import::GLTF2Options::LodErrorMetric Kuesa::GLTF2Import::GLTF2Options::lodErrorMetric() const
+{
+    return m_lodErrorMetric;
+}
+
+void Kuesa::GLTF2Import::GLTF2Options::setLodLevelCount(int lodLevelCount)
+{
+    lodLevelCount = std::max(lodLevelCount, 0);
+    if (lodLevelCount == m_lodLevelCount)
+        return;
+    m_lodLevelCount = lodLevelCount;
+    emit lodLevelCountChanged(m_lodLevelCount);
+}
+
+void Kuesa::GLTF2Import::GLTF2Options::setLodError(float lodError)
+{
+    if (qFuzzyCompare(lodError, m_lodError))
+        return;
+    m_lodError = lodError;
+    emit lodErrorChanged(m_lodError);
+}
+
+void Kuesa::GLTF2Import::GLTF2Options::setLodErrorMetric(LodErrorMetric lodErrorMetric)
+{
+    if (lodErrorMetric == m_lodErrorMetric)
+        return;
+    m_lodErrorMetric = lodErrorMetric;
+    emit lodErrorMetricChanged(m_lodErrorMetric);
+}
+
+bool Kuesa::GLTF2Import::GLTF2Options::packedMorphTargets() const
+{
+    return m_packedMorphTargets;
+}
+
+void Kuesa::GLTF2Import::GLTF2Options::setPackedMorphTargets(bool packedMorphTargets)
+{
+    if (packedMorphTargets == m_packedMorphTargets)
+        return;
+    m_packedMorphTargets = packedMorphTargets;
+    emit packedMorphTargetsChanged(m_packedMorphTargets);
+}
+
+bool Kuesa::GLTF2Import::GLTF2Options::lazyTextureLoading() const
+{
+    return m_lazyTextureLoading;
+}
+
+void Kuesa::GLTF2Import::GLTF2Options::setLazyTextureLoading(bool lazyTextureLoading)
+{
+    if (lazyTextureLoading == m_lazyTextureLoading)
+        return;
+    m_lazyTextureLoading = lazyTextureLoading;
+    emit lazyTextureLoadingChanged(m_lazyTextureLoading);
+}
+
+qint64 Kuesa::GLTF2Import::GLTF2Options::textureMemoryBudget() const
+{
+    return m_textureMemoryBudget;
+}
+
+void Kuesa::GLTF2Import::GLTF2Options::setTextureMemoryBudget(qint64 textureMemoryBudget)
+{
+    textureMemoryBudget = std::max(textureMemoryBudget, qint64(0));
+    if (textureMemoryBudget == m_textureMemoryBudget)
+        return;
+    m_textureMemoryBudget = textureMemoryBudget;
+    emit textureMemoryBudgetChanged(m_textureMemoryBudget);
+}
+
+int Kuesa::GLTF2Import::GLTF2Options::textureEvictionDelay() const
+{
+    return m_textureEvictionDelay;
+}
+
+void Kuesa::GLTF2Import::GLTF2Options::setTextureEvictionDelay(int textureEvictionDelay)
+{
+    textureEvictionDelay = std::max(textureEvictionDelay, 0);
+    if (textureEvictionDelay == m_textureEvictionDelay)
+        return;
+    m_textureEvictionDelay = textureEvictionDelay;
+    emit textureEvictionDelayChanged(m_textureEvictionDelay);
+}
+
 QT_END_NAMESPACE
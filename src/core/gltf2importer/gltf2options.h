@@ -42,23 +42,64 @@ class KUESASHARED_EXPORT GLTF2Options : public QObject
     Q_OBJECT
     Q_PROPERTY(bool generateTangents READ generateTangents WRITE setGenerateTangents NOTIFY generateTangentsChanged)
     Q_PROPERTY(bool generateNormals READ generateNormals WRITE setGenerateNormals NOTIFY generateNormalsChanged)
+    Q_PROPERTY(int lodLevelCount READ lodLevelCount WRITE setLodLevelCount NOTIFY lodLevelCountChanged)
+    Q_PROPERTY(float lodError READ lodError WRITE setLodError NOTIFY lodErrorChanged)
+    Q_PROPERTY(LodErrorMetric lodErrorMetric READ lodErrorMetric WRITE setLodErrorMetric NOTIFY lodErrorMetricChanged)
+    Q_PROPERTY(bool packedMorphTargets READ packedMorphTargets WRITE setPackedMorphTargets NOTIFY packedMorphTargetsChanged)
+    Q_PROPERTY(bool lazyTextureLoading READ lazyTextureLoading WRITE setLazyTextureLoading NOTIFY lazyTextureLoadingChanged)
+    Q_PROPERTY(qint64 textureMemoryBudget READ textureMemoryBudget WRITE setTextureMemoryBudget NOTIFY textureMemoryBudgetChanged)
+    Q_PROPERTY(int textureEvictionDelay READ textureEvictionDelay WRITE setTextureEvictionDelay NOTIFY textureEvictionDelayChanged)
 public:
+    enum LodErrorMetric {
+        RelativeLodError = 0,
+        AbsoluteLodError
+    };
+    Q_ENUM(LodErrorMetric)
+
     GLTF2Options();
 
     bool generateTangents() const;
     bool generateNormals() const;
+    int lodLevelCount() const;
+    float lodError() const;
+    LodErrorMetric lodErrorMetric() const;
+    bool packedMorphTargets() const;
+    bool lazyTextureLoading() const;
+    qint64 textureMemoryBudget() const;
+    int textureEvictionDelay() const;
 
 public Q_SLOTS:
     void setGenerateTangents(bool generateTangents);
     void setGenerateNormals(bool generateNormals);
+    void setLodLevelCount(int lodLevelCount);
+    void setLodError(float lodError);
+    void setLodErrorMetric(LodErrorMetric lodErrorMetric);
+    void setPackedMorphTargets(bool packedMorphTargets);
+    void setLazyTextureLoading(bool lazyTextureLoading);
+    void setTextureMemoryBudget(qint64 textureMemoryBudget);
+    void setTextureEvictionDelay(int textureEvictionDelay);
 
 Q_SIGNALS:
     void generateTangentsChanged(bool generateTangents);
     void generateNormalsChanged(bool generateNormals);
+    void lodLevelCountChanged(int lodLevelCount);
+    void lodErrorChanged(float lodError);
+    void lodErrorMetricChanged(LodErrorMetric lodErrorMetric);
+    void packedMorphTargetsChanged(bool packedMorphTargets);
+    void lazyTextureLoadingChanged(bool lazyTextureLoading);
+    void textureMemoryBudgetChanged(qint64 textureMemoryBudget);
+    void textureEvictionDelayChanged(int textureEvictionDelay);
 
 private:
     bool m_generateTangents;
     bool m_generateNormals;
+    int m_lodLevelCount;
+    float m_lodError;
+    LodErrorMetric m_lodErrorMetric;
+    bool m_packedMorphTargets;
+    bool m_lazyTextureLoading;
+    qint64 m_textureMemoryBudget;
+    int m_textureEvictionDelay;
 };
 
 } // namespace GLTF2Import
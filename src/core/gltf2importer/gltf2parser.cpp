@@ -56,6 +56,10 @@
 #include "spotlight.h"
 #include "placeholder.h"
 #include <Kuesa/private/kuesaentity_p.h>
+#include <Kuesa/private/morphtargetblender_p.h>
+#include <Kuesa/private/packedmorphtargets_p.h>
+#include <Kuesa/private/profiler_p.h>
+#include <Kuesa/private/texturestreamer_p.h>
 
 #include <QElapsedTimer>
 #include <QFile>
@@ -85,9 +89,11 @@
 #if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
 #include <Qt3DCore/QBuffer>
 #include <Qt3DCore/QAttribute>
+#include <Qt3DCore/QGeometry>
 #else
 #include <Qt3DRender/QBuffer>
 #include <Qt3DRender/QAttribute>
+#include <Qt3DRender/QGeometry>
 #endif
 
 QT_BEGIN_NAMESPACE
@@ -334,33 +340,49 @@ bool GLTF2Parser::doParse(const QString &filePath)
 
 void GLTF2Parser::generateContent()
 {
+    ProfilerScope generateScope("importer", "generateContent");
     QElapsedTimer t;
     qint64 elapsed = 0;
     qCDebug(gltf2_parser_profiling) << "GLTF2 Qt3D Scene contruction starting";
     t.start();
 
     // Build hierarchies for Entities and QJoints
-    buildEntitiesAndJointsGraph();
+    {
+        ProfilerScope scope("importer", "entitiesAndJointsGraph");
+        buildEntitiesAndJointsGraph();
+    }
     elapsed = t.elapsed();
     qCDebug(gltf2_parser_profiling) << "GLTF2 Qt3D Building Entities and Joints Graphes in (" << elapsed << "ms)";
 
     // Generate Qt3D content for skeletons
-    generateSkeletonContent();
+    {
+        ProfilerScope scope("importer", "skeletonContent");
+        generateSkeletonContent();
+    }
     qCDebug(gltf2_parser_profiling) << "GLTF2 Qt3D Building Skeleton in (" << t.elapsed() - elapsed << "ms)";
     elapsed = t.elapsed();
 
     // Generate Qt3D data for the nodes based on their type
-    generateTreeNodeContent();
+    {
+        ProfilerScope scope("importer", "treeNodeContent");
+        generateTreeNodeContent();
+    }
     qCDebug(gltf2_parser_profiling) << "GLTF2 Qt3D Building Entities Tree Content in (" << t.elapsed() - elapsed << "ms)";
     elapsed = t.elapsed();
 
     // Generate Qt3D content for animations
-    generateAnimationContent();
+    {
+        ProfilerScope scope("importer", "animationContent");
+        generateAnimationContent();
+    }
     qCDebug(gltf2_parser_profiling) << "GLTF2 Qt3D Building Animation Content in (" << t.elapsed() - elapsed << "ms)";
     elapsed = t.elapsed();
 
     // Build Scene Roots
-    buildSceneRootEntities();
+    {
+        ProfilerScope scope("importer", "sceneRoots");
+        buildSceneRootEntities();
+    }
     qCDebug(gltf2_parser_profiling) << "GLTF2 Qt3D Building Scene Roots in (" << t.elapsed() - elapsed << "ms)";
     elapsed = t.elapsed();
 
@@ -369,7 +391,10 @@ void GLTF2Parser::generateContent()
     elapsed = t.elapsed();
 
     // Fill in Asset Collections
-    addResourcesToSceneEntityCollections();
+    {
+        ProfilerScope scope("importer", "addToCollections");
+        addResourcesToSceneEntityCollections();
+    }
     qCDebug(gltf2_parser_profiling) << "GLTF2 Qt3D Resources added to collection (" << t.elapsed() - elapsed << "ms)";
 
     qCDebug(gltf2_parser_profiling) << "GLTF2 Scene contruction total (" << t.elapsed() << "ms)";
@@ -579,6 +604,7 @@ QVector<KeyParserFuncPair> GLTF2Parser::prepareParsers()
 
 bool GLTF2Parser::parseJSON(const QByteArray &jsonData, const QString &basePath, const QString &filename)
 {
+    ProfilerScope scope("importer", "parseJSON");
     QJsonDocument jsonDocument = QJsonDocument::fromJson(jsonData);
     if (jsonDocument.isNull() || !jsonDocument.isObject()) {
         qCWarning(Kuesa::kuesa) << "File is not a valid json document";
@@ -773,6 +799,15 @@ void GLTF2Parser::addResourcesToSceneEntityCollections()
                             addToCollectionWithUniqueName(m_sceneEntity->textures(), QStringLiteral("KuesaTexture_%1").arg(i), texture.texture);
                     });
 
+        // Textures only get their content once used by a visible entity
+        if (m_context->options()->lazyTextureLoading()) {
+            TextureStreamer *streamer = TextureStreamer::streamer(m_sceneEntity);
+            streamer->policy()->setMemoryBudget(m_context->options()->textureMemoryBudget());
+            streamer->policy()->setEvictionDelay(m_context->options()->textureEvictionDelay());
+            for (int i = 0, m = m_context->texturesCount(); i < m; ++i)
+                streamer->manage(m_context->texture(i).texture);
+        }
+
         if (m_sceneEntity->animationClips())
             addAssetsIntoCollection<Animation>(
                     [this](const Animation &animation, int) { addToCollectionWithUniqueName(m_sceneEntity->animationClips(), animation.name, animation.clip); },
@@ -1295,16 +1330,31 @@ void GLTF2Parser::createMesh(const TreeNode &node)
             // Store this Entity to Entity map so we can use it later on the animation generation
             primitiveData.primitiveRenderer->setParent(m_contentRootEntity);
             m_context->addPrimitiveEntityToEntity(node.entity, primitiveEntity);
-            primitiveEntity->addComponent(primitiveData.primitiveRenderer);
+
+            // Packed morph targets are blended on the CPU into a renderer
+            // dedicated to this node, the shared one holds the rest pose
+            const PackedMorphTargetsPtr &packedMorphTargets = primitiveData.packedMorphTargets;
+            const bool usesPackedMorphTargets = morphController != nullptr && packedMorphTargets;
+            if (usesPackedMorphTargets) {
+                Qt3DRender::QGeometryRenderer *morphedRenderer =
+                        MorphTargetBlender::createMorphedRenderer(primitiveData.primitiveRenderer,
+                                                                  packedMorphTargets,
+                                                                  morphController);
+                morphedRenderer->setParent(m_contentRootEntity);
+                primitiveEntity->addComponent(morphedRenderer);
+            } else {
+                primitiveEntity->addComponent(primitiveData.primitiveRenderer);
+            }
 
             // Add morph controller if it is not null
             if (morphController != nullptr)
                 primitiveEntity->addComponent(morphController);
 
             // Add material for mesh
+            const bool hasShaderMorphTargets = hasMorphTargets && !usesPackedMorphTargets;
             GLTF2Material *material = createMaterial(meshData, primitiveData,
-                                                     isSkinned, hasMorphTargets);
-            if (hasMorphTargets)
+                                                     isSkinned, hasShaderMorphTargets);
+            if (hasShaderMorphTargets)
                 material->setMorphController(morphController);
 
             primitiveEntity->addComponent(material);
@@ -1407,24 +1457,21 @@ MorphController *GLTF2Parser::createMorphTarget(const TreeNode &node)
     const Mesh &meshData = m_context->mesh(meshId);
     const QVector<float> nodeDefaultWeight = node.morphTargetWeights;
     const QVector<float> meshDefaultWeights = meshData.morphTargetWeights;
-    const quint8 morphTargetCount = std::min(meshData.morphTargetCount, quint8(8));
-
-    if (meshData.morphTargetCount > 8)
-        qCWarning(Kuesa::kuesa) << "Kuesa only supports up to 8 morph targets per mesh";
+    const int morphTargetCount = meshData.morphTargetCount;
 
     // node Default Weights have priority over the mesh ones
     MorphController *morphController = new MorphController(m_contentRootEntity);
     morphController->setCount(morphTargetCount);
 
-    QVariantList defaultWeights;
+    QVector<float> defaultWeights;
     defaultWeights.reserve(morphTargetCount);
 
-    for (int i = 0, m = morphTargetCount; i < m; ++i) {
-        const float defaultWeight = (i < nodeDefaultWeight.size()) ? nodeDefaultWeight.at(i) : meshDefaultWeights.at(i);
+    for (int i = 0; i < morphTargetCount; ++i) {
+        const float defaultWeight = (i < nodeDefaultWeight.size()) ? nodeDefaultWeight.at(i) : meshDefaultWeights.value(i);
         defaultWeights.push_back(defaultWeight);
     }
 
-    morphController->setMorphWeights(defaultWeights);
+    morphController->setWeights(defaultWeights);
 
     return morphController;
 }
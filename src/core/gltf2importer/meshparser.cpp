@@ -32,7 +32,9 @@
 #include "gltf2context_p.h"
 #include "kuesa_p.h"
 #include "meshparser_utils_p.h"
+#include "meshsimplifier_p.h"
 #include "assetkeyparser_p.h"
+#include <Kuesa/private/packedmorphtargets_p.h>
 
 #if defined(KUESA_DRACO_COMPRESSION)
 #include <Kuesa/private/draco_prefix_p.h>
@@ -43,6 +45,7 @@
 #include <QJsonArray>
 #include <QDebug>
 #include <QElapsedTimer>
+#include <cstring>
 
 #if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
 #include <Qt3DCore/QAttribute>
@@ -126,6 +129,67 @@ QAttribute *decodeAttribute(const draco::PointCloud *pointCould,
 }
 #endif
 
+// Bounds are taken from the POSITION accessor min/max when available and
+// computed from the vertices otherwise. Morph target position deltas are
+// accumulated so that the bounds remain conservative for any weight in
+// [minWeight, maxWeight].
+MeshParserUtils::PrimitiveBounds computePrimitiveBounds(const QGeometry *geometry,
+                                                        const Primitive &primitive,
+                                                        GLTF2Context *context,
+                                                        float minWeight, float maxWeight)
+{
+    auto findAttribute = [geometry](const QString &name) -> QAttribute * {
+        const auto &attributes = geometry->attributes();
+        auto it = std::find_if(attributes.cbegin(), attributes.cend(),
+                               [&name](const QAttribute *a) { return a->name() == name; });
+        return it != attributes.cend() ? *it : nullptr;
+    };
+
+    QVector3D minExtent;
+    QVector3D maxExtent;
+    bool hasExtents = false;
+
+    const auto positionAttrInfoIt = std::find_if(primitive.attributeInfo.cbegin(),
+                                                 primitive.attributeInfo.cend(),
+                                                 [](const AttributeInfo &info) {
+                                                     return info.attributeName == QAttribute::defaultPositionAttributeName();
+                                                 });
+    if (positionAttrInfoIt != primitive.attributeInfo.cend() &&
+        positionAttrInfoIt->accessorIdx >= 0 &&
+        positionAttrInfoIt->accessorIdx < qint32(context->accessorCount()))
+        hasExtents = MeshParserUtils::extentsFromAccessor(context->accessor(positionAttrInfoIt->accessorIdx),
+                                                          minExtent, maxExtent);
+
+    if (!hasExtents)
+        hasExtents = MeshParserUtils::extentsFromPositionAttribute(findAttribute(QAttribute::defaultPositionAttributeName()),
+                                                                   minExtent, maxExtent);
+
+    if (!hasExtents)
+        return {};
+
+    for (size_t i = 0, m = primitive.morphTargets.size(); i < m; ++i) {
+        for (const MorphTargetAttribute &morphTargetAttribute : primitive.morphTargets[i].attributes) {
+            if (morphTargetAttribute.name != QLatin1String("POSITION"))
+                continue;
+
+            QVector3D minDelta;
+            QVector3D maxDelta;
+            const QString attributeName = QStringLiteral("%1_%2")
+                                                  .arg(QAttribute::defaultPositionAttributeName())
+                                                  .arg(i + 1);
+            if (!MeshParserUtils::extentsFromAccessor(context->accessor(morphTargetAttribute.accessorIdx),
+                                                      minDelta, maxDelta) &&
+                !MeshParserUtils::extentsFromPositionAttribute(findAttribute(attributeName),
+                                                               minDelta, maxDelta))
+                return {};
+
+            MeshParserUtils::extentsForMorphTarget(minExtent, maxExtent, minDelta, maxDelta, minWeight, maxWeight);
+        }
+    }
+
+    return MeshParserUtils::boundsFromExtents(minExtent, maxExtent);
+}
+
 } // namespace
 
 MeshParser::MeshParser()
@@ -212,7 +276,7 @@ bool MeshParser::parse(const QJsonArray &meshArray, GLTF2Context *context)
             // Initialize count of morph targets
             const Primitive &firstPrimitive = mesh.meshPrimitives.first();
             // All primitives are supposed to have the same number of morph targets
-            mesh.morphTargetCount = quint8(firstPrimitive.morphTargets.size());
+            mesh.morphTargetCount = quint16(firstPrimitive.morphTargets.size());
 
             for (int i = 1, m = mesh.meshPrimitives.size(); i < m; ++i) {
                 const Primitive &previousPrimitive = mesh.meshPrimitives.at(i - 1);
@@ -574,19 +638,95 @@ bool PrimitiveBuilder::generateGeometryRendererForPrimitive(Primitive &primitive
     }
 
     if (primitive.hasMorphTargets) {
-        if (!generateMorphTargetAttributes(geometry.get(), primitive)) {
+        // Shaders only handle up to 8 morph target attributes, larger sets
+        // are packed and blended on the CPU
+        const bool usePackedMorphTargets = m_context->options()->packedMorphTargets() ||
+                primitive.morphTargets.size() > 8;
+        if (usePackedMorphTargets) {
+            if (!generatePackedMorphTargets(geometry.get(), primitive)) {
+                qCWarning(Kuesa::kuesa) << QLatin1String("Failed to generate packed morph targets");
+                return false;
+            }
+        } else if (!generateMorphTargetAttributes(geometry.get(), primitive)) {
             qCWarning(Kuesa::kuesa) << QLatin1String("Failed to generate morph target attributes");
             return false;
         }
     }
 
+    float minWeight = 0.0f;
+    float maxWeight = 1.0f;
+    if (primitive.hasMorphTargets)
+        morphTargetWeightRange(minWeight, maxWeight);
+    const MeshParserUtils::PrimitiveBounds bounds = computePrimitiveBounds(geometry.get(), primitive, m_context,
+                                                                           minWeight, maxWeight);
+
     QGeometryRenderer *renderer = new QGeometryRenderer;
     renderer->setPrimitiveType(primitive.primitiveType);
     renderer->setGeometry(geometry.release());
+    MeshParserUtils::applyPrimitiveBounds(renderer, bounds);
+
+    const GLTF2Options *options = m_context->options();
+    if (options->lodLevelCount() > 0)
+        MeshSimplifier::generateLevelsOfDetail(renderer,
+                                               options->lodLevelCount(),
+                                               options->lodError(),
+                                               options->lodErrorMetric() == GLTF2Options::RelativeLodError);
+
     primitive.primitiveRenderer = renderer;
     return true;
 }
 
+/*!
+    \internal
+
+    Range of the morph target weights found in the file, default mesh weights
+    and animated weights, widened to [0, 1]. Primitives are shared between
+    meshes, so this is computed once for the whole file rather than per mesh.
+    Weights set at runtime outside that range aren't accounted for.
+ */
+void PrimitiveBuilder::morphTargetWeightRange(float &minWeight, float &maxWeight)
+{
+    if (!m_hasMorphTargetWeightRange) {
+        m_hasMorphTargetWeightRange = true;
+        auto extendRange = [this](float weight) {
+            m_minMorphTargetWeight = std::min(m_minMorphTargetWeight, weight);
+            m_maxMorphTargetWeight = std::max(m_maxMorphTargetWeight, weight);
+        };
+
+        for (size_t i = 0, m = m_context->meshesCount(); i < m; ++i) {
+            for (float weight : m_context->mesh(qint32(i)).morphTargetWeights)
+                extendRange(weight);
+        }
+
+        // Bezier curves remain within the hull of their control points
+        for (size_t i = 0, m = m_context->animationsCount(); i < m; ++i) {
+            const Animation &animation = m_context->animation(qint32(i));
+            for (const ChannelMapping &mapping : animation.mappings) {
+                if (mapping.target.path != QLatin1String("weights"))
+                    continue;
+                const auto channelIt = std::find_if(animation.clipData.begin(), animation.clipData.end(),
+                                                    [&mapping](const Qt3DAnimation::QChannel &channel) {
+                                                        return channel.name() == mapping.name;
+                                                    });
+                if (channelIt == animation.clipData.end())
+                    continue;
+                for (const Qt3DAnimation::QChannelComponent &component : *channelIt) {
+                    for (const Qt3DAnimation::QKeyFrame &keyFrame : component) {
+                        extendRange(keyFrame.coordinates().y());
+                        if (keyFrame.interpolationType() == Qt3DAnimation::QKeyFrame::BezierInterpolation) {
+                            extendRange(keyFrame.leftControlPoint().y());
+                            extendRange(keyFrame.rightControlPoint().y());
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    minWeight = m_minMorphTargetWeight;
+    maxWeight = m_maxMorphTargetWeight;
+}
+
 bool PrimitiveBuilder::generateAttributes(QGeometry *geometry,
                                           const Primitive &primitive)
 {
@@ -754,6 +894,86 @@ bool PrimitiveBuilder::generateMorphTargetAttributes(QGeometry *geometry,
     return true;
 }
 
+bool PrimitiveBuilder::generatePackedMorphTargets(QGeometry *geometry,
+                                                  Primitive &primitive)
+{
+    const std::vector<MorphTarget> &morphTargets = primitive.morphTargets;
+
+    QAttribute *positionAttribute = nullptr;
+    for (QAttribute *attribute : geometry->attributes()) {
+        if (attribute->name() == QAttribute::defaultPositionAttributeName()) {
+            positionAttribute = attribute;
+            break;
+        }
+    }
+    if (positionAttribute == nullptr || positionAttribute->count() == 0)
+        return false;
+
+    const int vertexCount = int(positionAttribute->count());
+    auto packed = std::make_shared<PackedMorphTargets>(vertexCount, int(morphTargets.size()));
+    std::vector<float> deltas(size_t(vertexCount) * 3);
+
+    for (size_t i = 0, m = morphTargets.size(); i < m; ++i) {
+        for (const MorphTargetAttribute &morphTargetAttribute : morphTargets[i].attributes) {
+            const QString semanticName = morphTargetAttribute.name;
+            PackedMorphTargets::Channel channel;
+            if (semanticName == QLatin1String("POSITION"))
+                channel = PackedMorphTargets::Position;
+            else if (semanticName == QLatin1String("NORMAL"))
+                channel = PackedMorphTargets::Normal;
+            else if (semanticName == QLatin1String("TANGENT"))
+                channel = PackedMorphTargets::Tangent;
+            else
+                continue;
+
+            const QString targetStandardAttributeName = standardAttributeNameFromSemantic(semanticName);
+            const auto &attributes = geometry->attributes();
+            const bool hasReferenceAttribute = std::any_of(attributes.cbegin(), attributes.cend(),
+                                                           [&](const QAttribute *a) {
+                                                               return a->name() == targetStandardAttributeName &&
+                                                                       int(a->count()) == vertexCount;
+                                                           });
+            if (!hasReferenceAttribute) {
+                qCWarning(kuesa) << "Morph target attribute" << semanticName
+                                 << "doesn't match an attribute referenced in the primitive";
+                return false;
+            }
+
+            const Accessor &accessor = m_context->accessor(morphTargetAttribute.accessorIdx);
+            if (int(accessor.count) != vertexCount ||
+                accessor.type != QAttribute::Float ||
+                accessor.dataSize != 3) {
+                qCWarning(kuesa) << "Morph target attribute" << semanticName
+                                 << "isn't a vec3 float accessor matching the primitive";
+                return false;
+            }
+
+            quint32 byteStride = 3 * sizeof(float);
+            if (accessor.bufferViewIndex >= 0) {
+                const BufferView &viewData = m_context->bufferView(accessor.bufferViewIndex);
+                if (viewData.byteStride > 0)
+                    byteStride = quint32(viewData.byteStride);
+            }
+
+            const QByteArray &data = accessor.bufferData;
+            if (data.size() < int(accessor.offset + byteStride * (accessor.count - 1) + 3 * sizeof(float))) {
+                qCWarning(kuesa) << "Morph target attribute" << semanticName
+                                 << "references too little data";
+                return false;
+            }
+
+            const char *src = data.constData() + accessor.offset;
+            for (int v = 0; v < vertexCount; ++v)
+                std::memcpy(&deltas[size_t(v) * 3], src + size_t(v) * byteStride, 3 * sizeof(float));
+
+            packed->setTargetDeltas(int(i), channel, deltas.data());
+        }
+    }
+
+    primitive.packedMorphTargets = std::move(packed);
+    return true;
+}
+
 QAttribute *PrimitiveBuilder::createAttribute(qint32 accessorIndex,
                                               const QString &attributeName,
                                               const QString &semanticName)
@@ -40,6 +40,7 @@
 #include <QtCore/qglobal.h>
 #include <QtCore/QVector>
 #include <Kuesa/private/kuesa_global_p.h>
+#include <Kuesa/private/packedmorphtargets_p.h>
 #include <qtkuesa-config.h>
 #include "bufferaccessorparser_p.h"
 
@@ -102,12 +103,14 @@ struct Primitive {
 
     std::vector<MorphTarget> morphTargets;
     std::vector<AttributeInfo> attributeInfo;
+    // Set when the morph targets are blended on the CPU
+    PackedMorphTargetsPtr packedMorphTargets;
 };
 
 struct Mesh {
     QVector<Primitive> meshPrimitives;
     QString name;
-    quint8 morphTargetCount = 0;
+    quint16 morphTargetCount = 0;
     QVector<float> morphTargetWeights;
     qint32 meshIdx = -1;
 };
@@ -126,14 +129,20 @@ private:
                                  const Primitive &primitive);
     bool generateMorphTargetAttributes(Qt3DGeometry::QGeometry *geometry,
                                        const Primitive &primitive);
+    bool generatePackedMorphTargets(Qt3DGeometry::QGeometry *geometry,
+                                    Primitive &primitive);
     Qt3DGeometry::QAttribute *createAttribute(qint32 accessorIndex,
                                               const QString &attributeName,
                                               const QString &semanticName);
+    void morphTargetWeightRange(float &minWeight, float &maxWeight);
 
 private:
     GLTF2Context *m_context;
     QHash<qint32, Qt3DGeometry::QBuffer *> m_qViewBuffers;
     QHash<qint32, Qt3DGeometry::QBuffer *> m_qAccessorBuffers;
+    bool m_hasMorphTargetWeightRange = false;
+    float m_minMorphTargetWeight = 0.0f;
+    float m_maxMorphTargetWeight = 1.0f;
 };
 
 class Q_AUTOTEST_EXPORT MeshParser
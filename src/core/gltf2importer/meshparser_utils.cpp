@@ -44,14 +44,29 @@
 #endif
 #include <Qt3DRender/QGeometryRenderer>
 
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+#include <Qt3DCore/private/qgeometry_p.h>
+#else
+#include <Qt3DRender/private/qgeometry_p.h>
+#endif
+
+#include <algorithm>
 #include <array>
 #include <cstring>
+#include <limits>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
 
 #include "mikktspace.h"
 #include "gltf2context_p.h"
 #include "gltf2keys_p.h"
 #include "gltf2utils_p.h"
 #include "gltf2exporter_p.h"
+#include "bufferaccessorparser_p.h"
 #include "kuesa_p.h"
 
 QT_BEGIN_NAMESPACE
@@ -183,6 +198,19 @@ QAttribute *attributeFromGeometry(const QString &name,
     return *it;
 }
 
+// Morph target attributes are named after their base attribute with a
+// consecutive 1 based suffix (vertexPosition_1, vertexPosition_2...)
+int morphTargetCountForGeometry(const QGeometry *geometry)
+{
+    int count = 0;
+    while (attributeFromGeometry(QStringLiteral("%1_%2")
+                                         .arg(QAttribute::defaultPositionAttributeName())
+                                         .arg(count + 1),
+                                 geometry) != nullptr)
+        ++count;
+    return count;
+}
+
 struct Attribute {
     QByteArray bufferData;
     unsigned int byteOffset;
@@ -722,7 +750,7 @@ void createTangentForGeometry(QGeometry *geometry, QGeometryRenderer::PrimitiveT
     auto tangentAttribute = generateTangentForBaseMesh(&mikkTSpaceUserData, &mikkTSpaceInterface);
     geometry->addAttribute(tangentAttribute);
 
-    for (int morphTargetId = 0; morphTargetId < 8; ++morphTargetId) {
+    for (int morphTargetId = 0, m = morphTargetCountForGeometry(geometry); morphTargetId < m; ++morphTargetId) {
         tangentAttribute = generateTangentForMorphTarget(geometry, &mikkTSpaceUserData, &mikkTSpaceInterface, morphTargetId);
         if (tangentAttribute)
             geometry->addAttribute(tangentAttribute);
@@ -1406,7 +1434,7 @@ void generateNormals(QGeometry *geometry)
     geometry->addAttribute(normalsAttribute);
 
     // Compute normals for morph targets
-    for (int morphTargetId = 0; morphTargetId < 8; ++morphTargetId) {
+    for (int morphTargetId = 0, m = morphTargetCountForGeometry(geometry); morphTargetId < m; ++morphTargetId) {
         const QString attributeName = QStringLiteral("%1_%2")
                                               .arg(QAttribute::defaultPositionAttributeName())
                                               .arg(morphTargetId + 1);
@@ -1562,6 +1590,151 @@ bool generatePrecomputedNormalAttribute(QGeometryRenderer *mesh, GLTF2Context *c
     return true;
 }
 
+/*!
+    \internal
+
+    Retrieves the extents of a POSITION \a accessor from its min/max
+    properties. Only float accessors are handled as glTF leaves the min/max
+    of normalized accessors in their component type range.
+ */
+bool extentsFromAccessor(const Accessor &accessor, QVector3D &minExtent, QVector3D &maxExtent)
+{
+    if (accessor.type != QAttribute::Float || accessor.dataSize < 3 ||
+        accessor.min.size() < 3 || accessor.max.size() < 3)
+        return false;
+
+    minExtent = QVector3D(accessor.min[0], accessor.min[1], accessor.min[2]);
+    maxExtent = QVector3D(accessor.max[0], accessor.max[1], accessor.max[2]);
+    return minExtent.x() <= maxExtent.x() &&
+            minExtent.y() <= maxExtent.y() &&
+            minExtent.z() <= maxExtent.z();
+}
+
+/*!
+    \internal
+
+    Computes the extents of \a positionAttribute by going over its vertices.
+    This is only used when the accessor doesn't provide usable min/max values.
+ */
+bool extentsFromPositionAttribute(const QAttribute *positionAttribute, QVector3D &minExtent, QVector3D &maxExtent)
+{
+    if (positionAttribute == nullptr || positionAttribute->buffer() == nullptr ||
+        positionAttribute->vertexBaseType() != QAttribute::Float ||
+        positionAttribute->vertexSize() < 3 || positionAttribute->count() == 0)
+        return false;
+
+    const QByteArray data = positionAttribute->buffer()->data();
+    const size_t count = positionAttribute->count();
+    const size_t byteOffset = positionAttribute->byteOffset();
+    const size_t byteStride = positionAttribute->byteStride() > 0
+            ? positionAttribute->byteStride()
+            : positionAttribute->vertexSize() * sizeof(float);
+
+    if (byteOffset + (count - 1) * byteStride + 3 * sizeof(float) > size_t(data.size()))
+        return false;
+
+    const char *rawData = data.constData() + byteOffset;
+    const size_t bytesAvailable = size_t(data.size()) - byteOffset;
+    float mins[4] = { std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), 0.0f };
+    float maxs[4] = { std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), 0.0f };
+    size_t i = 0;
+
+    // Load 4 floats per vertex (the 4th lane is ignored) as long as that
+    // doesn't read past the end of the buffer
+#if defined(__SSE2__)
+    __m128 vMin = _mm_loadu_ps(mins);
+    __m128 vMax = _mm_loadu_ps(maxs);
+    for (; i < count && i * byteStride + 4 * sizeof(float) <= bytesAvailable; ++i) {
+        const __m128 p = _mm_loadu_ps(reinterpret_cast<const float *>(rawData + i * byteStride));
+        vMin = _mm_min_ps(vMin, p);
+        vMax = _mm_max_ps(vMax, p);
+    }
+    _mm_storeu_ps(mins, vMin);
+    _mm_storeu_ps(maxs, vMax);
+#elif defined(__ARM_NEON)
+    float32x4_t vMin = vld1q_f32(mins);
+    float32x4_t vMax = vld1q_f32(maxs);
+    for (; i < count && i * byteStride + 4 * sizeof(float) <= bytesAvailable; ++i) {
+        const float32x4_t p = vld1q_f32(reinterpret_cast<const float *>(rawData + i * byteStride));
+        vMin = vminq_f32(vMin, p);
+        vMax = vmaxq_f32(vMax, p);
+    }
+    vst1q_f32(mins, vMin);
+    vst1q_f32(maxs, vMax);
+#endif
+
+    for (; i < count; ++i) {
+        float p[3];
+        std::memcpy(p, rawData + i * byteStride, 3 * sizeof(float));
+        for (int c = 0; c < 3; ++c) {
+            mins[c] = std::min(mins[c], p[c]);
+            maxs[c] = std::max(maxs[c], p[c]);
+        }
+    }
+
+    minExtent = QVector3D(mins[0], mins[1], mins[2]);
+    maxExtent = QVector3D(maxs[0], maxs[1], maxs[2]);
+    return true;
+}
+
+/*!
+    \internal
+
+    Widens \a minExtent and \a maxExtent by the displacement of a morph
+    target whose position deltas lie within \a minDelta and \a maxDelta,
+    for any weight in [\a minWeight, \a maxWeight]. Negative weights move
+    the vertices against the deltas.
+ */
+void extentsForMorphTarget(QVector3D &minExtent, QVector3D &maxExtent,
+                           const QVector3D &minDelta, const QVector3D &maxDelta,
+                           float minWeight, float maxWeight)
+{
+    for (int c = 0; c < 3; ++c) {
+        // weight * delta is bilinear, its extremes are on the corners
+        const std::initializer_list<float> corners = { minWeight * minDelta[c], minWeight * maxDelta[c],
+                                                       maxWeight * minDelta[c], maxWeight * maxDelta[c] };
+        minExtent[c] += std::min(std::min(corners), 0.0f);
+        maxExtent[c] += std::max(std::max(corners), 0.0f);
+    }
+}
+
+PrimitiveBounds boundsFromExtents(const QVector3D &minExtent, const QVector3D &maxExtent)
+{
+    PrimitiveBounds bounds;
+    bounds.minExtent = minExtent;
+    bounds.maxExtent = maxExtent;
+    bounds.isValid = true;
+    return bounds;
+}
+
+/*!
+    \internal
+
+    Seeds the extents of the geometry of \a renderer with the precomputed
+    \a bounds so that frontend consumers (culling, level of detail selection,
+    bounding volume display ...) don't have to wait for the backend to compute
+    them. They derive the bounding sphere from these extents. On Qt 6, the
+    bounds are also provided to the backend through the QBoundingVolume API,
+    which spares the bounding volume computation jobs. Qt 5.15 has no API to
+    feed bounds to the backend, which keeps computing them from the vertex
+    buffers. Until these jobs have run, the ShadowMapManager derives the scene
+    bounds from the extents seeded here.
+ */
+void applyPrimitiveBounds(QGeometryRenderer *renderer, const PrimitiveBounds &bounds)
+{
+    if (renderer == nullptr || renderer->geometry() == nullptr || !bounds.isValid)
+        return;
+
+    QGeometry *geometry = renderer->geometry();
+    auto *d = static_cast<QGeometryPrivate *>(Qt3DCore::QNodePrivate::get(geometry));
+    d->setExtent(bounds.minExtent, bounds.maxExtent);
+
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+    renderer->setMinPoint(bounds.minExtent);
+    renderer->setMaxPoint(bounds.maxExtent);
+#endif
+}
+
 } // namespace MeshParserUtils
 } // namespace GLTF2Import
 } // namespace Kuesa
@@ -39,6 +39,7 @@
 
 #include <Kuesa/kuesa_global.h>
 #include <Qt3DRender/QGeometryRenderer>
+#include <QVector3D>
 
 QT_BEGIN_NAMESPACE
 
@@ -49,9 +50,16 @@ namespace Kuesa {
 namespace GLTF2Import {
 
 class GLTF2Context;
+struct Accessor;
 
 namespace MeshParserUtils {
 
+struct PrimitiveBounds {
+    QVector3D minExtent;
+    QVector3D maxExtent;
+    bool isValid = false;
+};
+
 KUESASHARED_EXPORT void createTangentForGeometry(QGeometry *geometry, QGeometryRenderer::PrimitiveType primitiveType);
 KUESASHARED_EXPORT bool needsTangentAttribute(const QGeometry *geometry,
                                               QGeometryRenderer::PrimitiveType primitiveType);
@@ -64,6 +72,15 @@ KUESASHARED_EXPORT bool generatePrecomputedTangentAttribute(QGeometryRenderer *m
 KUESASHARED_EXPORT bool generatePrecomputedNormalAttribute(QGeometryRenderer *mesh,
                                                            GLTF2Context *context);
 bool geometryIsGLTF2Valid(QGeometry *geometry);
+KUESASHARED_EXPORT bool extentsFromAccessor(const Accessor &accessor,
+                                            QVector3D &minExtent, QVector3D &maxExtent);
+KUESASHARED_EXPORT bool extentsFromPositionAttribute(const QAttribute *positionAttribute,
+                                                     QVector3D &minExtent, QVector3D &maxExtent);
+KUESASHARED_EXPORT void extentsForMorphTarget(QVector3D &minExtent, QVector3D &maxExtent,
+                                               const QVector3D &minDelta, const QVector3D &maxDelta,
+                                               float minWeight, float maxWeight);
+KUESASHARED_EXPORT PrimitiveBounds boundsFromExtents(const QVector3D &minExtent, const QVector3D &maxExtent);
+KUESASHARED_EXPORT void applyPrimitiveBounds(QGeometryRenderer *renderer, const PrimitiveBounds &bounds);
 
 } // namespace MeshParserUtils
 } // namespace GLTF2Import
@@ -0,0 +1,335 @@
+/*
+    meshsimplifier.cpp
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "meshsimplifier_p.h"
+
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+#include <Qt3DCore/QBuffer>
+#include <Qt3DCore/QGeometry>
+#include <Qt3DCore/QAttribute>
+#include <Qt3DCore/private/qgeometry_p.h>
+#else
+#include <Qt3DRender/QBuffer>
+#include <Qt3DRender/QGeometry>
+#include <Qt3DRender/QAttribute>
+#include <Qt3DRender/private/qgeometry_p.h>
+#endif
+#include <Qt3DRender/QGeometryRenderer>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+#include <unordered_set>
+
+QT_BEGIN_NAMESPACE
+
+using namespace Qt3DCore;
+using namespace Qt3DRender;
+
+namespace Kuesa {
+namespace GLTF2Import {
+namespace MeshSimplifier {
+
+LevelsOfDetail::LevelsOfDetail(QGeometryRenderer *renderer)
+    : QObject(renderer)
+{
+}
+
+LevelsOfDetail *LevelsOfDetail::find(const QGeometryRenderer *renderer)
+{
+    return renderer ? renderer->findChild<LevelsOfDetail *>(QString(), Qt::FindDirectChildrenOnly) : nullptr;
+}
+
+namespace {
+
+// A level must remove at least that fraction of the triangles of the
+// previous level to be worth keeping
+constexpr float MinimumReduction = 0.1f;
+
+quint64 cellKey(const QVector3D &p, const QVector3D &origin, float invCellSize)
+{
+    // 21 bits per axis is plenty for the cell counts we deal with
+    const auto cellCoord = [&](int axis) -> quint64 {
+        const float c = std::floor((p[axis] - origin[axis]) * invCellSize);
+        return quint64(std::min(std::max(c, 0.0f), float((1 << 21) - 1)));
+    };
+    return cellCoord(0) | (cellCoord(1) << 21) | (cellCoord(2) << 42);
+}
+
+bool readPositions(const QAttribute *attribute, std::vector<QVector3D> &positions)
+{
+    if (attribute == nullptr || attribute->buffer() == nullptr ||
+        attribute->vertexBaseType() != QAttribute::Float ||
+        attribute->vertexSize() < 3 || attribute->count() == 0)
+        return false;
+
+    const QByteArray data = attribute->buffer()->data();
+    const size_t count = attribute->count();
+    const size_t byteOffset = attribute->byteOffset();
+    const size_t byteStride = attribute->byteStride() > 0
+            ? attribute->byteStride()
+            : attribute->vertexSize() * sizeof(float);
+
+    if (byteOffset + (count - 1) * byteStride + 3 * sizeof(float) > size_t(data.size()))
+        return false;
+
+    positions.resize(count);
+    const char *rawData = data.constData() + byteOffset;
+    for (size_t i = 0; i < count; ++i) {
+        float p[3];
+        std::memcpy(p, rawData + i * byteStride, 3 * sizeof(float));
+        positions[i] = QVector3D(p[0], p[1], p[2]);
+    }
+    return true;
+}
+
+bool readIndices(const QAttribute *attribute, size_t vertexCount, std::vector<quint32> &indices)
+{
+    // Non indexed geometry, generate a trivial index list
+    if (attribute == nullptr) {
+        indices.resize(vertexCount);
+        for (size_t i = 0; i < vertexCount; ++i)
+            indices[i] = quint32(i);
+        return true;
+    }
+
+    if (attribute->buffer() == nullptr)
+        return false;
+
+    size_t elementSize = 0;
+    switch (attribute->vertexBaseType()) {
+    case QAttribute::UnsignedByte:
+        elementSize = 1;
+        break;
+    case QAttribute::UnsignedShort:
+        elementSize = 2;
+        break;
+    case QAttribute::UnsignedInt:
+        elementSize = 4;
+        break;
+    default:
+        return false;
+    }
+
+    const QByteArray data = attribute->buffer()->data();
+    const size_t count = attribute->count();
+    const size_t byteOffset = attribute->byteOffset();
+    const size_t byteStride = attribute->byteStride() > 0 ? attribute->byteStride() : elementSize;
+
+    if (count == 0 || byteOffset + (count - 1) * byteStride + elementSize > size_t(data.size()))
+        return false;
+
+    indices.resize(count);
+    const char *rawData = data.constData() + byteOffset;
+    for (size_t i = 0; i < count; ++i) {
+        const char *rawValue = rawData + i * byteStride;
+        switch (elementSize) {
+        case 1:
+            indices[i] = *reinterpret_cast<const quint8 *>(rawValue);
+            break;
+        case 2: {
+            quint16 v;
+            std::memcpy(&v, rawValue, sizeof(v));
+            indices[i] = v;
+            break;
+        }
+        default:
+            std::memcpy(&indices[i], rawValue, sizeof(quint32));
+            break;
+        }
+        if (indices[i] >= vertexCount)
+            return false;
+    }
+    return true;
+}
+
+QAttribute *createIndexAttribute(const std::vector<quint32> &indices, size_t vertexCount, QGeometry *geometry)
+{
+    QByteArray rawData;
+    QAttribute::VertexBaseType type;
+    if (vertexCount <= std::numeric_limits<quint16>::max() + 1u) {
+        type = QAttribute::UnsignedShort;
+        rawData.resize(int(indices.size() * sizeof(quint16)));
+        auto *dst = reinterpret_cast<quint16 *>(rawData.data());
+        for (size_t i = 0, m = indices.size(); i < m; ++i)
+            dst[i] = quint16(indices[i]);
+    } else {
+        type = QAttribute::UnsignedInt;
+        rawData.resize(int(indices.size() * sizeof(quint32)));
+        std::memcpy(rawData.data(), indices.data(), indices.size() * sizeof(quint32));
+    }
+
+    auto *buffer = new QBuffer(geometry);
+    buffer->setData(rawData);
+
+    auto *attribute = new QAttribute(geometry);
+    attribute->setAttributeType(QAttribute::IndexAttribute);
+    attribute->setBuffer(buffer);
+    attribute->setVertexBaseType(type);
+    attribute->setVertexSize(1);
+    attribute->setCount(uint(indices.size()));
+    return attribute;
+}
+
+} // namespace
+
+std::vector<quint32> simplifyTriangles(const std::vector<QVector3D> &positions,
+                                       const std::vector<quint32> &indices,
+                                       float cellSize)
+{
+    std::vector<quint32> simplified;
+    if (positions.empty() || indices.size() < 3 || !(cellSize > 0.0f))
+        return simplified;
+
+    QVector3D origin = positions.front();
+    for (const QVector3D &p : positions)
+        for (int c = 0; c < 3; ++c)
+            origin[c] = std::min(origin[c], p[c]);
+
+    const float invCellSize = 1.0f / cellSize;
+
+    // Map each referenced vertex to the representative of its cell
+    std::unordered_map<quint64, quint32> cellRepresentatives;
+    std::vector<quint32> remap(positions.size(), std::numeric_limits<quint32>::max());
+    for (const quint32 idx : indices) {
+        if (remap[idx] != std::numeric_limits<quint32>::max())
+            continue;
+        const auto it = cellRepresentatives.emplace(cellKey(positions[idx], origin, invCellSize), idx).first;
+        remap[idx] = it->second;
+    }
+
+    // Emit the triangles which haven't collapsed, skipping duplicates
+    struct TriangleHash {
+        size_t operator()(const std::array<quint32, 3> &t) const
+        {
+            return std::hash<quint64>()((quint64(t[0]) << 42) ^ (quint64(t[1]) << 21) ^ quint64(t[2]));
+        }
+    };
+    std::unordered_set<std::array<quint32, 3>, TriangleHash> emitted;
+    simplified.reserve(indices.size());
+
+    for (size_t i = 0, m = indices.size() - indices.size() % 3; i < m; i += 3) {
+        const quint32 a = remap[indices[i]];
+        const quint32 b = remap[indices[i + 1]];
+        const quint32 c = remap[indices[i + 2]];
+        if (a == b || b == c || a == c)
+            continue;
+
+        // Rotate so that the smallest index comes first, keeping the winding
+        std::array<quint32, 3> key = { a, b, c };
+        while (key[0] > key[1] || key[0] > key[2])
+            std::rotate(key.begin(), key.begin() + 1, key.end());
+        if (!emitted.insert(key).second)
+            continue;
+
+        simplified.push_back(a);
+        simplified.push_back(b);
+        simplified.push_back(c);
+    }
+
+    return simplified;
+}
+
+int generateLevelsOfDetail(QGeometryRenderer *renderer, int levelCount, float error, bool relativeError)
+{
+    if (renderer == nullptr || renderer->geometry() == nullptr ||
+        renderer->primitiveType() != QGeometryRenderer::Triangles ||
+        levelCount <= 0 || !(error > 0.0f))
+        return 0;
+
+    QGeometry *geometry = renderer->geometry();
+    const QVector<QAttribute *> attributes = geometry->attributes();
+    const QAttribute *positionAttribute = nullptr;
+    const QAttribute *indexAttribute = nullptr;
+    for (const QAttribute *attribute : attributes) {
+        if (attribute->attributeType() == QAttribute::IndexAttribute)
+            indexAttribute = attribute;
+        else if (attribute->name() == QAttribute::defaultPositionAttributeName())
+            positionAttribute = attribute;
+    }
+
+    std::vector<QVector3D> positions;
+    std::vector<quint32> indices;
+    if (!readPositions(positionAttribute, positions) ||
+        !readIndices(indexAttribute, positions.size(), indices))
+        return 0;
+
+    if (relativeError) {
+        const QVector3D extent = geometry->maxExtent() - geometry->minExtent();
+        error *= extent.length();
+        if (!(error > 0.0f))
+            return 0;
+    }
+
+    delete LevelsOfDetail::find(renderer);
+    auto *levelsOfDetail = new LevelsOfDetail(renderer);
+    levelsOfDetail->levels.push_back(geometry);
+
+    // A vertex moves at most by the diagonal of its cell
+    const float errorToCellSize = 1.0f / std::sqrt(3.0f);
+    size_t previousIndexCount = indices.size();
+    int generatedLevels = 0;
+
+    for (int level = 1; level <= levelCount; ++level) {
+        const std::vector<quint32> lodIndices = simplifyTriangles(positions, indices, error * errorToCellSize);
+        if (lodIndices.empty() ||
+            float(lodIndices.size()) > float(previousIndexCount) * (1.0f - MinimumReduction))
+            break;
+
+        auto *lodGeometry = new QGeometry(renderer);
+        for (QAttribute *attribute : attributes) {
+            if (attribute->attributeType() != QAttribute::IndexAttribute)
+                lodGeometry->addAttribute(attribute);
+        }
+        lodGeometry->addAttribute(createIndexAttribute(lodIndices, positions.size(), lodGeometry));
+
+        // Conservatively keep the bounds of the full resolution geometry so
+        // that culling doesn't depend on the selected level
+        auto *d = static_cast<QGeometryPrivate *>(Qt3DCore::QNodePrivate::get(lodGeometry));
+        d->setExtent(geometry->minExtent(), geometry->maxExtent());
+        levelsOfDetail->levels.push_back(lodGeometry);
+
+        previousIndexCount = lodIndices.size();
+        error *= 2.0f;
+        ++generatedLevels;
+    }
+
+    if (generatedLevels == 0)
+        delete levelsOfDetail;
+
+    return generatedLevels;
+}
+
+} // namespace MeshSimplifier
+} // namespace GLTF2Import
+} // namespace Kuesa
+
+QT_END_NAMESPACE
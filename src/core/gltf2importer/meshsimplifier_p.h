@@ -0,0 +1,103 @@
+/*
+    meshsimplifier_p.h
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef KUESA_GLTF2IMPORT_MESHSIMPLIFIER_P_H
+#define KUESA_GLTF2IMPORT_MESHSIMPLIFIER_P_H
+
+//
+//  NOTICE
+//  ------
+//
+// We mean it: this file is not part of the public API and could be
+// modified without notice
+//
+
+#include <Kuesa/kuesa_global.h>
+#include <Kuesa/private/kuesa_global_p.h>
+#include <QObject>
+#include <QPointer>
+#include <QVector3D>
+#include <vector>
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+#include <Qt3DCore/QGeometry>
+#else
+#include <Qt3DRender/QGeometry>
+#endif
+
+QT_BEGIN_NAMESPACE
+
+namespace Qt3DRender {
+class QGeometryRenderer;
+}
+
+namespace Kuesa {
+namespace GLTF2Import {
+
+namespace MeshSimplifier {
+
+// Levels of detail generated for a renderer, indexed by level. Level 0 is
+// the original geometry. Instances are children of the renderer.
+class KUESA_PRIVATE_EXPORT LevelsOfDetail : public QObject
+{
+    Q_OBJECT
+public:
+    explicit LevelsOfDetail(Qt3DRender::QGeometryRenderer *renderer);
+
+    static LevelsOfDetail *find(const Qt3DRender::QGeometryRenderer *renderer);
+
+    std::vector<QPointer<Qt3DGeometry::QGeometry>> levels;
+};
+
+// Vertex clustering simplification: vertices are snapped to the first vertex
+// found in their cell of a regular grid of size cellSize and triangles that
+// collapse or duplicate another triangle are dropped. The returned index list
+// references the original vertices, so vertex buffers can be shared between
+// all levels of detail. The maximum displacement of a vertex is the cell
+// diagonal.
+KUESA_PRIVATE_EXPORT std::vector<quint32> simplifyTriangles(const std::vector<QVector3D> &positions,
+                                                            const std::vector<quint32> &indices,
+                                                            float cellSize);
+
+// Generates up to levelCount simplified geometries for a Triangles renderer.
+// The first level has a maximum error of error (scaled by the bounding box
+// diagonal if relativeError is true), each following level doubles it.
+// Generation stops early when a level doesn't remove enough triangles.
+// Returns the number of levels generated.
+KUESA_PRIVATE_EXPORT int generateLevelsOfDetail(Qt3DRender::QGeometryRenderer *renderer,
+                                                int levelCount,
+                                                float error,
+                                                bool relativeError);
+
+} // namespace MeshSimplifier
+
+} // namespace GLTF2Import
+} // namespace Kuesa
+
+QT_END_NAMESPACE
+
+#endif // KUESA_GLTF2IMPORT_MESHSIMPLIFIER_P_H
@@ -0,0 +1,440 @@
+/*
+    levelofdetailselector.cpp
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "levelofdetailselector.h"
+#include <Kuesa/View>
+#include <Kuesa/private/kuesa_global_p.h>
+#include <Kuesa/private/kuesa_utils_p.h>
+#include <Kuesa/private/meshsimplifier_p.h>
+#include <Qt3DCore/QTransform>
+#include <Qt3DCore/private/qnode_p.h>
+#include <Qt3DRender/QGeometryRenderer>
+#include <Qt3DRender/QCamera>
+#include <Qt3DRender/QCameraLens>
+
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+#include <Qt3DCore/QGeometry>
+#else
+#include <Qt3DRender/QGeometry>
+#endif
+
+#include <algorithm>
+#include <cmath>
+
+QT_BEGIN_NAMESPACE
+
+namespace Kuesa {
+
+/*!
+    \class Kuesa::LevelOfDetailSelector
+    \inheaderfile Kuesa/LevelOfDetailSelector
+    \inmodule Kuesa
+    \inherits Kuesa::KuesaNode
+    \since Kuesa 1.4
+
+    \brief Kuesa::LevelOfDetailSelector switches between the levels of detail
+    generated at import time based on the screen size of the meshes.
+
+    When Kuesa::GLTF2Import::GLTF2Options::lodLevelCount is greater than 0,
+    the glTF importer generates simplified versions of each triangle
+    primitive. A LevelOfDetailSelector associated with a Kuesa::View
+    estimates, for every such mesh, the fraction of the view height covered
+    by its bounding sphere as seen from the view's camera and selects the
+    matching level.
+
+    Level i + 1 is used when the screen size falls below
+    screenSizeThresholds[i]. To avoid flickering between levels when the
+    screen size hovers around a threshold, a level is only left once the
+    screen size has moved past the threshold by more than hysteresis (a
+    fraction of the threshold).
+
+    As meshes can be shared by several entities, the largest screen size of
+    all the entities referencing a mesh is used.
+
+    \note The selected level replaces the geometry of the mesh's
+    Qt3DRender::QGeometryRenderer, which is shared by every Kuesa::View
+    rendering the scene. Selection is therefore global: all views render the
+    level chosen for the camera of \l view. When several views show the
+    same scene, associate the selector with the view in which detail matters
+    most.
+*/
+
+/*!
+    \qmltype LevelOfDetailSelector
+    \instantiates Kuesa::LevelOfDetailSelector
+    \inqmlmodule Kuesa
+    \since Kuesa 1.4
+
+    \brief LevelOfDetailSelector switches between the levels of detail
+    generated at import time based on the screen size of the meshes.
+
+    \badcode
+    import Kuesa 1.4 as Kuesa
+
+    Kuesa.SceneEntity {
+        id: scene
+        Kuesa.GLTF2Importer {
+            source: "file:///car.gltf"
+            options.lodLevelCount: 3
+        }
+        Kuesa.LevelOfDetailSelector {
+            view: frameGraph.view
+            screenSizeThresholds: [0.3, 0.1, 0.03]
+        }
+    }
+    \endcode
+*/
+
+/*!
+    \property Kuesa::LevelOfDetailSelector::view
+
+    The Kuesa::View whose camera is used to compute screen sizes. The
+    selected levels apply to every view rendering the scene.
+*/
+
+/*!
+    \property Kuesa::LevelOfDetailSelector::screenSizeThresholds
+
+    Decreasing list of screen sizes, expressed as fractions of the view
+    height, below which the next coarser level of detail is selected.
+    Defaults to [0.25, 0.1, 0.04].
+*/
+
+/*!
+    \property Kuesa::LevelOfDetailSelector::hysteresis
+
+    Relative margin around each threshold inside of which the current level
+    is kept. Defaults to 0.1.
+*/
+
+/*!
+    \property Kuesa::LevelOfDetailSelector::managedMeshCount
+    \readonly
+
+    The number of meshes of the scene for which levels of detail are
+    available.
+*/
+
+namespace {
+
+Qt3DCore::QTransform *worldTransformForEntity(Qt3DCore::QEntity *entity)
+{
+    // Entities without a transform share the world matrix of their parent
+    while (entity) {
+        Qt3DCore::QTransform *transform = componentFromEntity<Qt3DCore::QTransform>(entity);
+        if (transform)
+            return transform;
+        entity = entity->parentEntity();
+    }
+    return nullptr;
+}
+
+float maxScale(const QMatrix4x4 &m)
+{
+    const float sx = QVector3D(m(0, 0), m(1, 0), m(2, 0)).lengthSquared();
+    const float sy = QVector3D(m(0, 1), m(1, 1), m(2, 1)).lengthSquared();
+    const float sz = QVector3D(m(0, 2), m(1, 2), m(2, 2)).lengthSquared();
+    return std::sqrt(std::max(sx, std::max(sy, sz)));
+}
+
+} // namespace
+
+LevelOfDetailSelector::LevelOfDetailSelector(Qt3DCore::QNode *parent)
+    : KuesaNode(parent)
+    , m_screenSizeThresholds({ 0.25, 0.1, 0.04 })
+{
+    connect(this, &KuesaNode::sceneEntityChanged,
+            this, [this] {
+                disconnect(m_loadingDoneConnection);
+                if (m_sceneEntity)
+                    m_loadingDoneConnection = connect(m_sceneEntity, &SceneEntity::loadingDone, this, &LevelOfDetailSelector::collectMeshes);
+                collectMeshes();
+            });
+    connect(this, &Qt3DCore::QNode::enabledChanged,
+            this, [this](bool enabled) {
+                if (enabled)
+                    scheduleUpdate();
+                else
+                    restoreFullDetail();
+            });
+}
+
+LevelOfDetailSelector::~LevelOfDetailSelector()
+{
+    for (const auto &c : m_cameraConnections)
+        disconnect(c);
+    for (const auto &c : m_transformConnections)
+        disconnect(c);
+}
+
+View *LevelOfDetailSelector::view() const
+{
+    return m_view;
+}
+
+QVector<qreal> LevelOfDetailSelector::screenSizeThresholds() const
+{
+    return m_screenSizeThresholds;
+}
+
+float LevelOfDetailSelector::hysteresis() const
+{
+    return m_hysteresis;
+}
+
+int LevelOfDetailSelector::managedMeshCount() const
+{
+    return int(m_meshes.size());
+}
+
+void LevelOfDetailSelector::setView(View *view)
+{
+    if (view == m_view)
+        return;
+
+    auto d = Qt3DCore::QNodePrivate::get(this);
+    if (m_view)
+        d->unregisterDestructionHelper(m_view);
+    disconnect(m_viewCameraConnection);
+
+    m_view = view;
+
+    if (m_view) {
+        d->registerDestructionHelper(m_view, &LevelOfDetailSelector::setView, m_view);
+        m_viewCameraConnection = connect(m_view, &View::cameraChanged, this, &LevelOfDetailSelector::watchCamera);
+    }
+
+    emit viewChanged(m_view);
+    watchCamera();
+}
+
+void LevelOfDetailSelector::setScreenSizeThresholds(const QVector<qreal> &screenSizeThresholds)
+{
+    if (screenSizeThresholds == m_screenSizeThresholds)
+        return;
+    m_screenSizeThresholds = screenSizeThresholds;
+    emit screenSizeThresholdsChanged(m_screenSizeThresholds);
+    scheduleUpdate();
+}
+
+void LevelOfDetailSelector::setHysteresis(float hysteresis)
+{
+    hysteresis = std::max(hysteresis, 0.0f);
+    if (qFuzzyCompare(hysteresis, m_hysteresis))
+        return;
+    m_hysteresis = hysteresis;
+    emit hysteresisChanged(m_hysteresis);
+    scheduleUpdate();
+}
+
+/*!
+    Returns the fraction of the viewport height covered by a sphere of world
+    space \a center and \a radius, as seen through \a viewMatrix and \a
+    projectionMatrix. Returns 1 when the camera is inside the sphere.
+ */
+float LevelOfDetailSelector::projectedScreenSize(const QMatrix4x4 &viewMatrix,
+                                                 const QMatrix4x4 &projectionMatrix,
+                                                 const QVector3D &center,
+                                                 float radius)
+{
+    // Orthographic projection, size doesn't depend on the distance
+    if (qFuzzyCompare(projectionMatrix(3, 3), 1.0f))
+        return radius * std::abs(projectionMatrix(1, 1));
+
+    const float distance = -viewMatrix.map(center).z();
+    if (distance <= radius)
+        return 1.0f;
+    return radius * std::abs(projectionMatrix(1, 1)) / distance;
+}
+
+/*!
+    Returns the level to use for a mesh currently drawn at \a currentLevel
+    with a given \a screenSize.
+
+    A coarser level is only selected once \a screenSize goes below the
+    matching threshold minus \a hysteresis percent and a finer level once it
+    goes above the threshold plus \a hysteresis percent.
+ */
+int LevelOfDetailSelector::selectLevel(float screenSize,
+                                       const QVector<qreal> &screenSizeThresholds,
+                                       int currentLevel,
+                                       float hysteresis)
+{
+    // Levels we must at least be at / may at most be at
+    int coarsestAllowed = 0;
+    int finestAllowed = 0;
+    for (const qreal threshold : screenSizeThresholds) {
+        if (screenSize < threshold * (1.0 - hysteresis))
+            ++finestAllowed;
+        if (screenSize < threshold * (1.0 + hysteresis))
+            ++coarsestAllowed;
+    }
+    return std::min(std::max(currentLevel, finestAllowed), coarsestAllowed);
+}
+
+/*!
+    Selects the level of detail of all managed meshes for the current camera
+    position. This is called automatically whenever the camera or a managed
+    mesh moves.
+ */
+void LevelOfDetailSelector::updateLevels()
+{
+    m_updateScheduled = false;
+
+    Qt3DCore::QEntity *camera = m_view ? m_view->camera() : nullptr;
+    if (!isEnabled() || camera == nullptr)
+        return;
+
+    Qt3DRender::QCamera *qcamera = qobject_cast<Qt3DRender::QCamera *>(camera);
+    Qt3DRender::QCameraLens *lens = componentFromEntity<Qt3DRender::QCameraLens>(camera);
+    Qt3DCore::QTransform *cameraTransform = componentFromEntity<Qt3DCore::QTransform>(camera);
+    if (lens == nullptr)
+        return;
+    const QMatrix4x4 viewMatrix = qcamera ? qcamera->viewMatrix()
+                                          : (cameraTransform ? cameraTransform->worldMatrix().inverted() : QMatrix4x4());
+    const QMatrix4x4 projectionMatrix = lens->projectionMatrix();
+
+    for (ManagedMesh &mesh : m_meshes) {
+        if (mesh.renderer.isNull())
+            continue;
+
+        const auto entities = mesh.renderer->entities();
+        if (entities.empty())
+            continue;
+
+        float screenSize = 0.0f;
+        for (Qt3DCore::QEntity *entity : entities) {
+            Qt3DCore::QTransform *transform = worldTransformForEntity(entity);
+            const QMatrix4x4 worldMatrix = transform ? transform->worldMatrix() : QMatrix4x4();
+            screenSize = std::max(screenSize, projectedScreenSize(viewMatrix, projectionMatrix,
+                                                                  worldMatrix.map(mesh.center),
+                                                                  mesh.radius * maxScale(worldMatrix)));
+        }
+
+        const int level = std::min(selectLevel(screenSize, m_screenSizeThresholds, mesh.currentLevel, m_hysteresis),
+                                   int(mesh.levels.size()) - 1);
+        if (level != mesh.currentLevel) {
+            mesh.currentLevel = level;
+            mesh.renderer->setGeometry(static_cast<Qt3DGeometry::QGeometry *>(mesh.levels[size_t(level)]));
+        }
+    }
+}
+
+void LevelOfDetailSelector::collectMeshes()
+{
+    restoreFullDetail();
+    for (const auto &c : m_transformConnections)
+        disconnect(c);
+    m_transformConnections.clear();
+    m_meshes.clear();
+
+    if (m_sceneEntity) {
+        const auto renderers = m_sceneEntity->findChildren<Qt3DRender::QGeometryRenderer *>();
+        for (Qt3DRender::QGeometryRenderer *renderer : renderers) {
+            const GLTF2Import::MeshSimplifier::LevelsOfDetail *levelsOfDetail =
+                    GLTF2Import::MeshSimplifier::LevelsOfDetail::find(renderer);
+            if (levelsOfDetail == nullptr)
+                continue;
+
+            // We need a full detail level and at least one simplified level
+            ManagedMesh mesh;
+            for (Qt3DGeometry::QGeometry *geometry : levelsOfDetail->levels) {
+                if (geometry == nullptr)
+                    break;
+                mesh.levels.push_back(geometry);
+            }
+            if (mesh.levels.size() < 2)
+                continue;
+
+            // Extents are seeded by the importer, no need to wait for the backend
+            const auto *fullDetail = static_cast<Qt3DGeometry::QGeometry *>(mesh.levels.front());
+            mesh.center = (fullDetail->minExtent() + fullDetail->maxExtent()) * 0.5f;
+            mesh.radius = (fullDetail->maxExtent() - fullDetail->minExtent()).length() * 0.5f;
+
+            mesh.renderer = renderer;
+            const auto entities = renderer->entities();
+            for (Qt3DCore::QEntity *entity : entities) {
+                Qt3DCore::QTransform *transform = worldTransformForEntity(entity);
+                if (transform)
+                    m_transformConnections.push_back(connect(transform, &Qt3DCore::QTransform::worldMatrixChanged,
+                                                             this, &LevelOfDetailSelector::scheduleUpdate));
+            }
+            m_meshes.push_back(std::move(mesh));
+        }
+    }
+
+    emit managedMeshCountChanged(managedMeshCount());
+    scheduleUpdate();
+}
+
+void LevelOfDetailSelector::watchCamera()
+{
+    for (const auto &c : m_cameraConnections)
+        disconnect(c);
+    m_cameraConnections.clear();
+
+    Qt3DCore::QEntity *camera = m_view ? m_view->camera() : nullptr;
+    if (camera) {
+        Qt3DRender::QCameraLens *lens = componentFromEntity<Qt3DRender::QCameraLens>(camera);
+        Qt3DCore::QTransform *transform = componentFromEntity<Qt3DCore::QTransform>(camera);
+        if (lens)
+            m_cameraConnections.push_back(connect(lens, &Qt3DRender::QCameraLens::projectionMatrixChanged,
+                                                  this, &LevelOfDetailSelector::scheduleUpdate));
+        if (transform)
+            m_cameraConnections.push_back(connect(transform, &Qt3DCore::QTransform::worldMatrixChanged,
+                                                  this, &LevelOfDetailSelector::scheduleUpdate));
+        Qt3DRender::QCamera *qcamera = qobject_cast<Qt3DRender::QCamera *>(camera);
+        if (qcamera)
+            m_cameraConnections.push_back(connect(qcamera, &Qt3DRender::QCamera::viewMatrixChanged,
+                                                  this, &LevelOfDetailSelector::scheduleUpdate));
+    }
+
+    scheduleUpdate();
+}
+
+void LevelOfDetailSelector::scheduleUpdate()
+{
+    if (m_updateScheduled || !isEnabled())
+        return;
+    m_updateScheduled = true;
+    QMetaObject::invokeMethod(this, "updateLevels", Qt::QueuedConnection);
+}
+
+void LevelOfDetailSelector::restoreFullDetail()
+{
+    for (ManagedMesh &mesh : m_meshes) {
+        if (mesh.renderer.isNull() || mesh.currentLevel == 0)
+            continue;
+        mesh.currentLevel = 0;
+        mesh.renderer->setGeometry(static_cast<Qt3DGeometry::QGeometry *>(mesh.levels.front()));
+    }
+}
+
+} // namespace Kuesa
+
+QT_END_NAMESPACE
@@ -0,0 +1,122 @@
+/*
+    levelofdetailselector.h
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef KUESA_LEVELOFDETAILSELECTOR_H
+#define KUESA_LEVELOFDETAILSELECTOR_H
+
+#include <Kuesa/kuesa_global.h>
+#include <Kuesa/kuesanode.h>
+#include <QMatrix4x4>
+#include <QPointer>
+#include <QVector>
+#include <QVector3D>
+#include <vector>
+
+class tst_LevelOfDetailSelector;
+
+QT_BEGIN_NAMESPACE
+
+namespace Qt3DRender {
+class QGeometryRenderer;
+}
+
+namespace Kuesa {
+
+class View;
+
+class KUESASHARED_EXPORT LevelOfDetailSelector : public KuesaNode
+{
+    Q_OBJECT
+    Q_PROPERTY(Kuesa::View *view READ view WRITE setView NOTIFY viewChanged)
+    Q_PROPERTY(QVector<qreal> screenSizeThresholds READ screenSizeThresholds WRITE setScreenSizeThresholds NOTIFY screenSizeThresholdsChanged)
+    Q_PROPERTY(float hysteresis READ hysteresis WRITE setHysteresis NOTIFY hysteresisChanged)
+    Q_PROPERTY(int managedMeshCount READ managedMeshCount NOTIFY managedMeshCountChanged)
+
+public:
+    explicit LevelOfDetailSelector(Qt3DCore::QNode *parent = nullptr);
+    ~LevelOfDetailSelector();
+
+    View *view() const;
+    QVector<qreal> screenSizeThresholds() const;
+    float hysteresis() const;
+    int managedMeshCount() const;
+
+    static float projectedScreenSize(const QMatrix4x4 &viewMatrix,
+                                     const QMatrix4x4 &projectionMatrix,
+                                     const QVector3D &center,
+                                     float radius);
+    static int selectLevel(float screenSize,
+                           const QVector<qreal> &screenSizeThresholds,
+                           int currentLevel,
+                           float hysteresis);
+
+public Q_SLOTS:
+    void setView(Kuesa::View *view);
+    void setScreenSizeThresholds(const QVector<qreal> &screenSizeThresholds);
+    void setHysteresis(float hysteresis);
+
+    void updateLevels();
+
+Q_SIGNALS:
+    void viewChanged(Kuesa::View *view);
+    void screenSizeThresholdsChanged(const QVector<qreal> &screenSizeThresholds);
+    void hysteresisChanged(float hysteresis);
+    void managedMeshCountChanged(int managedMeshCount);
+
+private:
+    struct ManagedMesh {
+        QPointer<Qt3DRender::QGeometryRenderer> renderer;
+        std::vector<Qt3DCore::QNode *> levels;
+        QVector3D center;
+        float radius = 0.0f;
+        int currentLevel = 0;
+    };
+
+    void collectMeshes();
+    void watchCamera();
+    void scheduleUpdate();
+    void restoreFullDetail();
+
+    View *m_view = nullptr;
+    QVector<qreal> m_screenSizeThresholds;
+    float m_hysteresis = 0.1f;
+    std::vector<ManagedMesh> m_meshes;
+    std::vector<QMetaObject::Connection> m_cameraConnections;
+    std::vector<QMetaObject::Connection> m_transformConnections;
+    QMetaObject::Connection m_loadingDoneConnection;
+    QMetaObject::Connection m_viewCameraConnection;
+    bool m_updateScheduled = false;
+
+    friend class ::tst_LevelOfDetailSelector;
+};
+
+} // namespace Kuesa
+
+QT_END_NAMESPACE
+
+#endif // KUESA_LEVELOFDETAILSELECTOR_H
@@ -0,0 +1,418 @@
+/*
+    clusteredlights.cpp
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "clusteredlights_p.h"
+#include "directionallight.h"
+#include "pointlight.h"
+#include "spotlight.h"
+#include <Kuesa/private/kuesa_utils_p.h>
+#include <Kuesa/private/logging_p.h>
+#include <Qt3DCore/QEntity>
+#include <Qt3DCore/QTransform>
+#include <Qt3DRender/QCameraLens>
+#include <Qt3DRender/QParameter>
+#include <QMatrix4x4>
+#include <QtMath>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+#include <Qt3DCore/QBuffer>
+#else
+#include <Qt3DRender/QBuffer>
+#endif
+
+QT_BEGIN_NAMESPACE
+
+namespace Kuesa {
+
+namespace {
+
+Qt3DCore::QTransform *lightTransform(ShadowCastingLight *light)
+{
+    const auto entities = light->entities();
+    return entities.isEmpty() ? nullptr : componentFromEntity<Qt3DCore::QTransform>(entities.first());
+}
+
+float lightRange(ShadowCastingLight *light)
+{
+    if (auto pointLight = qobject_cast<PointLight *>(light))
+        return pointLight->range();
+    if (auto spotLight = qobject_cast<SpotLight *>(light))
+        return spotLight->range();
+    return 0.0f;
+}
+
+void writeVector(char *&data, float x, float y, float z, float w)
+{
+    const float v[4] = { x, y, z, w };
+    std::memcpy(data, v, sizeof(v));
+    data += sizeof(v);
+}
+
+// Uploads the bytes which differ from what was uploaded last
+void uploadChanges(Qt3DGeometry::QBuffer *buffer, QByteArray &uploaded, const QByteArray &data)
+{
+    Q_ASSERT(uploaded.size() == data.size());
+    int first = 0;
+    while (first < data.size() && data[first] == uploaded[first])
+        ++first;
+    if (first == data.size())
+        return;
+    int last = data.size();
+    while (data[last - 1] == uploaded[last - 1])
+        --last;
+
+    std::memcpy(uploaded.data() + first, data.constData() + first, size_t(last - first));
+    buffer->updateData(first, data.mid(first, last - first));
+}
+
+} // namespace
+
+/*!
+ * \internal
+ * \class Kuesa::ClusteredLights
+ * \brief Uploads the lights of a View binned in clusters of its frustum
+ * \inmodule Kuesa
+ * \since Kuesa 1.4
+ *
+ * ClusteredLights assigns lights to the clusters of a LightClusterGrid
+ * covering the frustum of the camera and uploads the result in three uniform
+ * buffers: the packed lights, the grid description with the offsets of each
+ * cluster into the light index list, and that list of 8 bit light indices.
+ * The metallic roughness shaders then only evaluate the lights of the cluster
+ * a fragment lies in, see kuesa_clusteredlights.inc.frag.
+ *
+ * Lights without a range, directional lights and all lights of cameras which
+ * don't use a symmetric perspective projection reach every cluster. They are
+ * packed first and evaluated by every fragment instead of being binned.
+ *
+ * Shadow casting lights are left out: they keep going through the light_0 to
+ * light_7 uniforms Qt 3D selects for each draw, as those also carry their
+ * shadow maps. Only the lights set with setLights, which are those of the
+ * LightCollection of the SceneEntity, are clustered.
+ *
+ * The buffers are rebuilt whenever the camera or one of the lights changes,
+ * and only the bytes which changed are uploaded. While disabled, the grid of
+ * the cluster buffer is empty, which makes the shaders fall back to the
+ * lights selected by Qt 3D.
+ */
+
+constexpr int ClusteredLights::TileCountX;
+constexpr int ClusteredLights::TileCountY;
+constexpr int ClusteredLights::SliceCount;
+constexpr int ClusteredLights::ClusterCount;
+constexpr int ClusteredLights::MaxLights;
+constexpr int ClusteredLights::MaxLightIndices;
+constexpr int ClusteredLights::LightDataSize;
+constexpr int ClusteredLights::ClusterHeaderSize;
+constexpr int ClusteredLights::ClusterDataSize;
+constexpr int ClusteredLights::LightIndexDataSize;
+
+ClusteredLights::ClusteredLights(Qt3DCore::QNode *parent)
+    : QObject(parent)
+    , m_lightData(LightDataSize, '\0')
+    , m_clusterData(ClusterDataSize, '\0')
+    , m_lightIndexData(LightIndexDataSize, '\0')
+{
+    m_grid.setDimensions(TileCountX, TileCountY, SliceCount);
+
+    auto createParameter = [parent](const QString &blockName, const QByteArray &data) {
+        auto buffer = new Qt3DGeometry::QBuffer(parent);
+        buffer->setData(data);
+        return new Qt3DRender::QParameter(blockName, QVariant::fromValue(buffer), parent);
+    };
+    m_lightParameter = createParameter(QStringLiteral("KuesaClusterLights"), m_lightData);
+    m_clusterParameter = createParameter(QStringLiteral("KuesaClusters"), m_clusterData);
+    m_lightIndexParameter = createParameter(QStringLiteral("KuesaClusterLightIndices"), m_lightIndexData);
+}
+
+ClusteredLights::~ClusteredLights()
+{
+    for (const auto &connection : m_connections)
+        disconnect(connection);
+}
+
+void ClusteredLights::setEnabled(bool enabled)
+{
+    if (enabled == m_enabled)
+        return;
+    m_enabled = enabled;
+    trackChanges();
+    update();
+}
+
+bool ClusteredLights::isEnabled() const
+{
+    return m_enabled;
+}
+
+void ClusteredLights::setCamera(Qt3DCore::QEntity *camera)
+{
+    if (camera == m_camera)
+        return;
+    m_camera = camera;
+    trackChanges();
+    scheduleUpdate();
+}
+
+Qt3DCore::QEntity *ClusteredLights::camera() const
+{
+    return m_camera;
+}
+
+void ClusteredLights::setLights(const QVector<ShadowCastingLight *> &lights)
+{
+    m_lights.clear();
+    m_lights.reserve(lights.size());
+    for (ShadowCastingLight *light : lights)
+        m_lights.push_back(light);
+    trackChanges();
+    scheduleUpdate();
+}
+
+QVector<ShadowCastingLight *> ClusteredLights::lights() const
+{
+    QVector<ShadowCastingLight *> lights;
+    lights.reserve(m_lights.size());
+    for (const auto &light : m_lights) {
+        if (light)
+            lights.push_back(light);
+    }
+    return lights;
+}
+
+/*!
+ * Returns the parameters binding the uniform buffers, to be added to the
+ * passes rendering the scene.
+ */
+QVector<Qt3DRender::QParameter *> ClusteredLights::parameters() const
+{
+    return { m_lightParameter, m_clusterParameter, m_lightIndexParameter };
+}
+
+const LightClusterGrid &ClusteredLights::grid() const
+{
+    return m_grid;
+}
+
+int ClusteredLights::globalLightCount() const
+{
+    return m_globalLightCount;
+}
+
+int ClusteredLights::clusteredLightCount() const
+{
+    return m_clusteredLightCount;
+}
+
+const QByteArray &ClusteredLights::lightData() const
+{
+    return m_lightData;
+}
+
+const QByteArray &ClusteredLights::clusterData() const
+{
+    return m_clusterData;
+}
+
+const QByteArray &ClusteredLights::lightIndexData() const
+{
+    return m_lightIndexData;
+}
+
+void ClusteredLights::scheduleUpdate()
+{
+    if (!m_enabled || m_updateScheduled)
+        return;
+    m_updateScheduled = true;
+    QMetaObject::invokeMethod(this, &ClusteredLights::update, Qt::QueuedConnection);
+}
+
+void ClusteredLights::trackChanges()
+{
+    for (const auto &connection : m_connections)
+        disconnect(connection);
+    m_connections.clear();
+    if (!m_enabled)
+        return;
+
+    auto track = [this](const auto *sender, auto signal) {
+        m_connections.push_back(connect(sender, signal, this, &ClusteredLights::scheduleUpdate));
+    };
+
+    if (m_camera) {
+        if (auto lens = componentFromEntity<Qt3DRender::QCameraLens>(m_camera))
+            track(lens, &Qt3DRender::QCameraLens::projectionMatrixChanged);
+        if (auto transform = componentFromEntity<Qt3DCore::QTransform>(m_camera))
+            track(transform, &Qt3DCore::QTransform::worldMatrixChanged);
+    }
+
+    for (const auto &light : qAsConst(m_lights)) {
+        if (!light)
+            continue;
+        track(light.data(), &QObject::destroyed);
+        track(light.data(), &ShadowCastingLight::enabledChanged);
+        track(light.data(), &ShadowCastingLight::colorChanged);
+        track(light.data(), &ShadowCastingLight::intensityChanged);
+        track(light.data(), &ShadowCastingLight::castsShadowsChanged);
+        if (auto transform = lightTransform(light))
+            track(transform, &Qt3DCore::QTransform::worldMatrixChanged);
+        if (auto pointLight = qobject_cast<PointLight *>(light)) {
+            track(pointLight, &PointLight::rangeChanged);
+        } else if (auto spotLight = qobject_cast<SpotLight *>(light)) {
+            track(spotLight, &SpotLight::rangeChanged);
+            track(spotLight, &SpotLight::localDirectionChanged);
+            track(spotLight, &SpotLight::innerConeAngleChanged);
+            track(spotLight, &SpotLight::outerConeAngleChanged);
+        } else if (auto directionalLight = qobject_cast<DirectionalLight *>(light)) {
+            track(directionalLight, &DirectionalLight::directionChanged);
+            track(directionalLight, &DirectionalLight::directionModeChanged);
+        }
+    }
+}
+
+/*!
+ * Bins the lights and uploads the buffers. Called on the next event loop
+ * iteration after the camera or a light changed.
+ */
+void ClusteredLights::update()
+{
+    m_updateScheduled = false;
+
+    QByteArray lightData(LightDataSize, '\0');
+    QByteArray clusterData(ClusterDataSize, '\0');
+    QByteArray lightIndexData(LightIndexDataSize, '\0');
+    m_globalLightCount = 0;
+    m_clusteredLightCount = 0;
+    m_grid.clearLights();
+
+    auto lens = m_camera ? componentFromEntity<Qt3DRender::QCameraLens>(m_camera) : nullptr;
+    if (m_enabled && lens) {
+        auto cameraTransform = componentFromEntity<Qt3DCore::QTransform>(m_camera);
+        const QMatrix4x4 viewMatrix = cameraTransform ? cameraTransform->worldMatrix().inverted() : QMatrix4x4();
+        const QMatrix4x4 projectionMatrix = lens->projectionMatrix();
+
+        // The grid only covers symmetric perspective frustums
+        const bool binned = lens->projectionType() == Qt3DRender::QCameraLens::PerspectiveProjection &&
+                qFuzzyIsNull(projectionMatrix(0, 2)) && qFuzzyIsNull(projectionMatrix(1, 2));
+        if (binned) {
+            const float fieldOfView = qRadiansToDegrees(2.0f * std::atan(1.0f / projectionMatrix(1, 1)));
+            const float aspectRatio = projectionMatrix(1, 1) / projectionMatrix(0, 0);
+            m_grid.setProjection(fieldOfView, aspectRatio, lens->nearPlane(), lens->farPlane());
+        }
+
+        // Shadow casting lights are evaluated from the lights Qt 3D selects
+        std::vector<ShadowCastingLight *> globalLights;
+        std::vector<ShadowCastingLight *> clusteredLights;
+        for (const auto &light : qAsConst(m_lights)) {
+            if (!light || !light->isEnabled() || light->castsShadows() || light->entities().isEmpty())
+                continue;
+            if (binned && light->type() != Qt3DRender::QAbstractLight::DirectionalLight && lightRange(light) > 0.0f)
+                clusteredLights.push_back(light);
+            else
+                globalLights.push_back(light);
+        }
+        if (globalLights.size() + clusteredLights.size() > size_t(MaxLights)) {
+            qCWarning(kuesa) << "Clustered lighting supports up to" << MaxLights << "lights,"
+                             << globalLights.size() + clusteredLights.size() - MaxLights << "lights are ignored";
+            globalLights.resize(std::min(globalLights.size(), size_t(MaxLights)));
+            clusteredLights.resize(size_t(MaxLights) - globalLights.size());
+        }
+        m_globalLightCount = int(globalLights.size());
+        m_clusteredLightCount = int(clusteredLights.size());
+
+        // Pack the lights, the ones reaching every cluster first
+        char *lightWriter = lightData.data();
+        auto packLight = [&](ShadowCastingLight *light) {
+            auto transform = lightTransform(light);
+            const QMatrix4x4 worldMatrix = transform ? transform->worldMatrix() : QMatrix4x4();
+            const QVector3D position = worldMatrix * QVector3D();
+            QVector3D direction;
+            float lightAngleScale = 0.0f;
+            float lightAngleOffset = 0.0f;
+            if (auto spotLight = qobject_cast<SpotLight *>(light)) {
+                direction = worldMatrix.mapVector(spotLight->localDirection()).normalized();
+                const float innerCone = std::cos(qDegreesToRadians(spotLight->innerConeAngle()));
+                const float outerCone = std::cos(qDegreesToRadians(spotLight->outerConeAngle()));
+                lightAngleScale = 1.0f / std::max(0.001f, innerCone - outerCone);
+                lightAngleOffset = -outerCone * lightAngleScale;
+            } else if (auto directionalLight = qobject_cast<DirectionalLight *>(light)) {
+                direction = directionalLight->direction();
+                if (directionalLight->directionMode() == DirectionalLight::Local)
+                    direction = worldMatrix.mapVector(direction).normalized();
+            }
+            const QColor color = light->color();
+            writeVector(lightWriter, position.x(), position.y(), position.z(), lightRange(light));
+            writeVector(lightWriter, float(color.redF()), float(color.greenF()), float(color.blueF()), light->intensity());
+            writeVector(lightWriter, direction.x(), direction.y(), direction.z(), float(light->type()));
+            writeVector(lightWriter, lightAngleScale, lightAngleOffset, 0.0f, 0.0f);
+            return position;
+        };
+        for (ShadowCastingLight *light : globalLights)
+            packLight(light);
+        for (ShadowCastingLight *light : clusteredLights)
+            m_grid.addLight(viewMatrix * packLight(light), lightRange(light));
+
+        m_grid.assign();
+
+        // Grid description, shaders map fragments to clusters with it
+        const float nearPlane = std::max(lens->nearPlane(), 1e-4f);
+        const float farPlane = std::max(lens->farPlane(), nearPlane * 1.001f);
+        const float sliceScale = float(SliceCount) / std::log(farPlane / nearPlane);
+        const quint32 grid[4] = { quint32(TileCountX), quint32(TileCountY), quint32(SliceCount), quint32(m_globalLightCount) };
+        const float depth[4] = { nearPlane, farPlane, sliceScale, -std::log(nearPlane) * sliceScale };
+        char *clusterWriter = clusterData.data();
+        std::memcpy(clusterWriter, viewMatrix.constData(), 16 * sizeof(float));
+        std::memcpy(clusterWriter + 16 * sizeof(float), projectionMatrix.constData(), 16 * sizeof(float));
+        std::memcpy(clusterWriter + 32 * sizeof(float), grid, sizeof(grid));
+        std::memcpy(clusterWriter + 36 * sizeof(float), depth, sizeof(depth));
+
+        // Offsets into the light index list, which gets truncated if too long
+        const std::vector<quint32> &offsets = m_grid.clusterOffsets();
+        const std::vector<quint32> &indices = m_grid.lightIndices();
+        if (indices.size() > size_t(MaxLightIndices))
+            qCWarning(kuesa) << "Clustered lighting supports up to" << MaxLightIndices << "light assignments,"
+                             << indices.size() - MaxLightIndices << "are ignored";
+        auto *clusterOffsets = reinterpret_cast<quint32 *>(clusterWriter + ClusterHeaderSize);
+        for (size_t i = 0, m = offsets.size(); i < m; ++i)
+            clusterOffsets[i] = std::min(offsets[i], quint32(MaxLightIndices));
+        auto *lightIndices = reinterpret_cast<quint8 *>(lightIndexData.data());
+        for (size_t i = 0, m = std::min(indices.size(), size_t(MaxLightIndices)); i < m; ++i)
+            lightIndices[i] = quint8(indices[i]);
+    }
+
+    uploadChanges(m_lightParameter->value().value<Qt3DGeometry::QBuffer *>(), m_lightData, lightData);
+    uploadChanges(m_clusterParameter->value().value<Qt3DGeometry::QBuffer *>(), m_clusterData, clusterData);
+    uploadChanges(m_lightIndexParameter->value().value<Qt3DGeometry::QBuffer *>(), m_lightIndexData, lightIndexData);
+}
+
+} // namespace Kuesa
+
+QT_END_NAMESPACE
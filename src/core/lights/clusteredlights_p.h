@@ -0,0 +1,133 @@
+/*
+    clusteredlights_p.h
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef KUESA_CLUSTEREDLIGHTS_P_H
+#define KUESA_CLUSTEREDLIGHTS_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Kuesa API.  It exists for the convenience
+// of other Kuesa classes.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <Kuesa/private/kuesa_global_p.h>
+#include <Kuesa/private/lightclustergrid_p.h>
+#include <QObject>
+#include <QPointer>
+#include <QVector>
+#include <vector>
+
+QT_BEGIN_NAMESPACE
+
+namespace Qt3DCore {
+class QNode;
+class QEntity;
+} // namespace Qt3DCore
+
+namespace Qt3DRender {
+class QParameter;
+} // namespace Qt3DRender
+
+namespace Kuesa {
+
+class ShadowCastingLight;
+
+class KUESA_PRIVATE_EXPORT ClusteredLights : public QObject
+{
+    Q_OBJECT
+public:
+    // Must match the uniform blocks of kuesa_clusteredlights.inc.frag
+    static constexpr int TileCountX = 8;
+    static constexpr int TileCountY = 6;
+    static constexpr int SliceCount = 16;
+    static constexpr int ClusterCount = TileCountX * TileCountY * SliceCount;
+    static constexpr int MaxLights = 256;
+    static constexpr int MaxLightIndices = 16384;
+
+    static constexpr int LightDataSize = MaxLights * 4 * 4 * int(sizeof(float));
+    static constexpr int ClusterHeaderSize = 2 * 16 * int(sizeof(float)) + 2 * 4 * int(sizeof(float));
+    static constexpr int ClusterDataSize = ClusterHeaderSize + (ClusterCount + 1 + 3) / 4 * 4 * int(sizeof(quint32));
+    static constexpr int LightIndexDataSize = MaxLightIndices;
+
+    explicit ClusteredLights(Qt3DCore::QNode *parent);
+    ~ClusteredLights();
+
+    void setEnabled(bool enabled);
+    bool isEnabled() const;
+
+    void setCamera(Qt3DCore::QEntity *camera);
+    Qt3DCore::QEntity *camera() const;
+
+    void setLights(const QVector<ShadowCastingLight *> &lights);
+    QVector<ShadowCastingLight *> lights() const;
+
+    QVector<Qt3DRender::QParameter *> parameters() const;
+
+    const LightClusterGrid &grid() const;
+    int globalLightCount() const;
+    int clusteredLightCount() const;
+
+    const QByteArray &lightData() const;
+    const QByteArray &clusterData() const;
+    const QByteArray &lightIndexData() const;
+
+    void update();
+
+private:
+    void scheduleUpdate();
+    void trackChanges();
+
+    QVector<QPointer<ShadowCastingLight>> m_lights;
+    QPointer<Qt3DCore::QEntity> m_camera;
+    std::vector<QMetaObject::Connection> m_connections;
+    bool m_enabled = false;
+    bool m_updateScheduled = false;
+
+    LightClusterGrid m_grid;
+    int m_globalLightCount = 0;
+    int m_clusteredLightCount = 0;
+
+    QByteArray m_lightData;
+    QByteArray m_clusterData;
+    QByteArray m_lightIndexData;
+
+    Qt3DRender::QParameter *m_lightParameter = nullptr;
+    Qt3DRender::QParameter *m_clusterParameter = nullptr;
+    Qt3DRender::QParameter *m_lightIndexParameter = nullptr;
+};
+
+} // namespace Kuesa
+
+QT_END_NAMESPACE
+
+#endif // KUESA_CLUSTEREDLIGHTS_P_H
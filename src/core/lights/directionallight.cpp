@@ -28,6 +28,7 @@
 
 #include "directionallight.h"
 #include "directionallight_p.h"
+#include <Kuesa/private/shadowcascades_p.h>
 #include <Qt3DRender/private/shaderdata_p.h>
 
 QT_BEGIN_NAMESPACE
@@ -85,6 +86,58 @@ namespace Kuesa {
     The default is World.
  */
 
+/*!
+    \qmlproperty int Kuesa::DirectionalLight::cascadeCount
+    \since Kuesa 1.4
+
+    Specifies the number of cascades of the shadow map, between 1 and 4.
+    With more than one cascade, the view frustum of the camera returned by
+    ForwardRenderer::shadowCascadeCamera() is split along its depth and each
+    slice gets its own shadow map, giving sharp shadows close to the camera
+    while still covering distant objects. The default is 1, a single shadow
+    map covering the whole scene.
+
+    Cascades are fitted to the camera of a single view: the first sub view
+    of the ForwardRenderer, or the ForwardRenderer itself when it has none.
+    The other views render and sample a single shadow map covering the
+    whole scene instead.
+*/
+
+/*!
+    \property Kuesa::DirectionalLight::cascadeCount
+    \since Kuesa 1.4
+
+    Specifies the number of cascades of the shadow map, between 1 and 4.
+    With more than one cascade, the view frustum of the camera returned by
+    ForwardRenderer::shadowCascadeCamera() is split along its depth and each
+    slice gets its own shadow map, giving sharp shadows close to the camera
+    while still covering distant objects. The default is 1, a single shadow
+    map covering the whole scene.
+
+    Cascades are fitted to the camera of a single view: the first sub view
+    of the ForwardRenderer, or the ForwardRenderer itself when it has none.
+    The other views render and sample a single shadow map covering the
+    whole scene instead.
+*/
+
+/*!
+    \qmlproperty float Kuesa::DirectionalLight::cascadeSplitLambda
+    \since Kuesa 1.4
+
+    Specifies how the view frustum is split into cascades, from 0 for slices
+    of equal depth to 1 for slices growing logarithmically with the distance
+    to the camera. The default is 0.75.
+*/
+
+/*!
+    \property Kuesa::DirectionalLight::cascadeSplitLambda
+    \since Kuesa 1.4
+
+    Specifies how the view frustum is split into cascades, from 0 for slices
+    of equal depth to 1 for slices growing logarithmically with the distance
+    to the camera. The default is 0.75.
+*/
+
 DirectionalLightPrivate::DirectionalLightPrivate()
     : ShadowCastingLightPrivate(Qt3DRender::QAbstractLight::DirectionalLight)
 {
@@ -144,6 +197,36 @@ DirectionalLight::DirectionMode DirectionalLight::directionMode() const
     return m_directionType;
 }
 
+void DirectionalLight::setCascadeCount(int cascadeCount)
+{
+    cascadeCount = qBound(1, cascadeCount, ShadowCascades::MaxCascadeCount);
+    if (m_cascadeCount == cascadeCount)
+        return;
+
+    m_cascadeCount = cascadeCount;
+    emit cascadeCountChanged(m_cascadeCount);
+}
+
+int DirectionalLight::cascadeCount() const
+{
+    return m_cascadeCount;
+}
+
+void DirectionalLight::setCascadeSplitLambda(float cascadeSplitLambda)
+{
+    cascadeSplitLambda = qBound(0.0f, cascadeSplitLambda, 1.0f);
+    if (qFuzzyCompare(m_cascadeSplitLambda, cascadeSplitLambda))
+        return;
+
+    m_cascadeSplitLambda = cascadeSplitLambda;
+    emit cascadeSplitLambdaChanged(m_cascadeSplitLambda);
+}
+
+float DirectionalLight::cascadeSplitLambda() const
+{
+    return m_cascadeSplitLambda;
+}
+
 } // namespace Kuesa
 
 QT_END_NAMESPACE
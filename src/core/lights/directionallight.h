@@ -42,6 +42,8 @@ class KUESASHARED_EXPORT DirectionalLight : public ShadowCastingLight
     Q_OBJECT
     Q_PROPERTY(QVector3D direction READ direction WRITE setDirection NOTIFY directionChanged)
     Q_PROPERTY(Kuesa::DirectionalLight::DirectionMode directionMode READ directionMode WRITE setDirectionMode NOTIFY directionModeChanged)
+    Q_PROPERTY(int cascadeCount READ cascadeCount WRITE setCascadeCount NOTIFY cascadeCountChanged)
+    Q_PROPERTY(float cascadeSplitLambda READ cascadeSplitLambda WRITE setCascadeSplitLambda NOTIFY cascadeSplitLambdaChanged)
 
 public:
     enum DirectionMode {
@@ -55,14 +57,20 @@ public:
 
     QVector3D direction() const;
     Kuesa::DirectionalLight::DirectionMode directionMode() const;
+    int cascadeCount() const;
+    float cascadeSplitLambda() const;
 
 public Q_SLOTS:
     void setDirection(const QVector3D &direction);
     void setDirectionMode(Kuesa::DirectionalLight::DirectionMode directionMode);
+    void setCascadeCount(int cascadeCount);
+    void setCascadeSplitLambda(float cascadeSplitLambda);
 
 Q_SIGNALS:
     void directionChanged(const QVector3D &direction);
     void directionModeChanged(Kuesa::DirectionalLight::DirectionMode directionMode);
+    void cascadeCountChanged(int cascadeCount);
+    void cascadeSplitLambdaChanged(float cascadeSplitLambda);
 
 protected:
     explicit DirectionalLight(DirectionalLightPrivate &dd, Qt3DCore::QNode *parent = nullptr);
@@ -71,6 +79,8 @@ private:
     Q_DECLARE_PRIVATE(DirectionalLight)
 
     DirectionMode m_directionType = World;
+    int m_cascadeCount = 1;
+    float m_cascadeSplitLambda = 0.75f;
 };
 
 } // namespace Kuesa
@@ -0,0 +1,334 @@
+/*
+    lightclustergrid.cpp
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "lightclustergrid_p.h"
+
+#include <QtMath>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+QT_BEGIN_NAMESPACE
+
+using namespace Kuesa;
+
+namespace {
+
+inline float sphereBoxDistanceSquared(float x, float y, float z,
+                                      float minX, float minY, float minZ,
+                                      float maxX, float maxY, float maxZ)
+{
+    const float dx = std::max(0.0f, std::max(minX - x, x - maxX));
+    const float dy = std::max(0.0f, std::max(minY - y, y - maxY));
+    const float dz = std::max(0.0f, std::max(minZ - z, z - maxZ));
+    return dx * dx + dy * dy + dz * dz;
+}
+
+} // namespace
+
+/*!
+ * \internal
+ * \class Kuesa::LightClusterGrid
+ * \brief Assigns lights to the clusters of a view frustum
+ * \inmodule Kuesa
+ * \since Kuesa 1.4
+ *
+ * The view frustum is divided in tileCountX by tileCountY screen tiles and
+ * sliceCount depth slices growing exponentially with the distance to the
+ * camera. Each light, a sphere of the light's range in view space, is
+ * assigned to every cluster it intersects.
+ *
+ * The result is laid out to be uploaded as is: clusterOffsets() holds
+ * clusterCount() + 1 prefix sums into lightIndices(), which lists the lights
+ * of each cluster in increasing order.
+ *
+ * assign() only tests the lights which reach the depth range of a slice
+ * against the rows of that slice, and only the lights which reach a row
+ * against its clusters. Lights are stored as one array per component so that
+ * the innermost loops vectorize. assignBruteForce() tests every light against
+ * every cluster and gives the exact same result.
+ */
+
+LightClusterGrid::LightClusterGrid()
+{
+}
+
+void LightClusterGrid::setDimensions(int tileCountX, int tileCountY, int sliceCount)
+{
+    m_tileCountX = std::max(tileCountX, 1);
+    m_tileCountY = std::max(tileCountY, 1);
+    m_sliceCount = std::max(sliceCount, 1);
+    m_boundsDirty = true;
+}
+
+int LightClusterGrid::tileCountX() const
+{
+    return m_tileCountX;
+}
+
+int LightClusterGrid::tileCountY() const
+{
+    return m_tileCountY;
+}
+
+int LightClusterGrid::sliceCount() const
+{
+    return m_sliceCount;
+}
+
+int LightClusterGrid::clusterCount() const
+{
+    return m_tileCountX * m_tileCountY * m_sliceCount;
+}
+
+/*!
+ * Sets the perspective projection of the camera, \a fieldOfView being the
+ * vertical field of view in degrees.
+ */
+void LightClusterGrid::setProjection(float fieldOfView, float aspectRatio, float nearPlane, float farPlane)
+{
+    m_fieldOfView = fieldOfView;
+    m_aspectRatio = aspectRatio;
+    m_nearPlane = std::max(nearPlane, 1e-4f);
+    m_farPlane = std::max(farPlane, m_nearPlane * 1.001f);
+    m_boundsDirty = true;
+}
+
+void LightClusterGrid::clearLights()
+{
+    m_lights.clear();
+}
+
+/*!
+ * Adds a light at \a viewPosition, in view space, affecting everything within
+ * \a range. Lights with a range of 0 or less have no range limit.
+ */
+void LightClusterGrid::addLight(const QVector3D &viewPosition, float range)
+{
+    const float radius = range > 0.0f ? range : std::numeric_limits<float>::infinity();
+    m_lights.append(viewPosition.x(), viewPosition.y(), viewPosition.z(), radius, quint32(m_lights.size()));
+}
+
+int LightClusterGrid::lightCount() const
+{
+    return int(m_lights.size());
+}
+
+void LightClusterGrid::assign()
+{
+    if (m_boundsDirty)
+        updateClusterBounds();
+
+    m_clusterOffsets.assign(size_t(clusterCount() + 1), 0);
+    m_lightIndices.clear();
+
+    for (int slice = 0; slice < m_sliceCount; ++slice) {
+        // All clusters of a slice share the same depth range
+        const size_t firstSliceCluster = size_t(clusterIndex(0, 0, slice));
+        const float sliceMinZ = m_clusterMinZ[firstSliceCluster];
+        const float sliceMaxZ = m_clusterMaxZ[firstSliceCluster];
+
+        m_sliceCandidates.clear();
+        for (size_t i = 0, m = m_lights.size(); i < m; ++i) {
+            const float dz = std::max(0.0f, std::max(sliceMinZ - m_lights.z[i], m_lights.z[i] - sliceMaxZ));
+            if (dz * dz <= m_lights.radius[i] * m_lights.radius[i])
+                m_sliceCandidates.append(m_lights.x[i], m_lights.y[i], m_lights.z[i], m_lights.radius[i], m_lights.index[i]);
+        }
+
+        for (int tileY = 0; tileY < m_tileCountY; ++tileY) {
+            const size_t firstRowCluster = size_t(clusterIndex(0, tileY, slice));
+            const size_t lastRowCluster = firstRowCluster + size_t(m_tileCountX) - 1;
+
+            // Bounds of the whole row
+            float rowMinX = m_clusterMinX[firstRowCluster];
+            float rowMaxX = m_clusterMaxX[firstRowCluster];
+            for (size_t cluster = firstRowCluster + 1; cluster <= lastRowCluster; ++cluster) {
+                rowMinX = std::min(rowMinX, m_clusterMinX[cluster]);
+                rowMaxX = std::max(rowMaxX, m_clusterMaxX[cluster]);
+            }
+            const float rowMinY = m_clusterMinY[firstRowCluster];
+            const float rowMaxY = m_clusterMaxY[firstRowCluster];
+
+            m_rowCandidates.clear();
+            for (size_t i = 0, m = m_sliceCandidates.size(); i < m; ++i) {
+                const float distanceSquared = sphereBoxDistanceSquared(m_sliceCandidates.x[i], m_sliceCandidates.y[i], m_sliceCandidates.z[i],
+                                                                       rowMinX, rowMinY, sliceMinZ,
+                                                                       rowMaxX, rowMaxY, sliceMaxZ);
+                if (distanceSquared <= m_sliceCandidates.radius[i] * m_sliceCandidates.radius[i])
+                    m_rowCandidates.append(m_sliceCandidates.x[i], m_sliceCandidates.y[i], m_sliceCandidates.z[i],
+                                           m_sliceCandidates.radius[i], m_sliceCandidates.index[i]);
+            }
+
+            const size_t candidateCount = m_rowCandidates.size();
+            m_hits.resize(candidateCount);
+            const float *x = m_rowCandidates.x.data();
+            const float *y = m_rowCandidates.y.data();
+            const float *z = m_rowCandidates.z.data();
+            const float *radius = m_rowCandidates.radius.data();
+            quint8 *hits = m_hits.data();
+
+            for (size_t cluster = firstRowCluster; cluster <= lastRowCluster; ++cluster) {
+                const float minX = m_clusterMinX[cluster];
+                const float minY = m_clusterMinY[cluster];
+                const float minZ = m_clusterMinZ[cluster];
+                const float maxX = m_clusterMaxX[cluster];
+                const float maxY = m_clusterMaxY[cluster];
+                const float maxZ = m_clusterMaxZ[cluster];
+
+                // Branch free so that it gets vectorized
+                for (size_t i = 0; i < candidateCount; ++i)
+                    hits[i] = sphereBoxDistanceSquared(x[i], y[i], z[i], minX, minY, minZ, maxX, maxY, maxZ) <= radius[i] * radius[i];
+
+                for (size_t i = 0; i < candidateCount; ++i) {
+                    if (hits[i])
+                        m_lightIndices.push_back(m_rowCandidates.index[i]);
+                }
+                m_clusterOffsets[cluster + 1] = quint32(m_lightIndices.size());
+            }
+        }
+    }
+}
+
+void LightClusterGrid::assignBruteForce()
+{
+    if (m_boundsDirty)
+        updateClusterBounds();
+
+    m_clusterOffsets.assign(size_t(clusterCount() + 1), 0);
+    m_lightIndices.clear();
+
+    for (size_t cluster = 0, n = size_t(clusterCount()); cluster < n; ++cluster) {
+        for (size_t i = 0, m = m_lights.size(); i < m; ++i) {
+            const float distanceSquared = sphereBoxDistanceSquared(m_lights.x[i], m_lights.y[i], m_lights.z[i],
+                                                                   m_clusterMinX[cluster], m_clusterMinY[cluster], m_clusterMinZ[cluster],
+                                                                   m_clusterMaxX[cluster], m_clusterMaxY[cluster], m_clusterMaxZ[cluster]);
+            if (distanceSquared <= m_lights.radius[i] * m_lights.radius[i])
+                m_lightIndices.push_back(m_lights.index[i]);
+        }
+        m_clusterOffsets[cluster + 1] = quint32(m_lightIndices.size());
+    }
+}
+
+int LightClusterGrid::clusterIndex(int tileX, int tileY, int slice) const
+{
+    return tileX + m_tileCountX * (tileY + m_tileCountY * slice);
+}
+
+/*!
+ * Returns the slice containing points at \a depth, the distance along the
+ * view direction, or -1 if it is outside of the near and far planes.
+ */
+int LightClusterGrid::sliceForDepth(float depth) const
+{
+    if (depth < m_nearPlane || depth >= m_farPlane)
+        return -1;
+    const int slice = int(std::floor(std::log(depth / m_nearPlane) / std::log(m_farPlane / m_nearPlane) * float(m_sliceCount)));
+    return qBound(0, slice, m_sliceCount - 1);
+}
+
+LightClusterGrid::ClusterBounds LightClusterGrid::clusterBounds(int cluster) const
+{
+    if (m_boundsDirty)
+        const_cast<LightClusterGrid *>(this)->updateClusterBounds();
+
+    const size_t i = size_t(cluster);
+    return { QVector3D(m_clusterMinX[i], m_clusterMinY[i], m_clusterMinZ[i]),
+             QVector3D(m_clusterMaxX[i], m_clusterMaxY[i], m_clusterMaxZ[i]) };
+}
+
+const std::vector<quint32> &LightClusterGrid::clusterOffsets() const
+{
+    return m_clusterOffsets;
+}
+
+const std::vector<quint32> &LightClusterGrid::lightIndices() const
+{
+    return m_lightIndices;
+}
+
+void LightClusterGrid::updateClusterBounds()
+{
+    const size_t count = size_t(clusterCount());
+    for (auto *bounds : { &m_clusterMinX, &m_clusterMinY, &m_clusterMinZ, &m_clusterMaxX, &m_clusterMaxY, &m_clusterMaxZ })
+        bounds->resize(count);
+
+    const float tanHalfFov = std::tan(qDegreesToRadians(m_fieldOfView * 0.5f));
+    const float scaleX = tanHalfFov * m_aspectRatio;
+    const float scaleY = tanHalfFov;
+    const float depthRatio = m_farPlane / m_nearPlane;
+
+    for (int slice = 0; slice < m_sliceCount; ++slice) {
+        const float nearDepth = m_nearPlane * std::pow(depthRatio, float(slice) / float(m_sliceCount));
+        const float farDepth = slice == m_sliceCount - 1
+                ? m_farPlane
+                : m_nearPlane * std::pow(depthRatio, float(slice + 1) / float(m_sliceCount));
+
+        for (int tileY = 0; tileY < m_tileCountY; ++tileY) {
+            const float ndcMinY = -1.0f + 2.0f * float(tileY) / float(m_tileCountY);
+            const float ndcMaxY = -1.0f + 2.0f * float(tileY + 1) / float(m_tileCountY);
+
+            for (int tileX = 0; tileX < m_tileCountX; ++tileX) {
+                const float ndcMinX = -1.0f + 2.0f * float(tileX) / float(m_tileCountX);
+                const float ndcMaxX = -1.0f + 2.0f * float(tileX + 1) / float(m_tileCountX);
+
+                // The cluster is a frustum, its bounds are reached on the
+                // near or far plane depending on the side of the view axis
+                const size_t cluster = size_t(clusterIndex(tileX, tileY, slice));
+                m_clusterMinX[cluster] = std::min(ndcMinX * scaleX * nearDepth, ndcMinX * scaleX * farDepth);
+                m_clusterMaxX[cluster] = std::max(ndcMaxX * scaleX * nearDepth, ndcMaxX * scaleX * farDepth);
+                m_clusterMinY[cluster] = std::min(ndcMinY * scaleY * nearDepth, ndcMinY * scaleY * farDepth);
+                m_clusterMaxY[cluster] = std::max(ndcMaxY * scaleY * nearDepth, ndcMaxY * scaleY * farDepth);
+                // Cameras look down -z
+                m_clusterMinZ[cluster] = -farDepth;
+                m_clusterMaxZ[cluster] = -nearDepth;
+            }
+        }
+    }
+
+    m_boundsDirty = false;
+}
+
+void LightClusterGrid::LightArrays::clear()
+{
+    x.clear();
+    y.clear();
+    z.clear();
+    radius.clear();
+    index.clear();
+}
+
+void LightClusterGrid::LightArrays::append(float lightX, float lightY, float lightZ, float lightRadius, quint32 lightIndex)
+{
+    x.push_back(lightX);
+    y.push_back(lightY);
+    z.push_back(lightZ);
+    radius.push_back(lightRadius);
+    index.push_back(lightIndex);
+}
+
+QT_END_NAMESPACE
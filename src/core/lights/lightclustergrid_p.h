@@ -0,0 +1,132 @@
+/*
+    lightclustergrid_p.h
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef KUESA_LIGHTCLUSTERGRID_P_H
+#define KUESA_LIGHTCLUSTERGRID_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Kuesa API.  It exists for the convenience
+// of other Kuesa classes.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <Kuesa/private/kuesa_global_p.h>
+#include <QVector3D>
+#include <vector>
+
+QT_BEGIN_NAMESPACE
+
+namespace Kuesa {
+
+class KUESA_PRIVATE_EXPORT LightClusterGrid
+{
+public:
+    struct ClusterBounds {
+        QVector3D minimum;
+        QVector3D maximum;
+    };
+
+    LightClusterGrid();
+
+    void setDimensions(int tileCountX, int tileCountY, int sliceCount);
+    int tileCountX() const;
+    int tileCountY() const;
+    int sliceCount() const;
+    int clusterCount() const;
+
+    void setProjection(float fieldOfView, float aspectRatio, float nearPlane, float farPlane);
+
+    void clearLights();
+    void addLight(const QVector3D &viewPosition, float range);
+    int lightCount() const;
+
+    void assign();
+    void assignBruteForce();
+
+    int clusterIndex(int tileX, int tileY, int slice) const;
+    int sliceForDepth(float depth) const;
+    ClusterBounds clusterBounds(int cluster) const;
+
+    const std::vector<quint32> &clusterOffsets() const;
+    const std::vector<quint32> &lightIndices() const;
+
+private:
+    void updateClusterBounds();
+
+    int m_tileCountX = 16;
+    int m_tileCountY = 9;
+    int m_sliceCount = 24;
+    float m_fieldOfView = 45.0f;
+    float m_aspectRatio = 16.0f / 9.0f;
+    float m_nearPlane = 0.1f;
+    float m_farPlane = 1000.0f;
+    bool m_boundsDirty = true;
+
+    // Lights in view space, one array per component so that tests over
+    // consecutive lights can be vectorized
+    struct LightArrays {
+        std::vector<float> x;
+        std::vector<float> y;
+        std::vector<float> z;
+        std::vector<float> radius;
+        std::vector<quint32> index;
+
+        void clear();
+        void append(float x, float y, float z, float radius, quint32 index);
+        size_t size() const { return index.size(); }
+    };
+    LightArrays m_lights;
+
+    // Axis aligned view space bounds of each cluster, one array per component
+    std::vector<float> m_clusterMinX;
+    std::vector<float> m_clusterMinY;
+    std::vector<float> m_clusterMinZ;
+    std::vector<float> m_clusterMaxX;
+    std::vector<float> m_clusterMaxY;
+    std::vector<float> m_clusterMaxZ;
+
+    // Light indices of cluster i are lightIndices[offsets[i]] to lightIndices[offsets[i + 1]]
+    std::vector<quint32> m_clusterOffsets;
+    std::vector<quint32> m_lightIndices;
+
+    // Scratch space of assign
+    LightArrays m_sliceCandidates;
+    LightArrays m_rowCandidates;
+    std::vector<quint8> m_hits;
+};
+
+} // namespace Kuesa
+
+QT_END_NAMESPACE
+
+#endif // KUESA_LIGHTCLUSTERGRID_P_H
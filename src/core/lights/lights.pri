@@ -29,6 +29,10 @@ INCLUDEPATH += $$PWD
 SOURCES += \
     $$PWD/shadowmap.cpp \
     $$PWD/shadowmapmanager.cpp \
+    $$PWD/shadowmapatlas.cpp \
+    $$PWD/shadowcascades.cpp \
+    $$PWD/lightclustergrid.cpp \
+    $$PWD/clusteredlights.cpp \
     $$PWD/shadowcastinglight.cpp \
     $$PWD/directionallight.cpp \
     $$PWD/pointlight.cpp \
@@ -37,6 +41,10 @@ SOURCES += \
 HEADERS += \
     $$PWD/shadowmap.h \
     $$PWD/shadowmapmanager_p.h \
+    $$PWD/shadowmapatlas_p.h \
+    $$PWD/shadowcascades_p.h \
+    $$PWD/lightclustergrid_p.h \
+    $$PWD/clusteredlights_p.h \
     $$PWD/shadowcastinglight.h \
     $$PWD/directionallight.h \
     $$PWD/directionallight_p.h \
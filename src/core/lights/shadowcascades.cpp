@@ -0,0 +1,168 @@
+/*
+    shadowcascades.cpp
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "shadowcascades_p.h"
+
+#include <QtMath>
+#include <algorithm>
+#include <cmath>
+
+QT_BEGIN_NAMESPACE
+
+namespace Kuesa {
+
+namespace ShadowCascades {
+
+std::vector<float> splitDistances(float nearPlane, float farPlane, int cascadeCount, float splitLambda)
+{
+    const int count = std::max(cascadeCount, 1);
+    const float lambda = qBound(0.0f, splitLambda, 1.0f);
+    const float near = std::max(nearPlane, 1e-4f);
+    const float far = std::max(farPlane, near);
+
+    std::vector<float> distances(size_t(count + 1));
+    for (int i = 0; i <= count; ++i) {
+        const float ratio = float(i) / float(count);
+        const float logSplit = near * std::pow(far / near, ratio);
+        const float uniformSplit = near + (far - near) * ratio;
+        distances[size_t(i)] = lambda * logSplit + (1.0f - lambda) * uniformSplit;
+    }
+    // Avoid rounding errors on the frustum bounds
+    distances.front() = near;
+    distances.back() = far;
+    return distances;
+}
+
+std::array<QVector3D, 8> frustumSliceCorners(const QMatrix4x4 &cameraViewMatrix,
+                                             float fieldOfView, float aspectRatio,
+                                             float sliceNear, float sliceFar)
+{
+    const QMatrix4x4 cameraWorldMatrix = cameraViewMatrix.inverted();
+    const float tanHalfFov = std::tan(qDegreesToRadians(fieldOfView * 0.5f));
+
+    std::array<QVector3D, 8> corners;
+    const float distances[2] = { sliceNear, sliceFar };
+    for (int plane = 0; plane < 2; ++plane) {
+        const float halfHeight = distances[plane] * tanHalfFov;
+        const float halfWidth = halfHeight * aspectRatio;
+        const QVector3D viewCorners[4] = {
+            { -halfWidth, -halfHeight, -distances[plane] },
+            { halfWidth, -halfHeight, -distances[plane] },
+            { halfWidth, halfHeight, -distances[plane] },
+            { -halfWidth, halfHeight, -distances[plane] },
+        };
+        for (int i = 0; i < 4; ++i)
+            corners[size_t(plane * 4 + i)] = cameraWorldMatrix * viewCorners[i];
+    }
+    return corners;
+}
+
+QMatrix4x4 lightViewMatrix(const QVector3D &sceneCenter, const QVector3D &lightDirection)
+{
+    const QVector3D direction = lightDirection.normalized();
+    // Same up vector as the light camera of non cascaded shadow maps
+    const QVector3D up = std::fabs(QVector3D::dotProduct(direction, QVector3D(0.0f, 1.0f, 0.0f))) > 0.99f
+            ? QVector3D(0.0f, 0.0f, 1.0f)
+            : QVector3D(0.0f, 1.0f, 0.0f);
+    QMatrix4x4 viewMatrix;
+    viewMatrix.lookAt(sceneCenter, sceneCenter + direction, up);
+    return viewMatrix;
+}
+
+Cascades computeCascades(const Parameters &parameters)
+{
+    Cascades result;
+    const float sceneRadius = std::max(parameters.sceneRadius, 1e-4f);
+    const int shadowMapSize = std::max(parameters.shadowMapSize, 1);
+
+    // Base projection covering the scene, as for non cascaded shadow maps
+    result.viewMatrix = lightViewMatrix(parameters.sceneCenter, parameters.lightDirection);
+    result.nearPlane = -sceneRadius + parameters.lightNearPlane;
+    result.farPlane = sceneRadius;
+    result.projectionMatrix.ortho(-sceneRadius, sceneRadius, -sceneRadius, sceneRadius,
+                                  result.nearPlane, result.farPlane);
+
+    // Nothing past the far side of the scene needs to be covered
+    const QVector3D cameraPosition = parameters.cameraViewMatrix.inverted() * QVector3D();
+    const float sceneFarDistance = (cameraPosition - parameters.sceneCenter).length() + sceneRadius;
+    const float farPlane = std::max(std::min(parameters.farPlane, sceneFarDistance), parameters.nearPlane);
+    const std::vector<float> splits = splitDistances(parameters.nearPlane, farPlane,
+                                                     parameters.cascadeCount, parameters.splitLambda);
+
+    result.cascades.resize(splits.size() - 1);
+    for (size_t i = 0; i < result.cascades.size(); ++i) {
+        Cascade &cascade = result.cascades[i];
+        cascade.splitNear = splits[i];
+        cascade.splitFar = splits[i + 1];
+
+        const std::array<QVector3D, 8> corners = frustumSliceCorners(parameters.cameraViewMatrix,
+                                                                     parameters.fieldOfView,
+                                                                     parameters.aspectRatio,
+                                                                     cascade.splitNear, cascade.splitFar);
+        QVector3D center;
+        for (const QVector3D &corner : corners)
+            center += corner;
+        center /= float(corners.size());
+        float radius = 0.0f;
+        for (const QVector3D &corner : corners)
+            radius = std::max(radius, (corner - center).length());
+        // Quantize the radius so that rounding errors don't change the texel size
+        radius = std::ceil(radius * 16.0f) / 16.0f;
+
+        QVector3D lightSpaceCenter = result.viewMatrix * center;
+        if (radius >= sceneRadius) {
+            radius = sceneRadius;
+            lightSpaceCenter = QVector3D();
+        } else {
+            // Only move the cascade by whole texels
+            const float texelSize = 2.0f * radius / float(shadowMapSize);
+            lightSpaceCenter.setX(std::floor(lightSpaceCenter.x() / texelSize) * texelSize);
+            lightSpaceCenter.setY(std::floor(lightSpaceCenter.y() / texelSize) * texelSize);
+        }
+
+        cascade.left = lightSpaceCenter.x() - radius;
+        cascade.right = lightSpaceCenter.x() + radius;
+        cascade.bottom = lightSpaceCenter.y() - radius;
+        cascade.top = lightSpaceCenter.y() + radius;
+        cascade.projectionMatrix.ortho(cascade.left, cascade.right, cascade.bottom, cascade.top,
+                                       result.nearPlane, result.farPlane);
+
+        const float scale = sceneRadius / radius;
+        cascade.scaleOffset = QVector4D(scale, scale,
+                                        (-sceneRadius - cascade.left) / (2.0f * radius),
+                                        (-sceneRadius - cascade.bottom) / (2.0f * radius));
+    }
+
+    return result;
+}
+
+} // namespace ShadowCascades
+
+} // namespace Kuesa
+
+QT_END_NAMESPACE
@@ -0,0 +1,131 @@
+/*
+    shadowcascades_p.h
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef KUESA_SHADOWCASCADES_P_H
+#define KUESA_SHADOWCASCADES_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Kuesa API.  It exists for the convenience
+// of other Kuesa classes.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <Kuesa/private/kuesa_global_p.h>
+#include <QMatrix4x4>
+#include <QVector3D>
+#include <QVector4D>
+#include <array>
+#include <vector>
+
+QT_BEGIN_NAMESPACE
+
+namespace Kuesa {
+
+// CPU side of the cascaded shadow maps of directional lights. All cascades
+// share the orientation and depth range of a base orthographic projection
+// covering the whole scene, so a position projected with the base matrix can
+// be moved into any cascade with a scale and an offset.
+namespace ShadowCascades {
+
+// Size of the cascade arrays of the light uniforms
+const int MaxCascadeCount = 4;
+
+struct Parameters {
+    // View camera
+    QMatrix4x4 cameraViewMatrix;
+    float fieldOfView = 45.0f;
+    float aspectRatio = 1.0f;
+    float nearPlane = 0.1f;
+    float farPlane = 1000.0f;
+
+    int cascadeCount = 4;
+    float splitLambda = 0.75f;
+    int shadowMapSize = 1024;
+
+    // Light and scene
+    QVector3D lightDirection = QVector3D(0.0f, -1.0f, 0.0f);
+    float lightNearPlane = 0.0f;
+    QVector3D sceneCenter;
+    float sceneRadius = 1.0f;
+};
+
+struct Cascade {
+    float splitNear = 0.0f;
+    float splitFar = 0.0f;
+    // Extent of the cascade in light view space
+    float left = 0.0f;
+    float right = 0.0f;
+    float bottom = 0.0f;
+    float top = 0.0f;
+    QMatrix4x4 projectionMatrix;
+    // xy scale and zw offset from base light space coordinates to the
+    // coordinates of the cascade, both in [0, 1]
+    QVector4D scaleOffset;
+};
+
+struct Cascades {
+    QMatrix4x4 viewMatrix;
+    QMatrix4x4 projectionMatrix;
+    float nearPlane = 0.0f;
+    float farPlane = 0.0f;
+    std::vector<Cascade> cascades;
+};
+
+// Distances from the camera of the cascadeCount + 1 split planes between
+// nearPlane and farPlane. splitLambda blends between a uniform (0) and a
+// logarithmic (1) distribution.
+KUESA_PRIVATE_EXPORT std::vector<float> splitDistances(float nearPlane, float farPlane,
+                                                       int cascadeCount, float splitLambda);
+
+// World space corners of the slice of a perspective camera frustum between
+// sliceNear and sliceFar, near corners first
+KUESA_PRIVATE_EXPORT std::array<QVector3D, 8> frustumSliceCorners(const QMatrix4x4 &cameraViewMatrix,
+                                                                  float fieldOfView, float aspectRatio,
+                                                                  float sliceNear, float sliceFar);
+
+// View matrix looking along lightDirection from the center of the scene
+KUESA_PRIVATE_EXPORT QMatrix4x4 lightViewMatrix(const QVector3D &sceneCenter, const QVector3D &lightDirection);
+
+// Splits the camera frustum, clamped to the scene, and fits an orthographic
+// projection around the bounding sphere of each slice. Bounding spheres don't
+// change size when the camera rotates and their centers are snapped to the
+// shadow map texels, which keeps shadow edges from shimmering.
+KUESA_PRIVATE_EXPORT Cascades computeCascades(const Parameters &parameters);
+
+} // namespace ShadowCascades
+
+} // namespace Kuesa
+
+QT_END_NAMESPACE
+
+#endif // KUESA_SHADOWCASCADES_P_H
@@ -28,9 +28,11 @@
 
 #include "shadowcastinglight.h"
 #include "shadowcastinglight_p.h"
+#include <Kuesa/private/shadowcascades_p.h>
 #include <Qt3DRender/private/shaderdata_p.h>
 #include <QMatrix4x4>
 #include <QVector2D>
+#include <QVector4D>
 
 QT_BEGIN_NAMESPACE
 
@@ -133,6 +135,28 @@ namespace Kuesa {
     precision of the shadowMap depth texture, reducing self-shadowing and "shadow-acne"
 */
 
+/*!
+    \qmlproperty float ShadowCastingLight::shadowMapPriority
+    \since Kuesa 1.4
+
+    Holds how important the shadow of this light is compared to the shadows
+    of the other lights. The resolution of the shadow map is scaled by this
+    value, and when the shadow maps of all lights don't fit in the shadow map
+    atlas, the lights with the lowest priority get smaller shadow maps first.
+    Defaults to 1.0.
+*/
+
+/*!
+    \property ShadowCastingLight::shadowMapPriority
+    \since Kuesa 1.4
+
+    Holds how important the shadow of this light is compared to the shadows
+    of the other lights. The resolution of the shadow map is scaled by this
+    value, and when the shadow maps of all lights don't fit in the shadow map
+    atlas, the lights with the lowest priority get smaller shadow maps first.
+    Defaults to 1.0.
+*/
+
 ShadowCastingLightPrivate::ShadowCastingLightPrivate(Qt3DRender::QAbstractLight::Type type)
     : QAbstractLightPrivate(type)
 {
@@ -148,6 +172,13 @@ ShadowCastingLightPrivate::ShadowCastingLightPrivate(Qt3DRender::QAbstractLight:
     m_shaderData->setProperty("nearFarPlanes", QVector2D());
     m_shaderData->setProperty("shadowBias", 0.005f);
     m_shaderData->setProperty("depthArrayIndex", 0);
+    m_shaderData->setProperty("shadowAtlasRect", QVector4D(0.0f, 0.0f, 1.0f, 1.0f));
+    QVariantList noCascades;
+    for (int i = 0; i < ShadowCascades::MaxCascadeCount; ++i)
+        noCascades.push_back(QVector4D());
+    m_shaderData->setProperty("cascadeCount", 0);
+    m_shaderData->setProperty("cascadeScaleOffsets", noCascades);
+    m_shaderData->setProperty("cascadeAtlasRects", noCascades);
     m_shaderData->setProperty("usePCF", true);
 
     if (type == QAbstractLight::Type::SpotLight)
@@ -243,6 +274,37 @@ void ShadowCastingLight::setLightIndex(int index)
     d->m_shaderData->setProperty("depthArrayIndex", index);
 }
 
+void ShadowCastingLight::setShadowMapAtlasRect(const QVector4D &rect)
+{
+    Q_D(const ShadowCastingLight);
+    d->m_shaderData->setProperty("shadowAtlasRect", rect);
+}
+
+void ShadowCastingLight::setShadowMapCascades(const QVariantList &scaleOffsets, const QVariantList &atlasRects)
+{
+    Q_D(const ShadowCastingLight);
+    Q_ASSERT(scaleOffsets.size() == atlasRects.size());
+
+    // Always upload full arrays, unused cascades are left empty
+    auto padded = [](QVariantList values) {
+        while (values.size() < ShadowCascades::MaxCascadeCount)
+            values.push_back(QVector4D());
+        return values;
+    };
+    d->m_shaderData->setProperty("cascadeCount", int(scaleOffsets.size()));
+    d->m_shaderData->setProperty("cascadeScaleOffsets", padded(scaleOffsets));
+    d->m_shaderData->setProperty("cascadeAtlasRects", padded(atlasRects));
+}
+
+void ShadowCastingLight::setShadowMapPriority(float shadowMapPriority)
+{
+    if (qFuzzyCompare(m_shadowMapPriority, shadowMapPriority))
+        return;
+
+    m_shadowMapPriority = shadowMapPriority;
+    emit shadowMapPriorityChanged(m_shadowMapPriority);
+}
+
 void ShadowCastingLight::setNearPlane(float nearPlane)
 {
     if (qFuzzyCompare(m_nearPlane, nearPlane))
@@ -263,6 +325,11 @@ float ShadowCastingLight::nearPlane() const
     return m_nearPlane;
 }
 
+float ShadowCastingLight::shadowMapPriority() const
+{
+    return m_shadowMapPriority;
+}
+
 } // namespace Kuesa
 
 QT_END_NAMESPACE
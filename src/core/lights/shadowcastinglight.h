@@ -31,6 +31,7 @@
 
 #include <QAbstractLight>
 #include <QSize>
+#include <QVector4D>
 #include <Kuesa/kuesa_global.h>
 
 QT_BEGIN_NAMESPACE
@@ -50,6 +51,7 @@ class KUESASHARED_EXPORT ShadowCastingLight : public Qt3DRender::QAbstractLight
     Q_PROPERTY(QSize textureSize READ textureSize WRITE setTextureSize NOTIFY textureSizeChanged)
     Q_PROPERTY(float shadowMapBias READ shadowMapBias WRITE setShadowMapBias NOTIFY biasChanged)
     Q_PROPERTY(float nearPlane READ nearPlane WRITE setNearPlane NOTIFY nearPlaneChanged)
+    Q_PROPERTY(float shadowMapPriority READ shadowMapPriority WRITE setShadowMapPriority NOTIFY shadowMapPriorityChanged)
 
 public:
     ~ShadowCastingLight();
@@ -62,6 +64,8 @@ public:
 
     bool softShadows() const;
 
+    float shadowMapPriority() const;
+
 public Q_SLOTS:
     void setCastsShadows(bool castsShadows);
     void setLightViewProjectionMatrix(const QMatrix4x4 &matrix);
@@ -71,6 +75,14 @@ public Q_SLOTS:
 
     void setSoftShadows(bool softShadows);
     void setLightIndex(int index);
+    void setShadowMapPriority(float shadowMapPriority);
+
+    // normalized rectangle of the shadow map in the depth texture
+    void setShadowMapAtlasRect(const QVector4D &rect);
+
+    // used for cascaded directional lights. Holds the scale and offset from
+    // light space to each cascade and the normalized rectangle of each cascade
+    void setShadowMapCascades(const QVariantList &scaleOffsets, const QVariantList &atlasRects);
 
     // used for point lights. Holds actual camera clip planes
     void setNearFarPlanes(float near, float far);
@@ -83,6 +95,7 @@ Q_SIGNALS:
     void nearPlaneChanged(float nearPlane);
 
     void softShadowsChanged(bool softShadows);
+    void shadowMapPriorityChanged(float shadowMapPriority);
 
 protected:
     explicit ShadowCastingLight(ShadowCastingLightPrivate &dd, Qt3DCore::QNode *parent = nullptr);
@@ -92,6 +105,7 @@ private:
 
     QSize m_textureSize;
     float m_nearPlane = 0.0f;
+    float m_shadowMapPriority = 1.0f;
 };
 
 } // namespace Kuesa
@@ -33,6 +33,8 @@
 #include <QCamera>
 #include <QTransform>
 #include <Kuesa/private/kuesa_utils_p.h>
+#include <Kuesa/private/shadowcascades_p.h>
+#include <algorithm>
 #include <cmath>
 
 QT_BEGIN_NAMESPACE
@@ -58,6 +60,8 @@ ShadowMap::ShadowMap(ShadowCastingLight *light, Qt3DRender::QAbstractTexture *de
     : QObject(parent)
     , m_light(light)
     , m_depthTexture(depthTexture)
+    , m_atlasTiles(1)
+    , m_viewportRects(1, QRectF(0.0f, 0.0f, 1.0f, 1.0f))
 {
     //parent light camera to light so it doesn't get deleted when being reparented to CameraSelector
     m_lightCamera = new QCamera;
@@ -68,6 +72,8 @@ ShadowMap::ShadowMap(ShadowCastingLight *light, Qt3DRender::QAbstractTexture *de
         auto directionalLight = qobject_cast<DirectionalLight *>(m_light);
         connect(directionalLight, &DirectionalLight::directionChanged, this, &ShadowMap::updateLightCamera);
         connect(directionalLight, &DirectionalLight::directionModeChanged, this, &ShadowMap::updateLightCamera);
+        connect(directionalLight, &DirectionalLight::cascadeCountChanged, this, &ShadowMap::updateCascadeSetup);
+        connect(directionalLight, &DirectionalLight::cascadeSplitLambdaChanged, this, &ShadowMap::updateLightCamera);
         break;
     }
     case QAbstractLight::SpotLight: {
@@ -112,6 +118,7 @@ ShadowMap::~ShadowMap()
     delete m_lightCamera;
     for (auto &cam : m_cubeMapLightCameras)
         delete cam;
+    qDeleteAll(m_cascadeCameras);
 }
 
 ShadowCastingLight *ShadowMap::light() const
@@ -148,8 +155,7 @@ void ShadowMap::updateLightCamera()
 
     auto updateCameraUpVector = [this](const QVector3D &cameraDirection) {
         const auto dp = QVector3D::dotProduct(cameraDirection.normalized(), QVector3D{ 0, 1, 0 });
-        if (std::fabs(dp) > .99f)
-            m_lightCamera->setUpVector({ 0, 0, 1 });
+        m_lightCamera->setUpVector(std::fabs(dp) > .99f ? QVector3D{ 0, 0, 1 } : QVector3D{ 0, 1, 0 });
     };
 
     const auto calcNearPlane = [this](float farPlane) { return m_light->nearPlane() > 0.0f ? m_light->nearPlane() : farPlane / 500.0f; };
@@ -174,6 +180,8 @@ void ShadowMap::updateLightCamera()
         m_lightCamera->setNearPlane(-m_sceneRadius + m_light->nearPlane());
         m_lightCamera->setFarPlane(m_sceneRadius);
         updateCameraUpVector(worldDir);
+        if (!m_cascadeCameras.isEmpty())
+            updateCascades();
         break;
     }
     case QAbstractLight::SpotLight: {
@@ -255,6 +263,201 @@ int ShadowMap::depthTextureLayer() const
     return m_depthTextureLayer;
 }
 
+/*!
+ * Sets the camera of the view the cascades of directional lights are fitted
+ * to. Without a perspective view camera, directional lights use a single
+ * shadow map covering the whole scene.
+ */
+void ShadowMap::setViewCamera(QCamera *viewCamera)
+{
+    if (m_viewCamera == viewCamera)
+        return;
+
+    if (m_viewCamera)
+        disconnect(m_viewCamera, nullptr, this, nullptr);
+
+    m_viewCamera = viewCamera;
+
+    if (m_viewCamera && m_light->type() == QAbstractLight::DirectionalLight) {
+        auto updateVisibleCascades = [this] {
+            if (!m_cascadeCameras.isEmpty())
+                updateLightCamera();
+        };
+        connect(m_viewCamera, &QCamera::viewMatrixChanged, this, updateVisibleCascades);
+        connect(m_viewCamera, &QCamera::projectionMatrixChanged, this, updateVisibleCascades);
+        connect(m_viewCamera, &QCamera::projectionTypeChanged, this, &ShadowMap::updateCascadeSetup);
+        connect(m_viewCamera, &QObject::destroyed, this, [this] { setViewCamera(nullptr); });
+    }
+
+    updateCascadeSetup();
+}
+
+QCamera *ShadowMap::viewCamera() const
+{
+    return m_viewCamera;
+}
+
+int ShadowMap::cascadeCount() const
+{
+    return m_cascadeCameras.isEmpty() ? 1 : m_cascadeCameras.size();
+}
+
+/*!
+ * Returns the camera to render the \a cascade of the shadow map with. Shadow
+ * maps without cascades only have the light camera.
+ */
+QCamera *ShadowMap::cascadeCamera(int cascade) const
+{
+    if (m_cascadeCameras.isEmpty())
+        return m_lightCamera;
+    return m_cascadeCameras.value(cascade, nullptr);
+}
+
+/*!
+ * Sets the \a tile, in texels, of the depth texture of size \a atlasSize
+ * into which the \a cascade of the shadow map is rendered. A null \a tile
+ * means the shadow map couldn't fit in the atlas and isn't rendered.
+ */
+void ShadowMap::setAtlasTile(const QRect &tile, const QSize &atlasSize, int cascade)
+{
+    if (cascade < 0 || cascade >= m_atlasTiles.size())
+        return;
+
+    QRectF viewportRect;
+    if (!tile.isNull() && !atlasSize.isEmpty()) {
+        const float width = float(atlasSize.width());
+        const float height = float(atlasSize.height());
+        viewportRect = QRectF(tile.x() / width, tile.y() / height,
+                              tile.width() / width, tile.height() / height);
+    }
+
+    // The same tile in a grown or shrunk atlas still moves the viewport, so
+    // only skip the update when the normalized viewport is unchanged as well
+    if (tile == m_atlasTiles[cascade] && viewportRect == m_viewportRects[cascade] && !tile.isNull())
+        return;
+
+    const bool tileSizeChanged = tile.size() != m_atlasTiles[cascade].size();
+    m_atlasTiles[cascade] = tile;
+
+    const bool viewportChanged = viewportRect != m_viewportRects[cascade];
+    m_viewportRects[cascade] = viewportRect;
+
+    // Cascades are snapped to the texels of their tiles
+    if (!m_cascadeCameras.isEmpty() && tileSizeChanged)
+        updateLightCamera();
+    else
+        updateAtlasUniforms();
+
+    if (viewportChanged)
+        emit viewportRectChanged();
+}
+
+QRect ShadowMap::atlasTile(int cascade) const
+{
+    return m_atlasTiles.value(cascade);
+}
+
+/*!
+ * Returns the normalized viewport to render the \a cascade of the shadow map
+ * into. Shadow maps which are not part of an atlas cover the whole depth
+ * texture.
+ */
+QRectF ShadowMap::viewportRect(int cascade) const
+{
+    return m_viewportRects.value(cascade);
+}
+
+void ShadowMap::updateCascadeSetup()
+{
+    int cascadeCount = 1;
+    auto directionalLight = qobject_cast<DirectionalLight *>(m_light);
+    if (directionalLight && m_viewCamera && m_viewCamera->projectionType() == QCameraLens::PerspectiveProjection)
+        cascadeCount = directionalLight->cascadeCount();
+
+    if (cascadeCount != this->cascadeCount()) {
+        qDeleteAll(m_cascadeCameras);
+        m_cascadeCameras.clear();
+        m_cascadeScaleOffsets.clear();
+        if (cascadeCount > 1) {
+            for (int i = 0; i < cascadeCount; ++i) {
+                auto camera = new QCamera;
+                camera->setProjectionType(QCameraLens::OrthographicProjection);
+                m_cascadeCameras.push_back(camera);
+            }
+            m_cascadeScaleOffsets.resize(cascadeCount);
+        }
+        m_atlasTiles = QVector<QRect>(cascadeCount);
+        m_viewportRects = QVector<QRectF>(cascadeCount, QRectF(0.0f, 0.0f, 1.0f, 1.0f));
+        updateLightCamera();
+        emit cascadeCountChanged(cascadeCount);
+    }
+}
+
+void ShadowMap::updateCascades()
+{
+    auto directionalLight = qobject_cast<DirectionalLight *>(m_light);
+    Q_ASSERT(directionalLight && m_viewCamera);
+
+    // Snapping to the texels of the smallest tile keeps the larger ones stable too
+    int shadowMapSize = std::max(m_light->textureSize().width(), m_light->textureSize().height());
+    for (const QRect &tile : qAsConst(m_atlasTiles)) {
+        if (!tile.isNull())
+            shadowMapSize = std::min(shadowMapSize, tile.width());
+    }
+
+    ShadowCascades::Parameters parameters;
+    parameters.cameraViewMatrix = m_viewCamera->viewMatrix();
+    parameters.fieldOfView = m_viewCamera->fieldOfView();
+    parameters.aspectRatio = m_viewCamera->aspectRatio();
+    parameters.nearPlane = m_viewCamera->nearPlane();
+    parameters.farPlane = m_viewCamera->farPlane();
+    parameters.cascadeCount = m_cascadeCameras.size();
+    parameters.splitLambda = directionalLight->cascadeSplitLambda();
+    parameters.shadowMapSize = shadowMapSize;
+    parameters.lightDirection = m_lightCamera->viewCenter() - m_lightCamera->position();
+    parameters.lightNearPlane = m_light->nearPlane();
+    parameters.sceneCenter = m_sceneCenter;
+    parameters.sceneRadius = m_sceneRadius;
+
+    const ShadowCascades::Cascades cascades = ShadowCascades::computeCascades(parameters);
+    for (int i = 0; i < m_cascadeCameras.size(); ++i) {
+        const ShadowCascades::Cascade &cascade = cascades.cascades[size_t(i)];
+        auto camera = m_cascadeCameras[i];
+        camera->setPosition(m_lightCamera->position());
+        camera->setViewCenter(m_lightCamera->viewCenter());
+        camera->setUpVector(m_lightCamera->upVector());
+        camera->setNearPlane(cascades.nearPlane);
+        camera->setFarPlane(cascades.farPlane);
+        camera->setLeft(cascade.left);
+        camera->setRight(cascade.right);
+        camera->setBottom(cascade.bottom);
+        camera->setTop(cascade.top);
+        m_cascadeScaleOffsets[i] = cascade.scaleOffset;
+    }
+    updateAtlasUniforms();
+}
+
+void ShadowMap::updateAtlasUniforms()
+{
+    // Viewports have their origin at the top left while texture coordinates
+    // have it at the bottom left
+    auto textureRect = [](const QRectF &viewportRect) {
+        return QVector4D(float(viewportRect.x()),
+                         float(1.0 - viewportRect.y() - viewportRect.height()),
+                         float(viewportRect.width()),
+                         float(viewportRect.height()));
+    };
+
+    QVariantList scaleOffsets;
+    QVariantList atlasRects;
+    for (int i = 0; i < m_cascadeScaleOffsets.size(); ++i) {
+        scaleOffsets.push_back(m_cascadeScaleOffsets[i]);
+        atlasRects.push_back(textureRect(m_viewportRects[i]));
+    }
+    m_light->setShadowMapCascades(scaleOffsets, atlasRects);
+    m_light->setShadowMapAtlasRect(textureRect(m_viewportRects.first()));
+}
+
 void ShadowMap::updateLightTransform(const QMatrix4x4 &worldMatrix)
 {
     if (m_worldMatrix == worldMatrix)
@@ -34,6 +34,8 @@
 #include <Qt3DRender/qtexture.h>
 #include <QVector3D>
 #include <QMatrix4x4>
+#include <QRect>
+#include <QVector>
 
 QT_BEGIN_NAMESPACE
 
@@ -70,13 +72,28 @@ public:
     void setDepthTextureLayer(int layer);
     int depthTextureLayer() const;
 
+    void setViewCamera(Qt3DRender::QCamera *viewCamera);
+    Qt3DRender::QCamera *viewCamera() const;
+
+    int cascadeCount() const;
+    Qt3DRender::QCamera *cascadeCamera(int cascade) const;
+
+    void setAtlasTile(const QRect &tile, const QSize &atlasSize, int cascade = 0);
+    QRect atlasTile(int cascade = 0) const;
+    QRectF viewportRect(int cascade = 0) const;
+
 Q_SIGNALS:
     void lightViewProjectionChanged();
+    void viewportRectChanged();
+    void cascadeCountChanged(int cascadeCount);
 
 private:
     void updateLightCamera();
     void updateLightTransform(const QMatrix4x4 &worldMatrix);
     void updateLightMatrixUniforms();
+    void updateCascadeSetup();
+    void updateCascades();
+    void updateAtlasUniforms();
 
     ShadowCastingLight *m_light = nullptr;
     Qt3DRender::QCamera *m_lightCamera = nullptr;
@@ -87,6 +104,11 @@ private:
     QHash<int, Qt3DRender::QCamera *> m_cubeMapLightCameras;
     Qt3DRender::QAbstractTexture *m_depthTexture = nullptr;
     int m_depthTextureLayer = -1;
+    Qt3DRender::QCamera *m_viewCamera = nullptr;
+    QVector<Qt3DRender::QCamera *> m_cascadeCameras;
+    QVector<QVector4D> m_cascadeScaleOffsets;
+    QVector<QRect> m_atlasTiles;
+    QVector<QRectF> m_viewportRects;
 };
 
 using ShadowMapPtr = QSharedPointer<ShadowMap>;
@@ -0,0 +1,380 @@
+/*
+    shadowmapatlas.cpp
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "shadowmapatlas_p.h"
+
+#include <QtMath>
+#include <algorithm>
+#include <cmath>
+
+QT_BEGIN_NAMESPACE
+
+using namespace Kuesa;
+
+namespace {
+
+int roundUpToPowerOfTwo(int value)
+{
+    int powerOfTwo = 1;
+    while (powerOfTwo < value)
+        powerOfTwo *= 2;
+    return powerOfTwo;
+}
+
+} // namespace
+
+/*!
+ * \internal
+ * \class Kuesa::ShadowMapAtlas
+ * \brief Packs shadow maps of various resolutions into a single depth texture
+ * \inmodule Kuesa
+ * \since Kuesa 1.4
+ *
+ * The atlas is a quadtree of square tiles whose sizes are powers of two
+ * between minTileSize and atlasSize. Each tile is requested by an id, with
+ * a size and a priority.
+ *
+ * Updating the atlas keeps the tiles whose size hasn't changed where they
+ * are and only places the new or resized tiles in the free space. The whole
+ * atlas is only repacked when a tile doesn't fit anymore. Tiles sorted by
+ * decreasing size always pack without holes, so a repack succeeds as long as
+ * the total area fits. When it doesn't, the tiles with the lowest priority
+ * are downgraded first.
+ */
+
+ShadowMapAtlas::ShadowMapAtlas(int atlasSize, int minTileSize)
+    : m_atlasSize(roundUpToPowerOfTwo(std::max(atlasSize, 1)))
+    , m_minTileSize(std::min(roundUpToPowerOfTwo(std::max(minTileSize, 1)), m_atlasSize))
+{
+    clear();
+}
+
+/*!
+ * Sets the size of the atlas to \a atlasSize, rounded up to a power of two.
+ * All tiles are dropped and will be placed on the next update.
+ */
+void ShadowMapAtlas::setAtlasSize(int atlasSize)
+{
+    m_atlasSize = roundUpToPowerOfTwo(std::max(atlasSize, 1));
+    m_minTileSize = std::min(m_minTileSize, m_atlasSize);
+    clear();
+}
+
+int ShadowMapAtlas::atlasSize() const
+{
+    return m_atlasSize;
+}
+
+int ShadowMapAtlas::minTileSize() const
+{
+    return m_minTileSize;
+}
+
+/*!
+ * Assigns a tile to each of the \a requests. Tiles which are not requested
+ * anymore are released. Returns the number of tiles which were placed or
+ * moved and need to be rendered again.
+ */
+int ShadowMapAtlas::update(const std::vector<Request> &requests)
+{
+    auto findRequest = [&requests](quintptr id) {
+        return std::find_if(requests.begin(), requests.end(),
+                            [id](const Request &request) { return request.id == id; });
+    };
+    auto findTile = [this](quintptr id) {
+        return std::find_if(m_tiles.begin(), m_tiles.end(),
+                            [id](const Tile &tile) { return tile.id == id; });
+    };
+
+    // Release the tiles which are no longer requested
+    for (auto it = m_tiles.begin(); it != m_tiles.end();) {
+        if (findRequest(it->id) == requests.end()) {
+            release(it->rect);
+            it = m_tiles.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    int movedTileCount = 0;
+    std::vector<Request> pendingRequests;
+    for (const Request &request : requests) {
+        const int size = normalizedSize(request.size);
+        auto tile = findTile(request.id);
+        if (tile != m_tiles.end() && tile->requestedSize == size) {
+            // Give back as much of their size as possible to downgraded tiles
+            for (int upgradedSize = size; upgradedSize > tile->rect.width(); upgradedSize /= 2) {
+                QRect rect;
+                if (allocate(upgradedSize, rect)) {
+                    release(tile->rect);
+                    tile->rect = rect;
+                    ++movedTileCount;
+                    break;
+                }
+            }
+            continue;
+        }
+
+        if (tile != m_tiles.end()) {
+            release(tile->rect);
+            m_tiles.erase(tile);
+        }
+        pendingRequests.push_back({ request.id, size, request.priority });
+    }
+
+    std::stable_sort(pendingRequests.begin(), pendingRequests.end(),
+                     [](const Request &a, const Request &b) {
+                         return a.size > b.size || (a.size == b.size && a.priority > b.priority);
+                     });
+
+    for (const Request &request : pendingRequests) {
+        QRect rect;
+        if (!allocate(request.size, rect)) {
+            repack(requests);
+            return int(m_tiles.size());
+        }
+        m_tiles.push_back({ request.id, rect, request.size });
+        ++movedTileCount;
+    }
+
+    return movedTileCount;
+}
+
+/*!
+ * Returns the tile, in texels, allocated to \a id or a null rectangle if it
+ * couldn't be allocated.
+ */
+QRect ShadowMapAtlas::tile(quintptr id) const
+{
+    const auto it = std::find_if(m_tiles.begin(), m_tiles.end(),
+                                 [id](const Tile &tile) { return tile.id == id; });
+    return it != m_tiles.end() ? it->rect : QRect();
+}
+
+size_t ShadowMapAtlas::tileCount() const
+{
+    return m_tiles.size();
+}
+
+qint64 ShadowMapAtlas::allocatedArea() const
+{
+    qint64 area = 0;
+    for (const Tile &tile : m_tiles)
+        area += qint64(tile.rect.width()) * qint64(tile.rect.height());
+    return area;
+}
+
+/*!
+ * Returns the size of the shadow map of a light covering \a coverage, from
+ * 0 to 1, of the screen. The size is scaled by \a priority, rounded up to a
+ * power of two and clamped between \a minSize and \a maxSize.
+ */
+int ShadowMapAtlas::selectResolution(float coverage, float priority, int maxSize, int minSize)
+{
+    const int maxResolution = roundUpToPowerOfTwo(std::max(maxSize, minSize));
+    const int minResolution = roundUpToPowerOfTwo(std::max(minSize, 1));
+    const float scale = std::sqrt(qBound(0.0f, coverage, 1.0f)) * std::max(priority, 0.0f);
+    const int resolution = roundUpToPowerOfTwo(int(std::ceil(float(maxResolution) * scale)));
+    return qBound(minResolution, resolution, maxResolution);
+}
+
+/*!
+ * Returns the fraction of a scene of radius \a sceneRadius lit by a cone of
+ * half angle \a halfAngle degrees whose base is at \a distance from its
+ * apex.
+ */
+float ShadowMapAtlas::coneCoverage(float halfAngle, float distance, float sceneRadius)
+{
+    if (sceneRadius <= 0.0f)
+        return 1.0f;
+    const float baseRadius = distance * std::tan(qDegreesToRadians(qBound(0.0f, halfAngle, 89.0f)));
+    return qBound(0.0f, (baseRadius * baseRadius) / (sceneRadius * sceneRadius), 1.0f);
+}
+
+/*!
+ * Returns the smallest atlas size, between \a minAtlasSize and
+ * \a maxAtlasSize, able to hold all \a requests at their full size.
+ */
+int ShadowMapAtlas::atlasSizeForRequests(const std::vector<Request> &requests, int minAtlasSize, int maxAtlasSize)
+{
+    const int maxSize = roundUpToPowerOfTwo(std::max(maxAtlasSize, 1));
+    int size = std::min(roundUpToPowerOfTwo(std::max(minAtlasSize, 1)), maxSize);
+
+    qint64 area = 0;
+    int largestTile = 0;
+    for (const Request &request : requests) {
+        const int tileSize = std::min(roundUpToPowerOfTwo(std::max(request.size, 1)), maxSize);
+        area += qint64(tileSize) * qint64(tileSize);
+        largestTile = std::max(largestTile, tileSize);
+    }
+
+    while (size < maxSize && (qint64(size) * qint64(size) < area || size < largestTile))
+        size *= 2;
+    return size;
+}
+
+int ShadowMapAtlas::normalizedSize(int size) const
+{
+    return qBound(m_minTileSize, roundUpToPowerOfTwo(std::max(size, 1)), m_atlasSize);
+}
+
+int ShadowMapAtlas::levelForSize(int size) const
+{
+    int level = 0;
+    for (int levelSize = m_atlasSize; levelSize > size; levelSize /= 2)
+        ++level;
+    return level;
+}
+
+bool ShadowMapAtlas::allocate(int size, QRect &rect)
+{
+    const int level = levelForSize(size);
+
+    // Find the smallest free block able to hold the tile
+    int blockLevel = level;
+    while (blockLevel >= 0 && m_freeBlocks[size_t(blockLevel)].empty())
+        --blockLevel;
+    if (blockLevel < 0)
+        return false;
+
+    // Favor the top left blocks to keep the free space in one piece
+    auto &freeBlocks = m_freeBlocks[size_t(blockLevel)];
+    const auto blockIt = std::min_element(freeBlocks.begin(), freeBlocks.end(),
+                                          [](const QPoint &a, const QPoint &b) {
+                                              return a.y() < b.y() || (a.y() == b.y() && a.x() < b.x());
+                                          });
+    const QPoint origin = *blockIt;
+    freeBlocks.erase(blockIt);
+
+    // Split the block until it has the requested size
+    for (int blockSize = m_atlasSize >> blockLevel; blockLevel < level; ++blockLevel) {
+        blockSize /= 2;
+        auto &childBlocks = m_freeBlocks[size_t(blockLevel + 1)];
+        childBlocks.push_back(origin + QPoint(blockSize, 0));
+        childBlocks.push_back(origin + QPoint(0, blockSize));
+        childBlocks.push_back(origin + QPoint(blockSize, blockSize));
+    }
+
+    rect = QRect(origin, QSize(size, size));
+    return true;
+}
+
+void ShadowMapAtlas::release(const QRect &rect)
+{
+    int level = levelForSize(rect.width());
+    QPoint origin = rect.topLeft();
+
+    // Merge the block with its siblings while they are all free
+    while (level > 0) {
+        const int parentSize = (m_atlasSize >> level) * 2;
+        const QPoint parentOrigin((origin.x() / parentSize) * parentSize,
+                                  (origin.y() / parentSize) * parentSize);
+        const int blockSize = parentSize / 2;
+        auto &freeBlocks = m_freeBlocks[size_t(level)];
+
+        std::vector<QPoint> siblings;
+        for (const QPoint &offset : { QPoint(0, 0), QPoint(blockSize, 0), QPoint(0, blockSize), QPoint(blockSize, blockSize) }) {
+            const QPoint sibling = parentOrigin + offset;
+            if (sibling != origin)
+                siblings.push_back(sibling);
+        }
+        const bool allSiblingsFree = std::all_of(siblings.begin(), siblings.end(), [&freeBlocks](const QPoint &sibling) {
+            return std::find(freeBlocks.begin(), freeBlocks.end(), sibling) != freeBlocks.end();
+        });
+        if (!allSiblingsFree)
+            break;
+
+        for (const QPoint &sibling : siblings)
+            freeBlocks.erase(std::find(freeBlocks.begin(), freeBlocks.end(), sibling));
+        origin = parentOrigin;
+        --level;
+    }
+
+    m_freeBlocks[size_t(level)].push_back(origin);
+}
+
+void ShadowMapAtlas::clear()
+{
+    m_tiles.clear();
+    m_freeBlocks.assign(size_t(levelForSize(m_minTileSize) + 1), {});
+    m_freeBlocks[0].push_back(QPoint(0, 0));
+}
+
+void ShadowMapAtlas::repack(const std::vector<Request> &requests)
+{
+    clear();
+
+    struct SizedRequest {
+        Request request;
+        int requestedSize;
+    };
+    std::vector<SizedRequest> sizedRequests;
+    sizedRequests.reserve(requests.size());
+    qint64 area = 0;
+    for (const Request &request : requests) {
+        const int size = normalizedSize(request.size);
+        sizedRequests.push_back({ { request.id, size, request.priority }, size });
+        area += qint64(size) * qint64(size);
+    }
+
+    // Downgrade the tiles with the lowest priority, the largest ones first,
+    // until everything fits
+    const qint64 atlasArea = qint64(m_atlasSize) * qint64(m_atlasSize);
+    while (area > atlasArea) {
+        auto downgraded = sizedRequests.end();
+        for (auto it = sizedRequests.begin(); it != sizedRequests.end(); ++it) {
+            if (it->request.size <= m_minTileSize)
+                continue;
+            if (downgraded == sizedRequests.end() ||
+                it->request.priority < downgraded->request.priority ||
+                (it->request.priority == downgraded->request.priority && it->request.size > downgraded->request.size))
+                downgraded = it;
+        }
+        if (downgraded == sizedRequests.end())
+            break;
+        const qint64 size = downgraded->request.size;
+        area -= size * size - (size / 2) * (size / 2);
+        downgraded->request.size /= 2;
+    }
+
+    // Power of two squares sorted by decreasing size pack without holes, if
+    // there still isn't enough room the lowest priority tiles are dropped
+    std::stable_sort(sizedRequests.begin(), sizedRequests.end(),
+                     [](const SizedRequest &a, const SizedRequest &b) {
+                         return a.request.size > b.request.size ||
+                                 (a.request.size == b.request.size && a.request.priority > b.request.priority);
+                     });
+
+    for (const SizedRequest &sizedRequest : sizedRequests) {
+        QRect rect;
+        if (allocate(sizedRequest.request.size, rect))
+            m_tiles.push_back({ sizedRequest.request.id, rect, sizedRequest.requestedSize });
+    }
+}
+
+QT_END_NAMESPACE
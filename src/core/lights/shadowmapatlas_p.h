@@ -0,0 +1,102 @@
+/*
+    shadowmapatlas_p.h
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef KUESA_SHADOWMAPATLAS_P_H
+#define KUESA_SHADOWMAPATLAS_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Kuesa API.  It exists for the convenience
+// of other Kuesa classes.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <Kuesa/private/kuesa_global_p.h>
+#include <QPoint>
+#include <QRect>
+#include <vector>
+
+QT_BEGIN_NAMESPACE
+
+namespace Kuesa {
+
+class KUESA_PRIVATE_EXPORT ShadowMapAtlas
+{
+public:
+    struct Request {
+        quintptr id = 0;
+        int size = 0;
+        float priority = 1.0f;
+    };
+
+    explicit ShadowMapAtlas(int atlasSize = 2048, int minTileSize = 128);
+
+    void setAtlasSize(int atlasSize);
+    int atlasSize() const;
+    int minTileSize() const;
+
+    int update(const std::vector<Request> &requests);
+
+    QRect tile(quintptr id) const;
+    size_t tileCount() const;
+    qint64 allocatedArea() const;
+
+    static int selectResolution(float coverage, float priority, int maxSize, int minSize);
+    static float coneCoverage(float halfAngle, float distance, float sceneRadius);
+    static int atlasSizeForRequests(const std::vector<Request> &requests, int minAtlasSize, int maxAtlasSize);
+
+private:
+    struct Tile {
+        quintptr id = 0;
+        QRect rect;
+        int requestedSize = 0;
+    };
+
+    int normalizedSize(int size) const;
+    int levelForSize(int size) const;
+    bool allocate(int size, QRect &rect);
+    void release(const QRect &rect);
+    void clear();
+    void repack(const std::vector<Request> &requests);
+
+    int m_atlasSize;
+    int m_minTileSize;
+    // Free square blocks per level, level 0 being the whole atlas
+    std::vector<std::vector<QPoint>> m_freeBlocks;
+    std::vector<Tile> m_tiles;
+};
+
+} // namespace Kuesa
+
+QT_END_NAMESPACE
+
+#endif // KUESA_SHADOWMAPATLAS_P_H
@@ -32,12 +32,19 @@
 #include "pointlight.h"
 #include <Kuesa/private/framegraphutils_p.h>
 #include <Kuesa/private/kuesa_utils_p.h>
+#include <Kuesa/private/shadowcascades_p.h>
 #include <Qt3DRender/private/entity_p.h>
 
 #include <QCamera>
 #include <QFrameAction>
 #include <QTexture>
 #include <Qt3DRender/private/sphere_p.h>
+#include <Qt3DRender/QGeometryRenderer>
+#include <Qt3DCore/QTransform>
+#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
+#include <Qt3DRender/QGeometry>
+#endif
+#include <limits>
 
 QT_BEGIN_NAMESPACE
 
@@ -54,17 +61,96 @@ QT_BEGIN_NAMESPACE
  *
  * It's responsible for maintaining the 2 shadowmap depth textures (a cubemap
  * texture for point lights and normal depth texture for directional and spot lights).
- * These are array textures, with one layer per ShadowCastingLight and its
- * corresponding ShadowMap. An array texture requires that all layer be the same size,
- * so this class keeps track of the requested texture size for  all active
- * ShadowCastingLights and updates the array texture to be the size of the
- * largest. The ShadowMapManager also updates each ShadowMap to indicate which array
- * texture index to use.
+ *
+ * The cubemap texture is an array texture, with one layer per point light. An
+ * array texture requires that all layer be the same size, so this class keeps
+ * track of the requested texture size for all point lights and updates the
+ * array texture to be the size of the largest.
+ *
+ * Directional and spot lights share a single depth texture layer which is
+ * used as an atlas, each ShadowMap being rendered into its own tile. The size
+ * of each tile is selected from how much of the scene the light covers, the
+ * light's textureSize and its shadowMapPriority. When the tiles don't fit in
+ * the largest atlas, the lights with the lowest priority get smaller tiles.
+ * Each cascade of a directional light gets its own tile, the farther cascades
+ * being downgraded first.
 */
 
 using namespace Kuesa;
+
+namespace {
+
+const int MinAtlasSize = 512;
+const int MaxAtlasSize = 4096;
+const int MinShadowMapSize = 128;
+
+// Cascade cameras are recreated when the cascade count changes, the tiles
+// are keyed on the shadow map instead so that they survive that. Shadow maps
+// are larger than their cascade count so the ids never overlap.
+static_assert(sizeof(ShadowMap) >= ShadowCascades::MaxCascadeCount, "Tile ids of shadow maps must not overlap");
+
+quintptr atlasTileId(const ShadowMap *shadowMap, int cascade)
+{
+    return quintptr(shadowMap) + quintptr(cascade);
+}
+
+#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
+// The world matrices of the frontend transforms are only updated once the
+// backend has computed them, compose the local matrices instead
+QMatrix4x4 frontendWorldMatrix(Qt3DCore::QEntity *entity)
+{
+    QMatrix4x4 worldMatrix;
+    for (; entity != nullptr; entity = entity->parentEntity()) {
+        const auto transforms = entity->componentsOfType<Qt3DCore::QTransform>();
+        if (!transforms.empty())
+            worldMatrix = transforms.first()->matrix() * worldMatrix;
+    }
+    return worldMatrix;
+}
+
+// Bounds of the geometry extents seeded at import time under sceneEntity
+bool frontendSceneBounds(Qt3DCore::QEntity *sceneEntity, QVector3D &sceneCenter, float &sceneRadius)
+{
+    QVector3D minExtent(std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max());
+    QVector3D maxExtent(std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest());
+    bool hasBounds = false;
+
+    const auto renderers = sceneEntity->findChildren<Qt3DRender::QGeometryRenderer *>();
+    for (Qt3DRender::QGeometryRenderer *renderer : renderers) {
+        const Qt3DRender::QGeometry *geometry = renderer->geometry();
+        if (geometry == nullptr || geometry->minExtent() == geometry->maxExtent())
+            continue;
+        const QVector3D geometryMin = geometry->minExtent();
+        const QVector3D geometryMax = geometry->maxExtent();
+        const auto entities = renderer->entities();
+        for (Qt3DCore::QEntity *entity : entities) {
+            const QMatrix4x4 worldMatrix = frontendWorldMatrix(entity);
+            for (int corner = 0; corner < 8; ++corner) {
+                const QVector3D point = worldMatrix.map(QVector3D(corner & 1 ? geometryMax.x() : geometryMin.x(),
+                                                                  corner & 2 ? geometryMax.y() : geometryMin.y(),
+                                                                  corner & 4 ? geometryMax.z() : geometryMin.z()));
+                for (int c = 0; c < 3; ++c) {
+                    minExtent[c] = std::min(minExtent[c], point[c]);
+                    maxExtent[c] = std::max(maxExtent[c], point[c]);
+                }
+            }
+            hasBounds = true;
+        }
+    }
+
+    if (!hasBounds)
+        return false;
+    sceneCenter = (minExtent + maxExtent) * 0.5f;
+    sceneRadius = (maxExtent - minExtent).length() * 0.5f;
+    return true;
+}
+#endif
+
+} // namespace
+
 ShadowMapManager::ShadowMapManager(QObject *parent)
     : QObject(parent)
+    , m_atlas(MinAtlasSize, MinShadowMapSize)
 {
     m_shadowMapEntity = new ShadowMapLightDataEntity;
     connect(m_shadowMapEntity, &ShadowMapLightDataEntity::worldBoundsChanged, this, &ShadowMapManager::updateSceneBounds);
@@ -103,6 +189,9 @@ void ShadowMapManager::addLight(ShadowCastingLight *light)
     m_lights.insert(light);
     connect(light, &ShadowCastingLight::castsShadowsChanged, this, &ShadowMapManager::castsShadowChanged);
     connect(light, &ShadowCastingLight::enabledChanged, this, &ShadowMapManager::castsShadowChanged);
+    connect(light, &ShadowCastingLight::textureSizeChanged, this, &ShadowMapManager::resizeShadowMaps);
+    connect(light, &ShadowCastingLight::textureSizeChanged, this, &ShadowMapManager::updateShadowMapAtlas);
+    connect(light, &ShadowCastingLight::shadowMapPriorityChanged, this, &ShadowMapManager::updateShadowMapAtlas);
 
     if (light->isEnabled() && light->castsShadows())
         createShadowMap(light);
@@ -110,12 +199,13 @@ void ShadowMapManager::addLight(ShadowCastingLight *light)
 
 void ShadowMapManager::removeLight(ShadowCastingLight *light)
 {
-    if (m_lights.contains(light))
+    if (!m_lights.contains(light))
         return;
 
     m_lights.remove(light);
-    disconnect(light, &ShadowCastingLight::castsShadowsChanged, this, &ShadowMapManager::castsShadowChanged);
-    destroyShadowMap(light);
+    disconnect(light, nullptr, this, nullptr);
+    if (m_shadowMaps.contains(light))
+        destroyShadowMap(light);
 }
 
 void ShadowMapManager::setLights(const QVector<ShadowCastingLight *> &lights)
@@ -130,6 +220,19 @@ void ShadowMapManager::setLights(const QVector<ShadowCastingLight *> &lights)
 
     for (auto light : lights)
         addLight(light);
+
+    if (lights != m_orderedLights) {
+        m_orderedLights = lights;
+        emit lightsChanged(lights);
+    }
+}
+
+/*!
+ * Returns the lights last set with setLights, in the order they were given.
+ */
+QVector<ShadowCastingLight *> ShadowMapManager::lights() const
+{
+    return m_orderedLights;
 }
 
 void ShadowMapManager::setSceneEntity(Qt3DCore::QEntity *sceneEntity)
@@ -137,6 +240,21 @@ void ShadowMapManager::setSceneEntity(Qt3DCore::QEntity *sceneEntity)
     m_shadowMapEntity->setParent(sceneEntity);
 }
 
+/*!
+ * Sets the camera the cascades of directional light shadow maps are fitted
+ * to. Only Qt3DRender::QCamera cameras are supported.
+ */
+void ShadowMapManager::setViewCamera(Qt3DCore::QEntity *viewCamera)
+{
+    auto camera = qobject_cast<Qt3DRender::QCamera *>(viewCamera);
+    if (m_viewCamera == camera)
+        return;
+
+    m_viewCamera = camera;
+    for (auto &shadowMap : m_shadowMaps)
+        shadowMap->setViewCamera(camera);
+}
+
 QVector<QSharedPointer<ShadowMap>> ShadowMapManager::activeShadowMaps() const
 {
     QVector<QSharedPointer<ShadowMap>> shadowMaps;
@@ -189,13 +307,17 @@ void ShadowMapManager::castsShadowChanged()
 void ShadowMapManager::renumberShadowMaps()
 {
     int cubeMapDepthTextureLayer = 0;
-    int depthTextureLayer = 0;
+    bool hasAtlasShadowMaps = false;
     for (auto &shadowMap : m_shadowMaps) {
-        auto &index = shadowMap->usesCubeMap() ? cubeMapDepthTextureLayer : depthTextureLayer;
-        shadowMap->setDepthTextureLayer(index);
-        ++index;
+        if (shadowMap->usesCubeMap()) {
+            shadowMap->setDepthTextureLayer(cubeMapDepthTextureLayer++);
+        } else {
+            // All directional and spot lights render into tiles of the same layer
+            shadowMap->setDepthTextureLayer(0);
+            hasAtlasShadowMaps = true;
+        }
     }
-    m_depthTexture->setLayers(depthTextureLayer);
+    m_depthTexture->setLayers(hasAtlasShadowMaps ? 1 : 0);
     m_depthCubeTexture->setLayers(cubeMapDepthTextureLayer);
 
     if (!m_hasCubeMapArrayTextures && cubeMapDepthTextureLayer > 1)
@@ -204,28 +326,69 @@ void ShadowMapManager::renumberShadowMaps()
 
 void ShadowMapManager::resizeShadowMaps()
 {
-    int maxTextureWidth = 0;
-    int maxTextureHeight = 0;
     int maxCubeMapTexureSize = 0;
 
     for (auto &shadowMap : m_shadowMaps) {
-        auto &width = shadowMap->usesCubeMap() ? maxCubeMapTexureSize : maxTextureWidth;
-        auto &height = shadowMap->usesCubeMap() ? maxCubeMapTexureSize : maxTextureHeight;
+        if (!shadowMap->usesCubeMap())
+            continue;
         const auto textureSize = shadowMap->light()->textureSize();
-        width = std::max(width, textureSize.width());
-        height = std::max(height, textureSize.height());
+        maxCubeMapTexureSize = std::max(maxCubeMapTexureSize, std::max(textureSize.width(), textureSize.height()));
     }
-    m_depthTexture->setSize(maxTextureWidth, maxTextureHeight);
     m_depthCubeTexture->setSize(maxCubeMapTexureSize, maxCubeMapTexureSize);
 }
 
+void ShadowMapManager::updateShadowMapAtlas()
+{
+    const float sceneRadius = m_shadowMapEntity->sceneRadius();
+
+    std::vector<ShadowMapAtlas::Request> requests;
+    QVector<ShadowMap *> atlasShadowMaps;
+    for (const auto &shadowMap : qAsConst(m_shadowMaps)) {
+        if (shadowMap->usesCubeMap())
+            continue;
+
+        // We have no access to the camera of the view, so the screen coverage
+        // is approximated with how much of the scene the light covers
+        auto light = shadowMap->light();
+        float coverage = 1.0f;
+        if (auto spotLight = qobject_cast<SpotLight *>(light))
+            coverage = ShadowMapAtlas::coneCoverage(spotLight->outerConeAngle(), shadowMap->lightCamera()->farPlane(), sceneRadius);
+
+        const auto textureSize = light->textureSize();
+        const int size = ShadowMapAtlas::selectResolution(coverage, light->shadowMapPriority(),
+                                                          std::max(textureSize.width(), textureSize.height()),
+                                                          MinShadowMapSize);
+        for (int cascade = 0, cascadeCount = shadowMap->cascadeCount(); cascade < cascadeCount; ++cascade)
+            requests.push_back({ atlasTileId(shadowMap.data(), cascade), size, light->shadowMapPriority() / float(cascade + 1) });
+        atlasShadowMaps.push_back(shadowMap.data());
+    }
+
+    // Growing or shrinking the atlas repacks all the tiles
+    const int atlasSize = ShadowMapAtlas::atlasSizeForRequests(requests, MinAtlasSize, MaxAtlasSize);
+    if (atlasSize != m_atlas.atlasSize())
+        m_atlas.setAtlasSize(atlasSize);
+    m_atlas.update(requests);
+    m_depthTexture->setSize(atlasSize, atlasSize);
+
+    for (auto shadowMap : atlasShadowMaps) {
+        for (int cascade = 0, cascadeCount = shadowMap->cascadeCount(); cascade < cascadeCount; ++cascade)
+            shadowMap->setAtlasTile(m_atlas.tile(atlasTileId(shadowMap, cascade)), QSize(atlasSize, atlasSize), cascade);
+    }
+}
+
 void ShadowMapManager::createShadowMap(ShadowCastingLight *light)
 {
     auto shadowMap = QSharedPointer<ShadowMap>::create(light, light->type() == Qt3DRender::QAbstractLight::PointLight ? m_depthCubeTexture : m_depthTexture);
     shadowMap->updateSceneBounds(m_shadowMapEntity->sceneCenter(), m_shadowMapEntity->sceneRadius());
+    shadowMap->setViewCamera(m_viewCamera);
     m_shadowMaps.insert(light, shadowMap);
+    connect(shadowMap.data(), &ShadowMap::cascadeCountChanged, this, &ShadowMapManager::updateShadowMapAtlas);
+    // The coverage of spot lights depends on their cone and position
+    if (light->type() == Qt3DRender::QAbstractLight::SpotLight)
+        connect(shadowMap.data(), &ShadowMap::lightViewProjectionChanged, this, &ShadowMapManager::updateShadowMapAtlas);
     renumberShadowMaps();
     resizeShadowMaps();
+    updateShadowMapAtlas();
     emit shadowMapsChanged(activeShadowMaps());
 }
 
@@ -234,6 +397,7 @@ void ShadowMapManager::destroyShadowMap(ShadowCastingLight *light)
     auto sm = m_shadowMaps.take(light);
     renumberShadowMaps();
     resizeShadowMaps();
+    updateShadowMapAtlas();
     emit shadowMapsChanged(activeShadowMaps());
 }
 
@@ -276,8 +440,14 @@ void ShadowMapLightDataEntity::updateSceneInfo()
     auto toQVector3D = [](const auto &v) { return QVector3D(v.x(), v.y(), v.z()); };
 
     const auto boundingSphere = rootEntity->worldBoundingVolumeWithChildren();
-    const auto sceneCenter = toQVector3D(boundingSphere->center());
-    const auto sceneRadius = boundingSphere->radius();
+    QVector3D sceneCenter = toQVector3D(boundingSphere->center());
+    float sceneRadius = boundingSphere->radius();
+#if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
+    // Qt 5 can't be handed the bounds seeded at import time, use them until
+    // the backend bounding volume jobs have run
+    if (sceneRadius <= 0.0f && parentEntity() != nullptr)
+        frontendSceneBounds(parentEntity(), sceneCenter, sceneRadius);
+#endif
     if (m_sceneRadius != sceneRadius || m_sceneCenter != sceneCenter) {
         m_sceneCenter = sceneCenter;
         m_sceneRadius = sceneRadius;
@@ -42,7 +42,9 @@
 
 #include <Kuesa/private/kuesa_global_p.h>
 #include <Kuesa/shadowmap.h>
+#include <Kuesa/private/shadowmapatlas_p.h>
 #include <QEntity>
+#include <QPointer>
 
 QT_BEGIN_NAMESPACE
 
@@ -77,7 +79,9 @@ public:
     void addLight(ShadowCastingLight *light);
     void removeLight(ShadowCastingLight *light);
     void setLights(const QVector<ShadowCastingLight *> &lights);
+    QVector<ShadowCastingLight *> lights() const;
     void setSceneEntity(Qt3DCore::QEntity *sceneEntity);
+    void setViewCamera(Qt3DCore::QEntity *viewCamera);
 
     QVector<QSharedPointer<ShadowMap>> activeShadowMaps() const;
 
@@ -89,6 +93,7 @@ public:
 
 Q_SIGNALS:
     void shadowMapsChanged(const QVector<QSharedPointer<ShadowMap>> &activeShadowMaps);
+    void lightsChanged(const QVector<ShadowCastingLight *> &lights);
     void sceneCenterChanged(const QVector3D &sceneCenter);
     void sceneRadiusChanged(float sceneRadius);
 
@@ -99,14 +104,18 @@ private:
     void castsShadowChanged();
     void renumberShadowMaps();
     void resizeShadowMaps();
+    void updateShadowMapAtlas();
 
     QSet<ShadowCastingLight *> m_lights;
+    QVector<ShadowCastingLight *> m_orderedLights;
     QHash<ShadowCastingLight *, QSharedPointer<ShadowMap>> m_shadowMaps;
     ShadowMapLightDataEntity *m_shadowMapEntity = nullptr;
 
     Qt3DRender::QAbstractTexture *m_depthTexture = nullptr;
     Qt3DRender::QAbstractTexture *m_depthCubeTexture = nullptr;
     bool m_hasCubeMapArrayTextures = false;
+    ShadowMapAtlas m_atlas;
+    QPointer<Qt3DRender::QCamera> m_viewCamera;
 };
 
 class KUESASHARED_EXPORT ShadowMapLightDataEntity : public Qt3DCore::QEntity
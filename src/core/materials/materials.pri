@@ -33,6 +33,8 @@ SOURCES += \
     $$PWD/metallicroughnesseffect.cpp \
     $$PWD/metallicroughnessmaterial.cpp \
     $$PWD/metallicroughnessshaderdata.cpp \
+    $$PWD/metallicroughnessblock.cpp \
+    $$PWD/shadervariantcache.cpp \
     $$PWD/metallicroughnessproperties.cpp \
     $$PWD/texturetransform.cpp \
     $$PWD/unliteffect.cpp \
@@ -49,6 +51,8 @@ HEADERS += \
     $$PWD/metallicroughnesseffect.h \
     $$PWD/metallicroughnessmaterial.h \
     $$PWD/metallicroughnessshaderdata_p.h \
+    $$PWD/metallicroughnessblock_p.h \
+    $$PWD/shadervariantcache_p.h \
     $$PWD/metallicroughnessproperties.h \
     $$PWD/texturetransform.h \
     $$PWD/unliteffect.h \
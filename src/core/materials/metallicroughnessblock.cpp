@@ -0,0 +1,106 @@
+/*
+    metallicroughnessblock.cpp
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "metallicroughnessblock_p.h"
+#include "metallicroughnessshaderdata_p.h"
+#include <cstring>
+
+QT_BEGIN_NAMESPACE
+
+namespace Kuesa {
+
+namespace MetallicRoughnessBlock {
+
+namespace {
+
+void writeFloat(char *block, int offset, float value)
+{
+    std::memcpy(block + offset, &value, sizeof(float));
+}
+
+void writeInt(char *block, int offset, qint32 value)
+{
+    std::memcpy(block + offset, &value, sizeof(qint32));
+}
+
+void writeColor(char *block, int offset, const QColor &color)
+{
+    const float rgba[4] = { float(color.redF()), float(color.greenF()), float(color.blueF()), float(color.alphaF()) };
+    std::memcpy(block + offset, rgba, sizeof(rgba));
+}
+
+void writeMatrix(char *block, int offset, const QMatrix3x3 &matrix)
+{
+    // QMatrix3x3 is stored column major, each column takes a vec4
+    const float *columns = matrix.constData();
+    for (int column = 0; column < 3; ++column) {
+        const float padded[4] = { columns[3 * column], columns[3 * column + 1], columns[3 * column + 2], 0.0f };
+        std::memcpy(block + offset + column * 4 * int(sizeof(float)), padded, sizeof(padded));
+    }
+}
+
+} // namespace
+
+void pack(const MetallicRoughnessShaderData &shaderData, char *block)
+{
+    std::memset(block, 0, Size);
+
+    writeMatrix(block, BaseColorMapTextureTransform, shaderData.baseColorMapTextureTransform());
+    writeMatrix(block, MetalRoughMapTextureTransform, shaderData.metalRoughMapTextureTransform());
+    writeMatrix(block, NormalMapTextureTransform, shaderData.normalMapTextureTransform());
+    writeMatrix(block, AmbientOcclusionMapTextureTransform, shaderData.ambientOcclusionMapTextureTransform());
+    writeMatrix(block, EmissiveMapTextureTransform, shaderData.emissiveMapTextureTransform());
+
+    writeColor(block, BaseColorFactor, shaderData.baseColorFactor());
+    writeColor(block, EmissiveFactor, shaderData.emissiveFactor());
+
+    writeFloat(block, MetallicFactor, shaderData.metallicFactor());
+    writeFloat(block, RoughnessFactor, shaderData.roughnessFactor());
+    writeFloat(block, NormalScale, shaderData.normalScale());
+    writeFloat(block, AlphaCutoff, shaderData.alphaCutoff());
+
+    writeInt(block, BaseColorUsesTexCoord1, shaderData.isBaseColorUsingTexCoord1());
+    writeInt(block, MetallicRoughnessUsesTexCoord1, shaderData.isMetallicRoughnessUsingTexCoord1());
+    writeInt(block, NormalUsesTexCoord1, shaderData.isNormalUsingTexCoord1());
+    writeInt(block, AOUsesTexCoord1, shaderData.isAOUsingTexCoord1());
+    writeInt(block, EmissiveUsesTexCoord1, shaderData.isEmissiveUsingTexCoord1());
+    writeInt(block, ReceivesShadows, shaderData.receivesShadows());
+}
+
+QByteArray pack(const MetallicRoughnessShaderData &shaderData)
+{
+    QByteArray block(Size, Qt::Uninitialized);
+    pack(shaderData, block.data());
+    return block;
+}
+
+} // namespace MetallicRoughnessBlock
+
+} // namespace Kuesa
+
+QT_END_NAMESPACE
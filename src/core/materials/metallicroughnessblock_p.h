@@ -0,0 +1,91 @@
+/*
+    metallicroughnessblock_p.h
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef KUESA_METALLICROUGHNESSBLOCK_P_H
+#define KUESA_METALLICROUGHNESSBLOCK_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Kuesa API.  It exists for the convenience
+// of other Kuesa classes.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <Kuesa/private/kuesa_global_p.h>
+#include <QByteArray>
+
+QT_BEGIN_NAMESPACE
+
+namespace Kuesa {
+
+class MetallicRoughnessShaderData;
+
+// std140 layout of the MetallicRoughness struct declared in
+// kuesa_metallicRoughnessShaderData.inc.frag. Matrices are stored as three
+// columns padded to a vec4, booleans as 32 bit integers. The shader
+// declarations must be kept in sync.
+namespace MetallicRoughnessBlock {
+
+enum Offset {
+    BaseColorMapTextureTransform = 0,
+    MetalRoughMapTextureTransform = 48,
+    NormalMapTextureTransform = 96,
+    AmbientOcclusionMapTextureTransform = 144,
+    EmissiveMapTextureTransform = 192,
+    BaseColorFactor = 240,
+    EmissiveFactor = 256,
+    MetallicFactor = 272,
+    RoughnessFactor = 276,
+    NormalScale = 280,
+    AlphaCutoff = 284,
+    BaseColorUsesTexCoord1 = 288,
+    MetallicRoughnessUsesTexCoord1 = 292,
+    NormalUsesTexCoord1 = 296,
+    AOUsesTexCoord1 = 300,
+    EmissiveUsesTexCoord1 = 304,
+    ReceivesShadows = 308,
+};
+
+// Size of the block, rounded up to a vec4 as for the elements of an array
+const int Size = 320;
+
+// Writes Size bytes to block
+KUESA_PRIVATE_EXPORT void pack(const MetallicRoughnessShaderData &shaderData, char *block);
+KUESA_PRIVATE_EXPORT QByteArray pack(const MetallicRoughnessShaderData &shaderData);
+
+} // namespace MetallicRoughnessBlock
+
+} // namespace Kuesa
+
+QT_END_NAMESPACE
+
+#endif // KUESA_METALLICROUGHNESSBLOCK_P_H
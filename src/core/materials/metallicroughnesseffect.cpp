@@ -42,6 +42,7 @@
 #include <Qt3DRender/qblendequation.h>
 #include <Qt3DRender/qblendequationarguments.h>
 #include <private/framegraphutils_p.h>
+#include "shadervariantcache_p.h"
 
 QT_BEGIN_NAMESPACE
 
@@ -59,6 +60,7 @@ MetallicRoughnessTechnique::MetallicRoughnessTechnique(Version version, Qt3DCore
     , m_cubeMapShadowShaderBuilder(new QShaderProgramBuilder(this))
     , m_metalRoughShader(new QShaderProgram(this))
     , m_zfillShader(new QShaderProgram(this))
+    , m_cubeMapShadowShader(nullptr)
     , m_zfillRenderPass(new QRenderPass(this))
     , m_opaqueRenderPass(new QRenderPass(this))
     , m_transparentRenderPass(new QRenderPass(this))
@@ -165,13 +167,13 @@ MetallicRoughnessTechnique::MetallicRoughnessTechnique(Version version, Qt3DCore
         QStringLiteral("qrc:/kuesa/shaders/gl3/shadow_cube.geom")
     };
     if (FrameGraphUtils::hasGeometryShaderSupport() && !cubeShadowShaderSource[version].isNull()) {
-        auto cubeShadowShaderProg = new Qt3DRender::QShaderProgram(this);
-        m_cubeMapShadowShaderBuilder->setShaderProgram(cubeShadowShaderProg);
+        m_cubeMapShadowShader = new Qt3DRender::QShaderProgram(this);
+        m_cubeMapShadowShaderBuilder->setShaderProgram(m_cubeMapShadowShader);
         m_cubeMapShadowShaderBuilder->setVertexShaderGraph(vertexShaderGraph);
-        cubeShadowShaderProg->setGeometryShaderCode(Qt3DRender::QShaderProgram::loadSource(QUrl(cubeShadowShaderSource[version])));
-        cubeShadowShaderProg->setFragmentShaderCode(zFillFragmentShaderCode[version]);
+        m_cubeMapShadowShader->setGeometryShaderCode(Qt3DRender::QShaderProgram::loadSource(QUrl(cubeShadowShaderSource[version])));
+        m_cubeMapShadowShader->setFragmentShaderCode(zFillFragmentShaderCode[version]);
 
-        m_cubeMapShadowRenderPass->setShaderProgram(cubeShadowShaderProg);
+        m_cubeMapShadowRenderPass->setShaderProgram(m_cubeMapShadowShader);
 
         auto cubeShadowMapFilterKey = new Qt3DRender::QFilterKey(this);
         cubeShadowMapFilterKey->setName(QStringLiteral("KuesaDrawStage"));
@@ -193,6 +195,12 @@ void MetallicRoughnessTechnique::setEnabledLayers(const QStringList &layers)
     m_metalRoughShaderBuilder->setEnabledLayers(layers);
     m_zfillShaderBuilder->setEnabledLayers(layers);
     m_cubeMapShadowShaderBuilder->setEnabledLayers(layers);
+
+    // Use pre-generated variants when available and skip the graph builders
+    ShaderVariantCache *cache = ShaderVariantCache::instance();
+    cache->apply(graphicsApiFilter(), m_metalRoughShaderBuilder, m_metalRoughShader);
+    cache->apply(graphicsApiFilter(), m_zfillShaderBuilder, m_zfillShader);
+    cache->apply(graphicsApiFilter(), m_cubeMapShadowShaderBuilder, m_cubeMapShadowShader);
 }
 
 void MetallicRoughnessTechnique::setOpaque(bool opaque)
@@ -368,6 +376,8 @@ MetallicRoughnessEffect::MetallicRoughnessEffect(Qt3DCore::QNode *parent)
                 QStringLiteral("noHasColorAttr"),
                 QStringLiteral("noDoubleSided"),
                 QStringLiteral("noHasAlphaCutoff"),
+                // Only used when the View enables clustered lighting
+                QStringLiteral("clusteredLights"),
 #if defined(ENABLE_SHADOWS)
                 QStringLiteral("shadows")
 #endif
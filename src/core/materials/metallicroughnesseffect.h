@@ -80,6 +80,7 @@ private:
     Qt3DRender::QShaderProgramBuilder *m_cubeMapShadowShaderBuilder;
     Qt3DRender::QShaderProgram *m_metalRoughShader;
     Qt3DRender::QShaderProgram *m_zfillShader;
+    Qt3DRender::QShaderProgram *m_cubeMapShadowShader;
     Qt3DRender::QRenderPass *m_zfillRenderPass;
     Qt3DRender::QRenderPass *m_opaqueRenderPass;
     Qt3DRender::QRenderPass *m_transparentRenderPass;
@@ -31,6 +31,7 @@
 
 #include <Qt3DRender/qtexture.h>
 #include <Qt3DRender/qparameter.h>
+#include <QOpenGLContext>
 
 #include <type_traits>
 
@@ -45,6 +46,18 @@ using namespace Qt3DRender;
 
 namespace Kuesa {
 
+namespace {
+
+// OpenGL ES 2 contexts can only be created from the GLES library. ES 2 has no
+// uniform blocks and its technique resolves the members of the shader data
+// one by one instead.
+bool mayUseOpenGLES2()
+{
+    return QOpenGLContext::openGLModuleType() == QOpenGLContext::LibGLES;
+}
+
+} // namespace
+
 /*!
     \class Kuesa::MetallicRoughnessMaterial
     \inheaderfile Kuesa/MetallicRoughnessMaterial
@@ -116,7 +129,8 @@ namespace Kuesa {
 MetallicRoughnessMaterial::MetallicRoughnessMaterial(Qt3DCore::QNode *parent)
     : GLTF2Material(parent)
     , m_materialProperties(nullptr)
-    , m_metallicRoughnessShaderDataParameter(new Qt3DRender::QParameter(QStringLiteral("metallicRoughness"), {}))
+    , m_metallicRoughnessBlockParameter(new Qt3DRender::QParameter(QStringLiteral("MetallicRoughnessBlock"), {}))
+    , m_metallicRoughnessShaderDataParameter(mayUseOpenGLES2() ? new Qt3DRender::QParameter(QStringLiteral("metallicRoughness"), {}) : nullptr)
     , m_baseColorMapParameter(new Qt3DRender::QParameter(QStringLiteral("baseColorMap"), {}))
     , m_normalMapParameter(new Qt3DRender::QParameter(QStringLiteral("normalMap"), {}))
     , m_emissiveMapParameter(new Qt3DRender::QParameter(QStringLiteral("emissiveMap"), {}))
@@ -124,7 +138,9 @@ MetallicRoughnessMaterial::MetallicRoughnessMaterial(Qt3DCore::QNode *parent)
     , m_metalRoughMapParameter(new Qt3DRender::QParameter(QStringLiteral("metalRoughMap"), {}))
 
 {
-    addParameter(m_metallicRoughnessShaderDataParameter);
+    addParameter(m_metallicRoughnessBlockParameter);
+    if (m_metallicRoughnessShaderDataParameter)
+        addParameter(m_metallicRoughnessShaderDataParameter);
     addParameter(m_baseColorMapParameter);
     addParameter(m_normalMapParameter);
     addParameter(m_emissiveMapParameter);
@@ -179,7 +195,13 @@ void MetallicRoughnessMaterial::setMaterialProperties(MetallicRoughnessPropertie
             enforceSRGBOnTexture(m_materialProperties->baseColorMap());
             enforceSRGBOnTexture(m_materialProperties->emissiveMap());
 
-            m_metallicRoughnessShaderDataParameter->setValue(QVariant::fromValue(metallicRoughnessProperties->shaderData()));
+            // The factors and flags of the material are uploaded as a single
+            // std140 block updated only when they change. The shader data is
+            // only bound when the ES 2 technique may get picked at runtime.
+            Qt3DRender::QShaderData *shaderData = metallicRoughnessProperties->shaderData();
+            m_metallicRoughnessBlockParameter->setValue(QVariant::fromValue(static_cast<MetallicRoughnessShaderData *>(shaderData)->blockBuffer()));
+            if (m_metallicRoughnessShaderDataParameter)
+                m_metallicRoughnessShaderDataParameter->setValue(QVariant::fromValue(shaderData));
             metallicRoughnessProperties->addClientMaterial(this);
 
             setShadowMapDepthTexture(m_materialProperties->shadowMapDepthTexture());
@@ -72,6 +72,7 @@ private:
     void enforceSRGBOnTexture(Qt3DRender::QAbstractTexture *t) const;
 
     MetallicRoughnessProperties *m_materialProperties;
+    Qt3DRender::QParameter *m_metallicRoughnessBlockParameter;
     Qt3DRender::QParameter *m_metallicRoughnessShaderDataParameter;
     QMetaObject::Connection m_textureTransformChangedConnection;
     Qt3DRender::QParameter *m_baseColorMapParameter;
@@ -27,6 +27,7 @@
 */
 
 #include "metallicroughnessshaderdata_p.h"
+#include "metallicroughnessblock_p.h"
 #include <Qt3DRender/private/qshaderdata_p.h>
 
 QT_BEGIN_NAMESPACE
@@ -46,7 +47,10 @@ MetallicRoughnessShaderData::MetallicRoughnessShaderData(Qt3DCore::QNode *parent
     , m_emissiveFactor(QColor("black"))
     , m_alphaCutoff(0.0f)
     , m_receivesShadows(true)
+    , m_block(MetallicRoughnessBlock::pack(*this))
+    , m_blockBuffer(new Qt3DGeometry::QBuffer(this))
 {
+    m_blockBuffer->setData(m_block);
 }
 
 MetallicRoughnessShaderData::~MetallicRoughnessShaderData()
@@ -139,6 +143,7 @@ void MetallicRoughnessShaderData::setBaseColorUsesTexCoord1(bool baseColorUsesTe
         return;
     m_baseColorUsesTexCoord1 = baseColorUsesTexCoord1;
     emit baseColorUsesTexCoord1Changed(baseColorUsesTexCoord1);
+    updateBlock();
 }
 
 void MetallicRoughnessShaderData::setMetallicRoughnessUsesTexCoord1(bool metallicRoughnessUsesTexCoord1)
@@ -147,6 +152,7 @@ void MetallicRoughnessShaderData::setMetallicRoughnessUsesTexCoord1(bool metalli
         return;
     m_metallicRoughnessUsesTexCoord1 = metallicRoughnessUsesTexCoord1;
     emit metallicRoughnessUsesTexCoord1Changed(metallicRoughnessUsesTexCoord1);
+    updateBlock();
 }
 
 void MetallicRoughnessShaderData::setNormalUsesTexCoord1(bool normalUsesTexCoord1)
@@ -155,6 +161,7 @@ void MetallicRoughnessShaderData::setNormalUsesTexCoord1(bool normalUsesTexCoord
         return;
     m_normalUsesTexCoord1 = normalUsesTexCoord1;
     emit normalUsesTexCoord1Changed(normalUsesTexCoord1);
+    updateBlock();
 }
 
 void MetallicRoughnessShaderData::setAOUsesTexCoord1(bool aoUsesTexCoord1)
@@ -163,6 +170,7 @@ void MetallicRoughnessShaderData::setAOUsesTexCoord1(bool aoUsesTexCoord1)
         return;
     m_aoUsesTexCoord1 = aoUsesTexCoord1;
     emit aoUsesTexCoord1Changed(aoUsesTexCoord1);
+    updateBlock();
 }
 
 void MetallicRoughnessShaderData::setEmissiveUsesTexCoord1(bool emissiveUsesTexCoord1)
@@ -171,6 +179,7 @@ void MetallicRoughnessShaderData::setEmissiveUsesTexCoord1(bool emissiveUsesTexC
         return;
     m_emissiveUsesTexCoord1 = emissiveUsesTexCoord1;
     emit emissiveUsesTexCoord1Changed(emissiveUsesTexCoord1);
+    updateBlock();
 }
 
 void MetallicRoughnessShaderData::setBaseColorFactor(const QColor &baseColorFactor)
@@ -179,6 +188,7 @@ void MetallicRoughnessShaderData::setBaseColorFactor(const QColor &baseColorFact
         return;
     m_baseColorFactor = baseColorFactor;
     emit baseColorFactorChanged(baseColorFactor);
+    updateBlock();
 }
 
 void MetallicRoughnessShaderData::setMetallicFactor(float metallicFactor)
@@ -187,6 +197,7 @@ void MetallicRoughnessShaderData::setMetallicFactor(float metallicFactor)
         return;
     m_metallicFactor = metallicFactor;
     emit metallicFactorChanged(metallicFactor);
+    updateBlock();
 }
 
 void MetallicRoughnessShaderData::setRoughnessFactor(float roughnessFactor)
@@ -195,13 +206,15 @@ void MetallicRoughnessShaderData::setRoughnessFactor(float roughnessFactor)
         return;
     m_roughnessFactor = roughnessFactor;
     emit roughnessFactorChanged(roughnessFactor);
+    updateBlock();
 }
 
 void MetallicRoughnessShaderData::setBaseColorMapTextureTransform(const QMatrix3x3 &m)
 {
     if (m_baseColorMapTextureTransform != m) {
         m_baseColorMapTextureTransform = m;
-        emit baseColorMapTextureTransform();
+        emit baseColorMapTextureTransformChanged(m);
+        updateBlock();
     }
 }
 
@@ -209,7 +222,8 @@ void MetallicRoughnessShaderData::setEmissiveMapTextureTransform(const QMatrix3x
 {
     if (m_emissiveMapTextureTransform != m) {
         m_emissiveMapTextureTransform = m;
-        emit emissiveMapTextureTransform();
+        emit emissiveMapTextureTransformChanged(m);
+        updateBlock();
     }
 }
 
@@ -217,7 +231,8 @@ void MetallicRoughnessShaderData::setMetalRoughMapTextureTransform(const QMatrix
 {
     if (m_metalRoughMapTextureTransform != m) {
         m_metalRoughMapTextureTransform = m;
-        emit metalRoughMapTextureTransform();
+        emit metalRoughMapTextureTransformChanged(m);
+        updateBlock();
     }
 }
 
@@ -225,7 +240,8 @@ void MetallicRoughnessShaderData::setNormalMapTextureTransform(const QMatrix3x3
 {
     if (m_normalMapTextureTransform != m) {
         m_normalMapTextureTransform = m;
-        emit normalMapTextureTransform();
+        emit normalMapTextureTransformChanged(m);
+        updateBlock();
     }
 }
 
@@ -233,7 +249,8 @@ void MetallicRoughnessShaderData::setAmbientOcclusionMapTextureTransform(const Q
 {
     if (m_ambientOcclusionMapTextureTransform != m) {
         m_ambientOcclusionMapTextureTransform = m;
-        emit ambientOcclusionMapTextureTransform();
+        emit ambientOcclusionMapTextureTransformChanged(m);
+        updateBlock();
     }
 }
 
@@ -243,6 +260,7 @@ void MetallicRoughnessShaderData::setNormalScale(float normalScale)
         return;
     m_normalScale = normalScale;
     emit normalScaleChanged(normalScale);
+    updateBlock();
 }
 
 void MetallicRoughnessShaderData::setEmissiveFactor(const QColor &emissiveFactor)
@@ -251,6 +269,7 @@ void MetallicRoughnessShaderData::setEmissiveFactor(const QColor &emissiveFactor
         return;
     m_emissiveFactor = emissiveFactor;
     emit emissiveFactorChanged(emissiveFactor);
+    updateBlock();
 }
 
 void MetallicRoughnessShaderData::setAlphaCutoff(float alphaCutoff)
@@ -259,6 +278,7 @@ void MetallicRoughnessShaderData::setAlphaCutoff(float alphaCutoff)
         return;
     m_alphaCutoff = alphaCutoff;
     emit alphaCutoffChanged(alphaCutoff);
+    updateBlock();
 }
 
 void MetallicRoughnessShaderData::setReceivesShadows(bool receivesShadows)
@@ -267,6 +287,7 @@ void MetallicRoughnessShaderData::setReceivesShadows(bool receivesShadows)
         return;
     m_receivesShadows = receivesShadows;
     emit receivesShadowsChanged(receivesShadows);
+    updateBlock();
 }
 
 QMatrix3x3 Kuesa::MetallicRoughnessShaderData::baseColorMapTextureTransform() const
@@ -274,6 +295,41 @@ QMatrix3x3 Kuesa::MetallicRoughnessShaderData::baseColorMapTextureTransform() co
     return m_baseColorMapTextureTransform;
 }
 
+QByteArray MetallicRoughnessShaderData::block() const
+{
+    return m_block;
+}
+
+/*!
+    \internal
+
+    Buffer holding block(), bound to the MetallicRoughnessBlock uniform block
+    of the shaders. It is only updated when a property actually changes.
+ */
+Qt3DGeometry::QBuffer *MetallicRoughnessShaderData::blockBuffer() const
+{
+    return m_blockBuffer;
+}
+
+void MetallicRoughnessShaderData::updateBlock()
+{
+    // Setters change a single member, only upload the bytes that differ
+    const QByteArray block = MetallicRoughnessBlock::pack(*this);
+    Q_ASSERT(block.size() == m_block.size());
+    int first = 0;
+    while (first < block.size() && block[first] == m_block[first])
+        ++first;
+    if (first == block.size())
+        return;
+    int last = block.size();
+    while (block[last - 1] == m_block[last - 1])
+        --last;
+
+    m_block = block;
+    m_blockBuffer->updateData(first, block.mid(first, last - first));
+    emit blockChanged(m_block);
+}
+
 } // namespace Kuesa
 
 QT_END_NAMESPACE
@@ -47,12 +47,18 @@
 #include <QMatrix3x3>
 
 #include <Kuesa/kuesa_global.h>
+#include <Kuesa/private/kuesa_global_p.h>
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+#include <Qt3DCore/QBuffer>
+#else
+#include <Qt3DRender/QBuffer>
+#endif
 
 QT_BEGIN_NAMESPACE
 
 namespace Kuesa {
 
-class MetallicRoughnessShaderData : public Qt3DRender::QShaderData
+class KUESA_PRIVATE_EXPORT MetallicRoughnessShaderData : public Qt3DRender::QShaderData
 {
     Q_OBJECT
 
@@ -113,6 +119,10 @@ public:
 
     bool receivesShadows() const;
 
+    // std140 packed MetallicRoughness block, see MetallicRoughnessBlock
+    QByteArray block() const;
+    Qt3DGeometry::QBuffer *blockBuffer() const;
+
 public Q_SLOTS:
     void setBaseColorUsesTexCoord1(bool baseColorUsesTexCoord1);
     void setMetallicRoughnessUsesTexCoord1(bool metallicRoughnessUsesTexCoord1);
@@ -164,8 +174,11 @@ Q_SIGNALS:
     void alphaCutoffChanged(float alphaCutoff);
 
     void receivesShadowsChanged(bool receivesShadows);
+    void blockChanged(const QByteArray &block);
 
 private:
+    void updateBlock();
+
     bool m_baseColorUsesTexCoord1;
     bool m_metallicRoughnessUsesTexCoord1;
     bool m_normalUsesTexCoord1;
@@ -189,6 +202,8 @@ private:
 
     float m_alphaCutoff;
     bool m_receivesShadows;
+    QByteArray m_block;
+    Qt3DGeometry::QBuffer *m_blockBuffer;
 };
 } // namespace Kuesa
 QT_END_NAMESPACE
@@ -0,0 +1,235 @@
+/*
+    shadervariantcache.cpp
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "shadervariantcache_p.h"
+#include "kuesa_p.h"
+
+#include <Kuesa/kuesaversion.h>
+#include <Qt3DRender/QEffect>
+#include <Qt3DRender/QGraphicsApiFilter>
+#include <Qt3DRender/QShaderProgramBuilder>
+#include <Qt3DRender/QTechnique>
+#include <Qt3DRender/private/qgraphicsapifilter_p.h>
+#include <Qt3DRender/private/shaderbuilder_p.h>
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+
+QT_BEGIN_NAMESPACE
+
+using namespace Qt3DRender;
+
+namespace Kuesa {
+
+namespace {
+
+struct StageGraph {
+    QShaderProgram::ShaderType stage;
+    QUrl (QShaderProgramBuilder::*graph)() const;
+    QLatin1String extension;
+};
+
+const StageGraph stageGraphs[] = {
+    { QShaderProgram::Vertex, &QShaderProgramBuilder::vertexShaderGraph, QLatin1String("vert") },
+    { QShaderProgram::TessellationControl, &QShaderProgramBuilder::tessellationControlShaderGraph, QLatin1String("tesc") },
+    { QShaderProgram::TessellationEvaluation, &QShaderProgramBuilder::tessellationEvaluationShaderGraph, QLatin1String("tese") },
+    { QShaderProgram::Geometry, &QShaderProgramBuilder::geometryShaderGraph, QLatin1String("geom") },
+    { QShaderProgram::Fragment, &QShaderProgramBuilder::fragmentShaderGraph, QLatin1String("frag") },
+    { QShaderProgram::Compute, &QShaderProgramBuilder::computeShaderGraph, QLatin1String("comp") },
+};
+
+QLatin1String stageExtension(QShaderProgram::ShaderType stage)
+{
+    for (const StageGraph &stageGraph : stageGraphs) {
+        if (stageGraph.stage == stage)
+            return stageGraph.extension;
+    }
+    return QLatin1String("glsl");
+}
+
+QString localFileName(const QUrl &url)
+{
+    if (url.scheme() == QLatin1String("qrc"))
+        return QLatin1Char(':') + url.path();
+    return url.toLocalFile();
+}
+
+QStringList defaultPaths()
+{
+    QStringList paths;
+    const QString environmentPaths = qEnvironmentVariable("KUESA_SHADER_VARIANTS_PATH");
+    if (!environmentPaths.isEmpty())
+        paths = environmentPaths.split(QDir::listSeparator(), Qt::SkipEmptyParts);
+    const QString resourcePath = QStringLiteral(":/kuesa/shadervariants");
+    if (QDir(resourcePath).exists())
+        paths.push_back(resourcePath);
+    return paths;
+}
+
+} // namespace
+
+ShaderVariantCache::ShaderVariantCache()
+    : m_paths(defaultPaths())
+{
+}
+
+ShaderVariantCache *ShaderVariantCache::instance()
+{
+    static ShaderVariantCache cache;
+    return &cache;
+}
+
+void ShaderVariantCache::setPaths(const QStringList &paths)
+{
+    m_paths = paths;
+    m_shaderCodes.clear();
+}
+
+QStringList ShaderVariantCache::paths() const
+{
+    return m_paths;
+}
+
+QString ShaderVariantCache::fileName(const QGraphicsApiFilter *api,
+                                     QShaderProgram::ShaderType stage,
+                                     const QUrl &graph,
+                                     const QStringList &layers)
+{
+    QStringList sortedLayers = layers;
+    sortedLayers.sort();
+    sortedLayers.removeDuplicates();
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(QByteArrayLiteral(KUESA_VERSION_STR " " QT_VERSION_STR));
+    hash.addData(QByteArray::number(int(api->api())) + ' ' + QByteArray::number(int(api->profile())) + ' ' + QByteArray::number(api->majorVersion()) + '.' + QByteArray::number(api->minorVersion()));
+    hash.addData(QByteArray::number(int(stage)));
+    hash.addData(graph.toEncoded());
+    hash.addData(graphHash(graph));
+    hash.addData(sortedLayers.join(QLatin1Char('\n')).toUtf8());
+    return QString::fromLatin1(hash.result().toHex()) + QLatin1Char('.') + stageExtension(stage);
+}
+
+std::vector<ShaderVariantCache::Variant> ShaderVariantCache::variants(const QGraphicsApiFilter *api,
+                                                                      const QShaderProgramBuilder *builder)
+{
+    std::vector<Variant> variants;
+    const QStringList layers = builder->enabledLayers();
+    for (const StageGraph &stageGraph : stageGraphs) {
+        const QUrl graph = (builder->*stageGraph.graph)();
+        if (!graph.isEmpty())
+            variants.push_back({ stageGraph.stage, graph, fileName(api, stageGraph.stage, graph, layers) });
+    }
+    return variants;
+}
+
+QByteArray ShaderVariantCache::shaderCode(const QString &fileName)
+{
+    const auto it = m_shaderCodes.constFind(fileName);
+    if (it != m_shaderCodes.cend())
+        return it.value();
+
+    // Misses are cached as well, layers change a lot while effects are set up
+    QByteArray code;
+    for (const QString &path : qAsConst(m_paths)) {
+        QFile file(QDir(path).filePath(fileName));
+        if (file.open(QIODevice::ReadOnly)) {
+            code = file.readAll();
+            break;
+        }
+    }
+    m_shaderCodes.insert(fileName, code);
+    return code;
+}
+
+bool ShaderVariantCache::apply(const QGraphicsApiFilter *api,
+                               QShaderProgramBuilder *builder,
+                               QShaderProgram *program)
+{
+    if (!program || m_paths.isEmpty())
+        return false;
+
+    const std::vector<Variant> variants = this->variants(api, builder);
+    if (variants.empty())
+        return false;
+
+    std::vector<QByteArray> codes;
+    codes.reserve(variants.size());
+    for (const Variant &variant : variants) {
+        codes.push_back(shaderCode(variant.fileName));
+        if (codes.back().isEmpty()) {
+            builder->setShaderProgram(program);
+            return false;
+        }
+    }
+
+    builder->setShaderProgram(nullptr);
+    for (size_t i = 0, m = variants.size(); i < m; ++i)
+        program->setShaderCode(variants[i].stage, codes[i]);
+    return true;
+}
+
+std::vector<ShaderVariantCache::GeneratedVariant> ShaderVariantCache::generate(const QEffect *effect)
+{
+    std::vector<GeneratedVariant> generated;
+    const auto techniques = effect->techniques();
+    for (const QTechnique *technique : techniques) {
+        const QGraphicsApiFilter *api = technique->graphicsApiFilter();
+        const auto builders = technique->findChildren<QShaderProgramBuilder *>(QString(), Qt::FindDirectChildrenOnly);
+        for (const QShaderProgramBuilder *builder : builders) {
+            Render::ShaderBuilder backend;
+            backend.setGraphicsApi(QGraphicsApiFilterPrivate::get(const_cast<QGraphicsApiFilter *>(api))->m_data);
+            backend.syncFromFrontEnd(builder, true);
+
+            for (const Variant &variant : variants(api, builder)) {
+                backend.generateCode(variant.stage);
+                const QByteArray code = backend.shaderCode(variant.stage);
+                if (code.isEmpty()) {
+                    qCWarning(kuesa) << "Failed to generate" << variant.graph << "with layers" << builder->enabledLayers();
+                    continue;
+                }
+                generated.push_back({ variant.fileName, code });
+            }
+        }
+    }
+    return generated;
+}
+
+QByteArray ShaderVariantCache::graphHash(const QUrl &graph)
+{
+    auto it = m_graphHashes.find(graph);
+    if (it == m_graphHashes.end()) {
+        QFile file(localFileName(graph));
+        const QByteArray content = file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+        it = m_graphHashes.insert(graph, QCryptographicHash::hash(content, QCryptographicHash::Sha1));
+    }
+    return it.value();
+}
+
+} // namespace Kuesa
+
+QT_END_NAMESPACE
@@ -0,0 +1,127 @@
+/*
+    shadervariantcache_p.h
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef KUESA_SHADERVARIANTCACHE_P_H
+#define KUESA_SHADERVARIANTCACHE_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Kuesa API.  It exists for the convenience
+// of other Kuesa classes.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <Kuesa/private/kuesa_global_p.h>
+#include <Qt3DRender/QShaderProgram>
+#include <QHash>
+#include <QStringList>
+#include <QUrl>
+#include <vector>
+
+QT_BEGIN_NAMESPACE
+
+namespace Qt3DRender {
+class QEffect;
+class QGraphicsApiFilter;
+class QShaderProgramBuilder;
+} // namespace Qt3DRender
+
+namespace Kuesa {
+
+// Shader sources generated offline from the shader graphs of the effects.
+//
+// Each stage of a QShaderProgramBuilder is identified by a key hashing the
+// graphics API of its technique, the URL and content of its graph and its
+// enabled layers. The shaderVariantGenerator tool writes the generated code
+// of each key to a file; at runtime apply() loads it into the shader program
+// and detaches the builder so that the graph is never expanded.
+//
+// Files are looked up in the directories listed in the
+// KUESA_SHADER_VARIANTS_PATH environment variable and in the
+// :/kuesa/shadervariants resource directory.
+class KUESA_PRIVATE_EXPORT ShaderVariantCache
+{
+public:
+    struct Variant {
+        Qt3DRender::QShaderProgram::ShaderType stage;
+        QUrl graph;
+        QString fileName;
+    };
+
+    struct GeneratedVariant {
+        QString fileName;
+        QByteArray code;
+    };
+
+    ShaderVariantCache();
+
+    static ShaderVariantCache *instance();
+
+    void setPaths(const QStringList &paths);
+    QStringList paths() const;
+
+    QString fileName(const Qt3DRender::QGraphicsApiFilter *api,
+                     Qt3DRender::QShaderProgram::ShaderType stage,
+                     const QUrl &graph,
+                     const QStringList &layers);
+
+    // One variant per stage of builder having a graph
+    std::vector<Variant> variants(const Qt3DRender::QGraphicsApiFilter *api,
+                                  const Qt3DRender::QShaderProgramBuilder *builder);
+
+    // Generated code for fileName, empty if it isn't in the cache
+    QByteArray shaderCode(const QString &fileName);
+
+    // Sets the cached code of all the stages of builder on program and
+    // detaches builder from it. Attaches builder back to program and returns
+    // false when a stage is missing.
+    bool apply(const Qt3DRender::QGraphicsApiFilter *api,
+               Qt3DRender::QShaderProgramBuilder *builder,
+               Qt3DRender::QShaderProgram *program);
+
+    // Runs the graph builder on all the shader program builders of the
+    // techniques of effect
+    std::vector<GeneratedVariant> generate(const Qt3DRender::QEffect *effect);
+
+private:
+    QByteArray graphHash(const QUrl &graph);
+
+    QStringList m_paths;
+    QHash<QString, QByteArray> m_shaderCodes;
+    QHash<QUrl, QByteArray> m_graphHashes;
+};
+
+} // namespace Kuesa
+
+QT_END_NAMESPACE
+
+#endif // KUESA_SHADERVARIANTCACHE_P_H
@@ -41,6 +41,7 @@
 #include <Qt3DRender/qdepthtest.h>
 #include <Qt3DRender/qblendequation.h>
 #include <Qt3DRender/qblendequationarguments.h>
+#include "shadervariantcache_p.h"
 
 QT_BEGIN_NAMESPACE
 
@@ -202,6 +203,11 @@ void UnlitTechnique::setEnabledLayers(const QStringList &layers)
 {
     m_unlitShaderBuilder->setEnabledLayers(layers);
     m_zfillShaderBuilder->setEnabledLayers(layers);
+
+    // Use pre-generated variants when available and skip the graph builders
+    ShaderVariantCache *cache = ShaderVariantCache::instance();
+    cache->apply(graphicsApiFilter(), m_unlitShaderBuilder, m_unlitShader);
+    cache->apply(graphicsApiFilter(), m_zfillShaderBuilder, m_zfillShader);
 }
 
 void UnlitTechnique::setOpaque(bool opaque)
@@ -29,7 +29,12 @@
 #include "meshinstantiator.h"
 #include <Kuesa/private/kuesa_global_p.h>
 #include <Kuesa/private/kuesa_utils_p.h>
+#include <Kuesa/private/boundingvolumehierarchy_p.h>
+#include <Qt3DCore/QTransform>
+#include <Qt3DCore/private/qnode_p.h>
 #include <Qt3DRender/QGeometryRenderer>
+#include <Qt3DRender/QCamera>
+#include <Qt3DRender/QCameraLens>
 #include <Kuesa/GLTF2Material>
 #include <Kuesa/GLTF2MaterialEffect>
 #include <stdio.h>
@@ -73,6 +78,12 @@ namespace Kuesa {
     GPU dependent. For simple meshes, this can easily be thousands of
     instances.
 
+    When \l {Kuesa::MeshInstantiator::instanceCulling} is enabled and a
+    \l {Kuesa::MeshInstantiator::camera} is set, instances are indexed in a
+    bounding volume hierarchy and culled on the CPU against the camera
+    frustum. Only the transformations of the visible instances are then
+    uploaded to the GPU.
+
     \note For the instances to be visible, you should ensure that either
     frustum culling is disabled or that the initial instances (the mesh with no
     transformation applies) fit within the view frustum. Furthermore care needs
@@ -95,6 +106,47 @@ namespace Kuesa {
     It will be at least 1 even if no transformation matrices were provided.
 */
 
+/*!
+    \property MeshInstantiator::visibleCount
+    \readonly
+    \since Kuesa 1.4
+
+    The number of instances that survived instance culling and whose
+    transformations were uploaded. This is equal to count when instance
+    culling is disabled.
+*/
+
+/*!
+    \property MeshInstantiator::camera
+    \since Kuesa 1.4
+
+    The camera entity against which the instances are culled when
+    instanceCulling is enabled. The entity is expected to hold a
+    Qt3DRender::QCameraLens and a Qt3DCore::QTransform component, as is the
+    case for Qt3DRender::QCamera.
+*/
+
+/*!
+    \property MeshInstantiator::instanceCulling
+    \since Kuesa 1.4
+
+    When true and a camera is set, instances lying outside of the camera
+    frustum are not uploaded nor drawn. The bounds of each instance are
+    computed from the extents of the instantiated geometries. Defaults to
+    false.
+*/
+
+/*!
+    \property MeshInstantiator::instanceTransform
+    \since Kuesa 1.4
+
+    An optional transformation applied to every instance before its own
+    transformation matrix. Animating this transform, for instance with a
+    single AnimationPlayer, animates all the instances at the cost of one
+    animation evaluation and one upload of the transformation buffer per
+    frame.
+*/
+
 /*!
     \qmltype MeshInstantiator
     \instantiates Kuesa::MeshInstantiator
@@ -143,10 +195,48 @@ namespace Kuesa {
     transformation matrices were provided.
 */
 
+/*!
+    \qmlproperty int MeshInstantiator::visibleCount
+    \readonly
+    \since Kuesa 1.4
+
+    The number of instances that survived instance culling and whose
+    transformations were uploaded. This is equal to count when instance
+    culling is disabled.
+*/
+
+/*!
+    \qmlproperty Entity MeshInstantiator::camera
+    \since Kuesa 1.4
+
+    The camera entity against which the instances are culled when
+    instanceCulling is enabled.
+*/
+
+/*!
+    \qmlproperty bool MeshInstantiator::instanceCulling
+    \since Kuesa 1.4
+
+    When true and a camera is set, instances lying outside of the camera
+    frustum are not uploaded nor drawn. Defaults to false.
+*/
+
+/*!
+    \qmlproperty Transform MeshInstantiator::instanceTransform
+    \since Kuesa 1.4
+
+    An optional transformation applied to every instance before its own
+    transformation matrix. Animating this transform, for instance with a
+    single AnimationPlayer, animates all the instances at the cost of one
+    animation evaluation and one upload of the transformation buffer per
+    frame.
+*/
+
 MeshInstantiator::MeshInstantiator(Qt3DCore::QNode *parent)
     : KuesaNode(parent)
     , m_transformationsBuffer(new Qt3DGeometry::QBuffer(this))
     , m_perInstanceTransformationAttribute(new Qt3DGeometry::QAttribute(this))
+    , m_instanceBVH(new BoundingVolumeHierarchy)
 {
     QObject::connect(this, &KuesaNode::sceneEntityChanged,
                      this, [this] {
@@ -167,11 +257,86 @@ MeshInstantiator::MeshInstantiator(Qt3DCore::QNode *parent)
     updateTransformBuffer();
 }
 
+MeshInstantiator::~MeshInstantiator()
+{
+    for (const auto &c : m_cameraConnections)
+        disconnect(c);
+    for (const auto &c : m_boundsConnections)
+        disconnect(c);
+    for (const auto &c : m_geometryConnections)
+        disconnect(c);
+    disconnect(m_instanceTransformConnection);
+}
+
 int MeshInstantiator::count() const
 {
     return int(std::max(m_transformations.size(), size_t(1)));
 }
 
+int MeshInstantiator::visibleCount() const
+{
+    return int(m_visibleCount);
+}
+
+void MeshInstantiator::setCamera(Qt3DCore::QEntity *camera)
+{
+    if (camera == m_camera)
+        return;
+
+    auto d = Qt3DCore::QNodePrivate::get(this);
+    if (m_camera)
+        d->unregisterDestructionHelper(m_camera);
+    for (const auto &c : m_cameraConnections)
+        disconnect(c);
+    m_cameraConnections.clear();
+
+    m_camera = camera;
+
+    if (m_camera) {
+        d->registerDestructionHelper(m_camera, &MeshInstantiator::setCamera, m_camera);
+
+        Qt3DRender::QCamera *qcamera = qobject_cast<Qt3DRender::QCamera *>(m_camera);
+        if (qcamera) {
+            m_cameraConnections.push_back(connect(qcamera, &Qt3DRender::QCamera::viewMatrixChanged,
+                                                  this, &MeshInstantiator::scheduleCulling));
+            m_cameraConnections.push_back(connect(qcamera, &Qt3DRender::QCamera::projectionMatrixChanged,
+                                                  this, &MeshInstantiator::scheduleCulling));
+        } else {
+            Qt3DRender::QCameraLens *lens = componentFromEntity<Qt3DRender::QCameraLens>(m_camera);
+            Qt3DCore::QTransform *transform = componentFromEntity<Qt3DCore::QTransform>(m_camera);
+            if (lens)
+                m_cameraConnections.push_back(connect(lens, &Qt3DRender::QCameraLens::projectionMatrixChanged,
+                                                      this, &MeshInstantiator::scheduleCulling));
+            if (transform)
+                m_cameraConnections.push_back(connect(transform, &Qt3DCore::QTransform::worldMatrixChanged,
+                                                      this, &MeshInstantiator::scheduleCulling));
+        }
+    }
+
+    emit cameraChanged(m_camera);
+    scheduleCulling();
+}
+
+Qt3DCore::QEntity *MeshInstantiator::camera() const
+{
+    return m_camera;
+}
+
+void MeshInstantiator::setInstanceCulling(bool instanceCulling)
+{
+    if (instanceCulling == m_instanceCulling)
+        return;
+    m_instanceCulling = instanceCulling;
+    emit instanceCullingChanged(m_instanceCulling);
+    updateInstanceBounds();
+    updateTransformBuffer();
+}
+
+bool MeshInstantiator::instanceCulling() const
+{
+    return m_instanceCulling;
+}
+
 void MeshInstantiator::setEntityName(const QString &entityName)
 {
     if (entityName == m_entityName)
@@ -186,6 +351,34 @@ QString MeshInstantiator::entityName() const
     return m_entityName;
 }
 
+void MeshInstantiator::setInstanceTransform(Qt3DCore::QTransform *instanceTransform)
+{
+    if (instanceTransform == m_instanceTransform)
+        return;
+
+    auto d = Qt3DCore::QNodePrivate::get(this);
+    if (m_instanceTransform)
+        d->unregisterDestructionHelper(m_instanceTransform);
+    disconnect(m_instanceTransformConnection);
+
+    m_instanceTransform = instanceTransform;
+
+    if (m_instanceTransform) {
+        d->registerDestructionHelper(m_instanceTransform, &MeshInstantiator::setInstanceTransform, m_instanceTransform);
+        m_instanceTransformConnection = connect(m_instanceTransform, &Qt3DCore::QTransform::matrixChanged,
+                                                this, &MeshInstantiator::scheduleTransformUpdate);
+    }
+
+    emit instanceTransformChanged(m_instanceTransform);
+    updateInstanceBounds();
+    updateTransformBuffer();
+}
+
+Qt3DCore::QTransform *MeshInstantiator::instanceTransform() const
+{
+    return m_instanceTransform;
+}
+
 /*!
     Set the transformation matrices \a transformationMatrices to be associated
     and applied to the instances.
@@ -194,9 +387,13 @@ void MeshInstantiator::setTransformationMatrices(const std::vector<QMatrix4x4> &
 {
     if (transformationMatrices == m_transformations)
         return;
+    const int oldCount = count();
     m_transformations = transformationMatrices;
     emit transformationMatricesChanged(m_transformations);
+    updateInstanceBounds();
     updateTransformBuffer();
+    if (oldCount != count())
+        emit countChanged(count());
 }
 
 /*!
@@ -209,36 +406,206 @@ const std::vector<QMatrix4x4> &MeshInstantiator::transformationMatrices() const
 
 void MeshInstantiator::updateTransformBuffer()
 {
-    const std::vector<QMatrix4x4> &matrices = m_transformations.empty() ? std::vector<QMatrix4x4>({ QMatrix4x4() }) : m_transformations;
+    static const QMatrix4x4 identity;
+    std::vector<const QMatrix4x4 *> matrices;
+
+    if (m_transformations.empty()) {
+        matrices.push_back(&identity);
+    } else if (!isCullingActive()) {
+        matrices.reserve(m_transformations.size());
+        for (const QMatrix4x4 &m : m_transformations)
+            matrices.push_back(&m);
+    } else {
+        Qt3DRender::QCamera *qcamera = qobject_cast<Qt3DRender::QCamera *>(m_camera);
+        Qt3DRender::QCameraLens *lens = componentFromEntity<Qt3DRender::QCameraLens>(m_camera);
+        Qt3DCore::QTransform *transform = componentFromEntity<Qt3DCore::QTransform>(m_camera);
+        const QMatrix4x4 viewMatrix = qcamera ? qcamera->viewMatrix()
+                                              : (transform ? transform->worldMatrix().inverted() : QMatrix4x4());
+        const QMatrix4x4 projectionMatrix = lens ? lens->projectionMatrix() : QMatrix4x4();
+
+        m_visibleInstances.clear();
+        m_instanceBVH->query(Frustum::fromViewProjection(projectionMatrix * viewMatrix), m_visibleInstances);
+        // Preserve the user provided instance order
+        std::sort(m_visibleInstances.begin(), m_visibleInstances.end());
+
+        matrices.reserve(m_visibleInstances.size());
+        for (const quintptr instanceIdx : m_visibleInstances)
+            matrices.push_back(&m_transformations[instanceIdx]);
+    }
 
     QByteArray rawData;
     rawData.resize(16 * sizeof(float) * matrices.size());
 
+    const QMatrix4x4 instanceMatrix = m_instanceTransform ? m_instanceTransform->matrix() : QMatrix4x4();
+    const bool hasInstanceMatrix = !instanceMatrix.isIdentity();
+
     // Note sizeof(QMatrix4x4) != 16 * sizeof(float)
     size_t offset = 0;
-    for (const QMatrix4x4 &m : matrices) {
+    for (const QMatrix4x4 *m : matrices) {
         // QMatrix4x4::constData is in column major order which is what we want
-        memcpy(rawData.data() + offset, m.constData(), 16 * sizeof(float));
+        if (hasInstanceMatrix) {
+            const QMatrix4x4 transformed = *m * instanceMatrix;
+            memcpy(rawData.data() + offset, transformed.constData(), 16 * sizeof(float));
+        } else {
+            memcpy(rawData.data() + offset, m->constData(), 16 * sizeof(float));
+        }
         offset += 16 * sizeof(float);
     }
 
     m_perInstanceTransformationAttribute->setCount(matrices.size());
     m_transformationsBuffer->setData(rawData);
 
+    if (m_visibleCount != matrices.size()) {
+        m_visibleCount = matrices.size();
+        emit visibleCountChanged(int(m_visibleCount));
+    }
+
     update();
 }
 
+bool MeshInstantiator::isCullingActive() const
+{
+    return m_instanceCulling && m_camera != nullptr && m_hasLocalBounds;
+}
+
+void MeshInstantiator::scheduleCulling()
+{
+    if (m_cullingScheduled || !m_instanceCulling)
+        return;
+    m_cullingScheduled = true;
+    QMetaObject::invokeMethod(this, "cullInstances", Qt::QueuedConnection);
+}
+
+void MeshInstantiator::cullInstances()
+{
+    m_cullingScheduled = false;
+    updateTransformBuffer();
+}
+
+// The instance transform usually changes component by component, the buffer
+// is only rebuilt once all of them have been set
+void MeshInstantiator::scheduleTransformUpdate()
+{
+    if (m_transformUpdateScheduled)
+        return;
+    m_transformUpdateScheduled = true;
+    QMetaObject::invokeMethod(this, "applyInstanceTransform", Qt::QueuedConnection);
+}
+
+void MeshInstantiator::applyInstanceTransform()
+{
+    m_transformUpdateScheduled = false;
+    updateInstanceBounds();
+    updateTransformBuffer();
+}
+
+// Computes the union of the world bounds of the instantiated geometries.
+// Instance transformations are applied on top of the geometries' own model
+// matrix, so instance bounds are derived from these.
+void MeshInstantiator::updateLocalBounds()
+{
+    for (const auto &c : m_boundsConnections)
+        disconnect(c);
+    m_boundsConnections.clear();
+
+    AxisAlignedBox bounds;
+    if (m_entity != nullptr) {
+        for (QObject *c : m_entity->children()) {
+            Qt3DCore::QEntity *e = qobject_cast<Qt3DCore::QEntity *>(c);
+            if (e == nullptr)
+                continue;
+
+            Qt3DRender::QGeometryRenderer *r = componentFromEntity<Qt3DRender::QGeometryRenderer>(e);
+            if (r == nullptr || r->geometry() == nullptr)
+                continue;
+
+            Qt3DGeometry::QGeometry *geometry = r->geometry();
+            const auto onBoundsChanged = [this] {
+                updateLocalBounds();
+                updateInstanceBounds();
+                scheduleCulling();
+            };
+            m_boundsConnections.push_back(connect(geometry, &Qt3DGeometry::QGeometry::minExtentChanged, this, onBoundsChanged));
+            m_boundsConnections.push_back(connect(geometry, &Qt3DGeometry::QGeometry::maxExtentChanged, this, onBoundsChanged));
+
+            const AxisAlignedBox geometryBounds(geometry->minExtent(), geometry->maxExtent());
+            if (!geometryBounds.isValid() || geometryBounds.min == geometryBounds.max)
+                continue;
+
+            QMatrix4x4 modelMatrix;
+            for (Qt3DCore::QEntity *p = e; p != nullptr; p = p->parentEntity()) {
+                Qt3DCore::QTransform *t = componentFromEntity<Qt3DCore::QTransform>(p);
+                if (t) {
+                    modelMatrix = t->worldMatrix();
+                    m_boundsConnections.push_back(connect(t, &Qt3DCore::QTransform::worldMatrixChanged, this, onBoundsChanged));
+                    break;
+                }
+            }
+            bounds.expandToContain(geometryBounds.transformed(modelMatrix));
+        }
+    }
+
+    m_hasLocalBounds = bounds.isValid();
+    m_localMinExtent = bounds.min;
+    m_localMaxExtent = bounds.max;
+}
+
+// Synchronizes the instance BVH with the instance transformations. Proxies are
+// updated in place and are only reinserted when they leave their fattened
+// bounds, which keeps the cost proportional to the instances that moved.
+void MeshInstantiator::updateInstanceBounds()
+{
+    if (!m_instanceCulling || !m_hasLocalBounds) {
+        m_instanceBVH->clear();
+        m_instanceProxies.clear();
+        return;
+    }
+
+    while (m_instanceProxies.size() > m_transformations.size()) {
+        m_instanceBVH->remove(m_instanceProxies.back());
+        m_instanceProxies.pop_back();
+    }
+
+    AxisAlignedBox localBounds(m_localMinExtent, m_localMaxExtent);
+    if (m_instanceTransform)
+        localBounds = localBounds.transformed(m_instanceTransform->matrix());
+    for (size_t i = 0, m = m_transformations.size(); i < m; ++i) {
+        const AxisAlignedBox instanceBounds = localBounds.transformed(m_transformations[i]);
+        if (i < m_instanceProxies.size())
+            m_instanceBVH->update(m_instanceProxies[i], instanceBounds);
+        else
+            m_instanceProxies.push_back(m_instanceBVH->insert(instanceBounds, quintptr(i)));
+    }
+}
+
+void MeshInstantiator::addInstanceAttribute(Qt3DGeometry::QGeometry *geometry)
+{
+    if (geometry == nullptr)
+        return;
+
+    const auto &attrs = geometry->attributes();
+    auto it = std::find_if(attrs.cbegin(),
+                           attrs.cend(), [](const Qt3DGeometry::QAttribute *attr) {
+                               return attr->name() == QStringLiteral("perInstanceTransform");
+                           });
+    if (it == attrs.end())
+        geometry->addAttribute(m_perInstanceTransformationAttribute);
+}
+
 void MeshInstantiator::update()
 {
     Qt3DCore::QEntity *meshEntity = m_sceneEntity ? m_sceneEntity->entity(m_entityName) : nullptr;
     const bool entityChanged = meshEntity != m_entity;
-    const size_t instanceCount = std::max(m_transformations.size(), size_t(1));
+    const size_t instanceCount = m_visibleCount;
 
     // Handle change of Entity
     if (entityChanged) {
 
         if (m_entity)
             disconnect(m_entity);
+        for (const auto &c : m_geometryConnections)
+            disconnect(c);
+        m_geometryConnections.clear();
 
         m_entity = meshEntity;
 
@@ -266,18 +633,24 @@ void MeshInstantiator::update()
                 if (!effect->isInstanced())
                     effect->setInstanced(true);
 
-                if (r->geometry()) {
-                    const auto &attrs = r->geometry()->attributes();
-                    auto it = std::find_if(attrs.cbegin(),
-                                           attrs.cend(), [](const Qt3DGeometry::QAttribute *attr) {
-                                               return attr->name() == QStringLiteral("perInstanceTransform");
-                                           });
-                    if (it == attrs.end())
-                        r->geometry()->addAttribute(m_perInstanceTransformationAttribute);
-                }
+                addInstanceAttribute(r->geometry());
                 r->setInstanceCount(instanceCount);
+
+                // The LevelOfDetailSelector swaps the renderer's geometry,
+                // each level needs the instance attribute too
+                m_geometryConnections.push_back(connect(r, &Qt3DRender::QGeometryRenderer::geometryChanged,
+                                                        this, [this](Qt3DGeometry::QGeometry *geometry) {
+                                                            addInstanceAttribute(geometry);
+                                                            updateLocalBounds();
+                                                            updateInstanceBounds();
+                                                            scheduleCulling();
+                                                        }));
             }
         }
+
+        updateLocalBounds();
+        updateInstanceBounds();
+        scheduleCulling();
     }
 
     // Handle instance count change
@@ -297,8 +670,7 @@ void MeshInstantiator::update()
         }
     }
 
-    if (instanceCountHasChanged)
-        emit countChanged(instanceCount);
+    m_instanceCount = instanceCount;
 }
 
 } // namespace Kuesa
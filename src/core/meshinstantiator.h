@@ -32,6 +32,8 @@
 #include <Kuesa/kuesa_global.h>
 #include <Kuesa/KuesaNode>
 #include <QMetaObject>
+#include <QVector3D>
+#include <memory>
 
 QT_BEGIN_NAMESPACE
 
@@ -44,20 +46,41 @@ namespace Qt3DRender {
 #endif
 class QAttribute;
 class QBuffer;
+class QGeometry;
+}
+
+namespace Qt3DCore {
+class QTransform;
 }
 
 namespace Kuesa {
 
+class BoundingVolumeHierarchy;
+
 class KUESASHARED_EXPORT MeshInstantiator : public KuesaNode
 {
     Q_OBJECT
     Q_PROPERTY(QString entityName READ entityName WRITE setEntityName NOTIFY entityNameChanged)
     Q_PROPERTY(int count READ count NOTIFY countChanged)
+    Q_PROPERTY(int visibleCount READ visibleCount NOTIFY visibleCountChanged)
+    Q_PROPERTY(Qt3DCore::QEntity *camera READ camera WRITE setCamera NOTIFY cameraChanged)
+    Q_PROPERTY(bool instanceCulling READ instanceCulling WRITE setInstanceCulling NOTIFY instanceCullingChanged)
+    Q_PROPERTY(Qt3DCore::QTransform *instanceTransform READ instanceTransform WRITE setInstanceTransform NOTIFY instanceTransformChanged)
 public:
     explicit MeshInstantiator(Qt3DCore::QNode *parent = nullptr);
-    ~MeshInstantiator() = default;
+    ~MeshInstantiator();
 
     int count() const;
+    int visibleCount() const;
+
+    void setCamera(Qt3DCore::QEntity *camera);
+    Qt3DCore::QEntity *camera() const;
+
+    void setInstanceCulling(bool instanceCulling);
+    bool instanceCulling() const;
+
+    void setInstanceTransform(Qt3DCore::QTransform *instanceTransform);
+    Qt3DCore::QTransform *instanceTransform() const;
 
     void setEntityName(const QString &entityName);
     QString entityName() const;
@@ -69,10 +92,22 @@ Q_SIGNALS:
     void countChanged(int count);
     void transformationMatricesChanged(const std::vector<QMatrix4x4> &transformationMatrices);
     void entityNameChanged(const QString &entityName);
+    void visibleCountChanged(int visibleCount);
+    void cameraChanged(Qt3DCore::QEntity *camera);
+    void instanceCullingChanged(bool instanceCulling);
+    void instanceTransformChanged(Qt3DCore::QTransform *instanceTransform);
 
 private:
     void updateTransformBuffer();
     void update();
+    void addInstanceAttribute(Qt3DGeometry::QGeometry *geometry);
+    void updateLocalBounds();
+    void updateInstanceBounds();
+    void scheduleCulling();
+    bool isCullingActive() const;
+    Q_INVOKABLE void cullInstances();
+    void scheduleTransformUpdate();
+    Q_INVOKABLE void applyInstanceTransform();
 
     std::vector<QMatrix4x4> m_transformations;
     QString m_entityName;
@@ -80,7 +115,27 @@ private:
     Qt3DGeometry::QBuffer *m_transformationsBuffer = nullptr;
     Qt3DGeometry::QAttribute *m_perInstanceTransformationAttribute = nullptr;
     Qt3DCore::QEntity *m_entity = nullptr;
+    std::vector<QMetaObject::Connection> m_geometryConnections;
     size_t m_instanceCount = 1;
+
+    // Instance culling
+    Qt3DCore::QEntity *m_camera = nullptr;
+    std::vector<QMetaObject::Connection> m_cameraConnections;
+    std::vector<QMetaObject::Connection> m_boundsConnections;
+    std::unique_ptr<BoundingVolumeHierarchy> m_instanceBVH;
+    std::vector<int> m_instanceProxies;
+    std::vector<quintptr> m_visibleInstances;
+    QVector3D m_localMinExtent;
+    QVector3D m_localMaxExtent;
+    size_t m_visibleCount = 1;
+    bool m_hasLocalBounds = false;
+    bool m_instanceCulling = false;
+    bool m_cullingScheduled = false;
+
+    // Animated transformation shared by all instances
+    Qt3DCore::QTransform *m_instanceTransform = nullptr;
+    QMetaObject::Connection m_instanceTransformConnection;
+    bool m_transformUpdateScheduled = false;
 };
 
 } // namespace Kuesa
@@ -41,8 +41,11 @@ namespace Kuesa {
     \since Kuesa 1.1
 
     \brief Kuesa::MorphController allows to control the morph target weights of
-    an entity. Though the glTF 2.0 specifications do not impose a limit on the
-    number of weights, we have limited it to 8.
+    an entity.
+
+    The first 8 weights are exposed as individual properties. Meshes with more
+    morph targets use the packed morph target mode of the glTF importer, their
+    weights are accessed with weight(), setWeight() and setWeights().
 
     The weight values are set to 0.0f by default.
 
@@ -111,6 +114,32 @@ namespace Kuesa {
     Used by the animation aspect to set all weights at once.
  */
 
+/*!
+    \fn float MorphController::weight(int index) const
+
+    Returns the weight value at \a index or 0.0f if \a index is out of range.
+ */
+
+/*!
+    \fn void MorphController::setWeight(int index, float weight)
+
+    Sets the weight value at \a index to \a weight.
+ */
+
+/*!
+    \fn QVector<float> MorphController::weights() const
+
+    Returns the count weight values handled by the controller.
+ */
+
+/*!
+    \fn void MorphController::setWeights(const QVector<float> &weights)
+
+    Sets all \a weights at once. Unlike setting weights one by one,
+    morphWeightsChanged() is only emitted once, which allows consumers to
+    update once for the whole batch of changes.
+ */
+
 /*!
     \qmltype MorphController
     \instantiates Kuesa::MorphController
@@ -119,8 +148,11 @@ namespace Kuesa {
     \since Kuesa 1.1
 
     \brief Kuesa::MorphController allows to control the morph target weights of
-    an entity. Though the glTF 2.0 specifications do not impose a limit on the
-    number of weights, we have limited it to 8.
+    an entity.
+
+    The first 8 weights are exposed as individual properties. Meshes with more
+    morph targets use the packed morph target mode of the glTF importer, their
+    weights are accessed with weight() and setWeight().
 
     The weight values are set to 0.0f by default.
 
@@ -189,12 +221,24 @@ namespace Kuesa {
     Used by the animation aspect to set all weights at once.
  */
 
+/*!
+    \qmlmethod real MorphController::weight(int index)
+
+    Returns the weight value at \a index.
+ */
+
+/*!
+    \qmlmethod void MorphController::setWeight(int index, real weight)
+
+    Sets the weight value at \a index to \a weight.
+ */
+
 MorphController::MorphController(Qt3DCore::QNode *parent)
     : Qt3DRender::QShaderData(parent)
+    , m_weights(8, 0.0f)
     , m_count(0)
     , m_shouldEmitMorphWeights(true)
 {
-    std::fill(std::begin(m_weights), std::end(m_weights), 0.0f);
 
     auto shouldEmitMorphWeightsChanged = [this]() {
         if (m_shouldEmitMorphWeights)
@@ -268,6 +312,18 @@ int MorphController::count() const
     return m_count;
 }
 
+QVector<float> MorphController::weights() const
+{
+    return m_weights.mid(0, m_count);
+}
+
+float MorphController::weight(int index) const
+{
+    if (index < 0 || index >= m_weights.size())
+        return 0.0f;
+    return m_weights.at(index);
+}
+
 QVariantList MorphController::morphWeights() const
 {
     QVariantList weights;
@@ -345,17 +401,18 @@ void MorphController::setWeight7(float weight7)
 
 void MorphController::setCount(int count)
 {
-    Q_ASSERT(count <= 8);
     if (count == m_count)
         return;
     m_count = count;
+    // The first 8 weights always exist as they are exposed as properties
+    m_weights.resize(std::max(m_count, 8));
     emit countChanged(count);
 }
 
-void MorphController::setMorphWeights(const QVariantList &morphWeights)
+void MorphController::setWeight(int index, float weight)
 {
     using WeightSetterFunc = void (MorphController::*)(float);
-    const WeightSetterFunc weightSetterFuncs[]{
+    static const WeightSetterFunc weightSetterFuncs[]{
         &MorphController::setWeight0,
         &MorphController::setWeight1,
         &MorphController::setWeight2,
@@ -366,12 +423,41 @@ void MorphController::setMorphWeights(const QVariantList &morphWeights)
         &MorphController::setWeight7,
     };
 
-    m_shouldEmitMorphWeights = false;
-    for (int i = 0, m = std::min(int(morphWeights.size()), m_count); i < m; ++i) {
-        const float w = morphWeights.at(i).toFloat();
-        (this->*weightSetterFuncs[i])(w);
+    if (index < 0 || index >= m_weights.size())
+        return;
+
+    if (index < 8) {
+        (this->*weightSetterFuncs[index])(weight);
+        return;
     }
 
+    if (weight == m_weights[index])
+        return;
+    m_weights[index] = weight;
+    if (m_shouldEmitMorphWeights)
+        emit morphWeightsChanged();
+}
+
+void MorphController::setWeights(const QVector<float> &weights)
+{
+    const int m = std::min(int(weights.size()), m_count);
+    if (std::equal(weights.cbegin(), weights.cbegin() + m, m_weights.cbegin()))
+        return;
+
+    m_shouldEmitMorphWeights = false;
+    for (int i = 0; i < m; ++i)
+        setWeight(i, weights.at(i));
+
+    emit morphWeightsChanged();
+    m_shouldEmitMorphWeights = true;
+}
+
+void MorphController::setMorphWeights(const QVariantList &morphWeights)
+{
+    m_shouldEmitMorphWeights = false;
+    for (int i = 0, m = std::min(int(morphWeights.size()), m_count); i < m; ++i)
+        setWeight(i, morphWeights.at(i).toFloat());
+
     emit morphWeightsChanged();
     m_shouldEmitMorphWeights = true;
 }
@@ -33,6 +33,7 @@
 #include <Qt3DRender/QShaderData>
 #include <Kuesa/kuesa_global.h>
 #include <QtCore/QVariant>
+#include <QtCore/QVector>
 
 QT_BEGIN_NAMESPACE
 
@@ -66,6 +67,8 @@ public:
     float weight7() const;
     int count() const;
     QVariantList morphWeights() const;
+    QVector<float> weights() const;
+    Q_INVOKABLE float weight(int index) const;
 
     void setWeight0(float weight0);
     void setWeight1(float weight1);
@@ -77,6 +80,8 @@ public:
     void setWeight7(float weight7);
     void setCount(int count);
     void setMorphWeights(const QVariantList &weights);
+    void setWeights(const QVector<float> &weights);
+    Q_INVOKABLE void setWeight(int index, float weight);
 
 Q_SIGNALS:
     void weight0Changed(float weight0);
@@ -91,7 +96,7 @@ Q_SIGNALS:
     void morphWeightsChanged();
 
 private:
-    float m_weights[8];
+    QVector<float> m_weights;
     int m_count;
     bool m_shouldEmitMorphWeights;
 };
@@ -0,0 +1,293 @@
+/*
+    morphtargetblender.cpp
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "morphtargetblender_p.h"
+#include "morphcontroller.h"
+#include <Qt3DRender/QGeometryRenderer>
+
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+#include <Qt3DCore/QGeometry>
+#include <Qt3DCore/QAttribute>
+#include <Qt3DCore/private/qgeometry_p.h>
+#else
+#include <Qt3DRender/QGeometry>
+#include <Qt3DRender/QAttribute>
+#include <Qt3DRender/private/qgeometry_p.h>
+#endif
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+QT_BEGIN_NAMESPACE
+
+namespace Kuesa {
+
+namespace {
+
+bool readFloatAttribute(const Qt3DGeometry::QAttribute *attribute, std::vector<float> &data)
+{
+    if (attribute == nullptr || attribute->buffer() == nullptr ||
+        attribute->vertexBaseType() != Qt3DGeometry::QAttribute::Float ||
+        attribute->vertexSize() < 3 || attribute->count() == 0)
+        return false;
+
+    const QByteArray rawData = attribute->buffer()->data();
+    const size_t count = attribute->count();
+    const size_t componentCount = attribute->vertexSize();
+    const size_t elementSize = componentCount * sizeof(float);
+    const size_t byteOffset = attribute->byteOffset();
+    const size_t byteStride = attribute->byteStride() > 0 ? attribute->byteStride() : elementSize;
+
+    if (byteOffset + (count - 1) * byteStride + elementSize > size_t(rawData.size()))
+        return false;
+
+    data.resize(count * componentCount);
+    const char *src = rawData.constData() + byteOffset;
+    for (size_t i = 0; i < count; ++i)
+        std::memcpy(data.data() + i * componentCount, src + i * byteStride, elementSize);
+    return true;
+}
+
+// Blends between two rebuilds of the accumulation buffers
+constexpr int MaxIncrementalBlends = 256;
+
+void normalize(float *v)
+{
+    const float length = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+    if (length > 0.0f) {
+        v[0] /= length;
+        v[1] /= length;
+        v[2] /= length;
+    }
+}
+
+PackedMorphTargets::Channel channelForAttribute(const QString &name, bool *ok)
+{
+    *ok = true;
+    if (name == Qt3DGeometry::QAttribute::defaultPositionAttributeName())
+        return PackedMorphTargets::Position;
+    if (name == Qt3DGeometry::QAttribute::defaultNormalAttributeName())
+        return PackedMorphTargets::Normal;
+    if (name == Qt3DGeometry::QAttribute::defaultTangentAttributeName())
+        return PackedMorphTargets::Tangent;
+    *ok = false;
+    return PackedMorphTargets::ChannelCount;
+}
+
+} // namespace
+
+MorphTargetBlender::MorphTargetBlender(const PackedMorphTargetsPtr &morphTargets, QObject *parent)
+    : QObject(parent)
+    , m_morphTargets(morphTargets)
+{
+}
+
+void MorphTargetBlender::setBaseData(PackedMorphTargets::Channel channel, const std::vector<float> &baseData,
+                                     int componentCount, Qt3DGeometry::QBuffer *output)
+{
+    ChannelData &data = m_channels[channel];
+    data.baseData = baseData;
+    data.componentCount = componentCount;
+    data.output = output;
+    m_dirty = true;
+    scheduleBlend();
+}
+
+void MorphTargetBlender::setMorphController(MorphController *controller)
+{
+    if (controller == m_controller)
+        return;
+
+    disconnect(m_controllerConnection);
+    m_controller = controller;
+    if (m_controller)
+        m_controllerConnection = connect(m_controller, &MorphController::morphWeightsChanged,
+                                         this, &MorphTargetBlender::scheduleBlend);
+    m_dirty = true;
+    scheduleBlend();
+}
+
+void MorphTargetBlender::scheduleBlend()
+{
+    if (m_blendScheduled)
+        return;
+    m_blendScheduled = true;
+    QMetaObject::invokeMethod(this, "blend", Qt::QueuedConnection);
+}
+
+void MorphTargetBlender::blend()
+{
+    m_blendScheduled = false;
+    if (!m_morphTargets)
+        return;
+
+    const QVector<float> weights = m_controller ? m_controller->weights() : QVector<float>();
+    if (!m_dirty && weights == m_blendedWeights)
+        return;
+
+    // Rounding errors pile up in the accumulation buffers, they are rebuilt
+    // from the base data every so often
+    const bool rebuild = m_dirty || m_incrementalBlendCount >= MaxIncrementalBlends;
+
+    std::vector<float> weightDeltas;
+    if (!rebuild) {
+        weightDeltas.resize(size_t(std::max(weights.size(), m_blendedWeights.size())), 0.0f);
+        for (int t = 0, m = int(weightDeltas.size()); t < m; ++t) {
+            const float weight = t < weights.size() ? weights[t] : 0.0f;
+            const float blendedWeight = t < m_blendedWeights.size() ? m_blendedWeights[t] : 0.0f;
+            weightDeltas[size_t(t)] = weight - blendedWeight;
+        }
+    }
+
+    m_evaluatedTargetCount = 0;
+    for (int c = 0; c < PackedMorphTargets::ChannelCount; ++c) {
+        ChannelData &channel = m_channels[c];
+        if (channel.output.isNull() || channel.baseData.empty())
+            continue;
+
+        if (rebuild) {
+            channel.accumulated = channel.baseData;
+            m_evaluatedTargetCount += m_morphTargets->accumulate(PackedMorphTargets::Channel(c),
+                                                                 weights.constData(), weights.size(),
+                                                                 channel.accumulated.data(), channel.componentCount);
+            upload(PackedMorphTargets::Channel(c), 0, int(channel.baseData.size()) / channel.componentCount - 1, true);
+            continue;
+        }
+
+        // Only the vertices moved by targets whose weight changed differ
+        // from what was last uploaded
+        int firstVertex = std::numeric_limits<int>::max();
+        int lastVertex = -1;
+        for (int t = 0, m = int(weightDeltas.size()); t < m; ++t) {
+            int first = 0;
+            int last = 0;
+            if (weightDeltas[size_t(t)] == 0.0f ||
+                !m_morphTargets->vertexSpan(t, PackedMorphTargets::Channel(c), &first, &last))
+                continue;
+            firstVertex = std::min(firstVertex, first);
+            lastVertex = std::max(lastVertex, last);
+        }
+        if (lastVertex < 0)
+            continue;
+
+        m_evaluatedTargetCount += m_morphTargets->accumulate(PackedMorphTargets::Channel(c),
+                                                             weightDeltas.data(), int(weightDeltas.size()),
+                                                             channel.accumulated.data(), channel.componentCount);
+        upload(PackedMorphTargets::Channel(c), firstVertex, lastVertex, false);
+    }
+
+    m_incrementalBlendCount = rebuild ? 0 : m_incrementalBlendCount + 1;
+    m_blendedWeights = weights;
+    m_dirty = false;
+    ++m_blendCount;
+}
+
+void MorphTargetBlender::upload(PackedMorphTargets::Channel channelId, int firstVertex, int lastVertex, bool wholeBuffer)
+{
+    const ChannelData &channel = m_channels[channelId];
+    const size_t offset = size_t(firstVertex) * size_t(channel.componentCount);
+    const size_t count = size_t(lastVertex - firstVertex + 1) * size_t(channel.componentCount);
+    QByteArray data(reinterpret_cast<const char *>(channel.accumulated.data() + offset),
+                    int(count * sizeof(float)));
+
+    // Normals and tangents are renormalized on the uploaded copy, the
+    // accumulation buffer keeps the plain sum of the deltas
+    if (channelId != PackedMorphTargets::Position) {
+        float *values = reinterpret_cast<float *>(data.data());
+        for (size_t i = 0; i < count; i += size_t(channel.componentCount))
+            normalize(values + i);
+    }
+
+    if (wholeBuffer)
+        channel.output->setData(data);
+    else
+        channel.output->updateData(int(offset * sizeof(float)), data);
+}
+
+Qt3DRender::QGeometryRenderer *MorphTargetBlender::createMorphedRenderer(Qt3DRender::QGeometryRenderer *source,
+                                                                         const PackedMorphTargetsPtr &morphTargets,
+                                                                         MorphController *controller)
+{
+    if (source == nullptr || source->geometry() == nullptr || !morphTargets)
+        return source;
+
+    Qt3DGeometry::QGeometry *sourceGeometry = source->geometry();
+
+    auto *renderer = new Qt3DRender::QGeometryRenderer;
+    renderer->setPrimitiveType(source->primitiveType());
+    renderer->setInstanceCount(source->instanceCount());
+    renderer->setVertexCount(source->vertexCount());
+    renderer->setIndexOffset(source->indexOffset());
+    renderer->setFirstInstance(source->firstInstance());
+    renderer->setFirstVertex(source->firstVertex());
+    renderer->setRestartIndexValue(source->restartIndexValue());
+    renderer->setVerticesPerPatch(source->verticesPerPatch());
+    renderer->setPrimitiveRestartEnabled(source->primitiveRestartEnabled());
+
+    auto *geometry = new Qt3DGeometry::QGeometry(renderer);
+    auto *blender = new MorphTargetBlender(morphTargets, geometry);
+
+    const QVector<Qt3DGeometry::QAttribute *> attributes = sourceGeometry->attributes();
+    for (Qt3DGeometry::QAttribute *attribute : attributes) {
+        bool isMorphable = false;
+        const PackedMorphTargets::Channel channel = channelForAttribute(attribute->name(), &isMorphable);
+        std::vector<float> baseData;
+        if (!isMorphable || !morphTargets->hasChannel(channel) ||
+            attribute->vertexSize() > 4 || !readFloatAttribute(attribute, baseData)) {
+            // Shared with the source geometry
+            geometry->addAttribute(attribute);
+            continue;
+        }
+
+        auto *buffer = new Qt3DGeometry::QBuffer(geometry);
+        auto *morphedAttribute = new Qt3DGeometry::QAttribute(buffer, attribute->name(), Qt3DGeometry::QAttribute::Float,
+                                                attribute->vertexSize(), attribute->count());
+        geometry->addAttribute(morphedAttribute);
+        blender->setBaseData(channel, baseData, int(attribute->vertexSize()), buffer);
+    }
+
+    // Bounds of the source geometry already account for the morph targets
+    auto *d = static_cast<Qt3DGeometry::QGeometryPrivate *>(Qt3DCore::QNodePrivate::get(geometry));
+    d->setExtent(sourceGeometry->minExtent(), sourceGeometry->maxExtent());
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+    renderer->setMinPoint(source->minPoint());
+    renderer->setMaxPoint(source->maxPoint());
+#endif
+
+    renderer->setGeometry(geometry);
+    blender->setMorphController(controller);
+    blender->blend();
+
+    return renderer;
+}
+
+} // namespace Kuesa
+
+QT_END_NAMESPACE
@@ -0,0 +1,125 @@
+/*
+    morphtargetblender_p.h
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef KUESA_MORPHTARGETBLENDER_P_H
+#define KUESA_MORPHTARGETBLENDER_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Kuesa API.  It exists for the convenience
+// of other Kuesa classes.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <Kuesa/private/kuesa_global_p.h>
+#include <Kuesa/private/packedmorphtargets_p.h>
+#include <QObject>
+#include <QPointer>
+#include <QVector>
+
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+#include <Qt3DCore/QBuffer>
+#else
+#include <Qt3DRender/QBuffer>
+#endif
+
+QT_BEGIN_NAMESPACE
+
+namespace Qt3DRender {
+class QGeometryRenderer;
+}
+
+namespace Kuesa {
+
+class MorphController;
+
+// Blends packed morph targets on the CPU into dedicated vertex buffers
+// whenever the weights of a MorphController change. Changes happening
+// within the same event loop iteration are blended and uploaded once. Only
+// the targets whose weight changed are blended, by the difference of their
+// weight, into a persistent accumulation buffer, and only the span of
+// vertices they move is uploaded. The vertex shaders are unchanged, so this
+// trades GPU work for CPU time and bus traffic: it suits many sparse targets
+// rather than dense targets animated every frame.
+class KUESA_PRIVATE_EXPORT MorphTargetBlender : public QObject
+{
+    Q_OBJECT
+public:
+    MorphTargetBlender(const PackedMorphTargetsPtr &morphTargets, QObject *parent = nullptr);
+
+    void setBaseData(PackedMorphTargets::Channel channel, const std::vector<float> &baseData,
+                     int componentCount, Qt3DGeometry::QBuffer *output);
+    void setMorphController(MorphController *controller);
+
+    int blendCount() const { return m_blendCount; }
+    int evaluatedTargetCount() const { return m_evaluatedTargetCount; }
+
+    // Creates a renderer drawing the geometry of source with the morph
+    // targets blended with the weights of controller. Attributes that aren't
+    // morphed are shared with source.
+    static Qt3DRender::QGeometryRenderer *createMorphedRenderer(Qt3DRender::QGeometryRenderer *source,
+                                                                const PackedMorphTargetsPtr &morphTargets,
+                                                                MorphController *controller);
+
+public Q_SLOTS:
+    void blend();
+
+private:
+    void scheduleBlend();
+
+    struct ChannelData {
+        std::vector<float> baseData;
+        // Base data with the deltas of all the targets blended in
+        std::vector<float> accumulated;
+        int componentCount = 0;
+        QPointer<Qt3DGeometry::QBuffer> output;
+    };
+
+    void upload(PackedMorphTargets::Channel channel, int firstVertex, int lastVertex, bool wholeBuffer);
+
+    PackedMorphTargetsPtr m_morphTargets;
+    ChannelData m_channels[PackedMorphTargets::ChannelCount];
+    QPointer<MorphController> m_controller;
+    QMetaObject::Connection m_controllerConnection;
+    QVector<float> m_blendedWeights;
+    int m_blendCount = 0;
+    int m_evaluatedTargetCount = 0;
+    int m_incrementalBlendCount = 0;
+    bool m_blendScheduled = false;
+    bool m_dirty = true;
+};
+
+} // namespace Kuesa
+
+QT_END_NAMESPACE
+
+#endif // KUESA_MORPHTARGETBLENDER_P_H
@@ -0,0 +1,122 @@
+/*
+    packedmorphtargets.cpp
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "packedmorphtargets_p.h"
+#include <algorithm>
+#include <cmath>
+
+QT_BEGIN_NAMESPACE
+
+namespace Kuesa {
+
+PackedMorphTargets::PackedMorphTargets(int vertexCount, int targetCount)
+    : m_vertexCount(std::max(vertexCount, 0))
+    , m_targetCount(std::max(targetCount, 0))
+    , m_ranges(size_t(m_targetCount) * ChannelCount)
+{
+    m_channels.fill(false);
+}
+
+size_t PackedMorphTargets::deltaCount(int target, Channel channel) const
+{
+    if (target < 0 || target >= m_targetCount)
+        return 0;
+    return m_ranges[size_t(target) * ChannelCount + channel].count;
+}
+
+size_t PackedMorphTargets::byteSize() const
+{
+    return m_vertexIndices.size() * sizeof(quint32) +
+            m_deltas.size() * sizeof(float) +
+            m_ranges.size() * sizeof(Range);
+}
+
+bool PackedMorphTargets::vertexSpan(int target, Channel channel, int *first, int *last) const
+{
+    if (target < 0 || target >= m_targetCount)
+        return false;
+
+    // Vertex indices are stored in increasing order for each target
+    const Range &range = m_ranges[size_t(target) * ChannelCount + channel];
+    if (range.count == 0)
+        return false;
+    *first = int(m_vertexIndices[range.offset]);
+    *last = int(m_vertexIndices[range.offset + range.count - 1]);
+    return true;
+}
+
+void PackedMorphTargets::setTargetDeltas(int target, Channel channel, const float *deltas, float epsilon)
+{
+    if (target < 0 || target >= m_targetCount || deltas == nullptr)
+        return;
+
+    Range &range = m_ranges[size_t(target) * ChannelCount + channel];
+    Q_ASSERT(range.count == 0);
+    range.offset = quint32(m_vertexIndices.size());
+
+    for (int v = 0; v < m_vertexCount; ++v) {
+        const float *d = deltas + 3 * v;
+        if (std::abs(d[0]) <= epsilon && std::abs(d[1]) <= epsilon && std::abs(d[2]) <= epsilon)
+            continue;
+        m_vertexIndices.push_back(quint32(v));
+        m_deltas.insert(m_deltas.end(), d, d + 3);
+    }
+
+    range.count = quint32(m_vertexIndices.size()) - range.offset;
+    m_channels[channel] = true;
+}
+
+int PackedMorphTargets::accumulate(Channel channel, const float *weights, int weightCount,
+                                   float *dst, int componentCount) const
+{
+    if (!m_channels[channel] || dst == nullptr || componentCount < 3)
+        return 0;
+
+    int evaluatedTargets = 0;
+    for (int t = 0, m = std::min(weightCount, m_targetCount); t < m; ++t) {
+        const float w = weights[t];
+        const Range &range = m_ranges[size_t(t) * ChannelCount + channel];
+        if (w == 0.0f || range.count == 0)
+            continue;
+
+        const quint32 *indices = m_vertexIndices.data() + range.offset;
+        const float *deltas = m_deltas.data() + 3 * size_t(range.offset);
+        for (quint32 i = 0; i < range.count; ++i) {
+            float *out = dst + size_t(indices[i]) * size_t(componentCount);
+            out[0] += w * deltas[3 * i];
+            out[1] += w * deltas[3 * i + 1];
+            out[2] += w * deltas[3 * i + 2];
+        }
+        ++evaluatedTargets;
+    }
+    return evaluatedTargets;
+}
+
+} // namespace Kuesa
+
+QT_END_NAMESPACE
@@ -0,0 +1,112 @@
+/*
+    packedmorphtargets_p.h
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef KUESA_PACKEDMORPHTARGETS_P_H
+#define KUESA_PACKEDMORPHTARGETS_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Kuesa API.  It exists for the convenience
+// of other Kuesa classes.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <Kuesa/private/kuesa_global_p.h>
+#include <QtGlobal>
+#include <array>
+#include <memory>
+#include <vector>
+
+QT_BEGIN_NAMESPACE
+
+namespace Kuesa {
+
+// Stores the deltas of all the morph targets of a primitive in a single
+// packed buffer. Only the vertices a target actually moves are stored, so
+// sparse targets (a blink on a face mesh) cost next to nothing, and only
+// targets with a non zero weight are evaluated.
+class KUESA_PRIVATE_EXPORT PackedMorphTargets
+{
+public:
+    enum Channel {
+        Position = 0,
+        Normal,
+        Tangent,
+        ChannelCount
+    };
+
+    PackedMorphTargets(int vertexCount, int targetCount);
+
+    int vertexCount() const { return m_vertexCount; }
+    int targetCount() const { return m_targetCount; }
+    bool hasChannel(Channel channel) const { return m_channels[channel]; }
+
+    size_t deltaCount() const { return m_vertexIndices.size(); }
+    size_t deltaCount(int target, Channel channel) const;
+    size_t byteSize() const;
+
+    // deltas holds 3 floats per vertex. Deltas whose components all have an
+    // absolute value lower or equal to epsilon are dropped. Must be called at
+    // most once per target and channel.
+    void setTargetDeltas(int target, Channel channel, const float *deltas, float epsilon = 0.0f);
+
+    // Sets first and last to the lowest and highest index of the vertices
+    // moved by target in channel. Returns false if it doesn't move any.
+    bool vertexSpan(int target, Channel channel, int *first, int *last) const;
+
+    // Adds the deltas of the targets whose weight isn't 0 to the first 3
+    // components of each vertex of dst, which holds componentCount floats
+    // per vertex. Returns the number of targets that were evaluated.
+    int accumulate(Channel channel, const float *weights, int weightCount,
+                   float *dst, int componentCount) const;
+
+private:
+    struct Range {
+        quint32 offset = 0;
+        quint32 count = 0;
+    };
+
+    int m_vertexCount;
+    int m_targetCount;
+    std::array<bool, ChannelCount> m_channels;
+    std::vector<Range> m_ranges;
+    std::vector<quint32> m_vertexIndices;
+    std::vector<float> m_deltas;
+};
+
+using PackedMorphTargetsPtr = std::shared_ptr<const PackedMorphTargets>;
+
+} // namespace Kuesa
+
+QT_END_NAMESPACE
+
+#endif // KUESA_PACKEDMORPHTARGETS_P_H
@@ -27,6 +27,9 @@
 */
 
 #include "particlegeometry_p.h"
+#include "particlesimulation_p.h"
+
+#include <cstddef>
 
 namespace {
 constexpr auto VertexElementSize = 2;
@@ -55,11 +58,31 @@ ParticleGeometry::ParticleGeometry(QNode *parent)
     m_positionAttribute->setByteStride(VertexStride);
     m_positionAttribute->setByteOffset(0);
     addAttribute(m_positionAttribute);
+
+    // Per particle attributes of ParticleSimulation::Vertex, used when
+    // particles are simulated on the CPU
+    const auto addInstanceAttribute = [this](const QString &name, uint vertexSize, uint byteOffset) {
+        auto *attribute = new QAttribute(this);
+        attribute->setName(name);
+        attribute->setVertexBaseType(QAttribute::Float);
+        attribute->setVertexSize(vertexSize);
+        attribute->setAttributeType(QAttribute::VertexAttribute);
+        attribute->setByteStride(sizeof(ParticleSimulation::Vertex));
+        attribute->setByteOffset(byteOffset);
+        attribute->setDivisor(1);
+        m_instanceAttributes.push_back(attribute);
+    };
+    addInstanceAttribute(QStringLiteral("particlePosition"), 4, offsetof(ParticleSimulation::Vertex, position));
+    addInstanceAttribute(QStringLiteral("particleVelocity"), 3, offsetof(ParticleSimulation::Vertex, velocity));
+    addInstanceAttribute(QStringLiteral("particleSize"), 2, offsetof(ParticleSimulation::Vertex, size));
+    addInstanceAttribute(QStringLiteral("particleColor"), 4, offsetof(ParticleSimulation::Vertex, color));
 }
 
 void ParticleGeometry::setParticleCount(int particleCount)
 {
     m_positionAttribute->setCount(particleCount);
+    for (QAttribute *attribute : m_instanceAttributes)
+        attribute->setCount(particleCount);
 }
 
 int ParticleGeometry::particleCount() const
@@ -70,6 +93,8 @@ int ParticleGeometry::particleCount() const
 void ParticleGeometry::setVertexBuffer(Qt3DGeometry::QBuffer *vertexBuffer)
 {
     m_positionAttribute->setBuffer(vertexBuffer);
+    for (QAttribute *attribute : m_instanceAttributes)
+        attribute->setBuffer(vertexBuffer);
 }
 
 Qt3DGeometry::QBuffer *ParticleGeometry::vertexBuffer() const
@@ -77,6 +102,35 @@ Qt3DGeometry::QBuffer *ParticleGeometry::vertexBuffer() const
     return m_positionAttribute->buffer();
 }
 
+/*!
+ * \internal
+ *
+ * Switches between one point per particle referencing the particle buffer
+ * of the compute shaders, and one instance per particle reading the
+ * ParticleSimulation vertices.
+ */
+void ParticleGeometry::setInstanced(bool instanced)
+{
+    if (m_instanced == instanced)
+        return;
+    m_instanced = instanced;
+
+    if (instanced) {
+        removeAttribute(m_positionAttribute);
+        for (QAttribute *attribute : m_instanceAttributes)
+            addAttribute(attribute);
+    } else {
+        for (QAttribute *attribute : m_instanceAttributes)
+            removeAttribute(attribute);
+        addAttribute(m_positionAttribute);
+    }
+}
+
+bool ParticleGeometry::isInstanced() const
+{
+    return m_instanced;
+}
+
 } // namespace Kuesa
 
 QT_END_NAMESPACE
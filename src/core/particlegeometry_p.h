@@ -50,6 +50,7 @@
 #include <Qt3DRender/QAttribute>
 #include <Qt3DRender/QBuffer>
 #endif
+#include <vector>
 
 QT_BEGIN_NAMESPACE
 
@@ -67,6 +68,9 @@ public:
     int particleCount() const;
     Qt3DGeometry::QBuffer *vertexBuffer() const;
 
+    void setInstanced(bool instanced);
+    bool isInstanced() const;
+
 public Q_SLOTS:
     void setParticleCount(int count);
     void setVertexBuffer(Qt3DGeometry::QBuffer *vertexBuffer);
@@ -77,6 +81,8 @@ Q_SIGNALS:
 
 private:
     Qt3DGeometry::QAttribute *m_positionAttribute;
+    std::vector<Qt3DGeometry::QAttribute *> m_instanceAttributes;
+    bool m_instanced = false;
 };
 
 } // namespace Kuesa
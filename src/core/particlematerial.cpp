@@ -29,6 +29,8 @@
 #include "particlematerial_p.h"
 
 #include "noisetextureimage_p.h"
+#include "particlesort_p.h"
+#include "logging_p.h"
 
 #include <QUrl>
 #include <Qt3DRender/QParameter>
@@ -42,6 +44,7 @@
 #include <Qt3DRender/QTexture>
 #include <Qt3DRender/QShaderProgramBuilder>
 
+#include <limits>
 #include <numeric>
 
 using namespace Qt3DRender;
@@ -87,11 +90,15 @@ ParticleMaterial::ParticleMaterial(Qt3DCore::QNode *parent)
     , m_rotationRate(new QParameter(QStringLiteral("rotationRate"), 0.0f))
     , m_rotationRateRandom(new QParameter(QStringLiteral("rotationRateRandom"), 0.0f))
     , m_spriteTexture(new QParameter(QStringLiteral("spriteTexture"), QVariant::fromValue(new QTexture2D)))
+    , m_alignToVelocity(new QParameter(QStringLiteral("alignToVelocity"), false))
+    , m_computeEffect(new QEffect(this))
+    , m_cpuEffect(new QEffect(this))
     , m_alignMode(Particles::AlignMode::FaceCamera)
 {
     connect(m_particleCount, &QParameter::valueChanged, this,
             [this](const QVariant &v) { emit particleCountChanged(v.toInt()); });
     connect(m_particleCount, &QParameter::valueChanged, this, &ParticleMaterial::updateBuffers);
+    connect(m_particleCount, &QParameter::valueChanged, this, &ParticleMaterial::updateSortPasses);
     connect(m_frameTime, &QParameter::valueChanged, this,
             [this](const QVariant &v) { emit frameTimeChanged(v.toFloat()); });
     connect(m_maxParticlesEmittedPerFrame, &QParameter::valueChanged, this,
@@ -143,6 +150,25 @@ ParticleMaterial::ParticleMaterial(Qt3DCore::QNode *parent)
         parent->addFilterKey(filterKey);
     };
 
+    const auto addRenderStates = [](QRenderPass *renderPass) {
+        auto cullFace = new QCullFace();
+        cullFace->setMode(QCullFace::NoCulling);
+        renderPass->addRenderState(cullFace);
+
+        renderPass->addRenderState(new QNoDepthMask);
+
+        auto blendEquationArguments = new QBlendEquationArguments();
+        blendEquationArguments->setSourceRgb(QBlendEquationArguments::SourceAlpha);
+        blendEquationArguments->setSourceAlpha(QBlendEquationArguments::SourceAlpha);
+        blendEquationArguments->setDestinationRgb(QBlendEquationArguments::OneMinusSourceAlpha);
+        blendEquationArguments->setDestinationAlpha(QBlendEquationArguments::One);
+        renderPass->addRenderState(blendEquationArguments);
+
+        auto blendEquation = new QBlendEquation;
+        blendEquation->setBlendFunction(QBlendEquation::Add);
+        renderPass->addRenderState(blendEquation);
+    };
+
     auto emitShaderProgram = new QShaderProgram;
     emitShaderProgram->setComputeShaderCode(
             QShaderProgram::loadSource(QUrl(QStringLiteral("qrc:/kuesa/shaders/gl3/particleemit.comp"))));
@@ -173,14 +199,11 @@ ParticleMaterial::ParticleMaterial(Qt3DCore::QNode *parent)
     simulatePass->addParameter(m_frameTime);
     simulatePass->addParameter(m_gravity);
 
-    auto sortShaderProgram = new QShaderProgram;
-    sortShaderProgram->setComputeShaderCode(
+    // The sort passes share this program, see updateSortPasses
+    m_sortShaderProgram = new QShaderProgram(this);
+    m_sortShaderProgram->setComputeShaderCode(
             QShaderProgram::loadSource(QUrl(QStringLiteral("qrc:/kuesa/shaders/gl3/particlesort.comp"))));
 
-    auto sortPass = new QRenderPass;
-    addFilterKey(sortPass, QStringLiteral("KuesaComputeStage"), QStringLiteral("ParticleSort"));
-    sortPass->setShaderProgram(sortShaderProgram);
-
     auto renderShaderProgram = new QShaderProgram;
     renderShaderProgram->setVertexShaderCode(
             QShaderProgram::loadSource(QUrl(QStringLiteral("qrc:/kuesa/shaders/gl3/particle.vert"))));
@@ -201,29 +224,13 @@ ParticleMaterial::ParticleMaterial(Qt3DCore::QNode *parent)
     renderPass->addParameter(m_initialColor);
     renderPass->addParameter(m_finalColor);
     renderPass->addParameter(m_spriteTexture);
-
-    auto cullFace = new QCullFace();
-    cullFace->setMode(QCullFace::NoCulling);
-    renderPass->addRenderState(cullFace);
-
-    renderPass->addRenderState(new QNoDepthMask);
-
-    auto blendEquationArguments = new QBlendEquationArguments();
-    blendEquationArguments->setSourceRgb(QBlendEquationArguments::SourceAlpha);
-    blendEquationArguments->setSourceAlpha(QBlendEquationArguments::SourceAlpha);
-    blendEquationArguments->setDestinationRgb(QBlendEquationArguments::OneMinusSourceAlpha);
-    blendEquationArguments->setDestinationAlpha(QBlendEquationArguments::One);
-    renderPass->addRenderState(blendEquationArguments);
-
-    auto blendEquation = new QBlendEquation;
-    blendEquation->setBlendFunction(QBlendEquation::Add);
-    renderPass->addRenderState(blendEquation);
+    addRenderStates(renderPass);
 
     auto technique = new QTechnique;
     technique->addRenderPass(emitPass);
     technique->addRenderPass(simulatePass);
-    technique->addRenderPass(sortPass);
     technique->addRenderPass(renderPass);
+    m_computeTechnique = technique;
 
     auto graphicsApiFilter = technique->graphicsApiFilter();
     graphicsApiFilter->setApi(QGraphicsApiFilter::OpenGL);
@@ -231,16 +238,52 @@ ParticleMaterial::ParticleMaterial(Qt3DCore::QNode *parent)
     graphicsApiFilter->setMajorVersion(4);
     graphicsApiFilter->setMinorVersion(3);
 
-    auto effect = new QEffect;
-    effect->addTechnique(technique);
-    effect->addParameter(m_particleCount);
-    effect->addParameter(m_particleBuffer);
-    effect->addParameter(m_deadListBuffer);
-    effect->addParameter(m_sortKeyBuffer);
-
-    setEffect(effect);
+    m_computeEffect->addTechnique(technique);
+    m_computeEffect->addParameter(m_particleCount);
+    m_computeEffect->addParameter(m_particleBuffer);
+    m_computeEffect->addParameter(m_deadListBuffer);
+    m_computeEffect->addParameter(m_sortKeyBuffer);
+
+    // Particles simulated on the CPU are streamed to the vertex buffer of
+    // the mesh, there is only the render pass left
+    struct ApiFilterInfo {
+        int major;
+        int minor;
+        QGraphicsApiFilter::Api api;
+        QGraphicsApiFilter::OpenGLProfile profile;
+        QString shaderDirectory;
+    };
+    const ApiFilterInfo cpuApiFilterInfos[] = {
+        { 3, 1, QGraphicsApiFilter::OpenGL, QGraphicsApiFilter::CoreProfile, QStringLiteral("gl3") },
+        { 3, 0, QGraphicsApiFilter::OpenGLES, QGraphicsApiFilter::NoProfile, QStringLiteral("es3") },
+    };
+    for (const ApiFilterInfo &info : cpuApiFilterInfos) {
+        auto instancedShaderProgram = new QShaderProgram;
+        instancedShaderProgram->setVertexShaderCode(QShaderProgram::loadSource(
+                QUrl(QStringLiteral("qrc:/kuesa/shaders/%1/particle_instanced.vert").arg(info.shaderDirectory))));
+        instancedShaderProgram->setFragmentShaderCode(QShaderProgram::loadSource(
+                QUrl(QStringLiteral("qrc:/kuesa/shaders/%1/particle_instanced.frag").arg(info.shaderDirectory))));
+
+        auto instancedRenderPass = new QRenderPass;
+        addFilterKey(instancedRenderPass, QStringLiteral("KuesaDrawStage"), QStringLiteral("ParticleRender"));
+        instancedRenderPass->setShaderProgram(instancedShaderProgram);
+        instancedRenderPass->addParameter(m_spriteTexture);
+        instancedRenderPass->addParameter(m_alignToVelocity);
+        addRenderStates(instancedRenderPass);
+
+        auto cpuTechnique = new QTechnique;
+        cpuTechnique->addRenderPass(instancedRenderPass);
+        cpuTechnique->graphicsApiFilter()->setApi(info.api);
+        cpuTechnique->graphicsApiFilter()->setProfile(info.profile);
+        cpuTechnique->graphicsApiFilter()->setMajorVersion(info.major);
+        cpuTechnique->graphicsApiFilter()->setMinorVersion(info.minor);
+        m_cpuEffect->addTechnique(cpuTechnique);
+    }
+
+    setEffect(m_computeEffect);
 
     updateBuffers();
+    updateSortPasses();
 }
 
 int ParticleMaterial::particleCount() const
@@ -454,6 +497,7 @@ void ParticleMaterial::setAlignMode(Particles::AlignMode alignMode)
         Q_UNREACHABLE();
     }();
     m_renderShaderProgramBuilder->setEnabledLayers({ layerName });
+    m_alignToVelocity->setValue(alignMode == Particles::AlignMode::Velocity);
     m_alignMode = alignMode;
     emit alignModeChanged(alignMode);
 }
@@ -473,6 +517,26 @@ Qt3DGeometry::QBuffer *ParticleMaterial::sortKeyBuffer() const
     return m_sortKeyBuffer->value().value<Qt3DGeometry::QBuffer *>();
 }
 
+/*!
+ * \internal
+ *
+ * Switches between the effect running the simulation in compute shaders and
+ * the one drawing particles simulated on the CPU.
+ */
+void ParticleMaterial::setCpuSimulation(bool cpuSimulation)
+{
+    if (m_cpuSimulation == cpuSimulation)
+        return;
+    m_cpuSimulation = cpuSimulation;
+    setEffect(cpuSimulation ? m_cpuEffect : m_computeEffect);
+    updateSortPasses();
+}
+
+bool ParticleMaterial::cpuSimulation() const
+{
+    return m_cpuSimulation;
+}
+
 void ParticleMaterial::updateBuffers()
 {
     const auto particleCount = this->particleCount();
@@ -482,7 +546,7 @@ void ParticleMaterial::updateBuffers()
         QByteArray data(particleCount * sizeof(Particle), 0);
         auto *p = reinterpret_cast<Particle *>(data.data());
         for (int i = 0; i < particleCount; ++i)
-            p->age = -1.0f;
+            p[i].age = -1.0f;
         return data;
     }();
     particleBuffer()->setData(particleData);
@@ -498,7 +562,63 @@ void ParticleMaterial::updateBuffers()
     }();
     deadListBuffer()->setData(deadListData);
 
-    sortKeyBuffer()->setData(QByteArray(particleCount * 2 * sizeof(float), 0));
+    auto sortKeyData = [&particleCount] {
+        // the sort passes work on a power of two number of keys, the padding
+        // keys and the keys of dead particles sort last
+        const int keyCount = ParticleSort::sortSize(particleCount);
+        QByteArray data(keyCount * 2 * sizeof(float), 0);
+        auto *p = reinterpret_cast<float *>(data.data());
+        for (int i = 0; i < keyCount; ++i) {
+            *p++ = -std::numeric_limits<float>::max(); // distance
+            *p++ = -1.0f; // particle index
+        }
+        return data;
+    }();
+    sortKeyBuffer()->setData(sortKeyData);
+}
+
+/*!
+ * \internal
+ *
+ * Adds one sort pass per step of the sorting network needed by the particle
+ * count padded to the next power of two. Each pass is matched by the sort
+ * stage of the ParticleRenderStage with the same index, the stages without a
+ * matching pass don't dispatch anything.
+ */
+void ParticleMaterial::updateSortPasses()
+{
+    int particleCount = this->particleCount();
+    if (particleCount > ParticleSort::MaxParticleCount) {
+        if (!m_cpuSimulation)
+            qCWarning(kuesa) << "Particles can only be sorted on the GPU up to"
+                             << ParticleSort::MaxParticleCount << "particles, got" << particleCount;
+        particleCount = ParticleSort::MaxParticleCount;
+    }
+
+    // The passes for fewer particles are always the first ones of the passes
+    // for more particles
+    const size_t passCount = ParticleSort::passes(particleCount).size();
+    while (m_sortPasses.size() > passCount) {
+        QRenderPass *sortPass = m_sortPasses.back();
+        m_sortPasses.pop_back();
+        m_computeTechnique->removeRenderPass(sortPass);
+        delete sortPass;
+    }
+
+    while (m_sortPasses.size() < passCount) {
+        auto sortPass = new QRenderPass;
+        auto stageKey = new QFilterKey(sortPass);
+        stageKey->setName(QStringLiteral("KuesaComputeStage"));
+        stageKey->setValue(QStringLiteral("ParticleSort"));
+        sortPass->addFilterKey(stageKey);
+        auto passKey = new QFilterKey(sortPass);
+        passKey->setName(QStringLiteral("KuesaParticleSortPass"));
+        passKey->setValue(int(m_sortPasses.size()));
+        sortPass->addFilterKey(passKey);
+        sortPass->setShaderProgram(m_sortShaderProgram);
+        m_computeTechnique->addRenderPass(sortPass);
+        m_sortPasses.push_back(sortPass);
+    }
 }
 
 } // namespace Kuesa
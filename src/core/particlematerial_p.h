@@ -47,6 +47,7 @@
 #include <QVector2D>
 #include <QVector3D>
 #include <QVector4D>
+#include <vector>
 
 #include <Kuesa/private/kuesa_global_p.h>
 #if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
@@ -61,6 +62,10 @@ QT_BEGIN_NAMESPACE
 
 namespace Qt3DRender {
 class QShaderProgramBuilder;
+class QShaderProgram;
+class QRenderPass;
+class QTechnique;
+class QEffect;
 }
 
 namespace Kuesa {
@@ -119,6 +124,9 @@ public:
     Qt3DGeometry::QBuffer *deadListBuffer() const;
     Qt3DGeometry::QBuffer *sortKeyBuffer() const;
 
+    void setCpuSimulation(bool cpuSimulation);
+    bool cpuSimulation() const;
+
 public Q_SLOTS:
     void setParticleCount(int particleCount);
     void setFrameTime(float frameTime);
@@ -165,6 +173,7 @@ Q_SIGNALS:
 
 private:
     void updateBuffers();
+    void updateSortPasses();
 
     Qt3DRender::QShaderProgramBuilder *m_renderShaderProgramBuilder;
     Qt3DRender::QParameter *m_particleCount;
@@ -190,7 +199,14 @@ private:
     Qt3DRender::QParameter *m_rotationRate;
     Qt3DRender::QParameter *m_rotationRateRandom;
     Qt3DRender::QParameter *m_spriteTexture;
+    Qt3DRender::QParameter *m_alignToVelocity;
+    Qt3DRender::QEffect *m_computeEffect;
+    Qt3DRender::QEffect *m_cpuEffect;
+    Qt3DRender::QTechnique *m_computeTechnique;
+    Qt3DRender::QShaderProgram *m_sortShaderProgram;
+    std::vector<Qt3DRender::QRenderPass *> m_sortPasses;
     Particles::AlignMode m_alignMode;
+    bool m_cpuSimulation = false;
 };
 
 } // namespace Kuesa
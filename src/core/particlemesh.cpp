@@ -67,6 +67,36 @@ Qt3DGeometry::QBuffer *ParticleMesh::vertexBuffer() const
     return static_cast<ParticleGeometry *>(geometry())->vertexBuffer();
 }
 
+/*!
+ * \internal
+ *
+ * Draws each particle as an instanced quad rather than as a point expanded
+ * by the geometry shader. The instance count is then the number of alive
+ * particles.
+ */
+void ParticleMesh::setInstanced(bool instanced)
+{
+    auto *particleGeometry = static_cast<ParticleGeometry *>(geometry());
+    if (particleGeometry->isInstanced() == instanced)
+        return;
+
+    particleGeometry->setInstanced(instanced);
+    if (instanced) {
+        setPrimitiveType(TriangleStrip);
+        setVertexCount(4);
+        setInstanceCount(0);
+    } else {
+        setPrimitiveType(Points);
+        setVertexCount(0);
+        setInstanceCount(1);
+    }
+}
+
+bool ParticleMesh::isInstanced() const
+{
+    return static_cast<ParticleGeometry *>(geometry())->isInstanced();
+}
+
 } // namespace Kuesa
 
 QT_END_NAMESPACE
@@ -67,6 +67,9 @@ public:
     int particleCount() const;
     Qt3DGeometry::QBuffer *vertexBuffer() const;
 
+    void setInstanced(bool instanced);
+    bool isInstanced() const;
+
 public Q_SLOTS:
     void setParticleCount(int particleCount);
     void setVertexBuffer(Qt3DGeometry::QBuffer *vertexBuffer);
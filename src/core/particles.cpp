@@ -30,6 +30,9 @@
 
 #include "particlemesh_p.h"
 #include "particlematerial_p.h"
+#include "particlesimulation_p.h"
+
+#include <Kuesa/private/framegraphutils_p.h>
 
 #include <Qt3DRender/QAbstractTexture>
 #include <Qt3DRender/QComputeCommand>
@@ -127,6 +130,8 @@ Particles::Particles(Qt3DCore::QEntity *parent)
     , m_computeCommand(new Qt3DRender::QComputeCommand(this))
     , m_mesh(new ParticleMesh(this))
     , m_material(new ParticleMaterial(this))
+    , m_computeEntity(new Qt3DCore::QEntity(this))
+    , m_simulationEntity(new ParticleSimulationEntity(m_material, m_mesh, this))
 {
     connect(m_material, &ParticleMaterial::particleCountChanged, this, &Particles::particleCountChanged);
     connect(m_material, &ParticleMaterial::particleCountChanged, m_mesh, &ParticleMesh::setParticleCount);
@@ -154,22 +159,24 @@ Particles::Particles(Qt3DCore::QEntity *parent)
     m_mesh->setVertexBuffer(m_material->sortKeyBuffer());
     m_mesh->setParticleCount(m_material->particleCount());
 
-    auto *computeEntity = new Qt3DCore::QEntity(this);
-    computeEntity->addComponent(m_computeCommand);
-    computeEntity->addComponent(m_material);
+    m_computeEntity->addComponent(m_computeCommand);
+    m_computeEntity->addComponent(m_material);
 
     auto *renderEntity = new Qt3DCore::QEntity(this);
     renderEntity->addComponent(m_mesh);
     renderEntity->addComponent(m_material);
 
     updateWorkGroupCount();
+    updateSimulationBackend();
 }
 
 /*!
     \property Kuesa::Particles::particleCount
 
     Holds the maximum number of particles the system can handle.
-    Currently the maximum value is 2048.
+    When particles are simulated on the GPU, the maximum value is 65536:
+    larger counts print a warning and aren't sorted back to front. There is
+    no limit on the CPU simulation path.
 
     \default 32
     \since Kuesa 1.3
@@ -179,7 +186,9 @@ Particles::Particles(Qt3DCore::QEntity *parent)
     \qmlproperty int Kuesa::Particles::particleCount
 
     Holds the maximum number of particles the system can handle.
-    Currently the maximum value is 2048.
+    When particles are simulated on the GPU, the maximum value is 65536:
+    larger counts print a warning and aren't sorted back to front. There is
+    no limit on the CPU simulation path.
 
     \default 32
     \since Kuesa 1.3
@@ -569,6 +578,65 @@ Particles::AlignMode Particles::alignMode() const
     return m_material->alignMode();
 }
 
+/*!
+    \enum Particles::SimulationMode
+
+    This enum type describes where particles are simulated.
+    \value Automatic On the GPU when compute shaders are supported, on the CPU otherwise.
+    \value Gpu In compute shaders, requires OpenGL 4.3.
+    \value Cpu On the CPU, the results being streamed to a vertex buffer every frame.
+ */
+
+/*!
+    \property Kuesa::Particles::simulationMode
+
+    Holds where the particles are simulated.
+
+    Simulating on the CPU makes particles available with OpenGL ES 3.0 and
+    OpenGL 3 where compute shaders are not available. Emission, motion, size
+    and color over life and back to front sorting are the same on both. CPU
+    particles are sorted for the camera of the ForwardRenderer.
+
+    \default Automatic
+    \since Kuesa 1.4
+ */
+
+/*!
+    \qmlproperty enumeration Kuesa::Particles::simulationMode
+
+    Holds where the particles are simulated.
+
+    \list
+    \li Particles.Automatic On the GPU when compute shaders are supported, on the CPU otherwise.
+    \li Particles.Gpu In compute shaders, requires OpenGL 4.3.
+    \li Particles.Cpu On the CPU, the results being streamed to a vertex buffer every frame.
+    \endlist
+
+    Simulating on the CPU makes particles available with OpenGL ES 3.0 and
+    OpenGL 3 where compute shaders are not available. Emission, motion, size
+    and color over life and back to front sorting are the same on both. CPU
+    particles are sorted for the camera of the ForwardRenderer.
+
+    \default Automatic
+    \since Kuesa 1.4
+ */
+Particles::SimulationMode Particles::simulationMode() const
+{
+    return m_simulationMode;
+}
+
+/*!
+    Returns whether particles are currently simulated on the CPU, either
+    because simulationMode is Cpu or because it is Automatic and compute
+    shaders are not supported.
+
+    \since Kuesa 1.4
+ */
+bool Particles::isCpuSimulationActive() const
+{
+    return m_simulationEntity->isActive();
+}
+
 void Particles::setParticleCount(int particleCount)
 {
     m_material->setParticleCount(particleCount);
@@ -669,6 +737,36 @@ void Particles::setAlignMode(AlignMode alignMode)
     m_material->setAlignMode(alignMode);
 }
 
+void Particles::setSimulationMode(SimulationMode simulationMode)
+{
+    if (m_simulationMode == simulationMode)
+        return;
+    m_simulationMode = simulationMode;
+    updateSimulationBackend();
+    emit simulationModeChanged(simulationMode);
+}
+
+void Particles::updateSimulationBackend()
+{
+    const bool useCpu = [this] {
+        switch (m_simulationMode) {
+        case SimulationMode::Gpu:
+            return false;
+        case SimulationMode::Cpu:
+            return true;
+        case SimulationMode::Automatic:
+        default:
+            return !FrameGraphUtils::hasComputeShaderSupport();
+        }
+    }();
+
+    m_computeEntity->setEnabled(!useCpu);
+    m_material->setCpuSimulation(useCpu);
+    m_mesh->setInstanced(useCpu);
+    m_mesh->setVertexBuffer(useCpu ? m_simulationEntity->vertexBuffer() : m_material->sortKeyBuffer());
+    m_simulationEntity->setActive(useCpu);
+}
+
 void Particles::updateWorkGroupCount()
 {
     m_computeCommand->setWorkGroupX((particleCount() + WorkGroupSize - 1) / WorkGroupSize);
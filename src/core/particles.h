@@ -46,6 +46,7 @@ namespace Kuesa {
 
 class ParticleMesh;
 class ParticleMaterial;
+class ParticleSimulationEntity;
 
 class KUESASHARED_EXPORT Particles : public Qt3DCore::QEntity
 {
@@ -70,6 +71,7 @@ class KUESASHARED_EXPORT Particles : public Qt3DCore::QEntity
     Q_PROPERTY(float rotationRateRandom READ rotationRateRandom WRITE setRotationRateRandom NOTIFY rotationRateRandomChanged)
     Q_PROPERTY(Qt3DRender::QAbstractTexture *spriteTexture READ spriteTexture WRITE setSpriteTexture NOTIFY spriteTextureChanged)
     Q_PROPERTY(AlignMode alignMode READ alignMode WRITE setAlignMode NOTIFY alignModeChanged)
+    Q_PROPERTY(SimulationMode simulationMode READ simulationMode WRITE setSimulationMode NOTIFY simulationModeChanged)
 
 public:
     enum class AlignMode {
@@ -78,6 +80,13 @@ public:
     };
     Q_ENUM(AlignMode);
 
+    enum class SimulationMode {
+        Automatic,
+        Gpu,
+        Cpu
+    };
+    Q_ENUM(SimulationMode);
+
     explicit Particles(Qt3DCore::QEntity *parent = nullptr);
 
     int particleCount() const;
@@ -100,6 +109,8 @@ public:
     float rotationRateRandom() const;
     Qt3DRender::QAbstractTexture *spriteTexture() const;
     AlignMode alignMode() const;
+    SimulationMode simulationMode() const;
+    bool isCpuSimulationActive() const;
 
 public Q_SLOTS:
     void setParticleCount(int particleCount);
@@ -122,6 +133,7 @@ public Q_SLOTS:
     void setRotationRateRandom(float rotationRateRandom);
     void setSpriteTexture(Qt3DRender::QAbstractTexture *spriteTexture);
     void setAlignMode(AlignMode alignMode);
+    void setSimulationMode(SimulationMode simulationMode);
 
 Q_SIGNALS:
     void particleCountChanged(int particleCount);
@@ -144,13 +156,18 @@ Q_SIGNALS:
     void rotationRateRandomChanged(float rotationRateRandom);
     void spriteTextureChanged(const Qt3DRender::QAbstractTexture *spriteTexture);
     void alignModeChanged(AlignMode alignMode);
+    void simulationModeChanged(SimulationMode simulationMode);
 
 private:
     void updateWorkGroupCount();
+    void updateSimulationBackend();
 
     Qt3DRender::QComputeCommand *m_computeCommand;
     ParticleMesh *m_mesh;
     ParticleMaterial *m_material;
+    Qt3DCore::QEntity *m_computeEntity;
+    ParticleSimulationEntity *m_simulationEntity;
+    SimulationMode m_simulationMode = SimulationMode::Automatic;
 };
 
 } // namespace Kuesa
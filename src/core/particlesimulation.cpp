@@ -0,0 +1,552 @@
+/*
+    particlesimulation.cpp
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "particlesimulation_p.h"
+#include "particlematerial_p.h"
+#include "particlemesh_p.h"
+
+#include <Kuesa/private/kuesa_utils_p.h>
+#include <Kuesa/forwardrenderer.h>
+#include <Qt3DCore/QTransform>
+#include <Qt3DLogic/QFrameAction>
+#include <QSemaphore>
+#include <QThread>
+#include <QThreadPool>
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <numeric>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+QT_BEGIN_NAMESPACE
+
+namespace Kuesa {
+
+namespace {
+
+// Below this, handing work over to other threads costs more than it saves
+constexpr int MinParticlesPerThread = 2048;
+
+constexpr float DeadParticleDistance = -std::numeric_limits<float>::max();
+
+// World matrix of the closest transform up the entity hierarchy
+QMatrix4x4 entityWorldMatrix(Qt3DCore::QEntity *entity)
+{
+    for (; entity != nullptr; entity = entity->parentEntity()) {
+        const auto transforms = entity->componentsOfType<Qt3DCore::QTransform>();
+        if (!transforms.empty())
+            return transforms.first()->worldMatrix();
+    }
+    return {};
+}
+
+} // namespace
+
+/*!
+ * \internal
+ * \class Kuesa::ParticleSimulation
+ * \brief CPU implementation of the particle compute shaders
+ * \inmodule Kuesa
+ * \since Kuesa 1.4
+ *
+ * ParticleSimulation follows the steps of the particleemit, particlesimulate
+ * and particlesort compute shaders for the platforms which lack compute
+ * support: up to maxParticlesEmittedPerFrame dead particles are respawned at
+ * the emitter, alive particles are moved by their velocity and the gravity
+ * and particles are sorted back to front from the eye position. Particles
+ * die once their age, counting down from their lifespan, is negative.
+ *
+ * Instead of the noise texture sampled by the shaders, random values come
+ * from a generator seeded with seed(), making runs reproducible.
+ *
+ * Particle state is stored as one array per component so that the
+ * simulation loop processes 4 particles at a time with SSE2 or NEON; it is
+ * split across threadCount() threads for large particle counts.
+ * writeVertices() outputs the alive particles in drawing order with their
+ * size and color over their life already applied.
+ */
+
+ParticleSimulation::ParticleSimulation(quint32 seed)
+    : m_seed(seed)
+{
+    reset();
+}
+
+void ParticleSimulation::setParticleCount(int particleCount)
+{
+    particleCount = std::max(particleCount, 0);
+    if (particleCount == m_particleCount)
+        return;
+    m_particleCount = particleCount;
+    reset();
+}
+
+int ParticleSimulation::particleCount() const
+{
+    return m_particleCount;
+}
+
+void ParticleSimulation::setSeed(quint32 seed)
+{
+    m_seed = seed;
+    reset();
+}
+
+quint32 ParticleSimulation::seed() const
+{
+    return m_seed;
+}
+
+void ParticleSimulation::setThreadCount(int threadCount)
+{
+    m_threadCount = std::max(threadCount, 0);
+}
+
+int ParticleSimulation::threadCount() const
+{
+    return m_threadCount > 0 ? m_threadCount : std::max(QThread::idealThreadCount(), 1);
+}
+
+void ParticleSimulation::setParameters(const Parameters &parameters)
+{
+    m_parameters = parameters;
+}
+
+const ParticleSimulation::Parameters &ParticleSimulation::parameters() const
+{
+    return m_parameters;
+}
+
+/*!
+ * Kills all particles and restarts the random sequence
+ */
+void ParticleSimulation::reset()
+{
+    const size_t count = size_t(m_particleCount);
+    for (auto *values : { &m_positionX, &m_positionY, &m_positionZ,
+                          &m_velocityX, &m_velocityY, &m_velocityZ,
+                          &m_lifespan, &m_rotation, &m_rotationRate })
+        values->assign(count, 0.0f);
+    m_age.assign(count, -1.0f);
+    m_distance.assign(count, DeadParticleDistance);
+
+    m_deadParticles.resize(count);
+    std::iota(m_deadParticles.begin(), m_deadParticles.end(), 0);
+    m_sortedParticles.clear();
+
+    m_randomState = m_seed;
+}
+
+/*!
+ * Advances the simulation by \a frameTime and sorts the particles back to
+ * front as seen from \a eyePosition.
+ */
+void ParticleSimulation::step(float frameTime, const QVector3D &eyePosition)
+{
+    emitParticles();
+    parallelFor(m_particleCount, [&](int begin, int end) {
+        simulate(begin, end, frameTime, eyePosition);
+    });
+    sortParticles();
+}
+
+int ParticleSimulation::aliveCount() const
+{
+    return int(m_sortedParticles.size());
+}
+
+const std::vector<quint32> &ParticleSimulation::sortedParticles() const
+{
+    return m_sortedParticles;
+}
+
+/*!
+ * Writes aliveCount() vertices to \a vertices, in the order of
+ * sortedParticles().
+ */
+void ParticleSimulation::writeVertices(Vertex *vertices) const
+{
+    const Parameters &p = m_parameters;
+
+    parallelFor(aliveCount(), [&](int begin, int end) {
+        for (int i = begin; i < end; ++i) {
+            const size_t particle = m_sortedParticles[size_t(i)];
+            // A particle spawned with no lifespan is drawn once, at the end of its life
+            const float lifespan = m_lifespan[particle];
+            const float normalizedAge = lifespan > 0.0f ? std::max(1.0f - m_age[particle] / lifespan, 0.0f) : 1.0f;
+            const QVector2D size = p.initialSize + (p.finalSize - p.initialSize) * normalizedAge;
+            const QVector4D color = p.initialColor + (p.finalColor - p.initialColor) * normalizedAge;
+
+            Vertex &v = vertices[i];
+            v.position[0] = m_positionX[particle];
+            v.position[1] = m_positionY[particle];
+            v.position[2] = m_positionZ[particle];
+            v.rotation = m_rotation[particle];
+            v.velocity[0] = m_velocityX[particle];
+            v.velocity[1] = m_velocityY[particle];
+            v.velocity[2] = m_velocityZ[particle];
+            v.size[0] = size.x();
+            v.size[1] = size.y();
+            v.color[0] = color.x();
+            v.color[1] = color.y();
+            v.color[2] = color.z();
+            v.color[3] = color.w();
+        }
+    });
+}
+
+bool ParticleSimulation::isAlive(int particle) const
+{
+    return m_age[size_t(particle)] >= 0.0f;
+}
+
+QVector3D ParticleSimulation::position(int particle) const
+{
+    const size_t i = size_t(particle);
+    return { m_positionX[i], m_positionY[i], m_positionZ[i] };
+}
+
+QVector3D ParticleSimulation::velocity(int particle) const
+{
+    const size_t i = size_t(particle);
+    return { m_velocityX[i], m_velocityY[i], m_velocityZ[i] };
+}
+
+float ParticleSimulation::age(int particle) const
+{
+    return m_age[size_t(particle)];
+}
+
+float ParticleSimulation::lifespan(int particle) const
+{
+    return m_lifespan[size_t(particle)];
+}
+
+float ParticleSimulation::rotation(int particle) const
+{
+    return m_rotation[size_t(particle)];
+}
+
+void ParticleSimulation::emitParticles()
+{
+    const Parameters &p = m_parameters;
+    const QMatrix3x3 normalMatrix = p.modelMatrix.normalMatrix();
+    const size_t emittedCount = std::min(m_deadParticles.size(), size_t(std::max(p.maxParticlesEmittedPerFrame, 0)));
+
+    for (size_t i = 0; i < emittedCount; ++i) {
+        const QVector4D random0(nextRandom(), nextRandom(), nextRandom(), nextRandom());
+        const QVector4D random1(nextRandom(), nextRandom(), nextRandom(), nextRandom());
+        const float random2 = nextRandom();
+
+        const QVector3D position = p.modelMatrix.map(p.emitterPosition + random0.toVector3D() * p.emitterPositionRandom);
+        const QVector3D localVelocity = p.emitterVelocity + random1.toVector3D() * p.emitterVelocityRandom;
+        QVector3D velocity;
+        for (int row = 0; row < 3; ++row)
+            velocity[row] = normalMatrix(row, 0) * localVelocity.x() + normalMatrix(row, 1) * localVelocity.y() + normalMatrix(row, 2) * localVelocity.z();
+
+        const size_t particle = m_deadParticles[i];
+        m_positionX[particle] = position.x();
+        m_positionY[particle] = position.y();
+        m_positionZ[particle] = position.z();
+        m_velocityX[particle] = velocity.x();
+        m_velocityY[particle] = velocity.y();
+        m_velocityZ[particle] = velocity.z();
+        m_lifespan[particle] = p.particleLifespan + random0.w() * p.particleLifespanRandom;
+        m_age[particle] = m_lifespan[particle];
+        m_rotation[particle] = p.initialAngle + random1.w() * p.initialAngleRandom;
+        m_rotationRate[particle] = p.rotationRate + random2 * p.rotationRateRandom;
+    }
+}
+
+void ParticleSimulation::simulate(int begin, int end, float frameTime, const QVector3D &eyePosition)
+{
+    const float gravityX = m_parameters.gravity.x();
+    const float gravityY = m_parameters.gravity.y();
+    const float gravityZ = m_parameters.gravity.z();
+    const float eyeX = eyePosition.x();
+    const float eyeY = eyePosition.y();
+    const float eyeZ = eyePosition.z();
+
+    float *positionX = m_positionX.data();
+    float *positionY = m_positionY.data();
+    float *positionZ = m_positionZ.data();
+    float *velocityX = m_velocityX.data();
+    float *velocityY = m_velocityY.data();
+    float *velocityZ = m_velocityZ.data();
+    float *age = m_age.data();
+    float *rotation = m_rotation.data();
+    const float *rotationRate = m_rotationRate.data();
+    float *distance = m_distance.data();
+
+    // Branch free, 4 particles at a time where SSE2 or NEON are available:
+    // dead particles advance by 0
+    int i = begin;
+#if defined(__SSE2__)
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 vFrameTime = _mm_set1_ps(frameTime);
+    const __m128 vDeadDistance = _mm_set1_ps(DeadParticleDistance);
+    for (; i + 4 <= end; i += 4) {
+        const __m128 alive = _mm_cmpge_ps(_mm_loadu_ps(age + i), zero);
+        const __m128 dt = _mm_and_ps(alive, vFrameTime);
+
+        const __m128 vx = _mm_loadu_ps(velocityX + i);
+        const __m128 vy = _mm_loadu_ps(velocityY + i);
+        const __m128 vz = _mm_loadu_ps(velocityZ + i);
+        const __m128 px = _mm_add_ps(_mm_loadu_ps(positionX + i), _mm_mul_ps(dt, vx));
+        const __m128 py = _mm_add_ps(_mm_loadu_ps(positionY + i), _mm_mul_ps(dt, vy));
+        const __m128 pz = _mm_add_ps(_mm_loadu_ps(positionZ + i), _mm_mul_ps(dt, vz));
+        _mm_storeu_ps(positionX + i, px);
+        _mm_storeu_ps(positionY + i, py);
+        _mm_storeu_ps(positionZ + i, pz);
+        _mm_storeu_ps(velocityX + i, _mm_add_ps(vx, _mm_mul_ps(dt, _mm_set1_ps(gravityX))));
+        _mm_storeu_ps(velocityY + i, _mm_add_ps(vy, _mm_mul_ps(dt, _mm_set1_ps(gravityY))));
+        _mm_storeu_ps(velocityZ + i, _mm_add_ps(vz, _mm_mul_ps(dt, _mm_set1_ps(gravityZ))));
+        _mm_storeu_ps(age + i, _mm_sub_ps(_mm_loadu_ps(age + i), dt));
+        _mm_storeu_ps(rotation + i, _mm_add_ps(_mm_loadu_ps(rotation + i), _mm_mul_ps(dt, _mm_loadu_ps(rotationRate + i))));
+
+        const __m128 dx = _mm_sub_ps(px, _mm_set1_ps(eyeX));
+        const __m128 dy = _mm_sub_ps(py, _mm_set1_ps(eyeY));
+        const __m128 dz = _mm_sub_ps(pz, _mm_set1_ps(eyeZ));
+        const __m128 d = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)));
+        _mm_storeu_ps(distance + i, _mm_or_ps(_mm_and_ps(alive, d), _mm_andnot_ps(alive, vDeadDistance)));
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    const float32x4_t zero = vdupq_n_f32(0.0f);
+    const float32x4_t vFrameTime = vdupq_n_f32(frameTime);
+    const float32x4_t vDeadDistance = vdupq_n_f32(DeadParticleDistance);
+    for (; i + 4 <= end; i += 4) {
+        const uint32x4_t alive = vcgeq_f32(vld1q_f32(age + i), zero);
+        const float32x4_t dt = vbslq_f32(alive, vFrameTime, zero);
+
+        const float32x4_t vx = vld1q_f32(velocityX + i);
+        const float32x4_t vy = vld1q_f32(velocityY + i);
+        const float32x4_t vz = vld1q_f32(velocityZ + i);
+        const float32x4_t px = vmlaq_f32(vld1q_f32(positionX + i), dt, vx);
+        const float32x4_t py = vmlaq_f32(vld1q_f32(positionY + i), dt, vy);
+        const float32x4_t pz = vmlaq_f32(vld1q_f32(positionZ + i), dt, vz);
+        vst1q_f32(positionX + i, px);
+        vst1q_f32(positionY + i, py);
+        vst1q_f32(positionZ + i, pz);
+        vst1q_f32(velocityX + i, vmlaq_n_f32(vx, dt, gravityX));
+        vst1q_f32(velocityY + i, vmlaq_n_f32(vy, dt, gravityY));
+        vst1q_f32(velocityZ + i, vmlaq_n_f32(vz, dt, gravityZ));
+        vst1q_f32(age + i, vsubq_f32(vld1q_f32(age + i), dt));
+        vst1q_f32(rotation + i, vmlaq_f32(vld1q_f32(rotation + i), dt, vld1q_f32(rotationRate + i)));
+
+        const float32x4_t dx = vsubq_f32(px, vdupq_n_f32(eyeX));
+        const float32x4_t dy = vsubq_f32(py, vdupq_n_f32(eyeY));
+        const float32x4_t dz = vsubq_f32(pz, vdupq_n_f32(eyeZ));
+        const float32x4_t d = vsqrtq_f32(vmlaq_f32(vmlaq_f32(vmulq_f32(dx, dx), dy, dy), dz, dz));
+        vst1q_f32(distance + i, vbslq_f32(alive, d, vDeadDistance));
+    }
+#endif
+
+    for (; i < end; ++i) {
+        const bool alive = age[i] >= 0.0f;
+        const float dt = alive ? frameTime : 0.0f;
+
+        positionX[i] += dt * velocityX[i];
+        positionY[i] += dt * velocityY[i];
+        positionZ[i] += dt * velocityZ[i];
+        velocityX[i] += dt * gravityX;
+        velocityY[i] += dt * gravityY;
+        velocityZ[i] += dt * gravityZ;
+        age[i] -= dt;
+        rotation[i] += dt * rotationRate[i];
+
+        const float dx = positionX[i] - eyeX;
+        const float dy = positionY[i] - eyeY;
+        const float dz = positionZ[i] - eyeZ;
+        distance[i] = alive ? std::sqrt(dx * dx + dy * dy + dz * dz) : DeadParticleDistance;
+    }
+}
+
+void ParticleSimulation::sortParticles()
+{
+    // Particles which were dead when simulated are respawned next step,
+    // the other ones are drawn
+    m_deadParticles.clear();
+    m_sortedParticles.clear();
+    for (size_t i = 0, m = size_t(m_particleCount); i < m; ++i) {
+        if (m_distance[i] < 0.0f)
+            m_deadParticles.push_back(quint32(i));
+        else
+            m_sortedParticles.push_back(quint32(i));
+    }
+
+    // Farthest first, ties keep the particle order so that runs are reproducible
+    std::sort(m_sortedParticles.begin(), m_sortedParticles.end(), [this](quint32 a, quint32 b) {
+        return m_distance[a] > m_distance[b] || (m_distance[a] == m_distance[b] && a < b);
+    });
+}
+
+// Uniformly distributed in [-1, 1), like the remapped noise texture of the
+// emit shader
+float ParticleSimulation::nextRandom()
+{
+    quint32 x = (m_randomState += 0x9e3779b9u);
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return float(x >> 8) * (2.0f / 16777216.0f) - 1.0f;
+}
+
+// Calls function(begin, end) over slices of [0, count), the last slice on
+// the calling thread
+template<typename Function>
+void ParticleSimulation::parallelFor(int count, Function &&function) const
+{
+    const int sliceCount = std::min(threadCount(), std::max(count / MinParticlesPerThread, 1));
+    if (sliceCount <= 1) {
+        function(0, count);
+        return;
+    }
+
+    QSemaphore finishedSlices;
+    QThreadPool *pool = QThreadPool::globalInstance();
+    for (int slice = 0; slice < sliceCount - 1; ++slice) {
+        const int begin = count * slice / sliceCount;
+        const int end = count * (slice + 1) / sliceCount;
+        const std::function<void()> runSlice = [&, begin, end] {
+            function(begin, end);
+            finishedSlices.release();
+        };
+        // Don't wait on a busy pool
+        if (!pool->tryStart(runSlice))
+            runSlice();
+    }
+    function(count * (sliceCount - 1) / sliceCount, count);
+    finishedSlices.acquire(sliceCount - 1);
+}
+
+/*!
+ * \internal
+ * \class Kuesa::ParticleSimulationEntity
+ * \brief Runs a ParticleSimulation every frame and streams it to a ParticleMesh
+ * \inmodule Kuesa
+ * \since Kuesa 1.4
+ *
+ * When active, the simulation takes its parameters from the ParticleMaterial,
+ * emits particles in the space of the parent Particles entity and sorts
+ * them for the camera of the first View of the ForwardRenderer, or of the
+ * ForwardRenderer itself when it has no sub views. The vertex buffer is
+ * shared by all the views, so the other views draw the particles in that
+ * same order.
+ */
+
+ParticleSimulationEntity::ParticleSimulationEntity(ParticleMaterial *material, ParticleMesh *mesh, Qt3DCore::QNode *parent)
+    : Qt3DCore::QEntity(parent)
+    , m_material(material)
+    , m_mesh(mesh)
+    , m_frameAction(new Qt3DLogic::QFrameAction(this))
+    , m_vertexBuffer(new Qt3DGeometry::QBuffer(this))
+{
+    m_frameAction->setEnabled(false);
+    addComponent(m_frameAction);
+    connect(m_frameAction, &Qt3DLogic::QFrameAction::triggered, this, &ParticleSimulationEntity::step);
+}
+
+void ParticleSimulationEntity::setActive(bool active)
+{
+    if (m_active == active)
+        return;
+    m_active = active;
+    m_frameAction->setEnabled(active);
+    // Start over from an empty system when switching back to the CPU
+    m_simulation.reset();
+    m_mesh->setInstanceCount(0);
+}
+
+bool ParticleSimulationEntity::isActive() const
+{
+    return m_active;
+}
+
+Qt3DGeometry::QBuffer *ParticleSimulationEntity::vertexBuffer() const
+{
+    return m_vertexBuffer;
+}
+
+const ParticleSimulation &ParticleSimulationEntity::simulation() const
+{
+    return m_simulation;
+}
+
+void ParticleSimulationEntity::step()
+{
+    ParticleSimulation::Parameters parameters;
+    parameters.maxParticlesEmittedPerFrame = m_material->maxParticlesEmittedPerFrame();
+    parameters.gravity = m_material->gravity();
+    parameters.emitterPosition = m_material->emitterPosition();
+    parameters.emitterPositionRandom = m_material->emitterPositionRandom();
+    parameters.emitterVelocity = m_material->emitterVelocity();
+    parameters.emitterVelocityRandom = m_material->emitterVelocityRandom();
+    parameters.particleLifespan = m_material->particleLifespan();
+    parameters.particleLifespanRandom = m_material->particleLifespanRandom();
+    parameters.initialSize = m_material->initialSize();
+    parameters.finalSize = m_material->finalSize();
+    parameters.initialColor = m_material->initialColor();
+    parameters.finalColor = m_material->finalColor();
+    parameters.initialAngle = m_material->initialAngle();
+    parameters.initialAngleRandom = m_material->initialAngleRandom();
+    parameters.rotationRate = m_material->rotationRate();
+    parameters.rotationRateRandom = m_material->rotationRateRandom();
+    parameters.modelMatrix = entityWorldMatrix(parentEntity());
+    m_simulation.setParameters(parameters);
+    m_simulation.setParticleCount(m_material->particleCount());
+
+    if (!m_forwardRenderer)
+        m_forwardRenderer = Utils::findForwardRenderer(this);
+    // Same view as the one the shadow cascades are fitted to
+    Qt3DCore::QEntity *camera = m_forwardRenderer ? m_forwardRenderer->shadowCascadeCamera() : nullptr;
+    const QVector3D eyePosition = camera
+            ? entityWorldMatrix(camera).column(3).toVector3D()
+            : QVector3D();
+
+    // Like the compute shaders, advance by frameTime whatever the actual
+    // time between frames
+    m_simulation.step(m_material->frameTime(), eyePosition);
+
+    const int aliveCount = m_simulation.aliveCount();
+    m_vertexData.resize(aliveCount * int(sizeof(ParticleSimulation::Vertex)));
+    m_simulation.writeVertices(reinterpret_cast<ParticleSimulation::Vertex *>(m_vertexData.data()));
+    m_vertexBuffer->setData(m_vertexData);
+    m_mesh->setInstanceCount(aliveCount);
+}
+
+} // namespace Kuesa
+
+QT_END_NAMESPACE
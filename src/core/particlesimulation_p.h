@@ -0,0 +1,196 @@
+/*
+    particlesimulation_p.h
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef KUESA_PARTICLESIMULATION_P_H
+#define KUESA_PARTICLESIMULATION_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Kuesa API.  It exists for the convenience
+// of other Kuesa classes.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <Kuesa/private/kuesa_global_p.h>
+#include <Qt3DCore/QEntity>
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+#include <Qt3DCore/QBuffer>
+#else
+#include <Qt3DRender/QBuffer>
+#endif
+#include <QByteArray>
+#include <QMatrix4x4>
+#include <QPointer>
+#include <QVector2D>
+#include <QVector3D>
+#include <QVector4D>
+#include <vector>
+
+QT_BEGIN_NAMESPACE
+
+namespace Qt3DLogic {
+class QFrameAction;
+}
+
+namespace Kuesa {
+
+class ForwardRenderer;
+class ParticleMaterial;
+class ParticleMesh;
+
+class KUESA_PRIVATE_EXPORT ParticleSimulation
+{
+public:
+    struct Parameters {
+        int maxParticlesEmittedPerFrame = 4;
+        QVector3D gravity;
+        QVector3D emitterPosition;
+        QVector3D emitterPositionRandom;
+        QVector3D emitterVelocity = QVector3D(0.0f, 1.0f, 0.0f);
+        QVector3D emitterVelocityRandom;
+        float particleLifespan = 1.0f;
+        float particleLifespanRandom = 0.0f;
+        QVector2D initialSize = QVector2D(1.0f, 1.0f);
+        QVector2D finalSize = QVector2D(1.0f, 1.0f);
+        QVector4D initialColor = QVector4D(1.0f, 1.0f, 1.0f, 1.0f);
+        QVector4D finalColor = QVector4D(1.0f, 1.0f, 1.0f, 1.0f);
+        float initialAngle = 0.0f;
+        float initialAngleRandom = 0.0f;
+        float rotationRate = 0.0f;
+        float rotationRateRandom = 0.0f;
+        // Transforms the emitter position and velocity to world space
+        QMatrix4x4 modelMatrix;
+    };
+
+    // Per particle data streamed to the vertex buffer, one instance per
+    // alive particle
+    struct Vertex {
+        float position[3];
+        float rotation;
+        float velocity[3];
+        float size[2];
+        float color[4];
+    };
+
+    explicit ParticleSimulation(quint32 seed = 0);
+
+    void setParticleCount(int particleCount);
+    int particleCount() const;
+
+    void setSeed(quint32 seed);
+    quint32 seed() const;
+
+    // 0 uses QThread::idealThreadCount()
+    void setThreadCount(int threadCount);
+    int threadCount() const;
+
+    void setParameters(const Parameters &parameters);
+    const Parameters &parameters() const;
+
+    void reset();
+    void step(float frameTime, const QVector3D &eyePosition);
+
+    int aliveCount() const;
+    // Alive particles, sorted back to front
+    const std::vector<quint32> &sortedParticles() const;
+    void writeVertices(Vertex *vertices) const;
+
+    bool isAlive(int particle) const;
+    QVector3D position(int particle) const;
+    QVector3D velocity(int particle) const;
+    float age(int particle) const;
+    float lifespan(int particle) const;
+    float rotation(int particle) const;
+
+private:
+    void emitParticles();
+    void simulate(int begin, int end, float frameTime, const QVector3D &eyePosition);
+    void sortParticles();
+    float nextRandom();
+
+    template<typename Function>
+    void parallelFor(int count, Function &&function) const;
+
+    int m_particleCount = 0;
+    quint32 m_seed = 0;
+    quint32 m_randomState = 0;
+    int m_threadCount = 0;
+    Parameters m_parameters;
+
+    // Particle state, one array per component. Dead particles have a
+    // negative age.
+    std::vector<float> m_positionX;
+    std::vector<float> m_positionY;
+    std::vector<float> m_positionZ;
+    std::vector<float> m_velocityX;
+    std::vector<float> m_velocityY;
+    std::vector<float> m_velocityZ;
+    std::vector<float> m_age;
+    std::vector<float> m_lifespan;
+    std::vector<float> m_rotation;
+    std::vector<float> m_rotationRate;
+    std::vector<float> m_distance;
+
+    std::vector<quint32> m_deadParticles;
+    std::vector<quint32> m_sortedParticles;
+};
+
+class KUESA_PRIVATE_EXPORT ParticleSimulationEntity : public Qt3DCore::QEntity
+{
+    Q_OBJECT
+public:
+    ParticleSimulationEntity(ParticleMaterial *material, ParticleMesh *mesh, Qt3DCore::QNode *parent = nullptr);
+
+    void setActive(bool active);
+    bool isActive() const;
+
+    Qt3DGeometry::QBuffer *vertexBuffer() const;
+    const ParticleSimulation &simulation() const;
+
+private:
+    void step();
+
+    ParticleMaterial *m_material;
+    ParticleMesh *m_mesh;
+    Qt3DLogic::QFrameAction *m_frameAction;
+    Qt3DGeometry::QBuffer *m_vertexBuffer;
+    QPointer<ForwardRenderer> m_forwardRenderer;
+    ParticleSimulation m_simulation;
+    QByteArray m_vertexData;
+    bool m_active = false;
+};
+
+} // namespace Kuesa
+
+QT_END_NAMESPACE
+
+#endif // KUESA_PARTICLESIMULATION_P_H
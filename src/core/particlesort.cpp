@@ -0,0 +1,130 @@
+/*
+    particlesort.cpp
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "particlesort_p.h"
+#include <algorithm>
+#include <limits>
+
+QT_BEGIN_NAMESPACE
+
+namespace Kuesa {
+
+namespace ParticleSort {
+
+namespace {
+
+bool outOfOrder(const QVector2D &a, const QVector2D &b, int i, int blockSize)
+{
+    return (i & blockSize) == 0 ? a.x() < b.x() : a.x() > b.x();
+}
+
+void compareAndExchange(std::vector<QVector2D> &keys, int i, int ixj, int blockSize)
+{
+    if (outOfOrder(keys[i], keys[ixj], i, blockSize))
+        std::swap(keys[i], keys[ixj]);
+}
+
+void localSteps(std::vector<QVector2D> &keys, int blockOffset, int localSize, int stride, int blockSize)
+{
+    for (int j = stride; j > 0; j >>= 1) {
+        for (int i = blockOffset, end = blockOffset + localSize; i < end; ++i) {
+            const int ixj = i ^ j;
+            if (ixj > i)
+                compareAndExchange(keys, i, ixj, blockSize);
+        }
+    }
+}
+
+} // namespace
+
+int sortSize(int particleCount)
+{
+    int size = 1;
+    while (size < particleCount)
+        size <<= 1;
+    return particleCount > 0 ? size : 0;
+}
+
+std::vector<Pass> passes(int maxParticleCount)
+{
+    std::vector<Pass> result = { { 0, 0 } };
+    const quint32 maxSortSize = quint32(sortSize(maxParticleCount));
+    for (quint32 k = 2 * LocalSortSize; k <= maxSortSize; k <<= 1) {
+        for (quint32 j = k >> 1; j >= quint32(LocalSortSize); j >>= 1)
+            result.push_back({ k, j });
+        result.push_back({ k, LocalSortSize >> 1 });
+    }
+    return result;
+}
+
+void bitonicSort(std::vector<QVector2D> &keys, int maxParticleCount)
+{
+    const int particleCount = int(keys.size());
+    const int size = sortSize(particleCount);
+    keys.resize(size, QVector2D(-std::numeric_limits<float>::max(), -1.0f));
+
+    const int localSize = std::min(size, LocalSortSize);
+    for (const Pass &pass : passes(maxParticleCount)) {
+        const int blockSize = int(pass.blockSize);
+        const int stride = int(pass.stride);
+        if (blockSize > size)
+            continue;
+
+        if (blockSize != 0 && stride >= LocalSortSize) {
+            for (int pair = 0; pair < size / 2; ++pair) {
+                const int i = 2 * stride * (pair / stride) + (pair % stride);
+                compareAndExchange(keys, i, i + stride, blockSize);
+            }
+            continue;
+        }
+
+        for (int blockOffset = 0; blockOffset < size; blockOffset += localSize) {
+            if (blockSize == 0) {
+                for (int k = 2; k <= localSize; k <<= 1)
+                    localSteps(keys, blockOffset, localSize, k >> 1, k);
+            } else {
+                localSteps(keys, blockOffset, localSize, stride, blockSize);
+            }
+        }
+    }
+
+    keys.resize(particleCount);
+}
+
+void referenceSort(std::vector<QVector2D> &keys)
+{
+    std::stable_sort(keys.begin(), keys.end(), [](const QVector2D &a, const QVector2D &b) {
+        return a.x() > b.x();
+    });
+}
+
+} // namespace ParticleSort
+
+} // namespace Kuesa
+
+QT_END_NAMESPACE
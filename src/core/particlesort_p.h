@@ -0,0 +1,93 @@
+/*
+    particlesort_p.h
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef KUESA_PARTICLESORT_P_H
+#define KUESA_PARTICLESORT_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Kuesa API.  It exists for the convenience
+// of other Kuesa classes.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <Kuesa/private/kuesa_global_p.h>
+#include <QVector2D>
+#include <vector>
+
+QT_BEGIN_NAMESPACE
+
+namespace Kuesa {
+
+// Schedule and CPU reference of the multi pass bitonic sort performed by
+// particlesort.comp. Sort keys are (distance, particle index) pairs sorted by
+// decreasing distance. The shader constants must be kept in sync.
+namespace ParticleSort {
+
+// Elements sorted by a work group in shared memory
+const int LocalSortSize = 2048;
+// Largest particle count the sort passes of the ParticleRenderStage handle,
+// larger particle counts are clamped with a warning
+const int MaxParticleCount = 65536;
+
+// One dispatch of particlesort.comp:
+// - blockSize 0: each work group sorts LocalSortSize keys, running all the
+//   steps of the bitonic network up to blocks of LocalSortSize keys
+// - stride >= LocalSortSize: a single compare and exchange step across the
+//   whole buffer
+// - stride < LocalSortSize: each work group runs the remaining steps of the
+//   merge of blocks of blockSize keys on its LocalSortSize keys
+struct Pass {
+    quint32 blockSize;
+    quint32 stride;
+};
+
+KUESA_PRIVATE_EXPORT int sortSize(int particleCount);
+
+// Passes needed to sort up to maxParticleCount keys, the passes for fewer keys
+// are the first ones of the passes for more keys
+KUESA_PRIVATE_EXPORT std::vector<Pass> passes(int maxParticleCount = MaxParticleCount);
+
+// Runs the passes the same way the shader does on keys padded to the next
+// power of two
+KUESA_PRIVATE_EXPORT void bitonicSort(std::vector<QVector2D> &keys, int maxParticleCount = MaxParticleCount);
+
+// Stable reference ordering: decreasing distance
+KUESA_PRIVATE_EXPORT void referenceSort(std::vector<QVector2D> &keys);
+
+} // namespace ParticleSort
+
+} // namespace Kuesa
+
+QT_END_NAMESPACE
+
+#endif // KUESA_PARTICLESORT_P_H
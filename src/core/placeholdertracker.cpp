@@ -32,6 +32,7 @@
 #include <Qt3DCore/private/qmath3d_p.h>
 #include <Qt3DCore/private/qnode_p.h>
 #include <Kuesa/private/logging_p.h>
+#include <Kuesa/private/profiler_p.h>
 
 QT_BEGIN_NAMESPACE
 
@@ -500,6 +501,7 @@ void PlaceholderTracker::matchNode()
  */
 void PlaceholderTracker::updatePlaceholderProjection()
 {
+    ProfilerScope scope("trackers", "placeholderTracker");
     if (m_camera && m_placeHolderTransform && m_cameraTransform && m_cameraLens) {
         QVector3D position;
         QQuaternion orientation;
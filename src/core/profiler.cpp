@@ -0,0 +1,201 @@
+/*
+    profiler.cpp
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "profiler_p.h"
+#include <QCoreApplication>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutexLocker>
+#include <QThread>
+#include <algorithm>
+#include <cstring>
+
+QT_BEGIN_NAMESPACE
+
+using namespace Kuesa;
+
+namespace {
+
+const int defaultCapacity = 4096;
+
+} // namespace
+
+QAtomicInt Profiler::s_enabled(qEnvironmentVariableIntValue("KUESA_PROFILING") != 0 ? 1 : 0);
+
+Profiler::Profiler()
+    : m_events(defaultCapacity)
+{
+    m_timer.start();
+}
+
+Profiler *Profiler::instance()
+{
+    static Profiler profiler;
+    return &profiler;
+}
+
+void Profiler::setEnabled(bool enabled)
+{
+    s_enabled.storeRelaxed(enabled ? 1 : 0);
+}
+
+void Profiler::setCapacity(int capacity)
+{
+    capacity = std::max(1, capacity);
+    const std::vector<Event> current = events();
+
+    QMutexLocker lock(&m_mutex);
+    m_events.assign(size_t(capacity), Event{});
+    // Keep the most recent events
+    const size_t kept = std::min(current.size(), size_t(capacity));
+    std::copy(current.end() - std::ptrdiff_t(kept), current.end(), m_events.begin());
+    m_eventCount = kept;
+    m_nextEvent = kept % size_t(capacity);
+    ++m_revision;
+}
+
+int Profiler::capacity() const
+{
+    QMutexLocker lock(&m_mutex);
+    return int(m_events.size());
+}
+
+void Profiler::clear()
+{
+    QMutexLocker lock(&m_mutex);
+    m_nextEvent = 0;
+    m_eventCount = 0;
+    m_counters.clear();
+    ++m_revision;
+}
+
+qint64 Profiler::timestamp() const
+{
+    return m_timer.nsecsElapsed();
+}
+
+void Profiler::addEvent(const char *category, const char *name, qint64 start, qint64 duration)
+{
+    const quint64 threadId = quint64(quintptr(QThread::currentThreadId()));
+
+    QMutexLocker lock(&m_mutex);
+    m_events[m_nextEvent] = { category, name, start, duration, threadId };
+    m_nextEvent = (m_nextEvent + 1) % m_events.size();
+    m_eventCount = std::min(m_eventCount + 1, m_events.size());
+    ++m_revision;
+}
+
+void Profiler::addCount(const char *category, const char *name, qint64 delta)
+{
+    QMutexLocker lock(&m_mutex);
+    m_counters[{ category, name }] += delta;
+    ++m_revision;
+}
+
+std::vector<Profiler::Event> Profiler::events() const
+{
+    QMutexLocker lock(&m_mutex);
+    std::vector<Event> events;
+    events.reserve(m_eventCount);
+    const size_t first = (m_nextEvent + m_events.size() - m_eventCount) % m_events.size();
+    for (size_t i = 0; i < m_eventCount; ++i)
+        events.push_back(m_events[(first + i) % m_events.size()]);
+    return events;
+}
+
+std::vector<Profiler::Counter> Profiler::counters() const
+{
+    QMutexLocker lock(&m_mutex);
+    std::vector<Counter> counters;
+    counters.reserve(m_counters.size());
+    for (const auto &c : m_counters) {
+        // The same literal can have different addresses in different
+        // translation units, merge counters by name
+        auto it = std::find_if(counters.begin(), counters.end(), [&c](const Counter &counter) {
+            return std::strcmp(counter.category, c.first.first) == 0 &&
+                    std::strcmp(counter.name, c.first.second) == 0;
+        });
+        if (it != counters.end())
+            it->value += c.second;
+        else
+            counters.push_back({ c.first.first, c.first.second, c.second });
+    }
+    return counters;
+}
+
+quint64 Profiler::revision() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_revision;
+}
+
+/*!
+    \internal
+
+    Returns the recorded events and the current value of the counters in the
+    Trace Event Format understood by chrome://tracing and Perfetto.
+*/
+QByteArray Profiler::toChromeTrace() const
+{
+    const qint64 pid = QCoreApplication::applicationPid();
+    QJsonArray traceEvents;
+
+    const std::vector<Event> recordedEvents = events();
+    for (const Event &e : recordedEvents) {
+        traceEvents.push_back(QJsonObject{
+                { QStringLiteral("name"), QLatin1String(e.name) },
+                { QStringLiteral("cat"), QLatin1String(e.category) },
+                { QStringLiteral("ph"), QStringLiteral("X") },
+                { QStringLiteral("ts"), double(e.start) / 1000.0 },
+                { QStringLiteral("dur"), double(e.duration) / 1000.0 },
+                { QStringLiteral("pid"), pid },
+                { QStringLiteral("tid"), qint64(e.threadId) },
+        });
+    }
+
+    const double now = double(timestamp()) / 1000.0;
+    const std::vector<Counter> recordedCounters = counters();
+    for (const Counter &c : recordedCounters) {
+        traceEvents.push_back(QJsonObject{
+                { QStringLiteral("name"), QLatin1String(c.category) },
+                { QStringLiteral("ph"), QStringLiteral("C") },
+                { QStringLiteral("ts"), now },
+                { QStringLiteral("pid"), pid },
+                { QStringLiteral("args"), QJsonObject{ { QLatin1String(c.name), c.value } } },
+        });
+    }
+
+    const QJsonObject root{
+        { QStringLiteral("traceEvents"), traceEvents },
+        { QStringLiteral("displayTimeUnit"), QStringLiteral("ms") },
+    };
+    return QJsonDocument(root).toJson(QJsonDocument::Compact);
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,156 @@
+/*
+    profiler_p.h
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef KUESA_PROFILER_P_H
+#define KUESA_PROFILER_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Kuesa API.  It exists for the convenience
+// of other Kuesa classes.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <Kuesa/private/kuesa_global_p.h>
+#include <QAtomicInt>
+#include <QByteArray>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <map>
+#include <utility>
+#include <vector>
+
+QT_BEGIN_NAMESPACE
+
+namespace Kuesa {
+
+// Records the duration of scopes and the value of counters across the whole
+// process. Scopes are kept in a ring buffer holding the most recent ones,
+// counters accumulate until cleared.
+//
+// Recording is disabled by default, unless the KUESA_PROFILING environment
+// variable is set to a non zero value. While disabled, a scope or counter
+// costs a single atomic load. While enabled, each of them also locks m_mutex
+// to record itself, which serializes recording threads, and scopes read the
+// timer twice. Categories and names are expected to be string literals, they are
+// stored as is.
+class KUESA_PRIVATE_EXPORT Profiler
+{
+public:
+    struct Event {
+        const char *category;
+        const char *name;
+        qint64 start; // ns since the profiler was created
+        qint64 duration; // ns
+        quint64 threadId;
+    };
+
+    struct Counter {
+        const char *category;
+        const char *name;
+        qint64 value;
+    };
+
+    static Profiler *instance();
+
+    static bool isEnabled() { return s_enabled.loadRelaxed() != 0; }
+    static void setEnabled(bool enabled);
+
+    static void count(const char *category, const char *name, qint64 delta = 1)
+    {
+        if (isEnabled())
+            instance()->addCount(category, name, delta);
+    }
+
+    void setCapacity(int capacity);
+    int capacity() const;
+    void clear();
+
+    qint64 timestamp() const;
+    void addEvent(const char *category, const char *name, qint64 start, qint64 duration);
+    void addCount(const char *category, const char *name, qint64 delta);
+
+    // Oldest event first
+    std::vector<Event> events() const;
+    std::vector<Counter> counters() const;
+
+    // Incremented whenever something is recorded or cleared
+    quint64 revision() const;
+
+    QByteArray toChromeTrace() const;
+
+private:
+    Profiler();
+
+    static QAtomicInt s_enabled;
+
+    mutable QMutex m_mutex;
+    QElapsedTimer m_timer;
+    std::vector<Event> m_events;
+    size_t m_nextEvent = 0;
+    size_t m_eventCount = 0;
+    std::map<std::pair<const char *, const char *>, qint64> m_counters;
+    quint64 m_revision = 0;
+};
+
+// Records the time spent between its construction and its destruction
+class ProfilerScope
+{
+public:
+    ProfilerScope(const char *category, const char *name)
+        : m_category(category)
+        , m_name(name)
+        , m_start(Profiler::isEnabled() ? Profiler::instance()->timestamp() : -1)
+    {
+    }
+
+    ~ProfilerScope()
+    {
+        if (m_start < 0)
+            return;
+        Profiler *profiler = Profiler::instance();
+        profiler->addEvent(m_category, m_name, m_start, profiler->timestamp() - m_start);
+    }
+
+private:
+    Q_DISABLE_COPY(ProfilerScope)
+
+    const char *m_category;
+    const char *m_name;
+    const qint64 m_start;
+};
+
+} // namespace Kuesa
+
+QT_END_NAMESPACE
+
+#endif // KUESA_PROFILER_P_H
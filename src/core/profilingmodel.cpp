@@ -0,0 +1,334 @@
+/*
+    profilingmodel.cpp
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "profilingmodel.h"
+#include "profiler_p.h"
+#include <QFile>
+#include <algorithm>
+#include <map>
+
+QT_BEGIN_NAMESPACE
+
+using namespace Kuesa;
+
+/*!
+    \class Kuesa::ProfilingModel
+    \inheaderfile Kuesa/ProfilingModel
+    \inmodule Kuesa
+    \since Kuesa 1.4
+
+    \brief Kuesa::ProfilingModel exposes the time spent in the main steps of
+    Kuesa and the value of its counters.
+
+    Kuesa records the duration of the glTF importer phases, frame graph
+    rebuilds and tracker updates, as well as counters such as the number of
+    assets added to or removed from the collections. Recording is shared by
+    the whole process, it is enabled through the enabled property or by
+    setting the KUESA_PROFILING environment variable to 1.
+
+    The most recent timings are kept in a ring buffer. The model aggregates
+    them into one row per timed step and one row per counter, and refreshes
+    itself every refreshInterval milliseconds, which makes it suitable for
+    on screen overlays.
+
+    The raw timings can also be exported in the Trace Event Format and loaded
+    in chrome://tracing or Perfetto.
+
+    \badcode
+    Kuesa::ProfilingModel model;
+    model.setEnabled(true);
+    ...
+    model.exportChromeTrace(QStringLiteral("kuesa_trace.json"));
+    \endcode
+*/
+
+/*!
+    \qmltype ProfilingModel
+    \instantiates Kuesa::ProfilingModel
+    \inqmlmodule Kuesa
+    \since Kuesa 1.4
+
+    \brief ProfilingModel exposes the time spent in the main steps of Kuesa and
+    the value of its counters.
+
+    \badcode
+    import Kuesa 1.4 as Kuesa
+
+    ListView {
+        model: Kuesa.ProfilingModel {
+            enabled: true
+        }
+        delegate: Text {
+            text: model.kind === Kuesa.ProfilingModel.Timer
+                  ? model.name + ": " + model.averageTime.toFixed(2) + "ms"
+                  : model.name + ": " + model.value
+        }
+    }
+    \endcode
+
+    Each row provides the name, category, kind, count, totalTime, averageTime,
+    maxTime, lastTime and value roles. Times are expressed in milliseconds.
+*/
+
+/*!
+    \property Kuesa::ProfilingModel::enabled
+
+    Whether Kuesa records timings and counters. This is shared by the whole
+    process. Defaults to false unless the KUESA_PROFILING environment variable
+    is set.
+*/
+
+/*!
+    \qmlproperty bool ProfilingModel::enabled
+
+    Whether Kuesa records timings and counters. This is shared by the whole
+    process. Defaults to false unless the KUESA_PROFILING environment variable
+    is set.
+*/
+
+/*!
+    \property Kuesa::ProfilingModel::refreshInterval
+
+    Interval in milliseconds at which the model is updated from the recorded
+    data. Defaults to 1000. When 0, the model is only updated when refresh()
+    is called.
+*/
+
+/*!
+    \qmlproperty int ProfilingModel::refreshInterval
+
+    Interval in milliseconds at which the model is updated from the recorded
+    data. Defaults to 1000. When 0, the model is only updated when refresh()
+    is called.
+*/
+
+/*!
+    \property Kuesa::ProfilingModel::count
+    \readonly
+
+    Number of rows of the model.
+*/
+
+/*!
+    \qmlproperty int ProfilingModel::count
+    \readonly
+
+    Number of rows of the model.
+*/
+
+ProfilingModel::ProfilingModel(QObject *parent)
+    : QAbstractListModel(parent)
+    , m_revision(0)
+{
+    QObject::connect(&m_refreshTimer, &QTimer::timeout, this, &ProfilingModel::refresh);
+    m_refreshTimer.setInterval(1000);
+    m_refreshTimer.start();
+    refresh();
+}
+
+ProfilingModel::~ProfilingModel() = default;
+
+bool ProfilingModel::isEnabled() const
+{
+    return Profiler::isEnabled();
+}
+
+void ProfilingModel::setEnabled(bool enabled)
+{
+    if (enabled == Profiler::isEnabled())
+        return;
+    Profiler::setEnabled(enabled);
+    emit enabledChanged(enabled);
+}
+
+int ProfilingModel::refreshInterval() const
+{
+    return m_refreshTimer.isActive() ? m_refreshTimer.interval() : 0;
+}
+
+void ProfilingModel::setRefreshInterval(int refreshInterval)
+{
+    refreshInterval = std::max(0, refreshInterval);
+    if (refreshInterval == this->refreshInterval())
+        return;
+    if (refreshInterval > 0)
+        m_refreshTimer.start(refreshInterval);
+    else
+        m_refreshTimer.stop();
+    emit refreshIntervalChanged(refreshInterval);
+}
+
+int ProfilingModel::count() const
+{
+    return int(m_rows.size());
+}
+
+int ProfilingModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid())
+        return 0;
+    return count();
+}
+
+QVariant ProfilingModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= count())
+        return {};
+
+    const Row &row = m_rows[size_t(index.row())];
+    const auto toMs = [](qint64 ns) { return double(ns) / 1.0e6; };
+    switch (role) {
+    case Qt::DisplayRole:
+    case NameRole:
+        return QString::fromLatin1(row.name);
+    case CategoryRole:
+        return QString::fromLatin1(row.category);
+    case KindRole:
+        return row.kind;
+    case CountRole:
+        return row.count;
+    case TotalTimeRole:
+        return toMs(row.totalTime);
+    case AverageTimeRole:
+        return row.count > 0 ? toMs(row.totalTime) / row.count : 0.0;
+    case MaxTimeRole:
+        return toMs(row.maxTime);
+    case LastTimeRole:
+        return toMs(row.lastTime);
+    case ValueRole:
+        return row.value;
+    default:
+        return {};
+    }
+}
+
+QHash<int, QByteArray> ProfilingModel::roleNames() const
+{
+    return {
+        { NameRole, QByteArrayLiteral("name") },
+        { CategoryRole, QByteArrayLiteral("category") },
+        { KindRole, QByteArrayLiteral("kind") },
+        { CountRole, QByteArrayLiteral("count") },
+        { TotalTimeRole, QByteArrayLiteral("totalTime") },
+        { AverageTimeRole, QByteArrayLiteral("averageTime") },
+        { MaxTimeRole, QByteArrayLiteral("maxTime") },
+        { LastTimeRole, QByteArrayLiteral("lastTime") },
+        { ValueRole, QByteArrayLiteral("value") },
+    };
+}
+
+/*!
+    Updates the model from the timings and counters recorded so far.
+ */
+void ProfilingModel::refresh()
+{
+    Profiler *profiler = Profiler::instance();
+    const quint64 revision = profiler->revision();
+    if (revision == m_revision)
+        return;
+    m_revision = revision;
+
+    // Aggregate the events of the ring buffer per category and name
+    std::map<std::pair<QByteArray, QByteArray>, Row> timers;
+    const std::vector<Profiler::Event> events = profiler->events();
+    for (const Profiler::Event &e : events) {
+        const QByteArray category(e.category);
+        const QByteArray name(e.name);
+        auto it = timers.find({ category, name });
+        if (it == timers.end())
+            it = timers.insert({ { category, name }, Row{ category, name, Timer, 0, 0, 0, 0, 0 } }).first;
+        Row &row = it->second;
+        ++row.count;
+        row.totalTime += e.duration;
+        row.maxTime = std::max(row.maxTime, e.duration);
+        row.lastTime = e.duration;
+    }
+
+    std::vector<Row> rows;
+    rows.reserve(timers.size());
+    for (const auto &t : timers)
+        rows.push_back(t.second);
+
+    std::vector<Profiler::Counter> counters = profiler->counters();
+    std::sort(counters.begin(), counters.end(), [](const Profiler::Counter &a, const Profiler::Counter &b) {
+        return std::make_pair(QByteArray(a.category), QByteArray(a.name)) <
+                std::make_pair(QByteArray(b.category), QByteArray(b.name));
+    });
+    for (const Profiler::Counter &c : counters)
+        rows.push_back(Row{ c.category, c.name, Counter, 0, 0, 0, 0, c.value });
+
+    const bool sameRows = rows.size() == m_rows.size() &&
+            std::equal(rows.begin(), rows.end(), m_rows.begin(), [](const Row &a, const Row &b) {
+                return a.kind == b.kind && a.category == b.category && a.name == b.name;
+            });
+
+    if (sameRows) {
+        m_rows = std::move(rows);
+        if (!m_rows.empty())
+            emit dataChanged(index(0), index(count() - 1));
+        return;
+    }
+
+    beginResetModel();
+    m_rows = std::move(rows);
+    endResetModel();
+    emit countChanged(count());
+}
+
+/*!
+    Discards the timings and counters recorded so far.
+ */
+void ProfilingModel::clear()
+{
+    Profiler::instance()->clear();
+    refresh();
+}
+
+/*!
+    Returns the recorded timings and counters in the Trace Event Format.
+ */
+QByteArray ProfilingModel::chromeTrace() const
+{
+    return Profiler::instance()->toChromeTrace();
+}
+
+/*!
+    Writes the recorded timings and counters in the Trace Event Format to \a
+    fileName, so that they can be loaded in chrome://tracing or Perfetto.
+    Returns false if the file couldn't be written.
+ */
+bool ProfilingModel::exportChromeTrace(const QString &fileName) const
+{
+    QFile f(fileName);
+    if (!f.open(QIODevice::WriteOnly))
+        return false;
+    const QByteArray trace = chromeTrace();
+    return f.write(trace) == trace.size();
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,115 @@
+/*
+    profilingmodel.h
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef KUESA_PROFILINGMODEL_H
+#define KUESA_PROFILINGMODEL_H
+
+#include <Kuesa/kuesa_global.h>
+#include <QAbstractListModel>
+#include <QByteArray>
+#include <QTimer>
+#include <vector>
+
+QT_BEGIN_NAMESPACE
+
+namespace Kuesa {
+
+class KUESASHARED_EXPORT ProfilingModel : public QAbstractListModel
+{
+    Q_OBJECT
+    Q_PROPERTY(bool enabled READ isEnabled WRITE setEnabled NOTIFY enabledChanged)
+    Q_PROPERTY(int refreshInterval READ refreshInterval WRITE setRefreshInterval NOTIFY refreshIntervalChanged)
+    Q_PROPERTY(int count READ count NOTIFY countChanged)
+
+public:
+    enum Kind {
+        Timer,
+        Counter
+    };
+    Q_ENUM(Kind)
+
+    enum Roles {
+        NameRole = Qt::UserRole + 1,
+        CategoryRole,
+        KindRole,
+        CountRole,
+        TotalTimeRole,
+        AverageTimeRole,
+        MaxTimeRole,
+        LastTimeRole,
+        ValueRole
+    };
+    Q_ENUM(Roles)
+
+    explicit ProfilingModel(QObject *parent = nullptr);
+    ~ProfilingModel();
+
+    bool isEnabled() const;
+    int refreshInterval() const;
+    int count() const;
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QHash<int, QByteArray> roleNames() const override;
+
+    Q_INVOKABLE QByteArray chromeTrace() const;
+    Q_INVOKABLE bool exportChromeTrace(const QString &fileName) const;
+
+public Q_SLOTS:
+    void setEnabled(bool enabled);
+    void setRefreshInterval(int refreshInterval);
+    void refresh();
+    void clear();
+
+Q_SIGNALS:
+    void enabledChanged(bool enabled);
+    void refreshIntervalChanged(int refreshInterval);
+    void countChanged(int count);
+
+private:
+    struct Row {
+        QByteArray category;
+        QByteArray name;
+        Kind kind;
+        int count;
+        qint64 totalTime;
+        qint64 maxTime;
+        qint64 lastTime;
+        qint64 value;
+    };
+
+    QTimer m_refreshTimer;
+    std::vector<Row> m_rows;
+    quint64 m_revision;
+};
+
+} // namespace Kuesa
+
+QT_END_NAMESPACE
+
+#endif // KUESA_PROFILINGMODEL_H
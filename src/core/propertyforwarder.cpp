@@ -0,0 +1,268 @@
+/*
+    propertyforwarder.cpp
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "propertyforwarder_p.h"
+
+#include <QColor>
+#include <QMatrix4x4>
+#include <QMetaProperty>
+#include <QQuaternion>
+#include <QVector2D>
+#include <QVector3D>
+#include <QVector4D>
+#include <algorithm>
+#include <map>
+
+QT_BEGIN_NAMESPACE
+
+namespace Kuesa {
+
+namespace {
+
+// Same arguments as QMetaProperty::read/write, without the QVariant
+template<typename From, typename To>
+void copyValue(QObject *from, int fromIndex, QObject *to, int toIndex)
+{
+    From value{};
+    int status = -1;
+    int flags = 0;
+    void *readArgs[] = { &value, nullptr, &status, &flags };
+    QMetaObject::metacall(from, QMetaObject::ReadProperty, fromIndex, readArgs);
+
+    To converted(static_cast<To>(value));
+    void *writeArgs[] = { &converted, nullptr, &status, &flags };
+    QMetaObject::metacall(to, QMetaObject::WriteProperty, toIndex, writeArgs);
+}
+
+void copyVariant(QObject *from, int fromIndex, QObject *to, int toIndex)
+{
+    const QVariant v = from->metaObject()->property(fromIndex).read(from);
+    if (v.isValid())
+        to->metaObject()->property(toIndex).write(to, v);
+}
+
+} // namespace
+
+PropertyForwarder::PropertyForwarder(QObject *parent)
+    : QObject(parent)
+    , m_table(nullptr)
+    , m_flushScheduled(false)
+    , m_writing(None)
+{
+}
+
+const PropertyForwarder::Table *PropertyForwarder::table(const QMetaObject *sourceType, const QMetaObject *targetType)
+{
+    // QML objects have a meta object per instance, tables are shared per class
+    static std::map<std::pair<QByteArray, QByteArray>, Table> tables;
+
+    const auto key = std::make_pair(QByteArray(sourceType->className()), QByteArray(targetType->className()));
+    auto it = tables.find(key);
+    if (it != tables.end())
+        return &it->second;
+
+    Table &result = tables[key];
+    for (int i = sourceType->propertyOffset(), m = sourceType->propertyCount(); i < m; ++i) {
+        const QMetaProperty sourceProperty = sourceType->property(i);
+        const int targetIndex = targetType->indexOfProperty(sourceProperty.name());
+        if (targetIndex == -1)
+            continue;
+
+        const QMetaProperty targetProperty = targetType->property(targetIndex);
+        if (!targetProperty.hasNotifySignal())
+            continue;
+
+        Copier toTarget = copier(sourceProperty.userType(), targetProperty.userType());
+        Copier toSource = copier(targetProperty.userType(), sourceProperty.userType());
+        const int bindingIndex = int(result.bindings.size());
+        result.bindings.push_back({ i, targetIndex,
+                                    sourceProperty.isWritable(), targetProperty.isWritable(),
+                                    toTarget ? toTarget : &copyVariant,
+                                    toSource ? toSource : &copyVariant });
+        if (sourceProperty.hasNotifySignal())
+            result.sourceSignals[sourceProperty.notifySignalIndex()].push_back(bindingIndex);
+        result.targetSignals[targetProperty.notifySignalIndex()].push_back(bindingIndex);
+    }
+    return &result;
+}
+
+PropertyForwarder::Copier PropertyForwarder::copier(int fromType, int toType)
+{
+    if (fromType == toType) {
+        switch (fromType) {
+        case QMetaType::Bool:
+            return &copyValue<bool, bool>;
+        case QMetaType::Int:
+            return &copyValue<int, int>;
+        case QMetaType::Float:
+            return &copyValue<float, float>;
+        case QMetaType::Double:
+            return &copyValue<double, double>;
+        case QMetaType::QVector2D:
+            return &copyValue<QVector2D, QVector2D>;
+        case QMetaType::QVector3D:
+            return &copyValue<QVector3D, QVector3D>;
+        case QMetaType::QVector4D:
+            return &copyValue<QVector4D, QVector4D>;
+        case QMetaType::QQuaternion:
+            return &copyValue<QQuaternion, QQuaternion>;
+        case QMetaType::QColor:
+            return &copyValue<QColor, QColor>;
+        case QMetaType::QMatrix4x4:
+            return &copyValue<QMatrix4x4, QMatrix4x4>;
+        default:
+            return nullptr;
+        }
+    }
+
+    // QML reals are doubles while node properties are mostly floats
+    if (fromType == QMetaType::Double && toType == QMetaType::Float)
+        return &copyValue<double, float>;
+    if (fromType == QMetaType::Float && toType == QMetaType::Double)
+        return &copyValue<float, double>;
+    return nullptr;
+}
+
+void PropertyForwarder::setObjects(QObject *source, QObject *target)
+{
+    clear();
+    if (!source || !target)
+        return;
+
+    m_source = source;
+    m_target = target;
+    m_table = table(source->metaObject(), target->metaObject());
+    m_pending.assign(m_table->bindings.size(), None);
+
+    for (const Binding &binding : m_table->bindings) {
+        // Set values on source properties from target properties
+        // This can only be done if the source property is not readonly
+        copy(binding, ToSource);
+        // Set values from source properties to target properties
+        copy(binding, ToTarget);
+    }
+
+    connectSignals(source, m_table->sourceSignals);
+    connectSignals(target, m_table->targetSignals);
+}
+
+void PropertyForwarder::clear()
+{
+    for (const QMetaObject::Connection &connection : m_connections)
+        QObject::disconnect(connection);
+    m_connections.clear();
+    m_pending.clear();
+    m_table = nullptr;
+    m_source = nullptr;
+    m_target = nullptr;
+}
+
+QObject *PropertyForwarder::source() const
+{
+    return m_source;
+}
+
+QObject *PropertyForwarder::target() const
+{
+    return m_target;
+}
+
+int PropertyForwarder::bindingCount() const
+{
+    return m_table ? int(m_table->bindings.size()) : 0;
+}
+
+bool PropertyForwarder::hasPendingChanges() const
+{
+    return std::any_of(m_pending.begin(), m_pending.end(), [](quint8 pending) { return pending != None; });
+}
+
+void PropertyForwarder::flush()
+{
+    m_flushScheduled = false;
+    if (!m_source || !m_target || !m_table)
+        return;
+
+    for (size_t i = 0, m = m_pending.size(); i < m; ++i) {
+        const quint8 pending = m_pending[i];
+        if (pending == None)
+            continue;
+        m_pending[i] = None;
+
+        // Changes made to the source win over changes made to the target
+        copy(m_table->bindings[i], (pending & ToTarget) ? ToTarget : ToSource);
+    }
+}
+
+void PropertyForwarder::notified()
+{
+    if (!m_table)
+        return;
+
+    // Ignore the notifications of our own writes
+    const bool fromSource = sender() == m_source;
+    if (m_writing == (fromSource ? ToSource : ToTarget))
+        return;
+
+    const QHash<int, std::vector<int>> &signalBindings = fromSource ? m_table->sourceSignals : m_table->targetSignals;
+    const auto it = signalBindings.constFind(senderSignalIndex());
+    if (it == signalBindings.cend())
+        return;
+
+    for (int bindingIndex : it.value())
+        m_pending[bindingIndex] |= fromSource ? ToTarget : ToSource;
+
+    if (!m_flushScheduled) {
+        m_flushScheduled = true;
+        QMetaObject::invokeMethod(this, "flush", Qt::QueuedConnection);
+    }
+}
+
+void PropertyForwarder::copy(const Binding &binding, Pending direction)
+{
+    m_writing = direction;
+    if (direction == ToTarget) {
+        if (binding.targetWritable)
+            binding.toTarget(m_source, binding.sourceIndex, m_target, binding.targetIndex);
+    } else {
+        if (binding.sourceWritable)
+            binding.toSource(m_target, binding.targetIndex, m_source, binding.sourceIndex);
+    }
+    m_writing = None;
+}
+
+void PropertyForwarder::connectSignals(QObject *object, const QHash<int, std::vector<int>> &signalBindings)
+{
+    static const int notifiedIndex = staticMetaObject.indexOfSlot("notified()");
+    for (auto it = signalBindings.cbegin(), end = signalBindings.cend(); it != end; ++it)
+        m_connections.push_back(QMetaObject::connect(object, it.key(), this, notifiedIndex, Qt::DirectConnection));
+}
+
+} // namespace Kuesa
+
+QT_END_NAMESPACE
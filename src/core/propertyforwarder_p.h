@@ -0,0 +1,133 @@
+/*
+    propertyforwarder_p.h
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef KUESA_PROPERTYFORWARDER_P_H
+#define KUESA_PROPERTYFORWARDER_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Kuesa API.  It exists for the convenience
+// of other Kuesa classes.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <Kuesa/private/kuesa_global_p.h>
+#include <QObject>
+#include <QHash>
+#include <QPointer>
+#include <vector>
+
+QT_BEGIN_NAMESPACE
+
+namespace Kuesa {
+
+// Keeps the properties declared by the class of a source object in sync with
+// the properties of the same name of a target object, e.g. the properties
+// added to an Asset in QML and the properties of its node.
+//
+// The matching property pairs are resolved once per (source class, target
+// class) and cached. Values of common types are copied through typed
+// metacalls rather than QVariant. Change notifications are coalesced: the
+// values are only copied once per event loop iteration, however many times
+// they changed in between, or when flush() is called.
+class KUESA_PRIVATE_EXPORT PropertyForwarder : public QObject
+{
+    Q_OBJECT
+public:
+    // Copies property fromIndex of from to property toIndex of to
+    using Copier = void (*)(QObject *from, int fromIndex, QObject *to, int toIndex);
+
+    // Properties are referred to by index rather than QMetaProperty as QML
+    // objects have their own meta object, which dies with the instance
+    struct Binding {
+        int sourceIndex;
+        int targetIndex;
+        bool sourceWritable;
+        bool targetWritable;
+        Copier toTarget;
+        Copier toSource;
+    };
+
+    struct Table {
+        std::vector<Binding> bindings;
+        // Notify signal method index to indices of bindings
+        QHash<int, std::vector<int>> sourceSignals;
+        QHash<int, std::vector<int>> targetSignals;
+    };
+
+    explicit PropertyForwarder(QObject *parent = nullptr);
+
+    static const Table *table(const QMetaObject *sourceType, const QMetaObject *targetType);
+    // Typed copier between properties of types fromType and toType, nullptr
+    // if the values have to go through QVariant
+    static Copier copier(int fromType, int toType);
+
+    // Initializes the writable properties of source from target, then target
+    // from source, and forwards changes from then on
+    void setObjects(QObject *source, QObject *target);
+    void clear();
+
+    QObject *source() const;
+    QObject *target() const;
+    int bindingCount() const;
+    bool hasPendingChanges() const;
+
+public Q_SLOTS:
+    void flush();
+
+private Q_SLOTS:
+    void notified();
+
+private:
+    enum Pending : quint8 {
+        None = 0,
+        ToTarget = 1 << 0,
+        ToSource = 1 << 1
+    };
+
+    void copy(const Binding &binding, Pending direction);
+    void connectSignals(QObject *object, const QHash<int, std::vector<int>> &signalBindings);
+
+    QPointer<QObject> m_source;
+    QPointer<QObject> m_target;
+    const Table *m_table;
+    std::vector<quint8> m_pending;
+    std::vector<QMetaObject::Connection> m_connections;
+    bool m_flushScheduled;
+    Pending m_writing;
+};
+
+} // namespace Kuesa
+
+QT_END_NAMESPACE
+
+#endif // KUESA_PROPERTYFORWARDER_P_H
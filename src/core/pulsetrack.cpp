@@ -0,0 +1,136 @@
+/*
+    pulsetrack.cpp
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "pulsetrack_p.h"
+
+#include <Qt3DAnimation/QChannel>
+#include <algorithm>
+#include <cmath>
+
+QT_BEGIN_NAMESPACE
+
+namespace Kuesa {
+
+PulseTrack PulseTrack::fromChannelComponent(const Qt3DAnimation::QChannelComponent &component)
+{
+    PulseTrack track;
+    if (component.keyFrameCount() == 0)
+        return track;
+
+    track.m_empty = false;
+    track.m_initialPulse = qRound(component.begin()->coordinates().y());
+
+    // The interpolation type of a key frame applies up to the next key frame
+    for (auto it = component.begin(), next = it + 1, end = component.end(); next != end; ++it, ++next) {
+        const QVector2D from = it->coordinates();
+        const QVector2D to = next->coordinates();
+
+        switch (it->interpolationType()) {
+        case Qt3DAnimation::QKeyFrame::ConstantInterpolation:
+            track.append(to.x(), qRound(to.y()));
+            break;
+        case Qt3DAnimation::QKeyFrame::LinearInterpolation:
+            track.appendLinear(from.x(), from.y(), to.x(), to.y());
+            break;
+        case Qt3DAnimation::QKeyFrame::BezierInterpolation: {
+            const QVector2D p1 = it->rightControlPoint();
+            const QVector2D p2 = next->leftControlPoint();
+            QVector2D previous = from;
+            for (int i = 1; i <= BezierSubdivisions; ++i) {
+                const float u = float(i) / BezierSubdivisions;
+                const float v = 1.0f - u;
+                const QVector2D point = v * v * v * from + 3.0f * v * v * u * p1 + 3.0f * v * u * u * p2 + u * u * u * to;
+                track.appendLinear(previous.x(), previous.y(), point.x(), point.y());
+                previous = point;
+            }
+            break;
+        }
+        }
+    }
+    return track;
+}
+
+bool PulseTrack::isEmpty() const
+{
+    return m_empty;
+}
+
+int PulseTrack::initialPulse() const
+{
+    return m_initialPulse;
+}
+
+const std::vector<PulseTrack::Event> &PulseTrack::events() const
+{
+    return m_events;
+}
+
+int PulseTrack::pulseAt(float time) const
+{
+    const int next = nextEvent(time);
+    return next > 0 ? m_events[next - 1].pulse : m_initialPulse;
+}
+
+int PulseTrack::nextEvent(float time) const
+{
+    const auto it = std::upper_bound(m_events.begin(), m_events.end(), time,
+                                     [](float t, const Event &event) { return t < event.time; });
+    return int(std::distance(m_events.begin(), it));
+}
+
+void PulseTrack::appendLinear(float fromTime, float fromValue, float toTime, float toValue)
+{
+    // qRound changes when the value crosses n + 0.5
+    const int fromPulse = qRound(fromValue);
+    const int toPulse = qRound(toValue);
+    const int step = toPulse > fromPulse ? 1 : -1;
+    for (int pulse = fromPulse; pulse != toPulse; pulse += step) {
+        const float threshold = float(pulse) + 0.5f * float(step);
+        const float t = fromTime + (threshold - fromValue) / (toValue - fromValue) * (toTime - fromTime);
+        append(t, pulse + step);
+    }
+}
+
+void PulseTrack::append(float time, int pulse)
+{
+    if (pulse == lastPulse())
+        return;
+    // Keep the track sorted even if the curve goes back in time
+    if (!m_events.empty())
+        time = std::max(time, m_events.back().time);
+    m_events.push_back({ time, pulse });
+}
+
+int PulseTrack::lastPulse() const
+{
+    return m_events.empty() ? m_initialPulse : m_events.back().pulse;
+}
+
+} // namespace Kuesa
+
+QT_END_NAMESPACE
@@ -0,0 +1,94 @@
+/*
+    pulsetrack_p.h
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef KUESA_PULSETRACK_P_H
+#define KUESA_PULSETRACK_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Kuesa API.  It exists for the convenience
+// of other Kuesa classes.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <Kuesa/private/kuesa_global_p.h>
+#include <vector>
+
+QT_BEGIN_NAMESPACE
+
+namespace Qt3DAnimation {
+class QChannelComponent;
+}
+
+namespace Kuesa {
+
+// Times at which qRound() of an animated value changes, computed once from
+// the key frames of a channel component so that AnimationPulse doesn't need
+// to evaluate the animation every frame.
+class KUESA_PRIVATE_EXPORT PulseTrack
+{
+public:
+    struct Event {
+        float time;
+        int pulse;
+    };
+
+    // Bezier segments are approximated by as many linear segments
+    static const int BezierSubdivisions = 16;
+
+    static PulseTrack fromChannelComponent(const Qt3DAnimation::QChannelComponent &component);
+
+    bool isEmpty() const;
+    int initialPulse() const;
+    const std::vector<Event> &events() const;
+
+    // Pulse at time, after all the events up to time included
+    int pulseAt(float time) const;
+
+    // Index of the first event after time
+    int nextEvent(float time) const;
+
+private:
+    void appendLinear(float fromTime, float fromValue, float toTime, float toValue);
+    void append(float time, int pulse);
+    int lastPulse() const;
+
+    bool m_empty = true;
+    int m_initialPulse = 0;
+    std::vector<Event> m_events;
+};
+
+} // namespace Kuesa
+
+QT_END_NAMESPACE
+
+#endif // KUESA_PULSETRACK_P_H
@@ -0,0 +1,211 @@
+/*
+    resourcereadinesstracker.cpp
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "resourcereadinesstracker_p.h"
+#include "texturestreamer_p.h"
+#include <Qt3DRender/QAbstractTexture>
+#include <Qt3DRender/QTextureImage>
+
+QT_BEGIN_NAMESPACE
+
+using namespace Kuesa;
+
+namespace {
+
+bool isPendingStatus(Qt3DRender::QTextureImage::Status status)
+{
+    return status != Qt3DRender::QTextureImage::Ready &&
+            status != Qt3DRender::QTextureImage::Error;
+}
+
+bool isPendingStatus(Qt3DRender::QAbstractTexture::Status status)
+{
+    return status != Qt3DRender::QAbstractTexture::Ready &&
+            status != Qt3DRender::QAbstractTexture::Error;
+}
+
+} // namespace
+
+ResourceReadinessTracker::ResourceReadinessTracker(QObject *parent)
+    : QObject(parent)
+{
+}
+
+ResourceReadinessTracker::~ResourceReadinessTracker()
+{
+    clear();
+    setTextureStreamer(nullptr);
+}
+
+void ResourceReadinessTracker::track(Qt3DRender::QAbstractTextureImage *image)
+{
+    auto *textureImage = qobject_cast<Qt3DRender::QTextureImage *>(image);
+    if (!textureImage || m_resources.contains(textureImage))
+        return;
+
+    m_connections.push_back(QObject::connect(textureImage, &Qt3DRender::QTextureImage::statusChanged,
+                                             this, [this, textureImage] {
+                                                 setPending(textureImage, isPending(textureImage));
+                                             }));
+    // Images removed from their texture by the streamer stay parented to it
+    addResource(textureImage, qobject_cast<Qt3DRender::QAbstractTexture *>(textureImage->parent()));
+}
+
+void ResourceReadinessTracker::track(Qt3DRender::QAbstractTexture *texture)
+{
+    if (!texture || m_resources.contains(texture))
+        return;
+
+    m_connections.push_back(QObject::connect(texture, &Qt3DRender::QAbstractTexture::statusChanged,
+                                             this, [this, texture] {
+                                                 setPending(texture, isPending(texture));
+                                             }));
+    addResource(texture, texture);
+}
+
+void ResourceReadinessTracker::clear()
+{
+    for (const auto &c : m_connections)
+        QObject::disconnect(c);
+    m_connections.clear();
+    m_resources.clear();
+    m_pending.clear();
+    m_textures.clear();
+}
+
+void ResourceReadinessTracker::setTextureStreamer(TextureStreamer *streamer)
+{
+    if (streamer == m_streamer)
+        return;
+
+    for (const auto &c : m_streamerConnections)
+        QObject::disconnect(c);
+    m_streamerConnections.clear();
+    m_streamer = streamer;
+
+    if (m_streamer) {
+        const auto f = [this](Qt3DRender::QAbstractTexture *texture) { updateTexture(texture); };
+        m_streamerConnections = {
+            QObject::connect(m_streamer, &TextureStreamer::textureEvicted, this, f),
+            QObject::connect(m_streamer, &TextureStreamer::textureLoaded, this, f),
+        };
+    }
+
+    const auto resources = m_resources;
+    for (QObject *resource : resources)
+        setPending(resource, isPending(resource));
+}
+
+TextureStreamer *ResourceReadinessTracker::textureStreamer() const
+{
+    return m_streamer;
+}
+
+int ResourceReadinessTracker::resourceCount() const
+{
+    return m_resources.size();
+}
+
+int ResourceReadinessTracker::pendingCount() const
+{
+    return m_pending.size();
+}
+
+bool ResourceReadinessTracker::isSettled() const
+{
+    return m_pending.isEmpty();
+}
+
+float ResourceReadinessTracker::progress() const
+{
+    if (m_resources.isEmpty())
+        return 1.0f;
+    return float(m_resources.size() - m_pending.size()) / float(m_resources.size());
+}
+
+bool ResourceReadinessTracker::isPending(QObject *resource) const
+{
+    Qt3DRender::QAbstractTexture *texture = m_textures.value(resource);
+    if (m_streamer && texture && !m_streamer->isLoaded(texture))
+        return false;
+
+    if (auto textureImage = qobject_cast<Qt3DRender::QTextureImage *>(resource))
+        return isPendingStatus(textureImage->status());
+    if (texture == resource)
+        return isPendingStatus(texture->status());
+    return false;
+}
+
+void ResourceReadinessTracker::addResource(QObject *resource, Qt3DRender::QAbstractTexture *texture)
+{
+    m_resources.insert(resource);
+    if (texture)
+        m_textures.insert(resource, texture);
+    m_connections.push_back(QObject::connect(resource, &QObject::destroyed,
+                                             this, [this, resource] { removeResource(resource); }));
+    if (isPending(resource))
+        m_pending.insert(resource);
+    emit progressChanged(progress());
+}
+
+void ResourceReadinessTracker::setPending(QObject *resource, bool pending)
+{
+    if (pending == m_pending.contains(resource))
+        return;
+
+    if (pending) {
+        m_pending.insert(resource);
+        emit progressChanged(progress());
+        return;
+    }
+
+    m_pending.remove(resource);
+    emit progressChanged(progress());
+    if (m_pending.isEmpty())
+        emit settled();
+}
+
+void ResourceReadinessTracker::removeResource(QObject *resource)
+{
+    m_resources.remove(resource);
+    m_textures.remove(resource);
+    const bool wasPending = m_pending.remove(resource);
+    emit progressChanged(progress());
+    if (wasPending && m_pending.isEmpty())
+        emit settled();
+}
+
+void ResourceReadinessTracker::updateTexture(Qt3DRender::QAbstractTexture *texture)
+{
+    for (auto it = m_textures.cbegin(), end = m_textures.cend(); it != end; ++it) {
+        if (it.value() == texture)
+            setPending(it.key(), isPending(it.key()));
+    }
+}
+
+QT_END_NAMESPACE
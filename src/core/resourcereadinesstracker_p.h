@@ -0,0 +1,113 @@
+/*
+    resourcereadinesstracker_p.h
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef KUESA_RESOURCEREADINESSTRACKER_P_H
+#define KUESA_RESOURCEREADINESSTRACKER_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Kuesa API.  It exists for the convenience
+// of other Kuesa classes.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <Kuesa/private/kuesa_global_p.h>
+#include <QHash>
+#include <QObject>
+#include <QPointer>
+#include <QSet>
+#include <vector>
+
+QT_BEGIN_NAMESPACE
+
+namespace Qt3DRender {
+class QAbstractTexture;
+class QAbstractTextureImage;
+} // namespace Qt3DRender
+
+namespace Kuesa {
+
+class TextureStreamer;
+
+// Counts the resources of a scene that are still being loaded, from the status
+// change notifications of these resources rather than by polling them. A
+// resource is settled once it is either ready or failed to load, it becomes
+// pending again if it gets reloaded.
+class KUESA_PRIVATE_EXPORT ResourceReadinessTracker : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ResourceReadinessTracker(QObject *parent = nullptr);
+    ~ResourceReadinessTracker();
+
+    // Texture images without a status, such as generated ones, are ignored
+    void track(Qt3DRender::QAbstractTextureImage *image);
+    void track(Qt3DRender::QAbstractTexture *texture);
+    void clear();
+
+    // Textures evicted by the streamer, along with their images, only load
+    // once in use and are reported as settled in the meantime
+    void setTextureStreamer(TextureStreamer *streamer);
+    TextureStreamer *textureStreamer() const;
+
+    int resourceCount() const;
+    int pendingCount() const;
+    bool isSettled() const;
+
+    // Fraction of the tracked resources that are settled, 1 if none is tracked
+    float progress() const;
+
+Q_SIGNALS:
+    void progressChanged(float progress);
+    void settled();
+
+private:
+    bool isPending(QObject *resource) const;
+    void addResource(QObject *resource, Qt3DRender::QAbstractTexture *texture);
+    void setPending(QObject *resource, bool pending);
+    void removeResource(QObject *resource);
+    void updateTexture(Qt3DRender::QAbstractTexture *texture);
+
+    QSet<QObject *> m_resources;
+    QSet<QObject *> m_pending;
+    // Texture each resource belongs to
+    QHash<QObject *, Qt3DRender::QAbstractTexture *> m_textures;
+    std::vector<QMetaObject::Connection> m_connections;
+    QPointer<TextureStreamer> m_streamer;
+    std::vector<QMetaObject::Connection> m_streamerConnections;
+};
+
+} // namespace Kuesa
+
+QT_END_NAMESPACE
+
+#endif // KUESA_RESOURCEREADINESSTRACKER_P_H
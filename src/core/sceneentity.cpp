@@ -31,6 +31,11 @@
 #include "logging_p.h"
 #include <Kuesa/forwardrenderer.h>
 #include <Kuesa/private/shadowmapmanager_p.h>
+#include <Kuesa/private/animationresultbuffer_p.h>
+#include <Kuesa/private/animationinstancer_p.h>
+#include <Kuesa/private/assetnameregistry_p.h>
+#include <Kuesa/private/assetmemory_p.h>
+#include <Kuesa/private/texturestreamer_p.h>
 
 #include <Qt3DCore/QTransform>
 #include <Qt3DLogic/QFrameAction>
@@ -96,6 +101,74 @@ using namespace Kuesa;
     GLTFImporter instance which sceneEntity points to this entity.
 */
 
+/*!
+    \property SceneEntity::appliedAnimationPropertyCount
+
+    Holds the number of properties written during the last pass applying the
+    results of the batched AnimationPlayer instances of this scene. When
+    animations are running, there is one such pass per frame.
+
+    \since Kuesa 1.4
+    \sa AnimationPlayer::batched
+*/
+
+/*!
+    \qmlproperty int SceneEntity::appliedAnimationPropertyCount
+
+    Holds the number of properties written during the last pass applying the
+    results of the batched AnimationPlayer instances of this scene. When
+    animations are running, there is one such pass per frame.
+
+    \since Kuesa 1.4
+    \sa AnimationPlayer::batched
+*/
+
+/*!
+    \property SceneEntity::cpuMemoryUsage
+
+    Holds an estimate of the CPU memory used by the assets of all the
+    collections of the scene, in bytes. Resources referenced by several assets
+    or collections are only counted once. This is updated as assets are added
+    and removed, and is cheap to read.
+
+    \since Kuesa 1.4
+    \sa memoryReport
+*/
+
+/*!
+    \qmlproperty real SceneEntity::cpuMemoryUsage
+
+    Holds an estimate of the CPU memory used by the assets of all the
+    collections of the scene, in bytes. Resources referenced by several assets
+    or collections are only counted once. This is updated as assets are added
+    and removed, and is cheap to read.
+
+    \since Kuesa 1.4
+    \sa memoryReport
+*/
+
+/*!
+    \property SceneEntity::gpuMemoryUsage
+
+    Holds an estimate of the GPU memory used by the assets of all the
+    collections of the scene, in bytes, once uploaded. Texture sizes are
+    refined once the textures are loaded.
+
+    \since Kuesa 1.4
+    \sa memoryReport
+*/
+
+/*!
+    \qmlproperty real SceneEntity::gpuMemoryUsage
+
+    Holds an estimate of the GPU memory used by the assets of all the
+    collections of the scene, in bytes, once uploaded. Texture sizes are
+    refined once the textures are loaded.
+
+    \since Kuesa 1.4
+    \sa memoryReport
+*/
+
 // TODO document properties
 SceneEntity::SceneEntity(Qt3DCore::QNode *parent)
     : Qt3DCore::QEntity(parent)
@@ -115,9 +188,22 @@ SceneEntity::SceneEntity(Qt3DCore::QNode *parent)
     , m_textureImages(new TextureImageCollection(this))
     , m_animationMappings(new AnimationMappingCollection(this))
     , m_reflectionPlanes(new ReflectionPlaneCollection(this))
+    , m_animationResultBuffer(nullptr)
+    , m_animationInstancer(nullptr)
+    , m_assetNameRegistry(new AssetNameRegistry(this))
+    , m_assetMemoryLedger(new AssetMemoryLedger(this))
+    , m_textureStreamer(nullptr)
 {
     initResources();
 
+    const AbstractAssetCollection *collections[] = {
+        m_clips, m_armatures, m_effects, m_layers, m_lights, m_materials, m_meshes, m_skeletons,
+        m_textures, m_cameras, m_entities, m_transforms, m_placeholders, m_textureImages,
+        m_animationMappings, m_reflectionPlanes
+    };
+    for (const AbstractAssetCollection *collection : collections)
+        connect(collection, &AbstractAssetCollection::memoryUsageChanged, this, &SceneEntity::memoryUsageChanged);
+
     // TODO: Replace this with a nicer way for registering assets needed by various subsystems
     m_brdfLUT = new Qt3DRender::QTextureLoader(this);
     m_brdfLUT->setObjectName(QLatin1String("_kuesa_brdfLUT"));
@@ -138,6 +224,13 @@ SceneEntity::SceneEntity(Qt3DCore::QNode *parent)
         if (forwardRenderer) {
             forwardRenderer->setShadowMaps(m_lights->shadowMapManager()->activeShadowMaps());
             connect(m_lights->shadowMapManager(), &ShadowMapManager::shadowMapsChanged, forwardRenderer, &ForwardRenderer::setShadowMaps);
+            // Lights binned by the views using clustered lighting
+            forwardRenderer->setLights(m_lights->shadowMapManager()->lights());
+            connect(m_lights->shadowMapManager(), &ShadowMapManager::lightsChanged, forwardRenderer, &ForwardRenderer::setLights);
+            // Cascaded shadow maps are fitted to the camera of a single view,
+            // the other views fall back to a whole scene shadow map
+            m_lights->shadowMapManager()->setViewCamera(forwardRenderer->shadowCascadeCamera());
+            connect(forwardRenderer, &ForwardRenderer::shadowCascadeCameraChanged, m_lights->shadowMapManager(), &ShadowMapManager::setViewCamera);
         } else {
             qCWarning(kuesa) << "No ForwardRenderer found: shadow support disabled";
         }
@@ -487,6 +580,84 @@ Kuesa::SceneEntity *Kuesa::SceneEntity::findParentSceneEntity(Qt3DCore::QEntity
     return nullptr;
 }
 
+int SceneEntity::appliedAnimationPropertyCount() const
+{
+    return m_animationResultBuffer ? m_animationResultBuffer->appliedPropertyCount() : 0;
+}
+
+qint64 SceneEntity::cpuMemoryUsage() const
+{
+    return m_assetMemoryLedger->cpuBytes();
+}
+
+qint64 SceneEntity::gpuMemoryUsage() const
+{
+    return m_assetMemoryLedger->gpuBytes();
+}
+
+/*!
+    Returns a report of the memory used by the assets of the scene.
+
+    The report is a map holding the cpuBytes and gpuBytes totals for the whole
+    scene, the duplicateCpuBytes and duplicateGpuBytes used by resources
+    loaded several times from the same source and the list of these
+    duplicates. The collections entry maps the name of each collection to its
+    own report, as returned by AbstractAssetCollection::memoryReport().
+
+    \since Kuesa 1.4
+ */
+QVariantMap SceneEntity::memoryReport() const
+{
+    QVariantMap collections;
+    collections.insert(QStringLiteral("animationClips"), m_clips->memoryReport());
+    collections.insert(QStringLiteral("armatures"), m_armatures->memoryReport());
+    collections.insert(QStringLiteral("effects"), m_effects->memoryReport());
+    collections.insert(QStringLiteral("layers"), m_layers->memoryReport());
+    collections.insert(QStringLiteral("lights"), m_lights->memoryReport());
+    collections.insert(QStringLiteral("materials"), m_materials->memoryReport());
+    collections.insert(QStringLiteral("meshes"), m_meshes->memoryReport());
+    collections.insert(QStringLiteral("skeletons"), m_skeletons->memoryReport());
+    collections.insert(QStringLiteral("textures"), m_textures->memoryReport());
+    collections.insert(QStringLiteral("cameras"), m_cameras->memoryReport());
+    collections.insert(QStringLiteral("entities"), m_entities->memoryReport());
+    collections.insert(QStringLiteral("transforms"), m_transforms->memoryReport());
+    collections.insert(QStringLiteral("placeholders"), m_placeholders->memoryReport());
+    collections.insert(QStringLiteral("textureImages"), m_textureImages->memoryReport());
+    collections.insert(QStringLiteral("animationMappings"), m_animationMappings->memoryReport());
+    collections.insert(QStringLiteral("reflectionPlanes"), m_reflectionPlanes->memoryReport());
+
+    QVariantMap report = m_assetMemoryLedger->report();
+    report.insert(QStringLiteral("collections"), collections);
+    return report;
+}
+
+AnimationResultBuffer *SceneEntity::animationResultBuffer()
+{
+    // Created on demand, only batched AnimationPlayers need it
+    if (m_animationResultBuffer == nullptr) {
+        m_animationResultBuffer = new AnimationResultBuffer(this);
+        connect(m_animationResultBuffer, &AnimationResultBuffer::appliedPropertyCountChanged,
+                this, &SceneEntity::appliedAnimationPropertyCountChanged);
+    }
+    return m_animationResultBuffer;
+}
+
+AnimationInstancer *SceneEntity::animationInstancer()
+{
+    // Created on demand, only instanced AnimationPlayers need it
+    if (m_animationInstancer == nullptr)
+        m_animationInstancer = new AnimationInstancer(this);
+    return m_animationInstancer;
+}
+
+TextureStreamer *SceneEntity::textureStreamer()
+{
+    // Created on demand, only when loading textures lazily
+    if (m_textureStreamer == nullptr)
+        m_textureStreamer = new TextureStreamer(this);
+    return m_textureStreamer;
+}
+
 Kuesa::PlaceholderCollection *Kuesa::SceneEntity::placeholders() const
 {
     return m_placeholders;
@@ -59,6 +59,12 @@ class QTextureLoader;
 namespace Kuesa {
 
 class ReflectionPlane;
+class AnimationPlayer;
+class AnimationResultBuffer;
+class AnimationInstancer;
+class AssetNameRegistry;
+class AssetMemoryLedger;
+class TextureStreamer;
 
 namespace GLTF2Import {
 class GLTF2Parser;
@@ -84,6 +90,9 @@ class KUESASHARED_EXPORT SceneEntity : public Qt3DCore::QEntity
     Q_PROPERTY(Kuesa::TransformCollection *transforms READ transforms NOTIFY loadingDone)
     Q_PROPERTY(Kuesa::ReflectionPlaneCollection *reflectionPlanes READ reflectionPlanes NOTIFY loadingDone)
     Q_PROPERTY(Kuesa::PlaceholderCollection *placeholders READ placeholders NOTIFY loadingDone)
+    Q_PROPERTY(int appliedAnimationPropertyCount READ appliedAnimationPropertyCount NOTIFY appliedAnimationPropertyCountChanged)
+    Q_PROPERTY(qint64 cpuMemoryUsage READ cpuMemoryUsage NOTIFY memoryUsageChanged)
+    Q_PROPERTY(qint64 gpuMemoryUsage READ gpuMemoryUsage NOTIFY memoryUsageChanged)
 
 public:
     SceneEntity(Qt3DCore::QNode *parent = nullptr);
@@ -146,10 +155,22 @@ public:
     Kuesa::ReflectionPlaneCollection *reflectionPlanes() const;
     Q_INVOKABLE Kuesa::ReflectionPlane *reflectionPlane(const QString &name) const;
 
+    int appliedAnimationPropertyCount() const;
+
+    qint64 cpuMemoryUsage() const;
+    qint64 gpuMemoryUsage() const;
+    Q_INVOKABLE QVariantMap memoryReport() const;
+
 Q_SIGNALS:
     void loadingDone();
+    void appliedAnimationPropertyCountChanged(int appliedAnimationPropertyCount);
+    void memoryUsageChanged();
 
 private:
+    AnimationResultBuffer *animationResultBuffer();
+    AnimationInstancer *animationInstancer();
+    TextureStreamer *textureStreamer();
+
     AnimationClipCollection *m_clips;
     ArmatureCollection *m_armatures;
     EffectCollection *m_effects;
@@ -168,6 +189,16 @@ private:
     ReflectionPlaneCollection *m_reflectionPlanes;
 
     Qt3DRender::QTextureLoader *m_brdfLUT;
+    AnimationResultBuffer *m_animationResultBuffer;
+    AnimationInstancer *m_animationInstancer;
+    AssetNameRegistry *m_assetNameRegistry;
+    AssetMemoryLedger *m_assetMemoryLedger;
+    TextureStreamer *m_textureStreamer;
+
+    friend class AnimationPlayer;
+    friend class AssetNameRegistry;
+    friend class AssetMemoryLedger;
+    friend class TextureStreamer;
 };
 
 } // namespace Kuesa
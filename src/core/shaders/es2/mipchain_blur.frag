@@ -0,0 +1,55 @@
+#version 100
+
+/*
+    mipchain_blur.frag
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+precision mediump float;
+precision highp int;
+
+// Separable gaussian blur relying on bilinear filtering to fetch two taps at
+// once. Generated with BlurKernel::linearSampledTaps(BlurKernel::binomialWeights(4))
+const highp float offset1 = 1.3846153846;
+const highp float offset2 = 3.2307692308;
+const highp float weight0 = 0.2270270270;
+const highp float weight1 = 0.3162162162;
+const highp float weight2 = 0.0702702703;
+
+uniform highp sampler2D sourceTexture;
+uniform highp vec2 blurStep;
+
+varying highp vec2 texCoord;
+
+void main()
+{
+    highp vec4 sum = texture2D(sourceTexture, texCoord) * weight0;
+    sum += texture2D(sourceTexture, texCoord + blurStep * offset1) * weight1;
+    sum += texture2D(sourceTexture, texCoord - blurStep * offset1) * weight1;
+    sum += texture2D(sourceTexture, texCoord + blurStep * offset2) * weight2;
+    sum += texture2D(sourceTexture, texCoord - blurStep * offset2) * weight2;
+    gl_FragColor = sum;
+}
@@ -49,4 +49,8 @@ struct MetallicRoughness {
     lowp int receivesShadows;
 };
 
-uniform MetallicRoughness metallicRoughness;
+// std140 layout matching Kuesa::MetallicRoughnessBlock, uploaded as a single
+// buffer when a material property changes
+layout(std140) uniform MetallicRoughnessBlock {
+    MetallicRoughness metallicRoughness;
+};
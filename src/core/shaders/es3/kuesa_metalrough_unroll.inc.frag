@@ -32,6 +32,10 @@
 
 #pragma include light_unroll.inc.frag
 
+#ifdef LAYER_clusteredLights
+#pragma include kuesa_clusteredlights.inc.frag
+#endif
+
 const FP float M_PI = 3.141592653589793;
 
 uniform sampler2D brdfLUT;
@@ -285,7 +289,15 @@ FP vec3 kuesa_metalRoughFunction(const in FP vec4 baseColor,
                                ambientOcclusion);
     }
 
-    if (lightCount > 0)
+    // With clustered lights, only the shadow casting lights are taken from
+    // the ones Qt 3D selects, the others are looked up per cluster
+#ifdef LAYER_clusteredLights
+    bool clustered = kuesa_clusteredLightsEnabled();
+#else
+    bool clustered = false;
+#endif
+
+    if (lightCount > 0 && (!clustered || light_0.castsShadows))
         cLinear += pbrModel(light_0,
                             worldPosition,
                             worldNormal,
@@ -295,7 +307,7 @@ FP vec3 kuesa_metalRoughFunction(const in FP vec4 baseColor,
                             alpha,
                             ambientOcclusion);
 
-    if (lightCount > 1)
+    if (lightCount > 1 && (!clustered || light_1.castsShadows))
         cLinear += pbrModel(light_1,
                             worldPosition,
                             worldNormal,
@@ -304,7 +316,7 @@ FP vec3 kuesa_metalRoughFunction(const in FP vec4 baseColor,
                             metalness,
                             alpha,
                             ambientOcclusion);
-    if (lightCount > 2)
+    if (lightCount > 2 && (!clustered || light_2.castsShadows))
         cLinear += pbrModel(light_2,
                             worldPosition,
                             worldNormal,
@@ -313,7 +325,7 @@ FP vec3 kuesa_metalRoughFunction(const in FP vec4 baseColor,
                             metalness,
                             alpha,
                             ambientOcclusion);
-    if (lightCount > 3)
+    if (lightCount > 3 && (!clustered || light_3.castsShadows))
         cLinear += pbrModel(light_3,
                             worldPosition,
                             worldNormal,
@@ -322,7 +334,7 @@ FP vec3 kuesa_metalRoughFunction(const in FP vec4 baseColor,
                             metalness,
                             alpha,
                             ambientOcclusion);
-    if (lightCount > 4)
+    if (lightCount > 4 && (!clustered || light_4.castsShadows))
         cLinear += pbrModel(light_4,
                             worldPosition,
                             worldNormal,
@@ -331,7 +343,7 @@ FP vec3 kuesa_metalRoughFunction(const in FP vec4 baseColor,
                             metalness,
                             alpha,
                             ambientOcclusion);
-    if (lightCount > 5)
+    if (lightCount > 5 && (!clustered || light_5.castsShadows))
         cLinear += pbrModel(light_5,
                             worldPosition,
                             worldNormal,
@@ -340,7 +352,7 @@ FP vec3 kuesa_metalRoughFunction(const in FP vec4 baseColor,
                             metalness,
                             alpha,
                             ambientOcclusion);
-    if (lightCount > 6)
+    if (lightCount > 6 && (!clustered || light_6.castsShadows))
         cLinear += pbrModel(light_6,
                             worldPosition,
                             worldNormal,
@@ -349,7 +361,7 @@ FP vec3 kuesa_metalRoughFunction(const in FP vec4 baseColor,
                             metalness,
                             alpha,
                             ambientOcclusion);
-    if (lightCount > 7)
+    if (lightCount > 7 && (!clustered || light_7.castsShadows))
         cLinear += pbrModel(light_7,
                             worldPosition,
                             worldNormal,
@@ -359,6 +371,32 @@ FP vec3 kuesa_metalRoughFunction(const in FP vec4 baseColor,
                             alpha,
                             ambientOcclusion);
 
+#ifdef LAYER_clusteredLights
+    if (clustered) {
+        for (int i = 0; i < kuesa_globalLightCount(); ++i)
+            cLinear += pbrModel(kuesa_clusterLight(i),
+                                worldPosition,
+                                worldNormal,
+                                worldView,
+                                baseColor.rgb,
+                                metalness,
+                                alpha,
+                                ambientOcclusion);
+
+        int cluster = kuesa_clusterIndex(worldPosition);
+        int lastIndex = kuesa_clusterOffset(cluster + 1);
+        for (int i = kuesa_clusterOffset(cluster); i < lastIndex; ++i)
+            cLinear += pbrModel(kuesa_clusterLight(kuesa_clusterLightIndex(i)),
+                                worldPosition,
+                                worldNormal,
+                                worldView,
+                                baseColor.rgb,
+                                metalness,
+                                alpha,
+                                ambientOcclusion);
+    }
+#endif
+
     // Apply ambient occlusion and emissive channels
     cLinear *= ambientOcclusion;
     cLinear += emissive.rgb;
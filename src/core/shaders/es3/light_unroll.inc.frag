@@ -43,6 +43,7 @@ struct Light {
     FP float range;
     FP float lightAngleScale;
     FP float lightAngleOffset;
+    bool castsShadows;
 };
 uniform Light light_0;
 uniform Light light_1;
@@ -0,0 +1,63 @@
+#version 300 es
+
+/*
+    mipchain_upsample.frag
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+precision mediump float;
+precision highp int;
+
+// Upsamples the previous, smaller level of the chain with a 3x3 tent filter
+// and blends it with the level being reconstructed
+
+uniform highp sampler2D lowTexture;
+uniform highp sampler2D highTexture;
+uniform highp vec2 lowTexelSize;
+uniform highp float highWeight;
+
+in highp vec2 texCoord;
+layout(location = 0) out highp vec4 fragColor;
+
+highp vec4 upsampleTent()
+{
+    highp vec4 d = lowTexelSize.xyxy * vec4(1.0, 1.0, -1.0, 0.0);
+    highp vec4 sum = texture(lowTexture, texCoord - d.xy);
+    sum += texture(lowTexture, texCoord - d.wy) * 2.0;
+    sum += texture(lowTexture, texCoord - d.zy);
+    sum += texture(lowTexture, texCoord + d.zw) * 2.0;
+    sum += texture(lowTexture, texCoord) * 4.0;
+    sum += texture(lowTexture, texCoord + d.xw) * 2.0;
+    sum += texture(lowTexture, texCoord + d.zy);
+    sum += texture(lowTexture, texCoord + d.wy) * 2.0;
+    sum += texture(lowTexture, texCoord + d.xy);
+    return sum * (1.0 / 16.0);
+}
+
+void main()
+{
+    fragColor = mix(upsampleTent(), texture(highTexture, texCoord), highWeight);
+}
@@ -1,10 +1,12 @@
+#version 300 es
+
 /*
-    assetproperty_p.cpp
+    particle_instanced.frag
 
     This file is part of Kuesa.
 
-    Copyright (C) 2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
-    Author: Juan Casafranca <juan.casafranca@kdab.com>
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
 
     Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
     accordance with the Kuesa Enterprise License Agreement provided with the Software in the
@@ -26,31 +28,17 @@
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
 
-#include "assetproperty_p.h"
+precision mediump float;
+precision highp int;
 
-Kuesa::AssetProperty::AssetProperty(Kuesa::Asset *asset)
-    : QObject(asset)
-    , asset(asset)
-    , node(nullptr)
-    , nodeProperty(QMetaProperty{})
-    , qmlProperty(QMetaProperty{})
-{
-}
+in highp vec2 texCoord;
+in vec4 color;
 
-void Kuesa::AssetProperty::setQmlProperty()
-{
-    if (qmlProperty.isValid() && qmlProperty.isWritable() && nodeProperty.isValid()) {
-        const QVariant &v = nodeProperty.read(node);
-        if (v.isValid())
-            qmlProperty.write(asset, v);
-    }
-}
+uniform highp sampler2D spriteTexture;
+
+out vec4 fragColor;
 
-void Kuesa::AssetProperty::setNodeProperty()
+void main()
 {
-    if (qmlProperty.isValid() && nodeProperty.isValid() && nodeProperty.isWritable()) {
-        const QVariant &v = qmlProperty.read(asset);
-        if (v.isValid())
-            nodeProperty.write(node, v);
-    }
+    fragColor = color * texture(spriteTexture, texCoord);
 }
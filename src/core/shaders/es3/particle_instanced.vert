@@ -0,0 +1,67 @@
+#version 300 es
+
+/*
+    particle_instanced.vert
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Particles simulated on the CPU, one instance per particle drawn as a
+// 4 vertices triangle strip quad
+
+in highp vec4 particlePosition; // xyz: world position, w: rotation
+in highp vec3 particleVelocity;
+in highp vec2 particleSize;
+in highp vec4 particleColor;
+
+uniform highp mat4 viewMatrix;
+uniform highp mat4 projectionMatrix;
+uniform bool alignToVelocity;
+
+out highp vec2 texCoord;
+out mediump vec4 color;
+
+void main()
+{
+    vec2 corner = vec2(float(gl_VertexID & 1), float(gl_VertexID >> 1)) * 2.0 - vec2(1.0);
+
+    mat2 rotation;
+    if (alignToVelocity) {
+        // Local Y axis along the projected velocity
+        vec2 direction = normalize((viewMatrix * vec4(particleVelocity, 0.0)).xyz).xy;
+        rotation = mat2(vec2(direction.y, -direction.x), direction);
+    } else {
+        float c = cos(particlePosition.w);
+        float s = sin(particlePosition.w);
+        rotation = mat2(c, s, -s, c);
+    }
+
+    vec3 position = (viewMatrix * vec4(particlePosition.xyz, 1.0)).xyz;
+    position.xy += rotation * (0.5 * particleSize * corner);
+    gl_Position = projectionMatrix * vec4(position, 1.0);
+
+    texCoord = vec2(0.5) + 0.5 * corner;
+    color = particleColor;
+}
@@ -50,4 +50,8 @@ struct MetallicRoughness {
     int receivesShadows;
 };
 
-uniform MetallicRoughness metallicRoughness;
+// std140 layout matching Kuesa::MetallicRoughnessBlock, uploaded as a single
+// buffer when a material property changes
+layout(std140) uniform MetallicRoughnessBlock {
+    MetallicRoughness metallicRoughness;
+};
@@ -28,6 +28,10 @@
 
 #pragma include light_unroll.inc.frag
 
+#ifdef LAYER_clusteredLights
+#pragma include kuesa_clusteredlights.inc.frag
+#endif
+
 #ifdef LAYER_shadows
 #pragma include kuesa_shadowmap.inc.frag
 #endif
@@ -294,8 +298,16 @@ vec3 kuesa_metalRoughFunction(const in vec4 baseColor,
                                ambientOcclusion);
     }
 
+    // With clustered lights, only the shadow casting lights are taken from
+    // the ones Qt 3D selects, the others are looked up per cluster
+#ifdef LAYER_clusteredLights
+    bool clustered = kuesa_clusteredLightsEnabled();
+#else
+    bool clustered = false;
+#endif
+
     // Add up the contributions from punctual lights
-    if (lightCount > 0)
+    if (lightCount > 0 && (!clustered || light_0.castsShadows))
         cLinear += pbrModel(light_0,
                             worldPosition,
                             worldNormal,
@@ -306,7 +318,7 @@ vec3 kuesa_metalRoughFunction(const in vec4 baseColor,
                             ambientOcclusion,
                             bool(receivesShadows));
 
-    if (lightCount > 1)
+    if (lightCount > 1 && (!clustered || light_1.castsShadows))
         cLinear += pbrModel(light_1,
                             worldPosition,
                             worldNormal,
@@ -316,7 +328,7 @@ vec3 kuesa_metalRoughFunction(const in vec4 baseColor,
                             alpha,
                             ambientOcclusion,
                             bool(receivesShadows));
-    if (lightCount > 2)
+    if (lightCount > 2 && (!clustered || light_2.castsShadows))
         cLinear += pbrModel(light_2,
                             worldPosition,
                             worldNormal,
@@ -326,7 +338,7 @@ vec3 kuesa_metalRoughFunction(const in vec4 baseColor,
                             alpha,
                             ambientOcclusion,
                             bool(receivesShadows));
-    if (lightCount > 3)
+    if (lightCount > 3 && (!clustered || light_3.castsShadows))
         cLinear += pbrModel(light_3,
                             worldPosition,
                             worldNormal,
@@ -336,7 +348,7 @@ vec3 kuesa_metalRoughFunction(const in vec4 baseColor,
                             alpha,
                             ambientOcclusion,
                             bool(receivesShadows));
-    if (lightCount > 4)
+    if (lightCount > 4 && (!clustered || light_4.castsShadows))
         cLinear += pbrModel(light_4,
                             worldPosition,
                             worldNormal,
@@ -346,7 +358,7 @@ vec3 kuesa_metalRoughFunction(const in vec4 baseColor,
                             alpha,
                             ambientOcclusion,
                             bool(receivesShadows));
-    if (lightCount > 5)
+    if (lightCount > 5 && (!clustered || light_5.castsShadows))
         cLinear += pbrModel(light_5,
                             worldPosition,
                             worldNormal,
@@ -356,7 +368,7 @@ vec3 kuesa_metalRoughFunction(const in vec4 baseColor,
                             alpha,
                             ambientOcclusion,
                             bool(receivesShadows));
-    if (lightCount > 6)
+    if (lightCount > 6 && (!clustered || light_6.castsShadows))
         cLinear += pbrModel(light_6,
                             worldPosition,
                             worldNormal,
@@ -366,7 +378,7 @@ vec3 kuesa_metalRoughFunction(const in vec4 baseColor,
                             alpha,
                             ambientOcclusion,
                             bool(receivesShadows));
-    if (lightCount > 7)
+    if (lightCount > 7 && (!clustered || light_7.castsShadows))
         cLinear += pbrModel(light_7,
                             worldPosition,
                             worldNormal,
@@ -377,6 +389,34 @@ vec3 kuesa_metalRoughFunction(const in vec4 baseColor,
                             ambientOcclusion,
                             bool(receivesShadows));
 
+#ifdef LAYER_clusteredLights
+    if (clustered) {
+        for (int i = 0; i < kuesa_globalLightCount(); ++i)
+            cLinear += pbrModel(kuesa_clusterLight(i),
+                                worldPosition,
+                                worldNormal,
+                                worldView,
+                                baseColor.rgb,
+                                metalness,
+                                alpha,
+                                ambientOcclusion,
+                                bool(receivesShadows));
+
+        int cluster = kuesa_clusterIndex(worldPosition);
+        int lastIndex = kuesa_clusterOffset(cluster + 1);
+        for (int i = kuesa_clusterOffset(cluster); i < lastIndex; ++i)
+            cLinear += pbrModel(kuesa_clusterLight(kuesa_clusterLightIndex(i)),
+                                worldPosition,
+                                worldNormal,
+                                worldView,
+                                baseColor.rgb,
+                                metalness,
+                                alpha,
+                                ambientOcclusion,
+                                bool(receivesShadows));
+    }
+#endif
+
     // Apply ambient occlusion and emissive channels
     cLinear *= ambientOcclusion;
     cLinear += emissive.rgb;
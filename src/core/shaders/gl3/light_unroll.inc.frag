@@ -45,6 +45,10 @@ struct Light {
     mat4 lightProjectionMatrix;
     vec2 nearFarPlanes;
     int depthArrayIndex;
+    vec4 shadowAtlasRect;
+    int cascadeCount;
+    vec4 cascadeScaleOffsets[4];
+    vec4 cascadeAtlasRects[4];
 };
 uniform Light light_0;
 uniform Light light_1;
@@ -1,10 +1,12 @@
+#version 330
+
 /*
-    assetproperty_p.h
+    mipchain_blur.frag
 
     This file is part of Kuesa.
 
-    Copyright (C) 2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
-    Author: Juan Casafranca <juan.casafranca@kdab.com>
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
 
     Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
     accordance with the Kuesa Enterprise License Agreement provided with the Software in the
@@ -26,41 +28,24 @@
     along with this program.  If not, see <https://www.gnu.org/licenses/>.
 */
 
-#ifndef ASSETPROPERTY_P_H
-#define ASSETPROPERTY_P_H
+// Separable gaussian blur relying on bilinear filtering to fetch two taps at
+// once. Generated with BlurKernel::linearSampledTaps(BlurKernel::binomialWeights(4))
+const int tapCount = 3;
+const float offsets[tapCount] = float[]( 0.0, 1.3846153846, 3.2307692308 );
+const float weights[tapCount] = float[]( 0.2270270270, 0.3162162162, 0.0702702703 );
 
-//
-//  W A R N I N G
-//  -------------
-//
-// This file is not part of the Kuesa API.  It exists for the convenience
-// of other Kuesa classes.  This header file may change from version to
-// version without notice, or even be removed.
-//
-// We mean it.
-//
+uniform sampler2D sourceTexture;
+uniform vec2 blurStep;
 
-#include <QObject>
-#include <QMetaProperty>
-#include <Qt3DCore/QNode>
-#include "asset.h"
+in vec2 texCoord;
+out vec4 fragColor;
 
-namespace Kuesa {
-class Asset;
-class AssetProperty : public QObject
+void main()
 {
-    Q_OBJECT
-public:
-    explicit AssetProperty(Kuesa::Asset *asset = nullptr);
-
-    Q_INVOKABLE void setQmlProperty();
-    Q_INVOKABLE void setNodeProperty();
-
-    Kuesa::Asset *asset;
-    Qt3DCore::QNode *node;
-    QMetaProperty nodeProperty;
-    QMetaProperty qmlProperty;
-};
-} // namespace Kuesa
-
-#endif // ASSETPROPERTY_P_H
+    vec4 sum = texture(sourceTexture, texCoord) * weights[0];
+    for (int i = 1; i < tapCount; i++) {
+        sum += texture(sourceTexture, texCoord + blurStep * offsets[i]) * weights[i];
+        sum += texture(sourceTexture, texCoord - blurStep * offsets[i]) * weights[i];
+    }
+    fragColor = sum;
+}
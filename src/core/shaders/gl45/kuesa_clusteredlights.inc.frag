@@ -0,0 +1,111 @@
+/*
+    kuesa_clusteredlights.inc.frag
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Lights binned per cluster of the view frustum by Kuesa::ClusteredLights.
+// The sizes must match the ones of clusteredlights_p.h
+
+const int KUESA_MAX_CLUSTER_LIGHTS = 256;
+const int KUESA_CLUSTER_OFFSET_VECTORS = 193;
+const int KUESA_CLUSTER_INDEX_VECTORS = 1024;
+
+// Each light takes 4 vectors:
+// position and range, color and intensity, direction and type,
+// angle scale and offset
+layout(std140, binding = auto) uniform KuesaClusterLights {
+    vec4 kuesa_clusterLights[KUESA_MAX_CLUSTER_LIGHTS * 4];
+};
+
+layout(std140, binding = auto) uniform KuesaClusters {
+    mat4 kuesa_clusterViewMatrix;
+    mat4 kuesa_clusterProjectionMatrix;
+    // Tiles along x and y, depth slices, lights reaching every cluster
+    uvec4 kuesa_clusterGrid;
+    // Near and far planes, scale and bias mapping log(depth) to slices
+    vec4 kuesa_clusterDepth;
+    // Offsets of each cluster into the light index list
+    uvec4 kuesa_clusterOffsets[KUESA_CLUSTER_OFFSET_VECTORS];
+};
+
+// Light indices of 8 bits, 16 per vector
+layout(std140, binding = auto) uniform KuesaClusterLightIndices {
+    uvec4 kuesa_clusterLightIndices[KUESA_CLUSTER_INDEX_VECTORS];
+};
+
+bool kuesa_clusteredLightsEnabled()
+{
+    return kuesa_clusterGrid.x > 0u;
+}
+
+int kuesa_globalLightCount()
+{
+    return int(kuesa_clusterGrid.w);
+}
+
+int kuesa_clusterIndex(const in vec3 worldPosition)
+{
+    vec4 viewPosition = kuesa_clusterViewMatrix * vec4(worldPosition, 1.0);
+    vec4 clipPosition = kuesa_clusterProjectionMatrix * viewPosition;
+    vec2 tile = (clipPosition.xy / clipPosition.w * 0.5 + 0.5) * vec2(kuesa_clusterGrid.xy);
+    float depth = max(-viewPosition.z, kuesa_clusterDepth.x);
+    ivec3 grid = ivec3(kuesa_clusterGrid.xyz);
+    int tileX = clamp(int(floor(tile.x)), 0, grid.x - 1);
+    int tileY = clamp(int(floor(tile.y)), 0, grid.y - 1);
+    int slice = clamp(int(floor(log(depth) * kuesa_clusterDepth.z + kuesa_clusterDepth.w)), 0, grid.z - 1);
+    return tileX + grid.x * (tileY + grid.y * slice);
+}
+
+int kuesa_clusterOffset(const in int cluster)
+{
+    return int(kuesa_clusterOffsets[cluster / 4][cluster % 4]);
+}
+
+int kuesa_clusterLightIndex(const in int i)
+{
+    uint indices = kuesa_clusterLightIndices[i / 16][(i / 4) % 4];
+    return kuesa_globalLightCount() + int((indices >> uint((i % 4) * 8)) & 0xffu);
+}
+
+Light kuesa_clusterLight(const in int index)
+{
+    vec4 positionRange = kuesa_clusterLights[index * 4];
+    vec4 colorIntensity = kuesa_clusterLights[index * 4 + 1];
+    vec4 directionType = kuesa_clusterLights[index * 4 + 2];
+    vec4 angleScaleOffset = kuesa_clusterLights[index * 4 + 3];
+
+    Light light;
+    light.type = int(directionType.w);
+    light.position = positionRange.xyz;
+    light.range = positionRange.w;
+    light.color = colorIntensity.rgb;
+    light.intensity = colorIntensity.a;
+    light.direction = directionType.xyz;
+    light.lightAngleScale = angleScaleOffset.x;
+    light.lightAngleOffset = angleScaleOffset.y;
+    light.castsShadows = false;
+    return light;
+}
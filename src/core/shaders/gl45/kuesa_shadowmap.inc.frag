@@ -41,7 +41,14 @@ layout(binding = auto) uniform samplerCubeShadow shadowMapCubeDepthTexture;
 
 layout(binding = auto) uniform sampler2DArrayShadow shadowMapDepthTextureArray;
 
+// Set by the views which don't fit the cascades to their camera: those only
+// sample the whole scene shadow map rendered into the first cascade tile
+layout(std140, binding = auto) uniform KuesaShadowCascades {
+    bool kuesa_shadowCascadesDisabled;
+};
+
 const int NUM_POINTLIGHT_PCF_SAMPLES = 20;
+const int MAX_CASCADE_COUNT = 4;
 
 vec3 sampleOffsetDirections[NUM_POINTLIGHT_PCF_SAMPLES] = vec3[]
 (
@@ -110,21 +117,53 @@ float shadowMapCoverage(const in Light l, const in vec3 worldPosition, const in
         if (projLightPos.z > 1.0)
             return 1.0;
 
+        vec4 tileRect = l.shadowAtlasRect;
+        if (l.cascadeCount > 1 && !kuesa_shadowCascadesDisabled) {
+            // cascades share the depth range of the light projection, use the
+            // first one containing the position as it has the sharpest shadows
+            bool inCascade = false;
+            for (int i = 0; i < MAX_CASCADE_COUNT; ++i) {
+                if (i >= l.cascadeCount)
+                    break;
+                vec2 cascadePos = projLightPos.xy * l.cascadeScaleOffsets[i].xy + l.cascadeScaleOffsets[i].zw;
+                if (all(greaterThanEqual(cascadePos, vec2(0.0))) && all(lessThanEqual(cascadePos, vec2(1.0)))) {
+                    projLightPos.xy = cascadePos;
+                    tileRect = l.cascadeAtlasRects[i];
+                    inCascade = true;
+                    break;
+                }
+            }
+            if (!inCascade)
+                return 1.0;
+        }
+
         // check x&y manually as work-around for Qt3D not having setting for GL_TEXTURE_BORDER_COLOR
         if ( projLightPos.x > 1.0 || projLightPos.x < 0|| projLightPos.y > 1.0 || projLightPos.y < 0)
             return 1.0;
 
+        // lights which didn't get a tile in the shadow map atlas don't cast shadows
+        if (tileRect.z <= 0.0 || tileRect.w <= 0.0)
+            return 1.0;
+
+        // map the position into the light's tile of the shadow map atlas
+        vec2 atlasPos = tileRect.xy + projLightPos.xy * tileRect.zw;
+
         if (l.usePCF)
         {
             vec2 offset = 1.0 / textureSize(shadowMapDepthTextureArray, 0).xy;
+            // keep the samples inside the tile so that neighbouring tiles don't bleed in
+            vec2 tileMin = tileRect.xy + 0.5 * offset;
+            vec2 tileMax = tileRect.xy + tileRect.zw - 0.5 * offset;
             float shadowCoverage = 0.0;
             for(int i = -1; i <=1; i++)
-                for(int j= -1; j <=1; j++)
-                    shadowCoverage += texture(shadowMapDepthTextureArray, vec4(projLightPos.x + i*offset.x, projLightPos.y + j*offset.y, l.depthArrayIndex, projLightPos.z - bias));
+                for(int j= -1; j <=1; j++) {
+                    vec2 samplePos = clamp(atlasPos + vec2(i, j) * offset, tileMin, tileMax);
+                    shadowCoverage += texture(shadowMapDepthTextureArray, vec4(samplePos, l.depthArrayIndex, projLightPos.z - bias));
+                }
             return shadowCoverage/9;
         }
         else {
-            return texture(shadowMapDepthTextureArray, vec4(projLightPos.x, projLightPos.y, l.depthArrayIndex, projLightPos.z - bias));
+            return texture(shadowMapDepthTextureArray, vec4(atlasPos, l.depthArrayIndex, projLightPos.z - bias));
         }
     }
 }
@@ -45,6 +45,10 @@ struct Light {
     bool usePCF;
     mat4 lightProjectionMatrix;
     vec2 nearFarPlanes;
+    vec4 shadowAtlasRect;
+    int cascadeCount;
+    vec4 cascadeScaleOffsets[4];
+    vec4 cascadeAtlasRects[4];
 };
 
 layout(std140, binding = auto) uniform LightBlock {
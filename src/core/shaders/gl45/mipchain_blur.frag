@@ -0,0 +1,54 @@
+#version 450 core
+
+/*
+    mipchain_blur.frag
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Separable gaussian blur relying on bilinear filtering to fetch two taps at
+// once. Generated with BlurKernel::linearSampledTaps(BlurKernel::binomialWeights(4))
+const int tapCount = 3;
+const float offsets[tapCount] = float[]( 0.0, 1.3846153846, 3.2307692308 );
+const float weights[tapCount] = float[]( 0.2270270270, 0.3162162162, 0.0702702703 );
+
+layout(binding = 3) uniform sampler2D sourceTexture;
+
+layout(std140, binding = 2) uniform MipChainBlurBlock {
+    vec2 blurStep;
+};
+
+layout(location = 0) in vec2 texCoord;
+layout(location = 0) out vec4 fragColor;
+
+void main()
+{
+    vec4 sum = texture(sourceTexture, texCoord) * weights[0];
+    for (int i = 1; i < tapCount; i++) {
+        sum += texture(sourceTexture, texCoord + blurStep * offsets[i]) * weights[i];
+        sum += texture(sourceTexture, texCoord - blurStep * offsets[i]) * weights[i];
+    }
+    fragColor = sum;
+}
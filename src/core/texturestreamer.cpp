@@ -0,0 +1,458 @@
+/*
+    texturestreamer.cpp
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "texturestreamer_p.h"
+#include "sceneentity.h"
+#include "embeddedtextureimage_p.h"
+#include <Kuesa/private/assetmemory_p.h>
+
+#include <Qt3DCore/QEntity>
+#include <Qt3DRender/QAbstractTexture>
+#include <Qt3DRender/QAbstractTextureImage>
+#include <Qt3DRender/QGeometryRenderer>
+#include <Qt3DRender/QMaterial>
+#include <Qt3DRender/QParameter>
+#include <Qt3DRender/QTexture>
+
+#include <QEvent>
+#include <algorithm>
+
+QT_BEGIN_NAMESPACE
+
+namespace Kuesa {
+
+void TextureStreamingPolicy::setMemoryBudget(qint64 memoryBudget)
+{
+    m_memoryBudget = std::max(qint64(0), memoryBudget);
+}
+
+qint64 TextureStreamingPolicy::memoryBudget() const
+{
+    return m_memoryBudget;
+}
+
+void TextureStreamingPolicy::setEvictionDelay(qint64 evictionDelay)
+{
+    m_evictionDelay = std::max(qint64(0), evictionDelay);
+}
+
+qint64 TextureStreamingPolicy::evictionDelay() const
+{
+    return m_evictionDelay;
+}
+
+/*!
+    \internal
+
+    Returns the textures to load and to evict given the \a textures visible at
+    time \a now, in milliseconds. The returned actions are considered applied.
+ */
+TextureStreamingPolicy::Actions TextureStreamingPolicy::update(const std::vector<Texture> &textures, qint64 now)
+{
+    Actions actions;
+    struct Candidate {
+        const void *key;
+        qint64 lastVisible;
+        qint64 bytes;
+    };
+    std::vector<Candidate> candidates;
+
+    m_loadedBytes = 0;
+    for (const Texture &texture : textures) {
+        State &state = m_states[texture.key];
+        if (texture.visible) {
+            state.lastVisible = now;
+            if (!state.loaded) {
+                state.loaded = true;
+                actions.load.push_back(texture.key);
+            }
+        }
+        if (!state.loaded)
+            continue;
+        m_loadedBytes += texture.bytes;
+        if (!texture.visible && now - state.lastVisible >= m_evictionDelay)
+            candidates.push_back({ texture.key, state.lastVisible, texture.bytes });
+    }
+
+    if (m_memoryBudget == 0 || m_loadedBytes <= m_memoryBudget)
+        return actions;
+
+    // Least recently used first, visible textures are never evicted
+    std::stable_sort(candidates.begin(), candidates.end(),
+                     [](const Candidate &a, const Candidate &b) { return a.lastVisible < b.lastVisible; });
+    for (const Candidate &candidate : candidates) {
+        if (m_loadedBytes <= m_memoryBudget)
+            break;
+        m_states[candidate.key].loaded = false;
+        m_loadedBytes -= candidate.bytes;
+        actions.evict.push_back(candidate.key);
+    }
+
+    return actions;
+}
+
+void TextureStreamingPolicy::forget(const void *key)
+{
+    m_states.remove(key);
+}
+
+bool TextureStreamingPolicy::isLoaded(const void *key) const
+{
+    return m_states.value(key).loaded;
+}
+
+qint64 TextureStreamingPolicy::loadedBytes() const
+{
+    return m_loadedBytes;
+}
+
+TextureVisibilitySource::~TextureVisibilitySource() = default;
+
+SceneTextureVisibility::SceneTextureVisibility(Qt3DCore::QNode *node)
+    : m_node(node)
+{
+}
+
+QSet<Qt3DRender::QAbstractTexture *> SceneTextureVisibility::visibleTextures()
+{
+    if (!m_dirty)
+        return m_textures;
+
+    for (const auto &c : m_connections)
+        QObject::disconnect(c);
+    m_connections.clear();
+    m_textures.clear();
+    m_dirty = false;
+    if (!m_node)
+        return m_textures;
+
+    // The importer may live anywhere in the tree, not necessarily below the
+    // SceneEntity, start from the root
+    Qt3DCore::QNode *root = m_node;
+    while (root->parentNode())
+        root = root->parentNode();
+    collect(root);
+    ++m_collectCount;
+    return m_textures;
+}
+
+bool SceneTextureVisibility::eventFilter(QObject *watched, QEvent *event)
+{
+    switch (event->type()) {
+    case QEvent::ChildAdded:
+    case QEvent::ChildRemoved:
+    case QEvent::ParentChange:
+        setDirty();
+        break;
+    default:
+        break;
+    }
+    return QObject::eventFilter(watched, event);
+}
+
+void SceneTextureVisibility::setDirty()
+{
+    m_dirty = true;
+}
+
+void SceneTextureVisibility::collect(Qt3DCore::QNode *node)
+{
+    // Installing a filter twice only moves it to the front
+    node->installEventFilter(this);
+
+    if (auto entity = qobject_cast<Qt3DCore::QEntity *>(node)) {
+        m_connections.push_back(QObject::connect(entity, &Qt3DCore::QNode::enabledChanged, this, &SceneTextureVisibility::setDirty));
+        if (!entity->isEnabled())
+            return;
+
+        m_connections.push_back(QObject::connect(entity, &Qt3DCore::QEntity::componentAdded, this, &SceneTextureVisibility::setDirty));
+        m_connections.push_back(QObject::connect(entity, &Qt3DCore::QEntity::componentRemoved, this, &SceneTextureVisibility::setDirty));
+
+        if (!entity->componentsOfType<Qt3DRender::QGeometryRenderer>().empty()) {
+            const auto materials = entity->componentsOfType<Qt3DRender::QMaterial>();
+            for (Qt3DRender::QMaterial *material : materials) {
+                // Parameters added to the material become its children
+                material->installEventFilter(this);
+                const auto parameters = material->parameters();
+                for (Qt3DRender::QParameter *parameter : parameters) {
+                    m_connections.push_back(QObject::connect(parameter, &Qt3DRender::QParameter::valueChanged, this, &SceneTextureVisibility::setDirty));
+                    if (auto texture = qobject_cast<Qt3DRender::QAbstractTexture *>(parameter->value().value<QObject *>())) {
+                        if (!m_textures.contains(texture))
+                            m_connections.push_back(QObject::connect(texture, &QObject::destroyed, this, &SceneTextureVisibility::setDirty));
+                        m_textures.insert(texture);
+                    }
+                }
+            }
+        }
+    }
+
+    const auto children = node->childNodes();
+    for (Qt3DCore::QNode *child : children)
+        collect(child);
+}
+
+TextureStreamer::TextureStreamer(QObject *parent)
+    : QObject(parent)
+    , m_sceneVisibility(new SceneTextureVisibility(qobject_cast<Qt3DCore::QNode *>(parent)))
+    , m_visibilitySource(m_sceneVisibility.get())
+{
+    m_updateTimer.setInterval(250);
+    QObject::connect(&m_updateTimer, &QTimer::timeout, this, [this] { update(); });
+    m_clock.start();
+}
+
+TextureStreamer::~TextureStreamer()
+{
+    for (auto it = m_textures.begin(), end = m_textures.end(); it != end; ++it) {
+        QObject::disconnect(it->destroyedConnection);
+        for (const auto &c : it->sizeConnections)
+            QObject::disconnect(c);
+    }
+}
+
+/*!
+    \internal
+
+    Returns the streamer of \a sceneEntity, created on first use.
+ */
+TextureStreamer *TextureStreamer::streamer(SceneEntity *sceneEntity)
+{
+    return sceneEntity ? sceneEntity->textureStreamer() : nullptr;
+}
+
+/*!
+    \internal
+
+    Uses \a source to find out which textures are in use instead of walking
+    the entities of the scene. Passing nullptr restores the default.
+ */
+void TextureStreamer::setVisibilitySource(TextureVisibilitySource *source)
+{
+    m_visibilitySource = source ? source : m_sceneVisibility.get();
+}
+
+TextureVisibilitySource *TextureStreamer::visibilitySource() const
+{
+    return m_visibilitySource;
+}
+
+TextureStreamingPolicy *TextureStreamer::policy()
+{
+    return &m_policy;
+}
+
+void TextureStreamer::setUpdateInterval(int updateInterval)
+{
+    m_updateTimer.setInterval(std::max(0, updateInterval));
+}
+
+int TextureStreamer::updateInterval() const
+{
+    return m_updateTimer.interval();
+}
+
+/*!
+    \internal
+
+    Strips \a texture of its content, which will only be loaded once the
+    texture is in use.
+ */
+void TextureStreamer::manage(Qt3DRender::QAbstractTexture *texture)
+{
+    if (texture == nullptr || m_textures.contains(texture))
+        return;
+
+    Content &content = m_textures[texture];
+    if (auto loader = qobject_cast<Qt3DRender::QTextureLoader *>(texture)) {
+        content.source = loader->source();
+    } else {
+        const auto images = texture->textureImages();
+        for (Qt3DRender::QAbstractTextureImage *image : images)
+            content.images.push_back(image);
+        QImage placeholder(1, 1, QImage::Format_RGBA8888);
+        placeholder.fill(Qt::white);
+        content.placeholder = new GLTF2Import::EmbeddedTextureImage(placeholder, texture);
+    }
+    content.width = texture->width();
+    content.height = texture->height();
+    content.depth = texture->depth();
+    content.bytes = AssetMemoryLedger::textureBytes(texture);
+    content.destroyedConnection = QObject::connect(texture, &QObject::destroyed, this, [this, texture] {
+        m_textures.remove(texture);
+        m_policy.forget(texture);
+        if (m_textures.empty())
+            m_updateTimer.stop();
+    });
+
+    // Textures loaded from a file only know their size once loaded
+    const auto f = [this, texture] { updateContentSize(texture); };
+    content.sizeConnections = {
+        QObject::connect(texture, &Qt3DRender::QAbstractTexture::widthChanged, this, f),
+        QObject::connect(texture, &Qt3DRender::QAbstractTexture::heightChanged, this, f),
+        QObject::connect(texture, &Qt3DRender::QAbstractTexture::depthChanged, this, f),
+        QObject::connect(texture, &Qt3DRender::QAbstractTexture::layersChanged, this, f),
+        QObject::connect(texture, &Qt3DRender::QAbstractTexture::formatChanged, this, f),
+        QObject::connect(texture, &Qt3DRender::QAbstractTexture::generateMipMapsChanged, this, f),
+    };
+
+    evict(texture, content);
+
+    if (!m_updateTimer.isActive())
+        m_updateTimer.start();
+}
+
+/*!
+    \internal
+
+    Restores the content of \a texture and stops managing it.
+ */
+void TextureStreamer::release(Qt3DRender::QAbstractTexture *texture)
+{
+    auto it = m_textures.find(texture);
+    if (it == m_textures.end())
+        return;
+
+    if (!it->loaded)
+        load(texture, *it);
+    QObject::disconnect(it->destroyedConnection);
+    for (const auto &c : it->sizeConnections)
+        QObject::disconnect(c);
+    delete it->placeholder.data();
+    m_textures.erase(it);
+    m_policy.forget(texture);
+    if (m_textures.empty())
+        m_updateTimer.stop();
+}
+
+bool TextureStreamer::isManaged(Qt3DRender::QAbstractTexture *texture) const
+{
+    return m_textures.contains(texture);
+}
+
+bool TextureStreamer::isLoaded(Qt3DRender::QAbstractTexture *texture) const
+{
+    const auto it = m_textures.constFind(texture);
+    return it == m_textures.cend() || it->loaded;
+}
+
+int TextureStreamer::managedCount() const
+{
+    return m_textures.size();
+}
+
+void TextureStreamer::update()
+{
+    update(m_clock.elapsed());
+}
+
+/*!
+    \internal
+
+    Loads the managed textures that became visible and evicts the ones unused
+    for too long if over budget, \a now being the current time in milliseconds.
+ */
+void TextureStreamer::update(qint64 now)
+{
+    if (m_textures.empty())
+        return;
+
+    const QSet<Qt3DRender::QAbstractTexture *> visible = m_visibilitySource->visibleTextures();
+
+    std::vector<TextureStreamingPolicy::Texture> textures;
+    textures.reserve(m_textures.size());
+    for (auto it = m_textures.cbegin(), end = m_textures.cend(); it != end; ++it)
+        textures.push_back({ it.key(), visible.contains(it.key()), it->bytes });
+
+    const TextureStreamingPolicy::Actions actions = m_policy.update(textures, now);
+
+    for (const void *key : actions.evict) {
+        auto texture = static_cast<Qt3DRender::QAbstractTexture *>(const_cast<void *>(key));
+        evict(texture, m_textures[texture]);
+        emit textureEvicted(texture);
+    }
+    for (const void *key : actions.load) {
+        auto texture = static_cast<Qt3DRender::QAbstractTexture *>(const_cast<void *>(key));
+        load(texture, m_textures[texture]);
+        emit textureLoaded(texture);
+    }
+}
+
+/*!
+    \internal
+
+    Refreshes the size and estimated memory of \a texture when it changes
+    while loaded. Evicted textures are resized to 1x1 by the streamer itself.
+ */
+void TextureStreamer::updateContentSize(Qt3DRender::QAbstractTexture *texture)
+{
+    auto it = m_textures.find(texture);
+    if (it == m_textures.end() || !it->loaded)
+        return;
+
+    it->width = texture->width();
+    it->height = texture->height();
+    it->depth = texture->depth();
+    it->bytes = AssetMemoryLedger::textureBytes(texture);
+}
+
+void TextureStreamer::load(Qt3DRender::QAbstractTexture *texture, Content &content)
+{
+    if (auto loader = qobject_cast<Qt3DRender::QTextureLoader *>(texture)) {
+        loader->setSource(content.source);
+    } else {
+        if (content.placeholder)
+            texture->removeTextureImage(content.placeholder);
+        for (Qt3DRender::QAbstractTextureImage *image : qAsConst(content.images)) {
+            if (image)
+                texture->addTextureImage(image);
+        }
+    }
+    texture->setSize(content.width, content.height, content.depth);
+    content.loaded = true;
+}
+
+void TextureStreamer::evict(Qt3DRender::QAbstractTexture *texture, Content &content)
+{
+    if (auto loader = qobject_cast<Qt3DRender::QTextureLoader *>(texture)) {
+        loader->setSource(QUrl());
+    } else {
+        // The images stay parented to the texture, the backend drops their data
+        for (Qt3DRender::QAbstractTextureImage *image : qAsConst(content.images)) {
+            if (image)
+                texture->removeTextureImage(image);
+        }
+        if (content.placeholder)
+            texture->addTextureImage(content.placeholder);
+    }
+    content.loaded = false;
+    texture->setSize(1, 1, 1);
+}
+
+} // namespace Kuesa
+
+QT_END_NAMESPACE
@@ -0,0 +1,214 @@
+/*
+    texturestreamer_p.h
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef KUESA_TEXTURESTREAMER_P_H
+#define KUESA_TEXTURESTREAMER_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Kuesa API.  It exists for the convenience
+// of other Kuesa classes.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <Kuesa/private/kuesa_global_p.h>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QObject>
+#include <QPointer>
+#include <QSet>
+#include <QTimer>
+#include <QUrl>
+#include <QVector>
+#include <memory>
+#include <vector>
+
+QT_BEGIN_NAMESPACE
+
+namespace Qt3DCore {
+class QNode;
+}
+
+namespace Qt3DRender {
+class QAbstractTexture;
+class QAbstractTextureImage;
+}
+
+namespace Kuesa {
+
+class SceneEntity;
+
+// Decides which textures to load and which to evict, independently of Qt3D
+// so that it can be driven with arbitrary visibility and time.
+//
+// Visible textures are always loaded. Loaded textures that haven't been
+// visible for evictionDelay are evicted, least recently used first, for as
+// long as the loaded textures exceed the memory budget. A budget of 0 never
+// evicts.
+class KUESA_PRIVATE_EXPORT TextureStreamingPolicy
+{
+public:
+    struct Texture {
+        const void *key;
+        bool visible;
+        qint64 bytes;
+    };
+
+    struct Actions {
+        std::vector<const void *> load;
+        std::vector<const void *> evict;
+    };
+
+    void setMemoryBudget(qint64 memoryBudget);
+    qint64 memoryBudget() const;
+    void setEvictionDelay(qint64 evictionDelay);
+    qint64 evictionDelay() const;
+
+    Actions update(const std::vector<Texture> &textures, qint64 now);
+    void forget(const void *key);
+
+    bool isLoaded(const void *key) const;
+    // As of the last update
+    qint64 loadedBytes() const;
+
+private:
+    struct State {
+        bool loaded = false;
+        qint64 lastVisible = 0;
+    };
+
+    QHash<const void *, State> m_states;
+    qint64 m_memoryBudget = 0;
+    qint64 m_evictionDelay = 10000;
+    qint64 m_loadedBytes = 0;
+};
+
+// Provides the textures currently in use
+class KUESA_PRIVATE_EXPORT TextureVisibilitySource
+{
+public:
+    virtual ~TextureVisibilitySource();
+    virtual QSet<Qt3DRender::QAbstractTexture *> visibleTextures() = 0;
+};
+
+// Textures referenced by the parameters of the materials of the enabled
+// entities rendering a mesh, in the whole tree the given node belongs to.
+// Frustum and layer culling happen on the backend and aren't taken into
+// account. The tree is only walked again once nodes, components, enabled
+// states or parameter values of the walked nodes change.
+class KUESA_PRIVATE_EXPORT SceneTextureVisibility : public QObject, public TextureVisibilitySource
+{
+    Q_OBJECT
+public:
+    explicit SceneTextureVisibility(Qt3DCore::QNode *node);
+
+    QSet<Qt3DRender::QAbstractTexture *> visibleTextures() override;
+    int collectCount() const { return m_collectCount; }
+
+protected:
+    bool eventFilter(QObject *watched, QEvent *event) override;
+
+private:
+    void collect(Qt3DCore::QNode *node);
+    void setDirty();
+
+    QPointer<Qt3DCore::QNode> m_node;
+    QSet<Qt3DRender::QAbstractTexture *> m_textures;
+    std::vector<QMetaObject::Connection> m_connections;
+    int m_collectCount = 0;
+    bool m_dirty = true;
+};
+
+// Loads the images of the textures it manages on demand. Managed textures are
+// stripped of their images (or source for texture loaders) and hold a 1x1
+// placeholder until the policy decides to load them.
+class KUESA_PRIVATE_EXPORT TextureStreamer : public QObject
+{
+    Q_OBJECT
+public:
+    explicit TextureStreamer(QObject *parent = nullptr);
+    ~TextureStreamer();
+
+    static TextureStreamer *streamer(SceneEntity *sceneEntity);
+
+    void setVisibilitySource(TextureVisibilitySource *source);
+    TextureVisibilitySource *visibilitySource() const;
+    TextureStreamingPolicy *policy();
+
+    void setUpdateInterval(int updateInterval);
+    int updateInterval() const;
+
+    void manage(Qt3DRender::QAbstractTexture *texture);
+    void release(Qt3DRender::QAbstractTexture *texture);
+    bool isManaged(Qt3DRender::QAbstractTexture *texture) const;
+    bool isLoaded(Qt3DRender::QAbstractTexture *texture) const;
+    int managedCount() const;
+
+    void update();
+    void update(qint64 now);
+
+Q_SIGNALS:
+    void textureLoaded(Qt3DRender::QAbstractTexture *texture);
+    void textureEvicted(Qt3DRender::QAbstractTexture *texture);
+
+private:
+    struct Content {
+        QVector<QPointer<Qt3DRender::QAbstractTextureImage>> images;
+        QPointer<Qt3DRender::QAbstractTextureImage> placeholder;
+        QUrl source;
+        int width = 1;
+        int height = 1;
+        int depth = 1;
+        qint64 bytes = 0;
+        bool loaded = true;
+        QMetaObject::Connection destroyedConnection;
+        std::vector<QMetaObject::Connection> sizeConnections;
+    };
+
+    void updateContentSize(Qt3DRender::QAbstractTexture *texture);
+
+    void load(Qt3DRender::QAbstractTexture *texture, Content &content);
+    void evict(Qt3DRender::QAbstractTexture *texture, Content &content);
+
+    QHash<Qt3DRender::QAbstractTexture *, Content> m_textures;
+    TextureStreamingPolicy m_policy;
+    std::unique_ptr<SceneTextureVisibility> m_sceneVisibility;
+    TextureVisibilitySource *m_visibilitySource;
+    QTimer m_updateTimer;
+    QElapsedTimer m_clock;
+};
+
+} // namespace Kuesa
+
+QT_END_NAMESPACE
+
+#endif // KUESA_TEXTURESTREAMER_P_H
@@ -28,6 +28,7 @@
 
 #include "transformtracker.h"
 #include <Kuesa/private/kuesa_utils_p.h>
+#include <Kuesa/private/profiler_p.h>
 #include <Qt3DCore/private/qnode_p.h>
 
 using namespace Kuesa;
@@ -554,6 +555,7 @@ void TransformTracker::matchNode()
 
 void TransformTracker::updateScreenProjection()
 {
+    ProfilerScope scope("trackers", "transformTracker");
     if (m_screenSize.width() <= 0 || m_screenSize.height() <= 0)
         return;
     QRect viewport{ 0, 0, m_screenSize.width(), m_screenSize.height() };
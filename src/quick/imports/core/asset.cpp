@@ -29,11 +29,8 @@
 #include "asset.h"
 #include <Kuesa/SceneEntity>
 #include <Kuesa/AbstractAssetCollection>
-
-#include "assetproperty_p.h"
-
-#include <QMetaProperty>
-#include <QMetaMethod>
+#include <Kuesa/private/assetnameregistry_p.h>
+#include <Kuesa/private/propertyforwarder_p.h>
 
 QT_USE_NAMESPACE
 using namespace Kuesa;
@@ -84,6 +81,9 @@ using namespace Kuesa;
     }
     \endcode
 
+    Once the node is found, changes are forwarded at most once per event loop
+    iteration, whatever the number of times a property changed in between.
+
     \sa Kuesa::SceneEntity, Kuesa::AbstractAssetCollection
  */
 
@@ -112,16 +112,21 @@ Asset::Asset(Qt3DCore::QNode *parent)
     : KuesaNode(parent)
     , m_collection(nullptr)
     , m_node(nullptr)
+    , m_propertyForwarder(new PropertyForwarder(this))
 {
     QObject::connect(this, &KuesaNode::sceneEntityChanged,
                      this, [this] {
-                         disconnect(m_loadingDoneConnection);
-                         if (m_sceneEntity)
-                             m_loadingDoneConnection = connect(m_sceneEntity, &SceneEntity::loadingDone, this, &Asset::findAsset);
+                         updateRegistration();
                          findAsset();
                      });
 }
 
+Asset::~Asset()
+{
+    if (m_registry)
+        m_registry->unwatch(this);
+}
+
 AbstractAssetCollection *Asset::collection() const
 {
     return m_collection;
@@ -130,17 +135,15 @@ AbstractAssetCollection *Asset::collection() const
 void Asset::setCollection(AbstractAssetCollection *collection)
 {
     if (m_collection != collection) {
-        if (m_collection) {
+        if (m_collection)
             QObject::disconnect(m_destructionConnections.take(m_collection));
-            disconnect(m_collection, &AbstractAssetCollection::namesChanged, this, &Asset::findAsset);
-        }
         m_collection = collection;
         emit collectionChanged(m_collection);
         if (m_collection) {
             auto f = [this]() { setCollection(nullptr); };
             m_destructionConnections.insert(m_collection, connect(m_collection, &Qt3DCore::QNode::nodeDestroyed, this, f));
-            connect(m_collection, &AbstractAssetCollection::namesChanged, this, &Asset::findAsset);
         }
+        updateRegistration();
         findAsset();
     }
 }
@@ -155,6 +158,7 @@ void Asset::setName(const QString &name)
     if (m_name != name) {
         m_name = name;
         emit nameChanged(m_name);
+        updateRegistration();
         findAsset();
     }
 }
@@ -164,50 +168,18 @@ void Asset::setNode(Qt3DCore::QNode *node)
     if (m_node != node) {
         m_node = node;
 
-        qDeleteAll(m_assetProperties);
-        m_assetProperties.clear();
+        m_propertyForwarder->clear();
         QObject::disconnect(m_releaseAssetPropertiesConnection);
 
         // Get only the Kuesa.Asset user defined properties. We are not interested in default properties!
-        // Iterate on the metaObject properties of this and forward node properties to metaObject properties
+        // Forward the node properties matching the properties declared on the QML type
         if (node != nullptr) {
             const QString &className = metaObject()->className();
 
             // The Kuesa.Asset has been extended with some properties! This is the case we are interested in!
-            if (className.contains(QStringLiteral("_QML_"))) {
-                const auto propertyOffset = this->metaObject()->propertyOffset();
-                const auto nbProperties = this->metaObject()->propertyCount();
-                for (int propertyIdx = propertyOffset; propertyIdx < nbProperties; ++propertyIdx) {
-                    const QMetaProperty property = metaObject()->property(propertyIdx);
-
-                    // Check if current node has a property with this name
-                    const auto nodePropertyId = m_node->metaObject()->indexOfProperty(property.name());
-                    if (nodePropertyId != -1) {
-                        // node has a property with this name. Forward signals and slots
-                        const QMetaProperty nodeProperty = m_node->metaObject()->property(nodePropertyId);
-                        if (nodeProperty.hasNotifySignal()) {
-                            AssetProperty *assetProperty = new AssetProperty(this);
-                            assetProperty->node = m_node;
-                            assetProperty->nodeProperty = nodeProperty;
-                            assetProperty->qmlProperty = property;
-                            QObject::connect(this,
-                                             property.notifySignal(),
-                                             assetProperty,
-                                             assetProperty->metaObject()->method(assetProperty->metaObject()->indexOfMethod("setNodeProperty()")));
-                            QObject::connect(m_node,
-                                             nodeProperty.notifySignal(),
-                                             assetProperty,
-                                             assetProperty->metaObject()->method(assetProperty->metaObject()->indexOfMethod("setQmlProperty()")));
-                            // Set values on QML properties from Node properties
-                            // This can only be done if the QML property is not marked as readonly
-                            assetProperty->setQmlProperty();
-                            // Set values (if valid) from QML properties to Node properties
-                            assetProperty->setNodeProperty();
-                            m_assetProperties.push_back(assetProperty);
-                        }
-                    }
-                }
-            }
+            if (className.contains(QStringLiteral("_QML_")))
+                m_propertyForwarder->setObjects(this, m_node);
+
             m_releaseAssetPropertiesConnection = QObject::connect(m_node, &QNode::nodeDestroyed, this, [this]() {
                 setNode(nullptr);
             });
@@ -221,17 +193,12 @@ Qt3DCore::QNode *Asset::node() const
     return m_node;
 }
 
-void Asset::findAsset()
+QVector<AbstractAssetCollection *> Asset::searchedCollections() const
 {
-    if ((nullptr == m_collection && nullptr == m_sceneEntity) || m_name.isEmpty()) {
-        setNode(nullptr);
-        return;
-    }
-
     QVector<AbstractAssetCollection *> collections;
     if (m_collection) {
         collections << m_collection;
-    } else {
+    } else if (m_sceneEntity) {
         collections << m_sceneEntity->animationClips()
                     << m_sceneEntity->armatures()
                     << m_sceneEntity->effects()
@@ -246,8 +213,44 @@ void Asset::findAsset()
                     << m_sceneEntity->animationMappings()
                     << m_sceneEntity->placeholders();
     }
+    return collections;
+}
+
+void Asset::updateRegistration()
+{
+    if (m_registry)
+        m_registry->unwatch(this);
+    QObject::disconnect(m_namesChangedConnection);
+
+    // Only get woken up when an asset with our name is added to or removed
+    // from one of the collections we search, rather than on every change
+    SceneEntity *sceneEntity = m_sceneEntity;
+    if (!sceneEntity && m_collection)
+        sceneEntity = qobject_cast<SceneEntity *>(m_collection->parent());
+    m_registry = AssetNameRegistry::registry(sceneEntity);
+
+    if (m_name.isEmpty())
+        return;
+
+    if (m_registry) {
+        const auto collections = searchedCollections();
+        for (AbstractAssetCollection *c : collections)
+            m_registry->watch(c, m_name, this, [this] { findAsset(); });
+    } else if (m_collection) {
+        // Collection not belonging to any scene
+        m_namesChangedConnection = connect(m_collection, &AbstractAssetCollection::namesChanged, this, &Asset::findAsset);
+    }
+}
+
+void Asset::findAsset()
+{
+    if ((nullptr == m_collection && nullptr == m_sceneEntity) || m_name.isEmpty()) {
+        setNode(nullptr);
+        return;
+    }
 
-    for (AbstractAssetCollection *c : qAsConst(collections)) {
+    const QVector<AbstractAssetCollection *> collections = searchedCollections();
+    for (AbstractAssetCollection *c : collections) {
         auto n = c->findAsset(m_name);
         if (n) {
             setNode(n);
@@ -33,12 +33,14 @@
 #include <Kuesa/SceneEntity>
 #include <Kuesa/AbstractAssetCollection>
 #include <Kuesa/KuesaNode>
+#include <QPointer>
 
 QT_BEGIN_NAMESPACE
 
 namespace Kuesa {
 
-class AssetProperty;
+class AssetNameRegistry;
+class PropertyForwarder;
 
 class Asset : public KuesaNode
 {
@@ -49,6 +51,7 @@ class Asset : public KuesaNode
 
 public:
     Asset(Qt3DCore::QNode *parent = nullptr);
+    ~Asset();
 
     AbstractAssetCollection *collection() const;
     QString name() const;
@@ -67,14 +70,16 @@ private:
     AbstractAssetCollection *m_collection;
     QString m_name;
     Qt3DCore::QNode *m_node;
+    PropertyForwarder *m_propertyForwarder;
     QHash<Qt3DCore::QNode *, QMetaObject::Connection> m_destructionConnections;
     QMetaObject::Connection m_releaseAssetPropertiesConnection;
-    QMetaObject::Connection m_loadingDoneConnection;
+    QMetaObject::Connection m_namesChangedConnection;
+    QPointer<AssetNameRegistry> m_registry;
 
     void setNode(Qt3DCore::QNode *node);
+    QVector<AbstractAssetCollection *> searchedCollections() const;
+    void updateRegistration();
     void findAsset();
-
-    std::vector<AssetProperty *> m_assetProperties;
 };
 
 } // namespace Kuesa
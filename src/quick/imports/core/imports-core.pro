@@ -29,11 +29,10 @@ TARGET = quickkuesaplugin
 TARGETPATH = Kuesa
 IMPORT_VERSION = 1.3
 
-QT += kuesa qml quick 3dquick 3dquick_private
+QT += kuesa kuesa-private qml quick 3dquick 3dquick_private
 
 SOURCES += \
     animationplayeritem.cpp \
-    assetproperty.cpp \
     forwardrendererextension.cpp \
     kuesaplugin.cpp \
     asset.cpp \
@@ -43,7 +42,6 @@ SOURCES += \
 
 HEADERS += \
     animationplayeritem.h \
-    assetproperty_p.h \
     forwardrendererextension.h \
     kuesaplugin.h \
     asset.h \
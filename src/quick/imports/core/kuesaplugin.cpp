@@ -91,6 +91,8 @@
 #include <Kuesa/Placeholder>
 #include <Kuesa/PlaceholderTracker>
 #include <Kuesa/MeshInstantiator>
+#include <Kuesa/LevelOfDetailSelector>
+#include <Kuesa/ProfilingModel>
 #include <qtkuesa-config.h>
 #ifdef KUESA_KTX
 #include <Kuesa/KTXTexture>
@@ -176,6 +178,8 @@ void KuesaPlugin::registerTypes(const char *uri)
     qmlRegisterUncreatableType<Kuesa::Placeholder>(uri, 1, 0, "Placeholder", QStringLiteral("You are not supposed to create a Placeholder instance"));
     qmlRegisterType<Kuesa::PlaceholderTracker>(uri, 1, 0, "PlaceholderTracker");
     qmlRegisterExtendedType<Kuesa::MeshInstantiator, Kuesa::MeshInstantiatorExtension>(uri, 1, 0, "MeshInstantiator");
+    qmlRegisterType<Kuesa::LevelOfDetailSelector>(uri, 1, 0, "LevelOfDetailSelector");
+    qmlRegisterType<Kuesa::ProfilingModel>(uri, 1, 4, "ProfilingModel");
 
     // Custom Simple Materials
     qmlRegisterType<Kuesa::IroDiffuseMaterial>("Kuesa.Iro", 1, 0, "IroDiffuseMaterial");
@@ -38,9 +38,12 @@
 #include <Kuesa/private/logging_p.h>
 
 #include <Kuesa/private/kuesa_utils_p.h>
+#include <Kuesa/private/resourcereadinesstracker_p.h>
+#include <Kuesa/private/texturestreamer_p.h>
 #include <Qt3DCore/private/qnode_p.h>
 #include <Qt3DCore/private/qabstractnodefactory_p.h>
 #include <Qt3DInput/qinputsettings.h>
+#include <Qt3DRender/qtexture.h>
 
 #include <Kuesa/Iro2PlanarReflectionEquiRectProperties>
 #include <Kuesa/Iro2PlanarReflectionSemProperties>
@@ -167,6 +170,17 @@ Q_LOGGING_CATEGORY(kuesa_utils, "Kuesa.Utils", QtWarningMsg)
     scene might not be visible on screen when this becomes true.
  */
 
+/*!
+    \property KuesaUtils::View3DScene::loadingProgress
+
+    \brief The fraction, between 0 and 1, of the scene texture images and
+    compressed textures which have been loaded once the glTF file has been
+    parsed. It is 0 until the glTF file is loaded and can be used to display a
+    progress bar until the scene becomes ready.
+
+    \since Kuesa 1.4
+ */
+
 /*!
     \property KuesaUtils::View3DScene::asynchronous
 
@@ -308,6 +322,17 @@ Q_LOGGING_CATEGORY(kuesa_utils, "Kuesa.Utils", QtWarningMsg)
     scene might not be visible on screen when this becomes true.
  */
 
+/*!
+    \qmlproperty real KuesaUtils::View3DScene::loadingProgress
+
+    \brief The fraction, between 0 and 1, of the scene texture images and
+    compressed textures which have been loaded once the glTF file has been
+    parsed. It is 0 until the glTF file is loaded and can be used to display a
+    progress bar until the scene becomes ready.
+
+    \since Kuesa 1.4
+ */
+
 /*!
     \qmlproperty bool KuesaUtils::View3DScene::asynchronous
 
@@ -342,7 +367,9 @@ View3DScene::View3DScene(Qt3DCore::QNode *parent)
     , m_renderSettings(new QRenderSettings)
     , m_activeScene(nullptr)
     , m_ready(false)
+    , m_resourcesTracked(false)
     , m_frameCount(0)
+    , m_readinessTracker(new ResourceReadinessTracker(this))
 {
     m_frameGraph = Qt3DCore::QAbstractNodeFactory::createNode<Kuesa::ForwardRenderer>("ForwardRenderer");
     m_importer->setSceneEntity(this);
@@ -358,6 +385,15 @@ View3DScene::View3DScene(Qt3DCore::QNode *parent)
     connect(m_frameAction, &Qt3DLogic::QFrameAction::triggered, this, &View3DScene::updateFrame);
     m_frameAction->setEnabled(false);
 
+    connect(m_readinessTracker, &ResourceReadinessTracker::progressChanged, this, [this] {
+        if (m_resourcesTracked)
+            emit loadingProgressChanged(loadingProgress());
+    });
+    connect(m_readinessTracker, &ResourceReadinessTracker::settled, this, [this] {
+        if (m_resourcesTracked)
+            scheduleReady();
+    });
+
     connect(m_importer, &GLTF2Importer::sourceChanged, this, &View3DScene::sourceChanged);
     connect(m_importer, &GLTF2Importer::asynchronousChanged, this, &View3DScene::asynchronousChanged);
     connect(m_frameGraph, &ForwardRenderer::showDebugOverlayChanged, this, &View3DScene::showDebugOverlayChanged);
@@ -384,12 +420,17 @@ void View3DScene::setSource(const QUrl &source)
         // same name as one from the previous scene.
         clearCollections();
 
+        // Stop tracking the resources of the previous scene
+        m_readinessTracker->clear();
+        m_resourcesTracked = false;
+        m_frameAction->setEnabled(false);
+
         m_importer->setSource(source);
         m_ready = false;
         m_frameCount = 0;
         emit readyChanged(false);
         emit loadedChanged(false);
-        m_frameAction->setEnabled(true);
+        emit loadingProgressChanged(loadingProgress());
     } else {
         // If we switch activeScene but activeScene references the same
         // source, there's no point in reloading it
@@ -528,6 +569,59 @@ void View3DScene::onSceneLoaded()
     loadReflections();
 
     emit loadedChanged(true);
+
+    if (!m_resourcesTracked)
+        trackResources();
+}
+
+/*!
+    \internal
+
+    Rather than polling the status of every texture each frame, count the ones
+    still loading and get notified when they change status.
+*/
+void View3DScene::trackResources()
+{
+    // Textures loaded lazily don't load until in use and mustn't hold back readiness
+    m_readinessTracker->setTextureStreamer(m_importer->options()->lazyTextureLoading()
+                                                   ? TextureStreamer::streamer(this)
+                                                   : nullptr);
+
+    // The importer doesn't fill the texture image collection, go through the
+    // images of the textures instead. Compressed textures are loaded without
+    // texture images.
+    const auto &textureNames = textures()->names();
+    for (const auto &name : textureNames) {
+        Qt3DRender::QAbstractTexture *t = texture(name);
+        if (!t)
+            continue;
+        if (auto *textureLoader = qobject_cast<Qt3DRender::QTextureLoader *>(t)) {
+            m_readinessTracker->track(textureLoader);
+            continue;
+        }
+        const auto images = t->textureImages();
+        for (Qt3DRender::QAbstractTextureImage *image : images)
+            m_readinessTracker->track(image);
+    }
+    m_resourcesTracked = true;
+
+    emit loadingProgressChanged(loadingProgress());
+    if (m_readinessTracker->isSettled())
+        scheduleReady();
+}
+
+/*!
+    \internal
+
+    Resources are uploaded by the time they are settled, wait for a couple of
+    frames for the scene to actually be visible on screen.
+*/
+void View3DScene::scheduleReady()
+{
+    if (m_ready)
+        return;
+    m_frameCount = 0;
+    m_frameAction->setEnabled(true);
 }
 
 void View3DScene::updateTransformTrackers(const std::vector<TransformTracker *> &transformTrackers, View *view)
@@ -562,28 +656,7 @@ void View3DScene::updateFrame(float dt)
     if (m_ready)
         return;
 
-    if (m_frameCount == 0) {
-        bool allReady = true;
-        const auto &textures = textureImages()->names();
-        for (const auto &textureName : textures) {
-            auto texture = textureImage(textureName);
-            auto textureImage = qobject_cast<Qt3DRender::QTextureImage *>(texture);
-            if (!textureImage)
-                continue;
-
-            if (textureImage->status() != Qt3DRender::QTextureImage::Ready) {
-                allReady = false;
-                break;
-            }
-        }
-
-        if (allReady)
-            m_frameCount = 1;
-    } else {
-        m_frameCount++;
-    }
-
-    if (m_frameCount == 2) {
+    if (++m_frameCount == 2) {
         m_ready = true;
         emit readyChanged(true);
         m_frameAction->setEnabled(false);
@@ -923,6 +996,13 @@ bool View3DScene::isLoaded() const
     return m_importer->status() == GLTF2Importer::Ready;
 }
 
+float View3DScene::loadingProgress() const
+{
+    if (!isLoaded() || !m_resourcesTracked)
+        return 0.0f;
+    return m_readinessTracker->progress();
+}
+
 /*!
     \brief Starts all the \l {Kuesa::AnimationPlayer} instances referenced by
     the View3DScene instance.
@@ -48,6 +48,10 @@
 
 QT_BEGIN_NAMESPACE
 
+namespace Kuesa {
+class ResourceReadinessTracker;
+}
+
 namespace KuesaUtils {
 
 class KUESAUTILS_SHARED_EXPORT View3DScene : public Kuesa::SceneEntity
@@ -61,6 +65,7 @@ class KUESAUTILS_SHARED_EXPORT View3DScene : public Kuesa::SceneEntity
     Q_PROPERTY(QSize screenSize READ screenSize WRITE setScreenSize NOTIFY screenSizeChanged)
     Q_PROPERTY(bool ready READ isReady NOTIFY readyChanged)
     Q_PROPERTY(bool loaded READ isLoaded NOTIFY loadedChanged)
+    Q_PROPERTY(float loadingProgress READ loadingProgress NOTIFY loadingProgressChanged)
     Q_PROPERTY(bool asynchronous READ asynchronous WRITE setAsynchronous NOTIFY asynchronousChanged)
     Q_PROPERTY(KuesaUtils::SceneConfiguration *activeScene READ activeScene WRITE setActiveScene NOTIFY activeSceneChanged)
     Q_PROPERTY(QString reflectionPlaneName READ reflectionPlaneName WRITE setReflectionPlaneName NOTIFY reflectionPlaneNameChanged)
@@ -84,6 +89,7 @@ public:
 
     bool isReady() const;
     bool isLoaded() const;
+    float loadingProgress() const;
 
 public Q_SLOTS:
     void setShowDebugOverlay(bool showDebugOverlay);
@@ -110,6 +116,7 @@ Q_SIGNALS:
     void screenSizeChanged(const QSize &screenSize);
     void readyChanged(bool ready);
     void loadedChanged(bool loaded);
+    void loadingProgressChanged(float loadingProgress);
     void asynchronousChanged(bool asynchronous);
     void activeSceneChanged(SceneConfiguration *activeScene);
     void reflectionPlaneNameChanged(const QString &reflectionPlaneName);
@@ -145,6 +152,8 @@ private:
     void updateTransformTrackers(const std::vector<Kuesa::TransformTracker *> &transformTrackers, Kuesa::View *view);
     void updatePlaceholderTrackers(const std::vector<Kuesa::PlaceholderTracker *> &placeholderTrackers, Kuesa::View *view);
     void updateFrame(float dt);
+    void trackResources();
+    void scheduleReady();
     void loadReflections();
 
     Kuesa::GLTF2Importer *m_importer;
@@ -157,9 +166,11 @@ private:
     QPointer<QObject> m_activeSceneOwner;
 
     bool m_ready;
+    bool m_resourcesTracked;
     QString m_reflectionPlaneName;
     int m_frameCount;
     Qt3DLogic::QFrameAction *m_frameAction;
+    Kuesa::ResourceReadinessTracker *m_readinessTracker;
 };
 
 } // namespace KuesaUtils
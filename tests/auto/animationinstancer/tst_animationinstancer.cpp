@@ -0,0 +1,471 @@
+/*
+    tst_animationinstancer.cpp
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <QtTest/QTest>
+#include <QtTest/QSignalSpy>
+#include <Qt3DCore/QTransform>
+#include <Qt3DAnimation/QAnimationClip>
+#include <Qt3DAnimation/QCallbackMapping>
+#include <Qt3DAnimation/QChannelMapper>
+#include <Qt3DAnimation/QChannelMapping>
+#include <Qt3DAnimation/QClipAnimator>
+#include <Qt3DAnimation/QClock>
+#include <Kuesa/AnimationPlayer>
+#include <Kuesa/SceneEntity>
+#include <Kuesa/private/animationinstancer_p.h>
+
+using namespace Kuesa;
+
+namespace {
+
+// Plain QObject target, written through its QMetaProperty
+class TranslationTarget : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(QVector3D translation READ translation WRITE setTranslation)
+public:
+    using QObject::QObject;
+
+    QVector3D translation() const { return m_translation; }
+    void setTranslation(const QVector3D &translation) { m_translation = translation; }
+
+private:
+    QVector3D m_translation;
+};
+
+Qt3DAnimation::QAnimationClip *createClip(Qt3DCore::QNode *parent)
+{
+    Qt3DAnimation::QChannel channel(QStringLiteral("Spin_translation"));
+    for (int i = 0; i < 3; ++i) {
+        Qt3DAnimation::QChannelComponent component;
+        component.appendKeyFrame(Qt3DAnimation::QKeyFrame(QVector2D(0.0f, 0.0f)));
+        component.appendKeyFrame(Qt3DAnimation::QKeyFrame(QVector2D(1.0f, 1.0f)));
+        channel.appendChannelComponent(component);
+    }
+    Qt3DAnimation::QAnimationClipData clipData;
+    clipData.appendChannel(channel);
+
+    auto clip = new Qt3DAnimation::QAnimationClip(parent);
+    clip->setClipData(clipData);
+    return clip;
+}
+
+Qt3DAnimation::QChannelMapper *createMapper(Qt3DCore::QNode *target, Qt3DCore::QNode *parent)
+{
+    auto mapping = new Qt3DAnimation::QChannelMapping;
+    mapping->setChannelName(QStringLiteral("Spin_translation"));
+    mapping->setProperty(QStringLiteral("translation"));
+    mapping->setTarget(target);
+
+    auto mapper = new Qt3DAnimation::QChannelMapper(parent);
+    mapper->addMapping(mapping);
+    return mapper;
+}
+
+std::vector<AnimationInstancer::Target> translationTarget(QObject *target)
+{
+    return { { QStringLiteral("Spin_translation"), target, QByteArrayLiteral("translation") } };
+}
+
+Qt3DAnimation::QAnimationCallback *groupCallback(Qt3DAnimation::QClipAnimator *animator)
+{
+    auto mapping = qobject_cast<Qt3DAnimation::QCallbackMapping *>(animator->channelMapper()->mappings().first());
+    return mapping ? mapping->callback() : nullptr;
+}
+
+} // anonymous
+
+class tst_AnimationInstancer : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+
+    void checkGroups()
+    {
+        // GIVEN
+        Qt3DCore::QNode root;
+        AnimationInstancer instancer;
+        AnimationPlayer player1;
+        AnimationPlayer player2;
+        AnimationPlayer player3;
+        Qt3DCore::QTransform transform1;
+        Qt3DCore::QTransform transform2;
+        Qt3DCore::QTransform transform3;
+        auto clip = createClip(&root);
+        auto mapper = createMapper(&transform1, &root);
+
+        // WHEN
+        Qt3DAnimation::QClipAnimator *animator1 = instancer.join(&player1, clip, mapper, nullptr, 1, translationTarget(&transform1));
+        Qt3DAnimation::QClipAnimator *animator2 = instancer.join(&player2, clip, mapper, nullptr, 1, translationTarget(&transform2));
+
+        // THEN
+        QVERIFY(animator1 != nullptr);
+        QCOMPARE(animator1, animator2);
+        QCOMPARE(animator1->clip(), clip);
+        QCOMPARE(instancer.groupCount(), 1);
+        QCOMPARE(instancer.instanceCount(), 2);
+        QCOMPARE(instancer.mappingCount(), 1);
+
+        // WHEN
+        Qt3DAnimation::QClipAnimator *animator3 = instancer.join(&player3, clip, mapper, nullptr, 3, translationTarget(&transform3));
+
+        // THEN
+        QVERIFY(animator3 != nullptr);
+        QVERIFY(animator3 != animator1);
+        QCOMPARE(animator3->loopCount(), 3);
+        QCOMPARE(instancer.groupCount(), 2);
+        QCOMPARE(instancer.instanceCount(), 3);
+
+        // WHEN
+        // Joining again moves the player to its new group
+        instancer.join(&player3, clip, mapper, nullptr, 1, translationTarget(&transform3));
+
+        // THEN
+        QCOMPARE(instancer.groupCount(), 1);
+        QCOMPARE(instancer.instanceCount(), 3);
+
+        // WHEN
+        // Players of different phase offsets don't share a group
+        Qt3DAnimation::QClipAnimator *animator4 = instancer.join(&player3, clip, mapper, nullptr, 1, translationTarget(&transform3), 0.5f);
+
+        // THEN
+        QVERIFY(animator4 != animator1);
+        QCOMPARE(animator4->normalizedTime(), 0.5f);
+        QCOMPARE(instancer.groupCount(), 2);
+
+        // WHEN
+        instancer.join(&player3, clip, mapper, nullptr, 1, translationTarget(&transform3));
+        instancer.leave(&player1);
+        instancer.leave(&player2);
+
+        // THEN
+        QCOMPARE(instancer.groupCount(), 1);
+        QCOMPARE(instancer.instanceCount(), 1);
+
+        // WHEN
+        instancer.leave(&player3);
+
+        // THEN
+        QCOMPARE(instancer.groupCount(), 0);
+        QCOMPARE(instancer.mappingCount(), 0);
+    }
+
+    void checkFanOut()
+    {
+        // GIVEN
+        Qt3DCore::QNode root;
+        AnimationInstancer instancer;
+        AnimationPlayer player1;
+        AnimationPlayer player2;
+        Qt3DCore::QTransform transform1;
+        Qt3DCore::QTransform transform2;
+        auto clip = createClip(&root);
+        auto mapper = createMapper(&transform1, &root);
+
+        Qt3DAnimation::QClipAnimator *animator = instancer.join(&player1, clip, mapper, nullptr, 1, translationTarget(&transform1));
+        instancer.join(&player2, clip, mapper, nullptr, 1, translationTarget(&transform2));
+        Qt3DAnimation::QAnimationCallback *callback = groupCallback(animator);
+        QVERIFY(callback != nullptr);
+
+        // WHEN
+        callback->valueChanged(QVariant::fromValue(QVector3D(1.0f, 2.0f, 3.0f)));
+
+        // THEN
+        QCOMPARE(transform1.translation(), QVector3D(1.0f, 2.0f, 3.0f));
+        QCOMPARE(transform2.translation(), QVector3D(1.0f, 2.0f, 3.0f));
+
+        // WHEN
+        instancer.leave(&player2);
+        callback->valueChanged(QVariant::fromValue(QVector3D(4.0f, 5.0f, 6.0f)));
+
+        // THEN
+        QCOMPARE(transform1.translation(), QVector3D(4.0f, 5.0f, 6.0f));
+        QCOMPARE(transform2.translation(), QVector3D(1.0f, 2.0f, 3.0f));
+    }
+
+    void checkIndependentPlayers()
+    {
+        // GIVEN
+        Qt3DCore::QNode root;
+        AnimationInstancer instancer;
+        AnimationPlayer player1;
+        AnimationPlayer player2;
+        Qt3DCore::QTransform transform1;
+        Qt3DCore::QTransform transform2;
+        auto clip = createClip(&root);
+        auto mapper = createMapper(&transform1, &root);
+
+        Qt3DAnimation::QClipAnimator *sharedAnimator = instancer.join(&player1, clip, mapper, nullptr, 1, translationTarget(&transform1));
+        instancer.join(&player2, clip, mapper, nullptr, 1, translationTarget(&transform2));
+
+        // THEN
+        // Shared groups only hold running players
+        QVERIFY(sharedAnimator->isRunning());
+
+        // WHEN
+        Qt3DAnimation::QClipAnimator *independentAnimator = instancer.setShared(&player2, false);
+
+        // THEN
+        // Player leaves with its targets, resuming the group playback
+        QVERIFY(independentAnimator != sharedAnimator);
+        QVERIFY(independentAnimator->isRunning());
+        QCOMPARE(instancer.groupCount(), 2);
+        QCOMPARE(instancer.mappingCount(), 2);
+
+        // WHEN
+        groupCallback(independentAnimator)->valueChanged(QVariant::fromValue(QVector3D(1.0f, 2.0f, 3.0f)));
+
+        // THEN
+        QCOMPARE(transform1.translation(), QVector3D());
+        QCOMPARE(transform2.translation(), QVector3D(1.0f, 2.0f, 3.0f));
+
+        // WHEN
+        // Stopped shared groups aren't joined
+        sharedAnimator->setRunning(false);
+        Qt3DAnimation::QClipAnimator *animator = instancer.setShared(&player2, true);
+
+        // THEN
+        QVERIFY(animator != sharedAnimator);
+        QVERIFY(animator->isRunning());
+        QCOMPARE(instancer.groupCount(), 2);
+
+        // WHEN
+        animator = instancer.setShared(&player1, false);
+
+        // THEN
+        // Sole player of a group keeps its animator
+        QCOMPARE(animator, sharedAnimator);
+        QCOMPARE(instancer.groupCount(), 2);
+    }
+
+    void checkInvalidTargets()
+    {
+        // GIVEN
+        Qt3DCore::QNode root;
+        AnimationInstancer instancer;
+        AnimationPlayer player;
+        QObject notATransform;
+        auto clip = createClip(&root);
+        auto mapper = createMapper(&notATransform, &root);
+
+        // WHEN
+        Qt3DAnimation::QClipAnimator *animator = instancer.join(&player, clip, mapper, nullptr, 1, translationTarget(&notATransform));
+
+        // THEN
+        QVERIFY(animator == nullptr);
+        QCOMPARE(instancer.groupCount(), 0);
+        QCOMPARE(instancer.instanceCount(), 0);
+    }
+
+    void checkInstancedPlayers()
+    {
+        // GIVEN
+        SceneEntity scene;
+        Qt3DCore::QTransform gltfTransform;
+        scene.animationClips()->add(QStringLiteral("Spin"), createClip(&scene));
+        scene.animationMappings()->add(QStringLiteral("Spin"), createMapper(&gltfTransform, &scene));
+
+        AnimationPlayer player1;
+        AnimationPlayer player2;
+        Qt3DCore::QTransform transform1;
+        Qt3DCore::QTransform transform2;
+        QSignalSpy instancedSpy(&player1, &AnimationPlayer::instancedChanged);
+
+        // WHEN
+        player1.setInstanced(true);
+        player2.setInstanced(true);
+        player1.setRunning(true);
+        player2.setRunning(true);
+        player1.addTarget(&transform1);
+        player2.addTarget(&transform2);
+        player1.setSceneEntity(&scene);
+        player2.setSceneEntity(&scene);
+        player1.setClip(QStringLiteral("Spin"));
+        player2.setClip(QStringLiteral("Spin"));
+
+        // THEN
+        QCOMPARE(instancedSpy.count(), 1);
+        QVERIFY(player1.isInstanced());
+        QCOMPARE(player1.status(), AnimationPlayer::Ready);
+        QCOMPARE(player2.status(), AnimationPlayer::Ready);
+
+        AnimationInstancer *instancer = scene.findChild<AnimationInstancer *>();
+        QVERIFY(instancer != nullptr);
+        QCOMPARE(instancer->groupCount(), 1);
+        QCOMPARE(instancer->instanceCount(), 2);
+
+        // WHEN
+        // Seeking a player only affects that player
+        player1.setNormalizedTime(0.5f);
+
+        // THEN
+        QCOMPARE(instancer->groupCount(), 2);
+        QCOMPARE(player1.normalizedTime(), 0.5f);
+        QCOMPARE(player2.normalizedTime(), 0.0f);
+        QVERIFY(player1.isRunning());
+        QVERIFY(player2.isRunning());
+
+        // WHEN
+        player1.stop();
+
+        // THEN
+        QVERIFY(!player1.isRunning());
+        QVERIFY(player2.isRunning());
+
+        // WHEN
+        // Starting from rest joins the shared group again
+        player1.reset();
+        player1.start();
+        QCoreApplication::processEvents();
+
+        // THEN
+        QVERIFY(player1.isRunning());
+        QCOMPARE(instancer->groupCount(), 1);
+
+        // WHEN
+        player2.setPhaseOffset(0.25f);
+
+        // THEN
+        QCOMPARE(instancer->groupCount(), 2);
+        QCOMPARE(player2.normalizedTime(), 0.25f);
+
+        // WHEN
+        player2.setPhaseOffset(0.0f);
+        player2.setLoopCount(2);
+
+        // THEN
+        QCOMPARE(instancer->groupCount(), 2);
+
+        // WHEN
+        player1.setInstanced(false);
+        player2.setClip(QString());
+
+        // THEN
+        QCOMPARE(instancer->groupCount(), 0);
+        QCOMPARE(player1.status(), AnimationPlayer::Ready);
+    }
+
+    void benchmarkPlayers_data()
+    {
+        QTest::addColumn<bool>("instanced");
+
+        QTest::newRow("per-player mappers") << false;
+        QTest::newRow("instanced") << true;
+    }
+
+    void benchmarkPlayers()
+    {
+        // GIVEN
+        QFETCH(bool, instanced);
+        const int PlayerCount = 500;
+
+        SceneEntity scene;
+        Qt3DCore::QTransform gltfTransform;
+        scene.animationClips()->add(QStringLiteral("Spin"), createClip(&scene));
+        scene.animationMappings()->add(QStringLiteral("Spin"), createMapper(&gltfTransform, &scene));
+
+        int evaluatedClips = 0;
+        int mappingNodes = 0;
+
+        // WHEN
+        QBENCHMARK {
+            Qt3DCore::QNode root;
+            for (int i = 0; i < PlayerCount; ++i) {
+                auto player = new AnimationPlayer(&root);
+                player->setInstanced(instanced);
+                player->setRunning(true);
+                player->addTarget(new Qt3DCore::QTransform(&root));
+                player->setSceneEntity(&scene);
+                player->setClip(QStringLiteral("Spin"));
+            }
+
+            if (instanced) {
+                AnimationInstancer *instancer = scene.findChild<AnimationInstancer *>();
+                evaluatedClips = instancer->groupCount();
+                mappingNodes = instancer->mappingCount();
+            } else {
+                evaluatedClips = PlayerCount;
+                mappingNodes = root.findChildren<Qt3DAnimation::QChannelMapping *>().size();
+            }
+        }
+
+        // THEN
+        // One clip evaluation and one mapping shared by all the players
+        // instead of one per player
+        QCOMPARE(evaluatedClips, instanced ? 1 : PlayerCount);
+        QCOMPARE(mappingNodes, instanced ? 1 : PlayerCount);
+    }
+
+    void benchmarkFanOut_data()
+    {
+        QTest::addColumn<bool>("transformTargets");
+
+        QTest::newRow("QTransform setters") << true;
+        QTest::newRow("QMetaProperty writes") << false;
+    }
+
+    void benchmarkFanOut()
+    {
+        // GIVEN
+        QFETCH(bool, transformTargets);
+        const int PlayerCount = 2000;
+
+        Qt3DCore::QNode root;
+        AnimationInstancer instancer;
+        auto clip = createClip(&root);
+        auto mapper = createMapper(&root, &root);
+
+        Qt3DAnimation::QClipAnimator *animator = nullptr;
+        for (int i = 0; i < PlayerCount; ++i) {
+            auto player = new AnimationPlayer(&root);
+            QObject *target = transformTargets
+                    ? static_cast<QObject *>(new Qt3DCore::QTransform(&root))
+                    : static_cast<QObject *>(new TranslationTarget(&root));
+            animator = instancer.join(player, clip, mapper, nullptr, 1, translationTarget(target));
+        }
+        Qt3DAnimation::QAnimationCallback *callback = groupCallback(animator);
+        QVERIFY(callback != nullptr);
+
+        // WHEN
+        // One frame worth of results written to all the instances
+        float x = 0.0f;
+        QBENCHMARK {
+            x += 1.0f;
+            callback->valueChanged(QVariant::fromValue(QVector3D(x, 0.0f, 0.0f)));
+        }
+
+        // THEN
+        QCOMPARE(instancer.groupCount(), 1);
+        QCOMPARE(instancer.instanceCount(), PlayerCount);
+    }
+};
+
+QTEST_MAIN(tst_AnimationInstancer)
+
+#include "tst_animationinstancer.moc"
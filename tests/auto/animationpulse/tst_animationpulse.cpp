@@ -28,11 +28,61 @@
 
 #include <QtTest/QTest>
 #include <Kuesa/AnimationPulse>
+#include <Kuesa/SceneEntity>
+#include <Kuesa/private/pulsetrack_p.h>
+#include <Qt3DCore/QTransform>
+#include <Qt3DAnimation/QAnimationClip>
+#include <Qt3DAnimation/QChannelMapper>
+#include <Qt3DAnimation/QChannelMapping>
+#include <Qt3DAnimation/QClipAnimator>
+#include <Qt3DLogic/QFrameAction>
 #include <QSignalSpy>
+#include <vector>
 
 using namespace Kuesa;
 using namespace GLTF2Import;
 
+namespace {
+
+Qt3DAnimation::QChannelComponent pulseComponent(Qt3DAnimation::QKeyFrame::InterpolationType interpolation,
+                                                const std::vector<QVector2D> &points)
+{
+    Qt3DAnimation::QChannelComponent component;
+    for (const QVector2D &point : points) {
+        Qt3DAnimation::QKeyFrame keyFrame(point);
+        keyFrame.setInterpolationType(interpolation);
+        component.appendKeyFrame(keyFrame);
+    }
+    return component;
+}
+
+void addPulseClip(Kuesa::SceneEntity &sceneEntity)
+{
+    // Pulse going from 2 down to 0 over one second
+    Qt3DAnimation::QChannel channel(QStringLiteral("Pulse_translation"));
+    channel.appendChannelComponent(pulseComponent(Qt3DAnimation::QKeyFrame::LinearInterpolation,
+                                                  { { 0.0f, 0.0f }, { 1.0f, 0.0f } }));
+    channel.appendChannelComponent(pulseComponent(Qt3DAnimation::QKeyFrame::LinearInterpolation,
+                                                  { { 0.0f, 2.0f }, { 1.0f, 0.0f } }));
+    channel.appendChannelComponent(pulseComponent(Qt3DAnimation::QKeyFrame::LinearInterpolation,
+                                                  { { 0.0f, 0.0f }, { 1.0f, 0.0f } }));
+    Qt3DAnimation::QAnimationClipData clipData;
+    clipData.appendChannel(channel);
+    auto *clip = new Qt3DAnimation::QAnimationClip;
+    clip->setClipData(clipData);
+    sceneEntity.animationClips()->add(QStringLiteral("Pulse"), clip);
+
+    auto *mapping = new Qt3DAnimation::QChannelMapping;
+    mapping->setChannelName(QStringLiteral("Pulse_translation"));
+    mapping->setProperty(QStringLiteral("translation"));
+    mapping->setTarget(new Qt3DCore::QTransform(&sceneEntity));
+    auto *mapper = new Qt3DAnimation::QChannelMapper;
+    mapper->addMapping(mapping);
+    sceneEntity.animationMappings()->add(QStringLiteral("Pulse"), mapper);
+}
+
+} // namespace
+
 class tst_AnimationPulse : public QObject
 {
     Q_OBJECT
@@ -112,6 +162,169 @@ private Q_SLOTS:
         QCOMPARE(spyUp.count(), 2);
         QCOMPARE(spyDown.count(), 2);
     }
+
+    void checkEmptyTrack()
+    {
+        // GIVEN
+        const Kuesa::PulseTrack track = Kuesa::PulseTrack::fromChannelComponent(Qt3DAnimation::QChannelComponent());
+
+        // THEN
+        QVERIFY(track.isEmpty());
+        QCOMPARE(track.initialPulse(), 0);
+        QCOMPARE(int(track.events().size()), 0);
+        QCOMPARE(track.pulseAt(1.0f), 0);
+    }
+
+    void checkConstantTrack()
+    {
+        // GIVEN
+        const Kuesa::PulseTrack track = Kuesa::PulseTrack::fromChannelComponent(
+                pulseComponent(Qt3DAnimation::QKeyFrame::ConstantInterpolation,
+                               { { 0.0f, 0.0f }, { 1.0f, 1.0f }, { 2.0f, 1.2f }, { 3.0f, 0.0f } }));
+
+        // THEN
+        QVERIFY(!track.isEmpty());
+        QCOMPARE(track.initialPulse(), 0);
+        QCOMPARE(int(track.events().size()), 2);
+        QCOMPARE(track.events()[0].time, 1.0f);
+        QCOMPARE(track.events()[0].pulse, 1);
+        QCOMPARE(track.events()[1].time, 3.0f);
+        QCOMPARE(track.events()[1].pulse, 0);
+
+        QCOMPARE(track.pulseAt(0.5f), 0);
+        QCOMPARE(track.pulseAt(1.0f), 1);
+        QCOMPARE(track.pulseAt(2.5f), 1);
+        QCOMPARE(track.pulseAt(3.0f), 0);
+
+        QCOMPARE(track.nextEvent(0.0f), 0);
+        QCOMPARE(track.nextEvent(1.0f), 1);
+        QCOMPARE(track.nextEvent(3.0f), 2);
+    }
+
+    void checkLinearTrack()
+    {
+        // GIVEN
+        const Kuesa::PulseTrack track = Kuesa::PulseTrack::fromChannelComponent(
+                pulseComponent(Qt3DAnimation::QKeyFrame::LinearInterpolation,
+                               { { 0.0f, 0.0f }, { 1.0f, 2.0f }, { 2.0f, 0.0f } }));
+
+        // THEN
+        // Crosses 0.5 and 1.5 going up, then 1.5 and 0.5 going down
+        QCOMPARE(track.initialPulse(), 0);
+        QCOMPARE(int(track.events().size()), 4);
+        QCOMPARE(track.events()[0].time, 0.25f);
+        QCOMPARE(track.events()[0].pulse, 1);
+        QCOMPARE(track.events()[1].time, 0.75f);
+        QCOMPARE(track.events()[1].pulse, 2);
+        QCOMPARE(track.events()[2].time, 1.25f);
+        QCOMPARE(track.events()[2].pulse, 1);
+        QCOMPARE(track.events()[3].time, 1.75f);
+        QCOMPARE(track.events()[3].pulse, 0);
+
+        QCOMPARE(track.pulseAt(0.2f), 0);
+        QCOMPARE(track.pulseAt(1.0f), 2);
+        QCOMPARE(track.pulseAt(1.5f), 1);
+        QCOMPARE(track.pulseAt(10.0f), 0);
+
+        // Several events in between two frames
+        QCOMPARE(track.nextEvent(0.1f), 0);
+        QCOMPARE(track.nextEvent(1.5f), 3);
+    }
+
+    void checkBezierTrack()
+    {
+        // GIVEN
+        Qt3DAnimation::QChannelComponent component;
+        component.appendKeyFrame(Qt3DAnimation::QKeyFrame({ 0.0f, 0.0f }, { 0.0f, 0.0f }, { 0.5f, 0.0f }));
+        component.appendKeyFrame(Qt3DAnimation::QKeyFrame({ 1.0f, 1.0f }, { 0.5f, 1.0f }, { 1.0f, 1.0f }));
+
+        // WHEN
+        const Kuesa::PulseTrack track = Kuesa::PulseTrack::fromChannelComponent(component);
+
+        // THEN
+        // Symmetric ease in/out crosses 0.5 halfway
+        QCOMPARE(track.initialPulse(), 0);
+        QCOMPARE(int(track.events().size()), 1);
+        QVERIFY(qAbs(track.events()[0].time - 0.5f) < 0.01f);
+        QCOMPARE(track.events()[0].pulse, 1);
+        QCOMPARE(track.pulseAt(0.4f), 0);
+        QCOMPARE(track.pulseAt(0.6f), 1);
+    }
+
+    void checkTrackFromClip()
+    {
+        // GIVEN
+        Kuesa::SceneEntity sceneEntity;
+        Kuesa::AnimationPulse animationPulse;
+        addPulseClip(sceneEntity);
+
+        QSignalSpy spyUp(&animationPulse, &Kuesa::AnimationPulse::up);
+        QSignalSpy spyDown(&animationPulse, &Kuesa::AnimationPulse::down);
+
+        // WHEN
+        animationPulse.setSceneEntity(&sceneEntity);
+        animationPulse.setClip(QStringLiteral("Pulse"));
+
+        // THEN
+        // Pulse at the start of the clip is known without evaluating the clip
+        QCOMPARE(animationPulse.status(), Kuesa::AnimationPlayer::Ready);
+        QCOMPARE(animationPulse.pulse(), 2.0f);
+        QCOMPARE(spyUp.count(), 1);
+        QCOMPARE(spyDown.count(), 0);
+
+        // WHEN
+        // Proxy transform is no longer animated
+        Qt3DCore::QTransform *proxyTransform = qobject_cast<Qt3DCore::QTransform *>(animationPulse.targets().last());
+        QVERIFY(proxyTransform);
+        proxyTransform->setTranslation({ 0, 2.0, 0 });
+
+        // THEN
+        QCOMPARE(animationPulse.pulse(), 2.0f);
+    }
+
+    void checkFrontendPlayback()
+    {
+        // GIVEN
+        Kuesa::SceneEntity sceneEntity;
+        Kuesa::AnimationPulse animationPulse;
+        addPulseClip(sceneEntity);
+        animationPulse.setSceneEntity(&sceneEntity);
+        animationPulse.setClip(QStringLiteral("Pulse"));
+
+        QSignalSpy spyDown(&animationPulse, &Kuesa::AnimationPulse::down);
+
+        Qt3DAnimation::QClipAnimator *animator = animationPulse.findChild<Qt3DAnimation::QClipAnimator *>();
+        Qt3DLogic::QFrameAction *frameAction = animationPulse.findChild<Qt3DLogic::QFrameAction *>();
+        QVERIFY(animator);
+        QVERIFY(frameAction);
+        QVERIFY(sceneEntity.components().contains(frameAction));
+
+        // WHEN
+        animationPulse.setRunning(true);
+
+        // THEN
+        // Clip is not evaluated, the player advances time itself
+        QVERIFY(animationPulse.isRunning());
+        QVERIFY(!animator->isRunning());
+
+        // WHEN
+        emit frameAction->triggered(0.5f);
+
+        // THEN
+        QCOMPARE(animationPulse.normalizedTime(), 0.5f);
+        QCOMPARE(animationPulse.pulse(), 1.0f);
+        QCOMPARE(spyDown.count(), 1);
+
+        // WHEN
+        emit frameAction->triggered(0.6f);
+
+        // THEN
+        // Single loop stops at the end of the clip
+        QCOMPARE(animationPulse.normalizedTime(), 1.0f);
+        QCOMPARE(animationPulse.pulse(), 0.0f);
+        QCOMPARE(spyDown.count(), 2);
+        QVERIFY(!animationPulse.isRunning());
+    }
 };
 
 QTEST_APPLESS_MAIN(tst_AnimationPulse)
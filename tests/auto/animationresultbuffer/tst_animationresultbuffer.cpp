@@ -0,0 +1,293 @@
+/*
+    tst_animationresultbuffer.cpp
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <QtTest/QTest>
+#include <QtTest/QSignalSpy>
+#include <Qt3DCore/QTransform>
+#include <Kuesa/AnimationPlayer>
+#include <Kuesa/MorphController>
+#include <Kuesa/private/animationresultbuffer_p.h>
+
+using namespace Kuesa;
+
+class tst_AnimationResultBuffer : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+
+    void checkCallbacks()
+    {
+        // GIVEN
+        AnimationResultBuffer buffer;
+        Qt3DCore::QTransform transform;
+
+        // WHEN
+        AnimationResultBuffer::Callback translation = buffer.callbackForProperty(&transform, QByteArrayLiteral("translation"));
+        AnimationResultBuffer::Callback translation2 = buffer.callbackForProperty(&transform, QByteArrayLiteral("translation"));
+        AnimationResultBuffer::Callback rotation = buffer.callbackForProperty(&transform, QByteArrayLiteral("rotation"));
+
+        // THEN
+        QVERIFY(translation != nullptr);
+        QVERIFY(rotation != nullptr);
+        QCOMPARE(translation.get(), translation2.get());
+        QVERIFY(translation != rotation);
+        QCOMPARE(buffer.slotCount(), 2);
+        QCOMPARE(buffer.propertyType(&transform, QByteArrayLiteral("translation")), int(QMetaType::QVector3D));
+
+        // THEN
+        QVERIFY(buffer.callbackForProperty(&transform, QByteArrayLiteral("doesNotExist")) == nullptr);
+        QVERIFY(buffer.callbackForProperty(&transform, QByteArrayLiteral("matrix")) != nullptr);
+        QVERIFY(buffer.callbackForProperty(nullptr, QByteArrayLiteral("translation")) == nullptr);
+    }
+
+    void checkWritesAreBatchedAndCoalesced()
+    {
+        // GIVEN
+        AnimationResultBuffer buffer;
+        Qt3DCore::QTransform transform;
+        QSignalSpy translationSpy(&transform, SIGNAL(translationChanged(const QVector3D &)));
+        QSignalSpy countSpy(&buffer, SIGNAL(appliedPropertyCountChanged(int)));
+        QVERIFY(translationSpy.isValid());
+        QVERIFY(countSpy.isValid());
+
+        AnimationResultBuffer::Callback translation = buffer.callbackForProperty(&transform, QByteArrayLiteral("translation"));
+        AnimationResultBuffer::Callback scale = buffer.callbackForProperty(&transform, QByteArrayLiteral("scale"));
+
+        // WHEN
+        translation->valueChanged(QVector3D(1.0f, 0.0f, 0.0f));
+        translation->valueChanged(QVector3D(2.0f, 0.0f, 0.0f));
+        scale->valueChanged(3.0f);
+
+        // THEN
+        QCOMPARE(translationSpy.count(), 0);
+        QCOMPARE(buffer.appliedPropertyCount(), 0);
+
+        // WHEN
+        QCoreApplication::processEvents();
+
+        // THEN
+        QCOMPARE(translationSpy.count(), 1);
+        QCOMPARE(transform.translation(), QVector3D(2.0f, 0.0f, 0.0f));
+        QCOMPARE(transform.scale(), 3.0f);
+        QCOMPARE(buffer.appliedPropertyCount(), 2);
+        QCOMPARE(countSpy.count(), 1);
+
+        // WHEN
+        translation->valueChanged(QVector3D(4.0f, 0.0f, 0.0f));
+        QCoreApplication::processEvents();
+
+        // THEN
+        QCOMPARE(translationSpy.count(), 2);
+        QCOMPARE(buffer.appliedPropertyCount(), 1);
+        QCOMPARE(countSpy.count(), 2);
+    }
+
+    void checkDestroyedTargetsAreSkipped()
+    {
+        // GIVEN
+        AnimationResultBuffer buffer;
+        auto *transform = new Qt3DCore::QTransform;
+        AnimationResultBuffer::Callback translation = buffer.callbackForProperty(transform, QByteArrayLiteral("translation"));
+
+        // WHEN
+        translation->valueChanged(QVector3D(1.0f, 0.0f, 0.0f));
+        delete transform;
+        QCoreApplication::processEvents();
+
+        // THEN
+        QCOMPARE(buffer.appliedPropertyCount(), 0);
+    }
+
+    void checkReleaseFreesSlots()
+    {
+        // GIVEN
+        AnimationResultBuffer buffer;
+        Qt3DCore::QTransform transform;
+        AnimationResultBuffer::Callback translation = buffer.callbackForProperty(&transform, QByteArrayLiteral("translation"));
+        AnimationResultBuffer::Callback shared = buffer.callbackForProperty(&transform, QByteArrayLiteral("translation"));
+        QCOMPARE(translation.get(), shared.get());
+
+        // WHEN -> still used by another mapping
+        buffer.releaseCallback(shared.get());
+
+        // THEN
+        QCOMPARE(buffer.slotCount(), 1);
+
+        // WHEN
+        translation->valueChanged(QVector3D(1.0f, 0.0f, 0.0f));
+        buffer.releaseCallback(translation.get());
+        QCoreApplication::processEvents();
+
+        // THEN -> pending write dropped along with the slot
+        QCOMPARE(buffer.slotCount(), 0);
+        QCOMPARE(transform.translation(), QVector3D());
+
+        // WHEN -> released callbacks ignore late values from the animation jobs
+        translation->valueChanged(QVector3D(2.0f, 0.0f, 0.0f));
+        AnimationResultBuffer::Callback scale = buffer.callbackForProperty(&transform, QByteArrayLiteral("scale"));
+        QCoreApplication::processEvents();
+
+        // THEN -> slot reused
+        QVERIFY(scale != nullptr);
+        QCOMPARE(buffer.slotCount(), 1);
+        QCOMPARE(transform.translation(), QVector3D());
+        QCOMPARE(transform.scale(), 1.0f);
+    }
+
+    void checkReleasedCallbacksAreBounded()
+    {
+        // GIVEN
+        AnimationResultBuffer buffer;
+        Qt3DCore::QTransform transform;
+        AnimationResultBuffer::Callback scale = buffer.callbackForProperty(&transform, QByteArrayLiteral("scale"));
+
+        // WHEN
+        for (int i = 0; i < 10; ++i) {
+            AnimationResultBuffer::Callback translation = buffer.callbackForProperty(&transform, QByteArrayLiteral("translation"));
+            buffer.releaseCallback(translation.get());
+        }
+
+        // THEN -> kept until Qt 3D can no longer call them
+        QCOMPARE(buffer.slotCount(), 1);
+        QCOMPARE(buffer.releasedCallbackCount(), 10);
+
+        // WHEN
+        for (int i = 0; i < AnimationResultBuffer::ReleaseGracePasses; ++i) {
+            scale->valueChanged(float(i));
+            QCoreApplication::processEvents();
+        }
+
+        // THEN
+        QCOMPARE(buffer.releasedCallbackCount(), 10);
+
+        // WHEN
+        scale->valueChanged(5.0f);
+        QCoreApplication::processEvents();
+
+        // THEN
+        QCOMPARE(buffer.releasedCallbackCount(), 0);
+        QCOMPARE(transform.scale(), 5.0f);
+    }
+
+    void checkCallbacksOutliveBuffer()
+    {
+        // GIVEN
+        Qt3DCore::QTransform transform;
+        auto *buffer = new AnimationResultBuffer;
+        AnimationResultBuffer::Callback translation = buffer->callbackForProperty(&transform, QByteArrayLiteral("translation"));
+
+        // WHEN
+        delete buffer;
+        translation->valueChanged(QVector3D(1.0f, 0.0f, 0.0f));
+        QCoreApplication::processEvents();
+
+        // THEN -> late values from the animation jobs are dropped
+        QCOMPARE(transform.translation(), QVector3D());
+    }
+
+    void checkTypedWrites()
+    {
+        // GIVEN
+        AnimationResultBuffer buffer;
+        Qt3DCore::QTransform transform;
+        AnimationResultBuffer::Callback rotation = buffer.callbackForProperty(&transform, QByteArrayLiteral("rotation"));
+        AnimationResultBuffer::Callback matrix = buffer.callbackForProperty(&transform, QByteArrayLiteral("matrix"));
+        const QQuaternion q = QQuaternion::fromAxisAndAngle(QVector3D(0.0f, 1.0f, 0.0f), 45.0f);
+        QMatrix4x4 m;
+        m.translate(1.0f, 2.0f, 3.0f);
+
+        // WHEN
+        rotation->valueChanged(q);
+        matrix->valueChanged(m);
+        QCoreApplication::processEvents();
+
+        // THEN -> types without typed setter go through QVariant
+        QCOMPARE(buffer.appliedPropertyCount(), 2);
+        QCOMPARE(transform.translation(), QVector3D(1.0f, 2.0f, 3.0f));
+    }
+
+    void checkCustomWriter()
+    {
+        // GIVEN
+        AnimationResultBuffer buffer;
+        MorphController controller;
+        controller.setCount(12);
+        QSignalSpy weightsSpy(&controller, SIGNAL(morphWeightsChanged()));
+        QVERIFY(weightsSpy.isValid());
+        const auto writeWeights = [](QObject *target, int, const float *values, int count) {
+            static_cast<MorphController *>(target)->setWeights(QVector<float>(values, values + count));
+            return true;
+        };
+
+        // WHEN
+        AnimationResultBuffer::Callback weights = buffer.callbackForProperty(&controller, QByteArrayLiteral("morphWeights"),
+                                                                             writeWeights);
+        QVector<float> values(12, 0.0f);
+        values[0] = 0.5f;
+        values[10] = 1.0f;
+        weights->valueChanged(QVariant::fromValue(values));
+        QCoreApplication::processEvents();
+
+        // THEN
+        QCOMPARE(weightsSpy.count(), 1);
+        QCOMPARE(controller.weight(0), 0.5f);
+        QCOMPARE(controller.weight(10), 1.0f);
+        QCOMPARE(buffer.appliedPropertyCount(), 1);
+
+        // WHEN -> same evaluation result
+        weights->valueChanged(QVariant::fromValue(values));
+        QCoreApplication::processEvents();
+
+        // THEN
+        QCOMPARE(weightsSpy.count(), 1);
+    }
+
+    void checkAnimationPlayerBatched()
+    {
+        // GIVEN
+        AnimationPlayer player;
+        QSignalSpy spy(&player, SIGNAL(batchedChanged(bool)));
+        QVERIFY(spy.isValid());
+
+        // THEN
+        QCOMPARE(player.isBatched(), false);
+
+        // WHEN
+        player.setBatched(true);
+        player.setBatched(true);
+
+        // THEN
+        QCOMPARE(player.isBatched(), true);
+        QCOMPARE(spy.count(), 1);
+    }
+};
+
+QTEST_MAIN(tst_AnimationResultBuffer)
+
+#include "tst_animationresultbuffer.moc"
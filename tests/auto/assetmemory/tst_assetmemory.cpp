@@ -0,0 +1,316 @@
+/*
+    tst_assetmemory.cpp
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <qtkuesa-config.h>
+#include <QtTest/QTest>
+#include <QtTest/QSignalSpy>
+#include <Qt3DRender/QGeometryRenderer>
+#include <Qt3DRender/QTexture>
+#include <Kuesa/GLTF2Importer>
+#include <Kuesa/SceneEntity>
+#include <Kuesa/private/assetmemory_p.h>
+
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+#include <Qt3DCore/QAttribute>
+#include <Qt3DCore/QBuffer>
+#include <Qt3DCore/QGeometry>
+#else
+#include <Qt3DRender/QAttribute>
+#include <Qt3DRender/QBuffer>
+#include <Qt3DRender/QGeometry>
+#endif
+
+using namespace Kuesa;
+
+namespace {
+
+Qt3DGeometry::QBuffer *createBuffer(int size, Qt3DCore::QNode *parent = nullptr)
+{
+    auto buffer = new Qt3DGeometry::QBuffer(parent);
+    buffer->setData(QByteArray(size, '\0'));
+    return buffer;
+}
+
+Qt3DRender::QGeometryRenderer *createMesh(const QVector<Qt3DGeometry::QBuffer *> &buffers)
+{
+    auto mesh = new Qt3DRender::QGeometryRenderer;
+    auto geometry = new Qt3DGeometry::QGeometry(mesh);
+    for (Qt3DGeometry::QBuffer *buffer : buffers) {
+        auto attribute = new Qt3DGeometry::QAttribute(geometry);
+        attribute->setBuffer(buffer);
+        geometry->addAttribute(attribute);
+    }
+    mesh->setGeometry(geometry);
+    return mesh;
+}
+
+Qt3DRender::QTextureLoader *createTextureLoader(const QString &source, int size)
+{
+    auto texture = new Qt3DRender::QTextureLoader;
+    texture->setSource(QUrl(source));
+    texture->setGenerateMipMaps(false);
+    texture->setFormat(Qt3DRender::QAbstractTexture::RGBA8_UNorm);
+    texture->setSize(size, size);
+    return texture;
+}
+
+} // namespace
+
+class tst_AssetMemory : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+
+    void checkTextureBytes()
+    {
+        // GIVEN
+        Qt3DRender::QTexture2D texture;
+        texture.setFormat(Qt3DRender::QAbstractTexture::RGBA8_UNorm);
+        texture.setSize(256, 256);
+        texture.setGenerateMipMaps(false);
+
+        // THEN
+        QCOMPARE(AssetMemoryLedger::textureBytes(&texture), qint64(256 * 256 * 4));
+
+        // WHEN -> 256x256 down to 1x1
+        texture.setGenerateMipMaps(true);
+
+        // THEN
+        QCOMPARE(AssetMemoryLedger::textureBytes(&texture), qint64(87381 * 4));
+
+        // WHEN
+        texture.setGenerateMipMaps(false);
+        texture.setFormat(Qt3DRender::QAbstractTexture::RGB_DXT1);
+
+        // THEN
+        QCOMPARE(AssetMemoryLedger::textureBytes(&texture), qint64(256 * 256 / 2));
+
+        // GIVEN
+        Qt3DRender::QTextureCubeMap cubeMap;
+        cubeMap.setFormat(Qt3DRender::QAbstractTexture::RGBA16F);
+        cubeMap.setSize(64, 64);
+        cubeMap.setGenerateMipMaps(false);
+
+        // THEN
+        QCOMPARE(AssetMemoryLedger::textureBytes(&cubeMap), qint64(6 * 64 * 64 * 8));
+    }
+
+    void checkSharedResources()
+    {
+        // GIVEN
+        AssetMemoryLedger ledger;
+        QObject a;
+        QObject b;
+        const std::vector<AssetMemoryResource> first = { { &a, QString(), 100, 200 }, { &b, QString(), 10, 0 } };
+        const std::vector<AssetMemoryResource> second = { { &a, QString(), 100, 200 } };
+
+        // WHEN
+        ledger.add(first);
+        ledger.add(second);
+
+        // THEN -> a is counted once
+        QCOMPARE(ledger.resourceCount(), 2);
+        QCOMPARE(ledger.cpuBytes(), qint64(110));
+        QCOMPARE(ledger.gpuBytes(), qint64(200));
+        QCOMPARE(ledger.duplicateCpuBytes(), qint64(0));
+
+        // WHEN
+        ledger.remove(first);
+
+        // THEN -> a is still referenced by second
+        QCOMPARE(ledger.resourceCount(), 1);
+        QCOMPARE(ledger.cpuBytes(), qint64(100));
+        QCOMPARE(ledger.gpuBytes(), qint64(200));
+
+        // WHEN
+        ledger.remove(second);
+
+        // THEN
+        QCOMPARE(ledger.resourceCount(), 0);
+        QCOMPARE(ledger.cpuBytes(), qint64(0));
+        QCOMPARE(ledger.gpuBytes(), qint64(0));
+    }
+
+    void checkDuplicates()
+    {
+        // GIVEN
+        AssetMemoryLedger ledger;
+        QObject a;
+        QObject b;
+        QObject c;
+        const QString source = QStringLiteral("file:///image.png");
+
+        // WHEN
+        ledger.add({ { &a, source, 0, 400 } });
+        ledger.add({ { &b, source, 0, 400 } });
+        ledger.add({ { &c, source, 0, 400 } });
+
+        // THEN
+        QCOMPARE(ledger.gpuBytes(), qint64(1200));
+        QCOMPARE(ledger.duplicateGpuBytes(), qint64(800));
+        const QVariantList duplicates = ledger.duplicates();
+        QCOMPARE(duplicates.size(), 1);
+        const QVariantMap duplicate = duplicates.first().toMap();
+        QCOMPARE(duplicate.value(QStringLiteral("source")).toString(), source);
+        QCOMPARE(duplicate.value(QStringLiteral("copies")).toInt(), 3);
+        QCOMPARE(duplicate.value(QStringLiteral("gpuBytes")).toLongLong(), qint64(800));
+
+        // WHEN -> removing the original makes the next copy the original
+        ledger.remove({ { &a, source, 0, 400 } });
+
+        // THEN
+        QCOMPARE(ledger.gpuBytes(), qint64(800));
+        QCOMPARE(ledger.duplicateGpuBytes(), qint64(400));
+
+        // WHEN
+        ledger.remove({ { &c, source, 0, 400 } });
+
+        // THEN
+        QCOMPARE(ledger.gpuBytes(), qint64(400));
+        QCOMPARE(ledger.duplicateGpuBytes(), qint64(0));
+        QVERIFY(ledger.duplicates().empty());
+    }
+
+    void checkMeshCollection()
+    {
+        // GIVEN
+        SceneEntity scene;
+        QSignalSpy sceneSpy(&scene, &SceneEntity::memoryUsageChanged);
+        QSignalSpy collectionSpy(scene.meshes(), &AbstractAssetCollection::memoryUsageChanged);
+        auto shared = createBuffer(1024, &scene);
+        auto own = createBuffer(512, &scene);
+
+        // THEN
+        QCOMPARE(scene.cpuMemoryUsage(), qint64(0));
+        QCOMPARE(scene.gpuMemoryUsage(), qint64(0));
+
+        // WHEN -> shared buffer referenced twice by the same mesh
+        scene.meshes()->add(QStringLiteral("a"), createMesh({ shared, shared, own }));
+
+        // THEN
+        QCOMPARE(collectionSpy.count(), 1);
+        QCOMPARE(sceneSpy.count(), 1);
+        QCOMPARE(scene.meshes()->cpuMemoryUsage(), qint64(1536));
+        QCOMPARE(scene.meshes()->gpuMemoryUsage(), qint64(1536));
+        QCOMPARE(scene.cpuMemoryUsage(), qint64(1536));
+
+        // WHEN
+        scene.meshes()->add(QStringLiteral("b"), createMesh({ shared }));
+
+        // THEN -> shared buffer only counted once
+        QCOMPARE(scene.meshes()->cpuMemoryUsage(), qint64(1536));
+        QCOMPARE(scene.cpuMemoryUsage(), qint64(1536));
+
+        const QVariantMap report = scene.meshes()->memoryReport();
+        const QVariantList assets = report.value(QStringLiteral("assets")).toList();
+        QCOMPARE(assets.size(), 2);
+        QCOMPARE(assets.first().toMap().value(QStringLiteral("name")).toString(), QStringLiteral("a"));
+        QCOMPARE(assets.first().toMap().value(QStringLiteral("cpuBytes")).toLongLong(), qint64(1536));
+        QCOMPARE(assets.last().toMap().value(QStringLiteral("cpuBytes")).toLongLong(), qint64(1024));
+
+        // WHEN
+        scene.meshes()->remove(QStringLiteral("a"));
+
+        // THEN
+        QCOMPARE(scene.meshes()->cpuMemoryUsage(), qint64(1024));
+        QCOMPARE(scene.cpuMemoryUsage(), qint64(1024));
+
+        // WHEN -> asset destroyed outside of the collection
+        delete scene.meshes()->find(QStringLiteral("b"));
+
+        // THEN
+        QCOMPARE(scene.meshes()->cpuMemoryUsage(), qint64(0));
+        QCOMPARE(scene.cpuMemoryUsage(), qint64(0));
+    }
+
+    void checkTextureCollection()
+    {
+        // GIVEN
+        SceneEntity scene;
+        auto texture = createTextureLoader(QStringLiteral("file:///a.ktx"), 16);
+        scene.textures()->add(QStringLiteral("a"), texture);
+
+        // THEN
+        QCOMPARE(scene.gpuMemoryUsage(), qint64(16 * 16 * 4));
+
+        // WHEN -> loaded texture reports its size
+        QSignalSpy sceneSpy(&scene, &SceneEntity::memoryUsageChanged);
+        texture->setSize(32, 32);
+
+        // THEN
+        QVERIFY(sceneSpy.count() > 0);
+        QCOMPARE(scene.textures()->gpuMemoryUsage(), qint64(32 * 32 * 4));
+        QCOMPARE(scene.gpuMemoryUsage(), qint64(32 * 32 * 4));
+
+        // WHEN -> same image loaded by another texture
+        scene.textures()->add(QStringLiteral("b"), createTextureLoader(QStringLiteral("file:///a.ktx"), 32));
+
+        // THEN
+        QCOMPARE(scene.gpuMemoryUsage(), qint64(2 * 32 * 32 * 4));
+        const QVariantMap report = scene.memoryReport();
+        QCOMPARE(report.value(QStringLiteral("duplicateGpuBytes")).toLongLong(), qint64(32 * 32 * 4));
+        QCOMPARE(report.value(QStringLiteral("duplicates")).toList().size(), 1);
+        const QVariantMap textures = report.value(QStringLiteral("collections")).toMap().value(QStringLiteral("textures")).toMap();
+        QCOMPARE(textures.value(QStringLiteral("gpuBytes")).toLongLong(), qint64(2 * 32 * 32 * 4));
+
+        // WHEN
+        scene.clearCollections();
+
+        // THEN
+        QCOMPARE(scene.gpuMemoryUsage(), qint64(0));
+        QCOMPARE(scene.memoryReport().value(QStringLiteral("duplicateGpuBytes")).toLongLong(), qint64(0));
+    }
+
+    void checkHeadlessLoad()
+    {
+        // GIVEN
+        SceneEntity scene;
+        GLTF2Importer importer;
+        importer.setSceneEntity(&scene);
+
+        // WHEN
+        importer.setSource(QUrl("file:///" ASSETS "Box.gltf"));
+        QCoreApplication::processEvents();
+
+        // THEN
+        QCOMPARE(importer.status(), GLTF2Importer::Ready);
+        QVERIFY(scene.meshes()->cpuMemoryUsage() > 0);
+        QVERIFY(scene.cpuMemoryUsage() >= scene.meshes()->cpuMemoryUsage());
+
+        // WHEN
+        scene.clearCollections();
+
+        // THEN
+        QCOMPARE(scene.cpuMemoryUsage(), qint64(0));
+        QCOMPARE(scene.gpuMemoryUsage(), qint64(0));
+    }
+};
+
+QTEST_MAIN(tst_AssetMemory)
+
+#include "tst_assetmemory.moc"
@@ -0,0 +1,247 @@
+/*
+    tst_assetnameregistry.cpp
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <QtTest/QTest>
+#include <Kuesa/SceneEntity>
+#include <Kuesa/private/assetnameregistry_p.h>
+#include <Qt3DCore/QEntity>
+#include <Qt3DRender/QCamera>
+#include <Qt3DRender/QGeometryRenderer>
+
+using namespace Kuesa;
+
+namespace {
+
+const int ItemCount = 600;
+
+QString assetName(int i)
+{
+    return QStringLiteral("Asset_%1").arg(i);
+}
+
+} // namespace
+
+class tst_AssetNameRegistry : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+
+    void checkSceneRegistry()
+    {
+        // GIVEN
+        SceneEntity scene;
+
+        // THEN
+        QVERIFY(AssetNameRegistry::registry(&scene) != nullptr);
+        QVERIFY(AssetNameRegistry::registry(nullptr) == nullptr);
+        QCOMPARE(AssetNameRegistry::registry(&scene)->watcherCount(), 0);
+    }
+
+    void checkOnlyMatchingWatchersAreWoken()
+    {
+        // GIVEN
+        SceneEntity scene;
+        AssetNameRegistry registry;
+        QObject watcherA;
+        QObject watcherB;
+        int wakeA = 0;
+        int wakeB = 0;
+
+        // WHEN
+        registry.watch(scene.entities(), QStringLiteral("A"), &watcherA, [&wakeA] { ++wakeA; });
+        registry.watch(scene.entities(), QStringLiteral("B"), &watcherB, [&wakeB] { ++wakeB; });
+        registry.watch(scene.cameras(), QStringLiteral("B"), &watcherB, [&wakeB] { ++wakeB; });
+
+        // THEN
+        QCOMPARE(registry.watcherCount(), 2);
+        QCOMPARE(registry.watcherCount(scene.entities(), QStringLiteral("A")), 1);
+        QCOMPARE(registry.watcherCount(scene.cameras(), QStringLiteral("A")), 0);
+
+        // WHEN
+        scene.entities()->add(QStringLiteral("A"), new Qt3DCore::QEntity);
+        scene.entities()->add(QStringLiteral("C"), new Qt3DCore::QEntity);
+        scene.meshes()->add(QStringLiteral("B"), new Qt3DRender::QGeometryRenderer);
+
+        // THEN
+        QCOMPARE(wakeA, 1);
+        QCOMPARE(wakeB, 0);
+
+        // WHEN
+        scene.entities()->add(QStringLiteral("A"), new Qt3DCore::QEntity);
+
+        // THEN
+        QCOMPARE(wakeA, 2);
+
+        // WHEN
+        scene.entities()->remove(QStringLiteral("A"));
+        scene.entities()->remove(QStringLiteral("B"));
+
+        // THEN
+        QCOMPARE(wakeA, 3);
+        QCOMPARE(wakeB, 0);
+
+        // WHEN
+        scene.entities()->add(QStringLiteral("B"), new Qt3DCore::QEntity);
+        scene.entities()->clear();
+
+        // THEN
+        QCOMPARE(wakeA, 3);
+        QCOMPARE(wakeB, 2);
+
+        // WHEN
+        auto camera = new Qt3DRender::QCamera;
+        scene.cameras()->add(QStringLiteral("B"), camera);
+        delete camera;
+
+        // THEN
+        QCOMPARE(wakeB, 4);
+        QVERIFY(!scene.cameras()->contains(QStringLiteral("B")));
+    }
+
+    void checkUnwatch()
+    {
+        // GIVEN
+        SceneEntity scene;
+        AssetNameRegistry registry;
+        QObject watcherA;
+        QObject watcherB;
+        int wakeA = 0;
+        int wakeB = 0;
+        registry.watch(scene.entities(), QStringLiteral("A"), &watcherA, [&] {
+            ++wakeA;
+            // Callbacks can drop other watchers of the same name
+            registry.unwatch(&watcherB);
+        });
+        registry.watch(scene.entities(), QStringLiteral("A"), &watcherB, [&wakeB] { ++wakeB; });
+
+        // WHEN
+        scene.entities()->add(QStringLiteral("A"), new Qt3DCore::QEntity);
+
+        // THEN
+        QCOMPARE(wakeA, 1);
+        QCOMPARE(wakeB, 0);
+        QCOMPARE(registry.watcherCount(scene.entities(), QStringLiteral("A")), 1);
+
+        // WHEN
+        registry.unwatch(&watcherA);
+        scene.entities()->remove(QStringLiteral("A"));
+
+        // THEN
+        QCOMPARE(wakeA, 1);
+        QCOMPARE(registry.watcherCount(), 0);
+        QCOMPARE(registry.watcherCount(scene.entities(), QStringLiteral("A")), 0);
+    }
+
+    void checkCollectionDestruction()
+    {
+        // GIVEN
+        AssetNameRegistry registry;
+        QObject watcher;
+        int wake = 0;
+        auto scene = new SceneEntity;
+        EntityCollection *entities = scene->entities();
+        registry.watch(entities, QStringLiteral("A"), &watcher, [&wake] { ++wake; });
+
+        // WHEN
+        delete scene;
+
+        // THEN
+        QCOMPARE(registry.watcherCount(entities, QStringLiteral("A")), 0);
+
+        // WHEN
+        registry.unwatch(&watcher);
+
+        // THEN
+        QCOMPARE(registry.watcherCount(), 0);
+    }
+
+    void benchmarkLoad_data()
+    {
+        QTest::addColumn<bool>("useRegistry");
+
+        QTest::newRow("registry") << true;
+        QTest::newRow("namesChanged") << false;
+    }
+
+    void benchmarkLoad()
+    {
+        // GIVEN
+        // ItemCount Asset-like items, each resolving one name of the scene
+        // the way Asset does, while ItemCount assets are loaded
+        QFETCH(bool, useRegistry);
+        SceneEntity scene;
+        AssetNameRegistry *registry = AssetNameRegistry::registry(&scene);
+        const QVector<AbstractAssetCollection *> collections = {
+            scene.animationClips(), scene.armatures(), scene.effects(), scene.layers(),
+            scene.materials(), scene.meshes(), scene.skeletons(), scene.textures(),
+            scene.cameras(), scene.entities(), scene.textureImages(),
+            scene.animationMappings(), scene.placeholders()
+        };
+        std::vector<Qt3DCore::QNode *> resolved(ItemCount, nullptr);
+        std::vector<QObject *> items;
+        for (int i = 0; i < ItemCount; ++i) {
+            QObject *item = new QObject;
+            const QString name = assetName(i);
+            auto find = [&collections, &resolved, name, i] {
+                resolved[i] = nullptr;
+                for (AbstractAssetCollection *c : collections) {
+                    if ((resolved[i] = c->findAsset(name)) != nullptr)
+                        break;
+                }
+            };
+            for (AbstractAssetCollection *c : collections) {
+                if (useRegistry)
+                    registry->watch(c, name, item, find);
+                else
+                    QObject::connect(c, &AbstractAssetCollection::namesChanged, item, find);
+            }
+            items.push_back(item);
+        }
+
+        // WHEN
+        QBENCHMARK {
+            scene.entities()->clear();
+            for (int i = 0; i < ItemCount; ++i)
+                scene.entities()->add(assetName(i), new Qt3DCore::QEntity);
+        }
+
+        // THEN
+        for (int i = 0; i < ItemCount; ++i)
+            QCOMPARE(resolved[i], scene.entities()->findAsset(assetName(i)));
+
+        for (QObject *item : items) {
+            registry->unwatch(item);
+            delete item;
+        }
+    }
+};
+
+QTEST_MAIN(tst_AssetNameRegistry)
+
+#include "tst_assetnameregistry.moc"
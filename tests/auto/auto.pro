@@ -132,7 +132,32 @@ qtConfig(private_tests) {
         iromattemult \
         iromatteopaque \
         iromatteskybox \
-        kuesaentity
+        kuesaentity \
+        boundingvolumehierarchy \
+        meshsimplifier \
+        levelofdetailselector \
+        packedmorphtargets \
+        animationresultbuffer \
+        framegraphreconfiguration \
+        rendertargetpool \
+        blurkernel \
+        shadowmapatlas \
+        shadowcascades \
+        lightclustergrid \
+        clusteredlights \
+        particlesimulation \
+        particlesort \
+        metallicroughnessblock \
+        shadervariantcache \
+        assetnameregistry \
+        propertyforwarder \
+        animationinstancer \
+        reflectioncamera \
+        resourcereadinesstracker \
+        profiler \
+        assetmemory \
+        texturestreamer \
+        gltfbatchprocessor
 
     greaterThan(QT_MAJOR_VERSION, 5):
         SUBDIRS += fboresolver
@@ -0,0 +1,176 @@
+/*
+    tst_blurkernel.cpp
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <QtTest/QTest>
+#include <Kuesa/private/blurkernel_p.h>
+#include <numeric>
+
+using namespace Kuesa;
+
+namespace {
+
+bool fuzzyEqual(float a, float b, float epsilon = 1e-6f)
+{
+    return std::abs(a - b) <= epsilon;
+}
+
+} // namespace
+
+class tst_BlurKernel : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+
+    void checkBinomialWeights()
+    {
+        // WHEN
+        const std::vector<float> weights = BlurKernel::binomialWeights(4);
+
+        // THEN -> Constants of the iterative blur shader
+        QCOMPARE(weights.size(), size_t(5));
+        QVERIFY(fuzzyEqual(weights[0], 0.2270270270f));
+        QVERIFY(fuzzyEqual(weights[1], 0.1945945946f));
+        QVERIFY(fuzzyEqual(weights[2], 0.1216216216f));
+        QVERIFY(fuzzyEqual(weights[3], 0.0540540541f));
+        QVERIFY(fuzzyEqual(weights[4], 0.0162162162f));
+
+        // THEN -> Normalized and decreasing
+        for (int radius = 0; radius < 12; ++radius) {
+            const std::vector<float> w = BlurKernel::binomialWeights(radius);
+            QCOMPARE(w.size(), size_t(radius + 1));
+            const float sum = std::accumulate(w.begin() + 1, w.end(), 0.0f) * 2.0f + w[0];
+            QVERIFY(fuzzyEqual(sum, 1.0f, 1e-5f));
+            for (int i = 1; i <= radius; ++i)
+                QVERIFY(w[size_t(i)] < w[size_t(i - 1)]);
+        }
+    }
+
+    void checkLinearSampledTaps()
+    {
+        // WHEN
+        const BlurKernel::LinearTaps taps = BlurKernel::linearSampledTaps(BlurKernel::binomialWeights(4));
+
+        // THEN -> Constants of the mip chain blur shader
+        QCOMPARE(taps.offsets.size(), size_t(3));
+        QCOMPARE(taps.weights.size(), size_t(3));
+        QVERIFY(fuzzyEqual(taps.offsets[0], 0.0f));
+        QVERIFY(fuzzyEqual(taps.offsets[1], 1.3846153846f));
+        QVERIFY(fuzzyEqual(taps.offsets[2], 3.2307692308f));
+        QVERIFY(fuzzyEqual(taps.weights[0], 0.2270270270f));
+        QVERIFY(fuzzyEqual(taps.weights[1], 0.3162162162f));
+        QVERIFY(fuzzyEqual(taps.weights[2], 0.0702702703f));
+
+        // WHEN
+        const BlurKernel::LinearTaps oddTaps = BlurKernel::linearSampledTaps(BlurKernel::binomialWeights(3));
+
+        // THEN -> Last tap fetched on its own
+        QCOMPARE(oddTaps.offsets.size(), size_t(3));
+        QVERIFY(fuzzyEqual(oddTaps.offsets[2], 3.0f));
+    }
+
+    void checkLinearSamplingMatchesDiscreteKernel()
+    {
+        // GIVEN
+        std::vector<float> texels;
+        for (int i = 0; i < 64; ++i)
+            texels.push_back(float((i * 37) % 11) + (i == 32 ? 100.0f : 0.0f));
+
+        for (int radius : { 2, 3, 4, 6 }) {
+            const std::vector<float> weights = BlurKernel::binomialWeights(radius);
+
+            // WHEN
+            const std::vector<float> discrete = BlurKernel::convolve(texels, weights);
+            const std::vector<float> linear = BlurKernel::convolve(texels, BlurKernel::linearSampledTaps(weights));
+
+            // THEN -> Identical away from the clamped edges
+            QCOMPARE(discrete.size(), texels.size());
+            QCOMPARE(linear.size(), texels.size());
+            for (int i = radius; i < int(texels.size()) - radius; ++i)
+                QVERIFY(fuzzyEqual(discrete[size_t(i)], linear[size_t(i)], 1e-4f));
+        }
+    }
+
+    void checkConvolutionPreservesEnergy()
+    {
+        // GIVEN
+        const std::vector<float> constant(16, 3.0f);
+
+        // WHEN
+        const std::vector<float> blurred = BlurKernel::convolve(constant, BlurKernel::linearSampledTaps(BlurKernel::binomialWeights(4)));
+
+        // THEN
+        for (float value : blurred)
+            QVERIFY(fuzzyEqual(value, 3.0f, 1e-5f));
+    }
+
+    void checkMipChainSizes()
+    {
+        // WHEN
+        const std::vector<QSize> sizes = BlurKernel::mipChainSizes(QSize(1920, 1080), 3);
+
+        // THEN
+        QCOMPARE(sizes.size(), size_t(3));
+        QCOMPARE(sizes[0], QSize(960, 540));
+        QCOMPARE(sizes[1], QSize(480, 270));
+        QCOMPARE(sizes[2], QSize(240, 135));
+
+        // WHEN
+        const std::vector<QSize> smallSizes = BlurKernel::mipChainSizes(QSize(5, 2), 4);
+
+        // THEN -> Never smaller than a texel
+        QCOMPARE(smallSizes.size(), size_t(4));
+        QCOMPARE(smallSizes[0], QSize(2, 1));
+        QCOMPARE(smallSizes[1], QSize(1, 1));
+        QCOMPARE(smallSizes[2], QSize(1, 1));
+        QCOMPARE(smallSizes[3], QSize(1, 1));
+
+        // THEN
+        QVERIFY(BlurKernel::mipChainSizes(QSize(512, 512), 0).empty());
+    }
+
+    void checkShadedPixelCount()
+    {
+        // GIVEN
+        const QSize size(3840, 2160);
+        const qint64 fullSize = qint64(size.width()) * size.height();
+
+        // THEN
+        QCOMPARE(BlurKernel::iterativeShadedPixelCount(size, 8), 16 * fullSize);
+        QCOMPARE(BlurKernel::mipChainShadedPixelCount(size, 1),
+                 fullSize + 2 * qint64(1920 * 1080));
+        QCOMPARE(BlurKernel::mipChainShadedPixelCount(size, 2),
+                 fullSize + 3 * qint64(1920 * 1080) + 2 * qint64(960 * 540));
+        QVERIFY(BlurKernel::mipChainShadedPixelCount(size, 3) < 2 * fullSize);
+        QVERIFY(BlurKernel::mipChainShadedPixelCount(size, 3) * 8 < BlurKernel::iterativeShadedPixelCount(size, 8));
+    }
+};
+
+QTEST_MAIN(tst_BlurKernel)
+
+#include "tst_blurkernel.moc"
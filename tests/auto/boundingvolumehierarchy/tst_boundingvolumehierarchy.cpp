@@ -0,0 +1,235 @@
+/*
+    tst_boundingvolumehierarchy.cpp
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <QtTest/QTest>
+#include <Kuesa/private/boundingvolumehierarchy_p.h>
+#include <cmath>
+
+using namespace Kuesa;
+
+namespace {
+
+AxisAlignedBox unitBoxAt(const QVector3D &center)
+{
+    return AxisAlignedBox(center - QVector3D(0.5f, 0.5f, 0.5f),
+                          center + QVector3D(0.5f, 0.5f, 0.5f));
+}
+
+QMatrix4x4 perspectiveViewProjection(const QVector3D &eye, const QVector3D &center)
+{
+    QMatrix4x4 projection;
+    projection.perspective(45.0f, 1.0f, 0.1f, 100.0f);
+    QMatrix4x4 view;
+    view.lookAt(eye, center, QVector3D(0.0f, 1.0f, 0.0f));
+    return projection * view;
+}
+
+std::vector<quintptr> bruteForceQuery(const BoundingVolumeHierarchy &bvh,
+                                      const std::vector<int> &proxies,
+                                      const Frustum &frustum)
+{
+    std::vector<quintptr> visible;
+    for (const int proxy : proxies) {
+        if (frustum.intersects(bvh.fatBounds(proxy)) != Frustum::Outside)
+            visible.push_back(bvh.userData(proxy));
+    }
+    std::sort(visible.begin(), visible.end());
+    return visible;
+}
+
+} // namespace
+
+class tst_BoundingVolumeHierarchy : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+
+    void checkAxisAlignedBox()
+    {
+        // GIVEN
+        AxisAlignedBox box;
+
+        // THEN
+        QVERIFY(!box.isValid());
+
+        // WHEN
+        box.expandToContain(QVector3D(-1.0f, 0.0f, 2.0f));
+        box.expandToContain(QVector3D(1.0f, 2.0f, 4.0f));
+
+        // THEN
+        QVERIFY(box.isValid());
+        QCOMPARE(box.center(), QVector3D(0.0f, 1.0f, 3.0f));
+        QCOMPARE(box.extents(), QVector3D(1.0f, 1.0f, 1.0f));
+        QCOMPARE(box.surfaceArea(), 24.0f);
+        QVERIFY(box.contains(unitBoxAt(QVector3D(0.0f, 1.0f, 3.0f))));
+        QVERIFY(!box.contains(unitBoxAt(QVector3D(1.0f, 1.0f, 3.0f))));
+
+        // WHEN
+        QMatrix4x4 m;
+        m.translate(QVector3D(10.0f, 0.0f, 0.0f));
+        m.rotate(90.0f, QVector3D(0.0f, 1.0f, 0.0f));
+        m.scale(2.0f);
+        const AxisAlignedBox transformed = unitBoxAt(QVector3D()).transformed(m);
+
+        // THEN
+        QVERIFY(qFuzzyCompare(transformed.min, QVector3D(9.0f, -1.0f, -1.0f)));
+        QVERIFY(qFuzzyCompare(transformed.max, QVector3D(11.0f, 1.0f, 1.0f)));
+    }
+
+    void checkFrustumIntersection()
+    {
+        // GIVEN
+        const Frustum frustum = Frustum::fromViewProjection(perspectiveViewProjection(QVector3D(0.0f, 0.0f, 10.0f),
+                                                                                      QVector3D()));
+
+        // THEN
+        QCOMPARE(frustum.intersects(unitBoxAt(QVector3D())), Frustum::Inside);
+        QCOMPARE(frustum.intersects(unitBoxAt(QVector3D(0.0f, 0.0f, 20.0f))), Frustum::Outside);
+        QCOMPARE(frustum.intersects(unitBoxAt(QVector3D(50.0f, 0.0f, 0.0f))), Frustum::Outside);
+        QCOMPARE(frustum.intersects(unitBoxAt(QVector3D(0.0f, 0.0f, 9.9f))), Frustum::Intersects);
+    }
+
+    void checkInsertRemove()
+    {
+        // GIVEN
+        BoundingVolumeHierarchy bvh;
+
+        // THEN
+        QCOMPARE(bvh.proxyCount(), size_t(0));
+        QCOMPARE(bvh.height(), 0);
+
+        // WHEN
+        const int a = bvh.insert(unitBoxAt(QVector3D()), 1);
+        const int b = bvh.insert(unitBoxAt(QVector3D(5.0f, 0.0f, 0.0f)), 2);
+
+        // THEN
+        QCOMPARE(bvh.proxyCount(), size_t(2));
+        QCOMPARE(bvh.height(), 1);
+        QCOMPARE(bvh.userData(a), quintptr(1));
+        QCOMPARE(bvh.userData(b), quintptr(2));
+        QVERIFY(bvh.fatBounds(a).contains(unitBoxAt(QVector3D())));
+
+        // WHEN
+        bvh.remove(a);
+
+        // THEN
+        QCOMPARE(bvh.proxyCount(), size_t(1));
+        QCOMPARE(bvh.height(), 0);
+        QCOMPARE(bvh.userData(b), quintptr(2));
+
+        // WHEN
+        bvh.clear();
+
+        // THEN
+        QCOMPARE(bvh.proxyCount(), size_t(0));
+    }
+
+    void checkIncrementalUpdate()
+    {
+        // GIVEN
+        BoundingVolumeHierarchy bvh;
+        const int proxy = bvh.insert(unitBoxAt(QVector3D()), 0);
+
+        // WHEN
+        const bool smallMoveReinserted = bvh.update(proxy, unitBoxAt(QVector3D(0.05f, 0.0f, 0.0f)));
+
+        // THEN
+        QVERIFY(!smallMoveReinserted);
+
+        // WHEN
+        const bool largeMoveReinserted = bvh.update(proxy, unitBoxAt(QVector3D(10.0f, 0.0f, 0.0f)));
+
+        // THEN
+        QVERIFY(largeMoveReinserted);
+        QVERIFY(bvh.fatBounds(proxy).contains(unitBoxAt(QVector3D(10.0f, 0.0f, 0.0f))));
+    }
+
+    void checkTreeStaysBalanced()
+    {
+        // GIVEN
+        BoundingVolumeHierarchy bvh;
+        const int count = 1024;
+
+        // WHEN -> worst case for an unbalanced tree: sorted insertions
+        for (int i = 0; i < count; ++i)
+            bvh.insert(unitBoxAt(QVector3D(float(i) * 2.0f, 0.0f, 0.0f)), quintptr(i));
+
+        // THEN
+        QCOMPARE(bvh.proxyCount(), size_t(count));
+        QVERIFY(bvh.height() <= 2 * int(std::log2(count)));
+    }
+
+    void checkQueryMatchesBruteForce()
+    {
+        // GIVEN -> A 32x32 parking lot
+        BoundingVolumeHierarchy bvh;
+        std::vector<int> proxies;
+        for (int x = 0; x < 32; ++x) {
+            for (int z = 0; z < 32; ++z) {
+                const quintptr idx = quintptr(x * 32 + z);
+                proxies.push_back(bvh.insert(unitBoxAt(QVector3D(float(x - 16) * 3.0f, 0.0f, float(z - 16) * 3.0f)), idx));
+            }
+        }
+
+        const std::vector<QMatrix4x4> viewProjections = {
+            perspectiveViewProjection(QVector3D(0.0f, 5.0f, 60.0f), QVector3D()),
+            perspectiveViewProjection(QVector3D(0.0f, 80.0f, 0.1f), QVector3D()),
+            perspectiveViewProjection(QVector3D(-50.0f, 2.0f, -50.0f), QVector3D(-60.0f, 2.0f, -60.0f)),
+            perspectiveViewProjection(QVector3D(0.0f, 2.0f, 0.0f), QVector3D(10.0f, 2.0f, 0.0f)),
+        };
+
+        for (const QMatrix4x4 &viewProjection : viewProjections) {
+            // WHEN
+            const Frustum frustum = Frustum::fromViewProjection(viewProjection);
+            std::vector<quintptr> visible;
+            bvh.query(frustum, visible);
+            std::sort(visible.begin(), visible.end());
+
+            // THEN
+            QCOMPARE(visible, bruteForceQuery(bvh, proxies, frustum));
+            QVERIFY(visible.size() < proxies.size());
+        }
+
+        // WHEN -> move half the instances far away
+        for (size_t i = 0; i < proxies.size(); i += 2)
+            bvh.update(proxies[i], unitBoxAt(QVector3D(1000.0f, 0.0f, float(i))));
+
+        const Frustum frustum = Frustum::fromViewProjection(viewProjections.front());
+        std::vector<quintptr> visible;
+        bvh.query(frustum, visible);
+        std::sort(visible.begin(), visible.end());
+
+        // THEN
+        QCOMPARE(visible, bruteForceQuery(bvh, proxies, frustum));
+        for (const quintptr idx : visible)
+            QVERIFY(idx % 2 == 1);
+    }
+};
+
+QTEST_APPLESS_MAIN(tst_BoundingVolumeHierarchy)
+#include "tst_boundingvolumehierarchy.moc"
@@ -0,0 +1,297 @@
+/*
+    tst_clusteredlights.cpp
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <QtTest/QTest>
+#include <Kuesa/private/clusteredlights_p.h>
+#include <Kuesa/directionallight.h>
+#include <Kuesa/pointlight.h>
+#include <Kuesa/spotlight.h>
+#include <Qt3DCore/QEntity>
+#include <Qt3DCore/QTransform>
+#include <Qt3DCore/private/qtransform_p.h>
+#include <Qt3DRender/QCamera>
+#include <Qt3DRender/QParameter>
+#include <cstring>
+#include <random>
+
+using namespace Kuesa;
+
+namespace {
+
+void updateWorldMatrixOnTransform(Qt3DCore::QTransform *t)
+{
+    Qt3DCore::QTransformPrivate *d = static_cast<Qt3DCore::QTransformPrivate *>(Qt3DCore::QNodePrivate::get(t));
+    d->setWorldMatrix(t->matrix());
+}
+
+template<typename Light>
+Light *addLight(Qt3DCore::QEntity *root, const QVector3D &position)
+{
+    auto entity = new Qt3DCore::QEntity(root);
+    auto transform = new Qt3DCore::QTransform;
+    transform->setTranslation(position);
+    updateWorldMatrixOnTransform(transform);
+    auto light = new Light;
+    entity->addComponent(transform);
+    entity->addComponent(light);
+    return light;
+}
+
+Qt3DRender::QCamera *createCamera(Qt3DCore::QEntity *root)
+{
+    auto camera = new Qt3DRender::QCamera(root);
+    camera->setFieldOfView(60.0f);
+    camera->setAspectRatio(1.0f);
+    camera->setNearPlane(1.0f);
+    camera->setFarPlane(100.0f);
+    camera->setPosition(QVector3D(0.0f, 0.0f, 0.0f));
+    camera->setViewCenter(QVector3D(0.0f, 0.0f, -1.0f));
+    updateWorldMatrixOnTransform(camera->transform());
+    return camera;
+}
+
+QVector4D lightVector(const ClusteredLights &clusteredLights, int light, int vector)
+{
+    float v[4];
+    std::memcpy(v, clusteredLights.lightData().constData() + (light * 4 + vector) * sizeof(v), sizeof(v));
+    return QVector4D(v[0], v[1], v[2], v[3]);
+}
+
+template<typename T>
+T clusterValue(const ClusteredLights &clusteredLights, int offset)
+{
+    T value;
+    std::memcpy(&value, clusteredLights.clusterData().constData() + offset, sizeof(T));
+    return value;
+}
+
+QMatrix4x4 clusterMatrix(const ClusteredLights &clusteredLights, int offset)
+{
+    float values[16];
+    std::memcpy(values, clusteredLights.clusterData().constData() + offset, sizeof(values));
+    // Uploaded column major
+    return QMatrix4x4(values).transposed();
+}
+
+quint32 clusterOffset(const ClusteredLights &clusteredLights, int cluster)
+{
+    return clusterValue<quint32>(clusteredLights, ClusteredLights::ClusterHeaderSize + cluster * int(sizeof(quint32)));
+}
+
+} // namespace
+
+class tst_ClusteredLights : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void checkDefaults()
+    {
+        // GIVEN
+        Qt3DCore::QNode owner;
+        ClusteredLights clusteredLights(&owner);
+
+        // THEN
+        QVERIFY(!clusteredLights.isEnabled());
+        QVERIFY(clusteredLights.camera() == nullptr);
+        QVERIFY(clusteredLights.lights().isEmpty());
+        QCOMPARE(clusteredLights.grid().clusterCount(), ClusteredLights::ClusterCount);
+        QCOMPARE(clusteredLights.lightData().size(), ClusteredLights::LightDataSize);
+        QCOMPARE(clusteredLights.clusterData().size(), ClusteredLights::ClusterDataSize);
+        QCOMPARE(clusteredLights.lightIndexData().size(), ClusteredLights::LightIndexDataSize);
+
+        // Uniform blocks of at most 16KB are supported everywhere
+        QVERIFY(ClusteredLights::LightDataSize <= 16384);
+        QVERIFY(ClusteredLights::ClusterDataSize <= 16384);
+        QVERIFY(ClusteredLights::LightIndexDataSize <= 16384);
+
+        // An empty grid makes the shaders use the lights selected by Qt 3D
+        QCOMPARE(clusterValue<quint32>(clusteredLights, 128), 0U);
+
+        const auto parameters = clusteredLights.parameters();
+        QCOMPARE(parameters.size(), 3);
+        QCOMPARE(parameters[0]->name(), QStringLiteral("KuesaClusterLights"));
+        QCOMPARE(parameters[1]->name(), QStringLiteral("KuesaClusters"));
+        QCOMPARE(parameters[2]->name(), QStringLiteral("KuesaClusterLightIndices"));
+        for (Qt3DRender::QParameter *parameter : parameters)
+            QVERIFY(parameter->value().value<Qt3DGeometry::QBuffer *>() != nullptr);
+    }
+
+    void checkAssignment()
+    {
+        // GIVEN
+        Qt3DCore::QEntity root;
+        Qt3DCore::QNode owner;
+        ClusteredLights clusteredLights(&owner);
+        Qt3DRender::QCamera *camera = createCamera(&root);
+
+        auto rangedLight = addLight<PointLight>(&root, QVector3D(0.0f, 0.0f, -10.0f));
+        rangedLight->setRange(5.0f);
+        auto directionalLight = addLight<DirectionalLight>(&root, QVector3D());
+        directionalLight->setDirectionMode(DirectionalLight::World);
+        directionalLight->setDirection(QVector3D(0.0f, -1.0f, 0.0f));
+        directionalLight->setIntensity(2.0f);
+        auto unrangedLight = addLight<PointLight>(&root, QVector3D(1.0f, 2.0f, 3.0f));
+        auto shadowCastingLight = addLight<SpotLight>(&root, QVector3D(0.0f, 0.0f, -20.0f));
+        shadowCastingLight->setRange(10.0f);
+        shadowCastingLight->setCastsShadows(true);
+
+        // WHEN
+        clusteredLights.setCamera(camera);
+        clusteredLights.setLights({ rangedLight, directionalLight, unrangedLight, shadowCastingLight });
+        clusteredLights.setEnabled(true);
+
+        // THEN
+        QCOMPARE(clusteredLights.globalLightCount(), 2);
+        QCOMPARE(clusteredLights.clusteredLightCount(), 1);
+        QCOMPARE(clusteredLights.grid().lightCount(), 1);
+
+        // Lights reaching every cluster come first
+        QCOMPARE(lightVector(clusteredLights, 0, 1).w(), 2.0f);
+        QCOMPARE(lightVector(clusteredLights, 0, 2), QVector4D(0.0f, -1.0f, 0.0f, float(Qt3DRender::QAbstractLight::DirectionalLight)));
+        QCOMPARE(lightVector(clusteredLights, 1, 0), QVector4D(1.0f, 2.0f, 3.0f, 0.0f));
+        QCOMPARE(lightVector(clusteredLights, 2, 0), QVector4D(0.0f, 0.0f, -10.0f, 5.0f));
+        QCOMPARE(lightVector(clusteredLights, 2, 2).w(), float(Qt3DRender::QAbstractLight::PointLight));
+        QCOMPARE(lightVector(clusteredLights, 3, 0), QVector4D());
+
+        // Grid description
+        QCOMPARE(clusterMatrix(clusteredLights, 0), QMatrix4x4());
+        QCOMPARE(clusterMatrix(clusteredLights, 64), camera->projectionMatrix());
+        QCOMPARE(clusterValue<quint32>(clusteredLights, 128), quint32(ClusteredLights::TileCountX));
+        QCOMPARE(clusterValue<quint32>(clusteredLights, 132), quint32(ClusteredLights::TileCountY));
+        QCOMPARE(clusterValue<quint32>(clusteredLights, 136), quint32(ClusteredLights::SliceCount));
+        QCOMPARE(clusterValue<quint32>(clusteredLights, 140), 2U);
+        QCOMPARE(clusterValue<float>(clusteredLights, 144), 1.0f);
+        QCOMPARE(clusterValue<float>(clusteredLights, 148), 100.0f);
+
+        // Offsets and indices are those of the grid
+        const std::vector<quint32> &offsets = clusteredLights.grid().clusterOffsets();
+        for (int cluster = 0; cluster <= ClusteredLights::ClusterCount; ++cluster)
+            QCOMPARE(clusterOffset(clusteredLights, cluster), offsets[size_t(cluster)]);
+
+        // The cluster at the center of the screen, 10 units away, holds the light
+        const LightClusterGrid &grid = clusteredLights.grid();
+        const int cluster = grid.clusterIndex(ClusteredLights::TileCountX / 2,
+                                              ClusteredLights::TileCountY / 2,
+                                              grid.sliceForDepth(10.0f));
+        QCOMPARE(clusterOffset(clusteredLights, cluster + 1) - clusterOffset(clusteredLights, cluster), 1U);
+        QCOMPARE(quint8(clusteredLights.lightIndexData()[int(clusterOffset(clusteredLights, cluster))]), quint8(0));
+
+        // Far away clusters don't
+        const int farCluster = grid.clusterIndex(0, 0, ClusteredLights::SliceCount - 1);
+        QCOMPARE(clusterOffset(clusteredLights, farCluster + 1), clusterOffset(clusteredLights, farCluster));
+
+        // WHEN
+        rangedLight->setRange(7.0f);
+
+        // THEN
+        QTRY_COMPARE(lightVector(clusteredLights, 2, 0).w(), 7.0f);
+
+        // WHEN
+        clusteredLights.setEnabled(false);
+
+        // THEN
+        QCOMPARE(clusterValue<quint32>(clusteredLights, 128), 0U);
+        QCOMPARE(lightVector(clusteredLights, 2, 0), QVector4D());
+    }
+
+    void checkOrthographicProjection()
+    {
+        // GIVEN
+        Qt3DCore::QEntity root;
+        Qt3DCore::QNode owner;
+        ClusteredLights clusteredLights(&owner);
+        Qt3DRender::QCamera *camera = createCamera(&root);
+        camera->setProjectionType(Qt3DRender::QCameraLens::OrthographicProjection);
+
+        auto rangedLight = addLight<PointLight>(&root, QVector3D(0.0f, 0.0f, -10.0f));
+        rangedLight->setRange(5.0f);
+
+        // WHEN
+        clusteredLights.setCamera(camera);
+        clusteredLights.setLights({ rangedLight });
+        clusteredLights.setEnabled(true);
+
+        // THEN
+        // The grid only covers perspective frustums, the light reaches every cluster
+        QCOMPARE(clusteredLights.globalLightCount(), 1);
+        QCOMPARE(clusteredLights.clusteredLightCount(), 0);
+        QCOMPARE(clusterOffset(clusteredLights, ClusteredLights::ClusterCount), 0U);
+    }
+
+    void checkLightDestruction()
+    {
+        // GIVEN
+        Qt3DCore::QEntity root;
+        Qt3DCore::QNode owner;
+        ClusteredLights clusteredLights(&owner);
+        clusteredLights.setCamera(createCamera(&root));
+        auto light = addLight<PointLight>(&root, QVector3D(0.0f, 0.0f, -10.0f));
+        light->setRange(5.0f);
+        clusteredLights.setLights({ light });
+        clusteredLights.setEnabled(true);
+        QCOMPARE(clusteredLights.clusteredLightCount(), 1);
+
+        // WHEN
+        delete light;
+
+        // THEN
+        QVERIFY(clusteredLights.lights().isEmpty());
+        QTRY_COMPARE(clusteredLights.clusteredLightCount(), 0);
+    }
+
+    void benchmarkUpdate()
+    {
+        // GIVEN
+        Qt3DCore::QEntity root;
+        Qt3DCore::QNode owner;
+        ClusteredLights clusteredLights(&owner);
+        clusteredLights.setCamera(createCamera(&root));
+
+        std::mt19937 generator(883);
+        std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+        QVector<ShadowCastingLight *> lights;
+        for (int i = 0; i < ClusteredLights::MaxLights; ++i) {
+            auto light = addLight<PointLight>(&root, QVector3D(unit(generator) * 50.0f,
+                                                                unit(generator) * 50.0f,
+                                                                -std::abs(unit(generator)) * 100.0f));
+            light->setRange(2.0f + std::abs(unit(generator)) * 8.0f);
+            lights.push_back(light);
+        }
+        clusteredLights.setLights(lights);
+        clusteredLights.setEnabled(true);
+
+        // THEN
+        QBENCHMARK {
+            clusteredLights.update();
+        }
+    }
+};
+
+QTEST_MAIN(tst_ClusteredLights)
+#include "tst_clusteredlights.moc"
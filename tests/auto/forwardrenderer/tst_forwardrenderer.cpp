@@ -36,10 +36,14 @@
 #include <Kuesa/private/transparentrenderstage_p.h>
 #include <Kuesa/private/scenestages_p.h>
 #include <Kuesa/private/reflectionstages_p.h>
+#include <Kuesa/private/shadowmapstages_p.h>
 #include <Kuesa/private/framegraphutils_p.h>
 #include <Kuesa/private/effectsstages_p.h>
 #include <Kuesa/private/fboresolver_p.h>
 #include <Kuesa/private/viewresolver_p.h>
+#include <Kuesa/private/rendertargetpool_p.h>
+#include <Kuesa/private/transienttexture_p.h>
+#include <Kuesa/gaussianblureffect.h>
 #include <Qt3DRender/QViewport>
 #include <Qt3DRender/QCameraSelector>
 #include <Qt3DRender/QCamera>
@@ -59,6 +63,7 @@
 #include <QWindow>
 #include <QSurfaceFormat>
 #include <QOffscreenSurface>
+#include <algorithm>
 
 namespace {
 
@@ -302,6 +307,63 @@ private Q_SLOTS:
         QCOMPARE(f.views().size(), 0U);
     }
 
+    void testShadowCascadeCamera()
+    {
+        // GIVEN
+        Kuesa::ForwardRenderer f;
+        Qt3DRender::QCamera mainCamera;
+        Qt3DRender::QCamera firstViewCamera;
+        Qt3DRender::QCamera secondViewCamera;
+        f.setCamera(&mainCamera);
+        QSignalSpy spy(&f, &Kuesa::ForwardRenderer::shadowCascadeCameraChanged);
+
+        // THEN
+        QCOMPARE(f.shadowCascadeCamera(), &mainCamera);
+        QVERIFY(f.m_shadowMapStages->cascadesEnabled());
+        QVERIFY(f.m_sceneStages->shadowCascadesEnabled());
+
+        // WHEN
+        Kuesa::View v1;
+        Kuesa::View v2;
+        v1.setCamera(&firstViewCamera);
+        v2.setCamera(&secondViewCamera);
+        f.addView(&v1);
+        f.addView(&v2);
+
+        // THEN -> Cascades follow the first view, the second one uses a
+        // whole scene shadow map
+        QCOMPARE(f.shadowCascadeCamera(), &firstViewCamera);
+        QCOMPARE(spy.count(), 1);
+        QVERIFY(v1.m_shadowMapStages->cascadesEnabled());
+        QVERIFY(v1.m_sceneStages->shadowCascadesEnabled());
+        QVERIFY(v1.m_reflectionStages->shadowCascadesEnabled());
+        QVERIFY(!v2.m_shadowMapStages->cascadesEnabled());
+        QVERIFY(!v2.m_sceneStages->shadowCascadesEnabled());
+        QVERIFY(!v2.m_reflectionStages->shadowCascadesEnabled());
+
+        // WHEN
+        v1.setCamera(&secondViewCamera);
+
+        // THEN
+        QCOMPARE(spy.count(), 2);
+        QCOMPARE(spy.last().first().value<Qt3DCore::QEntity *>(), &secondViewCamera);
+
+        // WHEN
+        f.removeView(&v1);
+
+        // THEN
+        QCOMPARE(f.shadowCascadeCamera(), &secondViewCamera);
+        QVERIFY(v2.m_shadowMapStages->cascadesEnabled());
+        QVERIFY(v2.m_sceneStages->shadowCascadesEnabled());
+
+        // WHEN
+        f.removeView(&v2);
+
+        // THEN
+        QCOMPARE(f.shadowCascadeCamera(), &mainCamera);
+        QCOMPARE(spy.last().first().value<Qt3DCore::QEntity *>(), &mainCamera);
+    }
+
     void testSetupRenderTargetsNoFXNoMSAA()
     {
 #if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
@@ -1248,16 +1310,16 @@ private Q_SLOTS:
 
         if (Kuesa::FrameGraphUtils::hasMSAASupport()) {
             QCOMPARE(v1.children().size(), 6);
-            QCOMPARE(v1.children()[0], v1.m_fg->m_renderTargets[0]);
-            QCOMPARE(v1.children()[1], v1.m_fg->m_multisampleTarget);
-            QCOMPARE(v1.children()[2], v1.m_fg->m_renderToTextureRootNode);
+            QCOMPARE(v1.children()[0], v1.m_fg->m_renderToTextureRootNode);
+            QCOMPARE(v1.children()[1], v1.m_fg->m_renderTargets[0]);
+            QCOMPARE(v1.children()[2], v1.m_fg->m_multisampleTarget);
             QCOMPARE(v1.children()[3], v1.m_fg->m_renderTargets[1]);
             QCOMPARE(v1.children()[4], v1.m_fxStages);
             QCOMPARE(v1.children()[5], v1.m_internalFXStages);
             QCOMPARE(v2.children().size(), 6);
-            QCOMPARE(v2.children()[0], v2.m_fg->m_renderTargets[0]);
-            QCOMPARE(v2.children()[1], v2.m_fg->m_multisampleTarget);
-            QCOMPARE(v2.children()[2], v2.m_fg->m_renderToTextureRootNode);
+            QCOMPARE(v2.children()[0], v2.m_fg->m_renderToTextureRootNode);
+            QCOMPARE(v2.children()[1], v2.m_fg->m_renderTargets[0]);
+            QCOMPARE(v2.children()[2], v2.m_fg->m_multisampleTarget);
             QCOMPARE(v2.children()[3], v2.m_fg->m_renderTargets[1]);
             QCOMPARE(v2.children()[4], v2.m_fxStages);
             QCOMPARE(v2.children()[5], v2.m_internalFXStages);
@@ -1277,14 +1339,14 @@ private Q_SLOTS:
             QCOMPARE(v2.m_fg->m_mainSceneLayerFilter->children()[0], v2.m_sceneStages);
         } else {
             QCOMPARE(v1.children().size(), 5);
-            QCOMPARE(v1.children()[0], v1.m_fg->m_renderTargets[0]);
-            QCOMPARE(v1.children()[1], v1.m_fg->m_renderToTextureRootNode);
+            QCOMPARE(v1.children()[0], v1.m_fg->m_renderToTextureRootNode);
+            QCOMPARE(v1.children()[1], v1.m_fg->m_renderTargets[0]);
             QCOMPARE(v1.children()[2], v1.m_fg->m_renderTargets[1]);
             QCOMPARE(v1.children()[3], v1.m_fxStages);
             QCOMPARE(v1.children()[4], v1.m_internalFXStages);
             QCOMPARE(v2.children().size(), 5);
-            QCOMPARE(v2.children()[0], v2.m_fg->m_renderTargets[0]);
-            QCOMPARE(v2.children()[1], v2.m_fg->m_renderToTextureRootNode);
+            QCOMPARE(v2.children()[0], v2.m_fg->m_renderToTextureRootNode);
+            QCOMPARE(v2.children()[1], v2.m_fg->m_renderTargets[0]);
             QCOMPARE(v2.children()[2], v2.m_fg->m_renderTargets[1]);
             QCOMPARE(v2.children()[3], v2.m_fxStages);
             QCOMPARE(v2.children()[4], v2.m_internalFXStages);
@@ -1345,17 +1407,17 @@ private Q_SLOTS:
 
         if (Kuesa::FrameGraphUtils::hasMSAASupport()) {
             QCOMPARE(v1.children().size(), 6);
-            QCOMPARE(v1.children()[0], v1.m_fg->m_renderTargets[0]);
-            QCOMPARE(v1.children()[1], v1.m_fg->m_renderTargets[1]);
-            QCOMPARE(v1.children()[2], v1.m_fg->m_multisampleTarget);
-            QCOMPARE(v1.children()[3], v1.m_fg->m_renderToTextureRootNode);
+            QCOMPARE(v1.children()[0], v1.m_fg->m_renderToTextureRootNode);
+            QCOMPARE(v1.children()[1], v1.m_fg->m_renderTargets[0]);
+            QCOMPARE(v1.children()[2], v1.m_fg->m_renderTargets[1]);
+            QCOMPARE(v1.children()[3], v1.m_fg->m_multisampleTarget);
             QCOMPARE(v1.children()[4], v1.m_fxStages);
             QCOMPARE(v1.children()[5], v1.m_internalFXStages);
             QCOMPARE(v2.children().size(), 6);
-            QCOMPARE(v2.children()[0], v2.m_fg->m_renderTargets[0]);
-            QCOMPARE(v2.children()[1], v2.m_fg->m_renderTargets[1]);
-            QCOMPARE(v2.children()[2], v2.m_fg->m_multisampleTarget);
-            QCOMPARE(v2.children()[3], v2.m_fg->m_renderToTextureRootNode);
+            QCOMPARE(v2.children()[0], v2.m_fg->m_renderToTextureRootNode);
+            QCOMPARE(v2.children()[1], v2.m_fg->m_renderTargets[0]);
+            QCOMPARE(v2.children()[2], v2.m_fg->m_renderTargets[1]);
+            QCOMPARE(v2.children()[3], v2.m_fg->m_multisampleTarget);
             QCOMPARE(v2.children()[4], v2.m_fxStages);
             QCOMPARE(v2.children()[5], v2.m_internalFXStages);
 
@@ -1374,15 +1436,15 @@ private Q_SLOTS:
             QCOMPARE(v2.m_fg->m_mainSceneLayerFilter->children()[0], v2.m_sceneStages);
         } else {
             QCOMPARE(v1.children().size(), 5);
-            QCOMPARE(v1.children()[0], v1.m_fg->m_renderTargets[0]);
-            QCOMPARE(v1.children()[1], v1.m_fg->m_renderTargets[1]);
-            QCOMPARE(v1.children()[2], v1.m_fg->m_renderToTextureRootNode);
+            QCOMPARE(v1.children()[0], v1.m_fg->m_renderToTextureRootNode);
+            QCOMPARE(v1.children()[1], v1.m_fg->m_renderTargets[0]);
+            QCOMPARE(v1.children()[2], v1.m_fg->m_renderTargets[1]);
             QCOMPARE(v1.children()[3], v1.m_fxStages);
             QCOMPARE(v1.children()[4], v1.m_internalFXStages);
             QCOMPARE(v2.children().size(), 5);
-            QCOMPARE(v2.children()[0], v2.m_fg->m_renderTargets[0]);
-            QCOMPARE(v2.children()[1], v2.m_fg->m_renderTargets[1]);
-            QCOMPARE(v2.children()[2], v2.m_fg->m_renderToTextureRootNode);
+            QCOMPARE(v2.children()[0], v2.m_fg->m_renderToTextureRootNode);
+            QCOMPARE(v2.children()[1], v2.m_fg->m_renderTargets[0]);
+            QCOMPARE(v2.children()[2], v2.m_fg->m_renderTargets[1]);
             QCOMPARE(v2.children()[3], v2.m_fxStages);
             QCOMPARE(v2.children()[4], v2.m_internalFXStages);
 
@@ -1602,6 +1664,41 @@ private Q_SLOTS:
         QCOMPARE(fx1Texture->height(), 64);
     }
 
+    void testEffectModeChangesArePooled()
+    {
+        // GIVEN
+        Kuesa::ForwardRenderer renderer;
+        auto fx = new Kuesa::GaussianBlurEffect();
+        renderer.addPostProcessingEffect(fx);
+        QCoreApplication::processEvents();
+
+        const auto allPooled = [fx] {
+            const QList<Kuesa::TransientTexture *> textures = fx->findChildren<Kuesa::TransientTexture *>();
+            return !textures.isEmpty() && std::all_of(textures.begin(), textures.end(), [](Kuesa::TransientTexture *texture) {
+                return texture->isPooled();
+            });
+        };
+
+        // THEN
+        QVERIFY(allPooled());
+        const size_t iterativeRequestCount = renderer.m_renderTargetPool->requestCount();
+
+        // WHEN - the mip chain blur creates new transient textures
+        fx->setBlurMode(Kuesa::GaussianBlurEffect::MipChainBlur);
+        QCoreApplication::processEvents();
+
+        // THEN
+        QVERIFY(allPooled());
+        QVERIFY(renderer.m_renderTargetPool->requestCount() > iterativeRequestCount);
+
+        // WHEN
+        fx->setMipLevelCount(fx->mipLevelCount() + 1);
+        QCoreApplication::processEvents();
+
+        // THEN
+        QVERIFY(allPooled());
+    }
+
     //    void testReflectionStages()
     //    {
     //        // GIVEN
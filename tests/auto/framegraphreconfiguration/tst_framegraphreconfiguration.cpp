@@ -0,0 +1,251 @@
+/*
+    tst_framegraphreconfiguration.cpp
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <QtTest/QTest>
+
+#include <QCoreApplication>
+#include <QChildEvent>
+
+#include <Qt3DRender/QFrameGraphNode>
+#include <Qt3DRender/QLayer>
+
+#include <Kuesa/view.h>
+#include <Kuesa/abstractpostprocessingeffect.h>
+#include <Kuesa/private/effectsstages_p.h>
+
+#include <memory>
+
+namespace {
+
+class tst_FX : public Kuesa::AbstractPostProcessingEffect
+{
+    Q_OBJECT
+
+public:
+    explicit tst_FX(Qt3DCore::QNode *parent = nullptr)
+        : Kuesa::AbstractPostProcessingEffect(parent)
+        , m_rootNode(new Qt3DRender::QFrameGraphNode())
+    {
+    }
+
+    // AbstractPostProcessingEffect interface
+    FrameGraphNodePtr frameGraphSubTree() const override
+    {
+        return m_rootNode;
+    }
+
+    QVector<Qt3DRender::QLayer *> layers() const override
+    {
+        return QVector<Qt3DRender::QLayer *>();
+    }
+
+    void setInputTexture(Qt3DRender::QAbstractTexture *) override
+    {
+    }
+
+    void setWindowSize(const QSize &) override
+    {
+    }
+
+private:
+    FrameGraphNodePtr m_rootNode;
+};
+
+// Counts every child added to or removed from a FrameGraph node. Each
+// of those makes Qt3D create or destroy the backend nodes of the subtree
+class FrameGraphChurnCounter : public QObject
+{
+    Q_OBJECT
+
+public:
+    FrameGraphChurnCounter()
+    {
+        QCoreApplication::instance()->installEventFilter(this);
+    }
+
+    ~FrameGraphChurnCounter()
+    {
+        QCoreApplication::instance()->removeEventFilter(this);
+    }
+
+    bool eventFilter(QObject *watched, QEvent *event) override
+    {
+        if (event->type() == QEvent::ChildAdded || event->type() == QEvent::ChildRemoved) {
+            if (qobject_cast<Qt3DRender::QFrameGraphNode *>(watched) != nullptr) {
+                ++m_count;
+                m_receivers.push_back(watched);
+            }
+        }
+        return QObject::eventFilter(watched, event);
+    }
+
+    void reset()
+    {
+        m_count = 0;
+        m_receivers.clear();
+    }
+
+    int count() const { return m_count; }
+    const QObjectList &receivers() const { return m_receivers; }
+
+private:
+    int m_count = 0;
+    QObjectList m_receivers;
+};
+
+} // namespace
+
+class tst_FrameGraphReconfiguration : public QObject
+{
+    Q_OBJECT
+
+private:
+    int toggleEffectChurn(size_t effectCount)
+    {
+        // GIVEN
+        Kuesa::View v;
+        std::vector<std::unique_ptr<tst_FX>> fxs;
+        for (size_t i = 0; i < effectCount; ++i) {
+            fxs.emplace_back(new tst_FX());
+            v.addPostProcessingEffect(fxs.back().get());
+        }
+        QCoreApplication::processEvents();
+
+        FrameGraphChurnCounter counter;
+        tst_FX toggledFx;
+
+        // WHEN
+        v.addPostProcessingEffect(&toggledFx);
+        QCoreApplication::processEvents();
+
+        // THEN
+        const int addChurn = counter.count();
+
+        // WHEN
+        counter.reset();
+        v.removePostProcessingEffect(&toggledFx);
+        QCoreApplication::processEvents();
+
+        // THEN
+        const int removeChurn = counter.count();
+
+        return addChurn + removeChurn;
+    }
+
+private Q_SLOTS:
+
+    void checkRebuildWithoutChangesHasNoChurn()
+    {
+        // GIVEN
+        Kuesa::View v;
+        tst_FX fx1;
+        tst_FX fx2;
+        Qt3DRender::QLayer layer;
+        v.addPostProcessingEffect(&fx1);
+        v.addPostProcessingEffect(&fx2);
+        v.addLayer(&layer);
+        QCoreApplication::processEvents();
+
+        FrameGraphChurnCounter counter;
+
+        // WHEN
+        v.rebuildFGTree();
+        QCoreApplication::processEvents();
+
+        // THEN
+        QCOMPARE(counter.count(), 0);
+    }
+
+    void checkEffectToggleChurnDoesNotDependOnEffectCount()
+    {
+        // WHEN
+        const int churnFor1 = toggleEffectChurn(1);
+        const int churnFor4 = toggleEffectChurn(4);
+        const int churnFor16 = toggleEffectChurn(16);
+
+        // THEN -> Only the toggled effect and its neighbours are touched
+        QVERIFY(churnFor1 > 0);
+        QCOMPARE(churnFor4, churnFor1);
+        QCOMPARE(churnFor16, churnFor1);
+    }
+
+    void checkAddingEffectsChurnIsLinear()
+    {
+        // GIVEN
+        Kuesa::View v;
+        QCoreApplication::processEvents();
+        std::vector<std::unique_ptr<tst_FX>> fxs;
+        for (size_t i = 0; i < 17; ++i)
+            fxs.emplace_back(new tst_FX());
+
+        // WHEN -> Warm up, the first effect creates the effect stage and RT1
+        v.addPostProcessingEffect(fxs[0].get());
+        QCoreApplication::processEvents();
+
+        FrameGraphChurnCounter counter;
+        std::vector<int> churns;
+        for (size_t i = 1, m = fxs.size(); i < m; ++i) {
+            counter.reset();
+            v.addPostProcessingEffect(fxs[i].get());
+            QCoreApplication::processEvents();
+            churns.push_back(counter.count());
+        }
+
+        // THEN -> Each addition costs the same regardless of how many
+        // effects are already there
+        for (int churn : churns)
+            QCOMPARE(churn, churns.front());
+    }
+
+    void checkLayerToggleDoesNotTouchEffects()
+    {
+        // GIVEN
+        Kuesa::View v;
+        tst_FX fx;
+        Qt3DRender::QLayer layer;
+        v.addPostProcessingEffect(&fx);
+        QCoreApplication::processEvents();
+
+        FrameGraphChurnCounter counter;
+
+        // WHEN
+        v.addLayer(&layer);
+        QCoreApplication::processEvents();
+        v.removeLayer(&layer);
+        QCoreApplication::processEvents();
+
+        // THEN
+        for (QObject *receiver : counter.receivers()) {
+            QVERIFY(receiver != v.m_fxStages);
+            QVERIFY(receiver != v.m_internalFXStages);
+        }
+    }
+};
+
+QTEST_MAIN(tst_FrameGraphReconfiguration)
+#include "tst_framegraphreconfiguration.moc"
@@ -30,6 +30,7 @@
 
 #include <Kuesa/private/framegraphutils_p.h>
 #include <Qt3DRender/QAbstractTexture>
+#include <Qt3DRender/QFrameGraphNode>
 #include <Qt3DRender/QRenderTarget>
 #include <Qt3DRender/QRenderTargetSelector>
 #include <Qt3DRender/QRenderTargetOutput>
@@ -177,6 +178,84 @@ private Q_SLOTS:
         QCOMPARE(colorTexture->format(), Qt3DRender::QAbstractTexture::RGBA8_UNorm);
         QCOMPARE(depthTexture->format(), defaultDepthFormat);
     }
+
+    void checkReconcileChildren()
+    {
+        // GIVEN
+        Qt3DRender::QFrameGraphNode root;
+        Qt3DRender::QFrameGraphNode *unmanaged = new Qt3DRender::QFrameGraphNode(&root);
+        Qt3DRender::QFrameGraphNode *a = new Qt3DRender::QFrameGraphNode();
+        Qt3DRender::QFrameGraphNode *b = new Qt3DRender::QFrameGraphNode();
+        Qt3DRender::QFrameGraphNode *c = new Qt3DRender::QFrameGraphNode();
+        const std::vector<Qt3DCore::QNode *> managed{ a, b, c };
+
+        {
+            // WHEN
+            const int reparented = Kuesa::FrameGraphUtils::reconcileChildren(&root, { a, b }, managed);
+
+            // THEN
+            QCOMPARE(reparented, 2);
+            QCOMPARE(root.children(), QObjectList({ unmanaged, a, b }));
+        }
+
+        {
+            // WHEN
+            const int reparented = Kuesa::FrameGraphUtils::reconcileChildren(&root, { a, b }, managed);
+
+            // THEN -> Nothing to do
+            QCOMPARE(reparented, 0);
+            QCOMPARE(root.children(), QObjectList({ unmanaged, a, b }));
+        }
+
+        {
+            // WHEN -> Append
+            const int reparented = Kuesa::FrameGraphUtils::reconcileChildren(&root, { a, b, c }, managed);
+
+            // THEN -> Only the new node is touched
+            QCOMPARE(reparented, 1);
+            QCOMPARE(root.children(), QObjectList({ unmanaged, a, b, c }));
+        }
+
+        {
+            // WHEN -> Remove
+            const int reparented = Kuesa::FrameGraphUtils::reconcileChildren(&root, { a, c }, managed);
+
+            // THEN
+            QCOMPARE(reparented, 1);
+            QCOMPARE(root.children(), QObjectList({ unmanaged, a, c }));
+            QVERIFY(b->parent() == nullptr);
+        }
+
+        {
+            // WHEN -> Insert
+            const int reparented = Kuesa::FrameGraphUtils::reconcileChildren(&root, { a, b, c }, managed);
+
+            // THEN -> The nodes following the insertion are moved
+            QCOMPARE(reparented, 3);
+            QCOMPARE(root.children(), QObjectList({ unmanaged, a, b, c }));
+        }
+
+        {
+            // WHEN -> Reorder
+            const int reparented = Kuesa::FrameGraphUtils::reconcileChildren(&root, { c, b, a }, managed);
+
+            // THEN
+            QCOMPARE(root.children(), QObjectList({ unmanaged, c, b, a }));
+            QVERIFY(reparented > 0);
+        }
+
+        {
+            // WHEN -> Clear
+            Kuesa::FrameGraphUtils::reconcileChildren(&root, {}, managed);
+
+            // THEN -> Unmanaged children are left untouched
+            QCOMPARE(root.children(), QObjectList({ unmanaged }));
+        }
+
+        delete a;
+        delete b;
+        delete c;
+    }
 };
 
 QTEST_MAIN(tst_FrameGraphUtils)
@@ -53,6 +53,8 @@ private Q_SLOTS:
 
         // THEN
         QCOMPARE(fx.blurPassCount(), 8);
+        QCOMPARE(fx.blurMode(), Kuesa::GaussianBlurEffect::IterativeBlur);
+        QCOMPARE(fx.mipLevelCount(), 3);
         QCOMPARE(fx.layers().size(), 1);
         QVERIFY(fx.frameGraphSubTree() != nullptr);
     }
@@ -209,6 +211,127 @@ private Q_SLOTS:
         // THEN
         checkBlurPasses(2);
     }
+
+    void checkSetBlurModeAndMipLevelCount()
+    {
+        // GIVEN
+        Kuesa::GaussianBlurEffect fx;
+        QSignalSpy blurModeSpy(&fx, &Kuesa::GaussianBlurEffect::blurModeChanged);
+        QSignalSpy mipLevelCountSpy(&fx, &Kuesa::GaussianBlurEffect::mipLevelCountChanged);
+
+        // THEN
+        QVERIFY(blurModeSpy.isValid());
+        QVERIFY(mipLevelCountSpy.isValid());
+
+        // WHEN
+        fx.setBlurMode(Kuesa::GaussianBlurEffect::MipChainBlur);
+
+        // THEN
+        QCOMPARE(fx.blurMode(), Kuesa::GaussianBlurEffect::MipChainBlur);
+        QCOMPARE(blurModeSpy.count(), 1);
+
+        // WHEN
+        fx.setBlurMode(Kuesa::GaussianBlurEffect::MipChainBlur);
+
+        // THEN
+        QCOMPARE(blurModeSpy.count(), 1);
+
+        // WHEN
+        fx.setMipLevelCount(0);
+
+        // THEN -> Nothing
+        QCOMPARE(fx.mipLevelCount(), 3);
+        QCOMPARE(mipLevelCountSpy.count(), 0);
+
+        // WHEN
+        fx.setMipLevelCount(5);
+
+        // THEN
+        QCOMPARE(fx.mipLevelCount(), 5);
+        QCOMPARE(mipLevelCountSpy.count(), 1);
+    }
+
+    void checkMipChainFrameGraphSubTree()
+    {
+        // GIVEN
+        Kuesa::GaussianBlurEffect fx;
+        Kuesa::AbstractPostProcessingEffect::FrameGraphNodePtr fg = fx.frameGraphSubTree();
+        Qt3DRender::QLayerFilter *layerFilter = fg->findChild<Qt3DRender::QLayerFilter *>();
+        Qt3DRender::QFrameGraphNode *blurFGRoot = qobject_cast<Qt3DRender::QFrameGraphNode *>(layerFilter->children().first());
+        QVERIFY(blurFGRoot != nullptr);
+
+        auto textureOf = [](QObject *node) -> Qt3DRender::QAbstractTexture * {
+            auto selector = qobject_cast<Qt3DRender::QRenderTargetSelector *>(node);
+            if (!selector || !selector->target() || selector->target()->outputs().size() != 1)
+                return nullptr;
+            return selector->target()->outputs().first()->texture();
+        };
+
+        auto checkMipChain = [&](int levelCount, const QSize &windowSize) {
+            // Horizontal and vertical pass per level, upsampling per level
+            // but the last one and final upsampling to the effect's target
+            const QObjectList &cs = blurFGRoot->children();
+            QCOMPARE(cs.size(), 3 * levelCount);
+
+            QSize expectedSize = windowSize;
+            for (int level = 0; level < levelCount; ++level) {
+                expectedSize = QSize(qMax(expectedSize.width() / 2, 1), qMax(expectedSize.height() / 2, 1));
+                for (int pass = 0; pass < 2; ++pass) {
+                    Qt3DRender::QAbstractTexture *t = textureOf(cs[2 * level + pass]);
+                    QVERIFY(t != nullptr);
+                    QCOMPARE(t->width(), expectedSize.width());
+                    QCOMPARE(t->height(), expectedSize.height());
+                }
+            }
+
+            for (int i = 2 * levelCount; i < cs.size() - 1; ++i)
+                QVERIFY(textureOf(cs[i]) != nullptr);
+            QVERIFY(qobject_cast<Qt3DRender::QRenderPassFilter *>(cs.last()) != nullptr);
+        };
+
+        // WHEN
+        fx.setBlurMode(Kuesa::GaussianBlurEffect::MipChainBlur);
+
+        // THEN
+        checkMipChain(3, QSize(512, 512));
+
+        // WHEN
+        fx.setWindowSize(QSize(1920, 1080));
+
+        // THEN
+        checkMipChain(3, QSize(1920, 1080));
+
+        // WHEN
+        fx.setMipLevelCount(1);
+
+        // THEN
+        checkMipChain(1, QSize(1920, 1080));
+
+        // WHEN
+        Qt3DRender::QTexture2D *tex = new Qt3DRender::QTexture2D();
+        fx.setInputTexture(tex);
+
+        // THEN -> Input sampled by the first and last passes
+        auto filterParameter = [](QObject *node, const QString &name) -> Qt3DRender::QParameter * {
+            auto filter = qobject_cast<Qt3DRender::QRenderPassFilter *>(node);
+            if (!filter)
+                filter = node->findChild<Qt3DRender::QRenderPassFilter *>();
+            for (Qt3DRender::QParameter *p : filter->parameters())
+                if (p->name() == name)
+                    return p;
+            return nullptr;
+        };
+        const QObjectList &cs = blurFGRoot->children();
+        QCOMPARE(filterParameter(cs.first(), QStringLiteral("sourceTexture"))->value().value<Qt3DRender::QAbstractTexture *>(), tex);
+        QCOMPARE(filterParameter(cs.last(), QStringLiteral("highTexture"))->value().value<Qt3DRender::QAbstractTexture *>(), tex);
+        QCOMPARE(filterParameter(cs.last(), QStringLiteral("lowTexture"))->value().value<Qt3DRender::QAbstractTexture *>(), textureOf(cs[1]));
+
+        // WHEN
+        fx.setBlurMode(Kuesa::GaussianBlurEffect::IterativeBlur);
+
+        // THEN
+        QCOMPARE(blurFGRoot->children().size(), fx.blurPassCount() * 2);
+    }
 };
 
 QTEST_MAIN(tst_GaussianBlurEffect)
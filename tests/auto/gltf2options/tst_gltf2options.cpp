@@ -47,6 +47,13 @@ private Q_SLOTS:
         // THEN
         QCOMPARE(options.generateNormals(), false);
         QCOMPARE(options.generateTangents(), false);
+        QCOMPARE(options.lodLevelCount(), 0);
+        QCOMPARE(options.lodError(), 0.01f);
+        QCOMPARE(options.lodErrorMetric(), GLTF2Options::RelativeLodError);
+        QCOMPARE(options.packedMorphTargets(), false);
+        QCOMPARE(options.lazyTextureLoading(), false);
+        QCOMPARE(options.textureMemoryBudget(), qint64(0));
+        QCOMPARE(options.textureEvictionDelay(), 10000);
     }
 
     void checkGenerateTangents()
@@ -96,6 +103,96 @@ private Q_SLOTS:
         QCOMPARE(spy.count(), 1);
         QCOMPARE(options.generateNormals(), true);
     }
+
+    void checkLodOptions()
+    {
+        // GIVEN
+        GLTF2Options options;
+        QSignalSpy levelCountSpy(&options, SIGNAL(lodLevelCountChanged(int)));
+        QSignalSpy errorSpy(&options, SIGNAL(lodErrorChanged(float)));
+        QSignalSpy metricSpy(&options, SIGNAL(lodErrorMetricChanged(LodErrorMetric)));
+
+        // THEN
+        QVERIFY(levelCountSpy.isValid());
+        QVERIFY(errorSpy.isValid());
+        QVERIFY(metricSpy.isValid());
+
+        // WHEN
+        options.setLodLevelCount(3);
+        options.setLodError(0.05f);
+        options.setLodErrorMetric(GLTF2Options::AbsoluteLodError);
+
+        // THEN
+        QCOMPARE(levelCountSpy.count(), 1);
+        QCOMPARE(errorSpy.count(), 1);
+        QCOMPARE(metricSpy.count(), 1);
+        QCOMPARE(options.lodLevelCount(), 3);
+        QCOMPARE(options.lodError(), 0.05f);
+        QCOMPARE(options.lodErrorMetric(), GLTF2Options::AbsoluteLodError);
+
+        // WHEN
+        options.setLodLevelCount(-2);
+
+        // THEN
+        QCOMPARE(levelCountSpy.count(), 2);
+        QCOMPARE(options.lodLevelCount(), 0);
+    }
+
+    void checkPackedMorphTargets()
+    {
+        // GIVEN
+        GLTF2Options options;
+        QSignalSpy spy(&options, SIGNAL(packedMorphTargetsChanged(bool)));
+
+        // THEN
+        QVERIFY(spy.isValid());
+
+        // WHEN
+        options.setPackedMorphTargets(true);
+        options.setPackedMorphTargets(true);
+
+        // THEN
+        QCOMPARE(spy.count(), 1);
+        QCOMPARE(options.packedMorphTargets(), true);
+    }
+
+    void checkLazyTextureLoading()
+    {
+        // GIVEN
+        GLTF2Options options;
+        QSignalSpy lazySpy(&options, SIGNAL(lazyTextureLoadingChanged(bool)));
+        QSignalSpy budgetSpy(&options, SIGNAL(textureMemoryBudgetChanged(qint64)));
+        QSignalSpy delaySpy(&options, SIGNAL(textureEvictionDelayChanged(int)));
+
+        // THEN
+        QVERIFY(lazySpy.isValid());
+        QVERIFY(budgetSpy.isValid());
+        QVERIFY(delaySpy.isValid());
+
+        // WHEN
+        options.setLazyTextureLoading(true);
+        options.setLazyTextureLoading(true);
+        options.setTextureMemoryBudget(64 * 1024 * 1024);
+        options.setTextureMemoryBudget(64 * 1024 * 1024);
+        options.setTextureEvictionDelay(500);
+        options.setTextureEvictionDelay(500);
+
+        // THEN
+        QCOMPARE(lazySpy.count(), 1);
+        QCOMPARE(budgetSpy.count(), 1);
+        QCOMPARE(delaySpy.count(), 1);
+        QCOMPARE(options.lazyTextureLoading(), true);
+        QCOMPARE(options.textureMemoryBudget(), qint64(64 * 1024 * 1024));
+        QCOMPARE(options.textureEvictionDelay(), 500);
+
+        // WHEN
+        options.setTextureMemoryBudget(-1);
+        options.setTextureEvictionDelay(-1);
+
+        // THEN
+        QCOMPARE(options.textureMemoryBudget(), qint64(0));
+        QCOMPARE(options.textureEvictionDelay(), 0);
+    }
 };
 
 QTEST_MAIN(tst_GLTF2Options)
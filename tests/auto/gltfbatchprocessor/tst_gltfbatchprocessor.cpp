@@ -0,0 +1,144 @@
+/*
+    tst_gltfbatchprocessor.cpp
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <QtTest/QTest>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QTemporaryDir>
+#include <QThread>
+#include "batchprocessor.h"
+
+#include <algorithm>
+
+using namespace Kuesa;
+
+class tst_GLTFBatchProcessor : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+
+    void checkDefaults()
+    {
+        // GIVEN
+        BatchProcessor processor;
+
+        // THEN
+        QVERIFY(processor.outputDirectory().isEmpty());
+        QCOMPARE(processor.jobCount(), 0);
+        QCOMPARE(processor.exportConfiguration().embedding(), GLTF2ExportConfiguration::Embed::Keep);
+
+        // WHEN
+        processor.setJobCount(-1);
+
+        // THEN
+        QCOMPARE(processor.jobCount(), 0);
+    }
+
+    void checkValidation()
+    {
+        // GIVEN
+        BatchProcessor processor;
+        QTemporaryDir tmp;
+        const QString invalid = tmp.filePath(QStringLiteral("invalid.gltf"));
+        {
+            QFile file(invalid);
+            QVERIFY(file.open(QIODevice::WriteOnly));
+            file.write("{ not json");
+        }
+
+        // WHEN
+        const QJsonObject report = processor.process({ QStringLiteral(ASSETS "Box.gltf"),
+                                                       tmp.filePath(QStringLiteral("missing.gltf")),
+                                                       invalid });
+
+        // THEN
+        QCOMPARE(report.value(QStringLiteral("succeeded")).toInt(), 1);
+        QCOMPARE(report.value(QStringLiteral("failed")).toInt(), 2);
+        QCOMPARE(report.value(QStringLiteral("jobs")).toInt(), std::max(1, QThread::idealThreadCount()));
+        QVERIFY(report.value(QStringLiteral("elapsed")).toDouble() >= 0.0);
+
+        const QJsonArray files = report.value(QStringLiteral("files")).toArray();
+        QCOMPARE(files.size(), 3);
+
+        const QJsonObject box = files.at(0).toObject();
+        QVERIFY(box.value(QStringLiteral("source")).toString().endsWith(QStringLiteral("Box.gltf")));
+        QVERIFY(box.value(QStringLiteral("success")).toBool());
+        QVERIFY(box.value(QStringLiteral("errors")).toArray().isEmpty());
+        QVERIFY(!box.contains(QStringLiteral("output")));
+        const QJsonObject timings = box.value(QStringLiteral("timings")).toObject();
+        QVERIFY(timings.contains(QStringLiteral("parse")));
+        QVERIFY(timings.contains(QStringLiteral("total")));
+        QVERIFY(!timings.contains(QStringLiteral("export")));
+
+        const QJsonObject missing = files.at(1).toObject();
+        QVERIFY(!missing.value(QStringLiteral("success")).toBool());
+        QCOMPARE(missing.value(QStringLiteral("errors")).toArray(), QJsonArray({ QStringLiteral("File not found") }));
+
+        const QJsonObject broken = files.at(2).toObject();
+        QVERIFY(!broken.value(QStringLiteral("success")).toBool());
+        QCOMPARE(broken.value(QStringLiteral("errors")).toArray(), QJsonArray({ QStringLiteral("Failed to parse") }));
+    }
+
+    void checkExport()
+    {
+        // GIVEN
+        QTemporaryDir tmp;
+        BatchProcessor processor;
+        processor.setOutputDirectory(tmp.path());
+        processor.setJobCount(2);
+
+        // WHEN -> same name twice
+        const QJsonObject report = processor.process({ QStringLiteral(ASSETS "Box.gltf"),
+                                                       QStringLiteral(ASSETS "Box.gltf"),
+                                                       QStringLiteral(ASSETS "Box.glb") });
+
+        // THEN
+        QCOMPARE(report.value(QStringLiteral("jobs")).toInt(), 2);
+        QCOMPARE(report.value(QStringLiteral("succeeded")).toInt(), 2);
+
+        const QJsonArray files = report.value(QStringLiteral("files")).toArray();
+        QCOMPARE(files.at(0).toObject().value(QStringLiteral("output")).toString(), tmp.filePath(QStringLiteral("Box/Box.gltf")));
+        QCOMPARE(files.at(1).toObject().value(QStringLiteral("output")).toString(), tmp.filePath(QStringLiteral("Box-1/Box.gltf")));
+        QVERIFY(files.at(0).toObject().value(QStringLiteral("timings")).toObject().contains(QStringLiteral("export")));
+
+        QFile exported(tmp.filePath(QStringLiteral("Box/Box.gltf")));
+        QVERIFY(exported.open(QIODevice::ReadOnly));
+        QVERIFY(QJsonDocument::fromJson(exported.readAll()).object().contains(QStringLiteral("asset")));
+
+        // THEN -> binary files are only validated
+        const QJsonObject glb = files.at(2).toObject();
+        QVERIFY(!glb.value(QStringLiteral("success")).toBool());
+        QVERIFY(!glb.contains(QStringLiteral("output")));
+    }
+};
+
+QTEST_MAIN(tst_GLTFBatchProcessor)
+
+#include "tst_gltfbatchprocessor.moc"
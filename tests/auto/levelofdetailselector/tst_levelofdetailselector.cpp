@@ -0,0 +1,252 @@
+/*
+    tst_levelofdetailselector.cpp
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <QtTest/QTest>
+#include <QSignalSpy>
+#include <Kuesa/LevelOfDetailSelector>
+#include <Kuesa/SceneEntity>
+#include <Kuesa/View>
+#include <Kuesa/private/meshsimplifier_p.h>
+#include <Kuesa/private/kuesa_global_p.h>
+#include <Qt3DRender/QCamera>
+#include <Qt3DRender/QGeometryRenderer>
+
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+#include <Qt3DCore/QGeometry>
+#include <Qt3DCore/private/qgeometry_p.h>
+#else
+#include <Qt3DRender/QGeometry>
+#include <Qt3DRender/private/qgeometry_p.h>
+#endif
+#include <cmath>
+
+using namespace Kuesa;
+
+namespace {
+
+QMatrix4x4 lookAtOrigin(float distance)
+{
+    QMatrix4x4 viewMatrix;
+    viewMatrix.lookAt(QVector3D(0.0f, 0.0f, distance), QVector3D(), QVector3D(0.0f, 1.0f, 0.0f));
+    return viewMatrix;
+}
+
+Qt3DGeometry::QGeometry *createLevel(Qt3DRender::QGeometryRenderer *renderer, int level)
+{
+    auto *geometry = new Qt3DGeometry::QGeometry(renderer);
+    auto *levelsOfDetail = GLTF2Import::MeshSimplifier::LevelsOfDetail::find(renderer);
+    if (levelsOfDetail == nullptr)
+        levelsOfDetail = new GLTF2Import::MeshSimplifier::LevelsOfDetail(renderer);
+    if (levelsOfDetail->levels.size() <= size_t(level))
+        levelsOfDetail->levels.resize(size_t(level) + 1);
+    levelsOfDetail->levels[size_t(level)] = geometry;
+    // Bounding sphere of radius 1 centered on the origin
+    const float halfExtent = 1.0f / std::sqrt(3.0f);
+    auto *d = static_cast<Qt3DGeometry::QGeometryPrivate *>(Qt3DCore::QNodePrivate::get(geometry));
+    d->setExtent(QVector3D(-halfExtent, -halfExtent, -halfExtent), QVector3D(halfExtent, halfExtent, halfExtent));
+    return geometry;
+}
+
+} // namespace
+
+class tst_LevelOfDetailSelector : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+
+    void checkInitialState()
+    {
+        // GIVEN
+        LevelOfDetailSelector selector;
+
+        // THEN
+        QVERIFY(selector.view() == nullptr);
+        QCOMPARE(selector.screenSizeThresholds(), QVector<qreal>({ 0.25, 0.1, 0.04 }));
+        QCOMPARE(selector.hysteresis(), 0.1f);
+        QCOMPARE(selector.managedMeshCount(), 0);
+    }
+
+    void checkSetters()
+    {
+        // GIVEN
+        LevelOfDetailSelector selector;
+        View view;
+        QSignalSpy viewSpy(&selector, &LevelOfDetailSelector::viewChanged);
+        QSignalSpy thresholdsSpy(&selector, &LevelOfDetailSelector::screenSizeThresholdsChanged);
+        QSignalSpy hysteresisSpy(&selector, &LevelOfDetailSelector::hysteresisChanged);
+
+        // WHEN
+        selector.setView(&view);
+        selector.setScreenSizeThresholds({ 0.5 });
+        selector.setHysteresis(0.2f);
+
+        // THEN
+        QCOMPARE(selector.view(), &view);
+        QCOMPARE(selector.screenSizeThresholds(), QVector<qreal>({ 0.5 }));
+        QCOMPARE(selector.hysteresis(), 0.2f);
+        QCOMPARE(viewSpy.count(), 1);
+        QCOMPARE(thresholdsSpy.count(), 1);
+        QCOMPARE(hysteresisSpy.count(), 1);
+
+        // WHEN
+        selector.setView(&view);
+        selector.setScreenSizeThresholds({ 0.5 });
+        selector.setHysteresis(0.2f);
+
+        // THEN
+        QCOMPARE(viewSpy.count(), 1);
+        QCOMPARE(thresholdsSpy.count(), 1);
+        QCOMPARE(hysteresisSpy.count(), 1);
+    }
+
+    void checkProjectedScreenSize()
+    {
+        // GIVEN
+        QMatrix4x4 perspective;
+        perspective.perspective(90.0f, 1.0f, 0.1f, 1000.0f);
+        QMatrix4x4 ortho;
+        ortho.ortho(-5.0f, 5.0f, -5.0f, 5.0f, 0.1f, 1000.0f);
+
+        // THEN -> a 90 degrees fov sees a height of 2 * distance
+        QVERIFY(qFuzzyCompare(LevelOfDetailSelector::projectedScreenSize(lookAtOrigin(10.0f), perspective, QVector3D(), 1.0f), 0.1f));
+        QVERIFY(qFuzzyCompare(LevelOfDetailSelector::projectedScreenSize(lookAtOrigin(20.0f), perspective, QVector3D(), 1.0f), 0.05f));
+        QVERIFY(qFuzzyCompare(LevelOfDetailSelector::projectedScreenSize(lookAtOrigin(10.0f), perspective, QVector3D(0.0f, 0.0f, -10.0f), 2.0f), 0.1f));
+
+        // THEN -> camera inside of the sphere
+        QCOMPARE(LevelOfDetailSelector::projectedScreenSize(lookAtOrigin(0.5f), perspective, QVector3D(), 1.0f), 1.0f);
+
+        // THEN -> orthographic projections don't depend on distance
+        QVERIFY(qFuzzyCompare(LevelOfDetailSelector::projectedScreenSize(lookAtOrigin(10.0f), ortho, QVector3D(), 1.0f), 0.2f));
+        QVERIFY(qFuzzyCompare(LevelOfDetailSelector::projectedScreenSize(lookAtOrigin(100.0f), ortho, QVector3D(), 1.0f), 0.2f));
+    }
+
+    void checkSelectLevel()
+    {
+        // GIVEN
+        const QVector<qreal> thresholds = { 0.5, 0.25 };
+
+        // THEN -> without hysteresis
+        QCOMPARE(LevelOfDetailSelector::selectLevel(0.6f, thresholds, 0, 0.0f), 0);
+        QCOMPARE(LevelOfDetailSelector::selectLevel(0.4f, thresholds, 0, 0.0f), 1);
+        QCOMPARE(LevelOfDetailSelector::selectLevel(0.1f, thresholds, 0, 0.0f), 2);
+        QCOMPARE(LevelOfDetailSelector::selectLevel(0.6f, thresholds, 2, 0.0f), 0);
+
+        // THEN -> within the hysteresis band the current level is kept
+        QCOMPARE(LevelOfDetailSelector::selectLevel(0.48f, thresholds, 0, 0.1f), 0);
+        QCOMPARE(LevelOfDetailSelector::selectLevel(0.52f, thresholds, 1, 0.1f), 1);
+        QCOMPARE(LevelOfDetailSelector::selectLevel(0.26f, thresholds, 2, 0.1f), 2);
+
+        // THEN -> past the band the level changes
+        QCOMPARE(LevelOfDetailSelector::selectLevel(0.44f, thresholds, 0, 0.1f), 1);
+        QCOMPARE(LevelOfDetailSelector::selectLevel(0.56f, thresholds, 1, 0.1f), 0);
+        QCOMPARE(LevelOfDetailSelector::selectLevel(0.1f, thresholds, 0, 0.1f), 2);
+        QCOMPARE(LevelOfDetailSelector::selectLevel(0.8f, thresholds, 2, 0.1f), 0);
+
+        // THEN -> no thresholds
+        QCOMPARE(LevelOfDetailSelector::selectLevel(0.01f, {}, 0, 0.1f), 0);
+    }
+
+    void checkSwitchesGeometry()
+    {
+        // GIVEN
+        SceneEntity scene;
+        View view;
+        Qt3DRender::QCamera camera;
+        camera.setFieldOfView(90.0f);
+        camera.setAspectRatio(1.0f);
+        camera.setViewCenter(QVector3D());
+        camera.setPosition(QVector3D(0.0f, 0.0f, 2.0f));
+        view.setCamera(&camera);
+
+        auto *entity = new Qt3DCore::QEntity(&scene);
+        auto *renderer = new Qt3DRender::QGeometryRenderer();
+        Qt3DGeometry::QGeometry *fullDetail = createLevel(renderer, 0);
+        Qt3DGeometry::QGeometry *simplified = createLevel(renderer, 1);
+        renderer->setGeometry(fullDetail);
+        entity->addComponent(renderer);
+
+        // Not a level of detail mesh
+        auto *otherEntity = new Qt3DCore::QEntity(&scene);
+        auto *otherRenderer = new Qt3DRender::QGeometryRenderer();
+        otherRenderer->setGeometry(new Qt3DGeometry::QGeometry(otherRenderer));
+        otherEntity->addComponent(otherRenderer);
+
+        LevelOfDetailSelector selector;
+        selector.setScreenSizeThresholds({ 0.25 });
+        selector.setView(&view);
+
+        // WHEN
+        selector.setSceneEntity(&scene);
+        selector.updateLevels();
+
+        // THEN -> screen size of 0.5
+        QCOMPARE(selector.managedMeshCount(), 1);
+        QCOMPARE(renderer->geometry(), fullDetail);
+
+        // WHEN -> screen size of 0.05, updated automatically
+        camera.setPosition(QVector3D(0.0f, 0.0f, 20.0f));
+
+        // THEN
+        QTRY_COMPARE(renderer->geometry(), simplified);
+
+        // WHEN -> screen size of 0.24, within the hysteresis band
+        camera.setPosition(QVector3D(0.0f, 0.0f, 1.0f / 0.24f));
+        selector.updateLevels();
+
+        // THEN
+        QCOMPARE(renderer->geometry(), simplified);
+
+        // WHEN -> screen size of 0.5
+        camera.setPosition(QVector3D(0.0f, 0.0f, 2.0f));
+        selector.updateLevels();
+
+        // THEN
+        QCOMPARE(renderer->geometry(), fullDetail);
+
+        // WHEN -> screen size of 0.24 coming from the full detail level
+        camera.setPosition(QVector3D(0.0f, 0.0f, 1.0f / 0.24f));
+        selector.updateLevels();
+
+        // THEN
+        QCOMPARE(renderer->geometry(), fullDetail);
+
+        // WHEN -> disabling restores full detail
+        camera.setPosition(QVector3D(0.0f, 0.0f, 20.0f));
+        selector.updateLevels();
+        QCOMPARE(renderer->geometry(), simplified);
+        selector.setEnabled(false);
+
+        // THEN
+        QCOMPARE(renderer->geometry(), fullDetail);
+    }
+};
+
+QTEST_MAIN(tst_LevelOfDetailSelector)
+
+#include "tst_levelofdetailselector.moc"
@@ -0,0 +1,257 @@
+/*
+    tst_lightclustergrid.cpp
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <QtTest/QTest>
+#include <Kuesa/private/lightclustergrid_p.h>
+#include <random>
+
+using namespace Kuesa;
+
+namespace {
+
+void addRandomLights(LightClusterGrid &grid, int lightCount, unsigned int seed = 883)
+{
+    std::mt19937 generator(seed);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+
+    for (int i = 0; i < lightCount; ++i) {
+        const QVector3D position(unit(generator) * 100.0f,
+                                 unit(generator) * 50.0f,
+                                 20.0f - std::abs(unit(generator)) * 300.0f);
+        grid.addLight(position, 2.0f + std::abs(unit(generator)) * 20.0f);
+    }
+}
+
+std::vector<quint32> clusterLights(const LightClusterGrid &grid, int cluster)
+{
+    const std::vector<quint32> &offsets = grid.clusterOffsets();
+    const std::vector<quint32> &indices = grid.lightIndices();
+    return std::vector<quint32>(indices.begin() + offsets[size_t(cluster)],
+                                indices.begin() + offsets[size_t(cluster) + 1]);
+}
+
+} // namespace
+
+class tst_LightClusterGrid : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void checkDefaults()
+    {
+        // GIVEN
+        LightClusterGrid grid;
+
+        // THEN
+        QCOMPARE(grid.tileCountX(), 16);
+        QCOMPARE(grid.tileCountY(), 9);
+        QCOMPARE(grid.sliceCount(), 24);
+        QCOMPARE(grid.clusterCount(), 16 * 9 * 24);
+        QCOMPARE(grid.lightCount(), 0);
+
+        // WHEN
+        grid.assign();
+
+        // THEN
+        QCOMPARE(grid.clusterOffsets().size(), size_t(grid.clusterCount() + 1));
+        QVERIFY(grid.lightIndices().empty());
+    }
+
+    void checkSliceForDepth()
+    {
+        // GIVEN
+        LightClusterGrid grid;
+        grid.setProjection(45.0f, 1.0f, 0.1f, 1000.0f);
+
+        // THEN
+        QCOMPARE(grid.sliceForDepth(0.05f), -1);
+        QCOMPARE(grid.sliceForDepth(1000.0f), -1);
+        QCOMPARE(grid.sliceForDepth(0.1f), 0);
+        QCOMPARE(grid.sliceForDepth(999.0f), 23);
+        // Slices grow exponentially, 6 slices per power of 10
+        QCOMPARE(grid.sliceForDepth(1.01f), 6);
+        QCOMPARE(grid.sliceForDepth(10.1f), 12);
+        QCOMPARE(grid.sliceForDepth(101.0f), 18);
+    }
+
+    void checkClusterBounds()
+    {
+        // GIVEN
+        LightClusterGrid grid;
+        grid.setDimensions(2, 2, 4);
+        grid.setProjection(90.0f, 1.0f, 1.0f, 10000.0f);
+
+        // WHEN
+        const LightClusterGrid::ClusterBounds nearBottomLeft = grid.clusterBounds(grid.clusterIndex(0, 0, 0));
+        const LightClusterGrid::ClusterBounds farTopRight = grid.clusterBounds(grid.clusterIndex(1, 1, 3));
+
+        // THEN
+        // tan(45) = 1, the frustum is as wide as it is deep
+        QVERIFY(qFuzzyCompare(nearBottomLeft.minimum, QVector3D(-10.0f, -10.0f, -10.0f)));
+        QVERIFY(qFuzzyCompare(nearBottomLeft.maximum, QVector3D(0.0f, 0.0f, -1.0f)));
+        QVERIFY(qFuzzyCompare(farTopRight.minimum, QVector3D(0.0f, 0.0f, -10000.0f)));
+        QVERIFY(qFuzzyCompare(farTopRight.maximum, QVector3D(10000.0f, 10000.0f, -1000.0f)));
+    }
+
+    void checkMatchesBruteForce_data()
+    {
+        QTest::addColumn<int>("lightCount");
+        QTest::addColumn<int>("tileCountX");
+        QTest::addColumn<int>("tileCountY");
+        QTest::addColumn<int>("sliceCount");
+
+        QTest::newRow("single light") << 1 << 16 << 9 << 24;
+        QTest::newRow("few lights") << 32 << 16 << 9 << 24;
+        QTest::newRow("many lights") << 2000 << 16 << 9 << 24;
+        QTest::newRow("coarse grid") << 500 << 4 << 3 << 8;
+        QTest::newRow("single cluster") << 100 << 1 << 1 << 1;
+    }
+
+    void checkMatchesBruteForce()
+    {
+        // GIVEN
+        QFETCH(int, lightCount);
+        QFETCH(int, tileCountX);
+        QFETCH(int, tileCountY);
+        QFETCH(int, sliceCount);
+        LightClusterGrid grid;
+        grid.setDimensions(tileCountX, tileCountY, sliceCount);
+        grid.setProjection(60.0f, 16.0f / 9.0f, 0.5f, 500.0f);
+        addRandomLights(grid, lightCount);
+
+        // WHEN
+        grid.assignBruteForce();
+        const std::vector<quint32> expectedOffsets = grid.clusterOffsets();
+        const std::vector<quint32> expectedIndices = grid.lightIndices();
+        grid.assign();
+
+        // THEN
+        QVERIFY(!expectedIndices.empty());
+        QVERIFY(grid.clusterOffsets() == expectedOffsets);
+        QVERIFY(grid.lightIndices() == expectedIndices);
+    }
+
+    void checkPointLight()
+    {
+        // GIVEN
+        LightClusterGrid grid;
+        grid.setDimensions(4, 4, 8);
+        grid.setProjection(90.0f, 1.0f, 1.0f, 10000.0f);
+        // Small light in the middle of cluster (3, 3, 2), clear of its edges
+        const int slice = grid.sliceForDepth(30.0f);
+        grid.addLight(QVector3D(22.0f, 22.0f, -30.0f), 1.0f);
+
+        // WHEN
+        grid.assign();
+
+        // THEN
+        QCOMPARE(slice, 2);
+        for (int cluster = 0; cluster < grid.clusterCount(); ++cluster) {
+            const std::vector<quint32> lights = clusterLights(grid, cluster);
+            if (cluster == grid.clusterIndex(3, 3, slice))
+                QVERIFY(lights == std::vector<quint32>({ 0 }));
+            else
+                QVERIFY(lights.empty());
+        }
+    }
+
+    void checkUnlimitedRange()
+    {
+        // GIVEN
+        LightClusterGrid grid;
+        grid.setDimensions(4, 4, 4);
+        addRandomLights(grid, 3);
+        grid.addLight(QVector3D(0.0f, 0.0f, 1000.0f), 0.0f);
+
+        // WHEN
+        grid.assign();
+
+        // THEN
+        for (int cluster = 0; cluster < grid.clusterCount(); ++cluster) {
+            const std::vector<quint32> lights = clusterLights(grid, cluster);
+            QVERIFY(!lights.empty());
+            QCOMPARE(lights.back(), quint32(3));
+        }
+    }
+
+    void checkLightsOutsideFrustum()
+    {
+        // GIVEN
+        LightClusterGrid grid;
+        grid.setProjection(45.0f, 1.0f, 0.1f, 100.0f);
+        // Behind the camera
+        grid.addLight(QVector3D(0.0f, 0.0f, 5.0f), 2.0f);
+        // Beyond the far plane
+        grid.addLight(QVector3D(0.0f, 0.0f, -150.0f), 10.0f);
+        // Far to the side
+        grid.addLight(QVector3D(500.0f, 0.0f, -10.0f), 10.0f);
+
+        // WHEN
+        grid.assign();
+
+        // THEN
+        QCOMPARE(grid.lightCount(), 3);
+        QVERIFY(grid.lightIndices().empty());
+        QCOMPARE(grid.clusterOffsets().back(), quint32(0));
+    }
+
+    void benchmarkAssign_data()
+    {
+        QTest::addColumn<int>("lightCount");
+        QTest::addColumn<bool>("bruteForce");
+
+        QTest::newRow("256 lights") << 256 << false;
+        QTest::newRow("256 lights brute force") << 256 << true;
+        QTest::newRow("1024 lights") << 1024 << false;
+        QTest::newRow("1024 lights brute force") << 1024 << true;
+    }
+
+    void benchmarkAssign()
+    {
+        // GIVEN
+        QFETCH(int, lightCount);
+        QFETCH(bool, bruteForce);
+        LightClusterGrid grid;
+        addRandomLights(grid, lightCount);
+
+        // WHEN
+        if (bruteForce) {
+            QBENCHMARK {
+                grid.assignBruteForce();
+            }
+        } else {
+            QBENCHMARK {
+                grid.assign();
+            }
+        }
+    }
+};
+
+QTEST_MAIN(tst_LightClusterGrid)
+
+#include "tst_lightclustergrid.moc"
@@ -28,7 +28,7 @@ TEMPLATE = app
 
 TARGET = tst_meshinstantiator
 
-QT += testlib kuesa 3dcore 3drender 3dcore-private
+QT += testlib kuesa 3dcore 3drender 3dcore-private 3drender-private
 
 CONFIG += testcase
 
@@ -28,23 +28,37 @@
 
 #include <QtTest/QTest>
 #include <QSignalSpy>
+#include <cstring>
 
 #include <Kuesa/meshinstantiator.h>
 #include <Qt3DRender/QViewport>
 #include <Qt3DRender/QCamera>
 #include <Qt3DRender/QCameraLens>
 #include <Qt3DCore/QEntity>
+#include <Qt3DCore/QTransform>
 #include <Qt3DRender/QGeometryRenderer>
 #include <Kuesa/MetallicRoughnessMaterial>
 
 #if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
 #include <Qt3DCore/QAttribute>
 #include <Qt3DCore/QBuffer>
+#include <Qt3DCore/private/qgeometry_p.h>
 #else
 #include <Qt3DRender/QAttribute>
 #include <Qt3DRender/QBuffer>
+#include <Qt3DRender/private/qgeometry_p.h>
 #endif
 
+namespace {
+
+void setGeometryExtent(Qt3DGeometry::QGeometry *geometry, const QVector3D &minExtent, const QVector3D &maxExtent)
+{
+    auto d = static_cast<Qt3DGeometry::QGeometryPrivate *>(Qt3DCore::QNodePrivate::get(geometry));
+    d->setExtent(minExtent, maxExtent);
+}
+
+} // namespace
+
 class tst_MeshInstantiator : public QObject
 {
     Q_OBJECT
@@ -64,9 +78,65 @@ private Q_SLOTS:
         QVERIFY(instantiator.entityName().isEmpty());
         QVERIFY(instantiator.transformationMatrices().empty());
         QCOMPARE(instantiator.count(), 1);
+        QCOMPARE(instantiator.visibleCount(), 1);
+        QVERIFY(instantiator.camera() == nullptr);
+        QVERIFY(!instantiator.instanceCulling());
         QVERIFY(instantiator.sceneEntity() == nullptr);
     }
 
+    void checkSetInstanceCulling()
+    {
+        // GIVEN
+        Kuesa::MeshInstantiator instantiator;
+        QSignalSpy spy(&instantiator, &Kuesa::MeshInstantiator::instanceCullingChanged);
+
+        // THEN
+        QVERIFY(spy.isValid());
+
+        // WHEN
+        instantiator.setInstanceCulling(true);
+
+        // THEN
+        QVERIFY(instantiator.instanceCulling());
+        QCOMPARE(spy.count(), 1);
+
+        // WHEN
+        instantiator.setInstanceCulling(true);
+
+        // THEN
+        QCOMPARE(spy.count(), 1);
+    }
+
+    void checkSetCamera()
+    {
+        // GIVEN
+        Kuesa::MeshInstantiator instantiator;
+        QSignalSpy spy(&instantiator, &Kuesa::MeshInstantiator::cameraChanged);
+
+        // THEN
+        QVERIFY(spy.isValid());
+
+        {
+            // WHEN
+            Qt3DRender::QCamera camera;
+            instantiator.setCamera(&camera);
+
+            // THEN
+            QCOMPARE(instantiator.camera(), &camera);
+            QCOMPARE(spy.count(), 1);
+
+            // WHEN
+            instantiator.setCamera(&camera);
+
+            // THEN
+            QCOMPARE(spy.count(), 1);
+        }
+
+        // THEN -> destruction helper resets the camera
+        QVERIFY(instantiator.camera() == nullptr);
+        QCOMPARE(spy.count(), 2);
+    }
+
     void checkSetEntityName()
     {
         // GIVEN
@@ -186,6 +256,198 @@ private Q_SLOTS:
         QCOMPARE(attr->divisor(), 1U);
         QCOMPARE(attr->buffer()->data().size(), int(2 * 16 * sizeof(float)));
     }
+
+    void checkFollowsGeometrySwaps()
+    {
+        // GIVEN
+        Kuesa::MeshInstantiator instantiator;
+        Kuesa::SceneEntity scene;
+
+        Qt3DCore::QEntity root;
+        Qt3DCore::QEntity *e = new Qt3DCore::QEntity(&root);
+        Qt3DRender::QGeometryRenderer *g = new Qt3DRender::QGeometryRenderer;
+        Qt3DGeometry::QGeometry *fullDetail = new Qt3DGeometry::QGeometry(g);
+        Qt3DGeometry::QGeometry *lowDetail = new Qt3DGeometry::QGeometry(g);
+        g->setGeometry(fullDetail);
+        Kuesa::MetallicRoughnessMaterial *m = new Kuesa::MetallicRoughnessMaterial;
+        m->setEffect(new Kuesa::MetallicRoughnessEffect);
+        e->addComponent(g);
+        e->addComponent(m);
+
+        scene.entities()->add(QStringLiteral("MyEntity"), &root);
+        instantiator.setSceneEntity(&scene);
+        instantiator.setEntityName(QStringLiteral("MyEntity"));
+        instantiator.setTransformationMatrices({ QMatrix4x4(), QMatrix4x4() });
+
+        // THEN
+        QCOMPARE(fullDetail->attributes().size(), 1);
+        QCOMPARE(lowDetail->attributes().size(), 0);
+
+        // WHEN -> swap level of detail like the LevelOfDetailSelector does
+        g->setGeometry(lowDetail);
+
+        // THEN
+        QCOMPARE(g->instanceCount(), 2);
+        QCOMPARE(lowDetail->attributes().size(), 1);
+        QCOMPARE(lowDetail->attributes().first()->name(), QStringLiteral("perInstanceTransform"));
+
+        // WHEN -> back to full detail
+        g->setGeometry(fullDetail);
+
+        // THEN -> attribute isn't added twice
+        QCOMPARE(fullDetail->attributes().size(), 1);
+    }
+
+    void checkCullsInstances()
+    {
+        // GIVEN
+        Kuesa::MeshInstantiator instantiator;
+        Kuesa::SceneEntity scene;
+        Qt3DRender::QCamera camera;
+        QSignalSpy visibleCountSpy(&instantiator, &Kuesa::MeshInstantiator::visibleCountChanged);
+
+        camera.setPerspectiveProjection(45.0f, 1.0f, 0.1f, 100.0f);
+        camera.setPosition(QVector3D(0.0f, 0.0f, 10.0f));
+        camera.setViewCenter(QVector3D());
+        camera.setUpVector(QVector3D(0.0f, 1.0f, 0.0f));
+
+        Qt3DCore::QEntity root;
+        Qt3DCore::QEntity *e = new Qt3DCore::QEntity(&root);
+        Qt3DRender::QGeometryRenderer *g = new Qt3DRender::QGeometryRenderer;
+        Qt3DGeometry::QGeometry *ge = new Qt3DGeometry::QGeometry();
+        setGeometryExtent(ge, QVector3D(-1.0f, -1.0f, -1.0f), QVector3D(1.0f, 1.0f, 1.0f));
+        g->setGeometry(ge);
+        Kuesa::MetallicRoughnessMaterial *m = new Kuesa::MetallicRoughnessMaterial;
+        m->setEffect(new Kuesa::MetallicRoughnessEffect);
+        e->addComponent(g);
+        e->addComponent(m);
+
+        QMatrix4x4 m1;
+        QMatrix4x4 m2;
+        QMatrix4x4 m3;
+        m2.translate(QVector3D(1000.0f, 0.0f, 0.0f));
+        m3.translate(QVector3D(-1000.0f, 0.0f, 0.0f));
+
+        scene.entities()->add(QStringLiteral("MyEntity"), &root);
+        instantiator.setSceneEntity(&scene);
+        instantiator.setEntityName(QStringLiteral("MyEntity"));
+        instantiator.setTransformationMatrices({ m1, m2, m3 });
+
+        // THEN
+        QCOMPARE(instantiator.visibleCount(), 3);
+        QCOMPARE(g->instanceCount(), 3);
+
+        // WHEN
+        instantiator.setCamera(&camera);
+        instantiator.setInstanceCulling(true);
+        QCoreApplication::processEvents();
+
+        // THEN
+        QCOMPARE(instantiator.count(), 3);
+        QCOMPARE(instantiator.visibleCount(), 1);
+        QCOMPARE(g->instanceCount(), 1);
+        QCOMPARE(visibleCountSpy.count(), 2);
+
+        auto *attr = ge->attributes().first();
+        QCOMPARE(attr->count(), 1U);
+        QCOMPARE(attr->buffer()->data().size(), int(16 * sizeof(float)));
+        QVERIFY(memcmp(attr->buffer()->data().constData(), m1.constData(), 16 * sizeof(float)) == 0);
+
+        // WHEN
+        camera.setPosition(QVector3D(1000.0f, 0.0f, 10.0f));
+        camera.setViewCenter(QVector3D(1000.0f, 0.0f, 0.0f));
+        QCoreApplication::processEvents();
+
+        // THEN
+        QCOMPARE(instantiator.visibleCount(), 1);
+        QVERIFY(memcmp(attr->buffer()->data().constData(), m2.constData(), 16 * sizeof(float)) == 0);
+
+        // WHEN
+        camera.setPosition(QVector3D(0.0f, 0.0f, 5000.0f));
+        camera.setViewCenter(QVector3D(0.0f, 0.0f, 6000.0f));
+        QCoreApplication::processEvents();
+
+        // THEN
+        QCOMPARE(instantiator.visibleCount(), 0);
+        QCOMPARE(g->instanceCount(), 0);
+
+        // WHEN
+        instantiator.setInstanceCulling(false);
+
+        // THEN
+        QCOMPARE(instantiator.visibleCount(), 3);
+        QCOMPARE(g->instanceCount(), 3);
+        QCOMPARE(attr->buffer()->data().size(), int(3 * 16 * sizeof(float)));
+    }
+
+    void checkInstanceTransform()
+    {
+        // GIVEN
+        Kuesa::MeshInstantiator instantiator;
+        Kuesa::SceneEntity scene;
+        QSignalSpy transformSpy(&instantiator, &Kuesa::MeshInstantiator::instanceTransformChanged);
+
+        Qt3DCore::QEntity root;
+        Qt3DCore::QEntity *e = new Qt3DCore::QEntity(&root);
+        Qt3DRender::QGeometryRenderer *g = new Qt3DRender::QGeometryRenderer;
+        Qt3DGeometry::QGeometry *ge = new Qt3DGeometry::QGeometry();
+        g->setGeometry(ge);
+        Kuesa::MetallicRoughnessMaterial *m = new Kuesa::MetallicRoughnessMaterial;
+        m->setEffect(new Kuesa::MetallicRoughnessEffect);
+        e->addComponent(g);
+        e->addComponent(m);
+
+        QMatrix4x4 m1;
+        QMatrix4x4 m2;
+        m2.translate(QVector3D(10.0f, 0.0f, 0.0f));
+
+        scene.entities()->add(QStringLiteral("MyEntity"), &root);
+        instantiator.setSceneEntity(&scene);
+        instantiator.setEntityName(QStringLiteral("MyEntity"));
+        instantiator.setTransformationMatrices({ m1, m2 });
+        auto *attr = ge->attributes().first();
+
+        // THEN
+        QVERIFY(instantiator.instanceTransform() == nullptr);
+
+        // WHEN
+        Qt3DCore::QTransform *transform = new Qt3DCore::QTransform;
+        transform->setTranslation(QVector3D(0.0f, 1.0f, 0.0f));
+        instantiator.setInstanceTransform(transform);
+
+        // THEN
+        QCOMPARE(instantiator.instanceTransform(), transform);
+        QCOMPARE(transformSpy.count(), 1);
+        QCOMPARE(attr->buffer()->data().size(), int(2 * 16 * sizeof(float)));
+        {
+            const QMatrix4x4 expected1 = m1 * transform->matrix();
+            const QMatrix4x4 expected2 = m2 * transform->matrix();
+            const char *data = attr->buffer()->data().constData();
+            QVERIFY(memcmp(data, expected1.constData(), 16 * sizeof(float)) == 0);
+            QVERIFY(memcmp(data + 16 * sizeof(float), expected2.constData(), 16 * sizeof(float)) == 0);
+        }
+
+        // WHEN
+        // Several changes result in a single update
+        transform->setTranslation(QVector3D(0.0f, 2.0f, 0.0f));
+        transform->setScale(2.0f);
+        QCoreApplication::processEvents();
+
+        // THEN
+        {
+            const QMatrix4x4 expected2 = m2 * transform->matrix();
+            const char *data = attr->buffer()->data().constData();
+            QVERIFY(memcmp(data + 16 * sizeof(float), expected2.constData(), 16 * sizeof(float)) == 0);
+        }
+
+        // WHEN
+        delete transform;
+
+        // THEN
+        QVERIFY(instantiator.instanceTransform() == nullptr);
+        QCOMPARE(transformSpy.count(), 2);
+        QVERIFY(memcmp(attr->buffer()->data().constData() + 16 * sizeof(float), m2.constData(), 16 * sizeof(float)) == 0);
+    }
 };
 
 QTEST_MAIN(tst_MeshInstantiator)
@@ -28,6 +28,7 @@
 
 #include <QtTest/QTest>
 #include <Kuesa/private/meshparser_utils_p.h>
+#include <Kuesa/private/bufferaccessorparser_p.h>
 #include <Kuesa/private/kuesa_global_p.h>
 
 #if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
@@ -747,6 +748,129 @@ private Q_SLOTS:
         QVERIFY(qFuzzyCompare(tangents[4] + QVector4D(morphTangents[4], 0.0f), QVector4D(std::sqrt(2.0f) / 2.0f, std::sqrt(2.0f) / 2.0f, 0, -1)));
         QVERIFY(qFuzzyCompare(tangents[5] + QVector4D(morphTangents[5], 0.0f), QVector4D(std::sqrt(2.0f) / 2.0f, std::sqrt(2.0f) / 2.0f, 0, -1)));
     }
+
+    void checkExtentsFromAccessor()
+    {
+        // GIVEN
+        Accessor accessor;
+        accessor.type = QAttribute::Float;
+        accessor.dataSize = 3;
+        QVector3D minExtent;
+        QVector3D maxExtent;
+
+        // THEN -> no min/max
+        QVERIFY(!MeshParserUtils::extentsFromAccessor(accessor, minExtent, maxExtent));
+
+        // WHEN
+        accessor.min = { -1.0f, -2.0f, -3.0f };
+        accessor.max = { 1.0f, 2.0f, 3.0f };
+
+        // THEN
+        QVERIFY(MeshParserUtils::extentsFromAccessor(accessor, minExtent, maxExtent));
+        QCOMPARE(minExtent, QVector3D(-1.0f, -2.0f, -3.0f));
+        QCOMPARE(maxExtent, QVector3D(1.0f, 2.0f, 3.0f));
+
+        // WHEN -> normalized integer accessors are not trusted
+        accessor.type = QAttribute::UnsignedShort;
+
+        // THEN
+        QVERIFY(!MeshParserUtils::extentsFromAccessor(accessor, minExtent, maxExtent));
+    }
+
+    void checkExtentsFromPositionAttribute()
+    {
+        // GIVEN -> interleaved position (vec3) + uv (vec2) so that the last
+        // position ends 8 bytes before the end of the buffer
+        const std::vector<float> vertices = {
+            0.0f, 0.0f, 0.0f, 0.0f, 0.0f,
+            5.0f, -1.0f, 2.0f, 1.0f, 0.0f,
+            -3.0f, 4.0f, -7.0f, 0.0f, 1.0f,
+            1.0f, 1.0f, 9.0f, 1.0f, 1.0f,
+        };
+        QByteArray rawData(reinterpret_cast<const char *>(vertices.data()), int(vertices.size() * sizeof(float)));
+
+        QScopedPointer<QGeometry> geometry(new QGeometry);
+        Qt3DGeometry::QBuffer *buffer = new Qt3DGeometry::QBuffer(geometry.data());
+        buffer->setData(rawData);
+        QAttribute *positionAttribute = new QAttribute(buffer, QAttribute::defaultPositionAttributeName(),
+                                                       QAttribute::Float, 3, 4, 0, 5 * sizeof(float));
+        geometry->addAttribute(positionAttribute);
+
+        QVector3D minExtent;
+        QVector3D maxExtent;
+
+        // WHEN
+        const bool success = MeshParserUtils::extentsFromPositionAttribute(positionAttribute, minExtent, maxExtent);
+
+        // THEN
+        QVERIFY(success);
+        QCOMPARE(minExtent, QVector3D(-3.0f, -1.0f, -7.0f));
+        QCOMPARE(maxExtent, QVector3D(5.0f, 4.0f, 9.0f));
+
+        // WHEN -> tightly packed, last vertex can't be loaded with 4 floats
+        const std::vector<float> packedVertices = { 1.0f, 2.0f, 3.0f, -4.0f, 5.0f, -6.0f, 7.0f, -8.0f, 9.0f };
+        buffer->setData(QByteArray(reinterpret_cast<const char *>(packedVertices.data()), int(packedVertices.size() * sizeof(float))));
+        positionAttribute->setByteStride(0);
+        positionAttribute->setCount(3);
+
+        // THEN
+        QVERIFY(MeshParserUtils::extentsFromPositionAttribute(positionAttribute, minExtent, maxExtent));
+        QCOMPARE(minExtent, QVector3D(-4.0f, -8.0f, -6.0f));
+        QCOMPARE(maxExtent, QVector3D(7.0f, 5.0f, 9.0f));
+
+        // WHEN -> count exceeding buffer size
+        positionAttribute->setCount(4);
+
+        // THEN
+        QVERIFY(!MeshParserUtils::extentsFromPositionAttribute(positionAttribute, minExtent, maxExtent));
+    }
+
+    void checkExtentsForMorphTarget()
+    {
+        // GIVEN
+        QVector3D minExtent(-1.0f, -1.0f, -1.0f);
+        QVector3D maxExtent(1.0f, 1.0f, 1.0f);
+
+        // WHEN
+        // Deltas only move vertices along +x
+        MeshParserUtils::extentsForMorphTarget(minExtent, maxExtent,
+                                               QVector3D(0.0f, 0.0f, 0.0f), QVector3D(2.0f, 0.0f, 0.0f),
+                                               0.0f, 1.0f);
+
+        // THEN
+        QCOMPARE(minExtent, QVector3D(-1.0f, -1.0f, -1.0f));
+        QCOMPARE(maxExtent, QVector3D(3.0f, 1.0f, 1.0f));
+
+        // WHEN
+        // Negative weights move them along -x, weights above 1 further along +x
+        minExtent = QVector3D(-1.0f, -1.0f, -1.0f);
+        maxExtent = QVector3D(1.0f, 1.0f, 1.0f);
+        MeshParserUtils::extentsForMorphTarget(minExtent, maxExtent,
+                                               QVector3D(0.0f, -1.0f, 0.0f), QVector3D(2.0f, 0.0f, 0.0f),
+                                               -0.5f, 2.0f);
+
+        // THEN
+        QCOMPARE(minExtent, QVector3D(-2.0f, -3.0f, -1.0f));
+        QCOMPARE(maxExtent, QVector3D(5.0f, 1.5f, 1.0f));
+    }
+
+    void checkApplyPrimitiveBounds()
+    {
+        // GIVEN
+        QGeometryRenderer renderer;
+        QGeometry *geometry = new QGeometry;
+        renderer.setGeometry(geometry);
+
+        // WHEN
+        const MeshParserUtils::PrimitiveBounds bounds = MeshParserUtils::boundsFromExtents(QVector3D(-1.0f, -2.0f, -2.0f),
+                                                                                           QVector3D(1.0f, 2.0f, 2.0f));
+        MeshParserUtils::applyPrimitiveBounds(&renderer, bounds);
+
+        // THEN
+        QVERIFY(bounds.isValid);
+        QCOMPARE(geometry->minExtent(), QVector3D(-1.0f, -2.0f, -2.0f));
+        QCOMPARE(geometry->maxExtent(), QVector3D(1.0f, 2.0f, 2.0f));
+    }
 };
 
 QTEST_APPLESS_MAIN(tst_MeshParserUtils)
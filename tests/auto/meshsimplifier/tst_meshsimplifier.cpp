@@ -0,0 +1,230 @@
+/*
+    tst_meshsimplifier.cpp
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <QtTest/QTest>
+#include <Kuesa/private/meshsimplifier_p.h>
+#include <Kuesa/private/kuesa_global_p.h>
+#include <Qt3DRender/QGeometryRenderer>
+
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+#include <Qt3DCore/QBuffer>
+#include <Qt3DCore/QGeometry>
+#include <Qt3DCore/QAttribute>
+#else
+#include <Qt3DRender/QBuffer>
+#include <Qt3DRender/QGeometry>
+#include <Qt3DRender/QAttribute>
+#endif
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <set>
+
+using namespace Kuesa::GLTF2Import;
+
+namespace {
+
+// Regular grid of size x size quads in the XY plane, spacing of 1
+void generateGrid(int size, std::vector<QVector3D> &positions, std::vector<quint32> &indices)
+{
+    positions.clear();
+    indices.clear();
+    for (int y = 0; y <= size; ++y)
+        for (int x = 0; x <= size; ++x)
+            positions.emplace_back(float(x), float(y), 0.0f);
+
+    const quint32 rowLength = quint32(size + 1);
+    for (int y = 0; y < size; ++y) {
+        for (int x = 0; x < size; ++x) {
+            const quint32 i = quint32(y) * rowLength + quint32(x);
+            indices.insert(indices.end(), { i, i + 1, i + rowLength + 1 });
+            indices.insert(indices.end(), { i, i + rowLength + 1, i + rowLength });
+        }
+    }
+}
+
+QVector3D triangleNormal(const std::vector<QVector3D> &positions, const quint32 *triangle)
+{
+    return QVector3D::crossProduct(positions[triangle[1]] - positions[triangle[0]],
+                                   positions[triangle[2]] - positions[triangle[0]]);
+}
+
+} // namespace
+
+class tst_MeshSimplifier : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+
+    void checkSimplifyKeepsMeshBelowVertexSpacing()
+    {
+        // GIVEN
+        std::vector<QVector3D> positions;
+        std::vector<quint32> indices;
+        generateGrid(8, positions, indices);
+
+        // WHEN
+        const std::vector<quint32> simplified = MeshSimplifier::simplifyTriangles(positions, indices, 0.5f);
+
+        // THEN
+        QCOMPARE(simplified.size(), indices.size());
+    }
+
+    void checkSimplifyReducesTriangles()
+    {
+        // GIVEN
+        std::vector<QVector3D> positions;
+        std::vector<quint32> indices;
+        generateGrid(16, positions, indices);
+
+        // WHEN
+        const std::vector<quint32> simplified = MeshSimplifier::simplifyTriangles(positions, indices, 2.0f);
+
+        // THEN
+        QVERIFY(!simplified.empty());
+        QCOMPARE(simplified.size() % 3, size_t(0));
+        QVERIFY(simplified.size() < indices.size() / 2);
+
+        std::set<std::array<quint32, 3>> triangles;
+        for (size_t i = 0; i < simplified.size(); i += 3) {
+            const quint32 *triangle = simplified.data() + i;
+            // No out of range index and no degenerate triangle
+            QVERIFY(triangle[0] < positions.size() && triangle[1] < positions.size() && triangle[2] < positions.size());
+            QVERIFY(triangle[0] != triangle[1] && triangle[1] != triangle[2] && triangle[0] != triangle[2]);
+            // Winding is preserved
+            QVERIFY(triangleNormal(positions, triangle).z() > 0.0f);
+            // No duplicated triangle
+            std::array<quint32, 3> key = { triangle[0], triangle[1], triangle[2] };
+            std::sort(key.begin(), key.end());
+            QVERIFY(triangles.insert(key).second);
+        }
+    }
+
+    void checkSimplifyHandlesInvalidInput()
+    {
+        // GIVEN
+        std::vector<QVector3D> positions;
+        std::vector<quint32> indices;
+        generateGrid(2, positions, indices);
+
+        // THEN
+        QVERIFY(MeshSimplifier::simplifyTriangles({}, indices, 1.0f).empty());
+        QVERIFY(MeshSimplifier::simplifyTriangles(positions, {}, 1.0f).empty());
+        QVERIFY(MeshSimplifier::simplifyTriangles(positions, indices, 0.0f).empty());
+    }
+
+    void checkGenerateLevelsOfDetail()
+    {
+        // GIVEN
+        std::vector<QVector3D> positions;
+        std::vector<quint32> indices;
+        generateGrid(32, positions, indices);
+
+        QByteArray vertexData(int(positions.size() * 3 * sizeof(float)), Qt::Uninitialized);
+        float *v = reinterpret_cast<float *>(vertexData.data());
+        for (const QVector3D &p : positions) {
+            *v++ = p.x();
+            *v++ = p.y();
+            *v++ = p.z();
+        }
+        QByteArray indexData(int(indices.size() * sizeof(quint32)), Qt::Uninitialized);
+        std::memcpy(indexData.data(), indices.data(), size_t(indexData.size()));
+
+        Qt3DRender::QGeometryRenderer renderer;
+        auto *geometry = new Qt3DGeometry::QGeometry();
+        auto *vertexBuffer = new Qt3DGeometry::QBuffer(geometry);
+        vertexBuffer->setData(vertexData);
+        auto *indexBuffer = new Qt3DGeometry::QBuffer(geometry);
+        indexBuffer->setData(indexData);
+
+        auto *positionAttribute = new Qt3DGeometry::QAttribute(vertexBuffer,
+                                                               Qt3DGeometry::QAttribute::defaultPositionAttributeName(),
+                                                               Qt3DGeometry::QAttribute::Float, 3,
+                                                               uint(positions.size()));
+        auto *indexAttribute = new Qt3DGeometry::QAttribute(indexBuffer, Qt3DGeometry::QAttribute::UnsignedInt,
+                                                            1, uint(indices.size()));
+        indexAttribute->setAttributeType(Qt3DGeometry::QAttribute::IndexAttribute);
+        geometry->addAttribute(positionAttribute);
+        geometry->addAttribute(indexAttribute);
+        renderer.setGeometry(geometry);
+        renderer.setPrimitiveType(Qt3DRender::QGeometryRenderer::Triangles);
+
+        // WHEN
+        const int levelCount = MeshSimplifier::generateLevelsOfDetail(&renderer, 3, 3.0f, false);
+
+        // THEN
+        QCOMPARE(levelCount, 3);
+        QCOMPARE(renderer.geometry(), geometry);
+
+        const MeshSimplifier::LevelsOfDetail *levelsOfDetail = MeshSimplifier::LevelsOfDetail::find(&renderer);
+        QVERIFY(levelsOfDetail != nullptr);
+        QCOMPARE(levelsOfDetail->levels.size(), size_t(levelCount + 1));
+        QCOMPARE(levelsOfDetail->levels.front().data(), geometry);
+
+        const auto lodGeometries = renderer.findChildren<Qt3DGeometry::QGeometry *>(QString(), Qt::FindDirectChildrenOnly);
+        QCOMPARE(lodGeometries.size(), 4);
+
+        uint previousIndexCount = uint(indices.size());
+        for (int level = 1; level <= levelCount; ++level) {
+            Qt3DGeometry::QGeometry *lod = levelsOfDetail->levels[size_t(level)];
+            QVERIFY(lod != nullptr);
+            QVERIFY(lodGeometries.contains(lod));
+
+            // Vertex attributes are shared with the full detail geometry
+            QVERIFY(lod->attributes().contains(positionAttribute));
+            QVERIFY(!lod->attributes().contains(indexAttribute));
+
+            const Qt3DGeometry::QAttribute *lodIndices = nullptr;
+            for (const Qt3DGeometry::QAttribute *attribute : lod->attributes())
+                if (attribute->attributeType() == Qt3DGeometry::QAttribute::IndexAttribute)
+                    lodIndices = attribute;
+            QVERIFY(lodIndices != nullptr);
+            QCOMPARE(lodIndices->vertexBaseType(), Qt3DGeometry::QAttribute::UnsignedShort);
+            QVERIFY(lodIndices->count() < previousIndexCount);
+            previousIndexCount = lodIndices->count();
+        }
+    }
+
+    void checkGenerateLevelsOfDetailSkipsNonTriangles()
+    {
+        // GIVEN
+        Qt3DRender::QGeometryRenderer renderer;
+        renderer.setGeometry(new Qt3DGeometry::QGeometry());
+        renderer.setPrimitiveType(Qt3DRender::QGeometryRenderer::Lines);
+
+        // THEN
+        QCOMPARE(MeshSimplifier::generateLevelsOfDetail(&renderer, 3, 1.0f, false), 0);
+        QCOMPARE(MeshSimplifier::generateLevelsOfDetail(nullptr, 3, 1.0f, false), 0);
+    }
+};
+
+QTEST_MAIN(tst_MeshSimplifier)
+
+#include "tst_meshsimplifier.moc"
@@ -0,0 +1,211 @@
+/*
+    tst_metallicroughnessblock.cpp
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <QtTest/QTest>
+#include <QSignalSpy>
+#include <QOpenGLContext>
+#include <Qt3DRender/QParameter>
+#include <Kuesa/MetallicRoughnessMaterial>
+#include <Kuesa/MetallicRoughnessProperties>
+#include <Kuesa/private/metallicroughnessblock_p.h>
+#include <Kuesa/private/metallicroughnessshaderdata_p.h>
+#include <cstring>
+
+using namespace Kuesa;
+
+namespace {
+
+float readFloat(const QByteArray &block, int offset)
+{
+    float value;
+    std::memcpy(&value, block.constData() + offset, sizeof(float));
+    return value;
+}
+
+qint32 readInt(const QByteArray &block, int offset)
+{
+    qint32 value;
+    std::memcpy(&value, block.constData() + offset, sizeof(qint32));
+    return value;
+}
+
+} // namespace
+
+class tst_MetallicRoughnessBlock : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+
+    void checkDefaultBlock()
+    {
+        // GIVEN
+        MetallicRoughnessShaderData shaderData;
+
+        // WHEN
+        const QByteArray block = shaderData.block();
+
+        // THEN
+        QCOMPARE(block.size(), MetallicRoughnessBlock::Size);
+        QCOMPARE(shaderData.blockBuffer()->data(), block);
+
+        // Identity texture transforms, columns padded to a vec4
+        const float identity[12] = { 1.0f, 0.0f, 0.0f, 0.0f,
+                                     0.0f, 1.0f, 0.0f, 0.0f,
+                                     0.0f, 0.0f, 1.0f, 0.0f };
+        QCOMPARE(std::memcmp(block.constData() + MetallicRoughnessBlock::BaseColorMapTextureTransform, identity, sizeof(identity)), 0);
+        QCOMPARE(std::memcmp(block.constData() + MetallicRoughnessBlock::EmissiveMapTextureTransform, identity, sizeof(identity)), 0);
+
+        QCOMPARE(readFloat(block, MetallicRoughnessBlock::NormalScale), 1.0f);
+        QCOMPARE(readFloat(block, MetallicRoughnessBlock::EmissiveFactor + 3 * 4), 1.0f);
+        QCOMPARE(readInt(block, MetallicRoughnessBlock::BaseColorUsesTexCoord1), 0);
+        QCOMPARE(readInt(block, MetallicRoughnessBlock::ReceivesShadows), 1);
+
+        // Padding up to the end of the struct
+        for (int offset = MetallicRoughnessBlock::ReceivesShadows + 4; offset < MetallicRoughnessBlock::Size; offset += 4)
+            QCOMPARE(readInt(block, offset), 0);
+    }
+
+    void checkPacking()
+    {
+        // GIVEN
+        MetallicRoughnessShaderData shaderData;
+        const float transform[9] = { 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f, 8.0f, 9.0f };
+
+        // WHEN
+        shaderData.setNormalMapTextureTransform(QMatrix3x3(transform));
+        shaderData.setBaseColorFactor(QColor(51, 102, 153));
+        shaderData.setMetallicFactor(0.125f);
+        shaderData.setRoughnessFactor(0.625f);
+        shaderData.setAlphaCutoff(0.5f);
+        shaderData.setAOUsesTexCoord1(true);
+        shaderData.setReceivesShadows(false);
+        const QByteArray block = MetallicRoughnessBlock::pack(shaderData);
+
+        // THEN -> QMatrix3x3 takes its values row by row, std140 stores columns
+        const int normalTransform = MetallicRoughnessBlock::NormalMapTextureTransform;
+        QCOMPARE(readFloat(block, normalTransform + 0), 1.0f);
+        QCOMPARE(readFloat(block, normalTransform + 4), 4.0f);
+        QCOMPARE(readFloat(block, normalTransform + 8), 7.0f);
+        QCOMPARE(readFloat(block, normalTransform + 12), 0.0f);
+        QCOMPARE(readFloat(block, normalTransform + 16), 2.0f);
+        QCOMPARE(readFloat(block, normalTransform + 32), 3.0f);
+        QCOMPARE(readFloat(block, normalTransform + 40), 9.0f);
+
+        QCOMPARE(readFloat(block, MetallicRoughnessBlock::BaseColorFactor + 0), 0.2f);
+        QCOMPARE(readFloat(block, MetallicRoughnessBlock::BaseColorFactor + 4), 0.4f);
+        QCOMPARE(readFloat(block, MetallicRoughnessBlock::BaseColorFactor + 8), 0.6f);
+        QCOMPARE(readFloat(block, MetallicRoughnessBlock::BaseColorFactor + 12), 1.0f);
+        QCOMPARE(readFloat(block, MetallicRoughnessBlock::MetallicFactor), 0.125f);
+        QCOMPARE(readFloat(block, MetallicRoughnessBlock::RoughnessFactor), 0.625f);
+        QCOMPARE(readFloat(block, MetallicRoughnessBlock::AlphaCutoff), 0.5f);
+        QCOMPARE(readInt(block, MetallicRoughnessBlock::AOUsesTexCoord1), 1);
+        QCOMPARE(readInt(block, MetallicRoughnessBlock::NormalUsesTexCoord1), 0);
+        QCOMPARE(readInt(block, MetallicRoughnessBlock::ReceivesShadows), 0);
+
+        // THEN -> kept up to date by the shader data
+        QCOMPARE(shaderData.block(), block);
+        QCOMPARE(shaderData.blockBuffer()->data(), block);
+    }
+
+    void checkBufferOnlyUpdatedOnChange()
+    {
+        // GIVEN
+        MetallicRoughnessShaderData shaderData;
+        QSignalSpy blockSpy(&shaderData, &MetallicRoughnessShaderData::blockChanged);
+        QSignalSpy bufferSpy(shaderData.blockBuffer(), &Qt3DGeometry::QBuffer::dataChanged);
+
+        // WHEN
+        shaderData.setNormalScale(shaderData.normalScale());
+        shaderData.setReceivesShadows(shaderData.receivesShadows());
+
+        // THEN
+        QCOMPARE(blockSpy.count(), 0);
+        QCOMPARE(bufferSpy.count(), 0);
+
+        // WHEN
+        shaderData.setNormalScale(2.0f);
+
+        // THEN
+        QCOMPARE(blockSpy.count(), 1);
+        QCOMPARE(bufferSpy.count(), 1);
+        QCOMPARE(readFloat(shaderData.blockBuffer()->data(), MetallicRoughnessBlock::NormalScale), 2.0f);
+    }
+
+    void checkTextureTransformChanges()
+    {
+        // GIVEN
+        MetallicRoughnessShaderData shaderData;
+        QSignalSpy transformSpy(&shaderData, &MetallicRoughnessShaderData::emissiveMapTextureTransformChanged);
+        QSignalSpy blockSpy(&shaderData, &MetallicRoughnessShaderData::blockChanged);
+        QMatrix3x3 transform;
+        transform(0, 2) = 0.5f;
+
+        // WHEN
+        shaderData.setEmissiveMapTextureTransform(transform);
+
+        // THEN
+        QCOMPARE(transformSpy.count(), 1);
+        QCOMPARE(blockSpy.count(), 1);
+        QCOMPARE(readFloat(shaderData.block(), MetallicRoughnessBlock::EmissiveMapTextureTransform + 32), 0.5f);
+    }
+
+    void checkMaterialParameters()
+    {
+        // GIVEN
+        MetallicRoughnessMaterial material;
+        MetallicRoughnessProperties properties;
+
+        // WHEN
+        material.setMaterialProperties(&properties);
+
+        // THEN -> GL 3 and ES 3 read the block, the shader data is only
+        // needed when an ES 2 context may be created
+        auto shaderData = static_cast<MetallicRoughnessShaderData *>(properties.shaderData());
+        Qt3DRender::QParameter *blockParameter = nullptr;
+        Qt3DRender::QParameter *shaderDataParameter = nullptr;
+        const auto parameters = material.parameters();
+        for (Qt3DRender::QParameter *parameter : parameters) {
+            if (parameter->name() == QLatin1String("MetallicRoughnessBlock"))
+                blockParameter = parameter;
+            else if (parameter->name() == QLatin1String("metallicRoughness"))
+                shaderDataParameter = parameter;
+        }
+        QVERIFY(blockParameter);
+        QCOMPARE(blockParameter->value().value<Qt3DGeometry::QBuffer *>(), shaderData->blockBuffer());
+        if (QOpenGLContext::openGLModuleType() == QOpenGLContext::LibGLES) {
+            QVERIFY(shaderDataParameter);
+            QCOMPARE(shaderDataParameter->value().value<Qt3DRender::QShaderData *>(), static_cast<Qt3DRender::QShaderData *>(shaderData));
+        } else {
+            QVERIFY(shaderDataParameter == nullptr);
+        }
+    }
+};
+
+QTEST_MAIN(tst_MetallicRoughnessBlock)
+#include "tst_metallicroughnessblock.moc"
@@ -309,6 +309,71 @@ private Q_SLOTS:
             QCOMPARE(ctrl.weight7(), 8.0f);
         }
     }
+    void checkWeightsBeyondEight()
+    {
+        // GIVEN
+        MorphController ctrl;
+        QSignalSpy spy(&ctrl, SIGNAL(morphWeightsChanged()));
+        QVERIFY(spy.isValid());
+
+        // WHEN
+        ctrl.setCount(40);
+
+        // THEN
+        QCOMPARE(ctrl.count(), 40);
+        QCOMPARE(ctrl.weights().size(), 40);
+        QCOMPARE(ctrl.weight(39), 0.0f);
+
+        // WHEN
+        ctrl.setWeight(3, 0.5f);
+        ctrl.setWeight(32, 0.25f);
+
+        // THEN
+        QCOMPARE(spy.count(), 2);
+        QCOMPARE(ctrl.weight3(), 0.5f);
+        QCOMPARE(ctrl.weight(3), 0.5f);
+        QCOMPARE(ctrl.weight(32), 0.25f);
+        QCOMPARE(ctrl.weights().at(32), 0.25f);
+
+        // WHEN
+        spy.clear();
+        ctrl.setWeight(32, 0.25f);
+        ctrl.setWeight(40, 1.0f);
+
+        // THEN
+        QCOMPARE(spy.count(), 0);
+        QCOMPARE(ctrl.weight(40), 0.0f);
+    }
+
+    void checkBatchedWeights()
+    {
+        // GIVEN
+        MorphController ctrl;
+        ctrl.setCount(20);
+        QSignalSpy spy(&ctrl, SIGNAL(morphWeightsChanged()));
+        QSignalSpy spy0(&ctrl, SIGNAL(weight0Changed(float)));
+        QVERIFY(spy.isValid());
+        QVERIFY(spy0.isValid());
+
+        QVector<float> weights(20, 0.0f);
+        weights[0] = 1.0f;
+        weights[10] = 0.5f;
+        weights[19] = 0.75f;
+
+        // WHEN
+        ctrl.setWeights(weights);
+
+        // THEN
+        QCOMPARE(spy.count(), 1);
+        QCOMPARE(spy0.count(), 1);
+        QCOMPARE(ctrl.weights(), weights);
+
+        // WHEN
+        ctrl.setWeights(weights);
+
+        // THEN
+        QCOMPARE(spy.count(), 1);
+    }
 };
 
 QTEST_APPLESS_MAIN(tst_MorphController)
@@ -0,0 +1,204 @@
+/*
+    tst_packedmorphtargets.cpp
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <QtTest/QTest>
+#include <Kuesa/MorphController>
+#include <Kuesa/private/packedmorphtargets_p.h>
+#include <Kuesa/private/morphtargetblender_p.h>
+#include <cstring>
+
+using namespace Kuesa;
+
+namespace {
+
+// 4 vertices, target 0 moves vertex 1, target 1 moves vertices 2 and 3
+PackedMorphTargetsPtr createMorphTargets()
+{
+    auto morphTargets = std::make_shared<PackedMorphTargets>(4, 2);
+    const float target0[] = {
+        0.0f, 0.0f, 0.0f,
+        1.0f, 0.0f, 0.0f,
+        0.0f, 0.0f, 0.0f,
+        0.0f, 0.0f, 0.0f
+    };
+    const float target1[] = {
+        0.0f, 0.0f, 0.0f,
+        0.0f, 0.0f, 0.0f,
+        0.0f, 2.0f, 0.0f,
+        0.0f, 0.0f, 3.0f
+    };
+    morphTargets->setTargetDeltas(0, PackedMorphTargets::Position, target0);
+    morphTargets->setTargetDeltas(1, PackedMorphTargets::Position, target1);
+    return morphTargets;
+}
+
+std::vector<float> toFloats(const QByteArray &data)
+{
+    std::vector<float> values(size_t(data.size()) / sizeof(float));
+    std::memcpy(values.data(), data.constData(), values.size() * sizeof(float));
+    return values;
+}
+
+} // namespace
+
+class tst_PackedMorphTargets : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+
+    void checkSparseStorage()
+    {
+        // GIVEN
+        const PackedMorphTargetsPtr morphTargets = createMorphTargets();
+
+        // THEN
+        QCOMPARE(morphTargets->vertexCount(), 4);
+        QCOMPARE(morphTargets->targetCount(), 2);
+        QVERIFY(morphTargets->hasChannel(PackedMorphTargets::Position));
+        QVERIFY(!morphTargets->hasChannel(PackedMorphTargets::Normal));
+        QCOMPARE(morphTargets->deltaCount(), size_t(3));
+        QCOMPARE(morphTargets->deltaCount(0, PackedMorphTargets::Position), size_t(1));
+        QCOMPARE(morphTargets->deltaCount(1, PackedMorphTargets::Position), size_t(2));
+        QCOMPARE(morphTargets->deltaCount(1, PackedMorphTargets::Normal), size_t(0));
+        QVERIFY(morphTargets->byteSize() < size_t(2 * 4 * 3 * sizeof(float)));
+    }
+
+    void checkAccumulate()
+    {
+        // GIVEN
+        const PackedMorphTargetsPtr morphTargets = createMorphTargets();
+        // 4 components per vertex, the 4th one must be left untouched
+        std::vector<float> data(16, 1.0f);
+
+        // WHEN
+        const float weights[] = { 0.0f, 0.5f };
+        const int evaluated = morphTargets->accumulate(PackedMorphTargets::Position,
+                                                       weights, 2, data.data(), 4);
+
+        // THEN
+        QCOMPARE(evaluated, 1);
+        QCOMPARE(data[4], 1.0f);
+        QCOMPARE(data[9], 2.0f);
+        QCOMPARE(data[14], 2.5f);
+        QCOMPARE(data[15], 1.0f);
+
+        // WHEN
+        const int evaluatedNormals = morphTargets->accumulate(PackedMorphTargets::Normal,
+                                                              weights, 2, data.data(), 4);
+
+        // THEN
+        QCOMPARE(evaluatedNormals, 0);
+    }
+
+    void checkVertexSpan()
+    {
+        // GIVEN
+        const PackedMorphTargetsPtr morphTargets = createMorphTargets();
+        int first = -1;
+        int last = -1;
+
+        // THEN
+        QVERIFY(morphTargets->vertexSpan(0, PackedMorphTargets::Position, &first, &last));
+        QCOMPARE(first, 1);
+        QCOMPARE(last, 1);
+        QVERIFY(morphTargets->vertexSpan(1, PackedMorphTargets::Position, &first, &last));
+        QCOMPARE(first, 2);
+        QCOMPARE(last, 3);
+        QVERIFY(!morphTargets->vertexSpan(1, PackedMorphTargets::Normal, &first, &last));
+        QVERIFY(!morphTargets->vertexSpan(2, PackedMorphTargets::Position, &first, &last));
+    }
+
+    void checkBlendIsBatched()
+    {
+        // GIVEN
+        MorphController controller;
+        controller.setCount(20);
+        Qt3DGeometry::QBuffer output;
+        MorphTargetBlender blender(createMorphTargets());
+        blender.setBaseData(PackedMorphTargets::Position, std::vector<float>(12, 0.0f), 3, &output);
+        blender.setMorphController(&controller);
+
+        // WHEN
+        QCoreApplication::processEvents();
+
+        // THEN
+        QCOMPARE(blender.blendCount(), 1);
+
+        // WHEN
+        controller.setWeight(0, 1.0f);
+        controller.setWeight(1, 1.0f);
+        controller.setWeight(15, 0.5f);
+        QCoreApplication::processEvents();
+
+        // THEN
+        QCOMPARE(blender.blendCount(), 2);
+        const std::vector<float> blended = toFloats(output.data());
+        QCOMPARE(blended.size(), size_t(12));
+        QCOMPARE(blended[3], 1.0f);
+        QCOMPARE(blended[7], 2.0f);
+        QCOMPARE(blended[11], 3.0f);
+
+        // WHEN
+        controller.setWeight(15, 0.5f);
+        blender.blend();
+
+        // THEN
+        QCOMPARE(blender.blendCount(), 2);
+
+        // WHEN -> only vertex 1 is updated
+        controller.setWeight(0, 0.5f);
+        blender.blend();
+
+        // THEN
+        // Only the target whose weight changed is blended
+        QCOMPARE(blender.blendCount(), 3);
+        QCOMPARE(blender.evaluatedTargetCount(), 1);
+        const std::vector<float> updated = toFloats(output.data());
+        QCOMPARE(updated.size(), size_t(12));
+        QCOMPARE(updated[3], 0.5f);
+        QCOMPARE(updated[7], 2.0f);
+        QCOMPARE(updated[11], 3.0f);
+
+        // WHEN
+        controller.setWeight(0, 0.0f);
+        controller.setWeight(1, -1.0f);
+        blender.blend();
+
+        // THEN
+        QCOMPARE(blender.evaluatedTargetCount(), 2);
+        const std::vector<float> reverted = toFloats(output.data());
+        QCOMPARE(reverted[3], 0.0f);
+        QCOMPARE(reverted[7], -2.0f);
+        QCOMPARE(reverted[11], -3.0f);
+    }
+};
+
+QTEST_MAIN(tst_PackedMorphTargets)
+
+#include "tst_packedmorphtargets.moc"
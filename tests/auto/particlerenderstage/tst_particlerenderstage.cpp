@@ -36,7 +36,9 @@
 #include <Qt3DRender/QDepthTest>
 #include <Qt3DRender/QMultiSampleAntiAliasing>
 #include <Qt3DRender/QNoDepthMask>
+#include <Qt3DRender/QParameter>
 #include <Kuesa/private/particlerenderstage_p.h>
+#include <Kuesa/private/particlesort_p.h>
 
 class tst_ParticleRenderStage : public QObject
 {
@@ -50,14 +52,13 @@ private Q_SLOTS:
 
         // THEN
         {
-            QCOMPARE(stages.children().size(), 4);
+            const std::vector<Kuesa::ParticleSort::Pass> sortPasses = Kuesa::ParticleSort::passes();
+            QCOMPARE(stages.children().size(), 3 + int(sortPasses.size()));
             Qt3DRender::QRenderPassFilter *emitPassFilter = qobject_cast<Qt3DRender::QRenderPassFilter *>(stages.children()[0]);
             Qt3DRender::QRenderPassFilter *simulatePassFilter = qobject_cast<Qt3DRender::QRenderPassFilter *>(stages.children()[1]);
-            Qt3DRender::QRenderPassFilter *sortPassFilter = qobject_cast<Qt3DRender::QRenderPassFilter *>(stages.children()[2]);
-            Qt3DRender::QRenderPassFilter *renderPassFilter = qobject_cast<Qt3DRender::QRenderPassFilter *>(stages.children()[3]);
+            Qt3DRender::QRenderPassFilter *renderPassFilter = qobject_cast<Qt3DRender::QRenderPassFilter *>(stages.children().last());
             QVERIFY(emitPassFilter);
             QVERIFY(simulatePassFilter);
-            QVERIFY(sortPassFilter);
             QVERIFY(renderPassFilter);
 
             {
@@ -89,11 +90,16 @@ private Q_SLOTS:
                 QCOMPARE(filter->name(), QStringLiteral("KuesaComputeStage"));
                 QCOMPARE(filter->value(), QStringLiteral("ParticleSimulate"));
             }
-            {
-                QCOMPARE(sortPassFilter->children().size(), 2);
+            for (size_t i = 0; i < sortPasses.size(); ++i) {
+                Qt3DRender::QRenderPassFilter *sortPassFilter = qobject_cast<Qt3DRender::QRenderPassFilter *>(stages.children()[2 + int(i)]);
+                QVERIFY(sortPassFilter);
+
+                QCOMPARE(sortPassFilter->children().size(), 5);
                 Qt3DRender::QFilterKey *filter = qobject_cast<Qt3DRender::QFilterKey *>(sortPassFilter->children().first());
-                Qt3DRender::QMemoryBarrier *barrier = qobject_cast<Qt3DRender::QMemoryBarrier *>(sortPassFilter->children()[1]);
+                Qt3DRender::QFilterKey *passFilter = qobject_cast<Qt3DRender::QFilterKey *>(sortPassFilter->children()[1]);
+                Qt3DRender::QMemoryBarrier *barrier = qobject_cast<Qt3DRender::QMemoryBarrier *>(sortPassFilter->children().last());
                 QVERIFY(filter);
+                QVERIFY(passFilter);
                 QVERIFY(barrier);
 
                 QCOMPARE(barrier->children().size(), 1);
@@ -101,10 +107,20 @@ private Q_SLOTS:
                 QVERIFY(compute);
                 QCOMPARE(barrier->waitOperations(), Qt3DRender::QMemoryBarrier::ShaderStorage);
 
-                QCOMPARE(sortPassFilter->matchAny().size(), 1);
+                QCOMPARE(sortPassFilter->matchAny().size(), 2);
                 QCOMPARE(sortPassFilter->matchAny().first(), filter);
+                QCOMPARE(sortPassFilter->matchAny().last(), passFilter);
                 QCOMPARE(filter->name(), QStringLiteral("KuesaComputeStage"));
                 QCOMPARE(filter->value(), QStringLiteral("ParticleSort"));
+                QCOMPARE(passFilter->name(), QStringLiteral("KuesaParticleSortPass"));
+                QCOMPARE(passFilter->value().toInt(), int(i));
+
+                const auto parameters = sortPassFilter->parameters();
+                QCOMPARE(parameters.size(), 2);
+                QCOMPARE(parameters[0]->name(), QStringLiteral("sortBlockSize"));
+                QCOMPARE(parameters[0]->value().toUInt(), sortPasses[i].blockSize);
+                QCOMPARE(parameters[1]->name(), QStringLiteral("sortStride"));
+                QCOMPARE(parameters[1]->value().toUInt(), sortPasses[i].stride);
             }
             {
                 QCOMPARE(renderPassFilter->children().size(), 2);
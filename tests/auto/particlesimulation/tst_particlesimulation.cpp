@@ -0,0 +1,428 @@
+/*
+    tst_particlesimulation.cpp
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <QtTest/QTest>
+#include <Kuesa/private/particlesimulation_p.h>
+#include <cmath>
+#include <cstring>
+
+using namespace Kuesa;
+
+namespace {
+
+bool fuzzyEqual(const QVector3D &a, const QVector3D &b, float epsilon = 1e-4f)
+{
+    return (a - b).length() <= epsilon;
+}
+
+ParticleSimulation::Parameters randomParameters()
+{
+    ParticleSimulation::Parameters parameters;
+    parameters.maxParticlesEmittedPerFrame = 64;
+    parameters.gravity = QVector3D(0.0f, -9.81f, 0.0f);
+    parameters.emitterPositionRandom = QVector3D(10.0f, 10.0f, 10.0f);
+    parameters.emitterVelocity = QVector3D(0.0f, 5.0f, 0.0f);
+    parameters.emitterVelocityRandom = QVector3D(1.0f, 2.0f, 1.0f);
+    parameters.particleLifespan = 2.0f;
+    parameters.particleLifespanRandom = 1.0f;
+    parameters.initialAngleRandom = 3.14f;
+    parameters.rotationRate = 1.0f;
+    parameters.rotationRateRandom = 0.5f;
+    return parameters;
+}
+
+std::vector<QVector3D> positions(const ParticleSimulation &simulation)
+{
+    std::vector<QVector3D> result;
+    for (int i = 0; i < simulation.particleCount(); ++i)
+        result.push_back(simulation.position(i));
+    return result;
+}
+
+} // namespace
+
+class tst_ParticleSimulation : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void checkDefaults()
+    {
+        // GIVEN
+        ParticleSimulation simulation;
+
+        // THEN
+        QCOMPARE(simulation.particleCount(), 0);
+        QCOMPARE(simulation.aliveCount(), 0);
+        QCOMPARE(simulation.seed(), 0U);
+        QVERIFY(simulation.threadCount() >= 1);
+
+        // WHEN
+        simulation.step(1.0f / 60.0f, QVector3D());
+
+        // THEN
+        QCOMPARE(simulation.aliveCount(), 0);
+    }
+
+    void checkEmission()
+    {
+        // GIVEN
+        ParticleSimulation simulation;
+        ParticleSimulation::Parameters parameters;
+        parameters.maxParticlesEmittedPerFrame = 4;
+        parameters.emitterPosition = QVector3D(1.0f, 2.0f, 3.0f);
+        parameters.particleLifespan = 10.0f;
+        simulation.setParameters(parameters);
+        simulation.setParticleCount(10);
+
+        // THEN
+        for (int i = 0; i < 10; ++i)
+            QVERIFY(!simulation.isAlive(i));
+
+        // WHEN
+        simulation.step(0.5f, QVector3D());
+
+        // THEN
+        QCOMPARE(simulation.aliveCount(), 4);
+        for (int i = 0; i < 4; ++i) {
+            QVERIFY(simulation.isAlive(i));
+            QVERIFY(fuzzyEqual(simulation.position(i), QVector3D(1.0f, 2.5f, 3.0f)));
+            QCOMPARE(simulation.lifespan(i), 10.0f);
+            QCOMPARE(simulation.age(i), 9.5f);
+        }
+
+        // WHEN
+        simulation.step(0.5f, QVector3D());
+        simulation.step(0.5f, QVector3D());
+
+        // THEN
+        // No more than particleCount particles
+        QCOMPARE(simulation.aliveCount(), 10);
+    }
+
+    void checkMotion()
+    {
+        // GIVEN
+        ParticleSimulation simulation;
+        ParticleSimulation::Parameters parameters;
+        parameters.maxParticlesEmittedPerFrame = 1;
+        parameters.gravity = QVector3D(0.0f, -10.0f, 0.0f);
+        parameters.emitterVelocity = QVector3D(2.0f, 5.0f, 0.0f);
+        parameters.particleLifespan = 100.0f;
+        simulation.setParameters(parameters);
+        simulation.setParticleCount(1);
+
+        // WHEN
+        const int stepCount = 30;
+        const float frameTime = 1.0f / 60.0f;
+        for (int i = 0; i < stepCount; ++i)
+            simulation.step(frameTime, QVector3D());
+
+        // THEN
+        // Position is moved by the velocity before gravity is applied
+        const float n = float(stepCount);
+        const QVector3D expectedPosition = n * frameTime * parameters.emitterVelocity
+                + frameTime * frameTime * parameters.gravity * n * (n - 1.0f) * 0.5f;
+        const QVector3D expectedVelocity = parameters.emitterVelocity + n * frameTime * parameters.gravity;
+        QVERIFY(fuzzyEqual(simulation.position(0), expectedPosition));
+        QVERIFY(fuzzyEqual(simulation.velocity(0), expectedVelocity));
+        QVERIFY(qAbs(simulation.age(0) - (100.0f - n * frameTime)) < 1e-4f);
+    }
+
+    void checkMotionOfEveryParticle()
+    {
+        // GIVEN
+        ParticleSimulation simulation;
+        ParticleSimulation::Parameters parameters;
+        parameters.maxParticlesEmittedPerFrame = 6;
+        parameters.gravity = QVector3D(0.0f, -10.0f, 0.0f);
+        parameters.emitterVelocity = QVector3D(2.0f, 5.0f, 0.0f);
+        parameters.particleLifespan = 100.0f;
+        parameters.rotationRate = 1.0f;
+        simulation.setParameters(parameters);
+        simulation.setParticleCount(6);
+
+        // WHEN
+        for (int i = 0; i < 10; ++i)
+            simulation.step(1.0f / 60.0f, QVector3D());
+
+        // THEN
+        // Particles updated 4 at a time match the remaining ones
+        for (int i = 1; i < 6; ++i) {
+            QCOMPARE(simulation.position(i), simulation.position(0));
+            QCOMPARE(simulation.velocity(i), simulation.velocity(0));
+            QCOMPARE(simulation.age(i), simulation.age(0));
+            QCOMPARE(simulation.rotation(i), simulation.rotation(0));
+        }
+    }
+
+    void checkRotation()
+    {
+        // GIVEN
+        ParticleSimulation simulation;
+        ParticleSimulation::Parameters parameters;
+        parameters.initialAngle = 1.0f;
+        parameters.rotationRate = 2.0f;
+        simulation.setParameters(parameters);
+        simulation.setParticleCount(1);
+
+        // WHEN
+        simulation.step(0.25f, QVector3D());
+
+        // THEN
+        QCOMPARE(simulation.rotation(0), 1.5f);
+    }
+
+    void checkLifespan()
+    {
+        // GIVEN
+        ParticleSimulation simulation;
+        ParticleSimulation::Parameters parameters;
+        parameters.particleLifespan = 0.1f;
+        simulation.setParameters(parameters);
+        simulation.setParticleCount(4);
+
+        // WHEN
+        std::vector<int> aliveCounts;
+        for (int i = 0; i < 5; ++i) {
+            simulation.step(0.04f, QVector3D());
+            aliveCounts.push_back(simulation.aliveCount());
+        }
+
+        // THEN
+        // Particles are drawn until they are found dead at the next step,
+        // then respawned at the following one
+        QVERIFY(aliveCounts == std::vector<int>({ 4, 4, 4, 0, 4 }));
+    }
+
+    void checkModelMatrix()
+    {
+        // GIVEN
+        ParticleSimulation simulation;
+        ParticleSimulation::Parameters parameters;
+        parameters.emitterPosition = QVector3D(1.0f, 0.0f, 0.0f);
+        parameters.emitterVelocity = QVector3D(1.0f, 0.0f, 0.0f);
+        parameters.particleLifespan = 10.0f;
+        parameters.modelMatrix.translate(10.0f, 0.0f, 0.0f);
+        parameters.modelMatrix.rotate(90.0f, 0.0f, 0.0f, 1.0f);
+        simulation.setParameters(parameters);
+        simulation.setParticleCount(1);
+
+        // WHEN
+        simulation.step(0.5f, QVector3D());
+
+        // THEN
+        QVERIFY(fuzzyEqual(simulation.velocity(0), QVector3D(0.0f, 1.0f, 0.0f)));
+        QVERIFY(fuzzyEqual(simulation.position(0), QVector3D(10.0f, 1.5f, 0.0f)));
+    }
+
+    void checkSortedBackToFront()
+    {
+        // GIVEN
+        ParticleSimulation simulation(883);
+        simulation.setParameters(randomParameters());
+        simulation.setParticleCount(256);
+        const QVector3D eyePosition(0.0f, 0.0f, 50.0f);
+
+        // WHEN
+        for (int i = 0; i < 10; ++i)
+            simulation.step(1.0f / 60.0f, eyePosition);
+
+        // THEN
+        const std::vector<quint32> &sorted = simulation.sortedParticles();
+        QCOMPARE(int(sorted.size()), simulation.aliveCount());
+        QCOMPARE(simulation.aliveCount(), 256);
+        for (size_t i = 1; i < sorted.size(); ++i) {
+            const float previousDistance = (simulation.position(int(sorted[i - 1])) - eyePosition).length();
+            const float distance = (simulation.position(int(sorted[i])) - eyePosition).length();
+            QVERIFY(previousDistance >= distance - 1e-4f);
+        }
+    }
+
+    void checkVertices()
+    {
+        // GIVEN
+        ParticleSimulation simulation;
+        ParticleSimulation::Parameters parameters;
+        parameters.emitterVelocity = QVector3D(0.0f, 0.0f, 4.0f);
+        parameters.particleLifespan = 1.0f;
+        parameters.initialAngle = 0.5f;
+        parameters.initialSize = QVector2D(1.0f, 1.0f);
+        parameters.finalSize = QVector2D(3.0f, 5.0f);
+        parameters.initialColor = QVector4D(1.0f, 0.0f, 0.0f, 1.0f);
+        parameters.finalColor = QVector4D(0.0f, 1.0f, 0.0f, 0.0f);
+        simulation.setParameters(parameters);
+        simulation.setParticleCount(1);
+
+        // WHEN
+        simulation.step(0.25f, QVector3D());
+        std::vector<ParticleSimulation::Vertex> vertices(size_t(simulation.aliveCount()));
+        simulation.writeVertices(vertices.data());
+
+        // THEN
+        QCOMPARE(vertices.size(), size_t(1));
+        const ParticleSimulation::Vertex &v = vertices.front();
+        QCOMPARE(v.position[2], 1.0f);
+        QCOMPARE(v.velocity[2], 4.0f);
+        QCOMPARE(v.rotation, 0.5f);
+        // A quarter of the lifespan
+        QCOMPARE(v.size[0], 1.5f);
+        QCOMPARE(v.size[1], 2.0f);
+        QCOMPARE(v.color[0], 0.75f);
+        QCOMPARE(v.color[1], 0.25f);
+        QCOMPARE(v.color[2], 0.0f);
+        QCOMPARE(v.color[3], 0.75f);
+    }
+
+    void checkZeroLifespanVertices()
+    {
+        // GIVEN
+        ParticleSimulation simulation;
+        ParticleSimulation::Parameters parameters;
+        parameters.particleLifespan = 0.0f;
+        parameters.initialSize = QVector2D(1.0f, 1.0f);
+        parameters.finalSize = QVector2D(3.0f, 5.0f);
+        simulation.setParameters(parameters);
+        simulation.setParticleCount(1);
+
+        // WHEN
+        simulation.step(0.0f, QVector3D());
+        std::vector<ParticleSimulation::Vertex> vertices(size_t(simulation.aliveCount()));
+        simulation.writeVertices(vertices.data());
+
+        // THEN
+        // Drawn at the end of its life rather than with a NaN size
+        QCOMPARE(vertices.size(), size_t(1));
+        QCOMPARE(vertices.front().size[0], 3.0f);
+        QCOMPARE(vertices.front().size[1], 5.0f);
+    }
+
+    void checkDeterministic()
+    {
+        // GIVEN
+        ParticleSimulation a(42);
+        ParticleSimulation b(42);
+        ParticleSimulation c(43);
+        for (ParticleSimulation *simulation : { &a, &b, &c }) {
+            simulation->setParameters(randomParameters());
+            simulation->setParticleCount(512);
+        }
+
+        // WHEN
+        for (int i = 0; i < 60; ++i) {
+            for (ParticleSimulation *simulation : { &a, &b, &c })
+                simulation->step(1.0f / 60.0f, QVector3D(0.0f, 0.0f, 20.0f));
+        }
+
+        // THEN
+        QVERIFY(positions(a) == positions(b));
+        QVERIFY(a.sortedParticles() == b.sortedParticles());
+        QVERIFY(positions(a) != positions(c));
+
+        // WHEN
+        a.reset();
+        for (int i = 0; i < 60; ++i)
+            a.step(1.0f / 60.0f, QVector3D(0.0f, 0.0f, 20.0f));
+
+        // THEN
+        QVERIFY(positions(a) == positions(b));
+    }
+
+    void checkThreadCountDoesNotChangeResults()
+    {
+        // GIVEN
+        ParticleSimulation singleThreaded(7);
+        ParticleSimulation multiThreaded(7);
+        singleThreaded.setThreadCount(1);
+        multiThreaded.setThreadCount(4);
+        for (ParticleSimulation *simulation : { &singleThreaded, &multiThreaded }) {
+            ParticleSimulation::Parameters parameters = randomParameters();
+            parameters.maxParticlesEmittedPerFrame = 4096;
+            simulation->setParameters(parameters);
+            simulation->setParticleCount(20000);
+        }
+
+        // WHEN
+        for (int i = 0; i < 10; ++i) {
+            singleThreaded.step(1.0f / 60.0f, QVector3D());
+            multiThreaded.step(1.0f / 60.0f, QVector3D());
+        }
+        std::vector<ParticleSimulation::Vertex> singleThreadedVertices(size_t(singleThreaded.aliveCount()));
+        std::vector<ParticleSimulation::Vertex> multiThreadedVertices(size_t(multiThreaded.aliveCount()));
+        singleThreaded.writeVertices(singleThreadedVertices.data());
+        multiThreaded.writeVertices(multiThreadedVertices.data());
+
+        // THEN
+        QCOMPARE(multiThreaded.threadCount(), 4);
+        QCOMPARE(singleThreaded.aliveCount(), 20000);
+        QVERIFY(positions(singleThreaded) == positions(multiThreaded));
+        QVERIFY(singleThreaded.sortedParticles() == multiThreaded.sortedParticles());
+        QVERIFY(std::memcmp(singleThreadedVertices.data(), multiThreadedVertices.data(),
+                            singleThreadedVertices.size() * sizeof(ParticleSimulation::Vertex)) == 0);
+    }
+
+    void benchmarkStep_data()
+    {
+        QTest::addColumn<int>("particleCount");
+        QTest::addColumn<int>("threadCount");
+
+        QTest::newRow("2048 particles") << 2048 << 1;
+        QTest::newRow("16384 particles") << 16384 << 1;
+        QTest::newRow("16384 particles, all threads") << 16384 << 0;
+        QTest::newRow("131072 particles") << 131072 << 1;
+        QTest::newRow("131072 particles, all threads") << 131072 << 0;
+    }
+
+    void benchmarkStep()
+    {
+        // GIVEN
+        QFETCH(int, particleCount);
+        QFETCH(int, threadCount);
+        ParticleSimulation simulation(1);
+        ParticleSimulation::Parameters parameters = randomParameters();
+        parameters.maxParticlesEmittedPerFrame = particleCount / 64;
+        simulation.setParameters(parameters);
+        simulation.setParticleCount(particleCount);
+        simulation.setThreadCount(threadCount);
+        std::vector<ParticleSimulation::Vertex> vertices(size_t(particleCount));
+
+        // Fill the system
+        for (int i = 0; i < 64; ++i)
+            simulation.step(1.0f / 60.0f, QVector3D(0.0f, 0.0f, 20.0f));
+
+        // WHEN
+        QBENCHMARK {
+            simulation.step(1.0f / 60.0f, QVector3D(0.0f, 0.0f, 20.0f));
+            simulation.writeVertices(vertices.data());
+        }
+    }
+};
+
+QTEST_MAIN(tst_ParticleSimulation)
+
+#include "tst_particlesimulation.moc"
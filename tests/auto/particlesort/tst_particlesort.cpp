@@ -0,0 +1,214 @@
+/*
+    tst_particlesort.cpp
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <QtTest/QTest>
+#include <Kuesa/private/particlesort_p.h>
+#include <algorithm>
+#include <limits>
+#include <random>
+
+using namespace Kuesa;
+
+namespace {
+
+const float DeadDistance = -std::numeric_limits<float>::max();
+
+// Distances drawn from a small range so that many keys tie, with one
+// particle out of deadRatio dead
+std::vector<QVector2D> randomKeys(int count, int deadRatio, quint32 seed)
+{
+    std::mt19937 generator(seed);
+    std::uniform_int_distribution<int> distance(0, 100);
+    std::vector<QVector2D> keys;
+    keys.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        const bool dead = deadRatio > 0 && i % deadRatio == 0;
+        keys.emplace_back(dead ? DeadDistance : float(distance(generator)) * 0.5f,
+                          dead ? -1.0f : float(i));
+    }
+    return keys;
+}
+
+std::vector<float> sortedIndices(const std::vector<QVector2D> &keys)
+{
+    std::vector<float> indices;
+    indices.reserve(keys.size());
+    for (const QVector2D &key : keys)
+        indices.push_back(key.y());
+    std::sort(indices.begin(), indices.end());
+    return indices;
+}
+
+} // namespace
+
+class tst_ParticleSort : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+
+    void checkSortSize()
+    {
+        QCOMPARE(ParticleSort::sortSize(0), 0);
+        QCOMPARE(ParticleSort::sortSize(1), 1);
+        QCOMPARE(ParticleSort::sortSize(2), 2);
+        QCOMPARE(ParticleSort::sortSize(3), 4);
+        QCOMPARE(ParticleSort::sortSize(2048), 2048);
+        QCOMPARE(ParticleSort::sortSize(2049), 4096);
+        QCOMPARE(ParticleSort::sortSize(ParticleSort::MaxParticleCount), ParticleSort::MaxParticleCount);
+    }
+
+    void checkPasses()
+    {
+        {
+            // WHEN
+            const std::vector<ParticleSort::Pass> passes = ParticleSort::passes(ParticleSort::LocalSortSize);
+
+            // THEN -> a single shared memory sort
+            QCOMPARE(passes.size(), size_t(1));
+            QCOMPARE(passes[0].blockSize, 0U);
+            QCOMPARE(passes[0].stride, 0U);
+        }
+        {
+            // WHEN
+            const std::vector<ParticleSort::Pass> passes = ParticleSort::passes(4 * ParticleSort::LocalSortSize);
+
+            // THEN -> shared memory sort, then for blocks of 4096 and 8192
+            // keys the global steps followed by a shared memory merge
+            QCOMPARE(passes.size(), size_t(6));
+            QCOMPARE(passes[0].blockSize, 0U);
+            QCOMPARE(passes[1].blockSize, 4096U);
+            QCOMPARE(passes[1].stride, 2048U);
+            QCOMPARE(passes[2].blockSize, 4096U);
+            QCOMPARE(passes[2].stride, 1024U);
+            QCOMPARE(passes[3].blockSize, 8192U);
+            QCOMPARE(passes[3].stride, 4096U);
+            QCOMPARE(passes[4].blockSize, 8192U);
+            QCOMPARE(passes[4].stride, 2048U);
+            QCOMPARE(passes[5].blockSize, 8192U);
+            QCOMPARE(passes[5].stride, 1024U);
+        }
+        {
+            // WHEN
+            const std::vector<ParticleSort::Pass> passes = ParticleSort::passes();
+
+            // THEN
+            QCOMPARE(passes.size(), size_t(21));
+            QCOMPARE(passes.back().blockSize, quint32(ParticleSort::MaxParticleCount));
+        }
+        {
+            // WHEN
+            const std::vector<ParticleSort::Pass> allPasses = ParticleSort::passes();
+
+            // THEN -> the passes of smaller counts match the first sort stages
+            for (int particleCount = 1; particleCount <= ParticleSort::MaxParticleCount; particleCount <<= 1) {
+                const std::vector<ParticleSort::Pass> passes = ParticleSort::passes(particleCount);
+                QVERIFY(passes.size() <= allPasses.size());
+                for (size_t i = 0; i < passes.size(); ++i) {
+                    QCOMPARE(passes[i].blockSize, allPasses[i].blockSize);
+                    QCOMPARE(passes[i].stride, allPasses[i].stride);
+                }
+            }
+        }
+    }
+
+    void checkBitonicSort_data()
+    {
+        QTest::addColumn<int>("particleCount");
+        QTest::addColumn<int>("deadRatio");
+
+        QTest::newRow("0") << 0 << 0;
+        QTest::newRow("1") << 1 << 0;
+        QTest::newRow("3") << 3 << 0;
+        QTest::newRow("32") << 32 << 3;
+        QTest::newRow("1000") << 1000 << 0;
+        QTest::newRow("2048") << 2048 << 5;
+        QTest::newRow("2049") << 2049 << 5;
+        QTest::newRow("5000") << 5000 << 0;
+        QTest::newRow("12345") << 12345 << 7;
+        QTest::newRow("65536") << 65536 << 4;
+    }
+
+    void checkBitonicSort()
+    {
+        // GIVEN
+        QFETCH(int, particleCount);
+        QFETCH(int, deadRatio);
+        const std::vector<QVector2D> keys = randomKeys(particleCount, deadRatio, 0xc0ffeeU + quint32(particleCount));
+
+        // WHEN
+        std::vector<QVector2D> sorted = keys;
+        ParticleSort::bitonicSort(sorted);
+        std::vector<QVector2D> reference = keys;
+        ParticleSort::referenceSort(reference);
+
+        // THEN -> same distances in the same order as the reference, ties
+        // may come in any order but no particle is lost or duplicated
+        QCOMPARE(sorted.size(), reference.size());
+        for (size_t i = 0; i < sorted.size(); ++i)
+            QCOMPARE(sorted[i].x(), reference[i].x());
+        QVERIFY(sortedIndices(sorted) == sortedIndices(keys));
+    }
+
+    void checkDeadParticlesSortLast()
+    {
+        // GIVEN
+        const std::vector<QVector2D> keys = randomKeys(3000, 2, 42);
+
+        // WHEN
+        std::vector<QVector2D> sorted = keys;
+        ParticleSort::bitonicSort(sorted);
+
+        // THEN
+        const auto firstDead = std::find_if(sorted.begin(), sorted.end(), [](const QVector2D &key) {
+            return key.y() < 0.0f;
+        });
+        QCOMPARE(int(std::distance(sorted.begin(), firstDead)), 1500);
+        QVERIFY(std::all_of(firstDead, sorted.end(), [](const QVector2D &key) {
+            return key.x() == DeadDistance && key.y() < 0.0f;
+        }));
+    }
+
+    void checkCountAboveMaximumIsNotSorted()
+    {
+        // GIVEN
+        const std::vector<QVector2D> keys = randomKeys(4 * ParticleSort::LocalSortSize, 0, 7);
+
+        // WHEN -> not enough passes to merge the whole buffer
+        std::vector<QVector2D> sorted = keys;
+        ParticleSort::bitonicSort(sorted, 2 * ParticleSort::LocalSortSize);
+
+        // THEN
+        QVERIFY(!std::is_sorted(sorted.begin(), sorted.end(), [](const QVector2D &a, const QVector2D &b) {
+            return a.x() > b.x();
+        }));
+    }
+};
+
+QTEST_MAIN(tst_ParticleSort)
+#include "tst_particlesort.moc"
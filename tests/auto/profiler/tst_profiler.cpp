@@ -0,0 +1,305 @@
+/*
+    tst_profiler.cpp
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <qtkuesa-config.h>
+#include <QtTest/QTest>
+#include <QtTest/QSignalSpy>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTemporaryDir>
+#include <Kuesa/GLTF2Importer>
+#include <Kuesa/SceneEntity>
+#include <Kuesa/ProfilingModel>
+#include <Kuesa/private/profiler_p.h>
+#include <algorithm>
+#include <cstring>
+
+using namespace Kuesa;
+
+namespace {
+
+bool hasEvent(const std::vector<Profiler::Event> &events, const char *category, const char *name)
+{
+    return std::any_of(events.begin(), events.end(), [&](const Profiler::Event &e) {
+        return std::strcmp(e.category, category) == 0 && std::strcmp(e.name, name) == 0;
+    });
+}
+
+qint64 counterValue(const std::vector<Profiler::Counter> &counters, const char *category, const char *name)
+{
+    for (const Profiler::Counter &c : counters) {
+        if (std::strcmp(c.category, category) == 0 && std::strcmp(c.name, name) == 0)
+            return c.value;
+    }
+    return -1;
+}
+
+} // namespace
+
+class tst_Profiler : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+
+    void init()
+    {
+        Profiler::setEnabled(true);
+        Profiler::instance()->setCapacity(4096);
+        Profiler::instance()->clear();
+    }
+
+    void cleanup()
+    {
+        Profiler::setEnabled(false);
+        Profiler::instance()->clear();
+    }
+
+    void checkDisabled()
+    {
+        // GIVEN
+        Profiler *profiler = Profiler::instance();
+        Profiler::setEnabled(false);
+        const quint64 revision = profiler->revision();
+
+        // WHEN
+        {
+            ProfilerScope scope("test", "scope");
+            Profiler::count("test", "counter");
+        }
+
+        // THEN
+        QVERIFY(profiler->events().empty());
+        QVERIFY(profiler->counters().empty());
+        QCOMPARE(profiler->revision(), revision);
+    }
+
+    void checkScopes()
+    {
+        // GIVEN
+        Profiler *profiler = Profiler::instance();
+
+        // WHEN
+        {
+            ProfilerScope outer("test", "outer");
+            ProfilerScope inner("test", "inner");
+        }
+
+        // THEN
+        const std::vector<Profiler::Event> events = profiler->events();
+        QCOMPARE(events.size(), size_t(2));
+        // Inner scope is destroyed first
+        QCOMPARE(events[0].name, "inner");
+        QCOMPARE(events[1].name, "outer");
+        QCOMPARE(events[1].category, "test");
+        QVERIFY(events[0].start >= events[1].start);
+        QVERIFY(events[0].duration >= 0);
+        QVERIFY(events[1].duration >= events[0].duration);
+    }
+
+    void checkRingBuffer()
+    {
+        // GIVEN
+        Profiler *profiler = Profiler::instance();
+        profiler->setCapacity(4);
+        static const char *names[] = { "0", "1", "2", "3", "4", "5" };
+
+        // WHEN
+        for (const char *name : names)
+            profiler->addEvent("test", name, 0, 1);
+
+        // THEN -> only the most recent events are kept, oldest first
+        std::vector<Profiler::Event> events = profiler->events();
+        QCOMPARE(profiler->capacity(), 4);
+        QCOMPARE(events.size(), size_t(4));
+        QCOMPARE(events.front().name, "2");
+        QCOMPARE(events.back().name, "5");
+
+        // WHEN
+        profiler->setCapacity(2);
+
+        // THEN
+        events = profiler->events();
+        QCOMPARE(events.size(), size_t(2));
+        QCOMPARE(events.front().name, "4");
+        QCOMPARE(events.back().name, "5");
+
+        // WHEN
+        profiler->clear();
+
+        // THEN
+        QVERIFY(profiler->events().empty());
+        QCOMPARE(profiler->capacity(), 2);
+    }
+
+    void checkCounters()
+    {
+        // GIVEN
+        Profiler *profiler = Profiler::instance();
+
+        // WHEN
+        Profiler::count("test", "a");
+        Profiler::count("test", "a", 4);
+        Profiler::count("test", "b", -2);
+
+        // THEN
+        const std::vector<Profiler::Counter> counters = profiler->counters();
+        QCOMPARE(counters.size(), size_t(2));
+        QCOMPARE(counterValue(counters, "test", "a"), qint64(5));
+        QCOMPARE(counterValue(counters, "test", "b"), qint64(-2));
+    }
+
+    void checkChromeTrace()
+    {
+        // GIVEN
+        Profiler *profiler = Profiler::instance();
+        profiler->addEvent("test", "scope", 2000, 3000);
+        Profiler::count("test", "counter", 3);
+
+        // WHEN
+        const QJsonDocument doc = QJsonDocument::fromJson(profiler->toChromeTrace());
+
+        // THEN
+        QVERIFY(doc.isObject());
+        const QJsonArray traceEvents = doc.object().value(QStringLiteral("traceEvents")).toArray();
+        QCOMPARE(traceEvents.size(), 2);
+
+        const QJsonObject scope = traceEvents.at(0).toObject();
+        QCOMPARE(scope.value(QStringLiteral("ph")).toString(), QStringLiteral("X"));
+        QCOMPARE(scope.value(QStringLiteral("cat")).toString(), QStringLiteral("test"));
+        QCOMPARE(scope.value(QStringLiteral("name")).toString(), QStringLiteral("scope"));
+        QCOMPARE(scope.value(QStringLiteral("ts")).toDouble(), 2.0);
+        QCOMPARE(scope.value(QStringLiteral("dur")).toDouble(), 3.0);
+
+        const QJsonObject counter = traceEvents.at(1).toObject();
+        QCOMPARE(counter.value(QStringLiteral("ph")).toString(), QStringLiteral("C"));
+        QCOMPARE(counter.value(QStringLiteral("name")).toString(), QStringLiteral("test"));
+        QCOMPARE(counter.value(QStringLiteral("args")).toObject().value(QStringLiteral("counter")).toInt(), 3);
+    }
+
+    void checkHeadlessLoad()
+    {
+        // GIVEN
+        Profiler *profiler = Profiler::instance();
+        SceneEntity scene;
+        GLTF2Importer importer;
+        importer.setSceneEntity(&scene);
+
+        // WHEN
+        importer.setSource(QUrl("file:///" ASSETS "Box.gltf"));
+        QCoreApplication::processEvents();
+
+        // THEN
+        QCOMPARE(importer.status(), GLTF2Importer::Ready);
+        const std::vector<Profiler::Event> events = profiler->events();
+        QVERIFY(hasEvent(events, "importer", "parseJSON"));
+        QVERIFY(hasEvent(events, "importer", "generateContent"));
+        QVERIFY(hasEvent(events, "importer", "entitiesAndJointsGraph"));
+        QVERIFY(hasEvent(events, "importer", "treeNodeContent"));
+        QVERIFY(hasEvent(events, "importer", "sceneRoots"));
+        QVERIFY(hasEvent(events, "importer", "addToCollections"));
+        QVERIFY(counterValue(profiler->counters(), "collections", "add") > 0);
+    }
+
+    void checkModel()
+    {
+        // GIVEN
+        ProfilingModel model;
+        QSignalSpy countSpy(&model, &ProfilingModel::countChanged);
+        model.setRefreshInterval(0);
+
+        // THEN
+        QVERIFY(model.isEnabled());
+        QCOMPARE(model.refreshInterval(), 0);
+        QCOMPARE(model.count(), 0);
+
+        // WHEN
+        Profiler::instance()->addEvent("test", "scope", 0, 2000000);
+        Profiler::instance()->addEvent("test", "scope", 0, 4000000);
+        Profiler::count("test", "counter", 7);
+        model.refresh();
+
+        // THEN
+        QCOMPARE(countSpy.count(), 1);
+        QCOMPARE(model.rowCount(), 2);
+
+        const QModelIndex timer = model.index(0);
+        QCOMPARE(timer.data(ProfilingModel::NameRole).toString(), QStringLiteral("scope"));
+        QCOMPARE(timer.data(ProfilingModel::CategoryRole).toString(), QStringLiteral("test"));
+        QCOMPARE(timer.data(ProfilingModel::KindRole).toInt(), int(ProfilingModel::Timer));
+        QCOMPARE(timer.data(ProfilingModel::CountRole).toInt(), 2);
+        QCOMPARE(timer.data(ProfilingModel::TotalTimeRole).toDouble(), 6.0);
+        QCOMPARE(timer.data(ProfilingModel::AverageTimeRole).toDouble(), 3.0);
+        QCOMPARE(timer.data(ProfilingModel::MaxTimeRole).toDouble(), 4.0);
+        QCOMPARE(timer.data(ProfilingModel::LastTimeRole).toDouble(), 4.0);
+
+        const QModelIndex counter = model.index(1);
+        QCOMPARE(counter.data(ProfilingModel::NameRole).toString(), QStringLiteral("counter"));
+        QCOMPARE(counter.data(ProfilingModel::KindRole).toInt(), int(ProfilingModel::Counter));
+        QCOMPARE(counter.data(ProfilingModel::ValueRole).toLongLong(), qint64(7));
+
+        // WHEN -> same rows, updated values
+        QSignalSpy dataSpy(&model, &ProfilingModel::dataChanged);
+        Profiler::count("test", "counter");
+        model.refresh();
+
+        // THEN
+        QCOMPARE(countSpy.count(), 1);
+        QCOMPARE(dataSpy.count(), 1);
+        QCOMPARE(model.index(1).data(ProfilingModel::ValueRole).toLongLong(), qint64(8));
+
+        // WHEN
+        model.clear();
+
+        // THEN
+        QCOMPARE(countSpy.count(), 2);
+        QCOMPARE(model.count(), 0);
+    }
+
+    void checkExport()
+    {
+        // GIVEN
+        ProfilingModel model;
+        QTemporaryDir dir;
+        const QString fileName = dir.filePath(QStringLiteral("trace.json"));
+        Profiler::instance()->addEvent("test", "scope", 0, 1000);
+
+        // WHEN
+        const bool exported = model.exportChromeTrace(fileName);
+
+        // THEN
+        QVERIFY(exported);
+        QFile f(fileName);
+        QVERIFY(f.open(QIODevice::ReadOnly));
+        QCOMPARE(f.readAll(), model.chromeTrace());
+    }
+};
+
+QTEST_MAIN(tst_Profiler)
+
+#include "tst_profiler.moc"
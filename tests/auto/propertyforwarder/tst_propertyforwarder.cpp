@@ -0,0 +1,320 @@
+/*
+    tst_propertyforwarder.cpp
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <QtTest/QTest>
+#include <QColor>
+#include <QMatrix4x4>
+#include <QVector3D>
+#include <Kuesa/private/propertyforwarder_p.h>
+
+using namespace Kuesa;
+
+// Stands for an Asset extended in QML
+class Source : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(double aspectRatio READ aspectRatio WRITE setAspectRatio NOTIFY aspectRatioChanged)
+    Q_PROPERTY(QVector3D position READ position WRITE setPosition NOTIFY positionChanged)
+    Q_PROPERTY(QColor color READ color WRITE setColor NOTIFY colorChanged)
+    Q_PROPERTY(QString name READ name WRITE setName NOTIFY nameChanged)
+    Q_PROPERTY(double fieldOfView READ fieldOfView NOTIFY fieldOfViewChanged)
+    Q_PROPERTY(bool missing READ missing CONSTANT)
+public:
+    double aspectRatio() const { return m_aspectRatio; }
+    QVector3D position() const { return m_position; }
+    QColor color() const { return m_color; }
+    QString name() const { return m_name; }
+    double fieldOfView() const { return 45.0; }
+    bool missing() const { return false; }
+
+    void setAspectRatio(double aspectRatio)
+    {
+        if (m_aspectRatio != aspectRatio) {
+            m_aspectRatio = aspectRatio;
+            emit aspectRatioChanged();
+        }
+    }
+    void setPosition(const QVector3D &position)
+    {
+        if (m_position != position) {
+            m_position = position;
+            emit positionChanged();
+        }
+    }
+    void setColor(const QColor &color)
+    {
+        if (m_color != color) {
+            m_color = color;
+            emit colorChanged();
+        }
+    }
+    void setName(const QString &name)
+    {
+        if (m_name != name) {
+            m_name = name;
+            emit nameChanged();
+        }
+    }
+
+Q_SIGNALS:
+    void aspectRatioChanged();
+    void positionChanged();
+    void colorChanged();
+    void nameChanged();
+    void fieldOfViewChanged();
+
+private:
+    double m_aspectRatio = 1.0;
+    QVector3D m_position;
+    QColor m_color;
+    QString m_name;
+};
+
+// Stands for a node
+class Target : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(float aspectRatio READ aspectRatio WRITE setAspectRatio NOTIFY aspectRatioChanged)
+    Q_PROPERTY(QVector3D position READ position WRITE setPosition NOTIFY positionChanged)
+    Q_PROPERTY(QColor color READ color WRITE setColor NOTIFY colorChanged)
+    Q_PROPERTY(QString name READ name WRITE setName NOTIFY nameChanged)
+    Q_PROPERTY(float fieldOfView READ fieldOfView WRITE setFieldOfView NOTIFY fieldOfViewChanged)
+public:
+    float aspectRatio() const { return m_aspectRatio; }
+    QVector3D position() const { return m_position; }
+    QColor color() const { return m_color; }
+    QString name() const { return m_name; }
+    float fieldOfView() const { return m_fieldOfView; }
+
+    void setAspectRatio(float aspectRatio)
+    {
+        ++aspectRatioWrites;
+        if (m_aspectRatio != aspectRatio) {
+            m_aspectRatio = aspectRatio;
+            emit aspectRatioChanged(aspectRatio);
+        }
+    }
+    void setPosition(const QVector3D &position)
+    {
+        if (m_position != position) {
+            m_position = position;
+            emit positionChanged(position);
+        }
+    }
+    void setColor(const QColor &color)
+    {
+        if (m_color != color) {
+            m_color = color;
+            emit colorChanged(color);
+        }
+    }
+    void setName(const QString &name)
+    {
+        if (m_name != name) {
+            m_name = name;
+            emit nameChanged(name);
+        }
+    }
+    void setFieldOfView(float fieldOfView)
+    {
+        if (m_fieldOfView != fieldOfView) {
+            m_fieldOfView = fieldOfView;
+            emit fieldOfViewChanged(fieldOfView);
+        }
+    }
+
+    int aspectRatioWrites = 0;
+
+Q_SIGNALS:
+    void aspectRatioChanged(float aspectRatio);
+    void positionChanged(const QVector3D &position);
+    void colorChanged(const QColor &color);
+    void nameChanged(const QString &name);
+    void fieldOfViewChanged(float fieldOfView);
+
+private:
+    float m_aspectRatio = 2.0f;
+    QVector3D m_position = QVector3D(1.0f, 2.0f, 3.0f);
+    QColor m_color = QColor(51, 102, 153);
+    QString m_name = QStringLiteral("node");
+    float m_fieldOfView = 60.0f;
+};
+
+class tst_PropertyForwarder : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+
+    void checkCopier()
+    {
+        // THEN
+        QVERIFY(PropertyForwarder::copier(QMetaType::Bool, QMetaType::Bool) != nullptr);
+        QVERIFY(PropertyForwarder::copier(QMetaType::Float, QMetaType::Float) != nullptr);
+        QVERIFY(PropertyForwarder::copier(QMetaType::Double, QMetaType::Float) != nullptr);
+        QVERIFY(PropertyForwarder::copier(QMetaType::Float, QMetaType::Double) != nullptr);
+        QVERIFY(PropertyForwarder::copier(QMetaType::QVector3D, QMetaType::QVector3D) != nullptr);
+        QVERIFY(PropertyForwarder::copier(QMetaType::QColor, QMetaType::QColor) != nullptr);
+        QVERIFY(PropertyForwarder::copier(QMetaType::QMatrix4x4, QMetaType::QMatrix4x4) != nullptr);
+        QVERIFY(PropertyForwarder::copier(QMetaType::QString, QMetaType::QString) == nullptr);
+        QVERIFY(PropertyForwarder::copier(QMetaType::Int, QMetaType::Float) == nullptr);
+    }
+
+    void checkTable()
+    {
+        // WHEN
+        const PropertyForwarder::Table *table = PropertyForwarder::table(&Source::staticMetaObject, &Target::staticMetaObject);
+
+        // THEN
+        // objectName is inherited and missing isn't a Target property
+        QVERIFY(table != nullptr);
+        QCOMPARE(int(table->bindings.size()), 5);
+        QCOMPARE(PropertyForwarder::table(&Source::staticMetaObject, &Target::staticMetaObject), table);
+        QCOMPARE(int(table->sourceSignals.size()), 5);
+        QCOMPARE(int(table->targetSignals.size()), 5);
+
+        const PropertyForwarder::Binding &aspectRatio = table->bindings.front();
+        QCOMPARE(aspectRatio.sourceIndex, Source::staticMetaObject.indexOfProperty("aspectRatio"));
+        QCOMPARE(aspectRatio.targetIndex, Target::staticMetaObject.indexOfProperty("aspectRatio"));
+        QVERIFY(aspectRatio.sourceWritable);
+        QVERIFY(aspectRatio.targetWritable);
+
+        const PropertyForwarder::Binding &fieldOfView = table->bindings.back();
+        QVERIFY(!fieldOfView.sourceWritable);
+        QVERIFY(fieldOfView.targetWritable);
+    }
+
+    void checkInitialSync()
+    {
+        // GIVEN
+        Source source;
+        Target target;
+        PropertyForwarder forwarder;
+
+        // WHEN
+        forwarder.setObjects(&source, &target);
+
+        // THEN
+        // Writable source properties are initialized from the target
+        QCOMPARE(forwarder.bindingCount(), 5);
+        QCOMPARE(source.aspectRatio(), 2.0);
+        QCOMPARE(source.position(), QVector3D(1.0f, 2.0f, 3.0f));
+        QCOMPARE(source.color(), QColor(51, 102, 153));
+        QCOMPARE(source.name(), QStringLiteral("node"));
+        // Readonly ones initialize the target
+        QCOMPARE(target.fieldOfView(), 45.0f);
+        QVERIFY(!forwarder.hasPendingChanges());
+    }
+
+    void checkSourceChangesAreCoalesced()
+    {
+        // GIVEN
+        Source source;
+        Target target;
+        PropertyForwarder forwarder;
+        forwarder.setObjects(&source, &target);
+        const int initialWrites = target.aspectRatioWrites;
+
+        // WHEN
+        for (int i = 0; i < 10; ++i)
+            source.setAspectRatio(double(i) + 0.5);
+        source.setPosition(QVector3D(4.0f, 5.0f, 6.0f));
+
+        // THEN
+        QVERIFY(forwarder.hasPendingChanges());
+        QCOMPARE(target.aspectRatioWrites, initialWrites);
+        QCOMPARE(target.aspectRatio(), 2.0f);
+
+        // WHEN
+        QCoreApplication::processEvents();
+
+        // THEN
+        QVERIFY(!forwarder.hasPendingChanges());
+        QCOMPARE(target.aspectRatioWrites, initialWrites + 1);
+        QCOMPARE(target.aspectRatio(), 9.5f);
+        QCOMPARE(target.position(), QVector3D(4.0f, 5.0f, 6.0f));
+        // The target notification of our own write isn't forwarded back
+        QCOMPARE(source.aspectRatio(), 9.5);
+    }
+
+    void checkTargetChanges()
+    {
+        // GIVEN
+        Source source;
+        Target target;
+        PropertyForwarder forwarder;
+        forwarder.setObjects(&source, &target);
+
+        // WHEN
+        target.setColor(QColor(153, 102, 51));
+        target.setName(QStringLiteral("renamed"));
+        target.setFieldOfView(30.0f);
+        forwarder.flush();
+
+        // THEN
+        QCOMPARE(source.color(), QColor(153, 102, 51));
+        QCOMPARE(source.name(), QStringLiteral("renamed"));
+        QCOMPARE(source.fieldOfView(), 45.0);
+        QVERIFY(!forwarder.hasPendingChanges());
+
+        // WHEN
+        // Both sides changed since the last flush, the source wins
+        target.setAspectRatio(3.0f);
+        source.setAspectRatio(4.0);
+        forwarder.flush();
+
+        // THEN
+        QCOMPARE(target.aspectRatio(), 4.0f);
+        QCOMPARE(source.aspectRatio(), 4.0);
+    }
+
+    void checkClear()
+    {
+        // GIVEN
+        Source source;
+        Target target;
+        PropertyForwarder forwarder;
+        forwarder.setObjects(&source, &target);
+
+        // WHEN
+        source.setAspectRatio(8.0);
+        forwarder.clear();
+        source.setAspectRatio(16.0);
+        QCoreApplication::processEvents();
+
+        // THEN
+        QCOMPARE(forwarder.bindingCount(), 0);
+        QVERIFY(forwarder.source() == nullptr);
+        QVERIFY(forwarder.target() == nullptr);
+        QCOMPARE(target.aspectRatio(), 2.0f);
+    }
+};
+
+QTEST_MAIN(tst_PropertyForwarder)
+
+#include "tst_propertyforwarder.moc"
@@ -0,0 +1,212 @@
+/*
+    tst_reflectioncamera.cpp
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <QtTest/QTest>
+#include <QtTest/QSignalSpy>
+#include <Qt3DCore/QTransform>
+#include <Qt3DRender/QCamera>
+#include <Kuesa/private/reflectioncamera_p.h>
+#include <Kuesa/private/boundingvolumehierarchy_p.h>
+#include <Kuesa/private/kuesa_utils_p.h>
+#include <cmath>
+
+using namespace Kuesa;
+
+namespace {
+
+const QVector4D groundPlane(0.0f, 1.0f, 0.0f, 0.0f);
+
+QMatrix4x4 lookAt(const QVector3D &eye, const QVector3D &center)
+{
+    QMatrix4x4 view;
+    view.lookAt(eye, center, QVector3D(0.0f, 1.0f, 0.0f));
+    return view;
+}
+
+QMatrix4x4 perspective()
+{
+    QMatrix4x4 projection;
+    projection.perspective(45.0f, 1.0f, 0.1f, 100.0f);
+    return projection;
+}
+
+AxisAlignedBox unitBoxAt(const QVector3D &center)
+{
+    return AxisAlignedBox(center - QVector3D(0.5f, 0.5f, 0.5f),
+                          center + QVector3D(0.5f, 0.5f, 0.5f));
+}
+
+bool fuzzyCompare(const QVector4D &a, const QVector4D &b, float epsilon = 1e-3f)
+{
+    const QVector4D d = a - b;
+    return std::abs(d.x()) < epsilon && std::abs(d.y()) < epsilon &&
+            std::abs(d.z()) < epsilon && std::abs(d.w()) < epsilon;
+}
+
+bool fuzzyCompare(const QMatrix4x4 &a, const QMatrix4x4 &b, float epsilon = 1e-3f)
+{
+    for (int i = 0; i < 4; ++i) {
+        if (!fuzzyCompare(a.row(i), b.row(i), epsilon))
+            return false;
+    }
+    return true;
+}
+
+} // namespace
+
+class tst_ReflectionCamera : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+
+    void checkReflectionMatrix()
+    {
+        // GIVEN
+        const QMatrix4x4 r = ReflectionCamera::reflectionMatrix(groundPlane);
+
+        // THEN
+        QVERIFY(fuzzyCompare(r * QVector4D(1.0f, 3.0f, 2.0f, 1.0f), QVector4D(1.0f, -3.0f, 2.0f, 1.0f)));
+        QVERIFY(fuzzyCompare(r * r, QMatrix4x4()));
+
+        // GIVEN -> y = 2
+        const QMatrix4x4 r2 = ReflectionCamera::reflectionMatrix(QVector4D(0.0f, 1.0f, 0.0f, -2.0f));
+
+        // THEN
+        QVERIFY(fuzzyCompare(r2 * QVector4D(0.0f, 5.0f, 0.0f, 1.0f), QVector4D(0.0f, -1.0f, 0.0f, 1.0f)));
+        QVERIFY(fuzzyCompare(r2 * QVector4D(4.0f, 2.0f, 1.0f, 1.0f), QVector4D(4.0f, 2.0f, 1.0f, 1.0f)));
+    }
+
+    void checkMirroredMatrices()
+    {
+        // GIVEN
+        const QMatrix4x4 view = lookAt(QVector3D(0.0f, 5.0f, 10.0f), QVector3D());
+        const QMatrix4x4 projection = perspective();
+        const QMatrix4x4 reflected = projection * view * ReflectionCamera::reflectionMatrix(groundPlane);
+
+        // WHEN
+        const ReflectionCamera::Matrices m = ReflectionCamera::mirroredMatrices(view, projection, groundPlane);
+
+        // THEN -> rigid view matrix, unlike view * reflectionMatrix
+        QVERIFY(std::abs(m.viewMatrix.determinant() - 1.0f) < 1e-3f);
+        QMatrix4x4 rotation = m.viewMatrix;
+        rotation.setColumn(3, QVector4D(0.0f, 0.0f, 0.0f, 1.0f));
+        QVERIFY(fuzzyCompare(rotation.transposed() * rotation, QMatrix4x4()));
+
+        // THEN -> same x, y and w clip coordinates above the plane
+        const QVector4D points[] = {
+            QVector4D(0.0f, 1.0f, 0.0f, 1.0f),
+            QVector4D(2.0f, 0.5f, -3.0f, 1.0f),
+            QVector4D(-1.0f, 3.0f, 2.0f, 1.0f),
+        };
+        for (const QVector4D &p : points) {
+            const QVector4D expected = reflected * p;
+            const QVector4D actual = m.projectionMatrix * m.viewMatrix * p;
+            QVERIFY(std::abs(expected.x() - actual.x()) < 1e-3f);
+            QVERIFY(std::abs(expected.y() - actual.y()) < 1e-3f);
+            QVERIFY(std::abs(expected.w() - actual.w()) < 1e-3f);
+            // Not clipped
+            QVERIFY(actual.z() >= -actual.w());
+            QVERIFY(actual.z() <= actual.w());
+        }
+
+        // THEN -> what lies behind the mirror is clipped by the near plane
+        const QVector4D below = m.projectionMatrix * m.viewMatrix * QVector4D(0.0f, -1.0f, 0.0f, 1.0f);
+        QVERIFY(below.z() < -below.w());
+    }
+
+    void checkMirroredFrustumCulling()
+    {
+        // GIVEN
+        const QMatrix4x4 view = lookAt(QVector3D(0.0f, 5.0f, 10.0f), QVector3D());
+        const ReflectionCamera::Matrices m = ReflectionCamera::mirroredMatrices(view, perspective(), groundPlane);
+
+        // WHEN
+        const Frustum frustum = Frustum::fromViewProjection(m.projectionMatrix * m.viewMatrix);
+
+        // THEN -> reflection in view
+        QVERIFY(frustum.intersects(unitBoxAt(QVector3D(0.0f, 1.0f, 0.0f))) != Frustum::Outside);
+        // THEN -> reflection out of view
+        QVERIFY(frustum.intersects(unitBoxAt(QVector3D(50.0f, 1.0f, 0.0f))) == Frustum::Outside);
+        // THEN -> behind the mirror, even though its reflection would be in view
+        QVERIFY(frustum.intersects(unitBoxAt(QVector3D(0.0f, -2.0f, 0.0f))) == Frustum::Outside);
+
+        // WHEN -> looking at the plane from below
+        const QMatrix4x4 viewBelow = lookAt(QVector3D(0.0f, -5.0f, 10.0f), QVector3D());
+        const ReflectionCamera::Matrices mBelow = ReflectionCamera::mirroredMatrices(viewBelow, perspective(), groundPlane);
+        const Frustum frustumBelow = Frustum::fromViewProjection(mBelow.projectionMatrix * mBelow.viewMatrix);
+
+        // THEN
+        QVERIFY(frustumBelow.intersects(unitBoxAt(QVector3D(0.0f, -2.0f, 0.0f))) != Frustum::Outside);
+        QVERIFY(frustumBelow.intersects(unitBoxAt(QVector3D(0.0f, 2.0f, 0.0f))) == Frustum::Outside);
+    }
+
+    void checkFollowsSourceCamera()
+    {
+        // GIVEN
+        Qt3DRender::QCamera camera;
+        camera.setPosition(QVector3D(0.0f, 5.0f, 10.0f));
+        camera.setViewCenter(QVector3D());
+        camera.setUpVector(QVector3D(0.0f, 1.0f, 0.0f));
+        camera.lens()->setPerspectiveProjection(45.0f, 1.0f, 0.1f, 100.0f);
+
+        ReflectionCamera *reflectionCamera = new ReflectionCamera(&camera);
+        QSignalSpy spy(reflectionCamera, &ReflectionCamera::changed);
+        QVERIFY(spy.isValid());
+
+        // THEN
+        QVERIFY(reflectionCamera->parent() == &camera);
+        QVERIFY(reflectionCamera->sourceCamera() == &camera);
+
+        // WHEN
+        reflectionCamera->setPlaneEquation(groundPlane);
+
+        // THEN
+        QCOMPARE(spy.count(), 1);
+        const ReflectionCamera::Matrices expected = ReflectionCamera::mirroredMatrices(camera.viewMatrix(),
+                                                                                      camera.projectionMatrix(),
+                                                                                      groundPlane);
+        QVERIFY(fuzzyCompare(reflectionCamera->viewMatrix(), expected.viewMatrix));
+        QVERIFY(fuzzyCompare(reflectionCamera->projectionMatrix(), expected.projectionMatrix));
+
+        // THEN -> world transform is the inverse of the mirrored view matrix
+        Qt3DCore::QTransform *transform = componentFromEntity<Qt3DCore::QTransform>(reflectionCamera);
+        QVERIFY(transform);
+        QVERIFY(fuzzyCompare(camera.transform()->matrix() * transform->matrix(), expected.viewMatrix.inverted()));
+
+        // WHEN
+        camera.setPosition(QVector3D(3.0f, 4.0f, 8.0f));
+
+        // THEN
+        QVERIFY(spy.count() > 1);
+        QVERIFY(fuzzyCompare(reflectionCamera->viewMatrix(),
+                             ReflectionCamera::mirroredMatrices(camera.viewMatrix(), camera.projectionMatrix(), groundPlane).viewMatrix));
+    }
+};
+
+QTEST_MAIN(tst_ReflectionCamera)
+#include "tst_reflectioncamera.moc"
@@ -46,6 +46,8 @@ private Q_SLOTS:
         // THEN
         QCOMPARE(plane.equation(), QVector4D());
         QCOMPARE(plane.layers().size(), size_t(0));
+        QCOMPARE(plane.updateInterval(), 1);
+        QCOMPARE(plane.resolutionScale(), 1.0f);
     }
 
     void testEquation()
@@ -70,6 +72,64 @@ private Q_SLOTS:
         QCOMPARE(spy.count(), 1);
     }
 
+    void testUpdateInterval()
+    {
+        // GIVEN
+        Kuesa::ReflectionPlane plane;
+        QSignalSpy spy(&plane, &Kuesa::ReflectionPlane::updateIntervalChanged);
+        QVERIFY(spy.isValid());
+
+        // WHEN
+        plane.setUpdateInterval(4);
+
+        // THEN
+        QCOMPARE(plane.updateInterval(), 4);
+        QCOMPARE(spy.count(), 1);
+
+        // WHEN
+        plane.setUpdateInterval(-1);
+
+        // THEN
+        QCOMPARE(plane.updateInterval(), 0);
+        QCOMPARE(spy.count(), 2);
+    }
+
+    void testResolutionScale()
+    {
+        // GIVEN
+        Kuesa::ReflectionPlane plane;
+        QSignalSpy spy(&plane, &Kuesa::ReflectionPlane::resolutionScaleChanged);
+        QVERIFY(spy.isValid());
+
+        // WHEN
+        plane.setResolutionScale(0.5f);
+
+        // THEN
+        QCOMPARE(plane.resolutionScale(), 0.5f);
+        QCOMPARE(spy.count(), 1);
+
+        // WHEN
+        plane.setResolutionScale(2.0f);
+
+        // THEN
+        QCOMPARE(plane.resolutionScale(), 1.0f);
+        QCOMPARE(spy.count(), 2);
+    }
+
+    void testRequestUpdate()
+    {
+        // GIVEN
+        Kuesa::ReflectionPlane plane;
+        QSignalSpy spy(&plane, &Kuesa::ReflectionPlane::updateRequested);
+        QVERIFY(spy.isValid());
+
+        // WHEN
+        plane.requestUpdate();
+
+        // THEN
+        QCOMPARE(spy.count(), 1);
+    }
+
     void testLayers()
     {
         // GIVEN
@@ -27,6 +27,7 @@
 */
 
 #include <QtTest/QTest>
+#include <QtTest/QSignalSpy>
 
 #include <Qt3DRender/QTechniqueFilter>
 #include <Qt3DRender/QFrustumCulling>
@@ -36,7 +37,9 @@
 #include <Qt3DRender/QCameraSelector>
 #include <Qt3DRender/QLayerFilter>
 #include <Qt3DRender/QRenderTargetSelector>
+#include <Qt3DRender/QSubtreeEnabler>
 #include <Qt3DRender/QRenderTarget>
+#include <Qt3DRender/QCamera>
 
 #include <Kuesa/forwardrenderer.h>
 #include <Kuesa/abstractpostprocessingeffect.h>
@@ -45,6 +48,23 @@
 #include <Kuesa/private/transparentrenderstage_p.h>
 #include <Kuesa/private/scenestages_p.h>
 #include <Kuesa/private/reflectionstages_p.h>
+#include <Kuesa/private/reflectioncamera_p.h>
+
+namespace {
+
+// Qt3D keeps traversing the children of a disabled FrameGraph node, only a
+// disabled QSubtreeEnabler ancestor prevents a node from being rendered
+bool isTraversed(const QObject *node)
+{
+    for (; node != nullptr; node = node->parent()) {
+        auto subtreeEnabler = qobject_cast<const Qt3DRender::QSubtreeEnabler *>(node);
+        if (subtreeEnabler && !subtreeEnabler->isEnabled())
+            return false;
+    }
+    return true;
+}
+
+} // namespace
 
 class tst_ReflectionStages : public QObject
 {
@@ -83,7 +103,11 @@ private Q_SLOTS:
             QCOMPARE(reflectivePlaneTextureParameter->name(), QStringLiteral("kuesa_reflectionPlaneMap"));
             QVERIFY(reflectivePlaneTextureParameter->value().value<Qt3DRender::QAbstractTexture *>() != nullptr);
 
-            Qt3DRender::QRenderTargetSelector *rtSelector = qobject_cast<Qt3DRender::QRenderTargetSelector *>(stages.children().last());
+            Qt3DRender::QSubtreeEnabler *subtreeEnabler = qobject_cast<Qt3DRender::QSubtreeEnabler *>(stages.children().last());
+            QVERIFY(subtreeEnabler);
+            QCOMPARE(subtreeEnabler->children().size(), 1);
+
+            Qt3DRender::QRenderTargetSelector *rtSelector = qobject_cast<Qt3DRender::QRenderTargetSelector *>(subtreeEnabler->children().first());
             QVERIFY(rtSelector);
 
             QCOMPARE(rtSelector->children().size(), 3);
@@ -129,7 +153,11 @@ private Q_SLOTS:
             QCOMPARE(reflectivePlaneTextureParameter->name(), QStringLiteral("kuesa_reflectionPlaneMap"));
             QVERIFY(reflectivePlaneTextureParameter->value().value<Qt3DRender::QAbstractTexture *>() != nullptr);
 
-            Qt3DRender::QRenderTargetSelector *rtSelector = qobject_cast<Qt3DRender::QRenderTargetSelector *>(stages.children().last());
+            Qt3DRender::QSubtreeEnabler *subtreeEnabler = qobject_cast<Qt3DRender::QSubtreeEnabler *>(stages.children().last());
+            QVERIFY(subtreeEnabler);
+            QCOMPARE(subtreeEnabler->children().size(), 1);
+
+            Qt3DRender::QRenderTargetSelector *rtSelector = qobject_cast<Qt3DRender::QRenderTargetSelector *>(subtreeEnabler->children().first());
             QVERIFY(rtSelector);
             QCOMPARE(rtSelector->children().size(), 3);
 
@@ -196,6 +224,162 @@ private Q_SLOTS:
         // THEN
         QCOMPARE(stages.reflectivePlaneEquation(), QVector4D(1.0f, 1.0f, 1.0f, 0.0f));
     }
+
+    void checkReflectionCamera()
+    {
+        // GIVEN
+        Kuesa::ReflectionStages stages;
+        Qt3DRender::QCamera camera;
+        stages.setFrustumCulling(true);
+        stages.setReflectivePlaneEquation(QVector4D(0.0f, 1.0f, 0.0f, 0.0f));
+
+        Qt3DRender::QParameter *reflectiveEnabledParameter = qobject_cast<Qt3DRender::QParameter *>(stages.children()[0]);
+        Qt3DRender::QSubtreeEnabler *subtreeEnabler = qobject_cast<Qt3DRender::QSubtreeEnabler *>(stages.children().last());
+        Qt3DRender::QRenderTargetSelector *rtSelector = qobject_cast<Qt3DRender::QRenderTargetSelector *>(subtreeEnabler->children().first());
+        Qt3DRender::QCameraSelector *cameraSelector = qobject_cast<Qt3DRender::QCameraSelector *>(rtSelector->children().at(1));
+
+        // THEN -> mirroring done by the shaders, no culling
+        QVERIFY(stages.reflectionCamera() == nullptr);
+        QCOMPARE(reflectiveEnabledParameter->value(), true);
+        QCOMPARE(qobject_cast<Kuesa::ScenePass *>(cameraSelector->children().first())->frustumCulling(), false);
+
+        // WHEN
+        stages.setCamera(&camera);
+
+        // THEN
+        Kuesa::ReflectionCamera *reflectionCamera = stages.reflectionCamera();
+        QVERIFY(reflectionCamera != nullptr);
+        QVERIFY(stages.camera() == &camera);
+        QVERIFY(reflectionCamera->parent() == &camera);
+        QCOMPARE(reflectionCamera->planeEquation(), QVector4D(0.0f, 1.0f, 0.0f, 0.0f));
+        QVERIFY(cameraSelector->camera() == reflectionCamera);
+        QCOMPARE(reflectiveEnabledParameter->value(), false);
+        QCOMPARE(qobject_cast<Kuesa::ScenePass *>(cameraSelector->children().first())->frustumCulling(), true);
+
+        // WHEN
+        stages.setReflectivePlaneEquation(QVector4D(0.0f, 0.0f, 1.0f, 1.0f));
+
+        // THEN
+        QCOMPARE(reflectionCamera->planeEquation(), QVector4D(0.0f, 0.0f, 1.0f, 1.0f));
+
+        // WHEN
+        stages.setCamera(nullptr);
+
+        // THEN
+        QVERIFY(stages.reflectionCamera() == nullptr);
+        QVERIFY(cameraSelector->camera() == nullptr);
+        QCOMPARE(reflectiveEnabledParameter->value(), true);
+    }
+
+    void checkUpdateInterval()
+    {
+        // GIVEN
+        Kuesa::ReflectionStages stages;
+        Qt3DRender::QCamera camera;
+        stages.setReflectivePlaneEquation(QVector4D(0.0f, 1.0f, 0.0f, 0.0f));
+        stages.setCamera(&camera);
+        Kuesa::ReflectionCamera *reflectionCamera = stages.reflectionCamera();
+        Qt3DRender::QSubtreeEnabler *subtreeEnabler = qobject_cast<Qt3DRender::QSubtreeEnabler *>(stages.children().last());
+        Qt3DRender::QRenderTargetSelector *rtSelector = qobject_cast<Qt3DRender::QRenderTargetSelector *>(subtreeEnabler->children().first());
+        Qt3DRender::QClearBuffers *clearBuffers = qobject_cast<Qt3DRender::QClearBuffers *>(rtSelector->children().first());
+        Qt3DRender::QCameraSelector *cameraSelector = qobject_cast<Qt3DRender::QCameraSelector *>(rtSelector->children().at(1));
+        QVERIFY(clearBuffers);
+        QVERIFY(cameraSelector);
+
+        // THEN
+        QCOMPARE(stages.updateInterval(), 1);
+        QCOMPARE(subtreeEnabler->enablement(), Qt3DRender::QSubtreeEnabler::Persistent);
+
+        // WHEN
+        stages.setUpdateInterval(3);
+        emit reflectionCamera->frameTriggered();
+
+        // THEN -> initial render
+        QCOMPARE(isTraversed(clearBuffers), true);
+        QCOMPARE(isTraversed(cameraSelector), true);
+        QCOMPARE(stages.isUpdatePending(), false);
+
+        // WHEN
+        emit reflectionCamera->frameTriggered();
+
+        // THEN
+        QCOMPARE(isTraversed(clearBuffers), false);
+        QCOMPARE(isTraversed(cameraSelector), false);
+
+        // WHEN
+        emit reflectionCamera->frameTriggered();
+
+        // THEN
+        QCOMPARE(isTraversed(clearBuffers), false);
+        QCOMPARE(isTraversed(cameraSelector), false);
+
+        // WHEN
+        emit reflectionCamera->frameTriggered();
+
+        // THEN
+        QCOMPARE(isTraversed(clearBuffers), true);
+        QCOMPARE(isTraversed(cameraSelector), true);
+
+        // WHEN
+        stages.setUpdateInterval(0);
+        for (int i = 0; i < 5; ++i)
+            emit reflectionCamera->frameTriggered();
+
+        // THEN
+        QCOMPARE(isTraversed(clearBuffers), false);
+        QCOMPARE(isTraversed(cameraSelector), false);
+
+        // WHEN
+        camera.setPosition(QVector3D(0.0f, 5.0f, 10.0f));
+
+        // THEN
+        QCOMPARE(stages.isUpdatePending(), true);
+
+        // WHEN
+        emit reflectionCamera->frameTriggered();
+
+        // THEN
+        QCOMPARE(isTraversed(clearBuffers), true);
+        QCOMPARE(isTraversed(cameraSelector), true);
+
+        // WHEN
+        emit reflectionCamera->frameTriggered();
+        stages.requestUpdate();
+        emit reflectionCamera->frameTriggered();
+
+        // THEN
+        QCOMPARE(isTraversed(clearBuffers), true);
+        QCOMPARE(isTraversed(cameraSelector), true);
+    
+        // THEN -> the selector itself is never disabled, only its subtree is pruned
+        QCOMPARE(rtSelector->isEnabled(), true);
+    }
+
+    void checkResolutionScale()
+    {
+        // GIVEN
+        Kuesa::ReflectionStages stages;
+        QSignalSpy spy(&stages, &Kuesa::ReflectionStages::reflectionTextureChanged);
+        QVERIFY(spy.isValid());
+
+        // WHEN
+        stages.setResolutionScale(0.5f);
+
+        // THEN
+        QCOMPARE(spy.count(), 1);
+        QCOMPARE(stages.reflectionTextureSize(), QSize(512, 512));
+        QCOMPARE(stages.reflectionTexture()->width(), 256);
+        QCOMPARE(stages.reflectionTexture()->height(), 256);
+
+        // WHEN
+        stages.setReflectionTextureSize({ 1024, 512 });
+
+        // THEN
+        QCOMPARE(spy.count(), 2);
+        QCOMPARE(stages.reflectionTextureSize(), QSize(1024, 512));
+        QCOMPARE(stages.reflectionTexture()->width(), 512);
+        QCOMPARE(stages.reflectionTexture()->height(), 256);
+    }
 };
 
 QTEST_MAIN(tst_ReflectionStages)
@@ -0,0 +1,256 @@
+/*
+    tst_rendertargetpool.cpp
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <QtTest/QTest>
+#include <QtTest/QSignalSpy>
+#include <Qt3DRender/QParameter>
+#include <Qt3DRender/QRenderTargetOutput>
+#include <Kuesa/private/rendertargetpool_p.h>
+#include <Kuesa/private/transienttexture_p.h>
+
+using namespace Kuesa;
+
+namespace {
+
+using Allocation = RenderTargetPool::Allocation;
+using TextureDescription = RenderTargetPool::TextureDescription;
+
+TextureDescription description(int width, int height,
+                               Qt3DRender::QAbstractTexture::TextureFormat format = Qt3DRender::QAbstractTexture::RGBA8_UNorm)
+{
+    TextureDescription d;
+    d.size = QSize(width, height);
+    d.format = format;
+    return d;
+}
+
+size_t maxOverlap(const std::vector<Allocation> &allocations)
+{
+    size_t overlap = 0;
+    for (const Allocation &a : allocations) {
+        for (int pass = a.firstUse; pass <= a.lastUse; ++pass) {
+            const size_t count = std::count_if(allocations.begin(), allocations.end(),
+                                               [pass](const Allocation &b) {
+                                                   return b.firstUse <= pass && pass <= b.lastUse;
+                                               });
+            overlap = std::max(overlap, count);
+        }
+    }
+    return overlap;
+}
+
+} // namespace
+
+class tst_RenderTargetPool : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+
+    void checkTextureMemorySize()
+    {
+        // THEN
+        QCOMPARE(RenderTargetPool::textureMemorySize(description(512, 256)), qint64(512 * 256 * 4));
+        QCOMPARE(RenderTargetPool::textureMemorySize(description(512, 256, Qt3DRender::QAbstractTexture::RGBA16F)), qint64(512 * 256 * 8));
+        QCOMPARE(RenderTargetPool::textureMemorySize(description(0, 256)), qint64(0));
+    }
+
+    void checkDisjointAllocationsAlias()
+    {
+        // GIVEN
+        const std::vector<Allocation> allocations = {
+            { description(512, 512), 0, 0 },
+            { description(512, 512), 1, 1 },
+            { description(512, 512), 2, 3 },
+        };
+        std::vector<TextureDescription> textures;
+
+        // WHEN
+        const std::vector<size_t> indices = RenderTargetPool::assignTextures(allocations, textures);
+
+        // THEN
+        QCOMPARE(textures.size(), size_t(1));
+        QCOMPARE(indices, std::vector<size_t>({ 0, 0, 0 }));
+    }
+
+    void checkOverlappingAllocationsDoNotAlias()
+    {
+        // GIVEN
+        const std::vector<Allocation> allocations = {
+            { description(512, 512), 0, 2 },
+            { description(512, 512), 1, 1 },
+            { description(512, 512), 3, 3 },
+        };
+        std::vector<TextureDescription> textures;
+
+        // WHEN
+        const std::vector<size_t> indices = RenderTargetPool::assignTextures(allocations, textures);
+
+        // THEN
+        QCOMPARE(textures.size(), size_t(2));
+        QVERIFY(indices[0] != indices[1]);
+        QVERIFY(indices[2] < textures.size());
+    }
+
+    void checkDifferentDescriptionsDoNotAlias()
+    {
+        // GIVEN
+        const std::vector<Allocation> allocations = {
+            { description(512, 512), 0, 0 },
+            { description(256, 512), 1, 1 },
+            { description(512, 512, Qt3DRender::QAbstractTexture::RGBA16F), 2, 2 },
+            { description(512, 512), 3, 3 },
+        };
+        std::vector<TextureDescription> textures;
+
+        // WHEN
+        const std::vector<size_t> indices = RenderTargetPool::assignTextures(allocations, textures);
+
+        // THEN
+        QCOMPARE(textures.size(), size_t(3));
+        QCOMPARE(indices[0], indices[3]);
+        for (size_t i = 0; i < allocations.size(); ++i)
+            QVERIFY(textures[indices[i]] == allocations[i].description);
+    }
+
+    void checkAssignmentIsOptimal()
+    {
+        // GIVEN
+        std::vector<Allocation> allocations;
+        for (int i = 0; i < 64; ++i) {
+            const int firstUse = (i * 7) % 23;
+            const int lastUse = firstUse + (i * 5) % 4;
+            allocations.push_back({ description(64, 64), firstUse, lastUse });
+        }
+        std::vector<TextureDescription> textures;
+
+        // WHEN
+        const std::vector<size_t> indices = RenderTargetPool::assignTextures(allocations, textures);
+
+        // THEN
+        QCOMPARE(textures.size(), maxOverlap(allocations));
+        for (size_t a = 0; a < allocations.size(); ++a) {
+            for (size_t b = a + 1; b < allocations.size(); ++b) {
+                const bool overlap = allocations[a].firstUse <= allocations[b].lastUse &&
+                        allocations[b].firstUse <= allocations[a].lastUse;
+                if (overlap)
+                    QVERIFY(indices[a] != indices[b]);
+            }
+        }
+    }
+
+    void checkRequestsBindPooledTextures()
+    {
+        // GIVEN
+        RenderTargetPool pool;
+        TransientTexture a;
+        TransientTexture b;
+        TransientTexture c;
+        for (TransientTexture *t : { &a, &b, &c }) {
+            t->setSize(QSize(256, 128));
+            t->setFormat(Qt3DRender::QAbstractTexture::RGBA8_UNorm);
+        }
+        Qt3DRender::QRenderTargetOutput output;
+        Qt3DRender::QParameter parameter;
+        a.addOutput(&output);
+        a.addParameter(&parameter);
+        QSignalSpy footprintSpy(&pool, SIGNAL(memoryFootprintChanged(qint64)));
+        QVERIFY(footprintSpy.isValid());
+
+        // THEN
+        QVERIFY(!a.isPooled());
+        QCOMPARE(output.texture(), a.texture());
+
+        // WHEN
+        pool.setRequests({ { &a, 0, 0 }, { &b, 1, 1 }, { &c, 1, 1 } });
+
+        // THEN
+        QCOMPARE(pool.requestCount(), size_t(3));
+        QCOMPARE(pool.textureCount(), size_t(2));
+        QCOMPARE(pool.memoryFootprint(), qint64(2 * 256 * 128 * 4));
+        QCOMPARE(pool.unaliasedMemoryFootprint(), qint64(3 * 256 * 128 * 4));
+        QCOMPARE(footprintSpy.count(), 1);
+        QVERIFY(a.isPooled() && b.isPooled() && c.isPooled());
+        QCOMPARE(a.texture(), pool.textureForRequest(0));
+        QCOMPARE(a.texture(), b.texture());
+        QVERIFY(b.texture() != c.texture());
+        QCOMPARE(output.texture(), a.texture());
+        QCOMPARE(parameter.value().value<Qt3DRender::QAbstractTexture *>(), a.texture());
+
+        // WHEN
+        pool.setRequests({});
+
+        // THEN
+        QCOMPARE(pool.textureCount(), size_t(0));
+        QCOMPARE(pool.memoryFootprint(), qint64(0));
+        QVERIFY(!a.isPooled() && !b.isPooled() && !c.isPooled());
+        QVERIFY(a.texture() != nullptr);
+        QVERIFY(a.texture() != b.texture());
+        QCOMPARE(output.texture(), a.texture());
+        QCOMPARE(parameter.value().value<Qt3DRender::QAbstractTexture *>(), a.texture());
+    }
+
+    void checkDescriptionChangesUpdateThePool()
+    {
+        // GIVEN
+        RenderTargetPool pool;
+        TransientTexture a;
+        TransientTexture b;
+        a.setFormat(Qt3DRender::QAbstractTexture::RGBA8_UNorm);
+        b.setFormat(Qt3DRender::QAbstractTexture::RGBA8_UNorm);
+        a.setSize(QSize(64, 64));
+        b.setSize(QSize(64, 64));
+        pool.setRequests({ { &a, 0, 0 }, { &b, 1, 1 } });
+
+        // THEN
+        QCOMPARE(pool.textureCount(), size_t(1));
+        QCOMPARE(pool.memoryFootprint(), qint64(64 * 64 * 4));
+
+        // WHEN
+        b.setSize(QSize(128, 128));
+        QCoreApplication::processEvents();
+
+        // THEN
+        QCOMPARE(pool.textureCount(), size_t(2));
+        QCOMPARE(pool.memoryFootprint(), qint64(64 * 64 * 4 + 128 * 128 * 4));
+        QVERIFY(a.texture() != b.texture());
+        QCOMPARE(b.texture()->width(), 128);
+
+        // WHEN
+        b.setSize(QSize(64, 64));
+        QCoreApplication::processEvents();
+
+        // THEN
+        QCOMPARE(pool.textureCount(), size_t(1));
+        QCOMPARE(a.texture(), b.texture());
+    }
+};
+
+QTEST_MAIN(tst_RenderTargetPool)
+
+#include "tst_rendertargetpool.moc"
@@ -0,0 +1,311 @@
+/*
+    tst_resourcereadinesstracker.cpp
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <QtTest/QTest>
+#include <QtTest/QSignalSpy>
+#include <Qt3DRender/QTextureImage>
+#include <Qt3DRender/QTexture>
+#include <Kuesa/private/resourcereadinesstracker_p.h>
+#include <Kuesa/private/texturestreamer_p.h>
+#include <memory>
+
+using namespace Kuesa;
+
+namespace {
+
+class TextureImage : public Qt3DRender::QTextureImage
+{
+public:
+    using Qt3DRender::QTextureImage::setStatus;
+};
+
+class TextureLoader : public Qt3DRender::QTextureLoader
+{
+public:
+    using Qt3DRender::QTextureLoader::setStatus;
+};
+
+class FakeVisibilitySource : public TextureVisibilitySource
+{
+public:
+    QSet<Qt3DRender::QAbstractTexture *> visibleTextures() override
+    {
+        return visible;
+    }
+
+    QSet<Qt3DRender::QAbstractTexture *> visible;
+};
+
+} // namespace
+
+class tst_ResourceReadinessTracker : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+
+    void checkDefaults()
+    {
+        // GIVEN
+        ResourceReadinessTracker tracker;
+
+        // THEN
+        QCOMPARE(tracker.resourceCount(), 0);
+        QCOMPARE(tracker.pendingCount(), 0);
+        QCOMPARE(tracker.isSettled(), true);
+        QCOMPARE(tracker.progress(), 1.0f);
+    }
+
+    void checkTracksStatusChanges()
+    {
+        // GIVEN
+        ResourceReadinessTracker tracker;
+        TextureImage images[4];
+        TextureLoader loader;
+        QSignalSpy settledSpy(&tracker, &ResourceReadinessTracker::settled);
+        QSignalSpy progressSpy(&tracker, &ResourceReadinessTracker::progressChanged);
+        QVERIFY(settledSpy.isValid());
+        QVERIFY(progressSpy.isValid());
+
+        images[3].setStatus(Qt3DRender::QTextureImage::Ready);
+
+        // WHEN
+        for (TextureImage &image : images)
+            tracker.track(&image);
+        tracker.track(&loader);
+
+        // THEN
+        QCOMPARE(tracker.resourceCount(), 5);
+        QCOMPARE(tracker.pendingCount(), 4);
+        QCOMPARE(tracker.isSettled(), false);
+        QCOMPARE(tracker.progress(), 0.2f);
+
+        // WHEN -> tracking twice
+        tracker.track(&images[0]);
+
+        // THEN
+        QCOMPARE(tracker.resourceCount(), 5);
+
+        // WHEN
+        progressSpy.clear();
+        images[0].setStatus(Qt3DRender::QTextureImage::Loading);
+
+        // THEN -> still pending
+        QCOMPARE(tracker.pendingCount(), 4);
+        QCOMPARE(progressSpy.count(), 0);
+
+        // WHEN
+        images[0].setStatus(Qt3DRender::QTextureImage::Ready);
+        images[1].setStatus(Qt3DRender::QTextureImage::Error);
+        loader.setStatus(Qt3DRender::QAbstractTexture::Ready);
+
+        // THEN -> failed resources don't block readiness
+        QCOMPARE(tracker.pendingCount(), 1);
+        QCOMPARE(progressSpy.count(), 3);
+        QCOMPARE(progressSpy.last().first().toFloat(), 0.8f);
+        QCOMPARE(settledSpy.count(), 0);
+
+        // WHEN
+        images[2].setStatus(Qt3DRender::QTextureImage::Ready);
+
+        // THEN
+        QCOMPARE(tracker.pendingCount(), 0);
+        QCOMPARE(tracker.isSettled(), true);
+        QCOMPARE(tracker.progress(), 1.0f);
+        QCOMPARE(settledSpy.count(), 1);
+
+        // WHEN -> reloaded
+        images[2].setStatus(Qt3DRender::QTextureImage::Loading);
+
+        // THEN
+        QCOMPARE(tracker.pendingCount(), 1);
+
+        // WHEN
+        images[2].setStatus(Qt3DRender::QTextureImage::Ready);
+
+        // THEN
+        QCOMPARE(settledSpy.count(), 2);
+    }
+
+    void checkDestroyedResources()
+    {
+        // GIVEN
+        ResourceReadinessTracker tracker;
+        TextureImage image;
+        QSignalSpy settledSpy(&tracker, &ResourceReadinessTracker::settled);
+        QVERIFY(settledSpy.isValid());
+
+        tracker.track(&image);
+        {
+            TextureImage transientImage;
+            tracker.track(&transientImage);
+
+            // THEN
+            QCOMPARE(tracker.pendingCount(), 2);
+        }
+
+        // THEN
+        QCOMPARE(tracker.resourceCount(), 1);
+        QCOMPARE(tracker.pendingCount(), 1);
+
+        // WHEN
+        {
+            TextureImage transientImage;
+            tracker.track(&transientImage);
+            image.setStatus(Qt3DRender::QTextureImage::Ready);
+
+            // THEN
+            QCOMPARE(settledSpy.count(), 0);
+        }
+
+        // THEN -> last pending resource destroyed
+        QCOMPARE(tracker.resourceCount(), 1);
+        QCOMPARE(tracker.isSettled(), true);
+        QCOMPARE(settledSpy.count(), 1);
+    }
+
+    void checkClear()
+    {
+        // GIVEN
+        ResourceReadinessTracker tracker;
+        TextureImage image;
+        QSignalSpy settledSpy(&tracker, &ResourceReadinessTracker::settled);
+        QVERIFY(settledSpy.isValid());
+        tracker.track(&image);
+
+        // WHEN
+        tracker.clear();
+
+        // THEN
+        QCOMPARE(tracker.resourceCount(), 0);
+        QCOMPARE(tracker.isSettled(), true);
+
+        // WHEN
+        image.setStatus(Qt3DRender::QTextureImage::Ready);
+
+        // THEN -> no longer tracked
+        QCOMPARE(settledSpy.count(), 0);
+    }
+
+    void checkStreamedTextures()
+    {
+        // GIVEN
+        ResourceReadinessTracker tracker;
+        TextureStreamer streamer;
+        FakeVisibilitySource source;
+        streamer.setVisibilitySource(&source);
+        TextureLoader loader;
+        loader.setSource(QUrl(QStringLiteral("file:///texture.ktx")));
+        Qt3DRender::QTexture2D texture;
+        texture.setFormat(Qt3DRender::QAbstractTexture::RGBA8_UNorm);
+        texture.setSize(64, 64);
+        auto image = new TextureImage;
+        texture.addTextureImage(image);
+        QSignalSpy settledSpy(&tracker, &ResourceReadinessTracker::settled);
+        QVERIFY(settledSpy.isValid());
+
+        // WHEN -> textures evicted before being tracked
+        streamer.manage(&loader);
+        streamer.manage(&texture);
+        tracker.track(&loader);
+        tracker.track(image);
+
+        // THEN -> nothing tells the textures are streamed
+        QCOMPARE(tracker.resourceCount(), 2);
+        QCOMPARE(tracker.pendingCount(), 2);
+
+        // WHEN
+        tracker.setTextureStreamer(&streamer);
+
+        // THEN -> evicted textures don't hold back readiness
+        QCOMPARE(tracker.textureStreamer(), &streamer);
+        QCOMPARE(tracker.pendingCount(), 0);
+        QCOMPARE(tracker.isSettled(), true);
+        QCOMPARE(settledSpy.count(), 1);
+
+        // WHEN
+        source.visible.insert(&loader);
+        streamer.update(0);
+
+        // THEN -> loading once in use
+        QVERIFY(streamer.isLoaded(&loader));
+        QCOMPARE(tracker.pendingCount(), 1);
+
+        // WHEN
+        loader.setStatus(Qt3DRender::QAbstractTexture::Ready);
+
+        // THEN
+        QCOMPARE(tracker.pendingCount(), 0);
+        QCOMPARE(settledSpy.count(), 2);
+
+        // WHEN
+        source.visible.insert(&texture);
+        streamer.update(100);
+
+        // THEN
+        QCOMPARE(tracker.pendingCount(), 1);
+
+        // WHEN
+        streamer.policy()->setMemoryBudget(1);
+        streamer.policy()->setEvictionDelay(0);
+        source.visible.clear();
+        streamer.update(200);
+
+        // THEN -> evicted again before the image got loaded
+        QVERIFY(!streamer.isLoaded(&texture));
+        QCOMPARE(tracker.pendingCount(), 0);
+        QCOMPARE(settledSpy.count(), 3);
+
+        // WHEN
+        tracker.setTextureStreamer(nullptr);
+
+        // THEN
+        QVERIFY(tracker.textureStreamer() == nullptr);
+        QCOMPARE(tracker.pendingCount(), 1);
+    }
+
+    void benchmarkStatusChanges()
+    {
+        // GIVEN
+        std::vector<std::unique_ptr<TextureImage>> images;
+        for (int i = 0; i < 1000; ++i)
+            images.emplace_back(new TextureImage);
+
+        QBENCHMARK {
+            ResourceReadinessTracker tracker;
+            for (const auto &image : images) {
+                image->setStatus(Qt3DRender::QTextureImage::Loading);
+                tracker.track(image.get());
+            }
+            for (const auto &image : images)
+                image->setStatus(Qt3DRender::QTextureImage::Ready);
+        }
+    }
+};
+
+QTEST_MAIN(tst_ResourceReadinessTracker)
+#include "tst_resourcereadinesstracker.moc"
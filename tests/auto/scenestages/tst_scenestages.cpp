@@ -661,7 +661,9 @@ private Q_SLOTS:
 
         // THEN -> No Layers, No ZFilling
         {
-            QCOMPARE(stages.children().size(), 4);
+            // Camera selector, reflection and shadow cascade parameters,
+            // clustered lights with their buffers and parameters
+            QCOMPARE(stages.children().size(), 12);
             Qt3DRender::QCameraSelector *cameraSelector = qobject_cast<Qt3DRender::QCameraSelector *>(stages.children().first());
             QVERIFY(cameraSelector);
 
@@ -680,6 +682,12 @@ private Q_SLOTS:
             QCOMPARE(reflectivePlaneTextureParameter->name(), QStringLiteral("kuesa_reflectionPlaneMap"));
             QVERIFY(reflectivePlaneTextureParameter->value().value<Qt3DRender::QAbstractTexture *>() != nullptr);
 
+            Qt3DRender::QParameter *shadowCascadesDisabledParameter = qobject_cast<Qt3DRender::QParameter *>(stages.children()[4]);
+            QVERIFY(shadowCascadesDisabledParameter);
+            QCOMPARE(shadowCascadesDisabledParameter->name(), QStringLiteral("kuesa_shadowCascadesDisabled"));
+            QCOMPARE(shadowCascadesDisabledParameter->value(), false);
+            QCOMPARE(stages.shadowCascadesEnabled(), true);
+
             QCOMPARE(cameraSelector->children().size(), 2);
             Kuesa::ScenePass *opaquePass = qobject_cast<Kuesa::ScenePass *>(cameraSelector->children().first());
             QVERIFY(opaquePass);
@@ -695,7 +703,7 @@ private Q_SLOTS:
 
         // THEN
         {
-            QCOMPARE(stages.children().size(), 4);
+            QCOMPARE(stages.children().size(), 12);
             Qt3DRender::QCameraSelector *cameraSelector = qobject_cast<Qt3DRender::QCameraSelector *>(stages.children().first());
             QVERIFY(cameraSelector);
 
@@ -741,7 +749,7 @@ private Q_SLOTS:
                 stages.addLayer(&layer);
 
                 // THEN
-                QCOMPARE(stages.children().size(), 4);
+                QCOMPARE(stages.children().size(), 12);
                 Qt3DRender::QCameraSelector *cameraSelector = qobject_cast<Qt3DRender::QCameraSelector *>(stages.children().first());
                 QVERIFY(cameraSelector);
 
@@ -787,7 +795,7 @@ private Q_SLOTS:
             }
 
             // THEN -> layer destroyed
-            QCOMPARE(stages.children().size(), 4);
+            QCOMPARE(stages.children().size(), 12);
             Qt3DRender::QCameraSelector *cameraSelector = qobject_cast<Qt3DRender::QCameraSelector *>(stages.children().first());
             QVERIFY(cameraSelector);
 
@@ -828,7 +836,7 @@ private Q_SLOTS:
 
         // THEN
         {
-            QCOMPARE(stages.children().size(), 4);
+            QCOMPARE(stages.children().size(), 12);
             Qt3DRender::QCameraSelector *cameraSelector = qobject_cast<Qt3DRender::QCameraSelector *>(stages.children().first());
             QVERIFY(cameraSelector);
 
@@ -852,6 +860,28 @@ private Q_SLOTS:
             QCOMPARE(transparentPass->cullingMode(), Qt3DRender::QCullFace::NoCulling);
         }
     }
+
+    void checkShadowCascades()
+    {
+        // GIVEN
+        Kuesa::SceneStages stages;
+        auto *shadowCascadesDisabledParameter = qobject_cast<Qt3DRender::QParameter *>(stages.children()[4]);
+        QVERIFY(shadowCascadesDisabledParameter);
+
+        // WHEN
+        stages.setShadowCascadesEnabled(false);
+
+        // THEN
+        QCOMPARE(stages.shadowCascadesEnabled(), false);
+        QCOMPARE(shadowCascadesDisabledParameter->value(), true);
+
+        // WHEN
+        stages.setShadowCascadesEnabled(true);
+
+        // THEN
+        QCOMPARE(stages.shadowCascadesEnabled(), true);
+        QCOMPARE(shadowCascadesDisabledParameter->value(), false);
+    }
 };
 
 QTEST_MAIN(tst_SceneStages)
@@ -0,0 +1,222 @@
+/*
+    tst_shadervariantcache.cpp
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <QtTest/QTest>
+#include <QDir>
+#include <QFile>
+#include <QTemporaryDir>
+#include <Qt3DRender/QGraphicsApiFilter>
+#include <Qt3DRender/QShaderProgramBuilder>
+#include <Qt3DRender/QTechnique>
+#include <Kuesa/private/effectslibrary_p.h>
+#include <Kuesa/private/shadervariantcache_p.h>
+#include <Kuesa/metallicroughnesseffect.h>
+#include <memory>
+
+using namespace Kuesa;
+using namespace Qt3DRender;
+
+namespace {
+
+const QUrl vertexGraph(QStringLiteral("qrc:/kuesa/shaders/graphs/metallicroughness.vert.json"));
+const QUrl fragmentGraph(QStringLiteral("qrc:/kuesa/shaders/graphs/metallicroughness.frag.json"));
+
+void setApi(QGraphicsApiFilter *api, QGraphicsApiFilter::Api name, int major, int minor)
+{
+    api->setApi(name);
+    api->setProfile(name == QGraphicsApiFilter::OpenGL ? QGraphicsApiFilter::CoreProfile : QGraphicsApiFilter::NoProfile);
+    api->setMajorVersion(major);
+    api->setMinorVersion(minor);
+}
+
+std::vector<QShaderProgramBuilder *> builders(const QEffect *effect)
+{
+    std::vector<QShaderProgramBuilder *> builders;
+    const auto techniques = effect->techniques();
+    for (const QTechnique *technique : techniques) {
+        const auto techniqueBuilders = technique->findChildren<QShaderProgramBuilder *>(QString(), Qt::FindDirectChildrenOnly);
+        builders.insert(builders.end(), techniqueBuilders.begin(), techniqueBuilders.end());
+    }
+    return builders;
+}
+
+} // namespace
+
+class tst_ShaderVariantCache : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+
+    void cleanup()
+    {
+        ShaderVariantCache::instance()->setPaths({});
+    }
+
+    void checkFileName()
+    {
+        // GIVEN
+        ShaderVariantCache cache;
+        QGraphicsApiFilter gl3;
+        setApi(&gl3, QGraphicsApiFilter::OpenGL, 3, 1);
+        QGraphicsApiFilter es2;
+        setApi(&es2, QGraphicsApiFilter::OpenGLES, 2, 0);
+        const QStringList layers = { QStringLiteral("baseColorMap"), QStringLiteral("normalMap") };
+        const QStringList reversedLayers = { QStringLiteral("normalMap"), QStringLiteral("baseColorMap") };
+
+        // WHEN
+        const QString fileName = cache.fileName(&gl3, QShaderProgram::Fragment, fragmentGraph, layers);
+
+        // THEN
+        QVERIFY(fileName.endsWith(QLatin1String(".frag")));
+        QCOMPARE(cache.fileName(&gl3, QShaderProgram::Fragment, fragmentGraph, layers), fileName);
+        QCOMPARE(cache.fileName(&gl3, QShaderProgram::Fragment, fragmentGraph, reversedLayers), fileName);
+        QVERIFY(cache.fileName(&es2, QShaderProgram::Fragment, fragmentGraph, layers) != fileName);
+        QVERIFY(cache.fileName(&gl3, QShaderProgram::Vertex, fragmentGraph, layers) != fileName);
+        QVERIFY(cache.fileName(&gl3, QShaderProgram::Fragment, vertexGraph, layers) != fileName);
+        QVERIFY(cache.fileName(&gl3, QShaderProgram::Fragment, fragmentGraph, { QStringLiteral("baseColorMap") }) != fileName);
+    }
+
+    void checkVariants()
+    {
+        // GIVEN
+        ShaderVariantCache cache;
+        QGraphicsApiFilter gl3;
+        setApi(&gl3, QGraphicsApiFilter::OpenGL, 3, 1);
+        QShaderProgramBuilder builder;
+        builder.setVertexShaderGraph(vertexGraph);
+        builder.setEnabledLayers({ QStringLiteral("noHasColorAttr") });
+
+        // WHEN
+        auto variants = cache.variants(&gl3, &builder);
+
+        // THEN
+        QCOMPARE(int(variants.size()), 1);
+        QCOMPARE(variants[0].stage, QShaderProgram::Vertex);
+        QCOMPARE(variants[0].graph, vertexGraph);
+        QCOMPARE(variants[0].fileName, cache.fileName(&gl3, QShaderProgram::Vertex, vertexGraph, builder.enabledLayers()));
+
+        // WHEN
+        builder.setFragmentShaderGraph(fragmentGraph);
+        variants = cache.variants(&gl3, &builder);
+
+        // THEN
+        QCOMPARE(int(variants.size()), 2);
+        QCOMPARE(variants[0].stage, QShaderProgram::Vertex);
+        QCOMPARE(variants[1].stage, QShaderProgram::Fragment);
+        QCOMPARE(variants[1].fileName, cache.fileName(&gl3, QShaderProgram::Fragment, fragmentGraph, builder.enabledLayers()));
+    }
+
+    void checkApply()
+    {
+        // GIVEN
+        QTemporaryDir dir;
+        ShaderVariantCache cache;
+        cache.setPaths({ dir.path() });
+        QGraphicsApiFilter gl3;
+        setApi(&gl3, QGraphicsApiFilter::OpenGL, 3, 1);
+        QShaderProgramBuilder builder;
+        QShaderProgram program;
+        builder.setShaderProgram(&program);
+        builder.setVertexShaderGraph(vertexGraph);
+        builder.setFragmentShaderGraph(fragmentGraph);
+        const auto variants = cache.variants(&gl3, &builder);
+
+        // WHEN
+        const bool missingApplied = cache.apply(&gl3, &builder, &program);
+
+        // THEN
+        QVERIFY(!missingApplied);
+        QCOMPARE(builder.shaderProgram(), &program);
+
+        // WHEN
+        for (const ShaderVariantCache::Variant &variant : variants) {
+            QFile file(QDir(dir.path()).filePath(variant.fileName));
+            QVERIFY(file.open(QIODevice::WriteOnly));
+            file.write(variant.fileName.toLatin1());
+        }
+        cache.setPaths({ dir.path() });
+        const bool applied = cache.apply(&gl3, &builder, &program);
+
+        // THEN
+        QVERIFY(applied);
+        QVERIFY(builder.shaderProgram() == nullptr);
+        QCOMPARE(program.vertexShaderCode(), variants[0].fileName.toLatin1());
+        QCOMPARE(program.fragmentShaderCode(), variants[1].fileName.toLatin1());
+
+        // WHEN
+        builder.setEnabledLayers({ QStringLiteral("noHasColorAttr") });
+        const bool otherVariantApplied = cache.apply(&gl3, &builder, &program);
+
+        // THEN
+        QVERIFY(!otherVariantApplied);
+        QCOMPARE(builder.shaderProgram(), &program);
+    }
+
+    void checkGeneratedVariantsAreUsed()
+    {
+        // GIVEN
+        QTemporaryDir dir;
+        const EffectProperties::Properties properties = EffectProperties::MetallicRoughness | EffectProperties::BaseColorMap;
+        std::unique_ptr<GLTF2MaterialEffect> effect(EffectsLibrary::createEffectWithKey(properties));
+
+        // WHEN
+        const auto generated = ShaderVariantCache::instance()->generate(effect.get());
+
+        // THEN
+        QVERIFY(!generated.empty());
+        for (const ShaderVariantCache::GeneratedVariant &variant : generated) {
+            QVERIFY(!variant.code.isEmpty());
+            QFile file(QDir(dir.path()).filePath(variant.fileName));
+            QVERIFY(file.open(QIODevice::WriteOnly));
+            file.write(variant.code);
+        }
+
+        // WHEN
+        ShaderVariantCache::instance()->setPaths({ dir.path() });
+        std::unique_ptr<GLTF2MaterialEffect> cachedEffect(EffectsLibrary::createEffectWithKey(properties));
+
+        // THEN
+        for (QShaderProgramBuilder *builder : builders(cachedEffect.get()))
+            QVERIFY(builder->shaderProgram() == nullptr);
+
+        // WHEN
+        std::unique_ptr<GLTF2MaterialEffect> otherEffect(EffectsLibrary::createEffectWithKey(EffectProperties::MetallicRoughness | EffectProperties::NormalMap));
+
+        // THEN
+        const auto otherTechniques = otherEffect->techniques();
+        for (QTechnique *technique : otherTechniques) {
+            auto metallicRoughnessTechnique = qobject_cast<MetallicRoughnessTechnique *>(technique);
+            QVERIFY(metallicRoughnessTechnique != nullptr);
+            QVERIFY(metallicRoughnessTechnique->metalRoughShaderBuilder()->shaderProgram() != nullptr);
+        }
+    }
+};
+
+QTEST_MAIN(tst_ShaderVariantCache)
+#include "tst_shadervariantcache.moc"
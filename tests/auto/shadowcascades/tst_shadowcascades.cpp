@@ -0,0 +1,286 @@
+/*
+    tst_shadowcascades.cpp
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <QtTest/QTest>
+#include <Kuesa/private/shadowcascades_p.h>
+#include <QVector2D>
+#include <cmath>
+
+using namespace Kuesa;
+
+namespace {
+
+bool fuzzyEqual(float a, float b, float epsilon = 1e-4f)
+{
+    return std::abs(a - b) <= epsilon;
+}
+
+QMatrix4x4 cameraViewMatrix(const QVector3D &position, const QVector3D &viewCenter)
+{
+    QMatrix4x4 viewMatrix;
+    viewMatrix.lookAt(position, viewCenter, QVector3D(0.0f, 1.0f, 0.0f));
+    return viewMatrix;
+}
+
+ShadowCascades::Parameters defaultParameters()
+{
+    ShadowCascades::Parameters parameters;
+    parameters.cameraViewMatrix = cameraViewMatrix(QVector3D(0.0f, 5.0f, 50.0f), QVector3D());
+    parameters.fieldOfView = 45.0f;
+    parameters.aspectRatio = 16.0f / 9.0f;
+    parameters.nearPlane = 0.1f;
+    parameters.farPlane = 1000.0f;
+    parameters.cascadeCount = 4;
+    parameters.splitLambda = 0.75f;
+    parameters.shadowMapSize = 1024;
+    parameters.lightDirection = QVector3D(-1.0f, -2.0f, -0.5f);
+    parameters.sceneCenter = QVector3D();
+    parameters.sceneRadius = 100.0f;
+    return parameters;
+}
+
+// Light space coordinates in [0, 1]
+QVector2D textureCoordinates(const QMatrix4x4 &viewProjection, const QVector3D &position)
+{
+    const QVector3D ndc = viewProjection * position;
+    return QVector2D(ndc.x() * 0.5f + 0.5f, ndc.y() * 0.5f + 0.5f);
+}
+
+} // namespace
+
+class tst_ShadowCascades : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+
+    void checkSplitDistances()
+    {
+        // WHEN
+        const std::vector<float> uniformSplits = ShadowCascades::splitDistances(1.0f, 101.0f, 4, 0.0f);
+        const std::vector<float> logSplits = ShadowCascades::splitDistances(1.0f, 10000.0f, 4, 1.0f);
+        const std::vector<float> blendedSplits = ShadowCascades::splitDistances(1.0f, 10000.0f, 4, 0.5f);
+
+        // THEN
+        QCOMPARE(uniformSplits.size(), size_t(5));
+        QVERIFY(fuzzyEqual(uniformSplits[0], 1.0f));
+        QVERIFY(fuzzyEqual(uniformSplits[1], 26.0f));
+        QVERIFY(fuzzyEqual(uniformSplits[2], 51.0f));
+        QVERIFY(fuzzyEqual(uniformSplits[3], 76.0f));
+        QVERIFY(fuzzyEqual(uniformSplits[4], 101.0f));
+
+        QCOMPARE(logSplits.size(), size_t(5));
+        QVERIFY(fuzzyEqual(logSplits[0], 1.0f));
+        QVERIFY(fuzzyEqual(logSplits[1], 10.0f));
+        QVERIFY(fuzzyEqual(logSplits[2], 100.0f, 1e-3f));
+        QVERIFY(fuzzyEqual(logSplits[3], 1000.0f, 1e-2f));
+        QVERIFY(fuzzyEqual(logSplits[4], 10000.0f));
+
+        for (size_t i = 0; i < blendedSplits.size(); ++i)
+            QVERIFY(fuzzyEqual(blendedSplits[i], 0.5f * (logSplits[i] + ShadowCascades::splitDistances(1.0f, 10000.0f, 4, 0.0f)[i]), 1e-2f));
+
+        // THEN -> A single cascade covers the whole range
+        const std::vector<float> singleSplit = ShadowCascades::splitDistances(0.5f, 20.0f, 0, 0.5f);
+        QCOMPARE(singleSplit.size(), size_t(2));
+        QCOMPARE(singleSplit.front(), 0.5f);
+        QCOMPARE(singleSplit.back(), 20.0f);
+    }
+
+    void checkFrustumSliceCorners()
+    {
+        // WHEN
+        const std::array<QVector3D, 8> corners = ShadowCascades::frustumSliceCorners(QMatrix4x4(), 90.0f, 2.0f, 1.0f, 3.0f);
+
+        // THEN
+        const QVector3D expectedCorners[8] = {
+            { -2.0f, -1.0f, -1.0f }, { 2.0f, -1.0f, -1.0f }, { 2.0f, 1.0f, -1.0f }, { -2.0f, 1.0f, -1.0f },
+            { -6.0f, -3.0f, -3.0f }, { 6.0f, -3.0f, -3.0f }, { 6.0f, 3.0f, -3.0f }, { -6.0f, 3.0f, -3.0f },
+        };
+        for (size_t i = 0; i < corners.size(); ++i)
+            QVERIFY(fuzzyEqual((corners[i] - expectedCorners[i]).length(), 0.0f));
+
+        // WHEN
+        const std::array<QVector3D, 8> movedCorners = ShadowCascades::frustumSliceCorners(cameraViewMatrix(QVector3D(0.0f, 0.0f, 10.0f), QVector3D()),
+                                                                                          90.0f, 2.0f, 1.0f, 3.0f);
+
+        // THEN -> Camera at z = 10 looking at the origin
+        for (size_t i = 0; i < movedCorners.size(); ++i)
+            QVERIFY(fuzzyEqual((movedCorners[i] - (expectedCorners[i] + QVector3D(0.0f, 0.0f, 10.0f))).length(), 0.0f));
+    }
+
+    void checkLightViewMatrix()
+    {
+        // WHEN
+        const QVector3D sceneCenter(1.0f, 2.0f, 3.0f);
+        const QMatrix4x4 viewMatrix = ShadowCascades::lightViewMatrix(sceneCenter, QVector3D(1.0f, -1.0f, 0.0f));
+
+        // THEN -> Scene center at the origin, light looking down -z
+        QVERIFY(fuzzyEqual((viewMatrix * sceneCenter).length(), 0.0f));
+        const QVector3D direction = viewMatrix.mapVector(QVector3D(1.0f, -1.0f, 0.0f).normalized());
+        QVERIFY(fuzzyEqual(direction.z(), -1.0f));
+
+        // WHEN -> Light pointing straight down
+        const QMatrix4x4 downViewMatrix = ShadowCascades::lightViewMatrix(QVector3D(), QVector3D(0.0f, -1.0f, 0.0f));
+
+        // THEN -> Valid basis despite the direction being colinear with +y
+        QVERIFY(fuzzyEqual(downViewMatrix.mapVector(QVector3D(0.0f, -1.0f, 0.0f)).z(), -1.0f));
+        QVERIFY(fuzzyEqual(downViewMatrix.mapVector(QVector3D(0.0f, 0.0f, 1.0f)).y(), 1.0f));
+    }
+
+    void checkCascadeSplitsAreClampedToScene()
+    {
+        // GIVEN
+        ShadowCascades::Parameters parameters = defaultParameters();
+
+        // WHEN
+        const ShadowCascades::Cascades cascades = ShadowCascades::computeCascades(parameters);
+
+        // THEN -> Contiguous slices ending at the far side of the scene
+        QCOMPARE(cascades.cascades.size(), size_t(4));
+        QVERIFY(fuzzyEqual(cascades.cascades.front().splitNear, parameters.nearPlane));
+        for (size_t i = 1; i < cascades.cascades.size(); ++i) {
+            QCOMPARE(cascades.cascades[i].splitNear, cascades.cascades[i - 1].splitFar);
+            QVERIFY(cascades.cascades[i].splitFar > cascades.cascades[i].splitNear);
+        }
+        const float sceneFarDistance = QVector3D(0.0f, 5.0f, 50.0f).length() + parameters.sceneRadius;
+        QVERIFY(fuzzyEqual(cascades.cascades.back().splitFar, sceneFarDistance, 1e-3f));
+
+        // THEN -> Base projection covers the scene
+        QVERIFY(fuzzyEqual(cascades.nearPlane, -parameters.sceneRadius));
+        QVERIFY(fuzzyEqual(cascades.farPlane, parameters.sceneRadius));
+        QMatrix4x4 expectedProjection;
+        expectedProjection.ortho(-100.0f, 100.0f, -100.0f, 100.0f, -100.0f, 100.0f);
+        QVERIFY(qFuzzyCompare(cascades.projectionMatrix, expectedProjection));
+
+        // THEN -> Closer cascades are smaller
+        for (size_t i = 1; i < cascades.cascades.size(); ++i) {
+            const float previousSize = cascades.cascades[i - 1].right - cascades.cascades[i - 1].left;
+            const float size = cascades.cascades[i].right - cascades.cascades[i].left;
+            QVERIFY(size >= previousSize);
+        }
+    }
+
+    void checkCascadesContainTheirSlice()
+    {
+        // GIVEN
+        const ShadowCascades::Parameters parameters = defaultParameters();
+
+        // WHEN
+        const ShadowCascades::Cascades cascades = ShadowCascades::computeCascades(parameters);
+
+        // THEN
+        const float texelTolerance = 2.0f / float(parameters.shadowMapSize) + 1e-4f;
+        for (const ShadowCascades::Cascade &cascade : cascades.cascades) {
+            // Cascades as large as the scene are centered on it instead
+            if (cascade.right - cascade.left >= 2.0f * parameters.sceneRadius)
+                continue;
+
+            const QMatrix4x4 viewProjection = cascade.projectionMatrix * cascades.viewMatrix;
+            const auto corners = ShadowCascades::frustumSliceCorners(parameters.cameraViewMatrix,
+                                                                     parameters.fieldOfView,
+                                                                     parameters.aspectRatio,
+                                                                     cascade.splitNear, cascade.splitFar);
+            for (const QVector3D &corner : corners) {
+                const QVector3D ndc = viewProjection * corner;
+                QVERIFY(std::abs(ndc.x()) <= 1.0f + texelTolerance);
+                QVERIFY(std::abs(ndc.y()) <= 1.0f + texelTolerance);
+            }
+        }
+    }
+
+    void checkScaleOffsetMatchesCascadeProjection()
+    {
+        // GIVEN
+        const ShadowCascades::Parameters parameters = defaultParameters();
+        const ShadowCascades::Cascades cascades = ShadowCascades::computeCascades(parameters);
+        const QMatrix4x4 baseViewProjection = cascades.projectionMatrix * cascades.viewMatrix;
+        const QVector3D positions[] = {
+            { 0.0f, 0.0f, 0.0f },
+            { 3.0f, 1.0f, 40.0f },
+            { -20.0f, 4.0f, 10.0f },
+            { 50.0f, -30.0f, -60.0f },
+        };
+
+        for (const ShadowCascades::Cascade &cascade : cascades.cascades) {
+            const QMatrix4x4 cascadeViewProjection = cascade.projectionMatrix * cascades.viewMatrix;
+            for (const QVector3D &position : positions) {
+                // WHEN
+                const QVector2D baseCoordinates = textureCoordinates(baseViewProjection, position);
+                const QVector2D cascadeCoordinates = textureCoordinates(cascadeViewProjection, position);
+                const QVector2D scaledCoordinates(baseCoordinates.x() * cascade.scaleOffset.x() + cascade.scaleOffset.z(),
+                                                  baseCoordinates.y() * cascade.scaleOffset.y() + cascade.scaleOffset.w());
+
+                // THEN -> The shader can move base light space coordinates into any cascade
+                QVERIFY(fuzzyEqual(scaledCoordinates.x(), cascadeCoordinates.x(), 1e-3f));
+                QVERIFY(fuzzyEqual(scaledCoordinates.y(), cascadeCoordinates.y(), 1e-3f));
+
+                // THEN -> Depth is shared by all cascades
+                QVERIFY(fuzzyEqual((baseViewProjection * position).z(), (cascadeViewProjection * position).z()));
+            }
+        }
+    }
+
+    void checkCascadesAreStable()
+    {
+        // GIVEN
+        ShadowCascades::Parameters parameters = defaultParameters();
+        const ShadowCascades::Cascades cascades = ShadowCascades::computeCascades(parameters);
+
+        // WHEN -> Rotating the camera in place
+        parameters.cameraViewMatrix = cameraViewMatrix(QVector3D(0.0f, 5.0f, 50.0f), QVector3D(20.0f, 0.0f, 10.0f));
+        const ShadowCascades::Cascades rotatedCascades = ShadowCascades::computeCascades(parameters);
+
+        // THEN -> Cascades keep their size so texels don't change
+        QCOMPARE(rotatedCascades.cascades.size(), cascades.cascades.size());
+        for (size_t i = 0; i < cascades.cascades.size(); ++i) {
+            const float size = cascades.cascades[i].right - cascades.cascades[i].left;
+            const float rotatedSize = rotatedCascades.cascades[i].right - rotatedCascades.cascades[i].left;
+            QCOMPARE(rotatedSize, size);
+        }
+
+        // WHEN -> Moving the camera
+        for (float offset : { 0.01f, 0.37f, 1.5f }) {
+            parameters.cameraViewMatrix = cameraViewMatrix(QVector3D(offset, 5.0f, 50.0f), QVector3D(offset, 0.0f, 0.0f));
+            const ShadowCascades::Cascades movedCascades = ShadowCascades::computeCascades(parameters);
+
+            // THEN -> Cascades only move by whole texels
+            for (const ShadowCascades::Cascade &cascade : movedCascades.cascades) {
+                const float size = cascade.right - cascade.left;
+                if (size >= 2.0f * parameters.sceneRadius)
+                    continue;
+                const float texelSize = size / float(parameters.shadowMapSize);
+                const float centerInTexels = (cascade.left + cascade.right) * 0.5f / texelSize;
+                QVERIFY(fuzzyEqual(centerInTexels, std::round(centerInTexels), 1e-2f));
+            }
+        }
+    }
+};
+
+QTEST_MAIN(tst_ShadowCascades)
+
+#include "tst_shadowcascades.moc"
@@ -0,0 +1,376 @@
+/*
+    tst_shadowmapatlas.cpp
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <QtTest/QTest>
+#include <QtTest/QSignalSpy>
+#include <Qt3DCore/QEntity>
+#include <Qt3DRender/QTexture>
+#include <Kuesa/SpotLight>
+#include <Kuesa/shadowmap.h>
+#include <Kuesa/private/shadowmapatlas_p.h>
+
+using namespace Kuesa;
+
+namespace {
+
+using Requests = std::vector<ShadowMapAtlas::Request>;
+
+bool tilesAreValid(const ShadowMapAtlas &atlas, const Requests &requests)
+{
+    const QRect atlasRect(0, 0, atlas.atlasSize(), atlas.atlasSize());
+    for (size_t i = 0; i < requests.size(); ++i) {
+        const QRect tile = atlas.tile(requests[i].id);
+        if (tile.isNull())
+            continue;
+        if (!atlasRect.contains(tile))
+            return false;
+        for (size_t j = i + 1; j < requests.size(); ++j) {
+            if (tile.intersects(atlas.tile(requests[j].id)))
+                return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+class tst_ShadowMapAtlas : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+
+    void checkSelectResolution()
+    {
+        // THEN -> Full coverage gets the requested size
+        QCOMPARE(ShadowMapAtlas::selectResolution(1.0f, 1.0f, 1024, 128), 1024);
+
+        // THEN -> Resolution follows the square root of the coverage
+        QCOMPARE(ShadowMapAtlas::selectResolution(0.25f, 1.0f, 1024, 128), 512);
+        QCOMPARE(ShadowMapAtlas::selectResolution(0.01f, 1.0f, 1024, 128), 128);
+        QCOMPARE(ShadowMapAtlas::selectResolution(0.0f, 1.0f, 1024, 128), 128);
+
+        // THEN -> Priority scales the resolution without exceeding the requested size
+        QCOMPARE(ShadowMapAtlas::selectResolution(1.0f, 0.5f, 1024, 128), 512);
+        QCOMPARE(ShadowMapAtlas::selectResolution(1.0f, 4.0f, 1024, 128), 1024);
+
+        // THEN -> Sizes are rounded up to powers of two
+        QCOMPARE(ShadowMapAtlas::selectResolution(1.0f, 1.0f, 1000, 128), 1024);
+        QCOMPARE(ShadowMapAtlas::selectResolution(0.3f, 1.0f, 1024, 128), 1024);
+    }
+
+    void checkConeCoverage()
+    {
+        // THEN
+        QVERIFY(qAbs(ShadowMapAtlas::coneCoverage(45.0f, 5.0f, 10.0f) - 0.25f) < 1e-5f);
+        QCOMPARE(ShadowMapAtlas::coneCoverage(45.0f, 50.0f, 10.0f), 1.0f);
+        QCOMPARE(ShadowMapAtlas::coneCoverage(45.0f, 5.0f, 0.0f), 1.0f);
+        QCOMPARE(ShadowMapAtlas::coneCoverage(0.0f, 5.0f, 10.0f), 0.0f);
+    }
+
+    void checkAtlasSizeForRequests()
+    {
+        // THEN
+        QCOMPARE(ShadowMapAtlas::atlasSizeForRequests({}, 512, 4096), 512);
+        QCOMPARE(ShadowMapAtlas::atlasSizeForRequests({ { 1, 1024, 1.0f } }, 512, 4096), 1024);
+        QCOMPARE(ShadowMapAtlas::atlasSizeForRequests({ { 1, 1024, 1.0f }, { 2, 1024, 1.0f }, { 3, 512, 1.0f } }, 512, 4096), 2048);
+        QCOMPARE(ShadowMapAtlas::atlasSizeForRequests({ { 1, 8192, 1.0f } }, 512, 4096), 4096);
+    }
+
+    void checkPacking()
+    {
+        // GIVEN
+        ShadowMapAtlas atlas(2048, 128);
+        const Requests requests = {
+            { 1, 1024, 1.0f },
+            { 2, 512, 1.0f },
+            { 3, 512, 1.0f },
+            { 4, 256, 1.0f },
+            { 5, 1024, 1.0f },
+            { 6, 1000, 1.0f },
+            { 7, 200, 1.0f },
+        };
+
+        // WHEN
+        const int movedTiles = atlas.update(requests);
+
+        // THEN
+        QCOMPARE(movedTiles, 7);
+        QCOMPARE(atlas.tileCount(), size_t(7));
+        QVERIFY(tilesAreValid(atlas, requests));
+        QCOMPARE(atlas.tile(1).size(), QSize(1024, 1024));
+        QCOMPARE(atlas.tile(4).size(), QSize(256, 256));
+        QCOMPARE(atlas.tile(6).size(), QSize(1024, 1024));
+        QCOMPARE(atlas.tile(7).size(), QSize(256, 256));
+        QCOMPARE(atlas.allocatedArea(), qint64(3 * 1024 * 1024 + 2 * 512 * 512 + 2 * 256 * 256));
+        QVERIFY(atlas.tile(42).isNull());
+    }
+
+    void checkIncrementalUpdate()
+    {
+        // GIVEN
+        ShadowMapAtlas atlas(2048, 128);
+        Requests requests = {
+            { 1, 1024, 1.0f },
+            { 2, 512, 1.0f },
+            { 3, 256, 1.0f },
+        };
+        atlas.update(requests);
+        const QRect tile1 = atlas.tile(1);
+        const QRect tile2 = atlas.tile(2);
+        const QRect tile3 = atlas.tile(3);
+
+        // WHEN
+        const int unchangedMovedTiles = atlas.update(requests);
+
+        // THEN
+        QCOMPARE(unchangedMovedTiles, 0);
+
+        // WHEN
+        requests.push_back({ 4, 512, 1.0f });
+        const int addedMovedTiles = atlas.update(requests);
+
+        // THEN -> Existing tiles didn't move
+        QCOMPARE(addedMovedTiles, 1);
+        QCOMPARE(atlas.tile(1), tile1);
+        QCOMPARE(atlas.tile(2), tile2);
+        QCOMPARE(atlas.tile(3), tile3);
+        QCOMPARE(atlas.tile(4).size(), QSize(512, 512));
+        QVERIFY(tilesAreValid(atlas, requests));
+
+        // WHEN
+        requests[1].size = 256;
+        const int resizedMovedTiles = atlas.update(requests);
+
+        // THEN -> Only the resized tile moved
+        QCOMPARE(resizedMovedTiles, 1);
+        QCOMPARE(atlas.tile(1), tile1);
+        QCOMPARE(atlas.tile(3), tile3);
+        QCOMPARE(atlas.tile(2).size(), QSize(256, 256));
+        QVERIFY(tilesAreValid(atlas, requests));
+    }
+
+    void checkRemovalFreesSpace()
+    {
+        // GIVEN
+        ShadowMapAtlas atlas(2048, 128);
+        Requests requests = {
+            { 1, 1024, 1.0f },
+            { 2, 1024, 1.0f },
+            { 3, 1024, 1.0f },
+            { 4, 512, 1.0f },
+            { 5, 512, 1.0f },
+            { 6, 512, 1.0f },
+            { 7, 512, 1.0f },
+        };
+        atlas.update(requests);
+        QCOMPARE(atlas.allocatedArea(), qint64(2048 * 2048));
+
+        // WHEN -> Freeing the 512 tiles merges them back into a 1024 block
+        requests.resize(3);
+        atlas.update(requests);
+        requests.push_back({ 8, 1024, 1.0f });
+        const int movedTiles = atlas.update(requests);
+
+        // THEN
+        QCOMPARE(movedTiles, 1);
+        QCOMPARE(atlas.tile(8).size(), QSize(1024, 1024));
+        QCOMPARE(atlas.allocatedArea(), qint64(2048 * 2048));
+        QVERIFY(tilesAreValid(atlas, requests));
+
+        // WHEN
+        const int clearedMovedTiles = atlas.update({});
+
+        // THEN
+        QCOMPARE(clearedMovedTiles, 0);
+        QCOMPARE(atlas.tileCount(), size_t(0));
+        QCOMPARE(atlas.allocatedArea(), qint64(0));
+
+        // WHEN -> Everything merged back into the whole atlas
+        const int fullMovedTiles = atlas.update({ { 9, 2048, 1.0f } });
+
+        // THEN
+        QCOMPARE(fullMovedTiles, 1);
+        QCOMPARE(atlas.tile(9), QRect(0, 0, 2048, 2048));
+    }
+
+    void checkRepackWhenFragmented()
+    {
+        // GIVEN
+        ShadowMapAtlas atlas(512, 128);
+        const Requests requests = {
+            { 1, 256, 1.0f },
+            { 2, 256, 1.0f },
+            { 3, 128, 1.0f },
+            { 4, 128, 1.0f },
+            { 5, 128, 1.0f },
+            { 6, 128, 1.0f },
+            { 7, 128, 1.0f },
+            { 8, 128, 1.0f },
+            { 9, 128, 1.0f },
+            { 10, 128, 1.0f },
+        };
+        atlas.update(requests);
+        QCOMPARE(atlas.allocatedArea(), qint64(512 * 512));
+
+        // WHEN -> Removing small tiles from two different quadrants leaves
+        // enough room for a 256 tile but no free 256 block
+        Requests fragmentedRequests;
+        for (const auto &request : requests) {
+            if (request.id != 3 && request.id != 4 && request.id != 7 && request.id != 8)
+                fragmentedRequests.push_back(request);
+        }
+        atlas.update(fragmentedRequests);
+        fragmentedRequests.push_back({ 11, 256, 1.0f });
+        const int movedTiles = atlas.update(fragmentedRequests);
+
+        // THEN -> Everything got repacked since the total area fits
+        QCOMPARE(movedTiles, 7);
+        QCOMPARE(atlas.tileCount(), size_t(7));
+        QCOMPARE(atlas.tile(11).size(), QSize(256, 256));
+        QCOMPARE(atlas.allocatedArea(), qint64(512 * 512));
+        QVERIFY(tilesAreValid(atlas, fragmentedRequests));
+    }
+
+    void checkLowestPriorityIsDowngraded()
+    {
+        // GIVEN
+        ShadowMapAtlas atlas(2048, 128);
+        Requests requests = {
+            { 1, 1024, 1.0f },
+            { 2, 1024, 2.0f },
+            { 3, 1024, 2.0f },
+            { 4, 1024, 2.0f },
+            { 5, 1024, 0.5f },
+        };
+
+        // WHEN
+        atlas.update(requests);
+
+        // THEN -> Lowest priority shrinks to the minimum, then the next lowest
+        QCOMPARE(atlas.tileCount(), size_t(5));
+        QCOMPARE(atlas.tile(5).size(), QSize(128, 128));
+        QCOMPARE(atlas.tile(1).size(), QSize(512, 512));
+        QCOMPARE(atlas.tile(2).size(), QSize(1024, 1024));
+        QCOMPARE(atlas.tile(3).size(), QSize(1024, 1024));
+        QCOMPARE(atlas.tile(4).size(), QSize(1024, 1024));
+        QVERIFY(tilesAreValid(atlas, requests));
+
+        // WHEN -> Freed space is given back to downgraded tiles
+        requests.erase(requests.begin() + 1);
+        const int movedTiles = atlas.update(requests);
+
+        // THEN
+        QCOMPARE(movedTiles, 2);
+        QCOMPARE(atlas.tile(1).size(), QSize(1024, 1024));
+        QVERIFY(atlas.tile(5).width() > 128);
+        QVERIFY(tilesAreValid(atlas, requests));
+    }
+
+    void checkLowestPriorityIsDroppedWhenFull()
+    {
+        // GIVEN
+        ShadowMapAtlas atlas(256, 128);
+        const Requests requests = {
+            { 1, 128, 1.0f },
+            { 2, 128, 3.0f },
+            { 3, 128, 0.25f },
+            { 4, 128, 2.0f },
+            { 5, 128, 4.0f },
+        };
+
+        // WHEN
+        atlas.update(requests);
+
+        // THEN
+        QCOMPARE(atlas.tileCount(), size_t(4));
+        QVERIFY(atlas.tile(3).isNull());
+        QVERIFY(tilesAreValid(atlas, requests));
+    }
+
+    void checkSetAtlasSize()
+    {
+        // GIVEN
+        ShadowMapAtlas atlas(1000, 100);
+
+        // THEN
+        QCOMPARE(atlas.atlasSize(), 1024);
+        QCOMPARE(atlas.minTileSize(), 128);
+
+        // WHEN
+        atlas.update({ { 1, 512, 1.0f } });
+        atlas.setAtlasSize(2048);
+
+        // THEN
+        QCOMPARE(atlas.atlasSize(), 2048);
+        QCOMPARE(atlas.tileCount(), size_t(0));
+
+        // WHEN
+        const int movedTiles = atlas.update({ { 1, 512, 1.0f } });
+
+        // THEN
+        QCOMPARE(movedTiles, 1);
+        QCOMPARE(atlas.tile(1).size(), QSize(512, 512));
+    }
+
+    void checkShadowMapFollowsAtlasGrowth()
+    {
+        // GIVEN
+        Qt3DCore::QEntity entity;
+        auto light = new SpotLight;
+        entity.addComponent(light);
+        Qt3DRender::QTexture2DArray depthTexture;
+        ShadowMap shadowMap(light, &depthTexture);
+        QSignalSpy viewportSpy(&shadowMap, &ShadowMap::viewportRectChanged);
+
+        // WHEN
+        shadowMap.setAtlasTile(QRect(0, 0, 512, 512), QSize(512, 512));
+
+        // THEN
+        QCOMPARE(shadowMap.viewportRect(), QRectF(0.0, 0.0, 1.0, 1.0));
+        QCOMPARE(viewportSpy.count(), 0);
+
+        // WHEN -> A second light grows the atlas, the first one keeps its tile
+        shadowMap.setAtlasTile(QRect(0, 0, 512, 512), QSize(1024, 1024));
+
+        // THEN
+        QCOMPARE(shadowMap.atlasTile(), QRect(0, 0, 512, 512));
+        QCOMPARE(shadowMap.viewportRect(), QRectF(0.0, 0.0, 0.5, 0.5));
+        QCOMPARE(viewportSpy.count(), 1);
+
+        // WHEN -> Same tile, same atlas
+        shadowMap.setAtlasTile(QRect(0, 0, 512, 512), QSize(1024, 1024));
+
+        // THEN
+        QCOMPARE(viewportSpy.count(), 1);
+    }
+};
+
+QTEST_MAIN(tst_ShadowMapAtlas)
+
+#include "tst_shadowmapatlas.moc"
@@ -0,0 +1,400 @@
+/*
+    tst_texturestreamer.cpp
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <qtkuesa-config.h>
+#include <QtTest/QTest>
+#include <QtTest/QSignalSpy>
+#include <Qt3DCore/QEntity>
+#include <Qt3DRender/QGeometryRenderer>
+#include <Qt3DRender/QMaterial>
+#include <Qt3DRender/QParameter>
+#include <Qt3DRender/QTexture>
+#include <Qt3DRender/QTextureImage>
+#include <Kuesa/GLTF2Importer>
+#include <Kuesa/SceneEntity>
+#include <Kuesa/private/texturestreamer_p.h>
+#include <memory>
+
+using namespace Kuesa;
+
+namespace {
+
+class FakeVisibilitySource : public TextureVisibilitySource
+{
+public:
+    QSet<Qt3DRender::QAbstractTexture *> visibleTextures() override
+    {
+        return visible;
+    }
+
+    QSet<Qt3DRender::QAbstractTexture *> visible;
+};
+
+Qt3DRender::QTexture2D *createTexture(int size, Qt3DCore::QNode *parent = nullptr)
+{
+    auto texture = new Qt3DRender::QTexture2D(parent);
+    texture->setFormat(Qt3DRender::QAbstractTexture::RGBA8_UNorm);
+    texture->setGenerateMipMaps(false);
+    texture->setSize(size, size);
+    texture->addTextureImage(new Qt3DRender::QTextureImage);
+    return texture;
+}
+
+} // namespace
+
+class tst_TextureStreamer : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+
+    void checkPolicyLoadsVisibleTextures()
+    {
+        // GIVEN
+        TextureStreamingPolicy policy;
+        const int ids[2] = {};
+        const void *a = &ids[0];
+        const void *b = &ids[1];
+
+        // THEN
+        QCOMPARE(policy.memoryBudget(), qint64(0));
+        QCOMPARE(policy.evictionDelay(), qint64(10000));
+
+        // WHEN
+        auto actions = policy.update({ { a, true, 100 }, { b, false, 100 } }, 0);
+
+        // THEN
+        QCOMPARE(actions.load.size(), size_t(1));
+        QCOMPARE(actions.load.front(), a);
+        QVERIFY(actions.evict.empty());
+        QVERIFY(policy.isLoaded(a));
+        QVERIFY(!policy.isLoaded(b));
+        QCOMPARE(policy.loadedBytes(), qint64(100));
+
+        // WHEN -> already loaded
+        actions = policy.update({ { a, true, 100 }, { b, false, 100 } }, 10);
+
+        // THEN
+        QVERIFY(actions.load.empty());
+        QVERIFY(actions.evict.empty());
+    }
+
+    void checkPolicyEviction()
+    {
+        // GIVEN
+        TextureStreamingPolicy policy;
+        policy.setMemoryBudget(250);
+        policy.setEvictionDelay(1000);
+        const int ids[3] = {};
+        const void *a = &ids[0];
+        const void *b = &ids[1];
+        const void *c = &ids[2];
+
+        policy.update({ { a, true, 100 }, { b, false, 100 }, { c, false, 100 } }, 0);
+        policy.update({ { a, false, 100 }, { b, true, 100 }, { c, false, 100 } }, 100);
+        policy.update({ { a, false, 100 }, { b, false, 100 }, { c, true, 100 } }, 200);
+
+        // THEN -> over budget but nothing unused for long enough
+        QCOMPARE(policy.loadedBytes(), qint64(300));
+        QVERIFY(policy.isLoaded(a));
+        QVERIFY(policy.isLoaded(b));
+
+        // WHEN
+        auto actions = policy.update({ { a, false, 100 }, { b, false, 100 }, { c, true, 100 } }, 1150);
+
+        // THEN -> least recently used goes first, only until within budget
+        QCOMPARE(actions.evict.size(), size_t(1));
+        QCOMPARE(actions.evict.front(), a);
+        QVERIFY(!policy.isLoaded(a));
+        QVERIFY(policy.isLoaded(b));
+        QCOMPARE(policy.loadedBytes(), qint64(200));
+
+        // WHEN -> visible again
+        actions = policy.update({ { a, true, 100 }, { b, false, 100 }, { c, false, 100 } }, 1200);
+
+        // THEN
+        QCOMPARE(actions.load.size(), size_t(1));
+        QCOMPARE(actions.load.front(), a);
+        QCOMPARE(actions.evict.size(), size_t(1));
+        QCOMPARE(actions.evict.front(), b);
+
+        // WHEN -> no budget, never evict
+        policy.setMemoryBudget(0);
+        actions = policy.update({ { a, false, 1000 }, { b, false, 1000 }, { c, false, 1000 } }, 100000);
+
+        // THEN
+        QVERIFY(actions.evict.empty());
+        QVERIFY(policy.isLoaded(c));
+    }
+
+    void checkManage()
+    {
+        // GIVEN
+        TextureStreamer streamer;
+        FakeVisibilitySource source;
+        streamer.setVisibilitySource(&source);
+        Qt3DRender::QTexture2D *texture = createTexture(256);
+        Qt3DRender::QAbstractTextureImage *image = texture->textureImages().front();
+        QSignalSpy loadedSpy(&streamer, &TextureStreamer::textureLoaded);
+
+        // WHEN
+        streamer.manage(texture);
+
+        // THEN -> only the placeholder is left
+        QVERIFY(streamer.isManaged(texture));
+        QVERIFY(!streamer.isLoaded(texture));
+        QCOMPARE(streamer.managedCount(), 1);
+        QCOMPARE(texture->width(), 1);
+        QCOMPARE(texture->height(), 1);
+        QCOMPARE(texture->textureImages().size(), 1);
+        QVERIFY(texture->textureImages().front() != image);
+
+        // WHEN
+        streamer.update(0);
+
+        // THEN
+        QVERIFY(!streamer.isLoaded(texture));
+        QCOMPARE(loadedSpy.count(), 0);
+
+        // WHEN
+        source.visible.insert(texture);
+        streamer.update(100);
+
+        // THEN
+        QVERIFY(streamer.isLoaded(texture));
+        QCOMPARE(loadedSpy.count(), 1);
+        QCOMPARE(texture->width(), 256);
+        QCOMPARE(texture->textureImages().size(), 1);
+        QCOMPARE(texture->textureImages().front(), image);
+
+        // WHEN
+        delete texture;
+
+        // THEN
+        QCOMPARE(streamer.managedCount(), 0);
+    }
+
+    void checkEviction()
+    {
+        // GIVEN
+        TextureStreamer streamer;
+        FakeVisibilitySource source;
+        streamer.setVisibilitySource(&source);
+        streamer.policy()->setMemoryBudget(256 * 256 * 4);
+        streamer.policy()->setEvictionDelay(1000);
+        std::unique_ptr<Qt3DRender::QTexture2D> a(createTexture(256));
+        std::unique_ptr<Qt3DRender::QTexture2D> b(createTexture(256));
+        QSignalSpy evictedSpy(&streamer, &TextureStreamer::textureEvicted);
+
+        streamer.manage(a.get());
+        streamer.manage(b.get());
+        source.visible = { a.get(), b.get() };
+        streamer.update(0);
+
+        // WHEN
+        source.visible = { b.get() };
+        streamer.update(500);
+
+        // THEN -> not unused for long enough
+        QVERIFY(streamer.isLoaded(a.get()));
+        QCOMPARE(evictedSpy.count(), 0);
+
+        // WHEN
+        streamer.update(1000);
+
+        // THEN
+        QVERIFY(!streamer.isLoaded(a.get()));
+        QVERIFY(streamer.isLoaded(b.get()));
+        QCOMPARE(evictedSpy.count(), 1);
+        QCOMPARE(a->width(), 1);
+
+        // WHEN
+        streamer.release(a.get());
+
+        // THEN -> restored
+        QVERIFY(!streamer.isManaged(a.get()));
+        QCOMPARE(a->width(), 256);
+        QCOMPARE(a->textureImages().size(), 1);
+    }
+
+    void checkSceneVisibility()
+    {
+        // GIVEN
+        Qt3DCore::QEntity root;
+        auto parent = new Qt3DCore::QEntity(&root);
+        auto entity = new Qt3DCore::QEntity(parent);
+        auto material = new Qt3DRender::QMaterial(entity);
+        Qt3DRender::QTexture2D *texture = createTexture(16, &root);
+        material->addParameter(new Qt3DRender::QParameter(QStringLiteral("map"), QVariant::fromValue(texture)));
+        entity->addComponent(material);
+        SceneTextureVisibility visibility(entity);
+
+        // THEN -> nothing rendered
+        QVERIFY(visibility.visibleTextures().isEmpty());
+
+        // WHEN
+        entity->addComponent(new Qt3DRender::QGeometryRenderer(entity));
+
+        // THEN
+        QCOMPARE(visibility.visibleTextures(), QSet<Qt3DRender::QAbstractTexture *>({ texture }));
+
+        // WHEN
+        parent->setEnabled(false);
+
+        // THEN
+        QVERIFY(visibility.visibleTextures().isEmpty());
+    }
+
+    void checkSceneVisibilityOnlyWalksOnChanges()
+    {
+        // GIVEN
+        Qt3DCore::QEntity root;
+        auto entity = new Qt3DCore::QEntity(&root);
+        auto material = new Qt3DRender::QMaterial(entity);
+        Qt3DRender::QTexture2D *a = createTexture(16, &root);
+        Qt3DRender::QTexture2D *b = createTexture(16, &root);
+        auto parameter = new Qt3DRender::QParameter(QStringLiteral("map"), QVariant::fromValue(a));
+        material->addParameter(parameter);
+        entity->addComponent(material);
+        entity->addComponent(new Qt3DRender::QGeometryRenderer(entity));
+        SceneTextureVisibility visibility(&root);
+
+        // WHEN
+        visibility.visibleTextures();
+        visibility.visibleTextures();
+
+        // THEN
+        QCOMPARE(visibility.collectCount(), 1);
+
+        // WHEN
+        parameter->setValue(QVariant::fromValue(b));
+
+        // THEN
+        QCOMPARE(visibility.visibleTextures(), QSet<Qt3DRender::QAbstractTexture *>({ b }));
+        QCOMPARE(visibility.collectCount(), 2);
+
+        // WHEN
+        auto other = new Qt3DCore::QEntity;
+        auto otherMaterial = new Qt3DRender::QMaterial(other);
+        otherMaterial->addParameter(new Qt3DRender::QParameter(QStringLiteral("map"), QVariant::fromValue(a)));
+        other->addComponent(otherMaterial);
+        other->addComponent(new Qt3DRender::QGeometryRenderer(other));
+        other->setParent(&root);
+
+        // THEN
+        QCOMPARE(visibility.visibleTextures(), QSet<Qt3DRender::QAbstractTexture *>({ a, b }));
+        QCOMPARE(visibility.collectCount(), 3);
+
+        // WHEN
+        delete other;
+
+        // THEN
+        QCOMPARE(visibility.visibleTextures(), QSet<Qt3DRender::QAbstractTexture *>({ b }));
+        QCOMPARE(visibility.collectCount(), 4);
+    }
+
+    void checkRefreshesSizeOnceLoaded()
+    {
+        // GIVEN -> a texture whose size is only known once its file is loaded
+        TextureStreamer streamer;
+        FakeVisibilitySource source;
+        streamer.setVisibilitySource(&source);
+        std::unique_ptr<Qt3DRender::QTexture2D> texture(createTexture(1));
+        streamer.manage(texture.get());
+        source.visible.insert(texture.get());
+        streamer.update(0);
+        QCOMPARE(streamer.policy()->loadedBytes(), qint64(4));
+
+        // WHEN
+        texture->setSize(512, 512);
+        streamer.update(100);
+
+        // THEN
+        QCOMPARE(streamer.policy()->loadedBytes(), qint64(512 * 512 * 4));
+
+        // WHEN
+        source.visible.clear();
+        streamer.policy()->setMemoryBudget(1);
+        streamer.policy()->setEvictionDelay(0);
+        streamer.update(200);
+
+        // THEN -> evicted, then restored to its loaded size
+        QVERIFY(!streamer.isLoaded(texture.get()));
+        QCOMPARE(texture->width(), 1);
+
+        // WHEN
+        streamer.release(texture.get());
+
+        // THEN
+        QCOMPARE(texture->width(), 512);
+    }
+
+    void checkLazyImport()
+    {
+        // GIVEN
+        SceneEntity scene;
+        GLTF2Importer importer;
+        importer.setSceneEntity(&scene);
+        GLTF2Import::GLTF2Options options;
+        options.setLazyTextureLoading(true);
+        options.setTextureEvictionDelay(500);
+        importer.setOptions(options);
+
+        // WHEN
+        importer.setSource(QUrl("file:///" ASSETS "BoxTextured.gltf"));
+        QCoreApplication::processEvents();
+
+        // THEN
+        QCOMPARE(importer.status(), GLTF2Importer::Ready);
+        TextureStreamer *streamer = TextureStreamer::streamer(&scene);
+        QVERIFY(streamer);
+        QCOMPARE(streamer->policy()->evictionDelay(), qint64(500));
+        QVERIFY(scene.textures()->size() > 0);
+        const auto names = scene.textures()->names();
+        for (const QString &name : names) {
+            Qt3DRender::QAbstractTexture *texture = scene.textures()->find(name);
+            QVERIFY(streamer->isManaged(texture));
+            QVERIFY(!streamer->isLoaded(texture));
+        }
+
+        // WHEN
+        FakeVisibilitySource source;
+        for (const QString &name : names)
+            source.visible.insert(scene.textures()->find(name));
+        streamer->setVisibilitySource(&source);
+        streamer->update(0);
+
+        // THEN
+        for (const QString &name : names)
+            QVERIFY(streamer->isLoaded(scene.textures()->find(name)));
+        streamer->setVisibilitySource(nullptr);
+    }
+};
+
+QTEST_MAIN(tst_TextureStreamer)
+
+#include "tst_texturestreamer.moc"
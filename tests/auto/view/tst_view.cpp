@@ -589,11 +589,11 @@ private Q_SLOTS:
 
             // THEN
             QCOMPARE(v.children().size(), 4);
-            QCOMPARE(v.children()[0], v.m_fg->m_renderTargets[0]);
+            QCOMPARE(v.children()[0], v.m_fg->m_renderToTextureRootNode);
+            QCOMPARE(v.children()[1], v.m_fg->m_renderTargets[0]);
+            QCOMPARE(v.children()[2], v.m_internalFXStages);
             // We parent plane if it has no parent
-            QCOMPARE(v.children()[1], &plane);
-            QCOMPARE(v.children()[2], v.m_fg->m_renderToTextureRootNode);
-            QCOMPARE(v.children()[3], v.m_internalFXStages);
+            QCOMPARE(v.children()[3], &plane);
             QCOMPARE(v.m_fg->m_renderToTextureRootNode->children().size(), 2);
             QCOMPARE(v.m_fg->m_renderToTextureRootNode->children().first(), v.m_fg->m_clearRT0);
             QCOMPARE(v.m_fg->m_renderToTextureRootNode->children()[1], v.m_fg->m_mainSceneLayerFilter);
@@ -606,8 +606,8 @@ private Q_SLOTS:
 
         // THEN
         QCOMPARE(v.children().size(), 3);
-        QCOMPARE(v.children()[0], v.m_fg->m_renderTargets[0]);
-        QCOMPARE(v.children()[1], v.m_fg->m_renderToTextureRootNode);
+        QCOMPARE(v.children()[0], v.m_fg->m_renderToTextureRootNode);
+        QCOMPARE(v.children()[1], v.m_fg->m_renderTargets[0]);
         QCOMPARE(v.children()[2], v.m_internalFXStages);
         QCOMPARE(v.m_fg->m_renderToTextureRootNode->children().size(), 2);
         QCOMPARE(v.m_fg->m_renderToTextureRootNode->children().first(), v.m_fg->m_clearRT0);
@@ -630,8 +630,8 @@ private Q_SLOTS:
         QCoreApplication::processEvents();
 
         QCOMPARE(v.children().size(), 5);
-        QCOMPARE(v.children()[0], v.m_fg->m_renderTargets[0]);
-        QCOMPARE(v.children()[1], v.m_fg->m_renderToTextureRootNode);
+        QCOMPARE(v.children()[0], v.m_fg->m_renderToTextureRootNode);
+        QCOMPARE(v.children()[1], v.m_fg->m_renderTargets[0]);
         QCOMPARE(v.children()[2], v.m_fg->m_renderTargets[1]);
         QCOMPARE(v.children()[3], v.m_fxStages);
         QCOMPARE(v.children()[4], v.m_internalFXStages);
@@ -663,8 +663,8 @@ private Q_SLOTS:
         QCoreApplication::processEvents();
 
         QCOMPARE(v.children().size(), 3);
-        QCOMPARE(v.children()[0], v.m_fg->m_renderTargets[0]);
-        QCOMPARE(v.children()[1], v.m_fg->m_renderToTextureRootNode);
+        QCOMPARE(v.children()[0], v.m_fg->m_renderToTextureRootNode);
+        QCOMPARE(v.children()[1], v.m_fg->m_renderTargets[0]);
         QCOMPARE(v.children()[2], v.m_internalFXStages);
         QCOMPARE(v.m_fg->m_renderToTextureRootNode->children().size(), 2);
         QCOMPARE(v.m_fg->m_renderToTextureRootNode->children().first(), v.m_fg->m_clearRT0);
@@ -693,9 +693,9 @@ private Q_SLOTS:
         QCoreApplication::processEvents();
 
         QCOMPARE(v.children().size(), 6);
-        QCOMPARE(v.children()[0], v.m_fg->m_renderTargets[0]);
-        QCOMPARE(v.children()[1], &plane);
-        QCOMPARE(v.children()[2], v.m_fg->m_renderToTextureRootNode);
+        QCOMPARE(v.children()[0], v.m_fg->m_renderToTextureRootNode);
+        QCOMPARE(v.children()[1], v.m_fg->m_renderTargets[0]);
+        QCOMPARE(v.children()[2], &plane);
         QCOMPARE(v.children()[3], v.m_fg->m_renderTargets[1]);
         QCOMPARE(v.children()[4], v.m_fxStages);
         QCOMPARE(v.children()[5], v.m_internalFXStages);
@@ -52,6 +52,7 @@ private Q_SLOTS:
         QCOMPARE(view.screenSize(), QSize());
         QCOMPARE(view.isReady(), false);
         QCOMPARE(view.isLoaded(), false);
+        QCOMPARE(view.loadingProgress(), 0.0f);
         QCOMPARE(view.asynchronous(), false);
         QVERIFY(view.activeScene() == nullptr);
         QVERIFY(view.animationPlayers().empty());
@@ -79,6 +80,22 @@ private Q_SLOTS:
         QCOMPARE(view.source(), view.importer()->source());
     }
 
+    void checkTracksTextureImages()
+    {
+        // GIVEN
+        KuesaUtils::View3DScene view;
+
+        // WHEN
+        view.setSource(QUrl("file:///" ASSETS "simple_cube_with_images.gtlf"));
+
+        // THEN -> the images of the textures are tracked and never get
+        // loaded without a renderer
+        QTRY_COMPARE(view.isLoaded(), true);
+        QCOMPARE(view.textures()->size(), 2);
+        QCOMPARE(view.loadingProgress(), 0.0f);
+        QCOMPARE(view.isReady(), false);
+    }
+
     void checkSetAutoloadReflections()
     {
         // GIVEN
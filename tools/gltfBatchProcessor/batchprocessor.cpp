@@ -0,0 +1,250 @@
+/*
+    batchprocessor.cpp
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "batchprocessor.h"
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QSet>
+#include <QThread>
+#include <QThreadPool>
+#include <Kuesa/private/gltf2context_p.h>
+#include <Kuesa/private/gltf2parser_p.h>
+
+#include <algorithm>
+#include <vector>
+
+using namespace Kuesa;
+
+namespace {
+
+// Warnings emitted while processing a file, e.g. by the parser, end up in
+// the report of that file rather than on the console
+thread_local QStringList *t_capturedMessages = nullptr;
+QtMessageHandler s_previousMessageHandler = nullptr;
+
+void captureMessage(QtMsgType type, const QMessageLogContext &context, const QString &message)
+{
+    if (t_capturedMessages && (type == QtWarningMsg || type == QtCriticalMsg)) {
+        t_capturedMessages->push_back(message);
+        return;
+    }
+    if (s_previousMessageHandler)
+        s_previousMessageHandler(type, context, message);
+}
+
+class MessageCapture
+{
+public:
+    explicit MessageCapture(QStringList *messages)
+    {
+        t_capturedMessages = messages;
+    }
+
+    ~MessageCapture()
+    {
+        t_capturedMessages = nullptr;
+    }
+};
+
+double elapsedMs(const QElapsedTimer &timer)
+{
+    return double(timer.nsecsElapsed()) / 1000000.0;
+}
+
+} // namespace
+
+BatchProcessor::BatchProcessor()
+    : m_jobCount(0)
+{
+}
+
+void BatchProcessor::setOutputDirectory(const QString &outputDirectory)
+{
+    m_outputDirectory = outputDirectory;
+}
+
+QString BatchProcessor::outputDirectory() const
+{
+    return m_outputDirectory;
+}
+
+void BatchProcessor::setExportConfiguration(const GLTF2ExportConfiguration &configuration)
+{
+    m_exportConfiguration = configuration;
+}
+
+GLTF2ExportConfiguration BatchProcessor::exportConfiguration() const
+{
+    return m_exportConfiguration;
+}
+
+void BatchProcessor::setJobCount(int jobCount)
+{
+    m_jobCount = std::max(0, jobCount);
+}
+
+int BatchProcessor::jobCount() const
+{
+    return m_jobCount;
+}
+
+// Returns a report listing, in the order of \a sources, whether each file
+// was processed successfully along with its errors, warnings and timings
+QJsonObject BatchProcessor::process(const QStringList &sources) const
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    const QStringList targets = targetDirectories(sources);
+    std::vector<QJsonObject> results(size_t(sources.size()));
+    const int jobs = m_jobCount > 0 ? m_jobCount : std::max(1, QThread::idealThreadCount());
+
+    s_previousMessageHandler = qInstallMessageHandler(captureMessage);
+    {
+        QThreadPool pool;
+        pool.setMaxThreadCount(jobs);
+        for (int i = 0, m = sources.size(); i < m; ++i)
+            pool.start([this, &sources, &targets, &results, i] {
+                results[size_t(i)] = processFile(sources.at(i), targets.at(i));
+            });
+        pool.waitForDone();
+    }
+    qInstallMessageHandler(s_previousMessageHandler);
+
+    QJsonArray files;
+    int failed = 0;
+    for (const QJsonObject &result : results) {
+        if (!result.value(QStringLiteral("success")).toBool())
+            ++failed;
+        files.push_back(result);
+    }
+
+    QJsonObject report;
+    report[QStringLiteral("files")] = files;
+    report[QStringLiteral("succeeded")] = sources.size() - failed;
+    report[QStringLiteral("failed")] = failed;
+    report[QStringLiteral("jobs")] = jobs;
+    report[QStringLiteral("elapsed")] = elapsedMs(timer);
+    return report;
+}
+
+QJsonObject BatchProcessor::processFile(const QString &source, const QString &targetDirectory) const
+{
+    QElapsedTimer totalTimer;
+    totalTimer.start();
+
+    QStringList errors;
+    QStringList warnings;
+    QJsonObject timings;
+    QJsonObject result;
+    const QFileInfo sourceInfo(source);
+    result[QStringLiteral("source")] = sourceInfo.absoluteFilePath();
+
+    {
+        MessageCapture capture(&warnings);
+
+        GLTF2Import::GLTF2Context context;
+        GLTF2Import::GLTF2Parser parser;
+        parser.setContext(&context);
+
+        QElapsedTimer timer;
+        timer.start();
+        bool parsed = false;
+        if (!sourceInfo.isFile())
+            errors << QStringLiteral("File not found");
+        else if (!(parsed = parser.parse(sourceInfo.absoluteFilePath())))
+            errors << QStringLiteral("Failed to parse");
+        timings[QStringLiteral("parse")] = elapsedMs(timer);
+
+        if (parsed && !targetDirectory.isEmpty()) {
+            const QDir target(targetDirectory);
+            if (sourceInfo.suffix().compare(QLatin1String("glb"), Qt::CaseInsensitive) == 0) {
+                // The binary chunk isn't referenced by any uri the export passes could process
+                errors << QStringLiteral("Exporting binary glTF files is not supported");
+            } else if (!target.mkpath(QStringLiteral("."))) {
+                errors << QStringLiteral("Failed to create output directory %1").arg(target.absolutePath());
+            } else {
+                GLTF2Exporter exporter;
+                exporter.setContext(&context);
+                exporter.setConfiguration(m_exportConfiguration);
+
+                timer.restart();
+                const GLTF2Exporter::Export exported = exporter.saveInFolder(sourceInfo.absoluteDir(), target);
+                timings[QStringLiteral("export")] = elapsedMs(timer);
+                errors << exporter.errors();
+
+                if (exported.success()) {
+                    timer.restart();
+                    QFile file(target.absoluteFilePath(sourceInfo.completeBaseName() + QStringLiteral(".gltf")));
+                    const QByteArray json = QJsonDocument(exported.json()).toJson();
+                    if (!file.open(QIODevice::WriteOnly) || file.write(json) != json.size())
+                        errors << QStringLiteral("Failed to write %1").arg(file.fileName());
+                    else
+                        result[QStringLiteral("output")] = file.fileName();
+                    timings[QStringLiteral("write")] = elapsedMs(timer);
+                }
+            }
+        }
+    }
+
+    timings[QStringLiteral("total")] = elapsedMs(totalTimer);
+    result[QStringLiteral("success")] = errors.empty();
+    result[QStringLiteral("errors")] = QJsonArray::fromStringList(errors);
+    result[QStringLiteral("warnings")] = QJsonArray::fromStringList(warnings);
+    result[QStringLiteral("timings")] = timings;
+    return result;
+}
+
+// Each file is exported in its own directory, as files of different sources
+// could otherwise overwrite each other's buffers and images. Directories are
+// named after the sources, numbered when several sources share a name.
+QStringList BatchProcessor::targetDirectories(const QStringList &sources) const
+{
+    QStringList targets;
+    if (m_outputDirectory.isEmpty()) {
+        for (int i = 0, m = sources.size(); i < m; ++i)
+            targets.push_back(QString());
+        return targets;
+    }
+
+    const QDir outputDir(m_outputDirectory);
+    QSet<QString> usedNames;
+    for (const QString &source : sources) {
+        const QString baseName = QFileInfo(source).completeBaseName();
+        QString name = baseName;
+        for (int i = 1; usedNames.contains(name); ++i)
+            name = QStringLiteral("%1-%2").arg(baseName).arg(i);
+        usedNames.insert(name);
+        targets.push_back(outputDir.absoluteFilePath(name));
+    }
+    return targets;
+}
@@ -0,0 +1,67 @@
+/*
+    batchprocessor.h
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#ifndef GLTFBATCHPROCESSOR_BATCHPROCESSOR_H
+#define GLTFBATCHPROCESSOR_BATCHPROCESSOR_H
+
+#include <QJsonObject>
+#include <QStringList>
+#include <Kuesa/private/gltf2exporter_p.h>
+
+// Loads and validates glTF 2.0 files on a pool of worker threads and,
+// when an output directory is set, exports them through GLTF2Exporter.
+// Only the parsing step of the importer is run, which doesn't need a
+// display nor a GPU.
+class BatchProcessor
+{
+public:
+    BatchProcessor();
+
+    // Empty to only validate the files
+    void setOutputDirectory(const QString &outputDirectory);
+    QString outputDirectory() const;
+
+    void setExportConfiguration(const Kuesa::GLTF2ExportConfiguration &configuration);
+    Kuesa::GLTF2ExportConfiguration exportConfiguration() const;
+
+    // 0 to use one job per core
+    void setJobCount(int jobCount);
+    int jobCount() const;
+
+    QJsonObject process(const QStringList &sources) const;
+
+private:
+    QJsonObject processFile(const QString &source, const QString &targetDirectory) const;
+    QStringList targetDirectories(const QStringList &sources) const;
+
+    QString m_outputDirectory;
+    Kuesa::GLTF2ExportConfiguration m_exportConfiguration;
+    int m_jobCount;
+};
+
+#endif // GLTFBATCHPROCESSOR_BATCHPROCESSOR_H
@@ -0,0 +1,5 @@
+INCLUDEPATH += $$PWD
+
+SOURCES += $$PWD/batchprocessor.cpp
+
+HEADERS += $$PWD/batchprocessor.h
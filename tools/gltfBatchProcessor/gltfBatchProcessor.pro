@@ -0,0 +1,15 @@
+QT += kuesa kuesa-private
+CONFIG += console
+CONFIG -= app_bundle
+
+include($$KUESA_ROOT/kuesa-global.pri)
+include(batchprocessor.pri)
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+SOURCES += main.cpp
+
+target.path = $$[QT_INSTALL_BINS]
+INSTALLS += target
+
+OTHER_FILES += README.md
@@ -0,0 +1,156 @@
+/*
+    main.cpp
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "batchprocessor.h"
+#include <qtkuesa-config.h>
+#include <QGuiApplication>
+#include <QCommandLineParser>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <Kuesa/kuesaversion.h>
+
+#include <cstdio>
+
+using namespace Kuesa;
+
+namespace {
+
+// Expands directories into the glTF files they contain, recursively
+QStringList collectSources(const QStringList &arguments)
+{
+    QStringList sources;
+    for (const QString &argument : arguments) {
+        if (!QFileInfo(argument).isDir()) {
+            sources.push_back(argument);
+            continue;
+        }
+        QStringList files;
+        QDirIterator it(argument, { QStringLiteral("*.gltf"), QStringLiteral("*.glb") },
+                        QDir::Files, QDirIterator::Subdirectories);
+        while (it.hasNext())
+            files.push_back(it.next());
+        files.sort();
+        sources += files;
+    }
+    return sources;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    // Only the parser is run, which doesn't need a display
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+
+    QCoreApplication::setApplicationName("gltfBatchProcessor");
+    QCoreApplication::setOrganizationDomain("kdab.com");
+    QCoreApplication::setOrganizationName("KDAB");
+    QCoreApplication::setApplicationVersion(KUESA_VERSION_STR);
+
+    QGuiApplication app(argc, argv);
+
+    QCommandLineParser cmdline;
+    cmdline.addHelpOption();
+    cmdline.addVersionOption();
+    cmdline.setApplicationDescription(
+            QObject::tr("\nThis tool validates and exports glTF 2.0 files in parallel.\n"
+                        "Example : ./gltfBatchProcessor -o out -e all -r report.json assets/"));
+    cmdline.addPositionalArgument("sources", QCoreApplication::translate("main", "gltf 2.0 files or directories to process."), "[sources...]");
+
+    QCommandLineOption outputOption({ "o", "output" }, QObject::tr("directory where exported files are written, only validate if not set"),
+                                    QObject::tr("directory"));
+    QCommandLineOption embedOption({ "e", "embed" }, QObject::tr("embedding of buffers and images: keep, none or all"),
+                                   QObject::tr("mode"), QStringLiteral("keep"));
+    QCommandLineOption compressOption({ "c", "compress" }, QObject::tr("compress meshes with Draco"));
+    QCommandLineOption jobsOption({ "j", "jobs" }, QObject::tr("number of files processed in parallel, one per core by default"),
+                                  QObject::tr("count"), QStringLiteral("0"));
+    QCommandLineOption reportOption({ "r", "report" }, QObject::tr("file where the JSON report is written, standard output by default"),
+                                    QObject::tr("file"));
+    cmdline.addOptions({ outputOption, embedOption, compressOption, jobsOption, reportOption });
+
+    cmdline.process(app);
+
+    const QStringList sources = collectSources(cmdline.positionalArguments());
+    if (sources.empty()) {
+        qCritical("No input file.\n%s", cmdline.helpText().toLatin1().constData());
+        return 1;
+    }
+
+    GLTF2ExportConfiguration configuration;
+    const QString embedding = cmdline.value(embedOption);
+    if (embedding == QLatin1String("keep")) {
+        configuration.setEmbedding(GLTF2ExportConfiguration::Embed::Keep);
+    } else if (embedding == QLatin1String("none")) {
+        configuration.setEmbedding(GLTF2ExportConfiguration::Embed::None);
+    } else if (embedding == QLatin1String("all")) {
+        configuration.setEmbedding(GLTF2ExportConfiguration::Embed::All);
+    } else {
+        qCritical("Invalid embedding mode %s", qPrintable(embedding));
+        return 1;
+    }
+
+    if (cmdline.isSet(compressOption)) {
+#if defined(KUESA_DRACO_COMPRESSION)
+        configuration.setMeshCompressionEnabled(true);
+#else
+        qCritical("Kuesa was built without Draco support, meshes can't be compressed");
+        return 1;
+#endif
+    }
+
+    bool ok = false;
+    const int jobs = cmdline.value(jobsOption).toInt(&ok);
+    if (!ok || jobs < 0) {
+        qCritical("Invalid number of jobs %s", qPrintable(cmdline.value(jobsOption)));
+        return 1;
+    }
+
+    BatchProcessor processor;
+    processor.setOutputDirectory(cmdline.value(outputOption));
+    processor.setExportConfiguration(configuration);
+    processor.setJobCount(jobs);
+
+    const QJsonObject report = processor.process(sources);
+    const QByteArray json = QJsonDocument(report).toJson();
+
+    if (cmdline.isSet(reportOption)) {
+        QFile file(cmdline.value(reportOption));
+        if (!file.open(QIODevice::WriteOnly) || file.write(json) != json.size()) {
+            qCritical("Failed to write %s", qPrintable(file.fileName()));
+            return 1;
+        }
+        printf("%d files processed, %d failed\n", int(sources.size()), report.value(QStringLiteral("failed")).toInt());
+    } else {
+        fwrite(json.constData(), 1, size_t(json.size()), stdout);
+    }
+
+    return report.value(QStringLiteral("failed")).toInt() == 0 ? 0 : 1;
+}
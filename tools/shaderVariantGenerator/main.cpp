@@ -0,0 +1,171 @@
+/*
+    main.cpp
+
+    This file is part of Kuesa.
+
+    Copyright (C) 2018-2021 Klarälvdalens Datakonsult AB, a KDAB Group company, info@kdab.com
+    Author: Paul Lemire <paul.lemire@kdab.com>
+
+    Licensees holding valid proprietary KDAB Kuesa licenses may use this file in
+    accordance with the Kuesa Enterprise License Agreement provided with the Software in the
+    LICENSE.KUESA.ENTERPRISE file.
+
+    Contact info@kdab.com if any conditions of this licensing are not clear to you.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include <QGuiApplication>
+#include <QCommandLineParser>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QMetaEnum>
+#include <QSet>
+#include <Qt3DRender/QEffect>
+#include <Kuesa/private/effectslibrary_p.h>
+#include <Kuesa/private/gltf2context_p.h>
+#include <Kuesa/private/gltf2parser_p.h>
+#include <Kuesa/private/shadervariantcache_p.h>
+#include <Kuesa/GLTF2MaterialEffect>
+#include <Kuesa/kuesaversion.h>
+
+#include <memory>
+
+using namespace Kuesa;
+
+namespace {
+
+bool writeVariants(const Qt3DRender::QEffect *effect, const QDir &outputDir,
+                   bool listOnly, QSet<QString> &writtenFiles)
+{
+    const auto variants = ShaderVariantCache::instance()->generate(effect);
+    for (const ShaderVariantCache::GeneratedVariant &variant : variants) {
+        if (writtenFiles.contains(variant.fileName))
+            continue;
+        writtenFiles.insert(variant.fileName);
+
+        if (listOnly) {
+            printf("%s\n", qPrintable(variant.fileName));
+            continue;
+        }
+
+        QFile file(outputDir.filePath(variant.fileName));
+        if (!file.open(QIODevice::WriteOnly) || file.write(variant.code) != variant.code.size()) {
+            qCritical("Failed to write %s", qPrintable(file.fileName()));
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    // The graph builder doesn't need a display
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+
+    QCoreApplication::setApplicationName("shaderVariantGenerator");
+    QCoreApplication::setOrganizationDomain("kdab.com");
+    QCoreApplication::setOrganizationName("KDAB");
+    QCoreApplication::setApplicationVersion(KUESA_VERSION_STR);
+
+    QGuiApplication app(argc, argv);
+
+    QCommandLineParser cmdline;
+    cmdline.addHelpOption();
+    cmdline.addVersionOption();
+    cmdline.setApplicationDescription(
+            QObject::tr("\nThis tool generates the shader variants used by glTF 2.0 files.\n"
+                        "Example : ./shaderVariantGenerator -o variants my_file.gltf"));
+    cmdline.addPositionalArgument("sources", QCoreApplication::translate("main", "gltf 2.0 files to scan for materials."), "[sources...]");
+
+    QCommandLineOption outputOption({ "o", "output" }, QObject::tr("directory where variants are written"),
+                                    QObject::tr("directory"), QStringLiteral("."));
+    QCommandLineOption propertiesOption({ "p", "properties" }, QObject::tr("generate variants for effect properties, e.g. MetallicRoughness|BaseColorMap"),
+                                        QObject::tr("properties"));
+    QCommandLineOption listOption({ "l", "list" }, QObject::tr("only list the variant files"));
+    cmdline.addOptions({ outputOption, propertiesOption, listOption });
+
+    cmdline.process(app);
+
+    const QStringList sources = cmdline.positionalArguments();
+    const QStringList declaredProperties = cmdline.values(propertiesOption);
+    if (sources.empty() && declaredProperties.empty()) {
+        qCritical("No input file or effect properties.\n%s", cmdline.helpText().toLatin1().constData());
+        return 1;
+    }
+
+    const bool listOnly = cmdline.isSet(listOption);
+    const QDir outputDir(cmdline.value(outputOption));
+    if (!listOnly && !outputDir.mkpath(QStringLiteral("."))) {
+        qCritical("Failed to create output directory %s", qPrintable(outputDir.path()));
+        return 1;
+    }
+
+    // Never short-circuit the builders with previously generated variants
+    ShaderVariantCache::instance()->setPaths({});
+
+    QSet<QString> writtenFiles;
+    const QMetaEnum propertiesEnum = QMetaEnum::fromType<EffectProperties::Properties>();
+    for (const QString &declared : declaredProperties) {
+        bool ok = false;
+        const int properties = propertiesEnum.keysToValue(declared.toLatin1().constData(), &ok);
+        if (!ok) {
+            qCritical("Invalid effect properties %s", qPrintable(declared));
+            return 1;
+        }
+        std::unique_ptr<GLTF2MaterialEffect> effect(EffectsLibrary::createEffectWithKey(EffectProperties::Properties(properties)));
+        if (!effect) {
+            qCritical("No effect matches properties %s", qPrintable(declared));
+            return 1;
+        }
+        if (!writeVariants(effect.get(), outputDir, listOnly, writtenFiles))
+            return 1;
+    }
+
+    for (const QString &source : sources) {
+        if (!QFileInfo::exists(source)) {
+            qCritical("Input file %s not found.", qPrintable(source));
+            return 1;
+        }
+
+        GLTF2Import::GLTF2Context context;
+        GLTF2Import::GLTF2Parser parser;
+        parser.setContext(&context);
+        if (!parser.parse(source)) {
+            qCritical("Failed to parse %s", qPrintable(source));
+            return 1;
+        }
+        parser.generateContent();
+
+        const EffectsLibrary *library = context.effectLibrary();
+        const auto effects = library->effects();
+        for (const GLTF2MaterialEffect *effect : effects) {
+            if (!writeVariants(effect, outputDir, listOnly, writtenFiles))
+                return 1;
+        }
+        const auto customEffects = library->customEffects();
+        for (const EffectsLibrary::CustomEffectKeyPair &customEffect : customEffects) {
+            if (!writeVariants(customEffect.second, outputDir, listOnly, writtenFiles))
+                return 1;
+        }
+    }
+
+    if (!listOnly)
+        printf("%d shader variants written to %s\n", int(writtenFiles.size()), qPrintable(outputDir.path()));
+    return 0;
+}
@@ -36,5 +36,7 @@ QT_FOR_CONFIG += kuesa
 qtConfig(kuesa-tools) {
 
 !uikit:!android: SUBDIRS += \
-    gltfViewer
+    gltfViewer \
+    shaderVariantGenerator \
+    gltfBatchProcessor
 }